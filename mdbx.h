@@ -878,6 +878,22 @@ enum MDBX_constants {
 #endif /* Windows */
 #endif /* MDBX_LOCK_SUFFIX */
 
+#ifndef MDBX_VLOG_SUFFIX
+/** \brief The suffix appended to the data file name to name the value log
+ * \see mdbx_dbi_set_vlog() */
+#if !(defined(_WIN32) || defined(_WIN64))
+#define MDBX_VLOG_SUFFIX "-vlog"
+#else
+#define MDBX_VLOG_SUFFIX_W L"-vlog"
+#define MDBX_VLOG_SUFFIX_A "-vlog"
+#ifdef UNICODE
+#define MDBX_VLOG_SUFFIX MDBX_VLOG_SUFFIX_W
+#else
+#define MDBX_VLOG_SUFFIX MDBX_VLOG_SUFFIX_A
+#endif /* UNICODE */
+#endif /* Windows */
+#endif /* MDBX_VLOG_SUFFIX */
+
 /* DEBUG & LOGGING ************************************************************/
 
 /** \addtogroup c_debug
@@ -1585,7 +1601,14 @@ enum MDBX_db_flags_t {
    * (must be one of uint32_t or uint64_t, other integer types, for example,
    * signed integer or uint16_t will not work).
    * The keys must all be of the same size and must be aligned while passing as
-   * arguments. */
+   * arguments.
+   *
+   * The search within pages starts from the position interpolated between the
+   * first and the last keys, so for dense sequences (e.g. row ids 0..N) the
+   * position is computed rather than searched. Combined with
+   * \ref MDBX_FIXEDSIZE and \ref MDBX_APPEND this turns a table into a
+   * densely packed array of fixed-size records, while keeping MVCC and
+   * transactions. */
   MDBX_INTEGERKEY = UINT32_C(0x08),
 
   /** With \ref MDBX_DUPSORT; sorted dup items have fixed size. The data values
@@ -1600,6 +1623,49 @@ enum MDBX_db_flags_t {
   /** With \ref MDBX_DUPSORT; use reverse string comparison for data values. */
   MDBX_REVERSEDUP = UINT32_C(0x40),
 
+  /** Without \ref MDBX_DUPSORT; all keys and all data values have fixed
+   * lengths, which are defined by the first inserted pair.
+   *
+   * Such pairs are stored densely packed (like items of \ref MDBX_DUPFIXED
+   * multi-values) without any per-pair headers, therefore a page holds
+   * noticeably more items and the search within page is performed over plain
+   * array. The key length remains fixed for the table lifetime, but the data
+   * length may be changed after the table became empty. The sum of key and
+   * data lengths must not exceed \ref mdbx_limits_keysize_max(), otherwise
+   * \ref MDBX_BAD_VALSIZE will be returned. Not compatible with
+   * \ref MDBX_DUPSORT and its accompanying flags, as well with
+   * value compression, value log, bulk loading and streaming puts. */
+  MDBX_FIXEDSIZE = UINT32_C(0x80),
+
+  /** Without \ref MDBX_DUPSORT and \ref MDBX_FIXEDSIZE; the data values are
+   * placed within pages at 8-byte aligned addresses.
+   *
+   * Keys are padded so the values start at the alignment boundary, and values
+   * on large/overflow pages are shifted past the page header. Thus a value
+   * could be accessed directly as a C structure without copying it into an
+   * aligned buffer. The price is up to alignment-minus-one bytes of padding
+   * for each key and each value, and a bit lower maximal key length (see
+   * \ref mdbx_limits_keysize_max()).
+   *
+   * The alignment is guaranteed for values read from the memory-mapped
+   * database, i.e. within read-only transactions and in the
+   * \ref MDBX_WRITEMAP mode. Without \ref MDBX_WRITEMAP a write transaction
+   * keeps modified pages in the heap, where the alignment is provided only up
+   * to the one of `malloc()`.
+   *
+   * Only one of \ref MDBX_ALIGNVALUE8, \ref MDBX_ALIGNVALUE16 and
+   * \ref MDBX_ALIGNVALUE64 can be specified. Not compatible with value
+   * compression, value log, bulk loading and streaming puts, and a main
+   * table with aligned values couldn't contain named sub-databases. */
+  MDBX_ALIGNVALUE8 = UINT32_C(0x100),
+
+  /** Same as \ref MDBX_ALIGNVALUE8 but with 16-byte alignment. */
+  MDBX_ALIGNVALUE16 = UINT32_C(0x200),
+
+  /** Same as \ref MDBX_ALIGNVALUE8 but with 64-byte (cache line)
+   * alignment. */
+  MDBX_ALIGNVALUE64 = UINT32_C(0x400),
+
   /** Create DB if not already existing. */
   MDBX_CREATE = UINT32_C(0x40000),
 
@@ -1607,8 +1673,8 @@ enum MDBX_db_flags_t {
    *
    * The `MDBX_DB_ACCEDE` flag is intend to open a existing sub-database which
    * was created with unknown flags (\ref MDBX_REVERSEKEY, \ref MDBX_DUPSORT,
-   * \ref MDBX_INTEGERKEY, \ref MDBX_DUPFIXED, \ref MDBX_INTEGERDUP and
-   * \ref MDBX_REVERSEDUP).
+   * \ref MDBX_INTEGERKEY, \ref MDBX_DUPFIXED, \ref MDBX_INTEGERDUP,
+   * \ref MDBX_REVERSEDUP, \ref MDBX_FIXEDSIZE and alignment of values).
    *
    * In such cases, instead of returning the \ref MDBX_INCOMPATIBLE error, the
    * sub-database will be opened with flags which it was created, and then an
@@ -1935,8 +2001,12 @@ enum MDBX_error_t {
   /** Alternative/Duplicate LCK-file is exists and should be removed manually */
   MDBX_DUPLICATED_CLK = -30413,
 
+  /** An optimistic transaction conflicts with changes committed after it
+   * was started and should be retried, see \ref mdbx_txn_begin_optimistic() */
+  MDBX_TXN_CONFLICT = -30412,
+
   /* The last of MDBX-added error codes */
-  MDBX_LAST_ADDED_ERRCODE = MDBX_TXN_OVERLAPPING,
+  MDBX_LAST_ADDED_ERRCODE = MDBX_TXN_CONFLICT,
 
 #if defined(_WIN32) || defined(_WIN64)
   MDBX_ENODATA = ERROR_HANDLE_EOF,
@@ -2631,6 +2701,20 @@ struct MDBX_envinfo {
     uint64_t
         fsync; /**< Number of explicit fsync-to-disk operations (not a pages) */
   } mi_pgop_stat;
+
+  /** Statistics of inter-process locks.
+   * \details Provided only for the futex-based locking, i.e. when libmdbx was
+   * built with `MDBX_LOCKING=1995`, otherwise all values are zeros. */
+  struct {
+    uint32_t wlock_waiters; /**< Number of processes and threads which are
+                                 waiting for the write-transaction lock */
+    uint32_t rlock_waiters; /**< Number of processes and threads which are
+                                 waiting for the readers registration lock */
+    uint64_t wlock_contended; /**< Number of the write-transaction lock
+                                   acquisitions with waiting */
+    uint64_t rlock_contended; /**< Number of the readers registration lock
+                                   acquisitions with waiting */
+  } mi_lock_stat;
 };
 #ifndef __cplusplus
 /** \ingroup c_statinfo */
@@ -2718,6 +2802,56 @@ LIBMDBX_INLINE_API(int, mdbx_env_sync_poll, (MDBX_env * env)) {
   return mdbx_env_sync_ex(env, false, true);
 }
 
+/** \brief Waits for a commit of a write transaction with ID greater than the
+ * given one, by any process which operates with the environment.
+ * \ingroup c_extra
+ *
+ * This allows follower processes to discover new commits without polling
+ * \ref mdbx_txn_begin() in a loop. On Linux the waiting is performed by futex
+ * on a counter within the lock file, which is signalled at the end of
+ * \ref mdbx_txn_commit_ex(), so a waiter wakes up immediately after a commit.
+ * On other platforms a short-period polling is used.
+ *
+ * \param [in] env          An environment handle returned
+ *                          by \ref mdbx_env_create().
+ * \param [in] after_txnid  The ID of the last transaction known to the caller,
+ *                          for instance obtained by \ref mdbx_txn_id().
+ * \param [in] timeout_seconds_16dot16  Timeout in 1/65536 of second,
+ *                          zero means to wait infinitely.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ * some possible errors are:
+ * \retval MDBX_RESULT_TRUE  The specified timeout is reached and
+ *                           no new transaction was committed.
+ * \retval MDBX_EINVAL       An invalid parameter was specified. */
+LIBMDBX_API int mdbx_env_wait_commit(const MDBX_env *env, uint64_t after_txnid,
+                                     unsigned timeout_seconds_16dot16);
+
+/** \brief Returns a file descriptor which becomes readable after each commit
+ * of a write transaction by any process which operates with the environment.
+ * \ingroup c_extra
+ *
+ * The descriptor is intended for integration into event loops based on
+ * `epoll()`, `poll()`, `select()` etc. It is an eventfd on Linux and the read
+ * end of a pipe on other POSIX systems, in both cases in the non-blocking
+ * mode. On the first call a background thread is started, which waits for
+ * commits by the same way as \ref mdbx_env_wait_commit() and signals
+ * the descriptor. Thus the descriptor should be drained by reading until
+ * `EAGAIN`, then a new read transaction may be started to see the changes.
+ *
+ * The descriptor and the thread are owned by the environment and will be
+ * released by \ref mdbx_env_close(), so the caller should not close it.
+ *
+ * \param [in] env   An environment handle returned by \ref mdbx_env_create().
+ * \param [out] fd   Address of a \ref mdbx_filehandle_t to store
+ *                   the descriptor.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ * some possible errors are:
+ * \retval MDBX_ENOSYS  Not supported on Windows.
+ * \retval MDBX_EINVAL  An invalid parameter was specified. */
+LIBMDBX_API int mdbx_env_get_commit_fd(MDBX_env *env, mdbx_filehandle_t *fd);
+
 /** \brief Sets threshold to force flush the data buffers to disk, even any of
  * \ref MDBX_SAFE_NOSYNC flag in the environment.
  * \ingroup c_settings
@@ -3336,11 +3470,13 @@ mdbx_limits_txnsize_max(intptr_t pagesize);
  * \ingroup c_settings
  *
  * \details This defines the number of slots in the lock table that is used to
- * track readers in the the environment. The default is about 100 for 4K system
- * page size. Starting a read-only transaction normally ties a lock table slot
- * to the current thread until the environment closes or the thread exits. If
- * \ref MDBX_NOTLS is in use, \ref mdbx_txn_begin() instead ties the slot to the
- * \ref MDBX_txn object until it or the \ref MDBX_env object is destroyed.
+ * track readers in the the environment. The lock table is allocated by shards
+ * of 64 slots, so the requested number is rounded up accordingly, up to 131072
+ * slots at most. The default is 64 slots. Starting a read-only transaction
+ * normally ties a lock table slot to the current thread until the environment
+ * closes or the thread exits. If \ref MDBX_NOTLS is in use,
+ * \ref mdbx_txn_begin() instead ties the slot to the \ref MDBX_txn object until
+ * it or the \ref MDBX_env object is destroyed.
  * This function may only be called after \ref mdbx_env_create() and before
  * \ref mdbx_env_open(), and has an effect only when the database is opened by
  * the first process interacts with the database.
@@ -3651,6 +3787,109 @@ LIBMDBX_INLINE_API(int, mdbx_txn_begin,
   return mdbx_txn_begin_ex(env, parent, flags, txn, NULL);
 }
 
+/** \brief Create a disjoint write transaction, which could run concurrently
+ * with other ones on top of the same write transaction.
+ * \ingroup c_transactions
+ *
+ * A disjoint transaction is a kind of nested transaction, which is allowed to
+ * change only the tables declared at its start. Several disjoint transactions
+ * for the non-overlapping sets of tables could be started on top of the same
+ * top-level write transaction and run in parallel by different threads.
+ * The pages are allocated from the parent's reclaimed list and the
+ * unallocated end of the database in portions, so the disjoint transactions
+ * neither touch the GC nor block each other except for a short time.
+ *
+ * Committing a disjoint transaction just accepts its changes into the parent,
+ * and the durability is provided only by the following commit of the parent.
+ * The changes of all disjoint transactions are merged into the parent when
+ * the last running one of them is finished.
+ *
+ * \note While there are running disjoint transactions, the parent
+ * transaction could not be used for anything else: \ref mdbx_txn_commit()
+ * and \ref mdbx_txn_abort() return \ref MDBX_BUSY, and other operations
+ * return \ref MDBX_BAD_TXN.
+ *
+ * \note A disjoint transaction could not open new tables (\ref MDBX_EPERM),
+ * change tables other than declared (\ref MDBX_EACCESS), including the
+ * canary and records of tables in the main DB, and could not have nested
+ * transactions. So all required tables should be opened beforehand, and
+ * the declared ones are held until all the concurrent disjoint transactions
+ * are finished. Also a disjoint transaction could not spill its dirty pages,
+ * therefore the amount of changes is limited by the free room of the parent
+ * (\ref MDBX_TXN_FULL).
+ *
+ * \param [in] parent  The top-level write transaction, which must be not
+ *                     nested and not used in the \ref MDBX_WRITEMAP mode.
+ *                     The function could be called from any thread.
+ * \param [in] dbis    An array of the tables handles which will be changed
+ *                     by the transaction. The handle of the main DB
+ *                     (i.e. `1`) is allowed, but the GC (i.e. `0`) is not.
+ * \param [in] count   The number of items in the `dbis` array.
+ * \param [in] flags   Reserved for future use, must be
+ *                     \ref MDBX_TXN_READWRITE.
+ * \param [out] txn    Address where the new \ref MDBX_txn handle will be
+ *                     stored. The transaction belongs to the calling thread.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EINVAL       An invalid parameter was specified.
+ * \retval MDBX_BAD_TXN      The parent is not a top-level write transaction,
+ *                           already finished or has a nested transaction.
+ * \retval MDBX_INCOMPATIBLE The environment is in \ref MDBX_WRITEMAP mode.
+ * \retval MDBX_BAD_DBI      Some table handle is invalid.
+ * \retval MDBX_BUSY         Some table is held by another disjoint transaction
+ *                           or is used by a cursor of the parent.
+ * \retval MDBX_ENOMEM       Out of memory. */
+LIBMDBX_API int mdbx_txn_begin_disjoint(MDBX_txn *parent, const MDBX_dbi *dbis,
+                                        size_t count, MDBX_txn_flags_t flags,
+                                        MDBX_txn **txn);
+
+/** \brief Starts an optimistic write transaction, which doesn't hold the
+ * writer lock until commit.
+ * \ingroup c_transactions
+ *
+ * An optimistic transaction works with a read-only snapshot of the database,
+ * so any number of such transactions could run in parallel by different
+ * threads together with a regular write transaction. Keys read by
+ * \ref mdbx_get() are tracked, while updates made by \ref mdbx_put() and
+ * \ref mdbx_del() are buffered within the transaction and are visible only
+ * to its own reads.
+ *
+ * On \ref mdbx_txn_commit() the writer lock is acquired and every tracked
+ * read is validated against the recent committed state. A key is treated as
+ * unchanged when the lookup ends on the same leaf page as it was in the
+ * snapshot, since pages of a snapshot are never reused while it is in use,
+ * otherwise the values are compared. When the validation succeeds the
+ * buffered updates are replayed and committed as a regular write transaction,
+ * otherwise the transaction is aborted and \ref MDBX_TXN_CONFLICT returned,
+ * so the whole transaction should be retried by the application.
+ *
+ * \note Only \ref mdbx_get(), \ref mdbx_get_ex(), \ref mdbx_put() without
+ * flags or with \ref MDBX_NOOVERWRITE, and \ref mdbx_del() are supported for
+ * tables without \ref MDBX_DUPSORT. Cursors and \ref mdbx_get_equal_or_great()
+ * return \ref MDBX_INCOMPATIBLE, since their reads can't be tracked, and other
+ * modifying operations return \ref MDBX_EACCESS as in a read-only transaction.
+ * Values returned from the buffered updates are valid until the end of the
+ * transaction.
+ * \ref mdbx_txn_reset() and \ref mdbx_txn_renew() are not supported.
+ *
+ * \param [in] env     An environment handle returned by \ref mdbx_env_create().
+ * \param [in] flags   Special options for the final write transaction,
+ *                     a combination of \ref MDBX_TXN_NOMETASYNC,
+ *                     \ref MDBX_TXN_NOSYNC and \ref MDBX_TXN_TRY.
+ * \param [out] txn    Address where the new \ref MDBX_txn handle will be
+ *                     stored.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EINVAL       An invalid parameter was specified.
+ * \retval MDBX_EACCESS      The environment is opened in read-only mode.
+ * \retval MDBX_TXN_OVERLAPPING  The current thread runs a write transaction.
+ * \retval MDBX_ENOMEM       Out of memory. */
+LIBMDBX_API int mdbx_txn_begin_optimistic(MDBX_env *env,
+                                          MDBX_txn_flags_t flags,
+                                          MDBX_txn **txn);
+
 /** \brief Sets application information associated (a context pointer) with the
  * transaction.
  * \ingroup c_transactions
@@ -3968,6 +4207,50 @@ LIBMDBX_API int mdbx_txn_abort(MDBX_txn *txn);
  * \returns A non-zero error value on failure and 0 on success. */
 LIBMDBX_API int mdbx_txn_break(MDBX_txn *txn);
 
+/** \brief Freezes a write transaction for concurrent reading by other threads.
+ * \ingroup c_transactions
+ *
+ * While a write transaction is frozen it can't be changed, but any thread
+ * could read the data including all uncommitted changes by \ref mdbx_get()
+ * and similar functions, as well as by cursors. Cursors bound to a frozen
+ * transaction are the "view" cursors, which are not tracked by the
+ * transaction and therefore are safe to use from other threads. All of them
+ * must be closed or unbound before \ref mdbx_txn_thaw().
+ *
+ * \note The threads should be synchronized with the calls of
+ * \ref mdbx_txn_freeze() and \ref mdbx_txn_thaw() by the application,
+ * e.g. by a barrier. All tables should be opened before freezing, since
+ * handles can't be opened or imported in a frozen transaction.
+ * Any modifications return \ref MDBX_EACCESS, while \ref mdbx_txn_commit()
+ * and \ref mdbx_txn_abort() return \ref MDBX_BUSY.
+ *
+ * \param [in] txn  A write transaction handle returned by
+ *                  \ref mdbx_txn_begin(), must be called by the thread
+ *                  owning the transaction.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EACCESS       The transaction is read-only or already frozen.
+ * \retval MDBX_BAD_TXN       The transaction is finished, has errors or
+ *                            a nested transaction.
+ * \retval MDBX_INCOMPATIBLE  The transaction is disjoint or optimistic.
+ * \retval MDBX_BUSY          There are running disjoint transactions. */
+LIBMDBX_API int mdbx_txn_freeze(MDBX_txn *txn);
+
+/** \brief Thaws a write transaction frozen by \ref mdbx_txn_freeze().
+ * \ingroup c_transactions
+ *
+ * \param [in] txn  A frozen write transaction handle, must be called by
+ *                  the thread owning the transaction.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EINVAL          The transaction is not frozen.
+ * \retval MDBX_THREAD_MISMATCH Called by a thread not owning the transaction.
+ * \retval MDBX_BUSY            Some view cursors are still bound to the
+ *                              transaction. */
+LIBMDBX_API int mdbx_txn_thaw(MDBX_txn *txn);
+
 /** \brief Reset a read-only transaction.
  * \ingroup c_transactions
  *
@@ -4024,6 +4307,37 @@ LIBMDBX_API int mdbx_txn_reset(MDBX_txn *txn);
  * \retval MDBX_EINVAL           Transaction handle is NULL. */
 LIBMDBX_API int mdbx_txn_renew(MDBX_txn *txn);
 
+/** \brief Starts a read-only transaction on exactly the same MVCC-snapshot
+ * as the given one.
+ * \ingroup c_transactions
+ *
+ * Unlike \ref mdbx_txn_begin() the clone does not look for the most recent
+ * meta-page, but binds a new reader slot to the snapshot which is already
+ * held by the origin transaction. This allows a set of threads to read the
+ * same data consistently, e.g. for parallel export or checksumming.
+ *
+ * The origin transaction must remain active until this function returns,
+ * but it may be finished at any time afterwards without affecting clones.
+ * The function could be called by any thread, however, without
+ * \ref MDBX_NOTLS a thread can't clone a transaction while it holds
+ * another read transaction, since there is only one reader slot per thread.
+ *
+ * \param [in] origin  A read-only transaction handle to be cloned.
+ * \param [out] ret    Address where the new \ref MDBX_txn handle
+ *                     will be stored. The clone should be finished
+ *                     by \ref mdbx_txn_abort() or \ref mdbx_txn_commit().
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_BAD_TXN          The origin transaction is finished, has an
+ *                               error or has been ended during the call.
+ * \retval MDBX_BAD_RSLOT        The current thread already holds a reader slot
+ *                               for another read transaction.
+ * \retval MDBX_READERS_FULL     The reader lock table is full.
+ * \retval MDBX_EINVAL           The origin is not a read-only transaction or
+ *                               an invalid parameter was specified. */
+LIBMDBX_API int mdbx_txn_clone(const MDBX_txn *origin, MDBX_txn **ret);
+
 /** \brief The fours integers markers (aka "canary") associated with the
  * environment.
  * \ingroup c_crud
@@ -4163,6 +4477,9 @@ typedef int(MDBX_cmp_func)(const MDBX_val *a,
  *      This option specifies that duplicate data items should be compared as
  *      strings in reverse order (the comparison is performed in the direction
  *      from the last byte to the first).
+ *  - \ref MDBX_ALIGNVALUE8, \ref MDBX_ALIGNVALUE16, \ref MDBX_ALIGNVALUE64
+ *      Data values are placed at addresses aligned to 8, 16 or 64 bytes
+ *      correspondingly, so they could be accessed in-place as C structures.
  *  - \ref MDBX_CREATE
  *      Create the named database if it doesn't exist. This option is not
  *      allowed in a read-only transaction or a read-only environment.
@@ -4346,6 +4663,192 @@ LIBMDBX_INLINE_API(int, mdbx_dbi_flags,
   return mdbx_dbi_flags_ex(txn, dbi, flags, &state);
 }
 
+/** \brief A codec for transparent compression of values.
+ * \ingroup c_dbi
+ * \see mdbx_dbi_set_codec() \see mdbx_codec_builtin() */
+struct MDBX_codec {
+  /** \brief Compresses `src_len` bytes from `src` into the `dst` buffer.
+   * \returns The size of the compressed data, or zero if the result doesn't
+   * fit into `dst_capacity` bytes and the value should be stored as is. */
+  size_t (*compress)(void *ctx, const void *src, size_t src_len, void *dst,
+                     size_t dst_capacity);
+  /** \brief Decompresses `src_len` bytes from `src` into exactly `dst_len`
+   * bytes at `dst`.
+   * \returns \ref MDBX_SUCCESS or an error code, e.g. \ref MDBX_CORRUPTED. */
+  int (*decompress)(void *ctx, const void *src, size_t src_len, void *dst,
+                    size_t dst_len);
+  /** \brief An arbitrary context passed to the callbacks. */
+  void *ctx;
+};
+#ifndef __cplusplus
+/** \ingroup c_dbi */
+typedef struct MDBX_codec MDBX_codec;
+#endif
+
+/** \brief Returns the built-in fast LZ-class codec.
+ * \ingroup c_dbi
+ *
+ * Values compressed by the built-in codec are readable regardless of the
+ * codec currently set for the table, including none at all.
+ * \see mdbx_dbi_set_codec() */
+MDBX_NOTHROW_CONST_FUNCTION LIBMDBX_API const MDBX_codec *
+mdbx_codec_builtin(void);
+
+/** \brief Sets a codec for transparent compression of table values.
+ * \ingroup c_dbi
+ *
+ * Values of `threshold` bytes or longer being put into the table are
+ * compressed by the codec and stored compressed, in-page or on large/overflow
+ * pages, if that saves at least 1/8 of their size. Shorter and incompressible
+ * values are stored as is. Reading functions return the decompressed values
+ * transparently, which are placed into a scratch arena of the transaction and
+ * remain valid until it ends. So the memory used by the values decompressed
+ * in a transaction is released only at its end, including
+ * \ref mdbx_txn_reset().
+ *
+ * Like custom comparators, the codec is not stored in the database and
+ * should be set each time the table is opened, right after
+ * \ref mdbx_dbi_open() and before the handle is used by other transactions.
+ * The codec structure must remain valid until the handle is closed.
+ *
+ * \note Values put with \ref MDBX_RESERVE are always stored as is, since the
+ * data is supplied by the application after the put.
+ *
+ * \note The stored values are not compatible with libmdbx versions that lack
+ * codec support, as well as values compressed by a custom codec are readable
+ * only when the same codec is set for the table.
+ *
+ * \param [in] txn        A transaction handle returned
+ *                        by \ref mdbx_txn_begin().
+ * \param [in] dbi        A table handle returned by \ref mdbx_dbi_open().
+ * \param [in] codec      A codec, either \ref mdbx_codec_builtin() or
+ *                        an application-supplied one, or NULL to stop
+ *                        compressing new values.
+ * \param [in] threshold  The minimal size of a value to be compressed.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EINVAL        An invalid parameter was specified.
+ * \retval MDBX_INCOMPATIBLE  The table is a dupsort (multi-value),
+ *                            a \ref MDBX_FIXEDSIZE one or with aligned
+ *                            values (\ref MDBX_ALIGNVALUE8). */
+LIBMDBX_API int mdbx_dbi_set_codec(MDBX_txn *txn, MDBX_dbi dbi,
+                                   const MDBX_codec *codec, size_t threshold);
+
+/** \brief Statistics of values compression for a table.
+ * \ingroup c_statinfo
+ * \see mdbx_dbi_codec_stat() */
+struct MDBX_codec_stat {
+  uint64_t cs_entries;        /**< Number of values in the table */
+  uint64_t cs_packed;         /**< Number of values stored compressed */
+  uint64_t cs_packed_bytes;   /**< Stored size of the compressed values */
+  uint64_t cs_unpacked_bytes; /**< Original size of the compressed values */
+};
+#ifndef __cplusplus
+/** \ingroup c_statinfo */
+typedef struct MDBX_codec_stat MDBX_codec_stat;
+#endif
+
+/** \brief Retrieve statistics of values compression for a table.
+ * \ingroup c_statinfo
+ *
+ * The statistics are collected by scanning all leaf pages of the table,
+ * so the call is costly for large tables.
+ *
+ * \param [in] txn     A transaction handle returned by \ref mdbx_txn_begin().
+ * \param [in] dbi     A table handle returned by \ref mdbx_dbi_open().
+ * \param [out] stat   The address of an \ref MDBX_codec_stat structure where
+ *                     the statistics will be copied.
+ * \param [in] bytes   The size of \ref MDBX_codec_stat.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EINVAL        An invalid parameter was specified.
+ * \retval MDBX_INCOMPATIBLE  The table is a dupsort (multi-value) or
+ *                            a \ref MDBX_FIXEDSIZE one. */
+LIBMDBX_API int mdbx_dbi_codec_stat(MDBX_txn *txn, MDBX_dbi dbi,
+                                    MDBX_codec_stat *stat, size_t bytes);
+
+/** \brief Enables the value log for large values of a table.
+ * \ingroup c_dbi
+ *
+ * Values of `threshold` bytes or longer being put into the table are
+ * appended to the value log, i.e. to a sibling file named by the data file
+ * name with the \ref MDBX_VLOG_SUFFIX, while the table keeps only a short
+ * reference to the value with its offset, length and checksum. So updates of
+ * large values don't rewrite large/overflow pages of the database and don't
+ * burden the GC, and the B+tree remains compact. Reading functions fetch such
+ * values transparently into a scratch arena of the transaction, like the
+ * values decompressed by a codec (see \ref mdbx_dbi_set_codec()), and verify
+ * their checksums.
+ *
+ * The log is append-only, so overwritten and deleted values leave garbage,
+ * which is reclaimed by \ref mdbx_vlog_gc(). The log is flushed to disk
+ * before each durable commit, but \ref mdbx_env_copy() doesn't include it,
+ * therefore a copy of a database with the value log is consistent only
+ * together with a copy of the log made after it, while
+ * \ref mdbx_vlog_gc() isn't running.
+ *
+ * Like a codec, the setting is not stored in the database and should be
+ * repeated each time the table is opened. The call requires a write
+ * transaction, since it creates an internal table with the live-bytes index
+ * of the log on first use, which should be committed before the log could
+ * be used by other transactions.
+ *
+ * \note Values put with \ref MDBX_RESERVE, streamed by
+ * \ref mdbx_stream_begin(), as well as ones put within disjoint
+ * transactions are always stored in the database itself.
+ *
+ * \param [in] txn        A write transaction handle returned
+ *                        by \ref mdbx_txn_begin().
+ * \param [in] dbi        A table handle returned by \ref mdbx_dbi_open().
+ * \param [in] threshold  The minimal size of a value to be moved into the
+ *                        value log, or zero to stop moving new values.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EINVAL        An invalid parameter was specified.
+ * \retval MDBX_EPERM         The transaction is a disjoint one.
+ * \retval MDBX_INCOMPATIBLE  The table is a dupsort (multi-value),
+ *                            a \ref MDBX_FIXEDSIZE one or with aligned
+ *                            values (\ref MDBX_ALIGNVALUE8). */
+LIBMDBX_API int mdbx_dbi_set_vlog(MDBX_txn *txn, MDBX_dbi dbi,
+                                  size_t threshold);
+
+/** \brief Reclaims garbage of the value log.
+ * \ingroup c_dbi
+ *
+ * The log is divided into segments of `MDBX_VLOG_SEGMENT_SIZE` bytes
+ * (a build option), whose live bytes are accounted in the index. The call
+ * processes all segments except the one being appended now:
+ *  - live values of each segment filled less than `live_percent`
+ *    are appended anew and the references to them are updated,
+ *    then the segment is marked as retired by the transaction;
+ *  - the space of segments retired by transactions which are already
+ *    older than any reader, as well as than the last durable commit,
+ *    is released to the filesystem by punching holes in the log file.
+ *
+ * Thus a segment is freed by the second call made after readers have
+ * released the snapshots which refer to its values. Segments with values
+ * of tables not opened in the environment are skipped, since their
+ * liveness couldn't be checked.
+ *
+ * \param [in] txn           A write transaction handle returned
+ *                           by \ref mdbx_txn_begin().
+ * \param [in] live_percent  The percentage of live bytes below which
+ *                           a segment is compacted, from 0 to 100.
+ * \param [out] reclaimed    The optional address to store the number of
+ *                           bytes released to the filesystem.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EINVAL   An invalid parameter was specified.
+ * \retval MDBX_EPERM    The transaction is a disjoint one.
+ * \retval MDBX_BAD_DBI  The value log wasn't enabled
+ *                       by \ref mdbx_dbi_set_vlog(). */
+LIBMDBX_API int mdbx_vlog_gc(MDBX_txn *txn, unsigned live_percent,
+                             uint64_t *reclaimed);
+
 /** \brief Close a database handle. Normally unnecessary.
  * \ingroup c_dbi
  *
@@ -4383,6 +4886,43 @@ LIBMDBX_API int mdbx_dbi_close(MDBX_env *env, MDBX_dbi dbi);
  * \returns A non-zero error value on failure and 0 on success. */
 LIBMDBX_API int mdbx_drop(MDBX_txn *txn, MDBX_dbi dbi, bool del);
 
+/** \brief Progressively empty or delete a database by bounded chunks.
+ * \ingroup c_crud
+ *
+ * Dropping a huge table by \ref mdbx_drop() requires visiting all of its
+ * pages within a single write transaction, which blocks other writers for
+ * a long time. This function instead cuts off and retires only a few leftmost
+ * subtrees of the table, about `pages_limit` pages in total, so the table
+ * remains valid (but shrunk) and the transaction could be committed quickly.
+ * Thus a huge table could be dropped by a series of short write transactions,
+ * interleaved with other writers, until the function returns
+ * \ref MDBX_SUCCESS.
+ *
+ * When the remaining table contains no more than `pages_limit` pages, or
+ * if `pages_limit` is zero, the function behaves exactly like
+ * \ref mdbx_drop(), i.e. empties or deletes the table according to `del`.
+ *
+ * \see mdbx_drop()
+ *
+ * \param [in] txn          A transaction handle returned
+ *                          by \ref mdbx_txn_begin().
+ * \param [in] dbi          A database handle returned by \ref mdbx_dbi_open().
+ * \param [in] del          `false` to empty the DB, `true` to delete it
+ *                          from the environment and close the DB handle
+ *                          once it has been emptied completely.
+ * \param [in] pages_limit  The approximate limit of pages to be retired
+ *                          by single call, or zero for unlimited.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_RESULT_TRUE  A chunk of the table was dropped, but the table
+ *                           is not empty yet, therefore the function should
+ *                           be called again (it is recommended to commit the
+ *                           current transaction and start a new one).
+ * \retval MDBX_SUCCESS      The table was completely emptied or deleted. */
+LIBMDBX_API int mdbx_drop_ex(MDBX_txn *txn, MDBX_dbi dbi, bool del,
+                             size_t pages_limit);
+
 /** \brief Get items from a database.
  * \ingroup c_crud
  *
@@ -4563,6 +5103,211 @@ LIBMDBX_API int mdbx_get_equal_or_great(MDBX_txn *txn, MDBX_dbi dbi,
 LIBMDBX_API int mdbx_put(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
                          MDBX_val *data, MDBX_put_flags_t flags);
 
+/** \brief Store a batch of key-value pairs sorted by keys into a table.
+ * \ingroup c_crud
+ *
+ * The whole batch is validated at once, then all pairs are stored by the
+ * same cursor. Since keys are sorted, each subsequent key is searched starting
+ * from the current leaf page and going up only to the nearest branch page
+ * which key range covers it, instead of a search from the root. So all pairs
+ * destined for the same leaf page are merged into it by a single walk of the
+ * tree, and the cost of the batch is close to the cost of the scan of the
+ * affected pages.
+ *
+ * \param [in] txn    A transaction handle returned
+ *                    by \ref mdbx_txn_begin().
+ * \param [in] dbi    A table handle returned by \ref mdbx_dbi_open().
+ * \param [in] pairs  An array of `count * 2` items where a key is followed
+ *                    by the corresponding data. Keys must be sorted in
+ *                    ascending order of the table comparator, i.e. strictly
+ *                    ascending, but equal keys are allowed for
+ *                    \ref MDBX_DUPSORT tables.
+ * \param [in] count  The number of key-value pairs in the batch.
+ * \param [in] flags  Special options for this operation, zero
+ *                    (i.e. \ref MDBX_UPSERT) or a combination of
+ *                    \ref MDBX_NOOVERWRITE, \ref MDBX_NODUPDATA,
+ *                    \ref MDBX_ALLDUPS, \ref MDBX_APPEND and
+ *                    \ref MDBX_APPENDDUP, which have the same meaning as for
+ *                    \ref mdbx_put().
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_RESULT_TRUE   All pairs are processed, but some were skipped
+ *                            since the key or pair already exists and
+ *                            \ref MDBX_NOOVERWRITE or \ref MDBX_NODUPDATA
+ *                            was specified.
+ * \retval MDBX_EKEYMISMATCH  The keys are not sorted, nothing was stored.
+ * \retval MDBX_BAD_VALSIZE   The size of some key or data is invalid,
+ *                            nothing was stored.
+ * \retval MDBX_MAP_FULL      The database is full,
+ *                            see \ref mdbx_env_set_mapsize().
+ * \retval MDBX_TXN_FULL      The transaction has too many dirty pages.
+ * \retval MDBX_EACCES        An attempt was made to write
+ *                            in a read-only transaction.
+ * \retval MDBX_EINVAL        An invalid parameter was specified. */
+LIBMDBX_API int mdbx_put_sorted_batch(MDBX_txn *txn, MDBX_dbi dbi,
+                                      const MDBX_val *pairs, size_t count,
+                                      MDBX_put_flags_t flags);
+
+/** \brief Opaque structure for a bulk builder of a table.
+ * \ingroup c_crud
+ * \see mdbx_bulk_begin() \see mdbx_bulk_add() \see mdbx_bulk_finish() */
+typedef struct MDBX_bulk MDBX_bulk;
+
+/** \brief Starts a bulk loading of sorted key-value pairs into a table.
+ * \ingroup c_crud
+ *
+ * Unlike \ref MDBX_APPEND the builder doesn't split pages, but fills leaf
+ * pages up to the given fill factor and then starts the next one, adding
+ * references to the parent branch pages from the bottom up. So pages are
+ * allocated sequentially and the overhead is close to copying the data.
+ * Completed pages are spilled to disk as usual when the transaction hits
+ * the dirty pages limit, see \ref MDBX_opt_txn_dp_limit.
+ *
+ * The table may be non-empty, then pairs are appended after the last key.
+ * The b-tree is valid after every \ref mdbx_bulk_add(), so the transaction
+ * could be committed at any time, but the builder must be released by
+ * \ref mdbx_bulk_finish() in any case. While the builder is active, the table
+ * must not be changed by other means and no other cursors of it may be used.
+ *
+ * \param [in] txn           A write transaction handle.
+ * \param [in] dbi           A table handle returned by \ref mdbx_dbi_open().
+ *                           The table must not be \ref MDBX_DUPSORT.
+ * \param [in] fill_percent  Fill factor of pages from 1 to 100 percents,
+ *                           or zero for the default 100%. A lower value
+ *                           leaves room for subsequent inserts without
+ *                           splitting pages.
+ * \param [out] bulk         Address where the new \ref MDBX_bulk handle
+ *                           will be stored.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_INCOMPATIBLE  The table is \ref MDBX_DUPSORT,
+ *                            \ref MDBX_FIXEDSIZE or with aligned values.
+ * \retval MDBX_EACCES        An attempt was made to write
+ *                            in a read-only transaction.
+ * \retval MDBX_EINVAL        An invalid parameter was specified. */
+LIBMDBX_API int mdbx_bulk_begin(MDBX_txn *txn, MDBX_dbi dbi,
+                                unsigned fill_percent, MDBX_bulk **bulk);
+
+/** \brief Adds a key-value pair to the end of a table being bulk loaded.
+ * \ingroup c_crud
+ *
+ * \param [in] bulk  A bulk builder handle returned by \ref mdbx_bulk_begin().
+ * \param [in] key   The key to add, must be greater than all the keys
+ *                   in the table.
+ * \param [in] data  The data to add.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EKEYMISMATCH  The key is not greater than the last one.
+ * \retval MDBX_BUSY          Other cursors of the table are in use.
+ * \retval MDBX_BAD_VALSIZE   The size of the key or data is invalid.
+ * \retval MDBX_BAD_TXN       The transaction has been finished or broken.
+ * \retval MDBX_EINVAL        The table was changed bypassing the builder
+ *                            or an invalid parameter was specified. */
+LIBMDBX_API int mdbx_bulk_add(MDBX_bulk *bulk, const MDBX_val *key,
+                              const MDBX_val *data);
+
+/** \brief Releases a bulk builder.
+ * \ingroup c_crud
+ *
+ * The builder is released in any case, including after the end of its
+ * transaction, however the function should be called by the thread which
+ * owns the transaction while it is running.
+ *
+ * \param [in] bulk  A bulk builder handle returned by \ref mdbx_bulk_begin().
+ *
+ * \returns \ref MDBX_SUCCESS if the transaction is still running and
+ *          healthy, otherwise an error code, for instance
+ *          \ref MDBX_BAD_TXN if the transaction was finished. */
+LIBMDBX_API int mdbx_bulk_finish(MDBX_bulk *bulk);
+
+/** \brief Opaque structure for a streaming put of a large value.
+ * \ingroup c_crud
+ * \see mdbx_stream_begin() \see mdbx_stream_write()
+ * \see mdbx_stream_finish() */
+typedef struct MDBX_stream MDBX_stream;
+
+/** \brief Starts a streaming put of a value which is passed by chunks.
+ * \ingroup c_crud
+ *
+ * This allows to store a value of hundreds of megabytes without having the
+ * whole of it in memory. The full length must be known in advance, since a
+ * large value is stored in a contiguous run of pages which is allocated at
+ * once. Without \ref MDBX_WRITEMAP the pages are written to the file through
+ * a bounded buffer, bypassing the dirty pages list as already spilled ones,
+ * and with \ref MDBX_WRITEMAP the chunks are copied directly into the map.
+ * Values up to a megabyte are accumulated in memory and then put as usual.
+ *
+ * The value becomes visible only after \ref mdbx_stream_finish(), which
+ * replaces the current value of the key if any. Streamed large values are
+ * not packed by the table codec, see \ref mdbx_dbi_set_codec(). The
+ * transaction could not be committed while it has unfinished streams.
+ *
+ * \param [in] txn     A write transaction handle.
+ * \param [in] dbi     A table handle returned by \ref mdbx_dbi_open().
+ *                     The table must not be \ref MDBX_DUPSORT.
+ * \param [in] key     The key to store.
+ * \param [in] length  The full length of the value in bytes.
+ * \param [in] flags   Either \ref MDBX_UPSERT or \ref MDBX_NOOVERWRITE.
+ * \param [out] stream Address where the new \ref MDBX_stream handle
+ *                     will be stored.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_INCOMPATIBLE  The table is \ref MDBX_DUPSORT,
+ *                            \ref MDBX_FIXEDSIZE or with aligned values,
+ *                            or the transaction is disjoint.
+ * \retval MDBX_KEYEXIST      The key already exists and \ref MDBX_NOOVERWRITE
+ *                            was specified.
+ * \retval MDBX_BAD_VALSIZE   The size of the key or the length is invalid.
+ * \retval MDBX_MAP_FULL      The database is full,
+ *                            see \ref mdbx_env_set_geometry().
+ * \retval MDBX_EACCES        An attempt was made to write
+ *                            in a read-only transaction.
+ * \retval MDBX_EINVAL        An invalid parameter was specified. */
+LIBMDBX_API int mdbx_stream_begin(MDBX_txn *txn, MDBX_dbi dbi,
+                                  const MDBX_val *key, size_t length,
+                                  MDBX_put_flags_t flags,
+                                  MDBX_stream **stream);
+
+/** \brief Appends a chunk to a value being streamed.
+ * \ingroup c_crud
+ *
+ * \param [in] stream  A stream handle returned by \ref mdbx_stream_begin().
+ * \param [in] chunk   The next part of the value.
+ * \param [in] bytes   The size of the chunk in bytes.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_BAD_TXN  The transaction has been finished or broken.
+ * \retval MDBX_EIO      An error occurred during writing to the file.
+ * \retval MDBX_EINVAL   The chunk exceeds the declared length
+ *                       or an invalid parameter was specified. */
+LIBMDBX_API int mdbx_stream_write(MDBX_stream *stream, const void *chunk,
+                                  size_t bytes);
+
+/** \brief Completes a streaming put and releases the stream.
+ * \ingroup c_crud
+ *
+ * The stream is released in any case, including after the end of its
+ * transaction, however the function should be called by the thread which
+ * owns the transaction while it is running. If the value was not written
+ * completely, the pages allocated for it are released and
+ * \ref MDBX_EINVAL is returned.
+ *
+ * \param [in] stream   A stream handle returned by \ref mdbx_stream_begin().
+ * \param [in] discard  Release the value instead of storing it.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_KEYEXIST  The key was added meanwhile and
+ *                        \ref MDBX_NOOVERWRITE was specified.
+ * \retval MDBX_BAD_TXN   The transaction has been finished or broken.
+ * \retval MDBX_EINVAL    The value was written incompletely. */
+LIBMDBX_API int mdbx_stream_finish(MDBX_stream *stream, bool discard);
+
 /** \brief Replace items in a database.
  * \ingroup c_crud
  *
@@ -4618,6 +5363,71 @@ LIBMDBX_API int mdbx_replace_ex(MDBX_txn *txn, MDBX_dbi dbi,
                                 MDBX_preserve_func preserver,
                                 void *preserver_context);
 
+/** \brief Get a part of an item from a database.
+ * \ingroup c_crud
+ *
+ * This function retrieves up to `length` bytes starting at `offset` of the
+ * value associated with the key. The range is truncated at the end of the
+ * value, thus the returned length may be less than requested, down to zero
+ * when `offset` is equal to the value length.
+ *
+ * Since a long value occupies consecutive large/overflow pages, the result
+ * always points directly into the database without copying, except for values
+ * compressed by a codec (see \ref mdbx_dbi_set_codec()), which are unpacked
+ * entirely into the transaction's memory.
+ *
+ * \param [in] txn     A transaction handle returned by \ref mdbx_txn_begin().
+ * \param [in] dbi     A database handle returned by \ref mdbx_dbi_open().
+ * \param [in] key     The key to search for in the database.
+ * \param [in] offset  The offset of the requested range within the value.
+ * \param [in] length  The length of the requested range.
+ * \param [out] data   The address of the range within the value.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_NOTFOUND      The key was not in the database.
+ * \retval MDBX_INCOMPATIBLE  The database is a \ref MDBX_DUPSORT one.
+ * \retval MDBX_EINVAL        The offset is beyond the end of the value,
+ *                            or an invalid parameter was specified. */
+LIBMDBX_API int mdbx_get_range(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                               size_t offset, size_t length, MDBX_val *data);
+
+/** \brief Update a part of an item in a database.
+ * \ingroup c_crud
+ *
+ * This function overwrites `data->iov_len` bytes of the existing value
+ * associated with the key, starting at `offset`. The value is extended if the
+ * range goes beyond its end, but the offset must not exceed the current
+ * length of the value.
+ *
+ * When the value size is kept, the update is performed in place:
+ *  - a value within a leaf page is changed after the usual copy-on-write of
+ *    the page;
+ *  - a long value already changed by the current transaction is patched
+ *    directly in its pages;
+ *  - otherwise a long value is relocated, since pages of a long value should
+ *    be consecutive. This happens only once per transaction and only
+ *    unchanged parts of the value are copied.
+ *
+ * Extended values and values compressed by a codec are rewritten entirely.
+ *
+ * \param [in] txn     A transaction handle returned by \ref mdbx_txn_begin().
+ * \param [in] dbi     A database handle returned by \ref mdbx_dbi_open().
+ * \param [in] key     The key of the value to update.
+ * \param [in] offset  The offset of the range within the value.
+ * \param [in] data    The data to be placed at the offset.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_NOTFOUND      The key was not in the database.
+ * \retval MDBX_INCOMPATIBLE  The database is a \ref MDBX_DUPSORT one.
+ * \retval MDBX_EACCES        An attempt was made to write
+ *                            in a read-only transaction.
+ * \retval MDBX_EINVAL        The offset is beyond the end of the value,
+ *                            or an invalid parameter was specified. */
+LIBMDBX_API int mdbx_put_range(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                               size_t offset, const MDBX_val *data);
+
 /** \brief Delete items from a database.
  * \ingroup c_crud
  *
@@ -4646,6 +5456,60 @@ LIBMDBX_API int mdbx_replace_ex(MDBX_txn *txn, MDBX_dbi dbi,
 LIBMDBX_API int mdbx_del(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
                          const MDBX_val *data);
 
+/** \brief Range deletion flags
+ * \ingroup c_crud
+ * \see mdbx_del_range() */
+enum MDBX_del_range_flags_t {
+  MDBX_DEL_RANGE_DEFAULTS = 0,
+
+  /** Delete the `end` key too, i.e. treat the range as `[begin, end]`
+   * instead of `[begin, end)`. */
+  MDBX_DEL_RANGE_INCLUDE_END = 1u
+};
+#ifndef __cplusplus
+/** \ingroup c_crud */
+typedef enum MDBX_del_range_flags_t MDBX_del_range_flags_t;
+#else
+DEFINE_ENUM_FLAG_OPERATORS(MDBX_del_range_flags_t)
+#endif
+
+/** \brief Delete a contiguous range of keys from a database.
+ * \ingroup c_crud
+ *
+ * This function removes all key/data pairs with keys in range `[begin, end)`,
+ * including all multi-values of such keys for a \ref MDBX_DUPSORT database.
+ * Subtrees which are fully covered by the range are cut off at the branch
+ * level and retired in bulk without visiting its leaf pages (except for
+ * accounting the number of entries and large/overflow pages), so only the
+ * keys on the boundary pages are deleted one-by-one. Thus the cost depends
+ * on the tree height rather than on the number of deleted items.
+ *
+ * \note All cursors of the database opened within the transaction become
+ * unpositioned once any subtree is cut off.
+ *
+ * \see mdbx_del()
+ * \see \ref c_crud_hints "Quick reference for Insert/Update/Delete operations"
+ *
+ * \param [in] txn    A transaction handle returned by \ref mdbx_txn_begin().
+ * \param [in] dbi    A database handle returned by \ref mdbx_dbi_open().
+ * \param [in] begin  The first key of the range, or NULL to delete from
+ *                    the beginning of the database.
+ * \param [in] end    The key which bounds the range, or NULL to delete
+ *                    up to the end of the database.
+ * \param [in] flags  Special options for this operation, which could be
+ *                    the \ref MDBX_DEL_RANGE_INCLUDE_END or zero.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          some possible errors are:
+ * \retval MDBX_EACCES        An attempt was made to write
+ *                            in a read-only transaction.
+ * \retval MDBX_INCOMPATIBLE  The range covers a named subDB record
+ *                            within the main database.
+ * \retval MDBX_EINVAL        An invalid parameter was specified. */
+LIBMDBX_API int mdbx_del_range(MDBX_txn *txn, MDBX_dbi dbi,
+                               const MDBX_val *begin, const MDBX_val *end,
+                               MDBX_del_range_flags_t flags);
+
 /** \brief Create a cursor handle but not bind it to transaction nor DBI handle.
  * \ingroup c_cursors
  *
@@ -5161,6 +6025,80 @@ LIBMDBX_API int mdbx_estimate_range(MDBX_txn *txn, MDBX_dbi dbi,
  * \ingroup c_rqest */
 #define MDBX_EPSILON ((MDBX_val *)((ptrdiff_t)-1))
 
+/** \brief Splits a table into roughly equal key ranges for a parallel scan.
+ * \ingroup c_rqest
+ *
+ * The function descends from the root of the b-tree to the first level which
+ * contains at least `n` entries, and picks evenly spaced keys among them as
+ * boundaries. So only a few pages near the root are read and the result is
+ * a cheap estimation with the same accuracy as \ref mdbx_estimate_range(),
+ * i.e. the ranges are equal if the subtrees are of similar size.
+ *
+ * The resulting `count` partitions cover the whole table: the first one
+ * begins from the first key, the i-th partition covers keys from
+ * `boundaries[i-1]` inclusive to `boundaries[i]` exclusive and the last one
+ * continues up to the last key. The boundary keys point into the database
+ * pages and are valid until the transaction ends, same as the keys returned
+ * by \ref mdbx_cursor_get().
+ *
+ * \param [in] txn         A transaction handle returned
+ *                         by \ref mdbx_txn_begin().
+ * \param [in] dbi         A table handle returned by \ref mdbx_dbi_open().
+ * \param [in] n           The desired number of partitions.
+ * \param [out] boundaries An array of at least `n-1` items to store
+ *                         boundary keys, could be NULL if `n` is 1.
+ * \param [out] count      The actual number of partitions, which could be
+ *                         less than `n` for a small table.
+ *
+ * \returns A non-zero error value on failure and 0 on success. */
+LIBMDBX_API int mdbx_dbi_partition(MDBX_txn *txn, MDBX_dbi dbi, size_t n,
+                                   MDBX_val *boundaries, size_t *count);
+
+/** \brief A callback function for \ref mdbx_dbi_partition_scan()
+ * to process a partition of a table.
+ * \ingroup c_rqest
+ *
+ * \param [in] ctx        An arbitrary context pointer for the callback.
+ * \param [in] cursor     A cursor positioned at the first item of the
+ *                        partition. The cursor is bound to a transaction
+ *                        reading the same MVCC-snapshot as given one.
+ * \param [in] partition  The ordinal number of the partition.
+ * \param [in] end_key    The key which ends the partition (exclusive),
+ *                        or NULL for the last partition.
+ *
+ * \returns Non-zero value to stop the scan, which is then returned
+ *          by \ref mdbx_dbi_partition_scan(), or \ref MDBX_SUCCESS
+ *          to continue. */
+typedef int(MDBX_partition_func)(void *ctx, MDBX_cursor *cursor,
+                                 size_t partition,
+                                 const MDBX_val *end_key) MDBX_CXX17_NOEXCEPT;
+
+/** \brief Scans a table in parallel by a set of threads.
+ * \ingroup c_rqest
+ *
+ * The table is split by \ref mdbx_dbi_partition() and the partitions are
+ * distributed among the current thread, which uses the given transaction,
+ * and up to `threads-1` auxiliary threads, each of which reads the same
+ * MVCC-snapshot via a transaction made by \ref mdbx_txn_clone().
+ * Thus the visitor could be called concurrently and must be thread-safe.
+ *
+ * Using more partitions than threads makes the load more even, since
+ * the ranges are estimated roughly.
+ *
+ * \param [in] txn         A read-only transaction handle.
+ * \param [in] dbi         A table handle returned by \ref mdbx_dbi_open().
+ * \param [in] partitions  The number of partitions to split the table.
+ * \param [in] threads     The number of threads including the current one.
+ * \param [in] visitor     A \ref MDBX_partition_func callback.
+ * \param [in] ctx         An arbitrary context pointer for the callback.
+ *
+ * \returns A non-zero error value on failure and 0 on success,
+ *          or the non-zero value returned by the visitor. */
+LIBMDBX_API int mdbx_dbi_partition_scan(MDBX_txn *txn, MDBX_dbi dbi,
+                                        size_t partitions, unsigned threads,
+                                        MDBX_partition_func *visitor,
+                                        void *ctx);
+
 /** \brief Determines whether the given address is on a dirty database page of
  * the transaction or not.
  * \ingroup c_statinfo
@@ -531,6 +531,7 @@ MDBX_DECLARE_EXCEPTION(reader_slot_busy);
 MDBX_DECLARE_EXCEPTION(remote_media);
 MDBX_DECLARE_EXCEPTION(something_busy);
 MDBX_DECLARE_EXCEPTION(thread_mismatch);
+MDBX_DECLARE_EXCEPTION(transaction_conflict);
 MDBX_DECLARE_EXCEPTION(transaction_full);
 MDBX_DECLARE_EXCEPTION(transaction_overlapping);
 #undef MDBX_DECLARE_EXCEPTION
@@ -678,6 +679,25 @@ struct LIBMDBX_API_TYPE slice : public ::MDBX_val {
     return slice(&pod, sizeof(pod));
   }
 
+  /// \brief Returns a reference to the contents as an instance of the POD
+  /// type without copying.
+  /// \details Intended for values of tables created with one of
+  /// \ref MDBX_ALIGNVALUE8, \ref MDBX_ALIGNVALUE16 or
+  /// \ref MDBX_ALIGNVALUE64, which are suitably aligned inside the database.
+  /// \throws bad_value_size if the length of slice differs from `sizeof(POD)`.
+  /// \throws std::invalid_argument if the data is insufficiently aligned
+  /// for the POD type.
+  template <typename POD> const POD &as() const {
+    static_assert(::std::is_standard_layout<POD>::value &&
+                      !::std::is_pointer<POD>::value,
+                  "Must be a standard layout type!");
+    if (MDBX_UNLIKELY(length() != sizeof(POD)))
+      MDBX_CXX20_UNLIKELY error::throw_exception(MDBX_BAD_VALSIZE);
+    if (MDBX_UNLIKELY(uintptr_t(data()) % alignof(POD)))
+      MDBX_CXX20_UNLIKELY error::throw_exception(MDBX_EINVAL);
+    return *static_cast<const POD *>(data());
+  }
+
   inline slice &assign(const void *ptr, size_t bytes);
   inline slice &assign(const slice &src) noexcept;
   inline slice &assign(const ::MDBX_val &src);
@@ -2821,6 +2841,22 @@ enum class key_mode {
 enum class value_mode {
   single = MDBX_DB_DEFAULTS, ///< Usual single value for each key. In terms of
                              ///< keys, they are unique.
+  single_samelength =
+      MDBX_FIXEDSIZE, ///< Usual single value for each key, but all keys and
+                      ///< all values must be same length correspondingly.
+                      ///< Internally pairs are densely packed without
+                      ///< per-pair headers. In terms of keys, they are unique.
+  single_aligned8 =
+      MDBX_ALIGNVALUE8, ///< Usual single value for each key, but values are
+                        ///< placed at 8-byte aligned addresses to be accessed
+                        ///< in-place, e.g. via \ref slice::as().
+                        ///< In terms of keys, they are unique.
+  single_aligned16 =
+      MDBX_ALIGNVALUE16, ///< Same as \ref single_aligned8 but values are
+                         ///< 16-byte aligned.
+  single_aligned64 =
+      MDBX_ALIGNVALUE64, ///< Same as \ref single_aligned8 but values are
+                         ///< 64-byte aligned, i.e. at cache-line boundary.
   multi =
       MDBX_DUPSORT, ///< A more than one data value could be associated with
                     ///< each key. Internally each key is stored once, and the
@@ -3490,6 +3526,16 @@ public:
   /// return number of cleared slots.
   inline unsigned check_readers();
 
+  /// \brief Waits for a commit of a transaction with ID greater than the given
+  /// one by any process, see \ref mdbx_env_wait_commit().
+  /// \returns `False` if the timeout is reached without a new commit.
+  inline bool wait_commit(uint64_t after_txnid,
+                          unsigned timeout_seconds_16dot16 = 0);
+
+  /// \brief Returns a descriptor which becomes readable after each commit,
+  /// see \ref mdbx_env_get_commit_fd().
+  inline filehandle get_commit_fd();
+
   /// \brief Sets a Handle-Slow-Readers callback to resolve database
   /// full/overflow issue due to a reader(s) which prevents the old data from
   /// being recycled.
@@ -3787,6 +3833,11 @@ public:
   /// multimap (aka sub-database).
   inline slice get(map_handle map, slice key, size_t &values_count,
                    const slice &value_at_absence) const;
+  /// \brief Get a part of value by key from a key-value map
+  /// (aka sub-database) without copying.
+  /// \see ::mdbx_get_range()
+  inline slice get_range(map_handle map, const slice &key, size_t offset,
+                         size_t length) const;
   /// \brief Get value for equal or great key from a database.
   /// \return Bundle of key-value pair and boolean flag,
   /// which will be `true` if the exact key was found and `false` otherwise.
@@ -3824,6 +3875,12 @@ public:
   /// \brief Removes the particular multi-value entry of the key.
   inline bool erase(map_handle map, const slice &key, const slice &value);
 
+  /// \brief Removes all keys from the range `[begin, end)`, or from
+  /// `[begin, end]` if `include_end` is true.
+  /// \see ::mdbx_del_range()
+  inline void erase_range(map_handle map, const slice &begin, const slice &end,
+                          bool include_end = false);
+
   /// \brief Replaces the particular multi-value of the key with a new value.
   inline void replace(map_handle map, const slice &key, slice old_value,
                       const slice &new_value);
@@ -3878,6 +3935,24 @@ public:
                  false);
   }
 
+  /// \brief Stores a batch of key-value pairs sorted by keys.
+  /// \returns `true` if all pairs were stored, or `false` if some of ones
+  /// were skipped since already present while \ref put_mode::insert_unique.
+  /// \see ::mdbx_put_sorted_batch()
+  inline bool put_batch(map_handle map, const pair *pairs, size_t count,
+                        put_mode mode = put_mode::upsert);
+  /// \brief Stores a batch of key-value pairs sorted by keys.
+  /// \see ::mdbx_put_sorted_batch()
+  bool put_batch(map_handle map, const ::std::vector<pair> &pairs,
+                 put_mode mode = put_mode::upsert) {
+    return put_batch(map, pairs.data(), pairs.size(), mode);
+  }
+
+  /// \brief Overwrites a part of value by key, extending it if necessary.
+  /// \see ::mdbx_put_range()
+  inline void put_range(map_handle map, const slice &key, size_t offset,
+                        const slice &data);
+
   inline ptrdiff_t estimate(map_handle map, pair from, pair to) const;
   inline ptrdiff_t estimate(map_handle map, slice from, slice to) const;
   inline ptrdiff_t estimate_from_first(map_handle map, slice to) const;
@@ -4782,8 +4857,11 @@ MDBX_CXX11_CONSTEXPR
 MDBX_CXX11_CONSTEXPR
 #endif
 ::mdbx::value_mode map_handle::info::value_mode() const noexcept {
-  return ::mdbx::value_mode(flags & (MDBX_DUPSORT | MDBX_REVERSEDUP |
-                                     MDBX_DUPFIXED | MDBX_INTEGERDUP));
+  return ::mdbx::value_mode(flags &
+                            (MDBX_DUPSORT | MDBX_REVERSEDUP | MDBX_DUPFIXED |
+                             MDBX_INTEGERDUP | MDBX_FIXEDSIZE |
+                             MDBX_ALIGNVALUE8 | MDBX_ALIGNVALUE16 |
+                             MDBX_ALIGNVALUE64));
 }
 
 //------------------------------------------------------------------------------
@@ -5146,6 +5224,18 @@ inline unsigned env::check_readers() {
   return static_cast<unsigned>(dead_count);
 }
 
+inline bool env::wait_commit(uint64_t after_txnid,
+                             unsigned timeout_seconds_16dot16) {
+  return !error::boolean_or_throw(
+      ::mdbx_env_wait_commit(handle_, after_txnid, timeout_seconds_16dot16));
+}
+
+inline filehandle env::get_commit_fd() {
+  filehandle fd;
+  error::success_or_throw(::mdbx_env_get_commit_fd(handle_, &fd));
+  return fd;
+}
+
 inline env &env::set_HandleSlowReaders(MDBX_hsr_func *cb) {
   error::success_or_throw(::mdbx_env_set_hsr(handle_, cb));
   return *this;
@@ -5418,6 +5508,14 @@ inline slice txn::get(map_handle map, slice key, size_t &values_count,
   }
 }
 
+inline slice txn::get_range(map_handle map, const slice &key, size_t offset,
+                            size_t length) const {
+  slice result;
+  error::success_or_throw(
+      ::mdbx_get_range(handle_, map.dbi, &key, offset, length, &result));
+  return result;
+}
+
 inline pair_result txn::get_equal_or_great(map_handle map,
                                            const slice &key) const {
   pair result(key, slice());
@@ -5579,6 +5677,13 @@ inline bool txn::erase(map_handle map, const slice &key, const slice &value) {
   }
 }
 
+inline void txn::erase_range(map_handle map, const slice &begin,
+                             const slice &end, bool include_end) {
+  error::success_or_throw(::mdbx_del_range(
+      handle_, map.dbi, &begin, &end,
+      include_end ? MDBX_DEL_RANGE_INCLUDE_END : MDBX_DEL_RANGE_DEFAULTS));
+}
+
 inline void txn::replace(map_handle map, const slice &key, slice old_value,
                          const slice &new_value) {
   error::success_or_throw(::mdbx_replace_ex(
@@ -5655,6 +5760,30 @@ inline size_t txn::put_multiple(map_handle map, const slice &key,
   return args[1].iov_len /* done item count */;
 }
 
+inline bool txn::put_batch(map_handle map, const pair *pairs, size_t count,
+                           put_mode mode) {
+  static_assert(sizeof(pair) == sizeof(MDBX_val) * 2,
+                "pair must be layout-compatible with a couple of MDBX_val");
+  const int err =
+      ::mdbx_put_sorted_batch(handle_, map.dbi,
+                              reinterpret_cast<const MDBX_val *>(pairs), count,
+                              MDBX_put_flags_t(mode));
+  switch (err) {
+  case MDBX_SUCCESS:
+    MDBX_CXX20_LIKELY return true;
+  case MDBX_RESULT_TRUE:
+    return false;
+  default:
+    MDBX_CXX20_UNLIKELY error::throw_exception(err);
+  }
+}
+
+inline void txn::put_range(map_handle map, const slice &key, size_t offset,
+                           const slice &data) {
+  error::success_or_throw(
+      ::mdbx_put_range(handle_, map.dbi, &key, offset, &data));
+}
+
 inline ptrdiff_t txn::estimate(map_handle map, pair from, pair to) const {
   ptrdiff_t result;
   error::success_or_throw(mdbx_estimate_range(
@@ -206,9 +206,12 @@
 #endif
 
 #if defined(__linux__) || defined(__gnu_linux__)
+#include <linux/futex.h>
 #include <sched.h>
+#include <sys/eventfd.h>
 #include <sys/sendfile.h>
 #include <sys/statfs.h>
+#include <sys/syscall.h>
 #endif /* Linux */
 
 #ifndef _XOPEN_SOURCE
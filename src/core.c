@@ -344,10 +344,11 @@ node_key(const MDBX_node *const __restrict node) {
   return ptr_disp(node, NODESIZE);
 }
 
-/* Address of the data for a node */
+/* Address of the data for a node, mn_extra is a padding after the key */
 MDBX_NOTHROW_PURE_FUNCTION static __always_inline void *
 node_data(const MDBX_node *const __restrict node) {
-  return ptr_disp(node_key(node), node_ks(node));
+  return ptr_disp(node_key(node),
+                  node_ks(node) + UNALIGNED_PEEK_8(node, MDBX_node, mn_extra));
 }
 
 /* Size of a node in a leaf page with a given key and data.
@@ -361,6 +362,51 @@ node_size(const MDBX_val *key, const MDBX_val *value) {
   return node_size_len(key ? key->iov_len : 0, value ? value->iov_len : 0);
 }
 
+/* Alignment of values for a table with MDBX_ALIGNVALUE8/16/64,
+ * or zero for usual tables. */
+MDBX_NOTHROW_CONST_FUNCTION static __always_inline size_t
+valign(const unsigned db_flags) {
+  return likely((db_flags & DB_ALIGNVALUE_FLAGS) == 0) ? 0
+         : (db_flags & MDBX_ALIGNVALUE64)              ? 64
+         : (db_flags & MDBX_ALIGNVALUE16)              ? 16
+                                                       : 8;
+}
+
+/* Size of a leaf node with the data placed within the node.
+ * For tables with aligned values the key is padded up to the alignment and
+ * the whole node is rounded up to the alignment. Since the nodes are
+ * allocated downward from the end of a page, all of them remain aligned. */
+MDBX_NOTHROW_CONST_FUNCTION static __always_inline size_t
+leaf_node_size(const size_t key_len, const size_t value_len,
+               const size_t align) {
+  return likely(!align) ? node_size_len(key_len, value_len)
+                        : ceil_powerof2(NODESIZE + key_len, align) +
+                              ceil_powerof2(value_len, align);
+}
+
+/* Size of a leaf node which refers to a large/overflow page. */
+MDBX_NOTHROW_CONST_FUNCTION static __always_inline size_t
+leaf_bignode_size(const size_t key_len, const size_t align) {
+  return likely(!align)
+             ? node_size_len(key_len, 0) + sizeof(pgno_t)
+             : ceil_powerof2(NODESIZE + key_len + sizeof(pgno_t), align);
+}
+
+/* Size occupied within a page by an existing leaf node. */
+MDBX_NOTHROW_PURE_FUNCTION static __always_inline size_t
+leaf_node_bytes(const MDBX_node *const __restrict node, const size_t align) {
+  const size_t bytes =
+      NODESIZE + node_ks(node) + UNALIGNED_PEEK_8(node, MDBX_node, mn_extra) +
+      ((node_flags(node) & F_BIGDATA) ? sizeof(pgno_t) : node_ds(node));
+  return ceil_powerof2(bytes, align ? align : 2);
+}
+
+/* Offset of the data within the first large/overflow page. */
+MDBX_NOTHROW_CONST_FUNCTION static __always_inline size_t
+largedata_offset(const size_t align) {
+  return likely(!align) ? PAGEHDRSZ : ceil_powerof2(PAGEHDRSZ, align);
+}
+
 MDBX_NOTHROW_PURE_FUNCTION static __always_inline pgno_t
 peek_pgno(const void *const __restrict ptr) {
   if (sizeof(pgno_t) == sizeof(uint32_t))
@@ -455,6 +501,15 @@ static __inline size_t keysize_max(size_t pagesize, MDBX_db_flags_t flags) {
     return (max_branch_key < max_dupsort_leaf_key) ? max_branch_key
                                                    : max_dupsort_leaf_key;
   }
+  if (flags & DB_ALIGNVALUE_FLAGS) {
+    /* Узел со ссылкой на large-страницу округляется до выравнивания
+     * значений, но должен помещаться в листовую страницу. */
+    const intptr_t max_aligned_leaf_key =
+        floor_powerof2(LEAF_NODE_MAX(pagesize), valign(flags)) - NODESIZE -
+        sizeof(pgno_t);
+    return (max_branch_key < max_aligned_leaf_key) ? max_branch_key
+                                                   : max_aligned_leaf_key;
+  }
   return max_branch_key;
 }
 
@@ -465,7 +520,8 @@ static __inline size_t valsize_max(size_t pagesize, MDBX_db_flags_t flags) {
   if (flags & MDBX_INTEGERDUP)
     return 8 /* sizeof(uint64_t) */;
 
-  if (flags & (MDBX_DUPSORT | MDBX_DUPFIXED | MDBX_REVERSEDUP))
+  if (flags &
+      (MDBX_DUPSORT | MDBX_DUPFIXED | MDBX_REVERSEDUP | MDBX_FIXEDSIZE))
     return keysize_max(pagesize, 0);
 
   const unsigned page_ln2 = log2n_powerof2(pagesize);
@@ -567,7 +623,7 @@ __cold intptr_t mdbx_limits_valsize4page_max(intptr_t pagesize,
       (MDBX_DUPSORT | MDBX_DUPFIXED | MDBX_INTEGERDUP | MDBX_REVERSEDUP))
     return valsize_max(pagesize, flags);
 
-  return PAGEROOM(pagesize);
+  return pagesize - largedata_offset(valign(flags));
 }
 
 __cold int mdbx_env_get_valsize4page_max(const MDBX_env *env,
@@ -584,13 +640,15 @@ __cold int mdbx_env_get_valsize4page_max(const MDBX_env *env,
  * is too large it will be put onto an large/overflow page and the node
  * size will only include the key and not the data. Sizes are always
  * rounded up to an even number of bytes, to guarantee 2-byte alignment
- * of the MDBX_node headers. */
+ * of the MDBX_node headers, or to the alignment of values for tables
+ * with MDBX_ALIGNVALUE8/16/64. */
 MDBX_NOTHROW_PURE_FUNCTION static __always_inline size_t
-leaf_size(const MDBX_env *env, const MDBX_val *key, const MDBX_val *data) {
-  size_t node_bytes = node_size(key, data);
+leaf_size(const MDBX_env *env, const MDBX_val *key, const MDBX_val *data,
+          const size_t align) {
+  size_t node_bytes = leaf_node_size(key->iov_len, data->iov_len, align);
   if (node_bytes > env->me_leaf_nodemax) {
     /* put on large/overflow page */
-    node_bytes = node_size_len(key->iov_len, 0) + sizeof(pgno_t);
+    node_bytes = leaf_bignode_size(key->iov_len, align);
   }
 
   return node_bytes + sizeof(indx_t);
@@ -729,6 +787,12 @@ number_of_ovpages(const MDBX_env *env, size_t bytes) {
   return bytes2pgno(env, PAGEHDRSZ - 1 + bytes) + 1;
 }
 
+/* The same for a value of a table with the given alignment of values. */
+MDBX_NOTHROW_PURE_FUNCTION static __always_inline pgno_t
+largedata_npages(const MDBX_env *env, size_t bytes, size_t align) {
+  return bytes2pgno(env, largedata_offset(align) - 1 + bytes) + 1;
+}
+
 __cold static const char *pagetype_caption(const uint8_t type,
                                            char buf4unknown[16]) {
   switch (type) {
@@ -803,12 +867,13 @@ page_node(const MDBX_page *mp, size_t i) {
 }
 
 /* The address of a key in a LEAF2 page.
- * LEAF2 pages are used for MDBX_DUPFIXED sorted-duplicate sub-DBs.
+ * LEAF2 pages are used for MDBX_DUPFIXED sorted-duplicate sub-DBs
+ * and for MDBX_FIXEDSIZE tables, where each item is a key followed by data.
  * There are no node headers, keys are stored contiguously. */
 MDBX_NOTHROW_PURE_FUNCTION static __always_inline void *
 page_leaf2key(const MDBX_page *mp, size_t i, size_t keysize) {
   assert(PAGETYPE_COMPAT(mp) == (P_LEAF | P_LEAF2));
-  assert(mp->mp_leaf2_ksize == keysize);
+  assert(mp->mp_leaf2_ksize >= keysize);
   (void)keysize;
   return ptr_disp(mp, PAGEHDRSZ + i * mp->mp_leaf2_ksize);
 }
@@ -826,6 +891,40 @@ get_key_optional(const MDBX_node *node, MDBX_val *keyptr /* __may_null */) {
     get_key(node, keyptr);
 }
 
+/* Читает ключ и данные элемента LEAF2-страницы. Для таблиц с MDBX_FIXEDSIZE
+ * элемент состоит из ключа длиной md_xsize и следующего за ним значения,
+ * а для вложенных MDBX_DUPFIXED-деревьев данные всегда пустые. */
+static __always_inline void leaf2_read(const MDBX_cursor *mc,
+                                       const MDBX_page *mp, size_t i,
+                                       MDBX_val *key /* __may_null */,
+                                       MDBX_val *data /* __may_null */) {
+  const size_t klen = mc->mc_db->md_xsize;
+  void *const ptr = page_leaf2key(mp, i, klen);
+  if (key) {
+    key->iov_len = klen;
+    key->iov_base = ptr;
+  }
+  if (data && (mc->mc_db->md_flags & MDBX_FIXEDSIZE)) {
+    data->iov_len = mp->mp_leaf2_ksize - klen;
+    data->iov_base = ptr_disp(ptr, klen);
+  }
+}
+
+/* Заполняет элемент LEAF2-страницы ключом и данными (если они заданы),
+ * либо возвращает адрес для MDBX_RESERVE. */
+static __always_inline void leaf2_fill(void *ptr, const MDBX_val *key,
+                                       MDBX_val *data /* __may_null */,
+                                       unsigned flags) {
+  memcpy(ptr, key->iov_base, key->iov_len);
+  if (data) {
+    void *const dst = ptr_disp(ptr, key->iov_len);
+    if (unlikely(flags & MDBX_RESERVE))
+      data->iov_base = dst;
+    else if (data->iov_len)
+      memcpy(dst, data->iov_base, data->iov_len);
+  }
+}
+
 /*------------------------------------------------------------------------------
  * safe read/write volatile 64-bit fields on 32-bit architectures. */
 
@@ -1122,15 +1221,64 @@ MDBX_MAYBE_UNUSED static
   safe64_update(p, safe64_read(p) + v);
 }
 
+/*----------------------------------------------------------------------------*/
+/* shards of the reader table */
+
+static __always_inline MDBX_rshard *rslot_shard(MDBX_rshard *const shards,
+                                                const MDBX_reader *const begin,
+                                                const MDBX_reader *const r) {
+  return shards + (size_t)(r - begin) / MDBX_READERS_SHARD;
+}
+
+/* Отмечает начало или завершение читающей транзакции в шарде, чтобы пишущая
+ * транзакция пересчитала для него самого старого читателя.
+ *
+ * Флаги изменяются только если шард еще не был отмечен, поэтому в промежутках
+ * между пересчетами читатели не конкурируют за кэш-линии дескриптора шарда
+ * и заголовка таблицы. Полные барьеры упорядочивают предшествующее изменение
+ * слота с последующим чтением флагов, которые взводит пишущая транзакция
+ * перед просмотром слотов (см. find_oldest_reader). */
+static __always_inline void rshard_changed(MDBX_lockinfo *const lck,
+                                           MDBX_rshard *const shard) {
+  osal_memory_barrier();
+  if (atomic_load32(&shard->rs_clean, mo_Relaxed)) {
+    atomic_store32(&shard->rs_clean, false, mo_Relaxed);
+    osal_memory_barrier();
+    if (atomic_load32(&lck->mti_readers_refresh_flag, mo_Relaxed) != true)
+      atomic_store32(&lck->mti_readers_refresh_flag, true, mo_AcquireRelease);
+  }
+}
+
+/* Учитывает освобождение слота в счетчике и подсказке шарда. Счетчик является
+ * лишь подсказкой для поиска свободного слота, поэтому защищен только от
+ * переполнения при повторном освобождении. */
+static void rshard_vacated(MDBX_rshard *const shard, const size_t slot) {
+  uint32_t count = atomic_load32(&shard->rs_count, mo_Relaxed);
+  while (count && !atomic_cas32(&shard->rs_count, count, count - 1))
+    count = atomic_load32(&shard->rs_count, mo_Relaxed);
+  atomic_store32(&shard->rs_hint, (uint32_t)(slot % MDBX_READERS_SHARD),
+                 mo_Relaxed);
+}
+
 /*----------------------------------------------------------------------------*/
 /* rthc (tls keys and destructors) */
 
 typedef struct rthc_entry_t {
   MDBX_reader *begin;
   MDBX_reader *end;
+  MDBX_rshard *shards;
   osal_thread_key_t thr_tls_key;
 } rthc_entry_t;
 
+/* Освобождает слот при завершении потока или закрытии среды. */
+static void rthc_vacated(const rthc_entry_t *const entry,
+                         const MDBX_reader *const r) {
+  MDBX_rshard *const shard = rslot_shard(entry->shards, entry->begin, r);
+  rshard_vacated(shard, (size_t)(r - entry->begin));
+  rshard_changed(container_of(entry->begin, MDBX_lockinfo, mti_readers),
+                 shard);
+}
+
 #if MDBX_DEBUG
 #define RTHC_INITIAL_LIMIT 1
 #else
@@ -1371,7 +1519,8 @@ __cold void thread_dtor(void *rthc) {
     if (atomic_load32(&reader->mr_pid, mo_Relaxed) == self_pid) {
       TRACE("==== thread 0x%" PRIxPTR ", rthc %p, cleanup", osal_thread_self(),
             __Wpedantic_format_voidptr(reader));
-      (void)atomic_cas32(&reader->mr_pid, self_pid, 0);
+      if (atomic_cas32(&reader->mr_pid, self_pid, 0))
+        rthc_vacated(&rthc_table[i], reader);
     }
   }
 
@@ -1486,6 +1635,7 @@ __cold void global_dtor(void) {
             rthc->mr_pid.weak, self_pid);
       if (atomic_load32(&rthc->mr_pid, mo_Relaxed) == self_pid) {
         atomic_store32(&rthc->mr_pid, 0, mo_AcquireRelease);
+        rthc_vacated(&rthc_table[i], rthc);
         TRACE("== cleanup %p", __Wpedantic_format_voidptr(rthc));
       }
     }
@@ -1511,7 +1661,7 @@ __cold void global_dtor(void) {
 }
 
 __cold int rthc_alloc(osal_thread_key_t *pkey, MDBX_reader *begin,
-                      MDBX_reader *end) {
+                      MDBX_reader *end, MDBX_rshard *shards) {
   assert(pkey != NULL);
 #ifndef NDEBUG
   *pkey = (osal_thread_key_t)0xBADBADBAD;
@@ -1544,6 +1694,7 @@ __cold int rthc_alloc(osal_thread_key_t *pkey, MDBX_reader *begin,
 
   rthc_table[rthc_count].begin = begin;
   rthc_table[rthc_count].end = end;
+  rthc_table[rthc_count].shards = shards;
   ++rthc_count;
   TRACE("<< key %" PRIuPTR ", rthc_count %u, rthc_limit %u", (uintptr_t)*pkey,
         rthc_count, rthc_limit);
@@ -1572,6 +1723,7 @@ __cold void rthc_remove(const osal_thread_key_t key) {
            ++rthc) {
         if (atomic_load32(&rthc->mr_pid, mo_Relaxed) == self_pid) {
           atomic_store32(&rthc->mr_pid, 0, mo_AcquireRelease);
+          rthc_vacated(&rthc_table[i], rthc);
           TRACE("== cleanup %p", __Wpedantic_format_voidptr(rthc));
         }
       }
@@ -2418,9 +2570,31 @@ static __always_inline bool pnl_check_allocated(const pgno_t *pl,
 
 static __always_inline void
 pnl_merge_inner(pgno_t *__restrict dst, const pgno_t *__restrict src_a,
+                const pgno_t *__restrict const src_a_detent,
                 const pgno_t *__restrict src_b,
                 const pgno_t *__restrict const src_b_detent) {
+  /* Списки страниц обычно состоят из длинных последовательностей (например,
+   * при слиянии GC-записей), поэтому прежде поэлементного слияния проверяем
+   * возможность переноса целого блока. Так как источники упорядочены, то для
+   * этого достаточно одного сравнения с дальним элементом блока, а сам блок
+   * копируется векторными инструкциями (memcpy с константным размером). */
+  const size_t block = 8;
   do {
+    if (src_a - block > src_a_detent && src_b - block > src_b_detent) {
+      if (MDBX_PNL_ORDERED(*src_b, src_a[1 - (ptrdiff_t)block])) {
+        dst -= block;
+        src_a -= block;
+        /* no overlapping since at least block-size items remain in src_b */
+        memcpy(dst + 1, src_a + 1, block * sizeof(pgno_t));
+        continue;
+      }
+      if (!MDBX_PNL_ORDERED(src_b[1 - (ptrdiff_t)block], *src_a)) {
+        dst -= block;
+        src_b -= block;
+        memcpy(dst + 1, src_b + 1, block * sizeof(pgno_t));
+        continue;
+      }
+    }
 #if MDBX_HAVE_CMOV
     const bool flag = MDBX_PNL_ORDERED(*src_b, *src_a);
 #if defined(__LCC__) || __CLANG_PREREQ(13, 0)
@@ -2470,7 +2644,7 @@ __hot static size_t pnl_merge(MDBX_PNL dst, const MDBX_PNL src) {
     } else {
     avoid_call_libc_for_short_cases:
       dst[0] = /* the detent */ (MDBX_PNL_ASCENDING ? 0 : P_INVALID);
-      pnl_merge_inner(dst + total, dst + dst_len, src + src_len, src);
+      pnl_merge_inner(dst + total, dst + dst_len, dst, src + src_len, src);
     }
     MDBX_PNL_SETSIZE(dst, total);
   }
@@ -2717,7 +2891,19 @@ static __always_inline void txl_xappend(MDBX_TXL tl, txnid_t id) {
 
 #define TXNID_SORT_CMP(first, last) ((first) > (last))
 SORT_IMPL(txnid_sort, false, txnid_t, TXNID_SORT_CMP)
+
+#if MDBX_WORDBITS >= 64
+/* the key should fit into size_t, so radix-sort is only for 64-bit builds */
+#define MDBX_TXL_EXTRACT_KEY(ptr) (UINT64_MAX - *(ptr))
+RADIXSORT_IMPL(txnid, txnid_t, MDBX_TXL_EXTRACT_KEY, false, 0)
+#endif /* MDBX_WORDBITS >= 64 */
+
 static void txl_sort(MDBX_TXL tl) {
+#if MDBX_WORDBITS >= 64
+  if (unlikely(MDBX_PNL_GETSIZE(tl) >= MDBX_RADIXSORT_THRESHOLD) &&
+      likely(txnid_radixsort(MDBX_PNL_BEGIN(tl), MDBX_PNL_GETSIZE(tl))))
+    return;
+#endif /* MDBX_WORDBITS >= 64 */
   txnid_sort(MDBX_PNL_BEGIN(tl), MDBX_PNL_END(tl));
 }
 
@@ -2736,6 +2922,9 @@ static int __must_check_result txl_append(MDBX_TXL *ptl, txnid_t id) {
 #define MDBX_DPL_GAP_MERGESORT 16
 #define MDBX_DPL_GAP_EDGING 2
 #define MDBX_DPL_RESERVE_GAP (MDBX_DPL_GAP_MERGESORT + MDBX_DPL_GAP_EDGING)
+/* unsorted items are merged into the sorted head only after their number
+ * reaches sqrt(sorted * MDBX_DPL_SORTED_RUN_FACTOR), see dpl_sort_run() */
+#define MDBX_DPL_SORTED_RUN_FACTOR 8
 
 static __always_inline size_t dpl_size2bytes(ptrdiff_t size) {
   assert(size > CURSOR_STACK && (size_t)size <= MDBX_PGL_LIMIT);
@@ -2776,6 +2965,7 @@ static __always_inline size_t dpl_setlen(MDBX_dpl *dl, size_t len) {
   assert(dpl_stub_pageE.mp_flags == P_BAD &&
          dpl_stub_pageE.mp_pgno == P_INVALID);
   dl->length = len;
+  dl->sorted_run = 0;
   dl->items[len + 1].ptr = (MDBX_page *)&dpl_stub_pageE;
   dl->items[len + 1].pgno = P_INVALID;
   dl->items[len + 1].npages = 1;
@@ -2903,9 +3093,54 @@ __hot __noinline static MDBX_dpl *dpl_sort_slowpath(const MDBX_txn *txn) {
            dl->items[dl->length + 1].pgno == P_INVALID);
   }
   dl->sorted = dl->length;
+  dl->sorted_run = 0;
   return dl;
 }
 
+/* Сортирует не-сортированный хвост и сливает его со второй отсортированной
+ * последовательностью (sorted_run), которая расположена между отсортированной
+ * головой и хвостом. Это позволяет не сливать хвост с головой при каждом
+ * поиске, т.е. избежать O(n) затрат на каждые несколько добавлений
+ * в огромный список. Слияние с головой откладывается до тех пор, пока
+ * sorted_run не станет сопоставимым с sqrt(n). */
+__hot __noinline static void dpl_sort_run(const MDBX_txn *txn) {
+  tASSERT(txn, (txn->mt_flags & MDBX_TXN_RDONLY) == 0);
+  tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
+
+  MDBX_dpl *dl = txn->tw.dirtylist;
+  MDBX_dp *const run = dl->items + dl->sorted + 1;
+  MDBX_dp *const tail = run + dl->sorted_run;
+  const size_t unsorted = dl->length - dl->sorted - dl->sorted_run;
+  assert(unsorted > 0 && tail + unsorted == dl->items + dl->length + 1);
+  if (MDBX_DPL_PREALLOC_FOR_RADIXSORT ||
+      dl->length + unsorted < dl->detent + MDBX_DPL_GAP_MERGESORT) {
+    MDBX_dp *const end =
+        dl->items + (MDBX_DPL_PREALLOC_FOR_RADIXSORT
+                         ? dl->length + dl->length + 1
+                         : dl->detent + MDBX_DPL_RESERVE_GAP);
+    MDBX_dp *const tmp = end - unsorted;
+    assert(dl->items + dl->length + 1 < tmp);
+    /* copy unsorted to the end of allocated space and sort it */
+    memcpy(tmp, tail, unsorted * sizeof(MDBX_dp));
+    dp_sort(tmp, end);
+    /* merge with the run from end to begin */
+    MDBX_dp *__restrict w = dl->items + dl->length;
+    MDBX_dp *__restrict l = tail - 1;
+    MDBX_dp *__restrict r = end - 1;
+    do
+      *w = (l >= run && l->pgno > r->pgno) ? *l-- : *r--;
+    while (--w > l);
+    assert(r == tmp - 1);
+  } else
+    dp_sort(run, tail + unsorted);
+
+  dl->sorted_run += unsorted;
+  assert(dl->items[0].pgno == 0 && dl->items[dl->length + 1].pgno == P_INVALID);
+  if (ASSERT_ENABLED())
+    for (MDBX_dp *scan = run; scan < tail + unsorted - 1; ++scan)
+      assert(scan[0].pgno < scan[1].pgno);
+}
+
 static __always_inline MDBX_dpl *dpl_sort(const MDBX_txn *txn) {
   tASSERT(txn, (txn->mt_flags & MDBX_TXN_RDONLY) == 0);
   tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
@@ -2935,8 +3170,14 @@ __hot __noinline static size_t dpl_search(const MDBX_txn *txn, pgno_t pgno) {
     }
   }
 
-  switch (dl->length - dl->sorted) {
+  switch (dl->length - dl->sorted - dl->sorted_run) {
   default:
+    if ((dl->length - dl->sorted) * (uint64_t)(dl->length - dl->sorted) <
+        dl->sorted * (uint64_t)MDBX_DPL_SORTED_RUN_FACTOR) {
+      /* sort the tail into the run */
+      dpl_sort_run(txn);
+      break;
+    }
     /* sort a whole */
     dpl_sort_slowpath(txn);
     break;
@@ -2963,6 +3204,13 @@ __hot __noinline static size_t dpl_search(const MDBX_txn *txn, pgno_t pgno) {
     /* continue bsearch on the sorted part */
     break;
   }
+  if (dl->sorted_run) {
+    const size_t n =
+        dp_bsearch(dl->items + dl->sorted + 1, dl->sorted_run, pgno) -
+        dl->items;
+    if (dl->items[n].pgno == pgno)
+      return n;
+  }
   return dp_bsearch(dl->items + 1, dl->sorted, pgno) - dl->items;
 }
 
@@ -3047,6 +3295,7 @@ static void dpl_remove_ex(const MDBX_txn *txn, size_t i, size_t npages) {
   assert((intptr_t)i > 0 && i <= dl->length);
   assert(dl->items[0].pgno == 0 && dl->items[dl->length + 1].pgno == P_INVALID);
   dl->pages_including_loose -= npages;
+  dl->sorted_run -= dl->sorted < i && dl->sorted + dl->sorted_run >= i;
   dl->sorted -= dl->sorted >= i;
   dl->length -= 1;
   memmove(dl->items + i, dl->items + i + 1,
@@ -3058,6 +3307,40 @@ static void dpl_remove(const MDBX_txn *txn, size_t i) {
   dpl_remove_ex(txn, i, dpl_npages(txn->tw.dirtylist, i));
 }
 
+/* The LRU-label of a dirty page is kept within a size_t word just before
+ * the page itself. The lower bits of the label is a value of the dirtylru
+ * sequence at the last reference, while two most significant bits of the
+ * lower 32-bit half are a saturating counter of re-references. The counter
+ * is incremented when a page is touched again after a spilling turn, set to
+ * maximum by page_unspill() and decremented by a clock-sweep at every spill.
+ * So a page dirtied once by a scan looks older than a frequently used one,
+ * and will be spilled first (like a CLOCK-Pro/2Q but cheaper). */
+#define DP_LRU_FREQ_SHIFT 30
+#define DP_LRU_FREQ_MAX 3u
+#define DP_LRU_MASK ((UINT32_C(1) << DP_LRU_FREQ_SHIFT) - 1)
+
+static __always_inline size_t *dp_lru_ptr(const MDBX_page *dp) {
+  return ptr_disp(dp, -(ptrdiff_t)sizeof(size_t));
+}
+
+static __always_inline unsigned dp_lru_freq(const MDBX_page *dp) {
+  return (uint32_t)*dp_lru_ptr(dp) >> DP_LRU_FREQ_SHIFT;
+}
+
+static __always_inline void dp_lru_set(MDBX_page *dp, uint32_t lru,
+                                       unsigned freq) {
+  assert(lru <= DP_LRU_MASK && freq <= DP_LRU_FREQ_MAX);
+  *dp_lru_ptr(dp) = lru | (size_t)freq << DP_LRU_FREQ_SHIFT;
+}
+
+/* Refresh the LRU-label of a dirty page being referenced/modified again. */
+static __always_inline void dp_lru_refer(const MDBX_txn *txn, MDBX_page *dp) {
+  const uint32_t label = (uint32_t)*dp_lru_ptr(dp);
+  unsigned freq = label >> DP_LRU_FREQ_SHIFT;
+  freq += (freq < DP_LRU_FREQ_MAX && (label & DP_LRU_MASK) != txn->tw.dirtylru);
+  dp_lru_set(dp, txn->tw.dirtylru, freq);
+}
+
 static __noinline void txn_lru_reduce(MDBX_txn *txn) {
   NOTICE("lru-reduce %u -> %u", txn->tw.dirtylru, txn->tw.dirtylru >> 1);
   tASSERT(txn, (txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_WRITEMAP)) == 0);
@@ -3065,11 +3348,12 @@ static __noinline void txn_lru_reduce(MDBX_txn *txn) {
     txn->tw.dirtylru >>= 1;
     MDBX_dpl *dl = txn->tw.dirtylist;
     for (size_t i = 1; i <= dl->length; ++i) {
-      size_t *const ptr =
-          ptr_disp(dl->items[i].ptr, -(ptrdiff_t)sizeof(size_t));
-      *ptr >>= 1;
+      MDBX_page *const dp = dl->items[i].ptr;
+      dp_lru_set(dp, ((uint32_t)*dp_lru_ptr(dp) & DP_LRU_MASK) >> 1,
+                 dp_lru_freq(dp));
     }
-    txn = txn->mt_parent;
+    /* родитель disjoint-транзакции разделяется с другими потоками */
+    txn = (txn->mt_flags & MDBX_TXN_DISJOINT) ? nullptr : txn->mt_parent;
   } while (txn);
 }
 
@@ -3078,13 +3362,13 @@ MDBX_NOTHROW_PURE_FUNCTION static __inline uint32_t dpl_age(const MDBX_txn *txn,
   tASSERT(txn, (txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_WRITEMAP)) == 0);
   const MDBX_dpl *dl = txn->tw.dirtylist;
   assert((intptr_t)i > 0 && i <= dl->length);
-  size_t *const ptr = ptr_disp(dl->items[i].ptr, -(ptrdiff_t)sizeof(size_t));
-  return txn->tw.dirtylru - (uint32_t)*ptr;
+  return txn->tw.dirtylru -
+         ((uint32_t)*dp_lru_ptr(dl->items[i].ptr) & DP_LRU_MASK);
 }
 
 static __inline uint32_t txn_lru_turn(MDBX_txn *txn) {
   txn->tw.dirtylru += 1;
-  if (unlikely(txn->tw.dirtylru > UINT32_MAX / 3) &&
+  if (unlikely(txn->tw.dirtylru > DP_LRU_MASK / 3) &&
       (txn->mt_flags & MDBX_WRITEMAP) == 0)
     txn_lru_reduce(txn);
   return txn->tw.dirtylru;
@@ -3097,10 +3381,8 @@ static __always_inline int __must_check_result dpl_append(MDBX_txn *txn,
   tASSERT(txn, (txn->mt_flags & MDBX_TXN_RDONLY) == 0);
   tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
   const MDBX_dp dp = {page, pgno, (pgno_t)npages};
-  if ((txn->mt_flags & MDBX_WRITEMAP) == 0) {
-    size_t *const ptr = ptr_disp(page, -(ptrdiff_t)sizeof(size_t));
-    *ptr = txn->tw.dirtylru;
-  }
+  if ((txn->mt_flags & MDBX_WRITEMAP) == 0)
+    dp_lru_set(page, txn->tw.dirtylru, 0);
 
   MDBX_dpl *dl = txn->tw.dirtylist;
   tASSERT(txn, dl->length <= MDBX_PGL_LIMIT + MDBX_PNL_GRANULATE);
@@ -3329,7 +3611,8 @@ static int __must_check_result node_add_leaf(MDBX_cursor *mc, size_t indx,
                                              const MDBX_val *key,
                                              MDBX_val *data, unsigned flags);
 static int __must_check_result node_add_leaf2(MDBX_cursor *mc, size_t indx,
-                                              const MDBX_val *key);
+                                              const MDBX_val *key,
+                                              MDBX_val *data, unsigned flags);
 
 static void node_del(MDBX_cursor *mc, size_t ksize);
 static void node_shrink(MDBX_page *mp, size_t indx);
@@ -3397,6 +3680,22 @@ static void cursor_copy(const MDBX_cursor *csrc, MDBX_cursor *cdst);
 static int __must_check_result drop_tree(MDBX_cursor *mc,
                                          const bool may_have_subDBs);
 static int __must_check_result fetch_sdb(MDBX_txn *txn, size_t dbi);
+static int disjoint_end(MDBX_txn *txn, bool commit);
+static void oplog_free(struct MDBX_oplog *log);
+static void codec_release(MDBX_txn *txn);
+static int __must_check_result vlog_fetch(MDBX_cursor *mc, const MDBX_val *ref,
+                                          MDBX_val *data);
+static int __must_check_result vlog_append(MDBX_cursor *mc, const MDBX_val *key,
+                                           const MDBX_val *data, uint8_t *ref);
+static void vlog_release(MDBX_cursor *mc, const MDBX_node *node);
+static int __must_check_result vlog_flush(MDBX_txn *txn);
+static void vlog_merge(MDBX_txn *parent, MDBX_txn *txn);
+static void vlog_end(MDBX_txn *txn, bool commit);
+static int __must_check_result vlog_sync(MDBX_env *env);
+static int dbi_open(MDBX_txn *txn, const MDBX_val *const table_name,
+                    unsigned user_flags, MDBX_dbi *dbi, MDBX_cmp_func *keycmp,
+                    MDBX_cmp_func *datacmp);
+static int __must_check_result cursor_unpack(MDBX_cursor *mc, MDBX_val *data);
 static int __must_check_result setup_dbx(MDBX_dbx *const dbx,
                                          const MDBX_db *const db,
                                          const unsigned pagesize);
@@ -3474,6 +3773,9 @@ __cold const char *mdbx_liberr2str(int errnum) {
   case MDBX_DUPLICATED_CLK:
     return "MDBX_DUPLICATED_CLK: Alternative/Duplicate LCK-file is exists, "
            "please keep one and remove unused other";
+  case MDBX_TXN_CONFLICT:
+    return "MDBX_TXN_CONFLICT: Optimistic transaction conflicts with changes"
+           " committed after it was started, it should be retried";
   default:
     return NULL;
   }
@@ -3796,7 +4098,11 @@ int mdbx_dcmp(const MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *a,
  * Set MDBX_TXN_ERROR on failure. */
 static MDBX_page *page_malloc(MDBX_txn *txn, size_t num) {
   MDBX_env *env = txn->mt_env;
-  MDBX_page *np = env->me_dp_reserve;
+  /* резерв страниц не защищен блокировками, поэтому пока работают
+   * disjoint-транзакции он не используется */
+  MDBX_page *np = likely(!atomic_load32(&env->me_disjoint.active, mo_Relaxed))
+                      ? env->me_dp_reserve
+                      : nullptr;
   size_t size = env->me_psize;
   if (likely(num == 1 && np)) {
     eASSERT(env, env->me_dp_reserve_len > 0);
@@ -3842,7 +4148,8 @@ static void dpage_free(MDBX_env *env, MDBX_page *dp, size_t npages) {
   if (unlikely(env->me_flags & MDBX_PAGEPERTURB))
     memset(dp, -1, pgno2bytes(env, npages));
   if (npages == 1 &&
-      env->me_dp_reserve_len < env->me_options.dp_reserve_limit) {
+      env->me_dp_reserve_len < env->me_options.dp_reserve_limit &&
+      likely(!atomic_load32(&env->me_disjoint.active, mo_Relaxed))) {
     MDBX_ASAN_POISON_MEMORY_REGION(dp, env->me_psize);
     MDBX_ASAN_UNPOISON_MEMORY_REGION(&mp_next(dp), sizeof(MDBX_page *));
     mp_next(dp) = env->me_dp_reserve;
@@ -3924,7 +4231,8 @@ MDBX_MAYBE_UNUSED __cold static bool dirtylist_check(MDBX_txn *txn) {
     if (unlikely(txn->mt_next_pgno < dp->mp_pgno + num))
       return false;
 
-    if (i < dl->sorted) {
+    if (i < dl->sorted ||
+        (i > dl->sorted && i < dl->sorted + dl->sorted_run)) {
       tASSERT(txn, dl->items[i + 1].pgno >= dp->mp_pgno + num);
       if (unlikely(dl->items[i + 1].pgno < dp->mp_pgno + num))
         return false;
@@ -4142,6 +4450,9 @@ static void refund_loose(MDBX_txn *txn) {
 }
 
 static bool txn_refund(MDBX_txn *txn) {
+  /* mt_next_pgno disjoint-транзакции принадлежит родителю */
+  if (txn->mt_flags & MDBX_TXN_DISJOINT)
+    return false;
   const pgno_t before = txn->mt_next_pgno;
 
   if (txn->tw.loose_pages && txn->tw.loose_refund_wl > txn->mt_next_pgno)
@@ -4399,7 +4710,8 @@ status_done:
   /* Возврат страниц в нераспределенный "хвост" БД.
    * Содержимое страниц не уничтожается, а для вложенных транзакций граница
    * нераспределенного "хвоста" БД сдвигается только при их коммите. */
-  if (MDBX_ENABLE_REFUND && unlikely(pgno + npages == txn->mt_next_pgno)) {
+  if (MDBX_ENABLE_REFUND && unlikely(pgno + npages == txn->mt_next_pgno) &&
+      (txn->mt_flags & MDBX_TXN_DISJOINT) == 0) {
     const char *kind = nullptr;
     if (status == modifable) {
       /* Страница испачкана в этой транзакции, но до этого могла быть
@@ -4807,9 +5119,8 @@ static size_t cursor_keep(const MDBX_txn *const txn, const MDBX_cursor *mc) {
         size_t const n = dpl_search(txn, mp->mp_pgno);
         if (txn->tw.dirtylist->items[n].pgno == mp->mp_pgno &&
             /* не считаем дважды */ dpl_age(txn, n)) {
-          size_t *const ptr = ptr_disp(txn->tw.dirtylist->items[n].ptr,
-                                       -(ptrdiff_t)sizeof(size_t));
-          *ptr = txn->tw.dirtylru;
+          MDBX_page *const dp = txn->tw.dirtylist->items[n].ptr;
+          dp_lru_set(dp, txn->tw.dirtylru, dp_lru_freq(dp));
           tASSERT(txn, dpl_age(txn, n) == 0);
           ++keep;
         }
@@ -4839,6 +5150,15 @@ static size_t txn_keep(MDBX_txn *txn, MDBX_cursor *m0) {
   return keep;
 }
 
+/* Returns the age of a dirty page for spilling purposes, i.e. the LRU-age
+ * slowed down according to the counter of re-references. */
+MDBX_NOTHROW_PURE_FUNCTION static __inline uint32_t
+spill_age(const MDBX_txn *txn, const size_t i) {
+  const uint32_t age = dpl_age(txn, i);
+  return age ? 1 + ((age - 1) >> dp_lru_freq(txn->tw.dirtylist->items[i].ptr))
+             : 0;
+}
+
 /* Returns the spilling priority (0..255) for a dirty page:
  *      0 = should be spilled;
  *    ...
@@ -4846,7 +5166,7 @@ static size_t txn_keep(MDBX_txn *txn, MDBX_cursor *m0) {
 MDBX_NOTHROW_PURE_FUNCTION static unsigned
 spill_prio(const MDBX_txn *txn, const size_t i, const uint32_t reciprocal) {
   MDBX_dpl *const dl = txn->tw.dirtylist;
-  const uint32_t age = dpl_age(txn, i);
+  const uint32_t age = spill_age(txn, i);
   const size_t npages = dpl_npages(dl, i);
   const pgno_t pgno = dl->items[i].pgno;
   if (age == 0) {
@@ -4973,6 +5293,13 @@ __cold static int txn_spill_slowpath(MDBX_txn *const txn, MDBX_cursor *const m0,
                                      const size_t need) {
   tASSERT(txn, (txn->mt_flags & MDBX_TXN_RDONLY) == 0);
 
+  if (txn->mt_flags & MDBX_TXN_DISJOINT)
+    /* Выталкивание затрагивает список грязных страниц родителя,
+     * поэтому disjoint-транзакции ограничены его свободным местом */
+    return (wanna_spill_entries > 0 || wanna_spill_npages > 0)
+               ? MDBX_TXN_FULL
+               : MDBX_SUCCESS;
+
   int rc = MDBX_SUCCESS;
   if (unlikely(txn->tw.loose_count >=
                (txn->tw.dirtylist ? txn->tw.dirtylist->pages_including_loose
@@ -5093,12 +5420,16 @@ __cold static int txn_spill_slowpath(MDBX_txn *const txn, MDBX_cursor *const m0,
    *    I/O операций выталкиваем и их, если они попадают в первую половину
    *    между выталкиваемыми и самыми свежими lru-метками;
    *  - дополнительно при сортировке умышленно старим large/overflow страницы,
-   *    тем самым повышая их шансы на выталкивание. */
+   *    тем самым повышая их шансы на выталкивание;
+   *  - для устойчивости к сканированию возраст страниц замедляется
+   *    пропорционально счетчику повторных обращений, а после выталкивания
+   *    счетчики оставшихся страниц уменьшаются (аналог CLOCK-Pro). Поэтому
+   *    однократно измененные страницы выталкиваются раньше "горячих". */
 
   /* get min/max of LRU-labels */
   uint32_t age_max = 0;
   for (size_t i = 1; i <= dl->length; ++i) {
-    const uint32_t age = dpl_age(txn, i);
+    const uint32_t age = spill_age(txn, i);
     age_max = (age_max >= age) ? age_max : age;
   }
 
@@ -5116,7 +5447,7 @@ __cold static int txn_spill_slowpath(MDBX_txn *const txn, MDBX_cursor *const m0,
     TRACE("page %" PRIaPGNO
           ", lru %zu, is_multi %c, npages %u, age %u of %u, prio %u",
           dl->items[i].pgno, *ptr, (dl->items[i].npages > 1) ? 'Y' : 'N',
-          dpl_npages(dl, i), dpl_age(txn, i), age_max, prio);
+          dpl_npages(dl, i), spill_age(txn, i), age_max, prio);
     if (prio < 256) {
       radix_entries[prio] += 1;
       spillable_entries += 1;
@@ -5214,6 +5545,14 @@ __cold static int txn_spill_slowpath(MDBX_txn *const txn, MDBX_cursor *const m0,
     txn->tw.dirtylist->pages_including_loose -= spilled_npages;
     tASSERT(txn, dirtylist_check(txn));
 
+    /* clock-sweep: survived pages lose one of re-references */
+    for (size_t i = 1; i <= dl->length; ++i) {
+      MDBX_page *const dp = dl->items[i].ptr;
+      const unsigned freq = dp_lru_freq(dp);
+      if (freq && dpl_age(txn, i))
+        dp_lru_set(dp, (uint32_t)*dp_lru_ptr(dp) & DP_LRU_MASK, freq - 1);
+    }
+
     if (!iov_empty(&ctx)) {
       tASSERT(txn, rc == MDBX_SUCCESS);
       rc = iov_write(&ctx);
@@ -5590,7 +5929,42 @@ __cold static void meta_troika_dump(const MDBX_env *env,
 
 /*----------------------------------------------------------------------------*/
 
-/* Find oldest txnid still referenced. */
+/* Отмечает изменение в шарде таблицы читателей, которому принадлежит слот. */
+static __always_inline void rslot_changed(MDBX_env *const env,
+                                          const MDBX_reader *const r) {
+  rshard_changed(env->me_lck,
+                 rslot_shard(env->me_rshards, env->me_lck->mti_readers, r));
+}
+
+/* Освобождает слот в таблице читателей. */
+static void rslot_release(MDBX_env *const env, MDBX_reader *const r) {
+  atomic_store32(&r->mr_pid, 0, mo_AcquireRelease);
+  MDBX_rshard *const shard =
+      rslot_shard(env->me_rshards, env->me_lck->mti_readers, r);
+  rshard_vacated(shard, (size_t)(r - env->me_lck->mti_readers));
+  rshard_changed(env->me_lck, shard);
+}
+
+/* Принудительный пересмотр всех шардов таблицы читателей. */
+static void readers_refresh_all(MDBX_env *const env) {
+  MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
+  if (likely(lck)) {
+    const size_t snap_nreaders =
+        atomic_load32(&lck->mti_numreaders, mo_AcquireRelease);
+    for (size_t shard = 0; shard * MDBX_READERS_SHARD < snap_nreaders; ++shard)
+      atomic_store32(&env->me_rshards[shard].rs_clean, false, mo_Relaxed);
+  }
+  atomic_store32(&env->me_lck->mti_readers_refresh_flag, true,
+                 mo_AcquireRelease);
+}
+
+/* Find oldest txnid still referenced.
+ *
+ * Слоты просматриваются только в шардах, где после предыдущего поиска
+ * начинались или завершались читающие транзакции, а для остальных шардов
+ * используется ранее найденный минимум. Поэтому при большом количестве
+ * читателей стоимость поиска определяется количеством шардов и активностью
+ * читателей, а не размером всей таблицы. */
 static txnid_t find_oldest_reader(MDBX_env *const env, const txnid_t steady) {
   const uint32_t nothing_changed = MDBX_STRING_TETRAD("None");
   eASSERT(env, steady <= env->me_txn0->mt_txnid);
@@ -5610,36 +5984,49 @@ static txnid_t find_oldest_reader(MDBX_env *const env, const txnid_t steady) {
   while (nothing_changed !=
          atomic_load32(&lck->mti_readers_refresh_flag, mo_AcquireRelease)) {
     lck->mti_readers_refresh_flag.weak = nothing_changed;
+    osal_memory_barrier();
     jitter4testing(false);
     const size_t snap_nreaders =
         atomic_load32(&lck->mti_numreaders, mo_AcquireRelease);
     new_oldest = steady;
 
-    for (size_t i = 0; i < snap_nreaders; ++i) {
-      const uint32_t pid =
-          atomic_load32(&lck->mti_readers[i].mr_pid, mo_AcquireRelease);
-      if (!pid)
-        continue;
-      jitter4testing(true);
+    for (size_t begin = 0; begin < snap_nreaders; begin += MDBX_READERS_SHARD) {
+      MDBX_rshard *const shard = env->me_rshards + begin / MDBX_READERS_SHARD;
+      if (!atomic_load32(&shard->rs_clean, mo_AcquireRelease)) {
+        atomic_store32(&shard->rs_clean, true, mo_Relaxed);
+        osal_memory_barrier();
+        const size_t end = (snap_nreaders - begin > MDBX_READERS_SHARD)
+                               ? begin + MDBX_READERS_SHARD
+                               : snap_nreaders;
+        txnid_t shard_oldest = MAX_TXNID;
+        for (size_t i = begin; i < end; ++i) {
+          const uint32_t pid =
+              atomic_load32(&lck->mti_readers[i].mr_pid, mo_AcquireRelease);
+          if (!pid)
+            continue;
+          jitter4testing(true);
+
+          const txnid_t rtxn = safe64_read(&lck->mti_readers[i].mr_txnid);
+          if (unlikely(rtxn < prev_oldest)) {
+            if (unlikely(nothing_changed ==
+                         atomic_load32(&lck->mti_readers_refresh_flag,
+                                       mo_AcquireRelease)) &&
+                safe64_reset_compare(&lck->mti_readers[i].mr_txnid, rtxn)) {
+              NOTICE("kick stuck reader[%zu of %zu].pid_%u %" PRIaTXN
+                     " < prev-oldest %" PRIaTXN ", steady-txn %" PRIaTXN,
+                     i, snap_nreaders, pid, rtxn, prev_oldest, steady);
+            }
+            continue;
+          }
 
-      const txnid_t rtxn = safe64_read(&lck->mti_readers[i].mr_txnid);
-      if (unlikely(rtxn < prev_oldest)) {
-        if (unlikely(nothing_changed ==
-                     atomic_load32(&lck->mti_readers_refresh_flag,
-                                   mo_AcquireRelease)) &&
-            safe64_reset_compare(&lck->mti_readers[i].mr_txnid, rtxn)) {
-          NOTICE("kick stuck reader[%zu of %zu].pid_%u %" PRIaTXN
-                 " < prev-oldest %" PRIaTXN ", steady-txn %" PRIaTXN,
-                 i, snap_nreaders, pid, rtxn, prev_oldest, steady);
+          if (rtxn < shard_oldest)
+            shard_oldest = rtxn;
         }
-        continue;
+        shard->rs_oldest = shard_oldest;
       }
 
-      if (rtxn < new_oldest) {
-        new_oldest = rtxn;
-        if (!MDBX_DEBUG && !MDBX_FORCE_ASSERTIONS && new_oldest == prev_oldest)
-          break;
-      }
+      if (new_oldest > shard->rs_oldest)
+        new_oldest = shard->rs_oldest;
     }
   }
 
@@ -6342,7 +6729,7 @@ __cold static int wipe_steady(MDBX_txn *txn, txnid_t last_steady) {
                              env->me_os_psize);
 
   /* force oldest refresh */
-  atomic_store32(&env->me_lck->mti_readers_refresh_flag, true, mo_Relaxed);
+  readers_refresh_all(env);
 
   tASSERT(txn, (txn->mt_flags & MDBX_TXN_RDONLY) == 0);
   txn->tw.troika = meta_tap(env);
@@ -6848,6 +7235,7 @@ static pgno_t *scan4seq_resolver(pgno_t *range, const size_t len,
 #define MDBX_ALLOC_COALESCE 4    /* внутреннее состояние */
 #define MDBX_ALLOC_SHOULD_SCAN 8 /* внутреннее состояние */
 #define MDBX_ALLOC_LIFO 16       /* внутреннее состояние */
+#define MDBX_ALLOC_SPILLED 32    /* без выделения памяти под грязные страницы */
 
 static __inline bool is_gc_usable(MDBX_txn *txn, const MDBX_cursor *mc,
                                   const uint8_t flags) {
@@ -7218,6 +7606,126 @@ bailout:
   return ret;
 }
 
+/* Выделение страниц для disjoint-транзакции. Такие транзакции не работают
+ * с GC, а получают страницы порциями из relist-а родителя или отрезая их от
+ * нераспределенного "хвоста" БД. Неиспользованный остаток порции остается
+ * в собственном relist-е транзакции и возвращается родителю при её завершении.
+ * Вызов выполняется под me_disjoint.lock, так как родитель общий. */
+static int disjoint_carve(MDBX_txn *txn, const size_t num, pgno_t *pgno) {
+  /* размер порции одиночных страниц, отбираемых у родителя за один раз */
+  const size_t chunk = 64;
+  MDBX_txn *const parent = txn->mt_parent;
+  MDBX_env *const env = txn->mt_env;
+  tASSERT(txn, (txn->mt_flags & MDBX_TXN_DISJOINT) && parent == env->me_txn0);
+
+  int rc = osal_fastmutex_acquire(&env->me_disjoint.lock);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  *pgno = 0;
+  if (num == 1) {
+    size_t n = MDBX_PNL_GETSIZE(parent->tw.relist);
+    if (n) {
+      n = (n < chunk) ? n : chunk;
+      rc = pnl_need(&txn->tw.relist, n);
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto bailout;
+      do
+        rc = pnl_insert_range(&txn->tw.relist, relist_get_single(parent), 1);
+      while (likely(rc == MDBX_SUCCESS) && --n);
+      tASSERT(txn, rc == MDBX_SUCCESS);
+      *pgno = relist_get_single(txn);
+    }
+  } else if (MDBX_PNL_GETSIZE(parent->tw.relist) >= num)
+    *pgno = relist_get_sequence(parent, num, MDBX_ALLOC_DEFAULT);
+
+  if (!*pgno) {
+    /* отрезаем от нераспределенного "хвоста" БД */
+    size_t want = (num > 1) ? num : chunk;
+    const size_t newnext = parent->mt_next_pgno + want;
+    if (newnext > parent->mt_end_pgno) {
+      size_t aligned = newnext;
+      if (parent->mt_geo.grow_pv) {
+        const size_t grow_step = pv2pages(parent->mt_geo.grow_pv);
+        aligned = pgno_align2os_pgno(
+            env, (pgno_t)(newnext + grow_step - newnext % grow_step));
+      }
+      if (aligned > parent->mt_geo.upper)
+        aligned = parent->mt_geo.upper;
+      if (aligned > parent->mt_end_pgno && parent->mt_geo.grow_pv) {
+        VERBOSE("try growth datafile to %zu pages (+%zu)", aligned,
+                aligned - parent->mt_end_pgno);
+        rc = dxb_resize(env, parent->mt_next_pgno, (pgno_t)aligned,
+                        parent->mt_geo.upper, implicit_grow);
+        if (unlikely(rc != MDBX_SUCCESS)) {
+          ERROR("unable growth datafile to %zu pages (+%zu), errcode %d",
+                aligned, aligned - parent->mt_end_pgno, rc);
+          goto bailout;
+        }
+        parent->mt_end_pgno = (pgno_t)aligned;
+      }
+      /* довольствуемся тем, что осталось */
+      if (parent->mt_next_pgno + want > parent->mt_end_pgno)
+        want = parent->mt_end_pgno - parent->mt_next_pgno;
+      if (want < num) {
+        NOTICE("disjoint-alloc: next %" PRIaPGNO " + %zu > upper %" PRIaPGNO,
+               parent->mt_next_pgno, num, parent->mt_geo.upper);
+        rc = MDBX_MAP_FULL;
+        goto bailout;
+      }
+    }
+    if (want > num) {
+      rc = pnl_insert_range(&txn->tw.relist, parent->mt_next_pgno + num,
+                            want - num);
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto bailout;
+    }
+    *pgno = parent->mt_next_pgno;
+    parent->mt_next_pgno += (pgno_t)want;
+  }
+
+  /* Refund for disjoint txns is impossible, therefore the last allocated
+   * page could be freed to relist. So shift the boundary to keep the relist
+   * invariant, i.e. MDBX_PNL_MOST(relist) < mt_next_pgno - MDBX_ENABLE_REFUND,
+   * since the parent will do refund after merge. */
+  txn->mt_next_pgno = parent->mt_next_pgno + MDBX_ENABLE_REFUND;
+  txn->mt_end_pgno = parent->mt_end_pgno;
+  eASSERT(env, *pgno >= NUM_METAS && *pgno + num <= txn->mt_next_pgno);
+
+bailout:
+  ENSURE(env, osal_fastmutex_release(&env->me_disjoint.lock) == MDBX_SUCCESS);
+  return rc;
+}
+
+/* Регистрирует выделенные страницы сразу как вытесненные (spilled), без
+ * выделения памяти и добавления в dirty-список. Содержимое таких страниц
+ * должно записываться непосредственно в файл до их использования. */
+static pgr_t page_alloc_spilled(MDBX_txn *const txn, const pgno_t pgno,
+                                const size_t num) {
+  tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0);
+  pgr_t ret;
+  if (!txn->tw.spilled.list) {
+    txn->tw.spilled.least_removed = INT_MAX;
+    txn->tw.spilled.list = pnl_alloc(num);
+    if (unlikely(!txn->tw.spilled.list)) {
+      ret.err = MDBX_ENOMEM;
+      ret.page = nullptr;
+      return ret;
+    }
+  } else
+    spill_purge(txn);
+
+  ret.err = pnl_append_range(true, &txn->tw.spilled.list, pgno << 1, num);
+  if (unlikely(ret.err != MDBX_SUCCESS)) {
+    ret.page = nullptr;
+    return ret;
+  }
+  pnl_sort(txn->tw.spilled.list, (size_t)txn->mt_next_pgno << 1);
+  txn->mt_flags |= MDBX_TXN_SPILLS;
+  ret.page = pgno2page(txn->mt_env, pgno);
+  return ret;
+}
+
 static pgr_t page_alloc_slowpath(const MDBX_cursor *const mc, const size_t num,
                                  uint8_t flags) {
 #if MDBX_ENABLE_PROFGC
@@ -7256,6 +7764,17 @@ static pgr_t page_alloc_slowpath(const MDBX_cursor *const mc, const size_t num,
     eASSERT(env, !(flags & MDBX_ALLOC_RESERVE) || num == 0);
   }
 
+  if (unlikely(txn->mt_flags & MDBX_TXN_DISJOINT)) {
+    if (unlikely(flags & MDBX_ALLOC_RESERVE)) {
+      ret.err = MDBX_NOTFOUND;
+      goto fail;
+    }
+    ret.err = disjoint_carve(txn, num, &pgno);
+    if (unlikely(ret.err != MDBX_SUCCESS))
+      goto fail;
+    goto done;
+  }
+
   //---------------------------------------------------------------------------
 
   if (unlikely(!is_gc_usable(txn, mc, flags))) {
@@ -7686,7 +8205,9 @@ done:
       eASSERT(env, pgno >= NUM_METAS && pgno + num <= txn->mt_next_pgno);
     }
 
-    ret = page_alloc_finalize(env, txn, mc, pgno, num);
+    ret = likely((flags & MDBX_ALLOC_SPILLED) == 0)
+              ? page_alloc_finalize(env, txn, mc, pgno, num)
+              : page_alloc_spilled(txn, pgno, num);
     if (unlikely(ret.err != MDBX_SUCCESS)) {
     fail:
       eASSERT(env, ret.err != MDBX_SUCCESS);
@@ -7842,6 +8363,8 @@ static pgr_t __must_check_result page_unspill(MDBX_txn *const txn,
     ret.err = page_dirty(txn, ret.page, npages);
     if (unlikely(ret.err != MDBX_SUCCESS))
       return ret;
+    /* the page was spilled but required again, so it is a hot one */
+    dp_lru_set(ret.page, txn->tw.dirtylru, DP_LRU_FREQ_MAX);
 #if MDBX_ENABLE_PGOP_STAT
     txn->mt_env->me_lck->mti_pgop_stat.unspill.weak += npages;
 #endif /* MDBX_ENABLE_PGOP_STAT */
@@ -7909,11 +8432,8 @@ __hot static int page_touch(MDBX_cursor *mc) {
     tASSERT(txn, n > 0 && n <= txn->tw.dirtylist->length);
     tASSERT(txn, txn->tw.dirtylist->items[n].pgno == mp->mp_pgno &&
                      txn->tw.dirtylist->items[n].ptr == mp);
-    if (!MDBX_AVOID_MSYNC || (txn->mt_flags & MDBX_WRITEMAP) == 0) {
-      size_t *const ptr =
-          ptr_disp(txn->tw.dirtylist->items[n].ptr, -(ptrdiff_t)sizeof(size_t));
-      *ptr = txn->tw.dirtylru;
-    }
+    if (!MDBX_AVOID_MSYNC || (txn->mt_flags & MDBX_WRITEMAP) == 0)
+      dp_lru_refer(txn, txn->tw.dirtylist->items[n].ptr);
     return MDBX_SUCCESS;
   }
   if (IS_SUBP(mp)) {
@@ -8252,6 +8772,157 @@ __cold int mdbx_env_sync_poll(MDBX_env *env) {
 }
 #endif /* LIBMDBX_NO_EXPORTS_LEGACY_API */
 
+/*----------------------------------------------------------------------------*/
+/* Уведомление о фиксации транзакций */
+
+/* Пишущая транзакция увеличивает mti_commit_seq после обновления мета-страницы,
+ * а ожидающие спят на нём как на futex. Поэтому будить требуется только при
+ * наличии ожидающих, а пропустить фиксацию невозможно: futex не заснет если
+ * счетчик уже изменился после последней проверки txnid. */
+static void notify_commit(MDBX_env *env) {
+  MDBX_lockinfo *const lck = env->me_lck;
+  atomic_add32(&lck->mti_commit_seq, 1);
+  if (atomic_load32(&lck->mti_commit_waiters, mo_AcquireRelease))
+    osal_futex_wake(&lck->mti_commit_seq.weak, INT_MAX);
+}
+
+static int wait_commit(const MDBX_env *env, const txnid_t after_txnid,
+                       const uint64_t timeout) {
+  MDBX_lockinfo *const lck = env->me_lck;
+  const uint64_t deadline = timeout ? osal_monotime() + timeout : 0;
+  for (;;) {
+    const uint32_t seq = atomic_load32(&lck->mti_commit_seq, mo_AcquireRelease);
+    if (recent_committed_txnid(env) > after_txnid)
+      return MDBX_SUCCESS;
+
+    uint64_t remain = 0;
+    if (deadline) {
+      const uint64_t now = osal_monotime();
+      if (now >= deadline)
+        return MDBX_RESULT_TRUE;
+      remain = osal_monotime_to_16dot16(deadline - now);
+      remain = (remain * UINT64_C(1000000000) + 65535) >> 16;
+    }
+
+    atomic_add32(&lck->mti_commit_waiters, 1);
+    const int err = osal_futex_wait(&lck->mti_commit_seq.weak, seq, remain);
+    atomic_sub32(&lck->mti_commit_waiters, 1);
+    if (unlikely(err != MDBX_SUCCESS && err != EAGAIN && err != EINTR &&
+                 err != ETIMEDOUT))
+      return err;
+  }
+}
+
+__cold int mdbx_env_wait_commit(const MDBX_env *env, uint64_t after_txnid,
+                                unsigned timeout_seconds_16dot16) {
+  int rc = check_env(env, true);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  return wait_commit(env, after_txnid,
+                     timeout_seconds_16dot16
+                         ? osal_16dot16_to_monotime(timeout_seconds_16dot16)
+                         : 0);
+}
+
+#if !(defined(_WIN32) || defined(_WIN64))
+static THREAD_RESULT THREAD_CALL commit_watch_thread(void *arg) {
+  MDBX_env *const env = arg;
+  MDBX_lockinfo *const lck = env->me_lck;
+  txnid_t last = recent_committed_txnid(env);
+  for (;;) {
+    const uint32_t seq = atomic_load32(&lck->mti_commit_seq, mo_AcquireRelease);
+    if (atomic_load32(&env->me_commit_watch.stop, mo_AcquireRelease))
+      break;
+    const txnid_t recent = recent_committed_txnid(env);
+    if (recent > last) {
+      last = recent;
+      const uint64_t one = 1;
+      /* eventfd требует 8 байт, а для pipe достаточно любого количества,
+       * при этом переполнение pipe означает что уведомление уже ожидает */
+      if (write(env->me_commit_watch.fd[1], &one, sizeof(one)) < 0 &&
+          errno != EAGAIN) {
+        ERROR("commit-watch: %s error %d", "write", errno);
+        break;
+      }
+    }
+
+    atomic_add32(&lck->mti_commit_waiters, 1);
+    const int err = osal_futex_wait(&lck->mti_commit_seq.weak, seq, 0);
+    atomic_sub32(&lck->mti_commit_waiters, 1);
+    if (unlikely(err != MDBX_SUCCESS && err != EAGAIN && err != EINTR)) {
+      ERROR("commit-watch: %s error %d", "futex", err);
+      break;
+    }
+  }
+  return (THREAD_RESULT)0;
+}
+
+static void commit_watch_stop(MDBX_env *env) {
+  if (!env->me_commit_watch.running)
+    return;
+  atomic_store32(&env->me_commit_watch.stop, true, mo_AcquireRelease);
+  /* изменение счетчика не даст потоку заснуть после проверки флага,
+   * а для прочих ожидающих это лишь ложное пробуждение */
+  notify_commit(env);
+  osal_thread_join(env->me_commit_watch.thread);
+  close(env->me_commit_watch.fd[0]);
+  if (env->me_commit_watch.fd[1] != env->me_commit_watch.fd[0])
+    close(env->me_commit_watch.fd[1]);
+  env->me_commit_watch.running = false;
+}
+#endif /* !Windows */
+
+__cold int mdbx_env_get_commit_fd(MDBX_env *env, mdbx_filehandle_t *fd) {
+  int rc = check_env(env, true);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely(!fd))
+    return MDBX_EINVAL;
+
+#if defined(_WIN32) || defined(_WIN64)
+  return MDBX_ENOSYS;
+#else
+  rc = osal_fastmutex_acquire(&env->me_dbi_lock);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (!env->me_commit_watch.running) {
+#if defined(__linux__) || defined(__gnu_linux__)
+    env->me_commit_watch.fd[0] = env->me_commit_watch.fd[1] =
+        eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    rc = (env->me_commit_watch.fd[0] < 0) ? errno : MDBX_SUCCESS;
+#else
+    rc = pipe(env->me_commit_watch.fd) ? errno : MDBX_SUCCESS;
+    for (size_t i = 0; rc == MDBX_SUCCESS && i < 2; ++i)
+      if (fcntl(env->me_commit_watch.fd[i], F_SETFD, FD_CLOEXEC) == -1 ||
+          fcntl(env->me_commit_watch.fd[i], F_SETFL, O_NONBLOCK) == -1) {
+        rc = errno;
+        close(env->me_commit_watch.fd[0]);
+        close(env->me_commit_watch.fd[1]);
+      }
+#endif /* Linux */
+    if (likely(rc == MDBX_SUCCESS)) {
+      atomic_store32(&env->me_commit_watch.stop, false, mo_Relaxed);
+      rc = osal_thread_create(&env->me_commit_watch.thread,
+                              commit_watch_thread, env);
+      if (likely(rc == MDBX_SUCCESS))
+        env->me_commit_watch.running = true;
+      else {
+        close(env->me_commit_watch.fd[0]);
+        if (env->me_commit_watch.fd[1] != env->me_commit_watch.fd[0])
+          close(env->me_commit_watch.fd[1]);
+      }
+    }
+  }
+  if (likely(rc == MDBX_SUCCESS))
+    *fd = env->me_commit_watch.fd[0];
+
+  ENSURE(env, osal_fastmutex_release(&env->me_dbi_lock) == MDBX_SUCCESS);
+  return rc;
+#endif /* !Windows */
+}
+
 /* Back up parent txn's cursors, then grab the originals for tracking */
 static int cursor_shadow(MDBX_txn *parent, MDBX_txn *nested) {
   tASSERT(parent, parent->mt_cursors[FREE_DBI] == nullptr);
@@ -8440,70 +9111,152 @@ typedef struct {
   MDBX_reader *rslot;
 } bind_rslot_result;
 
+/* Захват свободного слота в пределах шарда, начиная с его подсказки. */
+static MDBX_reader *rshard_claim(MDBX_env *env, const size_t begin,
+                                 const size_t nreaders) {
+  MDBX_rshard *const shard = env->me_rshards + begin / MDBX_READERS_SHARD;
+  const size_t n = (nreaders - begin > MDBX_READERS_SHARD) ? MDBX_READERS_SHARD
+                                                           : nreaders - begin;
+  size_t i = atomic_load32(&shard->rs_hint, mo_Relaxed);
+  if (unlikely(i >= n))
+    i = 0;
+  for (size_t left = n; left > 0; --left) {
+    MDBX_reader *const r = &env->me_lck->mti_readers[begin + i];
+    if (atomic_load32(&r->mr_pid, mo_Relaxed) == 0 &&
+        atomic_cas32(&r->mr_pid, 0, env->me_pid)) {
+      atomic_add32(&shard->rs_count, 1);
+      atomic_store32(&shard->rs_hint, (uint32_t)i + 1, mo_Relaxed);
+      return r;
+    }
+    if (++i == n)
+      i = 0;
+  }
+  return nullptr;
+}
+
+/* Lock-free захват свободного слота в таблице читателей.
+ *
+ * Слот считается свободным при нулевом mr_pid и захватывается посредством
+ * CAS этого поля, поэтому конкурирующие потоки и процессы не могут получить
+ * один и тот же слот. Таблица разделена на шарды по MDBX_READERS_SHARD
+ * слотов, у каждого из которых есть собственные счетчик занятых слотов и
+ * подсказка о вероятно свободном слоте. Поиск начинается с «домашнего»
+ * шарда, выбираемого по хэшу идентификаторов процесса и потока, поэтому
+ * потоки разных процессов распределяются по разным шардам и не конкурируют
+ * за общие кэш-линии, а заполненные шарды пропускаются без просмотра слотов.
+ *
+ * Если свободных слотов нет, то таблица расширяется атомарным увеличением
+ * mti_numreaders, который никогда не уменьшается. Счетчики шардов являются
+ * только подсказкой, поэтому перед отказом по исчерпанию таблицы выполняется
+ * просмотр всех слотов. Очистка слотов умерших процессов по-прежнему
+ * выполняется под блокировкой, но она только освобождает слоты, не конфликтуя
+ * с CAS-захватом. */
+static MDBX_reader *rslot_claim(MDBX_env *env, const uintptr_t tid) {
+  MDBX_lockinfo *const lck = env->me_lck;
+  const size_t home =
+      (size_t)(((uint64_t)env->me_pid << 32 ^ (uint64_t)tid) *
+                   UINT64_C(0x9E3779B97F4A7C15) >>
+               32);
+  bool exhaustive = false;
+  while (true) {
+    const size_t nreaders =
+        atomic_load32(&lck->mti_numreaders, mo_AcquireRelease);
+    const size_t nshards =
+        (nreaders + MDBX_READERS_SHARD - 1) / MDBX_READERS_SHARD;
+    for (size_t n = 0, shard = nshards ? home % nshards : 0; n < nshards;
+         ++n) {
+      const size_t begin = shard * MDBX_READERS_SHARD;
+      const size_t n = (nreaders - begin > MDBX_READERS_SHARD)
+                           ? MDBX_READERS_SHARD
+                           : nreaders - begin;
+      if (exhaustive ||
+          atomic_load32(&env->me_rshards[shard].rs_count, mo_Relaxed) < n) {
+        MDBX_reader *const r = rshard_claim(env, begin, nreaders);
+        if (r)
+          return r;
+      }
+      if (++shard == nshards)
+        shard = 0;
+    }
+
+    if (unlikely(nreaders >= env->me_maxreaders)) {
+      if (exhaustive)
+        return nullptr;
+      exhaustive = true;
+      continue;
+    }
+    if (atomic_cas32(&lck->mti_numreaders, (uint32_t)nreaders,
+                     (uint32_t)nreaders + 1)) {
+      MDBX_reader *const r = &lck->mti_readers[nreaders];
+      if (likely(atomic_cas32(&r->mr_pid, 0, env->me_pid))) {
+        MDBX_rshard *const shard =
+            env->me_rshards + nreaders / MDBX_READERS_SHARD;
+        atomic_add32(&shard->rs_count, 1);
+        atomic_store32(&shard->rs_hint,
+                       (uint32_t)(nreaders % MDBX_READERS_SHARD) + 1,
+                       mo_Relaxed);
+        return r;
+      }
+    }
+  }
+}
+
 static bind_rslot_result bind_rslot(MDBX_env *env, const uintptr_t tid) {
   eASSERT(env, env->me_lck_mmap.lck);
   eASSERT(env, env->me_lck->mti_magic_and_version == MDBX_LOCK_MAGIC);
   eASSERT(env, env->me_lck->mti_os_and_format == MDBX_LOCK_FORMAT);
 
-  bind_rslot_result result = {osal_rdt_lock(env), nullptr};
-  if (unlikely(MDBX_IS_ERROR(result.err)))
-    return result;
+  /* The readers table lock is needed only for the first registration of the
+   * process and for cleanup of dead readers. On Windows it also guards
+   * against remapping, so it is kept as before. */
+  bind_rslot_result result = {MDBX_SUCCESS, nullptr};
+#if defined(_WIN32) || defined(_WIN64)
+  const bool locked = true;
+#else
+  const bool locked = env->me_live_reader != env->me_pid;
+#endif
+  if (locked) {
+    result.err = osal_rdt_lock(env);
+    if (unlikely(MDBX_IS_ERROR(result.err)))
+      return result;
+  }
   if (unlikely(env->me_flags & MDBX_FATAL_ERROR)) {
-    osal_rdt_unlock(env);
     result.err = MDBX_PANIC;
-    return result;
+    goto bailout;
   }
   if (unlikely(!env->me_map)) {
-    osal_rdt_unlock(env);
     result.err = MDBX_EPERM;
-    return result;
+    goto bailout;
   }
 
   if (unlikely(env->me_live_reader != env->me_pid)) {
+    eASSERT(env, locked);
     result.err = osal_rpid_set(env);
-    if (unlikely(result.err != MDBX_SUCCESS)) {
-      osal_rdt_unlock(env);
-      return result;
-    }
+    if (unlikely(result.err != MDBX_SUCCESS))
+      goto bailout;
     env->me_live_reader = env->me_pid;
   }
 
   result.err = MDBX_SUCCESS;
-  size_t slot, nreaders;
-  while (1) {
-    nreaders = env->me_lck->mti_numreaders.weak;
-    for (slot = 0; slot < nreaders; slot++)
-      if (!atomic_load32(&env->me_lck->mti_readers[slot].mr_pid,
-                         mo_AcquireRelease))
-        break;
-
-    if (likely(slot < env->me_maxreaders))
-      break;
-
-    result.err = cleanup_dead_readers(env, true, NULL);
+  while (unlikely((result.rslot = rslot_claim(env, tid)) == nullptr)) {
+    result.err = cleanup_dead_readers(env, locked, NULL);
     if (result.err != MDBX_RESULT_TRUE) {
-      osal_rdt_unlock(env);
       result.err =
           (result.err == MDBX_SUCCESS) ? MDBX_READERS_FULL : result.err;
-      return result;
+      goto bailout;
     }
   }
 
-  result.rslot = &env->me_lck->mti_readers[slot];
-  /* Claim the reader slot, carefully since other code
-   * uses the reader table un-mutexed: First reset the
-   * slot, next publish it in lck->mti_numreaders.  After
-   * that, it is safe for mdbx_env_close() to touch it.
-   * When it will be closed, we can finally claim it. */
-  atomic_store32(&result.rslot->mr_pid, 0, mo_AcquireRelease);
+  /* The slot is owned now, since mr_pid was set by CAS. Other code uses
+   * the reader table un-mutexed, so reset the txnid before the tid. */
   safe64_reset(&result.rslot->mr_txnid, true);
-  if (slot == nreaders)
-    env->me_lck->mti_numreaders.weak = (uint32_t)++nreaders;
   result.rslot->mr_tid.weak = (env->me_flags & MDBX_NOTLS) ? 0 : tid;
-  atomic_store32(&result.rslot->mr_pid, env->me_pid, mo_AcquireRelease);
-  osal_rdt_unlock(env);
+  result.err = MDBX_SUCCESS;
 
-  if (likely(env->me_flags & MDBX_ENV_TXKEY)) {
+bailout:
+  if (locked)
+    osal_rdt_unlock(env);
+  if (likely(result.rslot) && likely(env->me_flags & MDBX_ENV_TXKEY)) {
     eASSERT(env, env->me_live_reader == env->me_pid);
     thread_rthc_set(env->me_txkey, result.rslot);
   }
@@ -8569,9 +9322,7 @@ __cold int mdbx_thread_unregister(const MDBX_env *env) {
   if (unlikely(r->mr_txnid.weak < SAFE64_INVALID_THRESHOLD))
     return MDBX_BUSY /* transaction is still active */;
 
-  atomic_store32(&r->mr_pid, 0, mo_Relaxed);
-  atomic_store32(&env->me_lck->mti_readers_refresh_flag, true,
-                 mo_AcquireRelease);
+  rslot_release((MDBX_env *)env, r);
   thread_rthc_set(env->me_txkey, nullptr);
   return MDBX_SUCCESS;
 }
@@ -8722,8 +9473,9 @@ static bool coherency_check_meta(const MDBX_env *env,
          MDBX_SUCCESS;
 }
 
-/* Common code for mdbx_txn_begin() and mdbx_txn_renew(). */
-static int txn_renew(MDBX_txn *txn, const unsigned flags) {
+/* Common code for mdbx_txn_begin(), mdbx_txn_renew() and mdbx_txn_clone() */
+static int txn_renew(MDBX_txn *txn, const unsigned flags,
+                     const MDBX_txn *origin) {
   MDBX_env *env = txn->mt_env;
   int rc;
 
@@ -8734,7 +9486,10 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
   }
 #endif /* MDBX_ENV_CHECKPID */
 
-  STATIC_ASSERT(sizeof(MDBX_reader) == 32);
+  STATIC_ASSERT(sizeof(MDBX_reader) ==
+                (MDBX_CACHELINE_SIZE > 32 ? MDBX_CACHELINE_SIZE : 32));
+  STATIC_ASSERT(sizeof(MDBX_rshard) == MDBX_CACHELINE_SIZE);
+  STATIC_ASSERT(MDBX_READERS_LIMIT % MDBX_READERS_SHARD == 0);
 #if MDBX_LOCKING > 0
   STATIC_ASSERT(offsetof(MDBX_lockinfo, mti_wlock) % MDBX_CACHELINE_SIZE == 0);
   STATIC_ASSERT(offsetof(MDBX_lockinfo, mti_rlock) % MDBX_CACHELINE_SIZE == 0);
@@ -8795,6 +9550,49 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
       return MDBX_SUCCESS;
     }
 
+    if (unlikely(origin)) {
+      /* Клонирование: снимок уже удерживается исходной читающей транзакцией,
+       * поэтому выбирать мета-страницу и проверять её когерентность не нужно,
+       * достаточно опубликовать тот же txnid в своём слоте читателя. */
+      eASSERT(env, origin->mt_flags & MDBX_TXN_RDONLY);
+      if (likely(r)) {
+        safe64_reset(&r->mr_txnid, false);
+        atomic_store32(&r->mr_snapshot_pages_used, origin->mt_next_pgno,
+                       mo_Relaxed);
+        atomic_store64(&r->mr_snapshot_pages_retired,
+                       origin->to.reader
+                           ? atomic_load64(
+                                 &origin->to.reader->mr_snapshot_pages_retired,
+                                 mo_Relaxed)
+                           : 0,
+                       mo_Relaxed);
+        safe64_write(&r->mr_txnid, origin->mt_txnid);
+        rslot_changed(env, r);
+      }
+      txn->mt_txnid = origin->mt_txnid;
+      txn->mt_geo = origin->mt_geo;
+      memcpy(txn->mt_dbs, origin->mt_dbs, CORE_DBS * sizeof(MDBX_db));
+      txn->mt_canary = origin->mt_canary;
+
+      /* Исходная транзакция должна оставаться активной до публикации txnid,
+       * иначе снимок мог быть уже переработан. */
+      if (unlikely(
+              (origin->mt_flags & MDBX_TXN_FINISHED) ||
+              (origin->to.reader &&
+               safe64_read(&origin->to.reader->mr_txnid) != txn->mt_txnid) ||
+              txn->mt_txnid < atomic_load64(&env->me_lck->mti_oldest_reader,
+                                            mo_AcquireRelease))) {
+        txn->mt_txnid = INVALID_TXNID;
+        if (likely(r)) {
+          safe64_reset(&r->mr_txnid, false);
+          rslot_changed(env, r);
+        }
+        rc = MDBX_BAD_TXN;
+        goto bailout;
+      }
+      goto snapshot_taken;
+    }
+
     /* Seek & fetch the last meta */
     uint64_t timestamp = 0;
     size_t loop = 0;
@@ -8820,8 +9618,7 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
         eASSERT(env, r->mr_txnid.weak == head.txnid ||
                          (r->mr_txnid.weak >= SAFE64_INVALID_THRESHOLD &&
                           head.txnid < env->me_lck->mti_oldest_reader.weak));
-        atomic_store32(&env->me_lck->mti_readers_refresh_flag, true,
-                       mo_AcquireRelease);
+        rslot_changed(env, r);
       } else {
         /* exclusive mode without lck */
         eASSERT(env, !env->me_lck_mmap.lck &&
@@ -8844,8 +9641,10 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
                 "metapages are too volatile");
           rc = MDBX_PROBLEM;
           txn->mt_txnid = INVALID_TXNID;
-          if (likely(r))
+          if (likely(r)) {
             safe64_reset(&r->mr_txnid, false);
+            rslot_changed(env, r);
+          }
           goto bailout;
         }
         timestamp = 0;
@@ -8860,16 +9659,21 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
 
       if (unlikely(rc != MDBX_RESULT_TRUE)) {
         txn->mt_txnid = INVALID_TXNID;
-        if (likely(r))
+        if (likely(r)) {
           safe64_reset(&r->mr_txnid, false);
+          rslot_changed(env, r);
+        }
         goto bailout;
       }
     }
 
+  snapshot_taken:
     if (unlikely(txn->mt_txnid < MIN_TXNID || txn->mt_txnid > MAX_TXNID)) {
       ERROR("%s", "environment corrupted by died writer, must shutdown!");
-      if (likely(r))
+      if (likely(r)) {
         safe64_reset(&r->mr_txnid, false);
+        rslot_changed(env, r);
+      }
       txn->mt_txnid = INVALID_TXNID;
       rc = MDBX_CORRUPTED;
       goto bailout;
@@ -8882,13 +9686,15 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
     txn->mt_numdbs = env->me_numdbs;
   } else {
     eASSERT(env, (flags & ~(MDBX_TXN_RW_BEGIN_FLAGS | MDBX_TXN_SPILLS |
-                            MDBX_WRITEMAP)) == 0);
+                            MDBX_WRITEMAP | MDBX_TXN_OPTIMISTIC)) == 0);
     if (unlikely(txn->mt_owner == tid ||
                  /* not recovery mode */ env->me_stuck_meta >= 0))
       return MDBX_BUSY;
     MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
+    /* the commit of an optimistic txn holds its snapshot intentionally */
     if (lck && (env->me_flags & MDBX_NOTLS) == 0 &&
-        (runtime_flags & MDBX_DBG_LEGACY_OVERLAP) == 0) {
+        (runtime_flags & MDBX_DBG_LEGACY_OVERLAP) == 0 &&
+        (flags & MDBX_TXN_OPTIMISTIC) == 0) {
       const size_t snap_nreaders =
           atomic_load32(&lck->mti_numreaders, mo_AcquireRelease);
       for (size_t i = 0; i < snap_nreaders; ++i) {
@@ -8939,10 +9745,13 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
       goto bailout;
     }
 
-    txn->mt_flags = flags;
+    txn->mt_flags = flags & ~MDBX_TXN_OPTIMISTIC;
     txn->mt_child = NULL;
     txn->tw.loose_pages = NULL;
     txn->tw.loose_count = 0;
+    txn->tw.streams = 0;
+    txn->tw.vlog.known = false;
+    txn->tw.vlog.deltas_count = 0;
 #if MDBX_ENABLE_REFUND
     txn->tw.loose_refund_wl = 0;
 #endif /* MDBX_ENABLE_REFUND */
@@ -8965,7 +9774,7 @@ static int txn_renew(MDBX_txn *txn, const unsigned flags) {
       if (unlikely(rc != MDBX_SUCCESS))
         goto bailout;
       txn->tw.dirtyroom = txn->mt_env->me_options.dp_limit;
-      txn->tw.dirtylru = MDBX_DEBUG ? UINT32_MAX / 3 - 42 : 0;
+      txn->tw.dirtylru = MDBX_DEBUG ? DP_LRU_MASK / 3 - 42 : 0;
     } else {
       tASSERT(txn, txn->tw.dirtylist == nullptr);
       txn->tw.dirtylist = nullptr;
@@ -9121,7 +9930,9 @@ static __always_inline int check_txn(const MDBX_txn *txn, int bad_bits) {
   STATIC_ASSERT(MDBX_NOTLS > MDBX_TXN_FINISHED + MDBX_TXN_RDONLY);
   if (unlikely(txn->mt_owner != osal_thread_self()) &&
       (txn->mt_flags & (MDBX_NOTLS | MDBX_TXN_FINISHED | MDBX_TXN_RDONLY)) <
-          (MDBX_TXN_FINISHED | MDBX_TXN_RDONLY))
+          (MDBX_TXN_FINISHED | MDBX_TXN_RDONLY) &&
+      /* a frozen txn may be read by any thread */
+      (txn->mt_flags & MDBX_TXN_FROZEN) == 0)
     return txn->mt_owner ? MDBX_THREAD_MISMATCH : MDBX_BAD_TXN;
 #endif /* MDBX_TXN_CHECKOWNER */
 
@@ -9136,7 +9947,7 @@ static __always_inline int check_txn_rw(const MDBX_txn *txn, int bad_bits) {
   if (unlikely(err))
     return err;
 
-  if (unlikely(txn->mt_flags & MDBX_TXN_RDONLY))
+  if (unlikely(txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN)))
     return MDBX_EACCESS;
 
   return MDBX_SUCCESS;
@@ -9159,7 +9970,7 @@ int mdbx_txn_renew(MDBX_txn *txn) {
       return rc;
   }
 
-  rc = txn_renew(txn, MDBX_TXN_RDONLY);
+  rc = txn_renew(txn, MDBX_TXN_RDONLY, nullptr);
   if (rc == MDBX_SUCCESS) {
     txn->mt_owner = osal_thread_self();
     DEBUG("renew txn %" PRIaTXN "%c %p on env %p, root page %" PRIaPGNO
@@ -9171,6 +9982,45 @@ int mdbx_txn_renew(MDBX_txn *txn) {
   return rc;
 }
 
+int mdbx_txn_clone(const MDBX_txn *origin, MDBX_txn **ret) {
+  if (unlikely(!ret))
+    return MDBX_EINVAL;
+  *ret = nullptr;
+
+  if (unlikely(!origin))
+    return MDBX_EINVAL;
+
+  if (unlikely(origin->mt_signature != MDBX_MT_SIGNATURE))
+    return MDBX_EBADSIGN;
+
+  if (unlikely((origin->mt_flags & MDBX_TXN_RDONLY) == 0))
+    return MDBX_EINVAL;
+
+  /* Владелец исходной транзакции не проверяется, так как клоны обычно
+   * создаются рабочими потоками, каждый из которых использует свой слот. */
+  if (unlikely(origin->mt_flags & MDBX_TXN_BLOCKED))
+    return MDBX_BAD_TXN;
+
+  MDBX_txn *txn;
+  int rc = mdbx_txn_begin_ex(origin->mt_env, nullptr, MDBX_TXN_RDONLY_PREPARE,
+                             &txn, nullptr);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  rc = txn_renew(txn, MDBX_TXN_RDONLY, origin);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    mdbx_txn_abort(txn);
+    return rc;
+  }
+
+  DEBUG("clone txn %" PRIaTXN "r %p from %p on env %p, root page %" PRIaPGNO
+        "/%" PRIaPGNO,
+        txn->mt_txnid, (void *)txn, (void *)origin, (void *)txn->mt_env,
+        txn->mt_dbs[MAIN_DBI].md_root, txn->mt_dbs[FREE_DBI].md_root);
+  *ret = txn;
+  return MDBX_SUCCESS;
+}
+
 #ifndef LIBMDBX_NO_EXPORTS_LEGACY_API
 int mdbx_txn_begin(MDBX_env *env, MDBX_txn *parent, MDBX_txn_flags_t flags,
                    MDBX_txn **ret) {
@@ -9191,6 +10041,30 @@ void *mdbx_txn_get_userctx(const MDBX_txn *txn) {
   return check_txn(txn, MDBX_TXN_FINISHED) ? nullptr : txn->mt_userctx;
 }
 
+/* Move loose pages to reclaimed list */
+static int txn_loose2relist(MDBX_txn *txn) {
+  if (txn->tw.loose_count) {
+    do {
+      MDBX_page *lp = txn->tw.loose_pages;
+      tASSERT(txn, lp->mp_flags == P_LOOSE);
+      int rc = pnl_insert_range(&txn->tw.relist, lp->mp_pgno, 1);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      MDBX_ASAN_UNPOISON_MEMORY_REGION(&mp_next(lp), sizeof(MDBX_page *));
+      VALGRIND_MAKE_MEM_DEFINED(&mp_next(lp), sizeof(MDBX_page *));
+      txn->tw.loose_pages = mp_next(lp);
+      /* Remove from dirty list */
+      page_wash(txn, dpl_exist(txn, lp->mp_pgno), lp, 1);
+    } while (txn->tw.loose_pages);
+    txn->tw.loose_count = 0;
+#if MDBX_ENABLE_REFUND
+    txn->tw.loose_refund_wl = 0;
+#endif /* MDBX_ENABLE_REFUND */
+    tASSERT(txn, dirtylist_check(txn));
+  }
+  return MDBX_SUCCESS;
+}
+
 int mdbx_txn_begin_ex(MDBX_env *env, MDBX_txn *parent, MDBX_txn_flags_t flags,
                       MDBX_txn **ret, void *context) {
   if (unlikely(!ret))
@@ -9214,8 +10088,8 @@ int mdbx_txn_begin_ex(MDBX_env *env, MDBX_txn *parent, MDBX_txn_flags_t flags,
   MDBX_txn *txn = nullptr;
   if (parent) {
     /* Nested transactions: Max 1 child, write txns only, no writemap */
-    rc = check_txn_rw(parent,
-                      MDBX_TXN_RDONLY | MDBX_WRITEMAP | MDBX_TXN_BLOCKED);
+    rc = check_txn_rw(parent, MDBX_TXN_RDONLY | MDBX_WRITEMAP |
+                                  MDBX_TXN_DISJOINT | MDBX_TXN_BLOCKED);
     if (unlikely(rc != MDBX_SUCCESS))
       return rc;
 
@@ -9287,26 +10161,9 @@ int mdbx_txn_begin_ex(MDBX_env *env, MDBX_txn *parent, MDBX_txn_flags_t flags,
       return rc;
     }
 
-    /* Move loose pages to reclaimed list */
-    if (parent->tw.loose_count) {
-      do {
-        MDBX_page *lp = parent->tw.loose_pages;
-        tASSERT(parent, lp->mp_flags == P_LOOSE);
-        rc = pnl_insert_range(&parent->tw.relist, lp->mp_pgno, 1);
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto nested_failed;
-        MDBX_ASAN_UNPOISON_MEMORY_REGION(&mp_next(lp), sizeof(MDBX_page *));
-        VALGRIND_MAKE_MEM_DEFINED(&mp_next(lp), sizeof(MDBX_page *));
-        parent->tw.loose_pages = mp_next(lp);
-        /* Remove from dirty list */
-        page_wash(parent, dpl_exist(parent, lp->mp_pgno), lp, 1);
-      } while (parent->tw.loose_pages);
-      parent->tw.loose_count = 0;
-#if MDBX_ENABLE_REFUND
-      parent->tw.loose_refund_wl = 0;
-#endif /* MDBX_ENABLE_REFUND */
-      tASSERT(parent, dirtylist_check(parent));
-    }
+    rc = txn_loose2relist(parent);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto nested_failed;
     txn->tw.dirtyroom = parent->tw.dirtyroom;
     txn->tw.dirtylru = parent->tw.dirtylru;
 
@@ -9341,6 +10198,8 @@ int mdbx_txn_begin_ex(MDBX_env *env, MDBX_txn *parent, MDBX_txn_flags_t flags,
 #if MDBX_ENABLE_REFUND
     txn->tw.loose_refund_wl = 0;
 #endif /* MDBX_ENABLE_REFUND */
+    txn->tw.vlog.known = parent->tw.vlog.known;
+    txn->tw.vlog.origin = txn->tw.vlog.tail = parent->tw.vlog.tail;
     txn->mt_canary = parent->mt_canary;
     parent->mt_flags |= MDBX_TXN_HAS_CHILD;
     parent->mt_child = txn;
@@ -9371,7 +10230,7 @@ int mdbx_txn_begin_ex(MDBX_env *env, MDBX_txn *parent, MDBX_txn_flags_t flags,
   } else { /* MDBX_TXN_RDONLY */
     txn->mt_dbiseqs = env->me_dbiseqs;
   renew:
-    rc = txn_renew(txn, flags);
+    rc = txn_renew(txn, flags, nullptr);
   }
 
   if (unlikely(rc != MDBX_SUCCESS)) {
@@ -9608,7 +10467,9 @@ static void dbi_import_locked(MDBX_txn *txn) {
 /* Import DBI which opened after txn started into context */
 __cold static bool dbi_import(MDBX_txn *txn, MDBX_dbi dbi) {
   if (dbi < CORE_DBS ||
-      (dbi >= txn->mt_numdbs && dbi >= txn->mt_env->me_numdbs))
+      (dbi >= txn->mt_numdbs && dbi >= txn->mt_env->me_numdbs) ||
+      /* the frozen txn is shared between threads */
+      (txn->mt_flags & MDBX_TXN_FROZEN))
     return false;
 
   ENSURE(txn->mt_env,
@@ -9765,9 +10626,17 @@ static int txn_end(MDBX_txn *txn, const unsigned mode) {
 
   if (!(mode & MDBX_END_EOTDONE)) /* !(already closed cursors) */
     cursors_eot(txn, false);
+  codec_release(txn);
+
+  if (unlikely(txn->mt_flags & MDBX_TXN_DISJOINT))
+    return disjoint_end(txn, false);
 
   int rc = MDBX_SUCCESS;
   if (txn->mt_flags & MDBX_TXN_RDONLY) {
+    if (txn->mt_flags & MDBX_TXN_OPTIMISTIC) {
+      oplog_free(txn->to.oplog);
+      txn->to.oplog = nullptr;
+    }
     if (txn->to.reader) {
       MDBX_reader *slot = txn->to.reader;
       eASSERT(env, slot->mr_pid.weak == env->me_pid);
@@ -9783,15 +10652,14 @@ static int txn_end(MDBX_txn *txn, const unsigned mode) {
 #endif
         atomic_store32(&slot->mr_snapshot_pages_used, 0, mo_Relaxed);
         safe64_reset(&slot->mr_txnid, false);
-        atomic_store32(&env->me_lck->mti_readers_refresh_flag, true,
-                       mo_Relaxed);
+        rslot_changed(env, slot);
       } else {
         eASSERT(env, slot->mr_pid.weak == env->me_pid);
         eASSERT(env, slot->mr_txnid.weak >= SAFE64_INVALID_THRESHOLD);
       }
       if (mode & MDBX_END_SLOT) {
         if ((env->me_flags & MDBX_ENV_TXKEY) == 0)
-          atomic_store32(&slot->mr_pid, 0, mo_Relaxed);
+          rslot_release(env, slot);
         txn->to.reader = NULL;
       }
     }
@@ -9811,6 +10679,8 @@ static int txn_end(MDBX_txn *txn, const unsigned mode) {
       txn_valgrind(env, nullptr);
 #endif
 
+    vlog_end(txn, (mode & MDBX_END_OPMASK) == MDBX_END_COMMITTED ||
+                      (mode & MDBX_END_OPMASK) == MDBX_END_PURE_COMMIT);
     txn->mt_flags = MDBX_TXN_FINISHED;
     txn->mt_owner = 0;
     env->me_txn = txn->mt_parent;
@@ -9905,7 +10775,8 @@ int mdbx_txn_reset(MDBX_txn *txn) {
     return rc;
 
   /* This call is only valid for read-only txns */
-  if (unlikely((txn->mt_flags & MDBX_TXN_RDONLY) == 0))
+  if (unlikely((txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_OPTIMISTIC)) !=
+               MDBX_TXN_RDONLY))
     return MDBX_EINVAL;
 
   /* LY: don't close DBI-handles */
@@ -9917,6 +10788,67 @@ int mdbx_txn_reset(MDBX_txn *txn) {
   return rc;
 }
 
+/* Проверяет не заморожена ли пишущая транзакция или её вложенные */
+static bool txn_frozen(const MDBX_txn *txn) {
+  tASSERT(txn, (txn->mt_flags & MDBX_TXN_RDONLY) == 0);
+  do
+    if (unlikely(txn->mt_flags & MDBX_TXN_FROZEN))
+      return true;
+  while ((txn = txn->mt_child) != nullptr);
+  return false;
+}
+
+int mdbx_txn_freeze(MDBX_txn *txn) {
+  int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(txn->mt_flags & (MDBX_TXN_DISJOINT | MDBX_TXN_OPTIMISTIC)))
+    return MDBX_INCOMPATIBLE;
+
+  if (unlikely(txn == txn->mt_env->me_txn0 &&
+               atomic_load32(&txn->mt_env->me_disjoint.active,
+                             mo_AcquireRelease)))
+    return MDBX_BUSY;
+
+  /* Подготовка к чтению из других потоков: все используемые при чтении
+   * структуры не должны изменяться по ходу дела, т.е. списки грязных
+   * страниц должны быть отсортированы, а записи таблиц - загружены. */
+  for (size_t dbi = CORE_DBS; dbi < txn->mt_numdbs; ++dbi)
+    if ((txn->mt_dbistate[dbi] & (DBI_VALID | DBI_STALE)) ==
+        (DBI_VALID | DBI_STALE)) {
+      rc = fetch_sdb(txn, dbi);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+  if ((txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC)
+    for (MDBX_txn *scan = txn; scan; scan = scan->mt_parent)
+      dpl_sort(scan);
+
+  tASSERT(txn, atomic_load32(&txn->tw.views, mo_Relaxed) == 0);
+  txn->mt_flags |= MDBX_TXN_FROZEN;
+  osal_memory_barrier();
+  return MDBX_SUCCESS;
+}
+
+int mdbx_txn_thaw(MDBX_txn *txn) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely((txn->mt_flags & MDBX_TXN_FROZEN) == 0))
+    return MDBX_EINVAL;
+
+  if (unlikely(txn->mt_owner != osal_thread_self()))
+    return MDBX_THREAD_MISMATCH;
+
+  if (unlikely(atomic_load32(&txn->tw.views, mo_AcquireRelease)))
+    return MDBX_BUSY;
+
+  txn->mt_flags -= MDBX_TXN_FROZEN;
+  return MDBX_SUCCESS;
+}
+
 int mdbx_txn_break(MDBX_txn *txn) {
   do {
     int rc = check_txn(txn, 0);
@@ -9943,6 +10875,14 @@ int mdbx_txn_abort(MDBX_txn *txn) {
   if (unlikely(txn->mt_flags & MDBX_TXN_FINISHED))
     return MDBX_BAD_TXN;
 
+  if (unlikely(txn == txn->mt_env->me_txn0 &&
+               atomic_load32(&txn->mt_env->me_disjoint.active,
+                             mo_AcquireRelease)))
+    return MDBX_BUSY;
+
+  if (unlikely(txn_frozen(txn)))
+    return MDBX_BUSY;
+
   if (txn->mt_child)
     mdbx_txn_abort(txn->mt_child);
 
@@ -10001,7 +10941,7 @@ __cold static int audit_ex(MDBX_txn *txn, size_t retired_stored,
             (size_t)txn->mt_dbs[i].md_leaf_pages +
             (size_t)txn->mt_dbs[i].md_overflow_pages;
 
-    if (i != MAIN_DBI)
+    if (i != MAIN_DBI || (txn->mt_dbs[i].md_flags & MDBX_FIXEDSIZE))
       continue;
     rc = page_search(&cx.outer, NULL, MDBX_PS_FIRST);
     while (rc == MDBX_SUCCESS) {
@@ -11124,6 +12064,20 @@ static __always_inline bool check_dbi(MDBX_txn *txn, MDBX_dbi dbi,
   return dbi_import(txn, dbi);
 }
 
+/* Disjoint-транзакция может изменять только заявленные при старте таблицы */
+static __always_inline bool dbi_writable(const MDBX_txn *txn, size_t dbi) {
+  return likely((txn->mt_flags & MDBX_TXN_DISJOINT) == 0) ||
+         (txn->mt_dbistate[dbi] & DBI_OWNED) != 0;
+}
+
+/* Временная страница для cursor_put(), у параллельно работающих
+ * disjoint-транзакций она своя */
+static __always_inline MDBX_page *txn_scratch(const MDBX_txn *txn) {
+  return likely((txn->mt_flags & MDBX_TXN_DISJOINT) == 0)
+             ? txn->mt_env->me_pbuf
+             : txn->tw.scratch;
+}
+
 #ifndef LIBMDBX_NO_EXPORTS_LEGACY_API
 int mdbx_txn_commit(MDBX_txn *txn) { return __inline_mdbx_txn_commit(txn); }
 #endif /* LIBMDBX_NO_EXPORTS_LEGACY_API */
@@ -11514,9605 +12468,12384 @@ static void take_gcprof(MDBX_txn *txn, MDBX_commit_latency *latency) {
     memset(&latency->gc_prof, 0, sizeof(latency->gc_prof));
 }
 
-int mdbx_txn_commit_ex(MDBX_txn *txn, MDBX_commit_latency *latency) {
-  STATIC_ASSERT(MDBX_TXN_FINISHED ==
-                MDBX_TXN_BLOCKED - MDBX_TXN_HAS_CHILD - MDBX_TXN_ERROR);
-  const uint64_t ts_0 = latency ? osal_monotime() : 0;
-  uint64_t ts_1 = 0, ts_2 = 0, ts_3 = 0, ts_4 = 0, ts_5 = 0, gc_cputime = 0;
-
-  int rc = check_txn(txn, MDBX_TXN_FINISHED);
-  if (unlikely(rc != MDBX_SUCCESS)) {
-    if (latency)
-      memset(latency, 0, sizeof(*latency));
-    return rc;
-  }
+/*----------------------------------------------------------------------------*/
+/* Disjoint write transactions */
 
-  MDBX_env *const env = txn->mt_env;
-#if MDBX_ENV_CHECKPID
-  if (unlikely(env->me_pid != osal_getpid())) {
-    env->me_flags |= MDBX_FATAL_ERROR;
-    if (latency)
-      memset(latency, 0, sizeof(*latency));
-    return MDBX_PANIC;
+static void disjoint_free(MDBX_txn *txn) {
+  dpl_free(txn);
+  pnl_free(txn->tw.relist);
+  pnl_free(txn->tw.retired_pages);
+  osal_free(txn->tw.scratch);
+  txn->mt_signature = 0;
+  osal_free(txn);
+}
+
+/* Слияние зафиксированной disjoint-транзакции с родителем. Выполняется под
+ * me_disjoint.lock, когда все параллельные disjoint-транзакции уже завершены
+ * и родитель больше никем не читается. По сути повторяет фиксацию вложенной
+ * транзакции, но relist/retired/loose списки сливаются, а не заменяются,
+ * а таблицы переносятся только заявленные при старте. */
+static int disjoint_merge(MDBX_txn *const parent, MDBX_txn *const txn) {
+  tASSERT(txn, txn->mt_parent == parent && !txn->tw.spilled.list);
+  MDBX_dpl *const dl = dpl_sort(txn);
+  int rc = MDBX_SUCCESS;
+  if (parent->tw.dirtyroom < dl->length) {
+    rc = txn_spill(parent, nullptr, dl->length);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (unlikely(parent->tw.dirtyroom < dl->length))
+      return MDBX_TXN_FULL;
   }
-#endif /* MDBX_ENV_CHECKPID */
+  txn->tw.dirtyroom = parent->tw.dirtyroom - dl->length;
 
-  if (unlikely(txn->mt_flags & MDBX_TXN_ERROR)) {
-    rc = MDBX_RESULT_TRUE;
-    goto fail;
-  }
+  /* Preserve space to avoid parent's state corruption if allocation fails */
+  if (unlikely(dl->length + parent->tw.dirtylist->length >
+                   parent->tw.dirtylist->detent &&
+               !dpl_reserve(parent,
+                            dl->length + parent->tw.dirtylist->length)))
+    return MDBX_ENOMEM;
+  const size_t retired_len = MDBX_PNL_GETSIZE(txn->tw.retired_pages);
+  rc = pnl_need(&parent->tw.relist,
+                MDBX_PNL_GETSIZE(txn->tw.relist) + retired_len);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = pnl_need(&parent->tw.retired_pages, retired_len);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  /* txn_end() mode for a commit which writes nothing */
-  unsigned end_mode =
-      MDBX_END_PURE_COMMIT | MDBX_END_UPDATE | MDBX_END_SLOT | MDBX_END_FREE;
-  if (unlikely(txn->mt_flags & MDBX_TXN_RDONLY))
-    goto done;
+  //-------------------------------------------------------------------------
 
-  if (txn->mt_child) {
-    rc = mdbx_txn_commit_ex(txn->mt_child, NULL);
-    tASSERT(txn, txn->mt_child == NULL);
-    if (unlikely(rc != MDBX_SUCCESS))
-      goto fail;
+  const size_t parent_retired_len = MDBX_PNL_GETSIZE(parent->tw.retired_pages);
+  if (retired_len) {
+    memcpy(MDBX_PNL_END(parent->tw.retired_pages),
+           MDBX_PNL_BEGIN(txn->tw.retired_pages), retired_len * sizeof(pgno_t));
+    MDBX_PNL_SETSIZE(parent->tw.retired_pages,
+                     parent_retired_len + retired_len);
   }
+  pnl_merge(parent->tw.relist, txn->tw.relist);
 
-  if (unlikely(txn != env->me_txn)) {
-    DEBUG("%s", "attempt to commit unknown transaction");
-    rc = MDBX_EINVAL;
-    goto fail;
+  /* Move loose pages to parent */
+  if (txn->tw.loose_pages) {
+    MDBX_page *lp = txn->tw.loose_pages;
+    while (true) {
+      MDBX_ASAN_UNPOISON_MEMORY_REGION(&mp_next(lp), sizeof(MDBX_page *));
+      VALGRIND_MAKE_MEM_DEFINED(&mp_next(lp), sizeof(MDBX_page *));
+      if (!mp_next(lp))
+        break;
+      lp = mp_next(lp);
+    }
+    mp_next(lp) = parent->tw.loose_pages;
+    parent->tw.loose_pages = txn->tw.loose_pages;
+    parent->tw.loose_count += txn->tw.loose_count;
+#if MDBX_ENABLE_REFUND
+    if (parent->tw.loose_refund_wl < txn->tw.loose_refund_wl)
+      parent->tw.loose_refund_wl = txn->tw.loose_refund_wl;
+#endif /* MDBX_ENABLE_REFUND */
   }
 
-  if (txn->mt_parent) {
-    tASSERT(txn, audit_ex(txn, 0, false) == 0);
-    eASSERT(env, txn != env->me_txn0);
-    MDBX_txn *const parent = txn->mt_parent;
-    eASSERT(env, parent->mt_signature == MDBX_MT_SIGNATURE);
-    eASSERT(env, parent->mt_child == txn &&
-                     (parent->mt_flags & MDBX_TXN_HAS_CHILD) != 0);
-    eASSERT(env, dirtylist_check(txn));
+  /* Update parent's records of the owned DBs */
+  for (size_t i = MAIN_DBI; i < txn->mt_numdbs; ++i)
+    if (txn->mt_dbistate[i] & DBI_OWNED) {
+      tASSERT(txn, i < parent->mt_numdbs &&
+                       (parent->mt_dbistate[i] & DBI_OWNED) != 0);
+      parent->mt_dbs[i] = txn->mt_dbs[i];
+      parent->mt_dbistate[i] =
+          (txn->mt_dbistate[i] & ~DBI_OWNED) |
+          (parent->mt_dbistate[i] & (DBI_CREAT | DBI_FRESH | DBI_DIRTY));
+    }
+  parent->mt_flags |= txn->mt_flags & MDBX_TXN_DIRTY;
 
-    if (txn->tw.dirtylist->length == 0 && !(txn->mt_flags & MDBX_TXN_DIRTY) &&
-        parent->mt_numdbs == txn->mt_numdbs) {
-      for (int i = txn->mt_numdbs; --i >= 0;) {
-        tASSERT(txn, (txn->mt_dbistate[i] & DBI_DIRTY) == 0);
-        if ((txn->mt_dbistate[i] & DBI_STALE) &&
-            !(parent->mt_dbistate[i] & DBI_STALE))
-          tASSERT(txn, memcmp(&parent->mt_dbs[i], &txn->mt_dbs[i],
-                              sizeof(MDBX_db)) == 0);
-      }
+  /* Счетчики LRU родителя и участника ведутся независимо, а txn_merge()
+   * наследует счетчик дочерней транзакции, поэтому берем наибольший. */
+  if (txn->tw.dirtylru < parent->tw.dirtylru)
+    txn->tw.dirtylru = parent->tw.dirtylru;
+  txn_merge(parent, txn, parent_retired_len);
+  tASSERT(parent, dirtylist_check(parent));
+  disjoint_free(txn);
+  return MDBX_SUCCESS;
+}
 
-      tASSERT(txn, memcmp(&parent->mt_geo, &txn->mt_geo,
-                          sizeof(parent->mt_geo)) == 0);
-      tASSERT(txn, memcmp(&parent->mt_canary, &txn->mt_canary,
-                          sizeof(parent->mt_canary)) == 0);
-      tASSERT(txn, !txn->tw.spilled.list ||
-                       MDBX_PNL_GETSIZE(txn->tw.spilled.list) == 0);
-      tASSERT(txn, txn->tw.loose_count == 0);
+/* Завершение disjoint-транзакции. При фиксации транзакция только паркуется,
+ * так как слияние с родителем изменяет его списки страниц, которые читают
+ * остальные параллельно работающие disjoint-транзакции. Поэтому слияние всех
+ * запаркованных транзакций выполняет последняя завершающаяся из них. */
+static int disjoint_end(MDBX_txn *txn, bool commit) {
+  MDBX_env *const env = txn->mt_env;
+  MDBX_txn *const parent = txn->mt_parent;
+  tASSERT(txn, (txn->mt_flags & MDBX_TXN_DISJOINT) && parent == env->me_txn0);
+  if (commit) {
+    cursors_eot(txn, false);
+    dpl_sort(txn);
+  }
 
-      /* fast completion of pure nested transaction */
-      end_mode = MDBX_END_PURE_COMMIT | MDBX_END_SLOT | MDBX_END_FREE;
-      goto done;
+  ENSURE(env, osal_fastmutex_acquire(&env->me_disjoint.lock) == MDBX_SUCCESS);
+  int rc = MDBX_SUCCESS;
+  txn->mt_owner = 0;
+  if (commit) {
+    txn->mt_child = env->me_disjoint.parked;
+    env->me_disjoint.parked = txn;
+  } else {
+    /* Return the pages allocated for this txn to the parent, except the
+     * parent's dirty and spilled pages which were shadowed here. */
+    const MDBX_dpl *const dl = txn->tw.dirtylist;
+    size_t w = 0;
+    for (size_t r = 1; r <= MDBX_PNL_GETSIZE(txn->tw.relist); ++r) {
+      const pgno_t pgno = txn->tw.relist[r];
+      if (!dpl_exist(parent, pgno) && !search_spilled(parent, pgno))
+        txn->tw.relist[++w] = pgno;
+    }
+    MDBX_PNL_SETSIZE(txn->tw.relist, w);
+    for (size_t i = 1; rc == MDBX_SUCCESS && i <= dl->length; ++i) {
+      const pgno_t pgno = dl->items[i].pgno;
+      if (!dpl_exist(parent, pgno) && !search_spilled(parent, pgno))
+        rc = pnl_append_range(false, &txn->tw.relist, pgno,
+                              dpl_npages(dl, i));
     }
-
-    /* Preserve space for spill list to avoid parent's state corruption
-     * if allocation fails. */
-    const size_t parent_retired_len = (uintptr_t)parent->tw.retired_pages;
-    tASSERT(txn, parent_retired_len <= MDBX_PNL_GETSIZE(txn->tw.retired_pages));
-    const size_t retired_delta =
-        MDBX_PNL_GETSIZE(txn->tw.retired_pages) - parent_retired_len;
-    if (retired_delta) {
-      rc = pnl_need(&txn->tw.relist, retired_delta);
-      if (unlikely(rc != MDBX_SUCCESS))
-        goto fail;
+    if (likely(rc == MDBX_SUCCESS)) {
+      pnl_sort(txn->tw.relist, parent->mt_next_pgno);
+      rc = pnl_need(&parent->tw.relist, MDBX_PNL_GETSIZE(txn->tw.relist));
+      if (likely(rc == MDBX_SUCCESS))
+        pnl_merge(parent->tw.relist, txn->tw.relist);
     }
-
-    if (txn->tw.spilled.list) {
-      if (parent->tw.spilled.list) {
-        rc = pnl_need(&parent->tw.spilled.list,
-                      MDBX_PNL_GETSIZE(txn->tw.spilled.list));
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto fail;
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      ERROR("error %d while returning pages of disjoint txn, fail the parent",
+            rc);
+      parent->mt_flags |= MDBX_TXN_ERROR;
+    }
+    for (size_t i = MAIN_DBI; i < txn->mt_numdbs; ++i)
+      if (txn->mt_dbistate[i] & DBI_OWNED)
+        parent->mt_dbistate[i] &= ~DBI_OWNED;
+    dlist_free(txn);
+    disjoint_free(txn);
+  }
+
+  if (atomic_load32(&env->me_disjoint.active, mo_Relaxed) == 1) {
+    /* the last running one, so merge all parked */
+    MDBX_txn *next = env->me_disjoint.parked;
+    env->me_disjoint.parked = nullptr;
+    while (next) {
+      MDBX_txn *const parked = next;
+      next = parked->mt_child;
+      parked->mt_child = nullptr;
+      int err = (parent->mt_flags & MDBX_TXN_ERROR)
+                    ? MDBX_BAD_TXN
+                    : disjoint_merge(parent, parked);
+      if (unlikely(err != MDBX_SUCCESS)) {
+        ERROR("error %d while merge disjoint txn, fail the parent", err);
+        parent->mt_flags |= MDBX_TXN_ERROR;
+        for (size_t i = MAIN_DBI; i < parked->mt_numdbs; ++i)
+          if (parked->mt_dbistate[i] & DBI_OWNED)
+            parent->mt_dbistate[i] &= ~DBI_OWNED;
+        dlist_free(parked);
+        disjoint_free(parked);
+        if (commit && rc == MDBX_SUCCESS)
+          rc = err;
       }
-      spill_purge(txn);
     }
-
-    if (unlikely(txn->tw.dirtylist->length + parent->tw.dirtylist->length >
-                     parent->tw.dirtylist->detent &&
-                 !dpl_reserve(parent, txn->tw.dirtylist->length +
-                                          parent->tw.dirtylist->length))) {
-      rc = MDBX_ENOMEM;
-      goto fail;
+    parent->mt_flags &= ~MDBX_TXN_HAS_CHILD;
+    if (likely((parent->mt_flags & MDBX_TXN_ERROR) == 0)) {
+#if MDBX_ENABLE_REFUND
+      txn_refund(parent);
+#endif /* MDBX_ENABLE_REFUND */
+      tASSERT(parent, dirtylist_check(parent));
+      tASSERT(parent, audit_ex(parent, 0, false) == 0);
     }
+  }
+  atomic_sub32(&env->me_disjoint.active, 1);
+  ENSURE(env, osal_fastmutex_release(&env->me_disjoint.lock) == MDBX_SUCCESS);
+  return rc;
+}
 
-    //-------------------------------------------------------------------------
-
-    parent->tw.lifo_reclaimed = txn->tw.lifo_reclaimed;
-    txn->tw.lifo_reclaimed = NULL;
-
-    parent->tw.retired_pages = txn->tw.retired_pages;
-    txn->tw.retired_pages = NULL;
-
-    pnl_free(parent->tw.relist);
-    parent->tw.relist = txn->tw.relist;
-    txn->tw.relist = NULL;
-    parent->tw.last_reclaimed = txn->tw.last_reclaimed;
+int mdbx_txn_begin_disjoint(MDBX_txn *parent, const MDBX_dbi *dbis,
+                            size_t count, MDBX_txn_flags_t flags,
+                            MDBX_txn **ret) {
+  if (unlikely(!ret))
+    return MDBX_EINVAL;
+  *ret = nullptr;
 
-    parent->mt_geo = txn->mt_geo;
-    parent->mt_canary = txn->mt_canary;
-    parent->mt_flags |= txn->mt_flags & MDBX_TXN_DIRTY;
+  if (unlikely(!parent || !dbis || !count || flags != MDBX_TXN_READWRITE))
+    return MDBX_EINVAL;
+  if (unlikely(parent->mt_signature != MDBX_MT_SIGNATURE))
+    return MDBX_EBADSIGN;
 
-    /* Move loose pages to parent */
-#if MDBX_ENABLE_REFUND
-    parent->tw.loose_refund_wl = txn->tw.loose_refund_wl;
-#endif /* MDBX_ENABLE_REFUND */
-    parent->tw.loose_count = txn->tw.loose_count;
-    parent->tw.loose_pages = txn->tw.loose_pages;
+  MDBX_env *const env = parent->mt_env;
+  int rc = check_env(env, true);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely(parent != env->me_txn0))
+    return MDBX_BAD_TXN;
+  if (unlikely(env->me_flags & MDBX_WRITEMAP))
+    return MDBX_INCOMPATIBLE;
 
-    /* Merge our cursors into parent's and close them */
-    cursors_eot(txn, true);
-    end_mode |= MDBX_END_EOTDONE;
+  const size_t size =
+      sizeof(MDBX_txn) +
+      env->me_maxdbs * (sizeof(MDBX_db) + sizeof(MDBX_cursor *) + 1);
+  MDBX_txn *const txn = osal_malloc(size);
+  if (unlikely(txn == nullptr))
+    return MDBX_ENOMEM;
+  memset(txn, 0, size);
+  txn->mt_dbs = ptr_disp(txn, sizeof(MDBX_txn));
+  txn->mt_cursors = ptr_disp(txn->mt_dbs, sizeof(MDBX_db) * env->me_maxdbs);
+  txn->mt_dbistate = ptr_disp(txn, size - env->me_maxdbs);
+  txn->mt_dbxs = env->me_dbxs; /* static */
+  txn->mt_flags = MDBX_TXN_DISJOINT;
+  txn->mt_env = env;
+  txn->mt_geo = parent->mt_geo;
+  rc = dpl_alloc(txn);
+  if (likely(rc == MDBX_SUCCESS)) {
+    txn->tw.relist = pnl_alloc(MDBX_PNL_INITIAL);
+    txn->tw.retired_pages = pnl_alloc(MDBX_PNL_INITIAL);
+    txn->tw.scratch = osal_malloc(env->me_psize);
+    if (unlikely(!txn->tw.relist || !txn->tw.retired_pages ||
+                 !txn->tw.scratch))
+      rc = MDBX_ENOMEM;
+  }
+  if (unlikely(rc != MDBX_SUCCESS)) {
+  bailout:
+    disjoint_free(txn);
+    return rc;
+  }
 
-    /* Update parent's DBs array */
-    memcpy(parent->mt_dbs, txn->mt_dbs, txn->mt_numdbs * sizeof(MDBX_db));
-    parent->mt_numdbs = txn->mt_numdbs;
-    for (size_t i = 0; i < txn->mt_numdbs; i++) {
-      /* preserve parent's status */
-      const uint8_t state =
-          txn->mt_dbistate[i] |
-          (parent->mt_dbistate[i] & (DBI_CREAT | DBI_FRESH | DBI_DIRTY));
-      DEBUG("dbi %zu dbi-state %s 0x%02x -> 0x%02x", i,
-            (parent->mt_dbistate[i] != state) ? "update" : "still",
-            parent->mt_dbistate[i], state);
-      parent->mt_dbistate[i] = state;
-    }
+  rc = osal_fastmutex_acquire(&env->me_disjoint.lock);
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto bailout;
 
-    if (latency) {
-      ts_1 = osal_monotime();
-      ts_2 = /* no gc-update */ ts_1;
-      ts_3 = /* no audit */ ts_2;
-      ts_4 = /* no write */ ts_3;
-      ts_5 = /* no sync */ ts_4;
+  size_t i = 0;
+  if (unlikely(parent != env->me_txn || parent->mt_child ||
+               (parent->mt_flags &
+                (MDBX_TXN_FINISHED | MDBX_TXN_ERROR | MDBX_TXN_FROZEN))))
+    rc = MDBX_BAD_TXN;
+  else
+    for (; i < count; ++i) {
+      const MDBX_dbi dbi = dbis[i];
+      rc = MDBX_EINVAL;
+      if (unlikely(dbi < MAIN_DBI))
+        break;
+      rc = MDBX_BAD_DBI;
+      if (unlikely(!check_dbi(parent, dbi, DBI_USRVALID)))
+        break;
+      /* the table is held by another disjoint txn or used by cursor(s) */
+      rc = MDBX_BUSY;
+      if (unlikely((parent->mt_dbistate[dbi] & DBI_OWNED) ||
+                   parent->mt_cursors[dbi]))
+        break;
+      rc = MDBX_SUCCESS;
+      parent->mt_dbistate[dbi] |= DBI_OWNED;
     }
-    txn_merge(parent, txn, parent_retired_len);
-    env->me_txn = parent;
-    parent->mt_child = NULL;
-    tASSERT(parent, dirtylist_check(parent));
 
-#if MDBX_ENABLE_REFUND
-    txn_refund(parent);
-    if (ASSERT_ENABLED()) {
-      /* Check parent's loose pages not suitable for refund */
-      for (MDBX_page *lp = parent->tw.loose_pages; lp; lp = mp_next(lp)) {
-        tASSERT(parent, lp->mp_pgno < parent->tw.loose_refund_wl &&
-                            lp->mp_pgno + 1 < parent->mt_next_pgno);
-        MDBX_ASAN_UNPOISON_MEMORY_REGION(&mp_next(lp), sizeof(MDBX_page *));
-        VALGRIND_MAKE_MEM_DEFINED(&mp_next(lp), sizeof(MDBX_page *));
-      }
-      /* Check parent's reclaimed pages not suitable for refund */
-      if (MDBX_PNL_GETSIZE(parent->tw.relist))
-        tASSERT(parent,
-                MDBX_PNL_MOST(parent->tw.relist) + 1 < parent->mt_next_pgno);
+  if (likely(rc == MDBX_SUCCESS) &&
+      atomic_load32(&env->me_disjoint.active, mo_Relaxed) == 0) {
+    /* Since now the parent's dirty and spilled lists are shared read-only,
+     * and the reclaimed list is the arena for disjoint txns. */
+    rc = txn_loose2relist(parent);
+    if (likely(rc == MDBX_SUCCESS)) {
+      dpl_sort(parent);
+      if (parent->tw.spilled.list)
+        spill_purge(parent);
     }
-#endif /* MDBX_ENABLE_REFUND */
-
-    txn->mt_signature = 0;
-    osal_free(txn);
-    tASSERT(parent, audit_ex(parent, 0, false) == 0);
-    rc = MDBX_SUCCESS;
-    goto provide_latency;
   }
 
-  if (!txn->tw.dirtylist) {
-    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) != 0 && !MDBX_AVOID_MSYNC);
-  } else {
-    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
-    tASSERT(txn, txn->tw.dirtyroom + txn->tw.dirtylist->length ==
-                     (txn->mt_parent ? txn->mt_parent->tw.dirtyroom
-                                     : txn->mt_env->me_options.dp_limit));
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    while (i > 0)
+      parent->mt_dbistate[dbis[--i]] &= ~DBI_OWNED;
+    ENSURE(env, osal_fastmutex_release(&env->me_disjoint.lock) == MDBX_SUCCESS);
+    goto bailout;
   }
-  cursors_eot(txn, false);
-  end_mode |= MDBX_END_EOTDONE;
 
-  if ((!txn->tw.dirtylist || txn->tw.dirtylist->length == 0) &&
-      (txn->mt_flags & (MDBX_TXN_DIRTY | MDBX_TXN_SPILLS)) == 0) {
-    for (intptr_t i = txn->mt_numdbs; --i >= 0;)
-      tASSERT(txn, (txn->mt_dbistate[i] & DBI_DIRTY) == 0);
-#if defined(MDBX_NOSUCCESS_EMPTY_COMMIT) && MDBX_NOSUCCESS_EMPTY_COMMIT
-    rc = txn_end(txn, end_mode);
-    if (unlikely(rc != MDBX_SUCCESS))
-      goto fail;
-    rc = MDBX_RESULT_TRUE;
-    goto provide_latency;
-#else
-    goto done;
-#endif /* MDBX_NOSUCCESS_EMPTY_COMMIT */
+  txn->mt_flags |=
+      parent->mt_flags & (MDBX_TXN_RW_BEGIN_FLAGS | MDBX_TXN_SPILLS);
+  txn->mt_dbiseqs = parent->mt_dbiseqs;
+  txn->mt_txnid = parent->mt_txnid;
+  txn->mt_front = parent->mt_front + 1;
+  txn->mt_parent = parent;
+  txn->mt_owner = osal_thread_self();
+  /* see the comment in disjoint_carve() */
+  txn->mt_next_pgno = parent->mt_next_pgno + MDBX_ENABLE_REFUND;
+  txn->mt_end_pgno = parent->mt_end_pgno;
+  txn->mt_canary = parent->mt_canary;
+  txn->tw.troika = parent->tw.troika;
+  txn->tw.last_reclaimed = parent->tw.last_reclaimed;
+  txn->tw.dirtyroom = parent->tw.dirtyroom;
+  txn->tw.dirtylru = parent->tw.dirtylru;
+  txn->mt_numdbs = parent->mt_numdbs;
+  memcpy(txn->mt_dbs, parent->mt_dbs, txn->mt_numdbs * sizeof(MDBX_db));
+  /* Copy parent's mt_dbistate, but clear DB_NEW and ownership */
+  for (i = 0; i < txn->mt_numdbs; i++)
+    txn->mt_dbistate[i] = parent->mt_dbistate[i] &
+                          ~(DBI_FRESH | DBI_CREAT | DBI_DIRTY | DBI_OWNED);
+  for (i = 0; i < count; i++)
+    txn->mt_dbistate[dbis[i]] |= DBI_OWNED;
+
+  parent->mt_flags |= MDBX_TXN_HAS_CHILD;
+  atomic_add32(&env->me_disjoint.active, 1);
+  ENSURE(env, osal_fastmutex_release(&env->me_disjoint.lock) == MDBX_SUCCESS);
+
+  txn->mt_signature = MDBX_MT_SIGNATURE;
+  tASSERT(txn, dirtylist_check(txn));
+  *ret = txn;
+  DEBUG("begin disjoint txn %" PRIaTXN "%c %p on mdbenv %p, %zu table(s)",
+        txn->mt_txnid, 'w', (void *)txn, (void *)env, count);
+  return MDBX_SUCCESS;
+}
+
+/* Optimistic write transactions */
+
+typedef enum oplog_op { OPLOG_READ, OPLOG_PUT, OPLOG_DEL } oplog_op_t;
+
+typedef struct oplog_item {
+  MDBX_val key, data;
+  MDBX_dbi dbi;
+  /* для чтений: листовая страница, на которой завершился поиск ключа */
+  pgno_t leaf;
+  oplog_op_t op;
+} oplog_item_t;
+
+typedef struct oplog_list {
+  size_t count, limit;
+  oplog_item_t **items;
+} oplog_list_t;
+
+struct MDBX_oplog {
+  MDBX_txn_flags_t flags; /* флаги для итоговой пишущей транзакции */
+  oplog_list_t reads, writes;
+};
+
+static void oplog_free(struct MDBX_oplog *log) {
+  for (size_t i = 0; i < log->reads.count; ++i)
+    osal_free(log->reads.items[i]);
+  osal_free(log->reads.items);
+  for (size_t i = 0; i < log->writes.count; ++i)
+    osal_free(log->writes.items[i]);
+  osal_free(log->writes.items);
+  osal_free(log);
+}
+
+static int oplog_push(oplog_list_t *list, MDBX_dbi dbi, oplog_op_t op,
+                      const MDBX_val *key, const MDBX_val *data, pgno_t leaf) {
+  if (unlikely(list->count == list->limit)) {
+    const size_t limit = list->limit ? list->limit * 2 : 64;
+    oplog_item_t **const items =
+        osal_realloc(list->items, limit * sizeof(oplog_item_t *));
+    if (unlikely(!items))
+      return MDBX_ENOMEM;
+    list->items = items;
+    list->limit = limit;
   }
 
-  DEBUG("committing txn %" PRIaTXN " %p on mdbenv %p, root page %" PRIaPGNO
-        "/%" PRIaPGNO,
-        txn->mt_txnid, (void *)txn, (void *)env, txn->mt_dbs[MAIN_DBI].md_root,
-        txn->mt_dbs[FREE_DBI].md_root);
+  const size_t dlen = data ? data->iov_len : 0;
+  oplog_item_t *const item =
+      osal_malloc(sizeof(oplog_item_t) + key->iov_len + dlen);
+  if (unlikely(!item))
+    return MDBX_ENOMEM;
+  item->key.iov_base = ptr_disp(item, sizeof(oplog_item_t));
+  item->key.iov_len = key->iov_len;
+  if (key->iov_len)
+    memcpy(item->key.iov_base, key->iov_base, key->iov_len);
+  item->data.iov_base = ptr_disp(item->key.iov_base, key->iov_len);
+  item->data.iov_len = dlen;
+  if (dlen)
+    memcpy(item->data.iov_base, data->iov_base, dlen);
+  item->dbi = dbi;
+  item->leaf = leaf;
+  item->op = op;
+  list->items[list->count++] = item;
+  return MDBX_SUCCESS;
+}
 
-  /* Update DB root pointers */
-  if (txn->mt_numdbs > CORE_DBS) {
-    MDBX_cursor_couple couple;
-    MDBX_val data;
-    data.iov_len = sizeof(MDBX_db);
+/* Поиск последнего изменения ключа среди отложенных изменений транзакции. */
+static const oplog_item_t *oplog_search(const MDBX_txn *txn, MDBX_dbi dbi,
+                                        const MDBX_val *key) {
+  const oplog_list_t *const writes = &txn->to.oplog->writes;
+  MDBX_val aligned_key = *key;
+  uint64_t aligned_keybytes;
+  if ((txn->mt_dbs[dbi].md_flags & MDBX_INTEGERKEY) &&
+      unlikely(1 & (uintptr_t)key->iov_base))
+    aligned_key.iov_base = memcpy(&aligned_keybytes, key->iov_base,
+                                  (key->iov_len > 8) ? 8 : key->iov_len);
 
-    rc = cursor_init(&couple.outer, txn, MAIN_DBI);
-    if (unlikely(rc != MDBX_SUCCESS))
-      goto fail;
-    for (MDBX_dbi i = CORE_DBS; i < txn->mt_numdbs; i++) {
-      if (txn->mt_dbistate[i] & DBI_DIRTY) {
-        MDBX_db *db = &txn->mt_dbs[i];
-        DEBUG("update main's entry for sub-db %u, mod_txnid %" PRIaTXN
-              " -> %" PRIaTXN,
-              i, db->md_mod_txnid, txn->mt_txnid);
-        /* Может быть mod_txnid > front после коммита вложенных тразакций */
-        db->md_mod_txnid = txn->mt_txnid;
-        data.iov_base = db;
-        WITH_CURSOR_TRACKING(
-            couple.outer,
-            rc = cursor_put_nochecklen(&couple.outer, &txn->mt_dbxs[i].md_name,
-                                       &data, F_SUBDATA));
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto fail;
-      }
-    }
+  MDBX_cmp_func *const cmp = txn->mt_dbxs[dbi].md_cmp;
+  for (size_t i = writes->count; i > 0; --i) {
+    const oplog_item_t *const item = writes->items[i - 1];
+    if (item->dbi == dbi && cmp(&aligned_key, &item->key) == 0)
+      return item;
   }
+  return nullptr;
+}
 
-  ts_1 = latency ? osal_monotime() : 0;
+/* Поиск ключа с получением номера листовой страницы, на которой он завершился.
+ * Пока снимок читается, его страницы не могут быть переиспользованы, поэтому
+ * совпадение номера листовой страницы означает неизменность ключа. */
+static int oplog_lookup(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                        MDBX_val *data, pgno_t *leaf) {
+  MDBX_cursor_couple cx;
+  int rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  rc = cursor_set(&cx.outer, (MDBX_val *)key, data, MDBX_SET).err;
+  *leaf = cx.outer.mc_snum ? cx.outer.mc_pg[cx.outer.mc_top]->mp_pgno
+                           : P_INVALID;
+  return unlikely(rc != MDBX_SUCCESS) ? rc : cursor_unpack(&cx.outer, data);
+}
 
-  gcu_context_t gcu_ctx;
-  gc_cputime = latency ? osal_cputime(nullptr) : 0;
-  rc = gcu_context_init(txn, &gcu_ctx);
+static int optimistic_check(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                            const MDBX_val *data) {
+  if (unlikely(txn->mt_dbs[dbi].md_flags & MDBX_DUPSORT))
+    return MDBX_INCOMPATIBLE;
+  if (unlikely(txn->mt_dbistate[dbi] & DBI_STALE)) {
+    int err = fetch_sdb(txn, dbi);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
+  }
+  const MDBX_dbx *const dbx = &txn->mt_dbxs[dbi];
+  if (unlikely(key->iov_len < dbx->md_klen_min ||
+               key->iov_len > dbx->md_klen_max))
+    return MDBX_BAD_VALSIZE;
+  if (data && unlikely(data->iov_len < dbx->md_vlen_min ||
+                       data->iov_len > dbx->md_vlen_max))
+    return MDBX_BAD_VALSIZE;
+  return MDBX_SUCCESS;
+}
+
+static int optimistic_get(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                          MDBX_val *data) {
+  int rc = optimistic_check(txn, dbi, key, nullptr);
   if (unlikely(rc != MDBX_SUCCESS))
-    goto fail;
-  rc = update_gc(txn, &gcu_ctx);
-  gc_cputime = latency ? osal_cputime(nullptr) - gc_cputime : 0;
+    return rc;
+
+  const oplog_item_t *const item = oplog_search(txn, dbi, key);
+  if (item) {
+    if (item->op == OPLOG_DEL)
+      return MDBX_NOTFOUND;
+    *data = item->data;
+    return MDBX_SUCCESS;
+  }
+
+  pgno_t leaf;
+  rc = oplog_lookup(txn, dbi, key, data, &leaf);
+  if (likely(rc == MDBX_SUCCESS || rc == MDBX_NOTFOUND)) {
+    const int err =
+        oplog_push(&txn->to.oplog->reads, dbi, OPLOG_READ, key, nullptr, leaf);
+    if (unlikely(err != MDBX_SUCCESS))
+      rc = err;
+  }
+  return rc;
+}
+
+static int optimistic_put(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                          MDBX_val *data, unsigned flags) {
+  if (unlikely(flags & ~MDBX_NOOVERWRITE))
+    return MDBX_INCOMPATIBLE;
+  int rc = optimistic_check(txn, dbi, key, data);
   if (unlikely(rc != MDBX_SUCCESS))
-    goto fail;
+    return rc;
 
-  tASSERT(txn, txn->tw.loose_count == 0);
-  txn->mt_dbs[FREE_DBI].md_mod_txnid = (txn->mt_dbistate[FREE_DBI] & DBI_DIRTY)
-                                           ? txn->mt_txnid
-                                           : txn->mt_dbs[FREE_DBI].md_mod_txnid;
+  if (flags & MDBX_NOOVERWRITE) {
+    MDBX_val present;
+    rc = optimistic_get(txn, dbi, key, &present);
+    if (rc == MDBX_SUCCESS) {
+      *data = present;
+      return MDBX_KEYEXIST;
+    }
+    if (unlikely(rc != MDBX_NOTFOUND))
+      return rc;
+  }
+  return oplog_push(&txn->to.oplog->writes, dbi, OPLOG_PUT, key, data,
+                    P_INVALID);
+}
 
-  txn->mt_dbs[MAIN_DBI].md_mod_txnid = (txn->mt_dbistate[MAIN_DBI] & DBI_DIRTY)
-                                           ? txn->mt_txnid
-                                           : txn->mt_dbs[MAIN_DBI].md_mod_txnid;
+static int optimistic_del(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                          const MDBX_val *data) {
+  MDBX_val present;
+  int rc = optimistic_get(txn, dbi, key, &present);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (data && (data->iov_len != present.iov_len ||
+               memcmp(data->iov_base, present.iov_base, data->iov_len)))
+    return MDBX_NOTFOUND;
+  return oplog_push(&txn->to.oplog->writes, dbi, OPLOG_DEL, key, nullptr,
+                    P_INVALID);
+}
+
+/* Проверка прочитанных транзакцией ключей относительно текущего состояния БД
+ * в пишущей транзакции, до внесения в неё каких-либо изменений. */
+static int optimistic_validate(MDBX_txn *txn, MDBX_txn *wtxn) {
+  const oplog_list_t *const reads = &txn->to.oplog->reads;
+  for (size_t i = 0; i < reads->count; ++i) {
+    const oplog_item_t *const item = reads->items[i];
+    if (unlikely(!check_dbi(wtxn, item->dbi, DBI_USRVALID)))
+      return MDBX_TXN_CONFLICT;
+
+    MDBX_val recent, origin;
+    pgno_t leaf;
+    int rc = oplog_lookup(wtxn, item->dbi, &item->key, &recent, &leaf);
+    if (unlikely(rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND))
+      return rc;
+    if (leaf == item->leaf)
+      continue;
 
-  ts_2 = latency ? osal_monotime() : 0;
-  ts_3 = ts_2;
-  if (AUDIT_ENABLED()) {
-    rc = audit_ex(txn, MDBX_PNL_GETSIZE(txn->tw.retired_pages), true);
-    ts_3 = osal_monotime();
-    if (unlikely(rc != MDBX_SUCCESS))
-      goto fail;
+    /* Листовая страница изменилась, но это ещё не означает изменения
+     * самого ключа, поэтому сравниваем со значением из снимка. */
+    int err = oplog_lookup(txn, item->dbi, &item->key, &origin, &leaf);
+    if (unlikely(err != MDBX_SUCCESS && err != MDBX_NOTFOUND))
+      return err;
+    if (rc != err)
+      return MDBX_TXN_CONFLICT;
+    if (rc == MDBX_SUCCESS &&
+        (recent.iov_len != origin.iov_len ||
+         memcmp(recent.iov_base, origin.iov_base, recent.iov_len)))
+      return MDBX_TXN_CONFLICT;
   }
+  return MDBX_SUCCESS;
+}
 
-  bool need_flush_for_nometasync = false;
-  const meta_ptr_t head = meta_recent(env, &txn->tw.troika);
-  const uint32_t meta_sync_txnid =
-      atomic_load32(&env->me_lck->mti_meta_sync_txnid, mo_Relaxed);
-  /* sync prev meta */
-  if (head.is_steady && meta_sync_txnid != (uint32_t)head.txnid) {
-    /* Исправление унаследованного от LMDB недочета:
-     *
-     * Всё хорошо, если все процессы работающие с БД не используют WRITEMAP.
-     * Тогда мета-страница (обновленная, но не сброшенная на диск) будет
-     * сохранена в результате fdatasync() при записи данных этой транзакции.
-     *
-     * Всё хорошо, если все процессы работающие с БД используют WRITEMAP
-     * без MDBX_AVOID_MSYNC.
-     * Тогда мета-страница (обновленная, но не сброшенная на диск) будет
-     * сохранена в результате msync() при записи данных этой транзакции.
-     *
-     * Если же в процессах работающих с БД используется оба метода, как sync()
-     * в режиме MDBX_WRITEMAP, так и записи через файловый дескриптор, то
-     * становится невозможным обеспечить фиксацию на диске мета-страницы
-     * предыдущей транзакции и данных текущей транзакции, за счет одной
-     * sync-операцией выполняемой после записи данных текущей транзакции.
-     * Соответственно, требуется явно обновлять мета-страницу, что полностью
-     * уничтожает выгоду от NOMETASYNC. */
-    const uint32_t txnid_dist =
-        ((txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC)
-            ? MDBX_NOMETASYNC_LAZY_FD
-            : MDBX_NOMETASYNC_LAZY_WRITEMAP;
-    /* Смысл "магии" в том, чтобы избежать отдельного вызова fdatasync()
-     * или msync() для гарантированной фиксации на диске мета-страницы,
-     * которая была "лениво" отправлена на запись в предыдущей транзакции,
-     * но не сброшена на диск из-за активного режима MDBX_NOMETASYNC. */
-    if (
-#if defined(_WIN32) || defined(_WIN64)
-        !env->me_overlapped_fd &&
-#endif
-        meta_sync_txnid == (uint32_t)head.txnid - txnid_dist)
-      need_flush_for_nometasync = true;
+/* Фиксация optimistic-транзакции: под блокировкой писателя проверяются
+ * прочитанные ключи и повторяются отложенные изменения. */
+static int optimistic_commit(MDBX_txn *txn, MDBX_commit_latency *latency) {
+  MDBX_env *const env = txn->mt_env;
+  const struct MDBX_oplog *const log = txn->to.oplog;
+  if (!log->writes.count) {
+    /* только чтение согласованного снимка, проверять нечего */
+    if (latency)
+      memset(latency, 0, sizeof(*latency));
+    return MDBX_SUCCESS;
+  }
+
+  MDBX_txn *const wtxn = env->me_txn0;
+  int rc = txn_renew(wtxn,
+                     log->flags | (env->me_flags & MDBX_WRITEMAP) |
+                         MDBX_TXN_OPTIMISTIC,
+                     nullptr);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    if (latency)
+      memset(latency, 0, sizeof(*latency));
+    return rc;
+  }
+  wtxn->mt_signature = MDBX_MT_SIGNATURE;
+  wtxn->mt_userctx = txn->mt_userctx;
+
+  /* Если после старта транзакции ничего не было зафиксировано,
+   * то прочитанные ключи заведомо не изменились. */
+  if (wtxn->mt_txnid != safe64_txnid_next(txn->mt_txnid))
+    rc = optimistic_validate(txn, wtxn);
+
+  for (size_t i = 0; rc == MDBX_SUCCESS && i < log->writes.count; ++i) {
+    oplog_item_t *const item = log->writes.items[i];
+    if (item->op == OPLOG_PUT)
+      rc = mdbx_put(wtxn, item->dbi, &item->key, &item->data, MDBX_UPSERT);
     else {
-      rc = meta_sync(env, head);
-      if (unlikely(rc != MDBX_SUCCESS)) {
-        ERROR("txn-%s: error %d", "presync-meta", rc);
-        goto fail;
-      }
+      rc = mdbx_del(wtxn, item->dbi, &item->key, nullptr);
+      if (rc == MDBX_NOTFOUND)
+        rc = MDBX_SUCCESS;
     }
   }
 
-  if (txn->tw.dirtylist) {
-    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
-    tASSERT(txn, txn->tw.loose_count == 0);
+  if (likely(rc == MDBX_SUCCESS))
+    return mdbx_txn_commit_ex(wtxn, latency);
 
-    mdbx_filehandle_t fd =
-#if defined(_WIN32) || defined(_WIN64)
-        env->me_overlapped_fd ? env->me_overlapped_fd : env->me_lazy_fd;
-    (void)need_flush_for_nometasync;
-#else
-#define MDBX_WRITETHROUGH_THRESHOLD_DEFAULT 2
-        (need_flush_for_nometasync ||
-         env->me_dsync_fd == INVALID_HANDLE_VALUE ||
-         txn->tw.dirtylist->length > env->me_options.writethrough_threshold ||
-         atomic_load64(&env->me_lck->mti_unsynced_pages, mo_Relaxed))
-            ? env->me_lazy_fd
-            : env->me_dsync_fd;
-#endif /* Windows */
+  DEBUG("optimistic txn %" PRIaTXN " %s, error %d", txn->mt_txnid,
+        (rc == MDBX_TXN_CONFLICT) ? "conflicted" : "failed", rc);
+  mdbx_txn_abort(wtxn);
+  if (latency)
+    memset(latency, 0, sizeof(*latency));
+  return rc;
+}
 
-    iov_ctx_t write_ctx;
-    rc = iov_init(txn, &write_ctx, txn->tw.dirtylist->length,
-                  txn->tw.dirtylist->pages_including_loose, fd, false);
-    if (unlikely(rc != MDBX_SUCCESS)) {
-      ERROR("txn-%s: error %d", "iov-init", rc);
-      goto fail;
-    }
+int mdbx_txn_begin_optimistic(MDBX_env *env, MDBX_txn_flags_t flags,
+                              MDBX_txn **ret) {
+  if (unlikely(!ret))
+    return MDBX_EINVAL;
+  *ret = NULL;
 
-    rc = txn_write(txn, &write_ctx);
-    if (unlikely(rc != MDBX_SUCCESS)) {
-      ERROR("txn-%s: error %d", "write", rc);
-      goto fail;
-    }
-  } else {
-    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) != 0 && !MDBX_AVOID_MSYNC);
-    env->me_lck->mti_unsynced_pages.weak += txn->tw.writemap_dirty_npages;
-    if (!env->me_lck->mti_eoos_timestamp.weak)
-      env->me_lck->mti_eoos_timestamp.weak = osal_monotime();
-  }
+  if (unlikely(flags & ~MDBX_TXN_RW_BEGIN_FLAGS))
+    return MDBX_EINVAL;
 
-  /* TODO: use ctx.flush_begin & ctx.flush_end for range-sync */
-  ts_4 = latency ? osal_monotime() : 0;
+  int rc = check_env(env, true);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  MDBX_meta meta;
-  memcpy(meta.mm_magic_and_version, head.ptr_c->mm_magic_and_version, 8);
-  meta.mm_extra_flags = head.ptr_c->mm_extra_flags;
-  meta.mm_validator_id = head.ptr_c->mm_validator_id;
-  meta.mm_extra_pagehdr = head.ptr_c->mm_extra_pagehdr;
-  unaligned_poke_u64(4, meta.mm_pages_retired,
-                     unaligned_peek_u64(4, head.ptr_c->mm_pages_retired) +
-                         MDBX_PNL_GETSIZE(txn->tw.retired_pages));
-  meta.mm_geo = txn->mt_geo;
-  meta.mm_dbs[FREE_DBI] = txn->mt_dbs[FREE_DBI];
-  meta.mm_dbs[MAIN_DBI] = txn->mt_dbs[MAIN_DBI];
-  meta.mm_canary = txn->mt_canary;
+  if (unlikely(env->me_flags & MDBX_RDONLY))
+    return MDBX_EACCESS;
 
-  txnid_t commit_txnid = txn->mt_txnid;
-#if MDBX_ENABLE_BIGFOOT
-  if (gcu_ctx.bigfoot > txn->mt_txnid) {
-    commit_txnid = gcu_ctx.bigfoot;
-    TRACE("use @%" PRIaTXN " (+%zu) for commit bigfoot-txn", commit_txnid,
-          (size_t)(commit_txnid - txn->mt_txnid));
+  struct MDBX_oplog *const log = osal_calloc(1, sizeof(struct MDBX_oplog));
+  if (unlikely(!log))
+    return MDBX_ENOMEM;
+  log->flags = flags;
+
+  MDBX_txn *txn;
+  rc = mdbx_txn_begin_ex(env, NULL, MDBX_TXN_RDONLY, &txn, NULL);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    osal_free(log);
+    return rc;
   }
-#endif
-  meta_set_txnid(env, &meta, commit_txnid);
+  txn->to.oplog = log;
+  txn->mt_flags |= MDBX_TXN_OPTIMISTIC;
+  *ret = txn;
+  DEBUG("begin optimistic txn %" PRIaTXN "%c %p on mdbenv %p", txn->mt_txnid,
+        'r', (void *)txn, (void *)env);
+  return MDBX_SUCCESS;
+}
 
-  rc = sync_locked(env, env->me_flags | txn->mt_flags | MDBX_SHRINK_ALLOWED,
-                   &meta, &txn->tw.troika);
+int mdbx_txn_commit_ex(MDBX_txn *txn, MDBX_commit_latency *latency) {
+  STATIC_ASSERT(MDBX_TXN_FINISHED ==
+                MDBX_TXN_BLOCKED - MDBX_TXN_HAS_CHILD - MDBX_TXN_ERROR);
+  const uint64_t ts_0 = latency ? osal_monotime() : 0;
+  uint64_t ts_1 = 0, ts_2 = 0, ts_3 = 0, ts_4 = 0, ts_5 = 0, gc_cputime = 0;
 
-  ts_5 = latency ? osal_monotime() : 0;
+  int rc = check_txn(txn, MDBX_TXN_FINISHED);
   if (unlikely(rc != MDBX_SUCCESS)) {
-    env->me_flags |= MDBX_FATAL_ERROR;
-    ERROR("txn-%s: error %d", "sync", rc);
-    goto fail;
+    if (latency)
+      memset(latency, 0, sizeof(*latency));
+    return rc;
   }
 
-  end_mode = MDBX_END_COMMITTED | MDBX_END_UPDATE | MDBX_END_EOTDONE;
+  MDBX_env *const env = txn->mt_env;
+#if MDBX_ENV_CHECKPID
+  if (unlikely(env->me_pid != osal_getpid())) {
+    env->me_flags |= MDBX_FATAL_ERROR;
+    if (latency)
+      memset(latency, 0, sizeof(*latency));
+    return MDBX_PANIC;
+  }
+#endif /* MDBX_ENV_CHECKPID */
 
-done:
-  if (latency)
-    take_gcprof(txn, latency);
-  rc = txn_end(txn, end_mode);
+  if (unlikely((txn == env->me_txn0 &&
+                atomic_load32(&env->me_disjoint.active, mo_AcquireRelease)) ||
+               ((txn->mt_flags & MDBX_TXN_RDONLY) == 0 && txn_frozen(txn)))) {
+    /* the disjoint txns are still running on top of this one,
+     * or the txn is frozen and may be read by other threads */
+    if (latency)
+      memset(latency, 0, sizeof(*latency));
+    return MDBX_BUSY;
+  }
 
-provide_latency:
-  if (latency) {
-    latency->preparation = ts_1 ? osal_monotime_to_16dot16(ts_1 - ts_0) : 0;
-    latency->gc_wallclock =
-        (ts_2 > ts_1) ? osal_monotime_to_16dot16(ts_2 - ts_1) : 0;
-    latency->gc_cputime = gc_cputime ? osal_monotime_to_16dot16(gc_cputime) : 0;
-    latency->audit = (ts_3 > ts_2) ? osal_monotime_to_16dot16(ts_3 - ts_2) : 0;
-    latency->write = (ts_4 > ts_3) ? osal_monotime_to_16dot16(ts_4 - ts_3) : 0;
-    latency->sync = (ts_5 > ts_4) ? osal_monotime_to_16dot16(ts_5 - ts_4) : 0;
-    const uint64_t ts_6 = osal_monotime();
-    latency->ending = ts_5 ? osal_monotime_to_16dot16(ts_6 - ts_5) : 0;
-    latency->whole = osal_monotime_to_16dot16_noUnderflow(ts_6 - ts_0);
+  if (unlikely(txn->mt_flags & MDBX_TXN_ERROR)) {
+    rc = MDBX_RESULT_TRUE;
+    goto fail;
   }
-  return rc;
 
-fail:
-  txn->mt_flags |= MDBX_TXN_ERROR;
-  if (latency)
-    take_gcprof(txn, latency);
-  mdbx_txn_abort(txn);
-  goto provide_latency;
-}
+  /* txn_end() mode for a commit which writes nothing */
+  unsigned end_mode =
+      MDBX_END_PURE_COMMIT | MDBX_END_UPDATE | MDBX_END_SLOT | MDBX_END_FREE;
+  if (unlikely(txn->mt_flags & MDBX_TXN_RDONLY)) {
+    if (txn->mt_flags & MDBX_TXN_OPTIMISTIC) {
+      /* latency is provided by the write txn which replays the changes */
+      rc = optimistic_commit(txn, latency);
+      const int err = txn_end(txn, end_mode);
+      return (rc == MDBX_SUCCESS) ? err : rc;
+    }
+    goto done;
+  }
 
-static __always_inline int cmp_int_inline(const size_t expected_alignment,
-                                          const MDBX_val *a,
-                                          const MDBX_val *b) {
-  if (likely(a->iov_len == b->iov_len)) {
-    if (sizeof(size_t) > 7 && likely(a->iov_len == 8))
-      return CMP2INT(unaligned_peek_u64(expected_alignment, a->iov_base),
-                     unaligned_peek_u64(expected_alignment, b->iov_base));
-    if (likely(a->iov_len == 4))
-      return CMP2INT(unaligned_peek_u32(expected_alignment, a->iov_base),
-                     unaligned_peek_u32(expected_alignment, b->iov_base));
-    if (sizeof(size_t) < 8 && likely(a->iov_len == 8))
-      return CMP2INT(unaligned_peek_u64(expected_alignment, a->iov_base),
-                     unaligned_peek_u64(expected_alignment, b->iov_base));
+  if (txn->mt_child) {
+    rc = mdbx_txn_commit_ex(txn->mt_child, NULL);
+    tASSERT(txn, txn->mt_child == NULL);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto fail;
   }
-  ERROR("mismatch and/or invalid size %p.%zu/%p.%zu for INTEGERKEY/INTEGERDUP",
-        a->iov_base, a->iov_len, b->iov_base, b->iov_len);
-  return 0;
-}
 
-__hot static int cmp_int_unaligned(const MDBX_val *a, const MDBX_val *b) {
-  return cmp_int_inline(1, a, b);
-}
+  if (unlikely(txn->tw.streams)) {
+    ERROR("%zu streaming put(s) of large values left unfinished",
+          txn->tw.streams);
+    rc = MDBX_BAD_TXN;
+    goto fail;
+  }
 
-/* Compare two items pointing at 2-byte aligned unsigned int's. */
-#if MDBX_UNALIGNED_OK < 2 ||                                                   \
-    (MDBX_DEBUG || MDBX_FORCE_ASSERTIONS || !defined(NDEBUG))
-__hot static int cmp_int_align2(const MDBX_val *a, const MDBX_val *b) {
-  return cmp_int_inline(2, a, b);
-}
-#else
-#define cmp_int_align2 cmp_int_unaligned
-#endif /* !MDBX_UNALIGNED_OK || debug */
+  if (txn->mt_flags & MDBX_TXN_DISJOINT) {
+    rc = disjoint_end(txn, true);
+    if (latency) {
+      ts_1 = osal_monotime();
+      ts_2 = /* no gc-update */ ts_1;
+      ts_3 = /* no audit */ ts_2;
+      ts_4 = /* no write */ ts_3;
+      ts_5 = /* no sync */ ts_4;
+    }
+    goto provide_latency;
+  }
 
-/* Compare two items pointing at aligned unsigned int's. */
-#if MDBX_UNALIGNED_OK < 4 ||                                                   \
-    (MDBX_DEBUG || MDBX_FORCE_ASSERTIONS || !defined(NDEBUG))
-__hot static int cmp_int_align4(const MDBX_val *a, const MDBX_val *b) {
-  return cmp_int_inline(4, a, b);
-}
-#else
-#define cmp_int_align4 cmp_int_unaligned
-#endif /* !MDBX_UNALIGNED_OK || debug */
+  if (unlikely(txn != env->me_txn)) {
+    DEBUG("%s", "attempt to commit unknown transaction");
+    rc = MDBX_EINVAL;
+    goto fail;
+  }
 
-/* Compare two items lexically */
-__hot static int cmp_lexical(const MDBX_val *a, const MDBX_val *b) {
-  if (a->iov_len == b->iov_len)
-    return a->iov_len ? memcmp(a->iov_base, b->iov_base, a->iov_len) : 0;
+  if (txn->tw.vlog.deltas_count) {
+    rc = vlog_flush(txn);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto fail;
+  }
 
-  const int diff_len = (a->iov_len < b->iov_len) ? -1 : 1;
-  const size_t shortest = (a->iov_len < b->iov_len) ? a->iov_len : b->iov_len;
-  int diff_data = shortest ? memcmp(a->iov_base, b->iov_base, shortest) : 0;
-  return likely(diff_data) ? diff_data : diff_len;
-}
-
-MDBX_NOTHROW_PURE_FUNCTION static __always_inline unsigned
-tail3le(const uint8_t *p, size_t l) {
-  STATIC_ASSERT(sizeof(unsigned) > 2);
-  // 1: 0 0 0
-  // 2: 0 1 1
-  // 3: 0 1 2
-  return p[0] | p[l >> 1] << 8 | p[l - 1] << 16;
-}
+  if (txn->mt_parent) {
+    tASSERT(txn, audit_ex(txn, 0, false) == 0);
+    eASSERT(env, txn != env->me_txn0);
+    MDBX_txn *const parent = txn->mt_parent;
+    eASSERT(env, parent->mt_signature == MDBX_MT_SIGNATURE);
+    eASSERT(env, parent->mt_child == txn &&
+                     (parent->mt_flags & MDBX_TXN_HAS_CHILD) != 0);
+    eASSERT(env, dirtylist_check(txn));
 
-/* Compare two items in reverse byte order */
-__hot static int cmp_reverse(const MDBX_val *a, const MDBX_val *b) {
-  size_t left = (a->iov_len < b->iov_len) ? a->iov_len : b->iov_len;
-  if (likely(left)) {
-    const uint8_t *pa = ptr_disp(a->iov_base, a->iov_len);
-    const uint8_t *pb = ptr_disp(b->iov_base, b->iov_len);
-    while (left >= sizeof(size_t)) {
-      pa -= sizeof(size_t);
-      pb -= sizeof(size_t);
-      left -= sizeof(size_t);
-      STATIC_ASSERT(sizeof(size_t) == 4 || sizeof(size_t) == 8);
-      if (sizeof(size_t) == 4) {
-        uint32_t xa = unaligned_peek_u32(1, pa);
-        uint32_t xb = unaligned_peek_u32(1, pb);
-#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
-        xa = osal_bswap32(xa);
-        xb = osal_bswap32(xb);
-#endif /* __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ */
-        if (xa != xb)
-          return (xa < xb) ? -1 : 1;
-      } else {
-        uint64_t xa = unaligned_peek_u64(1, pa);
-        uint64_t xb = unaligned_peek_u64(1, pb);
-#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
-        xa = osal_bswap64(xa);
-        xb = osal_bswap64(xb);
-#endif /* __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ */
-        if (xa != xb)
-          return (xa < xb) ? -1 : 1;
+    if (txn->tw.dirtylist->length == 0 && !(txn->mt_flags & MDBX_TXN_DIRTY) &&
+        parent->mt_numdbs == txn->mt_numdbs) {
+      for (int i = txn->mt_numdbs; --i >= 0;) {
+        tASSERT(txn, (txn->mt_dbistate[i] & DBI_DIRTY) == 0);
+        if ((txn->mt_dbistate[i] & DBI_STALE) &&
+            !(parent->mt_dbistate[i] & DBI_STALE))
+          tASSERT(txn, memcmp(&parent->mt_dbs[i], &txn->mt_dbs[i],
+                              sizeof(MDBX_db)) == 0);
       }
+
+      tASSERT(txn, memcmp(&parent->mt_geo, &txn->mt_geo,
+                          sizeof(parent->mt_geo)) == 0);
+      tASSERT(txn, memcmp(&parent->mt_canary, &txn->mt_canary,
+                          sizeof(parent->mt_canary)) == 0);
+      tASSERT(txn, !txn->tw.spilled.list ||
+                       MDBX_PNL_GETSIZE(txn->tw.spilled.list) == 0);
+      tASSERT(txn, txn->tw.loose_count == 0);
+
+      /* fast completion of pure nested transaction */
+      end_mode = MDBX_END_PURE_COMMIT | MDBX_END_SLOT | MDBX_END_FREE;
+      goto done;
     }
-    if (sizeof(size_t) == 8 && left >= 4) {
-      pa -= 4;
-      pb -= 4;
-      left -= 4;
-      uint32_t xa = unaligned_peek_u32(1, pa);
-      uint32_t xb = unaligned_peek_u32(1, pb);
-#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
-      xa = osal_bswap32(xa);
-      xb = osal_bswap32(xb);
-#endif /* __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ */
-      if (xa != xb)
-        return (xa < xb) ? -1 : 1;
+
+    /* Preserve space for spill list to avoid parent's state corruption
+     * if allocation fails. */
+    const size_t parent_retired_len = (uintptr_t)parent->tw.retired_pages;
+    tASSERT(txn, parent_retired_len <= MDBX_PNL_GETSIZE(txn->tw.retired_pages));
+    const size_t retired_delta =
+        MDBX_PNL_GETSIZE(txn->tw.retired_pages) - parent_retired_len;
+    if (retired_delta) {
+      rc = pnl_need(&txn->tw.relist, retired_delta);
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto fail;
     }
-    if (left) {
-      unsigned xa = tail3le(pa - left, left);
-      unsigned xb = tail3le(pb - left, left);
-      if (xa != xb)
-        return (xa < xb) ? -1 : 1;
+
+    if (txn->tw.spilled.list) {
+      if (parent->tw.spilled.list) {
+        rc = pnl_need(&parent->tw.spilled.list,
+                      MDBX_PNL_GETSIZE(txn->tw.spilled.list));
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto fail;
+      }
+      spill_purge(txn);
     }
-  }
-  return CMP2INT(a->iov_len, b->iov_len);
-}
 
-/* Fast non-lexically comparator */
-__hot static int cmp_lenfast(const MDBX_val *a, const MDBX_val *b) {
-  int diff = CMP2INT(a->iov_len, b->iov_len);
-  return (likely(diff) || a->iov_len == 0)
-             ? diff
-             : memcmp(a->iov_base, b->iov_base, a->iov_len);
-}
+    if (unlikely(txn->tw.dirtylist->length + parent->tw.dirtylist->length >
+                     parent->tw.dirtylist->detent &&
+                 !dpl_reserve(parent, txn->tw.dirtylist->length +
+                                          parent->tw.dirtylist->length))) {
+      rc = MDBX_ENOMEM;
+      goto fail;
+    }
 
-__hot static bool eq_fast_slowpath(const uint8_t *a, const uint8_t *b,
-                                   size_t l) {
-  if (likely(l > 3)) {
-    if (MDBX_UNALIGNED_OK >= 4 && likely(l < 9))
-      return ((unaligned_peek_u32(1, a) - unaligned_peek_u32(1, b)) |
-              (unaligned_peek_u32(1, a + l - 4) -
-               unaligned_peek_u32(1, b + l - 4))) == 0;
-    if (MDBX_UNALIGNED_OK >= 8 && sizeof(size_t) > 7 && likely(l < 17))
-      return ((unaligned_peek_u64(1, a) - unaligned_peek_u64(1, b)) |
-              (unaligned_peek_u64(1, a + l - 8) -
-               unaligned_peek_u64(1, b + l - 8))) == 0;
-    return memcmp(a, b, l) == 0;
-  }
-  if (likely(l))
-    return tail3le(a, l) == tail3le(b, l);
-  return true;
-}
+    //-------------------------------------------------------------------------
 
-static __always_inline bool eq_fast(const MDBX_val *a, const MDBX_val *b) {
-  return unlikely(a->iov_len == b->iov_len) &&
-         eq_fast_slowpath(a->iov_base, b->iov_base, a->iov_len);
-}
+    parent->tw.lifo_reclaimed = txn->tw.lifo_reclaimed;
+    txn->tw.lifo_reclaimed = NULL;
 
-static int validate_meta(MDBX_env *env, MDBX_meta *const meta,
-                         const MDBX_page *const page,
-                         const unsigned meta_number, unsigned *guess_pagesize) {
-  const uint64_t magic_and_version =
-      unaligned_peek_u64(4, &meta->mm_magic_and_version);
-  if (unlikely(magic_and_version != MDBX_DATA_MAGIC &&
-               magic_and_version != MDBX_DATA_MAGIC_LEGACY_COMPAT &&
-               magic_and_version != MDBX_DATA_MAGIC_LEGACY_DEVEL)) {
-    ERROR("meta[%u] has invalid magic/version %" PRIx64, meta_number,
-          magic_and_version);
-    return ((magic_and_version >> 8) != MDBX_MAGIC) ? MDBX_INVALID
-                                                    : MDBX_VERSION_MISMATCH;
-  }
+    parent->tw.retired_pages = txn->tw.retired_pages;
+    txn->tw.retired_pages = NULL;
 
-  if (unlikely(page->mp_pgno != meta_number)) {
-    ERROR("meta[%u] has invalid pageno %" PRIaPGNO, meta_number, page->mp_pgno);
-    return MDBX_INVALID;
-  }
+    pnl_free(parent->tw.relist);
+    parent->tw.relist = txn->tw.relist;
+    txn->tw.relist = NULL;
+    parent->tw.last_reclaimed = txn->tw.last_reclaimed;
 
-  if (unlikely(page->mp_flags != P_META)) {
-    ERROR("page #%u not a meta-page", meta_number);
-    return MDBX_INVALID;
-  }
+    parent->mt_geo = txn->mt_geo;
+    parent->mt_canary = txn->mt_canary;
+    parent->mt_flags |= txn->mt_flags & MDBX_TXN_DIRTY;
 
-  /* LY: check pagesize */
-  if (unlikely(!is_powerof2(meta->mm_psize) || meta->mm_psize < MIN_PAGESIZE ||
-               meta->mm_psize > MAX_PAGESIZE)) {
-    WARNING("meta[%u] has invalid pagesize (%u), skip it", meta_number,
-            meta->mm_psize);
-    return is_powerof2(meta->mm_psize) ? MDBX_VERSION_MISMATCH : MDBX_INVALID;
-  }
+    /* Move loose pages to parent */
+#if MDBX_ENABLE_REFUND
+    parent->tw.loose_refund_wl = txn->tw.loose_refund_wl;
+#endif /* MDBX_ENABLE_REFUND */
+    parent->tw.loose_count = txn->tw.loose_count;
+    parent->tw.loose_pages = txn->tw.loose_pages;
 
-  if (guess_pagesize && *guess_pagesize != meta->mm_psize) {
-    *guess_pagesize = meta->mm_psize;
-    VERBOSE("meta[%u] took pagesize %u", meta_number, meta->mm_psize);
-  }
+    /* Merge our cursors into parent's and close them */
+    cursors_eot(txn, true);
+    end_mode |= MDBX_END_EOTDONE;
 
-  const txnid_t txnid = unaligned_peek_u64(4, &meta->mm_txnid_a);
-  if (unlikely(txnid != unaligned_peek_u64(4, &meta->mm_txnid_b))) {
-    WARNING("meta[%u] not completely updated, skip it", meta_number);
-    return MDBX_RESULT_TRUE;
-  }
+    /* Update parent's DBs array */
+    memcpy(parent->mt_dbs, txn->mt_dbs, txn->mt_numdbs * sizeof(MDBX_db));
+    parent->mt_numdbs = txn->mt_numdbs;
+    for (size_t i = 0; i < txn->mt_numdbs; i++) {
+      /* preserve parent's status */
+      const uint8_t state =
+          txn->mt_dbistate[i] |
+          (parent->mt_dbistate[i] & (DBI_CREAT | DBI_FRESH | DBI_DIRTY));
+      DEBUG("dbi %zu dbi-state %s 0x%02x -> 0x%02x", i,
+            (parent->mt_dbistate[i] != state) ? "update" : "still",
+            parent->mt_dbistate[i], state);
+      parent->mt_dbistate[i] = state;
+    }
 
-  /* LY: check signature as a checksum */
-  if (META_IS_STEADY(meta) &&
-      unlikely(unaligned_peek_u64(4, &meta->mm_sign) != meta_sign(meta))) {
-    WARNING("meta[%u] has invalid steady-checksum (0x%" PRIx64 " != 0x%" PRIx64
-            "), skip it",
-            meta_number, unaligned_peek_u64(4, &meta->mm_sign),
-            meta_sign(meta));
-    return MDBX_RESULT_TRUE;
-  }
+    if (latency) {
+      ts_1 = osal_monotime();
+      ts_2 = /* no gc-update */ ts_1;
+      ts_3 = /* no audit */ ts_2;
+      ts_4 = /* no write */ ts_3;
+      ts_5 = /* no sync */ ts_4;
+    }
+    txn_merge(parent, txn, parent_retired_len);
+    vlog_merge(parent, txn);
+    env->me_txn = parent;
+    parent->mt_child = NULL;
+    tASSERT(parent, dirtylist_check(parent));
 
-  DEBUG("checking meta%" PRIaPGNO " = root %" PRIaPGNO "/%" PRIaPGNO
-        ", geo %" PRIaPGNO "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO
-        " +%u -%u, txn_id %" PRIaTXN ", %s",
-        page->mp_pgno, meta->mm_dbs[MAIN_DBI].md_root,
-        meta->mm_dbs[FREE_DBI].md_root, meta->mm_geo.lower, meta->mm_geo.next,
-        meta->mm_geo.now, meta->mm_geo.upper, pv2pages(meta->mm_geo.grow_pv),
-        pv2pages(meta->mm_geo.shrink_pv), txnid, durable_caption(meta));
+#if MDBX_ENABLE_REFUND
+    txn_refund(parent);
+    if (ASSERT_ENABLED()) {
+      /* Check parent's loose pages not suitable for refund */
+      for (MDBX_page *lp = parent->tw.loose_pages; lp; lp = mp_next(lp)) {
+        tASSERT(parent, lp->mp_pgno < parent->tw.loose_refund_wl &&
+                            lp->mp_pgno + 1 < parent->mt_next_pgno);
+        MDBX_ASAN_UNPOISON_MEMORY_REGION(&mp_next(lp), sizeof(MDBX_page *));
+        VALGRIND_MAKE_MEM_DEFINED(&mp_next(lp), sizeof(MDBX_page *));
+      }
+      /* Check parent's reclaimed pages not suitable for refund */
+      if (MDBX_PNL_GETSIZE(parent->tw.relist))
+        tASSERT(parent,
+                MDBX_PNL_MOST(parent->tw.relist) + 1 < parent->mt_next_pgno);
+    }
+#endif /* MDBX_ENABLE_REFUND */
 
-  if (unlikely(txnid < MIN_TXNID || txnid > MAX_TXNID)) {
-    WARNING("meta[%u] has invalid txnid %" PRIaTXN ", skip it", meta_number,
-            txnid);
-    return MDBX_RESULT_TRUE;
+    txn->mt_signature = 0;
+    osal_free(txn);
+    tASSERT(parent, audit_ex(parent, 0, false) == 0);
+    rc = MDBX_SUCCESS;
+    goto provide_latency;
   }
 
-  /* LY: check min-pages value */
-  if (unlikely(meta->mm_geo.lower < MIN_PAGENO ||
-               meta->mm_geo.lower > MAX_PAGENO + 1)) {
-    WARNING("meta[%u] has invalid min-pages (%" PRIaPGNO "), skip it",
-            meta_number, meta->mm_geo.lower);
-    return MDBX_INVALID;
+  if (!txn->tw.dirtylist) {
+    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) != 0 && !MDBX_AVOID_MSYNC);
+  } else {
+    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
+    tASSERT(txn, txn->tw.dirtyroom + txn->tw.dirtylist->length ==
+                     (txn->mt_parent ? txn->mt_parent->tw.dirtyroom
+                                     : txn->mt_env->me_options.dp_limit));
   }
+  cursors_eot(txn, false);
+  end_mode |= MDBX_END_EOTDONE;
 
-  /* LY: check max-pages value */
-  if (unlikely(meta->mm_geo.upper < MIN_PAGENO ||
-               meta->mm_geo.upper > MAX_PAGENO + 1 ||
-               meta->mm_geo.upper < meta->mm_geo.lower)) {
-    WARNING("meta[%u] has invalid max-pages (%" PRIaPGNO "), skip it",
-            meta_number, meta->mm_geo.upper);
-    return MDBX_INVALID;
+  if ((!txn->tw.dirtylist || txn->tw.dirtylist->length == 0) &&
+      (txn->mt_flags & (MDBX_TXN_DIRTY | MDBX_TXN_SPILLS)) == 0) {
+    for (intptr_t i = txn->mt_numdbs; --i >= 0;)
+      tASSERT(txn, (txn->mt_dbistate[i] & DBI_DIRTY) == 0);
+#if defined(MDBX_NOSUCCESS_EMPTY_COMMIT) && MDBX_NOSUCCESS_EMPTY_COMMIT
+    rc = txn_end(txn, end_mode);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto fail;
+    rc = MDBX_RESULT_TRUE;
+    goto provide_latency;
+#else
+    goto done;
+#endif /* MDBX_NOSUCCESS_EMPTY_COMMIT */
   }
 
-  /* LY: check last_pgno */
-  if (unlikely(meta->mm_geo.next < MIN_PAGENO ||
-               meta->mm_geo.next - 1 > MAX_PAGENO)) {
-    WARNING("meta[%u] has invalid next-pageno (%" PRIaPGNO "), skip it",
-            meta_number, meta->mm_geo.next);
-    return MDBX_CORRUPTED;
-  }
+  DEBUG("committing txn %" PRIaTXN " %p on mdbenv %p, root page %" PRIaPGNO
+        "/%" PRIaPGNO,
+        txn->mt_txnid, (void *)txn, (void *)env, txn->mt_dbs[MAIN_DBI].md_root,
+        txn->mt_dbs[FREE_DBI].md_root);
 
-  /* LY: check filesize & used_bytes */
-  const uint64_t used_bytes = meta->mm_geo.next * (uint64_t)meta->mm_psize;
-  if (unlikely(used_bytes > env->me_dxb_mmap.filesize)) {
-    /* Here could be a race with DB-shrinking performed by other process */
-    int err = osal_filesize(env->me_lazy_fd, &env->me_dxb_mmap.filesize);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
-    if (unlikely(used_bytes > env->me_dxb_mmap.filesize)) {
-      WARNING("meta[%u] used-bytes (%" PRIu64 ") beyond filesize (%" PRIu64
-              "), skip it",
-              meta_number, used_bytes, env->me_dxb_mmap.filesize);
-      return MDBX_CORRUPTED;
+  /* Update DB root pointers */
+  if (txn->mt_numdbs > CORE_DBS) {
+    MDBX_cursor_couple couple;
+    MDBX_val data;
+    data.iov_len = sizeof(MDBX_db);
+
+    rc = cursor_init(&couple.outer, txn, MAIN_DBI);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto fail;
+    for (MDBX_dbi i = CORE_DBS; i < txn->mt_numdbs; i++) {
+      if (txn->mt_dbistate[i] & DBI_DIRTY) {
+        MDBX_db *db = &txn->mt_dbs[i];
+        DEBUG("update main's entry for sub-db %u, mod_txnid %" PRIaTXN
+              " -> %" PRIaTXN,
+              i, db->md_mod_txnid, txn->mt_txnid);
+        /* Может быть mod_txnid > front после коммита вложенных тразакций */
+        db->md_mod_txnid = txn->mt_txnid;
+        data.iov_base = db;
+        WITH_CURSOR_TRACKING(
+            couple.outer,
+            rc = cursor_put_nochecklen(&couple.outer, &txn->mt_dbxs[i].md_name,
+                                       &data, F_SUBDATA));
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto fail;
+      }
     }
   }
-  if (unlikely(meta->mm_geo.next - 1 > MAX_PAGENO ||
-               used_bytes > MAX_MAPSIZE)) {
-    WARNING("meta[%u] has too large used-space (%" PRIu64 "), skip it",
-            meta_number, used_bytes);
-    return MDBX_TOO_LARGE;
+
+  ts_1 = latency ? osal_monotime() : 0;
+
+  gcu_context_t gcu_ctx;
+  gc_cputime = latency ? osal_cputime(nullptr) : 0;
+  rc = gcu_context_init(txn, &gcu_ctx);
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto fail;
+  rc = update_gc(txn, &gcu_ctx);
+  gc_cputime = latency ? osal_cputime(nullptr) - gc_cputime : 0;
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto fail;
+
+  tASSERT(txn, txn->tw.loose_count == 0);
+  txn->mt_dbs[FREE_DBI].md_mod_txnid = (txn->mt_dbistate[FREE_DBI] & DBI_DIRTY)
+                                           ? txn->mt_txnid
+                                           : txn->mt_dbs[FREE_DBI].md_mod_txnid;
+
+  txn->mt_dbs[MAIN_DBI].md_mod_txnid = (txn->mt_dbistate[MAIN_DBI] & DBI_DIRTY)
+                                           ? txn->mt_txnid
+                                           : txn->mt_dbs[MAIN_DBI].md_mod_txnid;
+
+  ts_2 = latency ? osal_monotime() : 0;
+  ts_3 = ts_2;
+  if (AUDIT_ENABLED()) {
+    rc = audit_ex(txn, MDBX_PNL_GETSIZE(txn->tw.retired_pages), true);
+    ts_3 = osal_monotime();
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto fail;
   }
 
-  /* LY: check mapsize limits */
-  pgno_t geo_lower = meta->mm_geo.lower;
-  uint64_t mapsize_min = geo_lower * (uint64_t)meta->mm_psize;
-  STATIC_ASSERT(MAX_MAPSIZE < PTRDIFF_MAX - MAX_PAGESIZE);
-  STATIC_ASSERT(MIN_MAPSIZE < MAX_MAPSIZE);
-  STATIC_ASSERT((uint64_t)(MAX_PAGENO + 1) * MIN_PAGESIZE % (4ul << 20) == 0);
-  if (unlikely(mapsize_min < MIN_MAPSIZE || mapsize_min > MAX_MAPSIZE)) {
-    if (MAX_MAPSIZE != MAX_MAPSIZE64 && mapsize_min > MAX_MAPSIZE &&
-        mapsize_min <= MAX_MAPSIZE64) {
-      eASSERT(env,
-              meta->mm_geo.next - 1 <= MAX_PAGENO && used_bytes <= MAX_MAPSIZE);
-      WARNING("meta[%u] has too large min-mapsize (%" PRIu64 "), "
-              "but size of used space still acceptable (%" PRIu64 ")",
-              meta_number, mapsize_min, used_bytes);
-      geo_lower = (pgno_t)((mapsize_min = MAX_MAPSIZE) / meta->mm_psize);
-      if (geo_lower > MAX_PAGENO + 1) {
-        geo_lower = MAX_PAGENO + 1;
-        mapsize_min = geo_lower * (uint64_t)meta->mm_psize;
+  bool need_flush_for_nometasync = false;
+  const meta_ptr_t head = meta_recent(env, &txn->tw.troika);
+  const uint32_t meta_sync_txnid =
+      atomic_load32(&env->me_lck->mti_meta_sync_txnid, mo_Relaxed);
+  /* sync prev meta */
+  if (head.is_steady && meta_sync_txnid != (uint32_t)head.txnid) {
+    /* Исправление унаследованного от LMDB недочета:
+     *
+     * Всё хорошо, если все процессы работающие с БД не используют WRITEMAP.
+     * Тогда мета-страница (обновленная, но не сброшенная на диск) будет
+     * сохранена в результате fdatasync() при записи данных этой транзакции.
+     *
+     * Всё хорошо, если все процессы работающие с БД используют WRITEMAP
+     * без MDBX_AVOID_MSYNC.
+     * Тогда мета-страница (обновленная, но не сброшенная на диск) будет
+     * сохранена в результате msync() при записи данных этой транзакции.
+     *
+     * Если же в процессах работающих с БД используется оба метода, как sync()
+     * в режиме MDBX_WRITEMAP, так и записи через файловый дескриптор, то
+     * становится невозможным обеспечить фиксацию на диске мета-страницы
+     * предыдущей транзакции и данных текущей транзакции, за счет одной
+     * sync-операцией выполняемой после записи данных текущей транзакции.
+     * Соответственно, требуется явно обновлять мета-страницу, что полностью
+     * уничтожает выгоду от NOMETASYNC. */
+    const uint32_t txnid_dist =
+        ((txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC)
+            ? MDBX_NOMETASYNC_LAZY_FD
+            : MDBX_NOMETASYNC_LAZY_WRITEMAP;
+    /* Смысл "магии" в том, чтобы избежать отдельного вызова fdatasync()
+     * или msync() для гарантированной фиксации на диске мета-страницы,
+     * которая была "лениво" отправлена на запись в предыдущей транзакции,
+     * но не сброшена на диск из-за активного режима MDBX_NOMETASYNC. */
+    if (
+#if defined(_WIN32) || defined(_WIN64)
+        !env->me_overlapped_fd &&
+#endif
+        meta_sync_txnid == (uint32_t)head.txnid - txnid_dist)
+      need_flush_for_nometasync = true;
+    else {
+      rc = meta_sync(env, head);
+      if (unlikely(rc != MDBX_SUCCESS)) {
+        ERROR("txn-%s: error %d", "presync-meta", rc);
+        goto fail;
       }
-      WARNING("meta[%u] consider get-%s pageno is %" PRIaPGNO
-              " instead of wrong %" PRIaPGNO
-              ", will be corrected on next commit(s)",
-              meta_number, "lower", geo_lower, meta->mm_geo.lower);
-      meta->mm_geo.lower = geo_lower;
-    } else {
-      WARNING("meta[%u] has invalid min-mapsize (%" PRIu64 "), skip it",
-              meta_number, mapsize_min);
-      return MDBX_VERSION_MISMATCH;
     }
   }
 
-  pgno_t geo_upper = meta->mm_geo.upper;
-  uint64_t mapsize_max = geo_upper * (uint64_t)meta->mm_psize;
-  STATIC_ASSERT(MIN_MAPSIZE < MAX_MAPSIZE);
-  if (unlikely(mapsize_max > MAX_MAPSIZE ||
-               (MAX_PAGENO + 1) <
-                   ceil_powerof2((size_t)mapsize_max, env->me_os_psize) /
-                       (size_t)meta->mm_psize)) {
-    if (mapsize_max > MAX_MAPSIZE64) {
-      WARNING("meta[%u] has invalid max-mapsize (%" PRIu64 "), skip it",
-              meta_number, mapsize_max);
-      return MDBX_VERSION_MISMATCH;
+  if (txn->tw.dirtylist) {
+    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
+    tASSERT(txn, txn->tw.loose_count == 0);
+
+    mdbx_filehandle_t fd =
+#if defined(_WIN32) || defined(_WIN64)
+        env->me_overlapped_fd ? env->me_overlapped_fd : env->me_lazy_fd;
+    (void)need_flush_for_nometasync;
+#else
+#define MDBX_WRITETHROUGH_THRESHOLD_DEFAULT 2
+        (need_flush_for_nometasync ||
+         env->me_dsync_fd == INVALID_HANDLE_VALUE ||
+         txn->tw.dirtylist->length > env->me_options.writethrough_threshold ||
+         atomic_load64(&env->me_lck->mti_unsynced_pages, mo_Relaxed))
+            ? env->me_lazy_fd
+            : env->me_dsync_fd;
+#endif /* Windows */
+
+    iov_ctx_t write_ctx;
+    rc = iov_init(txn, &write_ctx, txn->tw.dirtylist->length,
+                  txn->tw.dirtylist->pages_including_loose, fd, false);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      ERROR("txn-%s: error %d", "iov-init", rc);
+      goto fail;
     }
-    /* allow to open large DB from a 32-bit environment */
-    eASSERT(env,
-            meta->mm_geo.next - 1 <= MAX_PAGENO && used_bytes <= MAX_MAPSIZE);
-    WARNING("meta[%u] has too large max-mapsize (%" PRIu64 "), "
-            "but size of used space still acceptable (%" PRIu64 ")",
-            meta_number, mapsize_max, used_bytes);
-    geo_upper = (pgno_t)((mapsize_max = MAX_MAPSIZE) / meta->mm_psize);
-    if (geo_upper > MAX_PAGENO + 1) {
-      geo_upper = MAX_PAGENO + 1;
-      mapsize_max = geo_upper * (uint64_t)meta->mm_psize;
+
+    rc = txn_write(txn, &write_ctx);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      ERROR("txn-%s: error %d", "write", rc);
+      goto fail;
     }
-    WARNING("meta[%u] consider get-%s pageno is %" PRIaPGNO
-            " instead of wrong %" PRIaPGNO
-            ", will be corrected on next commit(s)",
-            meta_number, "upper", geo_upper, meta->mm_geo.upper);
-    meta->mm_geo.upper = geo_upper;
+  } else {
+    tASSERT(txn, (txn->mt_flags & MDBX_WRITEMAP) != 0 && !MDBX_AVOID_MSYNC);
+    env->me_lck->mti_unsynced_pages.weak += txn->tw.writemap_dirty_npages;
+    if (!env->me_lck->mti_eoos_timestamp.weak)
+      env->me_lck->mti_eoos_timestamp.weak = osal_monotime();
   }
 
-  /* LY: check and silently put mm_geo.now into [geo.lower...geo.upper].
-   *
-   * Copy-with-compaction by previous version of libmdbx could produce DB-file
-   * less than meta.geo.lower bound, in case actual filling is low or no data
-   * at all. This is not a problem as there is no damage or loss of data.
-   * Therefore it is better not to consider such situation as an error, but
-   * silently correct it. */
-  pgno_t geo_now = meta->mm_geo.now;
-  if (geo_now < geo_lower)
-    geo_now = geo_lower;
-  if (geo_now > geo_upper && meta->mm_geo.next <= geo_upper)
-    geo_now = geo_upper;
+  /* TODO: use ctx.flush_begin & ctx.flush_end for range-sync */
+  ts_4 = latency ? osal_monotime() : 0;
 
-  if (unlikely(meta->mm_geo.next > geo_now)) {
-    WARNING("meta[%u] next-pageno (%" PRIaPGNO
-            ") is beyond end-pgno (%" PRIaPGNO "), skip it",
-            meta_number, meta->mm_geo.next, geo_now);
-    return MDBX_CORRUPTED;
-  }
-  if (meta->mm_geo.now != geo_now) {
-    WARNING("meta[%u] consider geo-%s pageno is %" PRIaPGNO
-            " instead of wrong %" PRIaPGNO
-            ", will be corrected on next commit(s)",
-            meta_number, "now", geo_now, meta->mm_geo.now);
-    meta->mm_geo.now = geo_now;
-  }
+  MDBX_meta meta;
+  memcpy(meta.mm_magic_and_version, head.ptr_c->mm_magic_and_version, 8);
+  meta.mm_extra_flags = head.ptr_c->mm_extra_flags;
+  meta.mm_validator_id = head.ptr_c->mm_validator_id;
+  meta.mm_extra_pagehdr = head.ptr_c->mm_extra_pagehdr;
+  unaligned_poke_u64(4, meta.mm_pages_retired,
+                     unaligned_peek_u64(4, head.ptr_c->mm_pages_retired) +
+                         MDBX_PNL_GETSIZE(txn->tw.retired_pages));
+  meta.mm_geo = txn->mt_geo;
+  meta.mm_dbs[FREE_DBI] = txn->mt_dbs[FREE_DBI];
+  meta.mm_dbs[MAIN_DBI] = txn->mt_dbs[MAIN_DBI];
+  meta.mm_canary = txn->mt_canary;
 
-  /* GC */
-  if (meta->mm_dbs[FREE_DBI].md_root == P_INVALID) {
-    if (unlikely(meta->mm_dbs[FREE_DBI].md_branch_pages ||
-                 meta->mm_dbs[FREE_DBI].md_depth ||
-                 meta->mm_dbs[FREE_DBI].md_entries ||
-                 meta->mm_dbs[FREE_DBI].md_leaf_pages ||
-                 meta->mm_dbs[FREE_DBI].md_overflow_pages)) {
-      WARNING("meta[%u] has false-empty %s, skip it", meta_number, "GC");
-      return MDBX_CORRUPTED;
-    }
-  } else if (unlikely(meta->mm_dbs[FREE_DBI].md_root >= meta->mm_geo.next)) {
-    WARNING("meta[%u] has invalid %s-root %" PRIaPGNO ", skip it", meta_number,
-            "GC", meta->mm_dbs[FREE_DBI].md_root);
-    return MDBX_CORRUPTED;
+  txnid_t commit_txnid = txn->mt_txnid;
+#if MDBX_ENABLE_BIGFOOT
+  if (gcu_ctx.bigfoot > txn->mt_txnid) {
+    commit_txnid = gcu_ctx.bigfoot;
+    TRACE("use @%" PRIaTXN " (+%zu) for commit bigfoot-txn", commit_txnid,
+          (size_t)(commit_txnid - txn->mt_txnid));
   }
+#endif
+  meta_set_txnid(env, &meta, commit_txnid);
 
-  /* MainDB */
-  if (meta->mm_dbs[MAIN_DBI].md_root == P_INVALID) {
-    if (unlikely(meta->mm_dbs[MAIN_DBI].md_branch_pages ||
-                 meta->mm_dbs[MAIN_DBI].md_depth ||
-                 meta->mm_dbs[MAIN_DBI].md_entries ||
-                 meta->mm_dbs[MAIN_DBI].md_leaf_pages ||
-                 meta->mm_dbs[MAIN_DBI].md_overflow_pages)) {
-      WARNING("meta[%u] has false-empty %s", meta_number, "MainDB");
-      return MDBX_CORRUPTED;
-    }
-  } else if (unlikely(meta->mm_dbs[MAIN_DBI].md_root >= meta->mm_geo.next)) {
-    WARNING("meta[%u] has invalid %s-root %" PRIaPGNO ", skip it", meta_number,
-            "MainDB", meta->mm_dbs[MAIN_DBI].md_root);
-    return MDBX_CORRUPTED;
-  }
+  rc = sync_locked(env, env->me_flags | txn->mt_flags | MDBX_SHRINK_ALLOWED,
+                   &meta, &txn->tw.troika);
 
-  if (unlikely(meta->mm_dbs[FREE_DBI].md_mod_txnid > txnid)) {
-    WARNING("meta[%u] has wrong md_mod_txnid %" PRIaTXN " for %s, skip it",
-            meta_number, meta->mm_dbs[FREE_DBI].md_mod_txnid, "GC");
-    return MDBX_CORRUPTED;
+  ts_5 = latency ? osal_monotime() : 0;
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    env->me_flags |= MDBX_FATAL_ERROR;
+    ERROR("txn-%s: error %d", "sync", rc);
+    goto fail;
   }
 
-  if (unlikely(meta->mm_dbs[MAIN_DBI].md_mod_txnid > txnid)) {
-    WARNING("meta[%u] has wrong md_mod_txnid %" PRIaTXN " for %s, skip it",
-            meta_number, meta->mm_dbs[MAIN_DBI].md_mod_txnid, "MainDB");
-    return MDBX_CORRUPTED;
+  end_mode = MDBX_END_COMMITTED | MDBX_END_UPDATE | MDBX_END_EOTDONE;
+  notify_commit(env);
+
+done:
+  if (latency)
+    take_gcprof(txn, latency);
+  rc = txn_end(txn, end_mode);
+
+provide_latency:
+  if (latency) {
+    latency->preparation = ts_1 ? osal_monotime_to_16dot16(ts_1 - ts_0) : 0;
+    latency->gc_wallclock =
+        (ts_2 > ts_1) ? osal_monotime_to_16dot16(ts_2 - ts_1) : 0;
+    latency->gc_cputime = gc_cputime ? osal_monotime_to_16dot16(gc_cputime) : 0;
+    latency->audit = (ts_3 > ts_2) ? osal_monotime_to_16dot16(ts_3 - ts_2) : 0;
+    latency->write = (ts_4 > ts_3) ? osal_monotime_to_16dot16(ts_4 - ts_3) : 0;
+    latency->sync = (ts_5 > ts_4) ? osal_monotime_to_16dot16(ts_5 - ts_4) : 0;
+    const uint64_t ts_6 = osal_monotime();
+    latency->ending = ts_5 ? osal_monotime_to_16dot16(ts_6 - ts_5) : 0;
+    latency->whole = osal_monotime_to_16dot16_noUnderflow(ts_6 - ts_0);
   }
+  return rc;
 
-  return MDBX_SUCCESS;
+fail:
+  txn->mt_flags |= MDBX_TXN_ERROR;
+  if (latency)
+    take_gcprof(txn, latency);
+  mdbx_txn_abort(txn);
+  goto provide_latency;
 }
 
-static int validate_meta_copy(MDBX_env *env, const MDBX_meta *meta,
-                              MDBX_meta *dest) {
-  *dest = *meta;
-  return validate_meta(env, dest, data_page(meta),
-                       bytes2pgno(env, ptr_dist(meta, env->me_map)), nullptr);
+static __always_inline int cmp_int_inline(const size_t expected_alignment,
+                                          const MDBX_val *a,
+                                          const MDBX_val *b) {
+  if (likely(a->iov_len == b->iov_len)) {
+    if (sizeof(size_t) > 7 && likely(a->iov_len == 8))
+      return CMP2INT(unaligned_peek_u64(expected_alignment, a->iov_base),
+                     unaligned_peek_u64(expected_alignment, b->iov_base));
+    if (likely(a->iov_len == 4))
+      return CMP2INT(unaligned_peek_u32(expected_alignment, a->iov_base),
+                     unaligned_peek_u32(expected_alignment, b->iov_base));
+    if (sizeof(size_t) < 8 && likely(a->iov_len == 8))
+      return CMP2INT(unaligned_peek_u64(expected_alignment, a->iov_base),
+                     unaligned_peek_u64(expected_alignment, b->iov_base));
+  }
+  ERROR("mismatch and/or invalid size %p.%zu/%p.%zu for INTEGERKEY/INTEGERDUP",
+        a->iov_base, a->iov_len, b->iov_base, b->iov_len);
+  return 0;
 }
 
-/* Read the environment parameters of a DB environment
- * before mapping it into memory. */
-__cold static int read_header(MDBX_env *env, MDBX_meta *dest,
-                              const int lck_exclusive,
-                              const mdbx_mode_t mode_bits) {
-  memset(dest, 0, sizeof(MDBX_meta));
-  int rc = osal_filesize(env->me_lazy_fd, &env->me_dxb_mmap.filesize);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  unaligned_poke_u64(4, dest->mm_sign, MDBX_DATASIGN_WEAK);
-  rc = MDBX_CORRUPTED;
-
-  /* Read twice all meta pages so we can find the latest one. */
-  unsigned loop_limit = NUM_METAS * 2;
-  /* We don't know the page size on first time. So, just guess it. */
-  unsigned guess_pagesize = 0;
-  for (unsigned loop_count = 0; loop_count < loop_limit; ++loop_count) {
-    const unsigned meta_number = loop_count % NUM_METAS;
-    const unsigned offset = (guess_pagesize             ? guess_pagesize
-                             : (loop_count > NUM_METAS) ? env->me_psize
-                                                        : env->me_os_psize) *
-                            meta_number;
+__hot static int cmp_int_unaligned(const MDBX_val *a, const MDBX_val *b) {
+  return cmp_int_inline(1, a, b);
+}
 
-    char buffer[MIN_PAGESIZE];
-    unsigned retryleft = 42;
-    while (1) {
-      TRACE("reading meta[%d]: offset %u, bytes %u, retry-left %u", meta_number,
-            offset, MIN_PAGESIZE, retryleft);
-      int err = osal_pread(env->me_lazy_fd, buffer, MIN_PAGESIZE, offset);
-      if (err == MDBX_ENODATA && offset == 0 && loop_count == 0 &&
-          env->me_dxb_mmap.filesize == 0 &&
-          mode_bits /* non-zero for DB creation */ != 0) {
-        NOTICE("read meta: empty file (%d, %s)", err, mdbx_strerror(err));
-        return err;
-      }
-#if defined(_WIN32) || defined(_WIN64)
-      if (err == ERROR_LOCK_VIOLATION) {
-        SleepEx(0, true);
-        err = osal_pread(env->me_lazy_fd, buffer, MIN_PAGESIZE, offset);
-        if (err == ERROR_LOCK_VIOLATION && --retryleft) {
-          WARNING("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
-                  mdbx_strerror(err));
-          continue;
-        }
-      }
-#endif /* Windows */
-      if (err != MDBX_SUCCESS) {
-        ERROR("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
-              mdbx_strerror(err));
-        return err;
-      }
+/* Compare two items pointing at 2-byte aligned unsigned int's. */
+#if MDBX_UNALIGNED_OK < 2 ||                                                   \
+    (MDBX_DEBUG || MDBX_FORCE_ASSERTIONS || !defined(NDEBUG))
+__hot static int cmp_int_align2(const MDBX_val *a, const MDBX_val *b) {
+  return cmp_int_inline(2, a, b);
+}
+#else
+#define cmp_int_align2 cmp_int_unaligned
+#endif /* !MDBX_UNALIGNED_OK || debug */
 
-      char again[MIN_PAGESIZE];
-      err = osal_pread(env->me_lazy_fd, again, MIN_PAGESIZE, offset);
-#if defined(_WIN32) || defined(_WIN64)
-      if (err == ERROR_LOCK_VIOLATION) {
-        SleepEx(0, true);
-        err = osal_pread(env->me_lazy_fd, again, MIN_PAGESIZE, offset);
-        if (err == ERROR_LOCK_VIOLATION && --retryleft) {
-          WARNING("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
-                  mdbx_strerror(err));
-          continue;
-        }
-      }
-#endif /* Windows */
-      if (err != MDBX_SUCCESS) {
-        ERROR("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
-              mdbx_strerror(err));
-        return err;
-      }
+/* Compare two items pointing at aligned unsigned int's. */
+#if MDBX_UNALIGNED_OK < 4 ||                                                   \
+    (MDBX_DEBUG || MDBX_FORCE_ASSERTIONS || !defined(NDEBUG))
+__hot static int cmp_int_align4(const MDBX_val *a, const MDBX_val *b) {
+  return cmp_int_inline(4, a, b);
+}
+#else
+#define cmp_int_align4 cmp_int_unaligned
+#endif /* !MDBX_UNALIGNED_OK || debug */
 
-      if (memcmp(buffer, again, MIN_PAGESIZE) == 0 || --retryleft == 0)
-        break;
+/* Compare two items lexically */
+__hot static int cmp_lexical(const MDBX_val *a, const MDBX_val *b) {
+  if (a->iov_len == b->iov_len)
+    return a->iov_len ? memcmp(a->iov_base, b->iov_base, a->iov_len) : 0;
 
-      VERBOSE("meta[%u] was updated, re-read it", meta_number);
-    }
+  const int diff_len = (a->iov_len < b->iov_len) ? -1 : 1;
+  const size_t shortest = (a->iov_len < b->iov_len) ? a->iov_len : b->iov_len;
+  int diff_data = shortest ? memcmp(a->iov_base, b->iov_base, shortest) : 0;
+  return likely(diff_data) ? diff_data : diff_len;
+}
 
-    if (!retryleft) {
-      ERROR("meta[%u] is too volatile, skip it", meta_number);
-      continue;
-    }
+MDBX_NOTHROW_PURE_FUNCTION static __always_inline unsigned
+tail3le(const uint8_t *p, size_t l) {
+  STATIC_ASSERT(sizeof(unsigned) > 2);
+  // 1: 0 0 0
+  // 2: 0 1 1
+  // 3: 0 1 2
+  return p[0] | p[l >> 1] << 8 | p[l - 1] << 16;
+}
 
-    MDBX_page *const page = (MDBX_page *)buffer;
-    MDBX_meta *const meta = page_meta(page);
-    rc = validate_meta(env, meta, page, meta_number, &guess_pagesize);
-    if (rc != MDBX_SUCCESS)
-      continue;
-
-    bool latch;
-    if (env->me_stuck_meta >= 0)
-      latch = (meta_number == (unsigned)env->me_stuck_meta);
-    else if (meta_bootid_match(meta))
-      latch = meta_choice_recent(
-          meta->unsafe_txnid, SIGN_IS_STEADY(meta->unsafe_sign),
-          dest->unsafe_txnid, SIGN_IS_STEADY(dest->unsafe_sign));
-    else
-      latch = meta_choice_steady(
-          meta->unsafe_txnid, SIGN_IS_STEADY(meta->unsafe_sign),
-          dest->unsafe_txnid, SIGN_IS_STEADY(dest->unsafe_sign));
-    if (latch) {
-      *dest = *meta;
-      if (!lck_exclusive && !META_IS_STEADY(dest))
-        loop_limit += 1; /* LY: should re-read to hush race with update */
-      VERBOSE("latch meta[%u]", meta_number);
+/* Compare two items in reverse byte order */
+__hot static int cmp_reverse(const MDBX_val *a, const MDBX_val *b) {
+  size_t left = (a->iov_len < b->iov_len) ? a->iov_len : b->iov_len;
+  if (likely(left)) {
+    const uint8_t *pa = ptr_disp(a->iov_base, a->iov_len);
+    const uint8_t *pb = ptr_disp(b->iov_base, b->iov_len);
+    while (left >= sizeof(size_t)) {
+      pa -= sizeof(size_t);
+      pb -= sizeof(size_t);
+      left -= sizeof(size_t);
+      STATIC_ASSERT(sizeof(size_t) == 4 || sizeof(size_t) == 8);
+      if (sizeof(size_t) == 4) {
+        uint32_t xa = unaligned_peek_u32(1, pa);
+        uint32_t xb = unaligned_peek_u32(1, pb);
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+        xa = osal_bswap32(xa);
+        xb = osal_bswap32(xb);
+#endif /* __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ */
+        if (xa != xb)
+          return (xa < xb) ? -1 : 1;
+      } else {
+        uint64_t xa = unaligned_peek_u64(1, pa);
+        uint64_t xb = unaligned_peek_u64(1, pb);
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+        xa = osal_bswap64(xa);
+        xb = osal_bswap64(xb);
+#endif /* __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ */
+        if (xa != xb)
+          return (xa < xb) ? -1 : 1;
+      }
     }
-  }
-
-  if (dest->mm_psize == 0 ||
-      (env->me_stuck_meta < 0 &&
-       !(META_IS_STEADY(dest) ||
-         meta_weak_acceptable(env, dest, lck_exclusive)))) {
-    ERROR("%s", "no usable meta-pages, database is corrupted");
-    if (rc == MDBX_SUCCESS) {
-      /* TODO: try to restore the database by fully checking b-tree structure
-       * for the each meta page, if the corresponding option was given */
-      return MDBX_CORRUPTED;
+    if (sizeof(size_t) == 8 && left >= 4) {
+      pa -= 4;
+      pb -= 4;
+      left -= 4;
+      uint32_t xa = unaligned_peek_u32(1, pa);
+      uint32_t xb = unaligned_peek_u32(1, pb);
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+      xa = osal_bswap32(xa);
+      xb = osal_bswap32(xb);
+#endif /* __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__ */
+      if (xa != xb)
+        return (xa < xb) ? -1 : 1;
+    }
+    if (left) {
+      unsigned xa = tail3le(pa - left, left);
+      unsigned xb = tail3le(pb - left, left);
+      if (xa != xb)
+        return (xa < xb) ? -1 : 1;
     }
-    return rc;
   }
+  return CMP2INT(a->iov_len, b->iov_len);
+}
 
-  return MDBX_SUCCESS;
+/* Fast non-lexically comparator */
+__hot static int cmp_lenfast(const MDBX_val *a, const MDBX_val *b) {
+  int diff = CMP2INT(a->iov_len, b->iov_len);
+  return (likely(diff) || a->iov_len == 0)
+             ? diff
+             : memcmp(a->iov_base, b->iov_base, a->iov_len);
 }
 
-__cold static MDBX_page *meta_model(const MDBX_env *env, MDBX_page *model,
-                                    size_t num) {
-  ENSURE(env, is_powerof2(env->me_psize));
-  ENSURE(env, env->me_psize >= MIN_PAGESIZE);
-  ENSURE(env, env->me_psize <= MAX_PAGESIZE);
-  ENSURE(env, env->me_dbgeo.lower >= MIN_MAPSIZE);
-  ENSURE(env, env->me_dbgeo.upper <= MAX_MAPSIZE);
-  ENSURE(env, env->me_dbgeo.now >= env->me_dbgeo.lower);
-  ENSURE(env, env->me_dbgeo.now <= env->me_dbgeo.upper);
+__hot static bool eq_fast_slowpath(const uint8_t *a, const uint8_t *b,
+                                   size_t l) {
+  if (likely(l > 3)) {
+    if (MDBX_UNALIGNED_OK >= 4 && likely(l < 9))
+      return ((unaligned_peek_u32(1, a) - unaligned_peek_u32(1, b)) |
+              (unaligned_peek_u32(1, a + l - 4) -
+               unaligned_peek_u32(1, b + l - 4))) == 0;
+    if (MDBX_UNALIGNED_OK >= 8 && sizeof(size_t) > 7 && likely(l < 17))
+      return ((unaligned_peek_u64(1, a) - unaligned_peek_u64(1, b)) |
+              (unaligned_peek_u64(1, a + l - 8) -
+               unaligned_peek_u64(1, b + l - 8))) == 0;
+    return memcmp(a, b, l) == 0;
+  }
+  if (likely(l))
+    return tail3le(a, l) == tail3le(b, l);
+  return true;
+}
 
-  memset(model, 0, env->me_psize);
-  model->mp_pgno = (pgno_t)num;
-  model->mp_flags = P_META;
-  MDBX_meta *const model_meta = page_meta(model);
-  unaligned_poke_u64(4, model_meta->mm_magic_and_version, MDBX_DATA_MAGIC);
+static __always_inline bool eq_fast(const MDBX_val *a, const MDBX_val *b) {
+  return unlikely(a->iov_len == b->iov_len) &&
+         eq_fast_slowpath(a->iov_base, b->iov_base, a->iov_len);
+}
 
-  model_meta->mm_geo.lower = bytes2pgno(env, env->me_dbgeo.lower);
-  model_meta->mm_geo.upper = bytes2pgno(env, env->me_dbgeo.upper);
-  model_meta->mm_geo.grow_pv = pages2pv(bytes2pgno(env, env->me_dbgeo.grow));
-  model_meta->mm_geo.shrink_pv =
-      pages2pv(bytes2pgno(env, env->me_dbgeo.shrink));
-  model_meta->mm_geo.now = bytes2pgno(env, env->me_dbgeo.now);
-  model_meta->mm_geo.next = NUM_METAS;
+static int validate_meta(MDBX_env *env, MDBX_meta *const meta,
+                         const MDBX_page *const page,
+                         const unsigned meta_number, unsigned *guess_pagesize) {
+  const uint64_t magic_and_version =
+      unaligned_peek_u64(4, &meta->mm_magic_and_version);
+  if (unlikely(magic_and_version != MDBX_DATA_MAGIC &&
+               magic_and_version != MDBX_DATA_MAGIC_LEGACY_COMPAT &&
+               magic_and_version != MDBX_DATA_MAGIC_LEGACY_DEVEL)) {
+    ERROR("meta[%u] has invalid magic/version %" PRIx64, meta_number,
+          magic_and_version);
+    return ((magic_and_version >> 8) != MDBX_MAGIC) ? MDBX_INVALID
+                                                    : MDBX_VERSION_MISMATCH;
+  }
 
-  ENSURE(env, model_meta->mm_geo.lower >= MIN_PAGENO);
-  ENSURE(env, model_meta->mm_geo.upper <= MAX_PAGENO + 1);
-  ENSURE(env, model_meta->mm_geo.now >= model_meta->mm_geo.lower);
-  ENSURE(env, model_meta->mm_geo.now <= model_meta->mm_geo.upper);
-  ENSURE(env, model_meta->mm_geo.next >= MIN_PAGENO);
-  ENSURE(env, model_meta->mm_geo.next <= model_meta->mm_geo.now);
-  ENSURE(env, model_meta->mm_geo.grow_pv ==
-                  pages2pv(pv2pages(model_meta->mm_geo.grow_pv)));
-  ENSURE(env, model_meta->mm_geo.shrink_pv ==
-                  pages2pv(pv2pages(model_meta->mm_geo.shrink_pv)));
+  if (unlikely(page->mp_pgno != meta_number)) {
+    ERROR("meta[%u] has invalid pageno %" PRIaPGNO, meta_number, page->mp_pgno);
+    return MDBX_INVALID;
+  }
 
-  model_meta->mm_psize = env->me_psize;
-  model_meta->mm_dbs[FREE_DBI].md_flags = MDBX_INTEGERKEY;
-  model_meta->mm_dbs[FREE_DBI].md_root = P_INVALID;
-  model_meta->mm_dbs[MAIN_DBI].md_root = P_INVALID;
-  meta_set_txnid(env, model_meta, MIN_TXNID + num);
-  unaligned_poke_u64(4, model_meta->mm_sign, meta_sign(model_meta));
-  eASSERT(env, coherency_check_meta(env, model_meta, true));
-  return ptr_disp(model, env->me_psize);
-}
+  if (unlikely(page->mp_flags != P_META)) {
+    ERROR("page #%u not a meta-page", meta_number);
+    return MDBX_INVALID;
+  }
 
-/* Fill in most of the zeroed meta-pages for an empty database environment.
- * Return pointer to recently (head) meta-page. */
-__cold static MDBX_meta *init_metas(const MDBX_env *env, void *buffer) {
-  MDBX_page *page0 = (MDBX_page *)buffer;
-  MDBX_page *page1 = meta_model(env, page0, 0);
-  MDBX_page *page2 = meta_model(env, page1, 1);
-  meta_model(env, page2, 2);
-  return page_meta(page2);
-}
+  /* LY: check pagesize */
+  if (unlikely(!is_powerof2(meta->mm_psize) || meta->mm_psize < MIN_PAGESIZE ||
+               meta->mm_psize > MAX_PAGESIZE)) {
+    WARNING("meta[%u] has invalid pagesize (%u), skip it", meta_number,
+            meta->mm_psize);
+    return is_powerof2(meta->mm_psize) ? MDBX_VERSION_MISMATCH : MDBX_INVALID;
+  }
 
-static int sync_locked(MDBX_env *env, unsigned flags, MDBX_meta *const pending,
-                       meta_troika_t *const troika) {
-  eASSERT(env, ((env->me_flags ^ flags) & MDBX_WRITEMAP) == 0);
-  const MDBX_meta *const meta0 = METAPAGE(env, 0);
-  const MDBX_meta *const meta1 = METAPAGE(env, 1);
-  const MDBX_meta *const meta2 = METAPAGE(env, 2);
-  const meta_ptr_t head = meta_recent(env, troika);
-  int rc;
+  if (guess_pagesize && *guess_pagesize != meta->mm_psize) {
+    *guess_pagesize = meta->mm_psize;
+    VERBOSE("meta[%u] took pagesize %u", meta_number, meta->mm_psize);
+  }
 
-  eASSERT(env,
-          pending < METAPAGE(env, 0) || pending > METAPAGE(env, NUM_METAS));
-  eASSERT(env, (env->me_flags & (MDBX_RDONLY | MDBX_FATAL_ERROR)) == 0);
-  eASSERT(env, pending->mm_geo.next <= pending->mm_geo.now);
+  const txnid_t txnid = unaligned_peek_u64(4, &meta->mm_txnid_a);
+  if (unlikely(txnid != unaligned_peek_u64(4, &meta->mm_txnid_b))) {
+    WARNING("meta[%u] not completely updated, skip it", meta_number);
+    return MDBX_RESULT_TRUE;
+  }
 
-  if (flags & MDBX_SAFE_NOSYNC) {
-    /* Check auto-sync conditions */
-    const pgno_t autosync_threshold =
-        atomic_load32(&env->me_lck->mti_autosync_threshold, mo_Relaxed);
-    const uint64_t autosync_period =
-        atomic_load64(&env->me_lck->mti_autosync_period, mo_Relaxed);
-    uint64_t eoos_timestamp;
-    if ((autosync_threshold &&
-         atomic_load64(&env->me_lck->mti_unsynced_pages, mo_Relaxed) >=
-             autosync_threshold) ||
-        (autosync_period &&
-         (eoos_timestamp =
-              atomic_load64(&env->me_lck->mti_eoos_timestamp, mo_Relaxed)) &&
-         osal_monotime() - eoos_timestamp >= autosync_period))
-      flags &= MDBX_WRITEMAP | MDBX_SHRINK_ALLOWED; /* force steady */
+  /* LY: check signature as a checksum */
+  if (META_IS_STEADY(meta) &&
+      unlikely(unaligned_peek_u64(4, &meta->mm_sign) != meta_sign(meta))) {
+    WARNING("meta[%u] has invalid steady-checksum (0x%" PRIx64 " != 0x%" PRIx64
+            "), skip it",
+            meta_number, unaligned_peek_u64(4, &meta->mm_sign),
+            meta_sign(meta));
+    return MDBX_RESULT_TRUE;
   }
 
-  pgno_t shrink = 0;
-  if (flags & MDBX_SHRINK_ALLOWED) {
-    const size_t prev_discarded_pgno =
-        atomic_load32(&env->me_lck->mti_discarded_tail, mo_Relaxed);
-    if (prev_discarded_pgno < pending->mm_geo.next)
-      env->me_lck->mti_discarded_tail.weak = pending->mm_geo.next;
-    else if (prev_discarded_pgno >=
-             pending->mm_geo.next + env->me_madv_threshold) {
-      /* LY: check conditions to discard unused pages */
-      const pgno_t largest_pgno = find_largest_snapshot(
-          env, (head.ptr_c->mm_geo.next > pending->mm_geo.next)
-                   ? head.ptr_c->mm_geo.next
-                   : pending->mm_geo.next);
-      eASSERT(env, largest_pgno >= NUM_METAS);
+  DEBUG("checking meta%" PRIaPGNO " = root %" PRIaPGNO "/%" PRIaPGNO
+        ", geo %" PRIaPGNO "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO
+        " +%u -%u, txn_id %" PRIaTXN ", %s",
+        page->mp_pgno, meta->mm_dbs[MAIN_DBI].md_root,
+        meta->mm_dbs[FREE_DBI].md_root, meta->mm_geo.lower, meta->mm_geo.next,
+        meta->mm_geo.now, meta->mm_geo.upper, pv2pages(meta->mm_geo.grow_pv),
+        pv2pages(meta->mm_geo.shrink_pv), txnid, durable_caption(meta));
 
-#if defined(MDBX_USE_VALGRIND) || defined(__SANITIZE_ADDRESS__)
-      const pgno_t edge = env->me_poison_edge;
-      if (edge > largest_pgno) {
-        env->me_poison_edge = largest_pgno;
-        VALGRIND_MAKE_MEM_NOACCESS(
-            ptr_disp(env->me_map, pgno2bytes(env, largest_pgno)),
-            pgno2bytes(env, edge - largest_pgno));
-        MDBX_ASAN_POISON_MEMORY_REGION(
-            ptr_disp(env->me_map, pgno2bytes(env, largest_pgno)),
-            pgno2bytes(env, edge - largest_pgno));
-      }
-#endif /* MDBX_USE_VALGRIND || __SANITIZE_ADDRESS__ */
+  if (unlikely(txnid < MIN_TXNID || txnid > MAX_TXNID)) {
+    WARNING("meta[%u] has invalid txnid %" PRIaTXN ", skip it", meta_number,
+            txnid);
+    return MDBX_RESULT_TRUE;
+  }
 
-#if MDBX_ENABLE_MADVISE &&                                                     \
-    (defined(MADV_DONTNEED) || defined(POSIX_MADV_DONTNEED))
-      const size_t discard_edge_pgno = pgno_align2os_pgno(env, largest_pgno);
-      if (prev_discarded_pgno >= discard_edge_pgno + env->me_madv_threshold) {
-        const size_t prev_discarded_bytes =
-            pgno_align2os_bytes(env, prev_discarded_pgno);
-        const size_t discard_edge_bytes = pgno2bytes(env, discard_edge_pgno);
-        /* из-за выравнивания prev_discarded_bytes и discard_edge_bytes
-         * могут быть равны */
-        if (prev_discarded_bytes > discard_edge_bytes) {
-          NOTICE("shrink-MADV_%s %zu..%zu", "DONTNEED", discard_edge_pgno,
-                 prev_discarded_pgno);
-          munlock_after(env, discard_edge_pgno,
-                        bytes_align2os_bytes(env, env->me_dxb_mmap.current));
-          const uint32_t munlocks_before =
-              atomic_load32(&env->me_lck->mti_mlcnt[1], mo_Relaxed);
-#if defined(MADV_DONTNEED)
-          int advise = MADV_DONTNEED;
-#if defined(MADV_FREE) &&                                                      \
-    0 /* MADV_FREE works for only anonymous vma at the moment */
-          if ((env->me_flags & MDBX_WRITEMAP) &&
-              linux_kernel_version > 0x04050000)
-            advise = MADV_FREE;
-#endif /* MADV_FREE */
-          int err = madvise(ptr_disp(env->me_map, discard_edge_bytes),
-                            prev_discarded_bytes - discard_edge_bytes, advise)
-                        ? ignore_enosys(errno)
-                        : MDBX_SUCCESS;
-#else
-          int err = ignore_enosys(posix_madvise(
-              ptr_disp(env->me_map, discard_edge_bytes),
-              prev_discarded_bytes - discard_edge_bytes, POSIX_MADV_DONTNEED));
-#endif
-          if (unlikely(MDBX_IS_ERROR(err))) {
-            const uint32_t mlocks_after =
-                atomic_load32(&env->me_lck->mti_mlcnt[0], mo_Relaxed);
-            if (err == MDBX_EINVAL) {
-              const int severity = (mlocks_after - munlocks_before)
-                                       ? MDBX_LOG_NOTICE
-                                       : MDBX_LOG_WARN;
-              if (LOG_ENABLED(severity))
-                debug_log(
-                    severity, __func__, __LINE__,
-                    "%s-madvise: ignore EINVAL (%d) since some pages maybe "
-                    "locked (%u/%u mlcnt-processes)",
-                    "shrink", err, mlocks_after, munlocks_before);
-            } else {
-              ERROR("%s-madvise(%s, %zu, +%zu), %u/%u mlcnt-processes, err %d",
-                    "shrink", "DONTNEED", discard_edge_bytes,
-                    prev_discarded_bytes - discard_edge_bytes, mlocks_after,
-                    munlocks_before, err);
-              return err;
-            }
-          } else
-            env->me_lck->mti_discarded_tail.weak = discard_edge_pgno;
-        }
-      }
-#endif /* MDBX_ENABLE_MADVISE && (MADV_DONTNEED || POSIX_MADV_DONTNEED) */
+  /* LY: check min-pages value */
+  if (unlikely(meta->mm_geo.lower < MIN_PAGENO ||
+               meta->mm_geo.lower > MAX_PAGENO + 1)) {
+    WARNING("meta[%u] has invalid min-pages (%" PRIaPGNO "), skip it",
+            meta_number, meta->mm_geo.lower);
+    return MDBX_INVALID;
+  }
 
-      /* LY: check conditions to shrink datafile */
-      const pgno_t backlog_gap = 3 + pending->mm_dbs[FREE_DBI].md_depth * 3;
-      pgno_t shrink_step = 0;
-      if (pending->mm_geo.shrink_pv &&
-          pending->mm_geo.now - pending->mm_geo.next >
-              (shrink_step = pv2pages(pending->mm_geo.shrink_pv)) +
-                  backlog_gap) {
-        if (pending->mm_geo.now > largest_pgno &&
-            pending->mm_geo.now - largest_pgno > shrink_step + backlog_gap) {
-          const pgno_t aligner =
-              pending->mm_geo.grow_pv
-                  ? /* grow_step */ pv2pages(pending->mm_geo.grow_pv)
-                  : shrink_step;
-          const pgno_t with_backlog_gap = largest_pgno + backlog_gap;
-          const pgno_t aligned =
-              pgno_align2os_pgno(env, (size_t)with_backlog_gap + aligner -
-                                          with_backlog_gap % aligner);
-          const pgno_t bottom = (aligned > pending->mm_geo.lower)
-                                    ? aligned
-                                    : pending->mm_geo.lower;
-          if (pending->mm_geo.now > bottom) {
-            if (TROIKA_HAVE_STEADY(troika))
-              /* force steady, but only if steady-checkpoint is present */
-              flags &= MDBX_WRITEMAP | MDBX_SHRINK_ALLOWED;
-            shrink = pending->mm_geo.now - bottom;
-            pending->mm_geo.now = bottom;
-            if (unlikely(head.txnid == pending->unsafe_txnid)) {
-              const txnid_t txnid = safe64_txnid_next(pending->unsafe_txnid);
-              NOTICE("force-forward pending-txn %" PRIaTXN " -> %" PRIaTXN,
-                     pending->unsafe_txnid, txnid);
-              ENSURE(env, !env->me_txn0 ||
-                              (env->me_txn0->mt_owner != osal_thread_self() &&
-                               !env->me_txn));
-              if (unlikely(txnid > MAX_TXNID)) {
-                rc = MDBX_TXN_FULL;
-                ERROR("txnid overflow, raise %d", rc);
-                goto fail;
-              }
-              meta_set_txnid(env, pending, txnid);
-              eASSERT(env, coherency_check_meta(env, pending, true));
-            }
-          }
-        }
-      }
-    }
+  /* LY: check max-pages value */
+  if (unlikely(meta->mm_geo.upper < MIN_PAGENO ||
+               meta->mm_geo.upper > MAX_PAGENO + 1 ||
+               meta->mm_geo.upper < meta->mm_geo.lower)) {
+    WARNING("meta[%u] has invalid max-pages (%" PRIaPGNO "), skip it",
+            meta_number, meta->mm_geo.upper);
+    return MDBX_INVALID;
   }
 
-  /* LY: step#1 - sync previously written/updated data-pages */
-  rc = MDBX_RESULT_FALSE /* carry steady */;
-  if (atomic_load64(&env->me_lck->mti_unsynced_pages, mo_Relaxed)) {
-    eASSERT(env, ((flags ^ env->me_flags) & MDBX_WRITEMAP) == 0);
-    enum osal_syncmode_bits mode_bits = MDBX_SYNC_NONE;
-    unsigned sync_op = 0;
-    if ((flags & MDBX_SAFE_NOSYNC) == 0) {
-      sync_op = 1;
-      mode_bits = MDBX_SYNC_DATA;
-      if (pending->mm_geo.next >
-          meta_prefer_steady(env, troika).ptr_c->mm_geo.now)
-        mode_bits |= MDBX_SYNC_SIZE;
-      if (flags & MDBX_NOMETASYNC)
-        mode_bits |= MDBX_SYNC_IODQ;
-    } else if (unlikely(env->me_incore))
-      goto skip_incore_sync;
-    if (flags & MDBX_WRITEMAP) {
-#if MDBX_ENABLE_PGOP_STAT
-      env->me_lck->mti_pgop_stat.msync.weak += sync_op;
-#else
-      (void)sync_op;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-      rc =
-          osal_msync(&env->me_dxb_mmap, 0,
-                     pgno_align2os_bytes(env, pending->mm_geo.next), mode_bits);
-    } else {
-#if MDBX_ENABLE_PGOP_STAT
-      env->me_lck->mti_pgop_stat.fsync.weak += sync_op;
-#else
-      (void)sync_op;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-      rc = osal_fsync(env->me_lazy_fd, mode_bits);
-    }
-    if (unlikely(rc != MDBX_SUCCESS))
-      goto fail;
-    rc = (flags & MDBX_SAFE_NOSYNC) ? MDBX_RESULT_TRUE /* carry non-steady */
-                                    : MDBX_RESULT_FALSE /* carry steady */;
+  /* LY: check last_pgno */
+  if (unlikely(meta->mm_geo.next < MIN_PAGENO ||
+               meta->mm_geo.next - 1 > MAX_PAGENO)) {
+    WARNING("meta[%u] has invalid next-pageno (%" PRIaPGNO "), skip it",
+            meta_number, meta->mm_geo.next);
+    return MDBX_CORRUPTED;
   }
-  eASSERT(env, coherency_check_meta(env, pending, true));
 
-  /* Steady or Weak */
-  if (rc == MDBX_RESULT_FALSE /* carry steady */) {
-    unaligned_poke_u64(4, pending->mm_sign, meta_sign(pending));
-    atomic_store64(&env->me_lck->mti_eoos_timestamp, 0, mo_Relaxed);
-    atomic_store64(&env->me_lck->mti_unsynced_pages, 0, mo_Relaxed);
-  } else {
-    assert(rc == MDBX_RESULT_TRUE /* carry non-steady */);
-  skip_incore_sync:
-    eASSERT(env, env->me_lck->mti_unsynced_pages.weak > 0);
-    /* Может быть нулевым если unsynced_pages > 0 в результате спиллинга.
-     * eASSERT(env, env->me_lck->mti_eoos_timestamp.weak != 0); */
-    unaligned_poke_u64(4, pending->mm_sign, MDBX_DATASIGN_WEAK);
+  /* LY: check filesize & used_bytes */
+  const uint64_t used_bytes = meta->mm_geo.next * (uint64_t)meta->mm_psize;
+  if (unlikely(used_bytes > env->me_dxb_mmap.filesize)) {
+    /* Here could be a race with DB-shrinking performed by other process */
+    int err = osal_filesize(env->me_lazy_fd, &env->me_dxb_mmap.filesize);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
+    if (unlikely(used_bytes > env->me_dxb_mmap.filesize)) {
+      WARNING("meta[%u] used-bytes (%" PRIu64 ") beyond filesize (%" PRIu64
+              "), skip it",
+              meta_number, used_bytes, env->me_dxb_mmap.filesize);
+      return MDBX_CORRUPTED;
+    }
+  }
+  if (unlikely(meta->mm_geo.next - 1 > MAX_PAGENO ||
+               used_bytes > MAX_MAPSIZE)) {
+    WARNING("meta[%u] has too large used-space (%" PRIu64 "), skip it",
+            meta_number, used_bytes);
+    return MDBX_TOO_LARGE;
   }
 
-  const bool legal4overwrite =
-      head.txnid == pending->unsafe_txnid &&
-      memcmp(&head.ptr_c->mm_dbs, &pending->mm_dbs, sizeof(pending->mm_dbs)) ==
-          0 &&
-      memcmp(&head.ptr_c->mm_canary, &pending->mm_canary,
-             sizeof(pending->mm_canary)) == 0 &&
-      memcmp(&head.ptr_c->mm_geo, &pending->mm_geo, sizeof(pending->mm_geo)) ==
-          0;
-  MDBX_meta *target = nullptr;
-  if (head.txnid == pending->unsafe_txnid) {
-    ENSURE(env, legal4overwrite);
-    if (!head.is_steady && META_IS_STEADY(pending))
-      target = (MDBX_meta *)head.ptr_c;
-    else {
-      WARNING("%s", "skip update meta");
-      return MDBX_SUCCESS;
+  /* LY: check mapsize limits */
+  pgno_t geo_lower = meta->mm_geo.lower;
+  uint64_t mapsize_min = geo_lower * (uint64_t)meta->mm_psize;
+  STATIC_ASSERT(MAX_MAPSIZE < PTRDIFF_MAX - MAX_PAGESIZE);
+  STATIC_ASSERT(MIN_MAPSIZE < MAX_MAPSIZE);
+  STATIC_ASSERT((uint64_t)(MAX_PAGENO + 1) * MIN_PAGESIZE % (4ul << 20) == 0);
+  if (unlikely(mapsize_min < MIN_MAPSIZE || mapsize_min > MAX_MAPSIZE)) {
+    if (MAX_MAPSIZE != MAX_MAPSIZE64 && mapsize_min > MAX_MAPSIZE &&
+        mapsize_min <= MAX_MAPSIZE64) {
+      eASSERT(env,
+              meta->mm_geo.next - 1 <= MAX_PAGENO && used_bytes <= MAX_MAPSIZE);
+      WARNING("meta[%u] has too large min-mapsize (%" PRIu64 "), "
+              "but size of used space still acceptable (%" PRIu64 ")",
+              meta_number, mapsize_min, used_bytes);
+      geo_lower = (pgno_t)((mapsize_min = MAX_MAPSIZE) / meta->mm_psize);
+      if (geo_lower > MAX_PAGENO + 1) {
+        geo_lower = MAX_PAGENO + 1;
+        mapsize_min = geo_lower * (uint64_t)meta->mm_psize;
+      }
+      WARNING("meta[%u] consider get-%s pageno is %" PRIaPGNO
+              " instead of wrong %" PRIaPGNO
+              ", will be corrected on next commit(s)",
+              meta_number, "lower", geo_lower, meta->mm_geo.lower);
+      meta->mm_geo.lower = geo_lower;
+    } else {
+      WARNING("meta[%u] has invalid min-mapsize (%" PRIu64 "), skip it",
+              meta_number, mapsize_min);
+      return MDBX_VERSION_MISMATCH;
     }
-  } else {
-    const unsigned troika_tail = troika->tail_and_flags & 3;
-    ENSURE(env, troika_tail < NUM_METAS && troika_tail != troika->recent &&
-                    troika_tail != troika->prefer_steady);
-    target = (MDBX_meta *)meta_tail(env, troika).ptr_c;
   }
 
-  /* LY: step#2 - update meta-page. */
-  DEBUG("writing meta%" PRIaPGNO " = root %" PRIaPGNO "/%" PRIaPGNO
-        ", geo %" PRIaPGNO "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO
-        " +%u -%u, txn_id %" PRIaTXN ", %s",
-        data_page(target)->mp_pgno, pending->mm_dbs[MAIN_DBI].md_root,
-        pending->mm_dbs[FREE_DBI].md_root, pending->mm_geo.lower,
-        pending->mm_geo.next, pending->mm_geo.now, pending->mm_geo.upper,
-        pv2pages(pending->mm_geo.grow_pv), pv2pages(pending->mm_geo.shrink_pv),
-        pending->unsafe_txnid, durable_caption(pending));
-
-  DEBUG("meta0: %s, %s, txn_id %" PRIaTXN ", root %" PRIaPGNO "/%" PRIaPGNO,
-        (meta0 == head.ptr_c) ? "head"
-        : (meta0 == target)   ? "tail"
-                              : "stay",
-        durable_caption(meta0), constmeta_txnid(meta0),
-        meta0->mm_dbs[MAIN_DBI].md_root, meta0->mm_dbs[FREE_DBI].md_root);
-  DEBUG("meta1: %s, %s, txn_id %" PRIaTXN ", root %" PRIaPGNO "/%" PRIaPGNO,
-        (meta1 == head.ptr_c) ? "head"
-        : (meta1 == target)   ? "tail"
-                              : "stay",
-        durable_caption(meta1), constmeta_txnid(meta1),
-        meta1->mm_dbs[MAIN_DBI].md_root, meta1->mm_dbs[FREE_DBI].md_root);
-  DEBUG("meta2: %s, %s, txn_id %" PRIaTXN ", root %" PRIaPGNO "/%" PRIaPGNO,
-        (meta2 == head.ptr_c) ? "head"
-        : (meta2 == target)   ? "tail"
-                              : "stay",
-        durable_caption(meta2), constmeta_txnid(meta2),
-        meta2->mm_dbs[MAIN_DBI].md_root, meta2->mm_dbs[FREE_DBI].md_root);
-
-  eASSERT(env, pending->unsafe_txnid != constmeta_txnid(meta0) ||
-                   (META_IS_STEADY(pending) && !META_IS_STEADY(meta0)));
-  eASSERT(env, pending->unsafe_txnid != constmeta_txnid(meta1) ||
-                   (META_IS_STEADY(pending) && !META_IS_STEADY(meta1)));
-  eASSERT(env, pending->unsafe_txnid != constmeta_txnid(meta2) ||
-                   (META_IS_STEADY(pending) && !META_IS_STEADY(meta2)));
-
-  eASSERT(env, ((env->me_flags ^ flags) & MDBX_WRITEMAP) == 0);
-  ENSURE(env, target == head.ptr_c ||
-                  constmeta_txnid(target) < pending->unsafe_txnid);
-  if (flags & MDBX_WRITEMAP) {
-    jitter4testing(true);
-    if (likely(target != head.ptr_c)) {
-      /* LY: 'invalidate' the meta. */
-      meta_update_begin(env, target, pending->unsafe_txnid);
-      unaligned_poke_u64(4, target->mm_sign, MDBX_DATASIGN_WEAK);
-#ifndef NDEBUG
-      /* debug: provoke failure to catch a violators, but don't touch mm_psize
-       * to allow readers catch actual pagesize. */
-      void *provoke_begin = &target->mm_dbs[FREE_DBI].md_root;
-      void *provoke_end = &target->mm_sign;
-      memset(provoke_begin, 0xCC, ptr_dist(provoke_end, provoke_begin));
-      jitter4testing(false);
-#endif
-
-      /* LY: update info */
-      target->mm_geo = pending->mm_geo;
-      target->mm_dbs[FREE_DBI] = pending->mm_dbs[FREE_DBI];
-      target->mm_dbs[MAIN_DBI] = pending->mm_dbs[MAIN_DBI];
-      target->mm_canary = pending->mm_canary;
-      memcpy(target->mm_pages_retired, pending->mm_pages_retired, 8);
-      jitter4testing(true);
-
-      /* LY: 'commit' the meta */
-      meta_update_end(env, target, unaligned_peek_u64(4, pending->mm_txnid_b));
-      jitter4testing(true);
-      eASSERT(env, coherency_check_meta(env, target, true));
-    } else {
-      /* dangerous case (target == head), only mm_sign could
-       * me updated, check assertions once again */
-      eASSERT(env,
-              legal4overwrite && !head.is_steady && META_IS_STEADY(pending));
-    }
-    memcpy(target->mm_sign, pending->mm_sign, 8);
-    osal_flush_incoherent_cpu_writeback();
-    jitter4testing(true);
-    if (!env->me_incore) {
-      if (!MDBX_AVOID_MSYNC) {
-        /* sync meta-pages */
-#if MDBX_ENABLE_PGOP_STAT
-        env->me_lck->mti_pgop_stat.msync.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-        rc = osal_msync(
-            &env->me_dxb_mmap, 0, pgno_align2os_bytes(env, NUM_METAS),
-            (flags & MDBX_NOMETASYNC) ? MDBX_SYNC_NONE
-                                      : MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
-      } else {
-#if MDBX_ENABLE_PGOP_STAT
-        env->me_lck->mti_pgop_stat.wops.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-        const MDBX_page *page = data_page(target);
-        rc = osal_pwrite(env->me_fd4meta, page, env->me_psize,
-                         ptr_dist(page, env->me_map));
-        if (likely(rc == MDBX_SUCCESS)) {
-          osal_flush_incoherent_mmap(target, sizeof(MDBX_meta),
-                                     env->me_os_psize);
-          if ((flags & MDBX_NOMETASYNC) == 0 &&
-              env->me_fd4meta == env->me_lazy_fd) {
-#if MDBX_ENABLE_PGOP_STAT
-            env->me_lck->mti_pgop_stat.fsync.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-            rc = osal_fsync(env->me_lazy_fd, MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
-          }
-        }
-      }
-      if (unlikely(rc != MDBX_SUCCESS))
-        goto fail;
-    }
-  } else {
-#if MDBX_ENABLE_PGOP_STAT
-    env->me_lck->mti_pgop_stat.wops.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-    const MDBX_meta undo_meta = *target;
-    rc = osal_pwrite(env->me_fd4meta, pending, sizeof(MDBX_meta),
-                     ptr_dist(target, env->me_map));
-    if (unlikely(rc != MDBX_SUCCESS)) {
-    undo:
-      DEBUG("%s", "write failed, disk error?");
-      /* On a failure, the pagecache still contains the new data.
-       * Try write some old data back, to prevent it from being used. */
-      osal_pwrite(env->me_fd4meta, &undo_meta, sizeof(MDBX_meta),
-                  ptr_dist(target, env->me_map));
-      goto fail;
+  pgno_t geo_upper = meta->mm_geo.upper;
+  uint64_t mapsize_max = geo_upper * (uint64_t)meta->mm_psize;
+  STATIC_ASSERT(MIN_MAPSIZE < MAX_MAPSIZE);
+  if (unlikely(mapsize_max > MAX_MAPSIZE ||
+               (MAX_PAGENO + 1) <
+                   ceil_powerof2((size_t)mapsize_max, env->me_os_psize) /
+                       (size_t)meta->mm_psize)) {
+    if (mapsize_max > MAX_MAPSIZE64) {
+      WARNING("meta[%u] has invalid max-mapsize (%" PRIu64 "), skip it",
+              meta_number, mapsize_max);
+      return MDBX_VERSION_MISMATCH;
     }
-    osal_flush_incoherent_mmap(target, sizeof(MDBX_meta), env->me_os_psize);
-    /* sync meta-pages */
-    if ((flags & MDBX_NOMETASYNC) == 0 && env->me_fd4meta == env->me_lazy_fd &&
-        !env->me_incore) {
-#if MDBX_ENABLE_PGOP_STAT
-      env->me_lck->mti_pgop_stat.fsync.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-      rc = osal_fsync(env->me_lazy_fd, MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
-      if (rc != MDBX_SUCCESS)
-        goto undo;
+    /* allow to open large DB from a 32-bit environment */
+    eASSERT(env,
+            meta->mm_geo.next - 1 <= MAX_PAGENO && used_bytes <= MAX_MAPSIZE);
+    WARNING("meta[%u] has too large max-mapsize (%" PRIu64 "), "
+            "but size of used space still acceptable (%" PRIu64 ")",
+            meta_number, mapsize_max, used_bytes);
+    geo_upper = (pgno_t)((mapsize_max = MAX_MAPSIZE) / meta->mm_psize);
+    if (geo_upper > MAX_PAGENO + 1) {
+      geo_upper = MAX_PAGENO + 1;
+      mapsize_max = geo_upper * (uint64_t)meta->mm_psize;
     }
+    WARNING("meta[%u] consider get-%s pageno is %" PRIaPGNO
+            " instead of wrong %" PRIaPGNO
+            ", will be corrected on next commit(s)",
+            meta_number, "upper", geo_upper, meta->mm_geo.upper);
+    meta->mm_geo.upper = geo_upper;
   }
 
-  uint64_t timestamp = 0;
-  while ("workaround for https://libmdbx.dqdkfa.ru/dead-github/issues/269") {
-    rc =
-        coherency_check_written(env, pending->unsafe_txnid, target, &timestamp);
-    if (likely(rc == MDBX_SUCCESS))
-      break;
-    if (unlikely(rc != MDBX_RESULT_TRUE))
-      goto fail;
+  /* LY: check and silently put mm_geo.now into [geo.lower...geo.upper].
+   *
+   * Copy-with-compaction by previous version of libmdbx could produce DB-file
+   * less than meta.geo.lower bound, in case actual filling is low or no data
+   * at all. This is not a problem as there is no damage or loss of data.
+   * Therefore it is better not to consider such situation as an error, but
+   * silently correct it. */
+  pgno_t geo_now = meta->mm_geo.now;
+  if (geo_now < geo_lower)
+    geo_now = geo_lower;
+  if (geo_now > geo_upper && meta->mm_geo.next <= geo_upper)
+    geo_now = geo_upper;
+
+  if (unlikely(meta->mm_geo.next > geo_now)) {
+    WARNING("meta[%u] next-pageno (%" PRIaPGNO
+            ") is beyond end-pgno (%" PRIaPGNO "), skip it",
+            meta_number, meta->mm_geo.next, geo_now);
+    return MDBX_CORRUPTED;
+  }
+  if (meta->mm_geo.now != geo_now) {
+    WARNING("meta[%u] consider geo-%s pageno is %" PRIaPGNO
+            " instead of wrong %" PRIaPGNO
+            ", will be corrected on next commit(s)",
+            meta_number, "now", geo_now, meta->mm_geo.now);
+    meta->mm_geo.now = geo_now;
   }
 
-  const uint32_t sync_txnid_dist =
-      ((flags & MDBX_NOMETASYNC) == 0) ? 0
-      : ((flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC)
-          ? MDBX_NOMETASYNC_LAZY_FD
-          : MDBX_NOMETASYNC_LAZY_WRITEMAP;
-  env->me_lck->mti_meta_sync_txnid.weak =
-      pending->mm_txnid_a[__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__].weak -
-      sync_txnid_dist;
+  /* GC */
+  if (meta->mm_dbs[FREE_DBI].md_root == P_INVALID) {
+    if (unlikely(meta->mm_dbs[FREE_DBI].md_branch_pages ||
+                 meta->mm_dbs[FREE_DBI].md_depth ||
+                 meta->mm_dbs[FREE_DBI].md_entries ||
+                 meta->mm_dbs[FREE_DBI].md_leaf_pages ||
+                 meta->mm_dbs[FREE_DBI].md_overflow_pages)) {
+      WARNING("meta[%u] has false-empty %s, skip it", meta_number, "GC");
+      return MDBX_CORRUPTED;
+    }
+  } else if (unlikely(meta->mm_dbs[FREE_DBI].md_root >= meta->mm_geo.next)) {
+    WARNING("meta[%u] has invalid %s-root %" PRIaPGNO ", skip it", meta_number,
+            "GC", meta->mm_dbs[FREE_DBI].md_root);
+    return MDBX_CORRUPTED;
+  }
 
-  *troika = meta_tap(env);
-  for (MDBX_txn *txn = env->me_txn0; txn; txn = txn->mt_child)
-    if (troika != &txn->tw.troika)
-      txn->tw.troika = *troika;
+  /* MainDB */
+  if (meta->mm_dbs[MAIN_DBI].md_root == P_INVALID) {
+    if (unlikely(meta->mm_dbs[MAIN_DBI].md_branch_pages ||
+                 meta->mm_dbs[MAIN_DBI].md_depth ||
+                 meta->mm_dbs[MAIN_DBI].md_entries ||
+                 meta->mm_dbs[MAIN_DBI].md_leaf_pages ||
+                 meta->mm_dbs[MAIN_DBI].md_overflow_pages)) {
+      WARNING("meta[%u] has false-empty %s", meta_number, "MainDB");
+      return MDBX_CORRUPTED;
+    }
+  } else if (unlikely(meta->mm_dbs[MAIN_DBI].md_root >= meta->mm_geo.next)) {
+    WARNING("meta[%u] has invalid %s-root %" PRIaPGNO ", skip it", meta_number,
+            "MainDB", meta->mm_dbs[MAIN_DBI].md_root);
+    return MDBX_CORRUPTED;
+  }
 
-  /* LY: shrink datafile if needed */
-  if (unlikely(shrink)) {
-    VERBOSE("shrink to %" PRIaPGNO " pages (-%" PRIaPGNO ")",
-            pending->mm_geo.now, shrink);
-    rc = dxb_resize(env, pending->mm_geo.next, pending->mm_geo.now,
-                    pending->mm_geo.upper, impilict_shrink);
-    if (rc != MDBX_SUCCESS && rc != MDBX_EPERM)
-      goto fail;
-    eASSERT(env, coherency_check_meta(env, target, true));
+  if (unlikely(meta->mm_dbs[FREE_DBI].md_mod_txnid > txnid)) {
+    WARNING("meta[%u] has wrong md_mod_txnid %" PRIaTXN " for %s, skip it",
+            meta_number, meta->mm_dbs[FREE_DBI].md_mod_txnid, "GC");
+    return MDBX_CORRUPTED;
   }
 
-  MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
-  if (likely(lck))
-    /* toggle oldest refresh */
-    atomic_store32(&lck->mti_readers_refresh_flag, false, mo_Relaxed);
+  if (unlikely(meta->mm_dbs[MAIN_DBI].md_mod_txnid > txnid)) {
+    WARNING("meta[%u] has wrong md_mod_txnid %" PRIaTXN " for %s, skip it",
+            meta_number, meta->mm_dbs[MAIN_DBI].md_mod_txnid, "MainDB");
+    return MDBX_CORRUPTED;
+  }
 
   return MDBX_SUCCESS;
+}
 
-fail:
-  env->me_flags |= MDBX_FATAL_ERROR;
-  return rc;
+static int validate_meta_copy(MDBX_env *env, const MDBX_meta *meta,
+                              MDBX_meta *dest) {
+  *dest = *meta;
+  return validate_meta(env, dest, data_page(meta),
+                       bytes2pgno(env, ptr_dist(meta, env->me_map)), nullptr);
 }
 
-static void recalculate_merge_threshold(MDBX_env *env) {
-  const size_t bytes = page_space(env);
-  env->me_merge_threshold =
-      (uint16_t)(bytes -
-                 (bytes * env->me_options.merge_threshold_16dot16_percent >>
-                  16));
-  env->me_merge_threshold_gc =
-      (uint16_t)(bytes -
-                 ((env->me_options.merge_threshold_16dot16_percent > 19005)
-                      ? bytes / 3 /* 33 % */
-                      : bytes / 4 /* 25 % */));
-}
+/* Read the environment parameters of a DB environment
+ * before mapping it into memory. */
+__cold static int read_header(MDBX_env *env, MDBX_meta *dest,
+                              const int lck_exclusive,
+                              const mdbx_mode_t mode_bits) {
+  memset(dest, 0, sizeof(MDBX_meta));
+  int rc = osal_filesize(env->me_lazy_fd, &env->me_dxb_mmap.filesize);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-__cold static void setup_pagesize(MDBX_env *env, const size_t pagesize) {
-  STATIC_ASSERT(PTRDIFF_MAX > MAX_MAPSIZE);
-  STATIC_ASSERT(MIN_PAGESIZE > sizeof(MDBX_page) + sizeof(MDBX_meta));
-  ENSURE(env, is_powerof2(pagesize));
-  ENSURE(env, pagesize >= MIN_PAGESIZE);
-  ENSURE(env, pagesize <= MAX_PAGESIZE);
-  env->me_psize = (unsigned)pagesize;
-  if (env->me_pbuf) {
-    osal_memalign_free(env->me_pbuf);
-    env->me_pbuf = nullptr;
-  }
+  unaligned_poke_u64(4, dest->mm_sign, MDBX_DATASIGN_WEAK);
+  rc = MDBX_CORRUPTED;
 
-  STATIC_ASSERT(MAX_GC1OVPAGE(MIN_PAGESIZE) > 4);
-  STATIC_ASSERT(MAX_GC1OVPAGE(MAX_PAGESIZE) < MDBX_PGL_LIMIT);
-  const intptr_t maxgc_ov1page = (pagesize - PAGEHDRSZ) / sizeof(pgno_t) - 1;
-  ENSURE(env,
-         maxgc_ov1page > 42 && maxgc_ov1page < (intptr_t)MDBX_PGL_LIMIT / 4);
-  env->me_maxgc_ov1page = (unsigned)maxgc_ov1page;
-  env->me_maxgc_per_branch =
-      (unsigned)((pagesize - PAGEHDRSZ) /
-                 (sizeof(indx_t) + sizeof(MDBX_node) + sizeof(txnid_t)));
+  /* Read twice all meta pages so we can find the latest one. */
+  unsigned loop_limit = NUM_METAS * 2;
+  /* We don't know the page size on first time. So, just guess it. */
+  unsigned guess_pagesize = 0;
+  for (unsigned loop_count = 0; loop_count < loop_limit; ++loop_count) {
+    const unsigned meta_number = loop_count % NUM_METAS;
+    const unsigned offset = (guess_pagesize             ? guess_pagesize
+                             : (loop_count > NUM_METAS) ? env->me_psize
+                                                        : env->me_os_psize) *
+                            meta_number;
 
-  STATIC_ASSERT(LEAF_NODE_MAX(MIN_PAGESIZE) > sizeof(MDBX_db) + NODESIZE + 42);
-  STATIC_ASSERT(LEAF_NODE_MAX(MAX_PAGESIZE) < UINT16_MAX);
-  STATIC_ASSERT(LEAF_NODE_MAX(MIN_PAGESIZE) >= BRANCH_NODE_MAX(MIN_PAGESIZE));
-  STATIC_ASSERT(BRANCH_NODE_MAX(MAX_PAGESIZE) > NODESIZE + 42);
-  STATIC_ASSERT(BRANCH_NODE_MAX(MAX_PAGESIZE) < UINT16_MAX);
-  const intptr_t branch_nodemax = BRANCH_NODE_MAX(pagesize);
-  const intptr_t leaf_nodemax = LEAF_NODE_MAX(pagesize);
-  ENSURE(env, branch_nodemax > (intptr_t)(NODESIZE + 42) &&
-                  branch_nodemax % 2 == 0 &&
-                  leaf_nodemax > (intptr_t)(sizeof(MDBX_db) + NODESIZE + 42) &&
-                  leaf_nodemax >= branch_nodemax &&
-                  leaf_nodemax < (int)UINT16_MAX && leaf_nodemax % 2 == 0);
-  env->me_leaf_nodemax = (unsigned)leaf_nodemax;
-  env->me_branch_nodemax = (unsigned)branch_nodemax;
-  env->me_psize2log = (uint8_t)log2n_powerof2(pagesize);
-  eASSERT(env, pgno2bytes(env, 1) == pagesize);
-  eASSERT(env, bytes2pgno(env, pagesize + pagesize) == 2);
-  recalculate_merge_threshold(env);
+    char buffer[MIN_PAGESIZE];
+    unsigned retryleft = 42;
+    while (1) {
+      TRACE("reading meta[%d]: offset %u, bytes %u, retry-left %u", meta_number,
+            offset, MIN_PAGESIZE, retryleft);
+      int err = osal_pread(env->me_lazy_fd, buffer, MIN_PAGESIZE, offset);
+      if (err == MDBX_ENODATA && offset == 0 && loop_count == 0 &&
+          env->me_dxb_mmap.filesize == 0 &&
+          mode_bits /* non-zero for DB creation */ != 0) {
+        NOTICE("read meta: empty file (%d, %s)", err, mdbx_strerror(err));
+        return err;
+      }
+#if defined(_WIN32) || defined(_WIN64)
+      if (err == ERROR_LOCK_VIOLATION) {
+        SleepEx(0, true);
+        err = osal_pread(env->me_lazy_fd, buffer, MIN_PAGESIZE, offset);
+        if (err == ERROR_LOCK_VIOLATION && --retryleft) {
+          WARNING("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
+                  mdbx_strerror(err));
+          continue;
+        }
+      }
+#endif /* Windows */
+      if (err != MDBX_SUCCESS) {
+        ERROR("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
+              mdbx_strerror(err));
+        return err;
+      }
 
-  const pgno_t max_pgno = bytes2pgno(env, MAX_MAPSIZE);
-  if (!env->me_options.flags.non_auto.dp_limit) {
-    /* auto-setup dp_limit by "The42" ;-) */
-    intptr_t total_ram_pages, avail_ram_pages;
-    int err = mdbx_get_sysraminfo(nullptr, &total_ram_pages, &avail_ram_pages);
-    if (unlikely(err != MDBX_SUCCESS))
-      ERROR("mdbx_get_sysraminfo(), rc %d", err);
-    else {
-      size_t reasonable_dpl_limit =
-          (size_t)(total_ram_pages + avail_ram_pages) / 42;
-      if (pagesize > env->me_os_psize)
-        reasonable_dpl_limit /= pagesize / env->me_os_psize;
-      else if (pagesize < env->me_os_psize)
-        reasonable_dpl_limit *= env->me_os_psize / pagesize;
-      reasonable_dpl_limit = (reasonable_dpl_limit < MDBX_PGL_LIMIT)
-                                 ? reasonable_dpl_limit
-                                 : MDBX_PGL_LIMIT;
-      reasonable_dpl_limit = (reasonable_dpl_limit > CURSOR_STACK * 4)
-                                 ? reasonable_dpl_limit
-                                 : CURSOR_STACK * 4;
-      env->me_options.dp_limit = (unsigned)reasonable_dpl_limit;
+      char again[MIN_PAGESIZE];
+      err = osal_pread(env->me_lazy_fd, again, MIN_PAGESIZE, offset);
+#if defined(_WIN32) || defined(_WIN64)
+      if (err == ERROR_LOCK_VIOLATION) {
+        SleepEx(0, true);
+        err = osal_pread(env->me_lazy_fd, again, MIN_PAGESIZE, offset);
+        if (err == ERROR_LOCK_VIOLATION && --retryleft) {
+          WARNING("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
+                  mdbx_strerror(err));
+          continue;
+        }
+      }
+#endif /* Windows */
+      if (err != MDBX_SUCCESS) {
+        ERROR("read meta[%u,%u]: %i, %s", offset, MIN_PAGESIZE, err,
+              mdbx_strerror(err));
+        return err;
+      }
+
+      if (memcmp(buffer, again, MIN_PAGESIZE) == 0 || --retryleft == 0)
+        break;
+
+      VERBOSE("meta[%u] was updated, re-read it", meta_number);
     }
-  }
-  if (env->me_options.dp_limit > max_pgno - NUM_METAS)
-    env->me_options.dp_limit = max_pgno - NUM_METAS;
-  if (env->me_options.dp_initial > env->me_options.dp_limit)
-    env->me_options.dp_initial = env->me_options.dp_limit;
-}
 
-static __inline MDBX_CONST_FUNCTION MDBX_lockinfo *
-lckless_stub(const MDBX_env *env) {
-  uintptr_t stub = (uintptr_t)&env->x_lckless_stub;
-  /* align to avoid false-positive alarm from UndefinedBehaviorSanitizer */
-  stub = (stub + MDBX_CACHELINE_SIZE - 1) & ~(MDBX_CACHELINE_SIZE - 1);
-  return (MDBX_lockinfo *)stub;
-}
+    if (!retryleft) {
+      ERROR("meta[%u] is too volatile, skip it", meta_number);
+      continue;
+    }
 
-__cold int mdbx_env_create(MDBX_env **penv) {
-  if (unlikely(!penv))
-    return MDBX_EINVAL;
-  *penv = nullptr;
+    MDBX_page *const page = (MDBX_page *)buffer;
+    MDBX_meta *const meta = page_meta(page);
+    rc = validate_meta(env, meta, page, meta_number, &guess_pagesize);
+    if (rc != MDBX_SUCCESS)
+      continue;
 
-#ifdef MDBX_HAVE_C11ATOMICS
-  if (unlikely(!atomic_is_lock_free((const volatile uint32_t *)penv))) {
-    ERROR("lock-free atomic ops for %u-bit types is required", 32);
-    return MDBX_INCOMPATIBLE;
-  }
-#if MDBX_64BIT_ATOMIC
-  if (unlikely(!atomic_is_lock_free((const volatile uint64_t *)penv))) {
-    ERROR("lock-free atomic ops for %u-bit types is required", 64);
-    return MDBX_INCOMPATIBLE;
+    bool latch;
+    if (env->me_stuck_meta >= 0)
+      latch = (meta_number == (unsigned)env->me_stuck_meta);
+    else if (meta_bootid_match(meta))
+      latch = meta_choice_recent(
+          meta->unsafe_txnid, SIGN_IS_STEADY(meta->unsafe_sign),
+          dest->unsafe_txnid, SIGN_IS_STEADY(dest->unsafe_sign));
+    else
+      latch = meta_choice_steady(
+          meta->unsafe_txnid, SIGN_IS_STEADY(meta->unsafe_sign),
+          dest->unsafe_txnid, SIGN_IS_STEADY(dest->unsafe_sign));
+    if (latch) {
+      *dest = *meta;
+      if (!lck_exclusive && !META_IS_STEADY(dest))
+        loop_limit += 1; /* LY: should re-read to hush race with update */
+      VERBOSE("latch meta[%u]", meta_number);
+    }
   }
-#endif /* MDBX_64BIT_ATOMIC */
-#endif /* MDBX_HAVE_C11ATOMICS */
 
-  const size_t os_psize = osal_syspagesize();
-  if (unlikely(!is_powerof2(os_psize) || os_psize < MIN_PAGESIZE)) {
-    ERROR("unsuitable system pagesize %" PRIuPTR, os_psize);
-    return MDBX_INCOMPATIBLE;
+  if (dest->mm_psize == 0 ||
+      (env->me_stuck_meta < 0 &&
+       !(META_IS_STEADY(dest) ||
+         meta_weak_acceptable(env, dest, lck_exclusive)))) {
+    ERROR("%s", "no usable meta-pages, database is corrupted");
+    if (rc == MDBX_SUCCESS) {
+      /* TODO: try to restore the database by fully checking b-tree structure
+       * for the each meta page, if the corresponding option was given */
+      return MDBX_CORRUPTED;
+    }
+    return rc;
   }
 
-#if defined(__linux__) || defined(__gnu_linux__)
-  if (unlikely(linux_kernel_version < 0x04000000)) {
-    /* 2022-09-01: Прошло уже больше двух после окончания какой-либо поддержки
-     * самого "долгоиграющего" ядра 3.16.85 ветки 3.x */
-    ERROR("too old linux kernel %u.%u.%u.%u, the >= 4.0.0 is required",
-          linux_kernel_version >> 24, (linux_kernel_version >> 16) & 255,
-          (linux_kernel_version >> 8) & 255, linux_kernel_version & 255);
-    return MDBX_INCOMPATIBLE;
-  }
-#endif /* Linux */
+  return MDBX_SUCCESS;
+}
 
-  MDBX_env *env = osal_calloc(1, sizeof(MDBX_env));
-  if (unlikely(!env))
-    return MDBX_ENOMEM;
+__cold static MDBX_page *meta_model(const MDBX_env *env, MDBX_page *model,
+                                    size_t num) {
+  ENSURE(env, is_powerof2(env->me_psize));
+  ENSURE(env, env->me_psize >= MIN_PAGESIZE);
+  ENSURE(env, env->me_psize <= MAX_PAGESIZE);
+  ENSURE(env, env->me_dbgeo.lower >= MIN_MAPSIZE);
+  ENSURE(env, env->me_dbgeo.upper <= MAX_MAPSIZE);
+  ENSURE(env, env->me_dbgeo.now >= env->me_dbgeo.lower);
+  ENSURE(env, env->me_dbgeo.now <= env->me_dbgeo.upper);
 
-  env->me_maxreaders = DEFAULT_READERS;
-  env->me_maxdbs = env->me_numdbs = CORE_DBS;
-  env->me_lazy_fd = env->me_dsync_fd = env->me_fd4meta = env->me_lfd =
-      INVALID_HANDLE_VALUE;
-  env->me_pid = osal_getpid();
-  env->me_stuck_meta = -1;
+  memset(model, 0, env->me_psize);
+  model->mp_pgno = (pgno_t)num;
+  model->mp_flags = P_META;
+  MDBX_meta *const model_meta = page_meta(model);
+  unaligned_poke_u64(4, model_meta->mm_magic_and_version, MDBX_DATA_MAGIC);
 
-  env->me_options.rp_augment_limit = MDBX_PNL_INITIAL;
-  env->me_options.dp_reserve_limit = MDBX_PNL_INITIAL;
-  env->me_options.dp_initial = MDBX_PNL_INITIAL;
-  env->me_options.spill_max_denominator = 8;
-  env->me_options.spill_min_denominator = 8;
-  env->me_options.spill_parent4child_denominator = 0;
-  env->me_options.dp_loose_limit = 64;
-  env->me_options.merge_threshold_16dot16_percent = 65536 / 4 /* 25% */;
-
-#if !(defined(_WIN32) || defined(_WIN64))
-  env->me_options.writethrough_threshold =
-#if defined(__linux__) || defined(__gnu_linux__)
-      mdbx_RunningOnWSL1 ? MAX_PAGENO :
-#endif /* Linux */
-                         MDBX_WRITETHROUGH_THRESHOLD_DEFAULT;
-#endif /* Windows */
-
-  env->me_os_psize = (unsigned)os_psize;
-  setup_pagesize(env, (env->me_os_psize < MAX_PAGESIZE) ? env->me_os_psize
-                                                        : MAX_PAGESIZE);
-
-  int rc = osal_fastmutex_init(&env->me_dbi_lock);
-  if (unlikely(rc != MDBX_SUCCESS))
-    goto bailout;
-
-#if defined(_WIN32) || defined(_WIN64)
-  osal_srwlock_Init(&env->me_remap_guard);
-  InitializeCriticalSection(&env->me_windowsbug_lock);
-#else
-  rc = osal_fastmutex_init(&env->me_remap_guard);
-  if (unlikely(rc != MDBX_SUCCESS)) {
-    osal_fastmutex_destroy(&env->me_dbi_lock);
-    goto bailout;
-  }
-
-#if MDBX_LOCKING > MDBX_LOCKING_SYSV
-  MDBX_lockinfo *const stub = lckless_stub(env);
-  rc = osal_ipclock_stub(&stub->mti_wlock);
-#endif /* MDBX_LOCKING */
-  if (unlikely(rc != MDBX_SUCCESS)) {
-    osal_fastmutex_destroy(&env->me_remap_guard);
-    osal_fastmutex_destroy(&env->me_dbi_lock);
-    goto bailout;
-  }
-#endif /* Windows */
+  model_meta->mm_geo.lower = bytes2pgno(env, env->me_dbgeo.lower);
+  model_meta->mm_geo.upper = bytes2pgno(env, env->me_dbgeo.upper);
+  model_meta->mm_geo.grow_pv = pages2pv(bytes2pgno(env, env->me_dbgeo.grow));
+  model_meta->mm_geo.shrink_pv =
+      pages2pv(bytes2pgno(env, env->me_dbgeo.shrink));
+  model_meta->mm_geo.now = bytes2pgno(env, env->me_dbgeo.now);
+  model_meta->mm_geo.next = NUM_METAS;
 
-  VALGRIND_CREATE_MEMPOOL(env, 0, 0);
-  env->me_signature.weak = MDBX_ME_SIGNATURE;
-  *penv = env;
-  return MDBX_SUCCESS;
+  ENSURE(env, model_meta->mm_geo.lower >= MIN_PAGENO);
+  ENSURE(env, model_meta->mm_geo.upper <= MAX_PAGENO + 1);
+  ENSURE(env, model_meta->mm_geo.now >= model_meta->mm_geo.lower);
+  ENSURE(env, model_meta->mm_geo.now <= model_meta->mm_geo.upper);
+  ENSURE(env, model_meta->mm_geo.next >= MIN_PAGENO);
+  ENSURE(env, model_meta->mm_geo.next <= model_meta->mm_geo.now);
+  ENSURE(env, model_meta->mm_geo.grow_pv ==
+                  pages2pv(pv2pages(model_meta->mm_geo.grow_pv)));
+  ENSURE(env, model_meta->mm_geo.shrink_pv ==
+                  pages2pv(pv2pages(model_meta->mm_geo.shrink_pv)));
 
-bailout:
-  osal_free(env);
-  return rc;
+  model_meta->mm_psize = env->me_psize;
+  model_meta->mm_dbs[FREE_DBI].md_flags = MDBX_INTEGERKEY;
+  model_meta->mm_dbs[FREE_DBI].md_root = P_INVALID;
+  model_meta->mm_dbs[MAIN_DBI].md_root = P_INVALID;
+  meta_set_txnid(env, model_meta, MIN_TXNID + num);
+  unaligned_poke_u64(4, model_meta->mm_sign, meta_sign(model_meta));
+  eASSERT(env, coherency_check_meta(env, model_meta, true));
+  return ptr_disp(model, env->me_psize);
 }
 
-__cold static intptr_t get_reasonable_db_maxsize(intptr_t *cached_result) {
-  if (*cached_result == 0) {
-    intptr_t pagesize, total_ram_pages;
-    if (unlikely(mdbx_get_sysraminfo(&pagesize, &total_ram_pages, nullptr) !=
-                 MDBX_SUCCESS))
-      return *cached_result = MAX_MAPSIZE32 /* the 32-bit limit is good enough
-                                               for fallback */
-          ;
-
-    if (unlikely((size_t)total_ram_pages * 2 > MAX_MAPSIZE / (size_t)pagesize))
-      return *cached_result = MAX_MAPSIZE;
-    assert(MAX_MAPSIZE >= (size_t)(total_ram_pages * pagesize * 2));
-
-    /* Suggesting should not be more than golden ratio of the size of RAM. */
-    *cached_result = (intptr_t)((size_t)total_ram_pages * 207 >> 7) * pagesize;
-
-    /* Round to the nearest human-readable granulation. */
-    for (size_t unit = MEGABYTE; unit; unit <<= 5) {
-      const size_t floor = floor_powerof2(*cached_result, unit);
-      const size_t ceil = ceil_powerof2(*cached_result, unit);
-      const size_t threshold = (size_t)*cached_result >> 4;
-      const bool down =
-          *cached_result - floor < ceil - *cached_result || ceil > MAX_MAPSIZE;
-      if (threshold < (down ? *cached_result - floor : ceil - *cached_result))
-        break;
-      *cached_result = down ? floor : ceil;
-    }
-  }
-  return *cached_result;
+/* Fill in most of the zeroed meta-pages for an empty database environment.
+ * Return pointer to recently (head) meta-page. */
+__cold static MDBX_meta *init_metas(const MDBX_env *env, void *buffer) {
+  MDBX_page *page0 = (MDBX_page *)buffer;
+  MDBX_page *page1 = meta_model(env, page0, 0);
+  MDBX_page *page2 = meta_model(env, page1, 1);
+  meta_model(env, page2, 2);
+  return page_meta(page2);
 }
 
-__cold LIBMDBX_API int
-mdbx_env_set_geometry(MDBX_env *env, intptr_t size_lower, intptr_t size_now,
-                      intptr_t size_upper, intptr_t growth_step,
-                      intptr_t shrink_threshold, intptr_t pagesize) {
-  int rc = check_env(env, false);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+static int sync_locked(MDBX_env *env, unsigned flags, MDBX_meta *const pending,
+                       meta_troika_t *const troika) {
+  eASSERT(env, ((env->me_flags ^ flags) & MDBX_WRITEMAP) == 0);
+  const MDBX_meta *const meta0 = METAPAGE(env, 0);
+  const MDBX_meta *const meta1 = METAPAGE(env, 1);
+  const MDBX_meta *const meta2 = METAPAGE(env, 2);
+  const meta_ptr_t head = meta_recent(env, troika);
+  int rc;
 
-  const bool inside_txn =
-      (env->me_txn0 && env->me_txn0->mt_owner == osal_thread_self());
+  eASSERT(env,
+          pending < METAPAGE(env, 0) || pending > METAPAGE(env, NUM_METAS));
+  eASSERT(env, (env->me_flags & (MDBX_RDONLY | MDBX_FATAL_ERROR)) == 0);
+  eASSERT(env, pending->mm_geo.next <= pending->mm_geo.now);
 
-#if MDBX_DEBUG
-  if (growth_step < 0) {
-    growth_step = 1;
-    if (shrink_threshold < 0)
-      shrink_threshold = 1;
+  if (flags & MDBX_SAFE_NOSYNC) {
+    /* Check auto-sync conditions */
+    const pgno_t autosync_threshold =
+        atomic_load32(&env->me_lck->mti_autosync_threshold, mo_Relaxed);
+    const uint64_t autosync_period =
+        atomic_load64(&env->me_lck->mti_autosync_period, mo_Relaxed);
+    uint64_t eoos_timestamp;
+    if ((autosync_threshold &&
+         atomic_load64(&env->me_lck->mti_unsynced_pages, mo_Relaxed) >=
+             autosync_threshold) ||
+        (autosync_period &&
+         (eoos_timestamp =
+              atomic_load64(&env->me_lck->mti_eoos_timestamp, mo_Relaxed)) &&
+         osal_monotime() - eoos_timestamp >= autosync_period))
+      flags &= MDBX_WRITEMAP | MDBX_SHRINK_ALLOWED; /* force steady */
   }
-#endif /* MDBX_DEBUG */
-
-  intptr_t reasonable_maxsize = 0;
-  bool need_unlock = false;
-  if (env->me_map) {
-    /* env already mapped */
-    if (unlikely(env->me_flags & MDBX_RDONLY))
-      return MDBX_EACCESS;
-
-    if (!inside_txn) {
-      int err = mdbx_txn_lock(env, false);
-      if (unlikely(err != MDBX_SUCCESS))
-        return err;
-      need_unlock = true;
-      env->me_txn0->tw.troika = meta_tap(env);
-      eASSERT(env, !env->me_txn && !env->me_txn0->mt_child);
-      env->me_txn0->mt_txnid =
-          env->me_txn0->tw.troika.txnid[env->me_txn0->tw.troika.recent];
-      txn_oldest_reader(env->me_txn0);
-    }
-
-    /* get untouched params from current TXN or DB */
-    if (pagesize <= 0 || pagesize >= INT_MAX)
-      pagesize = env->me_psize;
-    const MDBX_geo *const geo =
-        inside_txn ? &env->me_txn->mt_geo
-                   : &meta_recent(env, &env->me_txn0->tw.troika).ptr_c->mm_geo;
-    if (size_lower < 0)
-      size_lower = pgno2bytes(env, geo->lower);
-    if (size_now < 0)
-      size_now = pgno2bytes(env, geo->now);
-    if (size_upper < 0)
-      size_upper = pgno2bytes(env, geo->upper);
-    if (growth_step < 0)
-      growth_step = pgno2bytes(env, pv2pages(geo->grow_pv));
-    if (shrink_threshold < 0)
-      shrink_threshold = pgno2bytes(env, pv2pages(geo->shrink_pv));
-
-    if (pagesize != (intptr_t)env->me_psize) {
-      rc = MDBX_EINVAL;
-      goto bailout;
-    }
-    const size_t usedbytes =
-        pgno2bytes(env, find_largest_snapshot(env, geo->next));
-    if ((size_t)size_upper < usedbytes) {
-      rc = MDBX_MAP_FULL;
-      goto bailout;
-    }
-    if ((size_t)size_now < usedbytes)
-      size_now = usedbytes;
-  } else {
-    /* env NOT yet mapped */
-    if (unlikely(inside_txn))
-      return MDBX_PANIC;
 
-    /* is requested some auto-value for pagesize ? */
-    if (pagesize >= INT_MAX /* maximal */)
-      pagesize = MAX_PAGESIZE;
-    else if (pagesize <= 0) {
-      if (pagesize < 0 /* default */) {
-        pagesize = env->me_os_psize;
-        if ((uintptr_t)pagesize > MAX_PAGESIZE)
-          pagesize = MAX_PAGESIZE;
-        eASSERT(env, (uintptr_t)pagesize >= MIN_PAGESIZE);
-      } else if (pagesize == 0 /* minimal */)
-        pagesize = MIN_PAGESIZE;
+  pgno_t shrink = 0;
+  if (flags & MDBX_SHRINK_ALLOWED) {
+    const size_t prev_discarded_pgno =
+        atomic_load32(&env->me_lck->mti_discarded_tail, mo_Relaxed);
+    if (prev_discarded_pgno < pending->mm_geo.next)
+      env->me_lck->mti_discarded_tail.weak = pending->mm_geo.next;
+    else if (prev_discarded_pgno >=
+             pending->mm_geo.next + env->me_madv_threshold) {
+      /* LY: check conditions to discard unused pages */
+      const pgno_t largest_pgno = find_largest_snapshot(
+          env, (head.ptr_c->mm_geo.next > pending->mm_geo.next)
+                   ? head.ptr_c->mm_geo.next
+                   : pending->mm_geo.next);
+      eASSERT(env, largest_pgno >= NUM_METAS);
 
-      /* choose pagesize */
-      intptr_t max_size = (size_now > size_lower) ? size_now : size_lower;
-      max_size = (size_upper > max_size) ? size_upper : max_size;
-      if (max_size < 0 /* default */)
-        max_size = DEFAULT_MAPSIZE;
-      else if (max_size == 0 /* minimal */)
-        max_size = MIN_MAPSIZE;
-      else if (max_size >= (intptr_t)MAX_MAPSIZE /* maximal */)
-        max_size = get_reasonable_db_maxsize(&reasonable_maxsize);
+#if defined(MDBX_USE_VALGRIND) || defined(__SANITIZE_ADDRESS__)
+      const pgno_t edge = env->me_poison_edge;
+      if (edge > largest_pgno) {
+        env->me_poison_edge = largest_pgno;
+        VALGRIND_MAKE_MEM_NOACCESS(
+            ptr_disp(env->me_map, pgno2bytes(env, largest_pgno)),
+            pgno2bytes(env, edge - largest_pgno));
+        MDBX_ASAN_POISON_MEMORY_REGION(
+            ptr_disp(env->me_map, pgno2bytes(env, largest_pgno)),
+            pgno2bytes(env, edge - largest_pgno));
+      }
+#endif /* MDBX_USE_VALGRIND || __SANITIZE_ADDRESS__ */
 
-      while (max_size > pagesize * (int64_t)(MAX_PAGENO + 1) &&
-             pagesize < MAX_PAGESIZE)
-        pagesize <<= 1;
-    }
-  }
+#if MDBX_ENABLE_MADVISE &&                                                     \
+    (defined(MADV_DONTNEED) || defined(POSIX_MADV_DONTNEED))
+      const size_t discard_edge_pgno = pgno_align2os_pgno(env, largest_pgno);
+      if (prev_discarded_pgno >= discard_edge_pgno + env->me_madv_threshold) {
+        const size_t prev_discarded_bytes =
+            pgno_align2os_bytes(env, prev_discarded_pgno);
+        const size_t discard_edge_bytes = pgno2bytes(env, discard_edge_pgno);
+        /* из-за выравнивания prev_discarded_bytes и discard_edge_bytes
+         * могут быть равны */
+        if (prev_discarded_bytes > discard_edge_bytes) {
+          NOTICE("shrink-MADV_%s %zu..%zu", "DONTNEED", discard_edge_pgno,
+                 prev_discarded_pgno);
+          munlock_after(env, discard_edge_pgno,
+                        bytes_align2os_bytes(env, env->me_dxb_mmap.current));
+          const uint32_t munlocks_before =
+              atomic_load32(&env->me_lck->mti_mlcnt[1], mo_Relaxed);
+#if defined(MADV_DONTNEED)
+          int advise = MADV_DONTNEED;
+#if defined(MADV_FREE) &&                                                      \
+    0 /* MADV_FREE works for only anonymous vma at the moment */
+          if ((env->me_flags & MDBX_WRITEMAP) &&
+              linux_kernel_version > 0x04050000)
+            advise = MADV_FREE;
+#endif /* MADV_FREE */
+          int err = madvise(ptr_disp(env->me_map, discard_edge_bytes),
+                            prev_discarded_bytes - discard_edge_bytes, advise)
+                        ? ignore_enosys(errno)
+                        : MDBX_SUCCESS;
+#else
+          int err = ignore_enosys(posix_madvise(
+              ptr_disp(env->me_map, discard_edge_bytes),
+              prev_discarded_bytes - discard_edge_bytes, POSIX_MADV_DONTNEED));
+#endif
+          if (unlikely(MDBX_IS_ERROR(err))) {
+            const uint32_t mlocks_after =
+                atomic_load32(&env->me_lck->mti_mlcnt[0], mo_Relaxed);
+            if (err == MDBX_EINVAL) {
+              const int severity = (mlocks_after - munlocks_before)
+                                       ? MDBX_LOG_NOTICE
+                                       : MDBX_LOG_WARN;
+              if (LOG_ENABLED(severity))
+                debug_log(
+                    severity, __func__, __LINE__,
+                    "%s-madvise: ignore EINVAL (%d) since some pages maybe "
+                    "locked (%u/%u mlcnt-processes)",
+                    "shrink", err, mlocks_after, munlocks_before);
+            } else {
+              ERROR("%s-madvise(%s, %zu, +%zu), %u/%u mlcnt-processes, err %d",
+                    "shrink", "DONTNEED", discard_edge_bytes,
+                    prev_discarded_bytes - discard_edge_bytes, mlocks_after,
+                    munlocks_before, err);
+              return err;
+            }
+          } else
+            env->me_lck->mti_discarded_tail.weak = discard_edge_pgno;
+        }
+      }
+#endif /* MDBX_ENABLE_MADVISE && (MADV_DONTNEED || POSIX_MADV_DONTNEED) */
 
-  if (pagesize < (intptr_t)MIN_PAGESIZE || pagesize > (intptr_t)MAX_PAGESIZE ||
-      !is_powerof2(pagesize)) {
-    rc = MDBX_EINVAL;
-    goto bailout;
+      /* LY: check conditions to shrink datafile */
+      const pgno_t backlog_gap = 3 + pending->mm_dbs[FREE_DBI].md_depth * 3;
+      pgno_t shrink_step = 0;
+      if (pending->mm_geo.shrink_pv &&
+          pending->mm_geo.now - pending->mm_geo.next >
+              (shrink_step = pv2pages(pending->mm_geo.shrink_pv)) +
+                  backlog_gap) {
+        if (pending->mm_geo.now > largest_pgno &&
+            pending->mm_geo.now - largest_pgno > shrink_step + backlog_gap) {
+          const pgno_t aligner =
+              pending->mm_geo.grow_pv
+                  ? /* grow_step */ pv2pages(pending->mm_geo.grow_pv)
+                  : shrink_step;
+          const pgno_t with_backlog_gap = largest_pgno + backlog_gap;
+          const pgno_t aligned =
+              pgno_align2os_pgno(env, (size_t)with_backlog_gap + aligner -
+                                          with_backlog_gap % aligner);
+          const pgno_t bottom = (aligned > pending->mm_geo.lower)
+                                    ? aligned
+                                    : pending->mm_geo.lower;
+          if (pending->mm_geo.now > bottom) {
+            if (TROIKA_HAVE_STEADY(troika))
+              /* force steady, but only if steady-checkpoint is present */
+              flags &= MDBX_WRITEMAP | MDBX_SHRINK_ALLOWED;
+            shrink = pending->mm_geo.now - bottom;
+            pending->mm_geo.now = bottom;
+            if (unlikely(head.txnid == pending->unsafe_txnid)) {
+              const txnid_t txnid = safe64_txnid_next(pending->unsafe_txnid);
+              NOTICE("force-forward pending-txn %" PRIaTXN " -> %" PRIaTXN,
+                     pending->unsafe_txnid, txnid);
+              ENSURE(env, !env->me_txn0 ||
+                              (env->me_txn0->mt_owner != osal_thread_self() &&
+                               !env->me_txn));
+              if (unlikely(txnid > MAX_TXNID)) {
+                rc = MDBX_TXN_FULL;
+                ERROR("txnid overflow, raise %d", rc);
+                goto fail;
+              }
+              meta_set_txnid(env, pending, txnid);
+              eASSERT(env, coherency_check_meta(env, pending, true));
+            }
+          }
+        }
+      }
+    }
   }
 
-  if (size_lower <= 0) {
-    size_lower = MIN_MAPSIZE;
-    if (MIN_MAPSIZE / pagesize < MIN_PAGENO)
-      size_lower = MIN_PAGENO * pagesize;
-  }
-  if (size_lower >= INTPTR_MAX) {
-    size_lower = get_reasonable_db_maxsize(&reasonable_maxsize);
-    if ((size_t)size_lower / pagesize > MAX_PAGENO + 1)
-      size_lower = pagesize * (MAX_PAGENO + 1);
+  /* LY: step#1 - sync previously written/updated data-pages */
+  rc = MDBX_RESULT_FALSE /* carry steady */;
+  if (atomic_load64(&env->me_lck->mti_unsynced_pages, mo_Relaxed)) {
+    eASSERT(env, ((flags ^ env->me_flags) & MDBX_WRITEMAP) == 0);
+    enum osal_syncmode_bits mode_bits = MDBX_SYNC_NONE;
+    unsigned sync_op = 0;
+    if ((flags & MDBX_SAFE_NOSYNC) == 0) {
+      sync_op = 1;
+      mode_bits = MDBX_SYNC_DATA;
+      if (pending->mm_geo.next >
+          meta_prefer_steady(env, troika).ptr_c->mm_geo.now)
+        mode_bits |= MDBX_SYNC_SIZE;
+      if (flags & MDBX_NOMETASYNC)
+        mode_bits |= MDBX_SYNC_IODQ;
+    } else if (unlikely(env->me_incore))
+      goto skip_incore_sync;
+    if (flags & MDBX_WRITEMAP) {
+#if MDBX_ENABLE_PGOP_STAT
+      env->me_lck->mti_pgop_stat.msync.weak += sync_op;
+#else
+      (void)sync_op;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+      rc =
+          osal_msync(&env->me_dxb_mmap, 0,
+                     pgno_align2os_bytes(env, pending->mm_geo.next), mode_bits);
+    } else {
+#if MDBX_ENABLE_PGOP_STAT
+      env->me_lck->mti_pgop_stat.fsync.weak += sync_op;
+#else
+      (void)sync_op;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+      rc = osal_fsync(env->me_lazy_fd, mode_bits);
+    }
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto fail;
+    if (sync_op) {
+      /* значения должны оказаться на диске не позже ссылок на них */
+      rc = vlog_sync(env);
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto fail;
+    }
+    rc = (flags & MDBX_SAFE_NOSYNC) ? MDBX_RESULT_TRUE /* carry non-steady */
+                                    : MDBX_RESULT_FALSE /* carry steady */;
   }
+  eASSERT(env, coherency_check_meta(env, pending, true));
 
-  if (size_now <= 0) {
-    size_now = size_lower;
-    if (size_upper >= size_lower && size_now > size_upper)
-      size_now = size_upper;
-  }
-  if (size_now >= INTPTR_MAX) {
-    size_now = get_reasonable_db_maxsize(&reasonable_maxsize);
-    if ((size_t)size_now / pagesize > MAX_PAGENO + 1)
-      size_now = pagesize * (MAX_PAGENO + 1);
+  /* Steady or Weak */
+  if (rc == MDBX_RESULT_FALSE /* carry steady */) {
+    unaligned_poke_u64(4, pending->mm_sign, meta_sign(pending));
+    atomic_store64(&env->me_lck->mti_eoos_timestamp, 0, mo_Relaxed);
+    atomic_store64(&env->me_lck->mti_unsynced_pages, 0, mo_Relaxed);
+  } else {
+    assert(rc == MDBX_RESULT_TRUE /* carry non-steady */);
+  skip_incore_sync:
+    eASSERT(env, env->me_lck->mti_unsynced_pages.weak > 0);
+    /* Может быть нулевым если unsynced_pages > 0 в результате спиллинга.
+     * eASSERT(env, env->me_lck->mti_eoos_timestamp.weak != 0); */
+    unaligned_poke_u64(4, pending->mm_sign, MDBX_DATASIGN_WEAK);
   }
 
-  if (size_upper <= 0) {
-    if (size_now >= get_reasonable_db_maxsize(&reasonable_maxsize) / 2)
-      size_upper = get_reasonable_db_maxsize(&reasonable_maxsize);
-    else if (MAX_MAPSIZE != MAX_MAPSIZE32 &&
-             (size_t)size_now >= MAX_MAPSIZE32 / 2 &&
-             (size_t)size_now <= MAX_MAPSIZE32 / 4 * 3)
-      size_upper = MAX_MAPSIZE32;
+  const bool legal4overwrite =
+      head.txnid == pending->unsafe_txnid &&
+      memcmp(&head.ptr_c->mm_dbs, &pending->mm_dbs, sizeof(pending->mm_dbs)) ==
+          0 &&
+      memcmp(&head.ptr_c->mm_canary, &pending->mm_canary,
+             sizeof(pending->mm_canary)) == 0 &&
+      memcmp(&head.ptr_c->mm_geo, &pending->mm_geo, sizeof(pending->mm_geo)) ==
+          0;
+  MDBX_meta *target = nullptr;
+  if (head.txnid == pending->unsafe_txnid) {
+    ENSURE(env, legal4overwrite);
+    if (!head.is_steady && META_IS_STEADY(pending))
+      target = (MDBX_meta *)head.ptr_c;
     else {
-      size_upper = size_now + size_now;
-      if ((size_t)size_upper < DEFAULT_MAPSIZE * 2)
-        size_upper = DEFAULT_MAPSIZE * 2;
+      WARNING("%s", "skip update meta");
+      return MDBX_SUCCESS;
     }
-    if ((size_t)size_upper / pagesize > (MAX_PAGENO + 1))
-      size_upper = pagesize * (MAX_PAGENO + 1);
-  } else if (size_upper >= INTPTR_MAX) {
-    size_upper = get_reasonable_db_maxsize(&reasonable_maxsize);
-    if ((size_t)size_upper / pagesize > MAX_PAGENO + 1)
-      size_upper = pagesize * (MAX_PAGENO + 1);
+  } else {
+    const unsigned troika_tail = troika->tail_and_flags & 3;
+    ENSURE(env, troika_tail < NUM_METAS && troika_tail != troika->recent &&
+                    troika_tail != troika->prefer_steady);
+    target = (MDBX_meta *)meta_tail(env, troika).ptr_c;
   }
 
-  if (unlikely(size_lower < (intptr_t)MIN_MAPSIZE || size_lower > size_upper)) {
-    rc = MDBX_EINVAL;
-    goto bailout;
-  }
+  /* LY: step#2 - update meta-page. */
+  DEBUG("writing meta%" PRIaPGNO " = root %" PRIaPGNO "/%" PRIaPGNO
+        ", geo %" PRIaPGNO "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO
+        " +%u -%u, txn_id %" PRIaTXN ", %s",
+        data_page(target)->mp_pgno, pending->mm_dbs[MAIN_DBI].md_root,
+        pending->mm_dbs[FREE_DBI].md_root, pending->mm_geo.lower,
+        pending->mm_geo.next, pending->mm_geo.now, pending->mm_geo.upper,
+        pv2pages(pending->mm_geo.grow_pv), pv2pages(pending->mm_geo.shrink_pv),
+        pending->unsafe_txnid, durable_caption(pending));
 
-  if ((uint64_t)size_lower / pagesize < MIN_PAGENO) {
-    size_lower = pagesize * MIN_PAGENO;
-    if (unlikely(size_lower > size_upper)) {
-      rc = MDBX_EINVAL;
-      goto bailout;
-    }
-    if (size_now < size_lower)
-      size_now = size_lower;
-  }
+  DEBUG("meta0: %s, %s, txn_id %" PRIaTXN ", root %" PRIaPGNO "/%" PRIaPGNO,
+        (meta0 == head.ptr_c) ? "head"
+        : (meta0 == target)   ? "tail"
+                              : "stay",
+        durable_caption(meta0), constmeta_txnid(meta0),
+        meta0->mm_dbs[MAIN_DBI].md_root, meta0->mm_dbs[FREE_DBI].md_root);
+  DEBUG("meta1: %s, %s, txn_id %" PRIaTXN ", root %" PRIaPGNO "/%" PRIaPGNO,
+        (meta1 == head.ptr_c) ? "head"
+        : (meta1 == target)   ? "tail"
+                              : "stay",
+        durable_caption(meta1), constmeta_txnid(meta1),
+        meta1->mm_dbs[MAIN_DBI].md_root, meta1->mm_dbs[FREE_DBI].md_root);
+  DEBUG("meta2: %s, %s, txn_id %" PRIaTXN ", root %" PRIaPGNO "/%" PRIaPGNO,
+        (meta2 == head.ptr_c) ? "head"
+        : (meta2 == target)   ? "tail"
+                              : "stay",
+        durable_caption(meta2), constmeta_txnid(meta2),
+        meta2->mm_dbs[MAIN_DBI].md_root, meta2->mm_dbs[FREE_DBI].md_root);
 
-  if (unlikely((size_t)size_upper > MAX_MAPSIZE ||
-               (uint64_t)size_upper / pagesize > MAX_PAGENO + 1)) {
-    rc = MDBX_TOO_LARGE;
-    goto bailout;
-  }
+  eASSERT(env, pending->unsafe_txnid != constmeta_txnid(meta0) ||
+                   (META_IS_STEADY(pending) && !META_IS_STEADY(meta0)));
+  eASSERT(env, pending->unsafe_txnid != constmeta_txnid(meta1) ||
+                   (META_IS_STEADY(pending) && !META_IS_STEADY(meta1)));
+  eASSERT(env, pending->unsafe_txnid != constmeta_txnid(meta2) ||
+                   (META_IS_STEADY(pending) && !META_IS_STEADY(meta2)));
 
-  const size_t unit = (env->me_os_psize > (size_t)pagesize) ? env->me_os_psize
-                                                            : (size_t)pagesize;
-  size_lower = ceil_powerof2(size_lower, unit);
-  size_upper = ceil_powerof2(size_upper, unit);
-  size_now = ceil_powerof2(size_now, unit);
+  eASSERT(env, ((env->me_flags ^ flags) & MDBX_WRITEMAP) == 0);
+  ENSURE(env, target == head.ptr_c ||
+                  constmeta_txnid(target) < pending->unsafe_txnid);
+  if (flags & MDBX_WRITEMAP) {
+    jitter4testing(true);
+    if (likely(target != head.ptr_c)) {
+      /* LY: 'invalidate' the meta. */
+      meta_update_begin(env, target, pending->unsafe_txnid);
+      unaligned_poke_u64(4, target->mm_sign, MDBX_DATASIGN_WEAK);
+#ifndef NDEBUG
+      /* debug: provoke failure to catch a violators, but don't touch mm_psize
+       * to allow readers catch actual pagesize. */
+      void *provoke_begin = &target->mm_dbs[FREE_DBI].md_root;
+      void *provoke_end = &target->mm_sign;
+      memset(provoke_begin, 0xCC, ptr_dist(provoke_end, provoke_begin));
+      jitter4testing(false);
+#endif
 
-  /* LY: подбираем значение size_upper:
-   *  - кратное размеру страницы
-   *  - без нарушения MAX_MAPSIZE и MAX_PAGENO */
-  while (unlikely((size_t)size_upper > MAX_MAPSIZE ||
-                  (uint64_t)size_upper / pagesize > MAX_PAGENO + 1)) {
-    if ((size_t)size_upper < unit + MIN_MAPSIZE ||
-        (size_t)size_upper < (size_t)pagesize * (MIN_PAGENO + 1)) {
-      /* паранойа на случай переполнения при невероятных значениях */
-      rc = MDBX_EINVAL;
-      goto bailout;
+      /* LY: update info */
+      target->mm_geo = pending->mm_geo;
+      target->mm_dbs[FREE_DBI] = pending->mm_dbs[FREE_DBI];
+      target->mm_dbs[MAIN_DBI] = pending->mm_dbs[MAIN_DBI];
+      target->mm_canary = pending->mm_canary;
+      memcpy(target->mm_pages_retired, pending->mm_pages_retired, 8);
+      jitter4testing(true);
+
+      /* LY: 'commit' the meta */
+      meta_update_end(env, target, unaligned_peek_u64(4, pending->mm_txnid_b));
+      jitter4testing(true);
+      eASSERT(env, coherency_check_meta(env, target, true));
+    } else {
+      /* dangerous case (target == head), only mm_sign could
+       * me updated, check assertions once again */
+      eASSERT(env,
+              legal4overwrite && !head.is_steady && META_IS_STEADY(pending));
+    }
+    memcpy(target->mm_sign, pending->mm_sign, 8);
+    osal_flush_incoherent_cpu_writeback();
+    jitter4testing(true);
+    if (!env->me_incore) {
+      if (!MDBX_AVOID_MSYNC) {
+        /* sync meta-pages */
+#if MDBX_ENABLE_PGOP_STAT
+        env->me_lck->mti_pgop_stat.msync.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+        rc = osal_msync(
+            &env->me_dxb_mmap, 0, pgno_align2os_bytes(env, NUM_METAS),
+            (flags & MDBX_NOMETASYNC) ? MDBX_SYNC_NONE
+                                      : MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
+      } else {
+#if MDBX_ENABLE_PGOP_STAT
+        env->me_lck->mti_pgop_stat.wops.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+        const MDBX_page *page = data_page(target);
+        rc = osal_pwrite(env->me_fd4meta, page, env->me_psize,
+                         ptr_dist(page, env->me_map));
+        if (likely(rc == MDBX_SUCCESS)) {
+          osal_flush_incoherent_mmap(target, sizeof(MDBX_meta),
+                                     env->me_os_psize);
+          if ((flags & MDBX_NOMETASYNC) == 0 &&
+              env->me_fd4meta == env->me_lazy_fd) {
+#if MDBX_ENABLE_PGOP_STAT
+            env->me_lck->mti_pgop_stat.fsync.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+            rc = osal_fsync(env->me_lazy_fd, MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
+          }
+        }
+      }
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto fail;
+    }
+  } else {
+#if MDBX_ENABLE_PGOP_STAT
+    env->me_lck->mti_pgop_stat.wops.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+    const MDBX_meta undo_meta = *target;
+    rc = osal_pwrite(env->me_fd4meta, pending, sizeof(MDBX_meta),
+                     ptr_dist(target, env->me_map));
+    if (unlikely(rc != MDBX_SUCCESS)) {
+    undo:
+      DEBUG("%s", "write failed, disk error?");
+      /* On a failure, the pagecache still contains the new data.
+       * Try write some old data back, to prevent it from being used. */
+      osal_pwrite(env->me_fd4meta, &undo_meta, sizeof(MDBX_meta),
+                  ptr_dist(target, env->me_map));
+      goto fail;
+    }
+    osal_flush_incoherent_mmap(target, sizeof(MDBX_meta), env->me_os_psize);
+    /* sync meta-pages */
+    if ((flags & MDBX_NOMETASYNC) == 0 && env->me_fd4meta == env->me_lazy_fd &&
+        !env->me_incore) {
+#if MDBX_ENABLE_PGOP_STAT
+      env->me_lck->mti_pgop_stat.fsync.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+      rc = osal_fsync(env->me_lazy_fd, MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
+      if (rc != MDBX_SUCCESS)
+        goto undo;
     }
-    size_upper -= unit;
-    if ((size_t)size_upper < (size_t)size_lower)
-      size_lower = size_upper;
   }
-  eASSERT(env, (size_upper - size_lower) % env->me_os_psize == 0);
-
-  if (size_now < size_lower)
-    size_now = size_lower;
-  if (size_now > size_upper)
-    size_now = size_upper;
 
-  if (growth_step < 0) {
-    growth_step = ((size_t)(size_upper - size_lower)) / 42;
-    if (growth_step > size_lower && size_lower < (intptr_t)MEGABYTE)
-      growth_step = size_lower;
-    if (growth_step < 65536)
-      growth_step = 65536;
-    if ((size_t)growth_step > MAX_MAPSIZE / 64)
-      growth_step = MAX_MAPSIZE / 64;
+  uint64_t timestamp = 0;
+  while ("workaround for https://libmdbx.dqdkfa.ru/dead-github/issues/269") {
+    rc =
+        coherency_check_written(env, pending->unsafe_txnid, target, &timestamp);
+    if (likely(rc == MDBX_SUCCESS))
+      break;
+    if (unlikely(rc != MDBX_RESULT_TRUE))
+      goto fail;
   }
-  if (growth_step == 0 && shrink_threshold > 0)
-    growth_step = 1;
-  growth_step = ceil_powerof2(growth_step, unit);
 
-  if (shrink_threshold < 0)
-    shrink_threshold = growth_step + growth_step;
-  shrink_threshold = ceil_powerof2(shrink_threshold, unit);
+  const uint32_t sync_txnid_dist =
+      ((flags & MDBX_NOMETASYNC) == 0) ? 0
+      : ((flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC)
+          ? MDBX_NOMETASYNC_LAZY_FD
+          : MDBX_NOMETASYNC_LAZY_WRITEMAP;
+  env->me_lck->mti_meta_sync_txnid.weak =
+      pending->mm_txnid_a[__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__].weak -
+      sync_txnid_dist;
 
-  //----------------------------------------------------------------------------
+  *troika = meta_tap(env);
+  for (MDBX_txn *txn = env->me_txn0; txn; txn = txn->mt_child)
+    if (troika != &txn->tw.troika)
+      txn->tw.troika = *troika;
 
-  if (!env->me_map) {
-    /* save user's geo-params for future open/create */
-    if (pagesize != (intptr_t)env->me_psize)
-      setup_pagesize(env, pagesize);
-    env->me_dbgeo.lower = size_lower;
-    env->me_dbgeo.now = size_now;
-    env->me_dbgeo.upper = size_upper;
-    env->me_dbgeo.grow =
-        pgno2bytes(env, pv2pages(pages2pv(bytes2pgno(env, growth_step))));
-    env->me_dbgeo.shrink =
-        pgno2bytes(env, pv2pages(pages2pv(bytes2pgno(env, shrink_threshold))));
-    adjust_defaults(env);
+  /* LY: shrink datafile if needed */
+  if (unlikely(shrink)) {
+    VERBOSE("shrink to %" PRIaPGNO " pages (-%" PRIaPGNO ")",
+            pending->mm_geo.now, shrink);
+    rc = dxb_resize(env, pending->mm_geo.next, pending->mm_geo.now,
+                    pending->mm_geo.upper, impilict_shrink);
+    if (rc != MDBX_SUCCESS && rc != MDBX_EPERM)
+      goto fail;
+    eASSERT(env, coherency_check_meta(env, target, true));
+  }
 
-    ENSURE(env, env->me_dbgeo.lower >= MIN_MAPSIZE);
-    ENSURE(env, env->me_dbgeo.lower / (unsigned)pagesize >= MIN_PAGENO);
-    ENSURE(env, env->me_dbgeo.lower % (unsigned)pagesize == 0);
-    ENSURE(env, env->me_dbgeo.lower % env->me_os_psize == 0);
+  MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
+  if (likely(lck))
+    /* toggle oldest refresh */
+    atomic_store32(&lck->mti_readers_refresh_flag, false, mo_Relaxed);
 
-    ENSURE(env, env->me_dbgeo.upper <= MAX_MAPSIZE);
-    ENSURE(env, env->me_dbgeo.upper / (unsigned)pagesize <= MAX_PAGENO + 1);
-    ENSURE(env, env->me_dbgeo.upper % (unsigned)pagesize == 0);
-    ENSURE(env, env->me_dbgeo.upper % env->me_os_psize == 0);
+  return MDBX_SUCCESS;
 
-    ENSURE(env, env->me_dbgeo.now >= env->me_dbgeo.lower);
-    ENSURE(env, env->me_dbgeo.now <= env->me_dbgeo.upper);
-    ENSURE(env, env->me_dbgeo.now % (unsigned)pagesize == 0);
-    ENSURE(env, env->me_dbgeo.now % env->me_os_psize == 0);
+fail:
+  env->me_flags |= MDBX_FATAL_ERROR;
+  return rc;
+}
 
-    ENSURE(env, env->me_dbgeo.grow % (unsigned)pagesize == 0);
-    ENSURE(env, env->me_dbgeo.grow % env->me_os_psize == 0);
-    ENSURE(env, env->me_dbgeo.shrink % (unsigned)pagesize == 0);
-    ENSURE(env, env->me_dbgeo.shrink % env->me_os_psize == 0);
+static void recalculate_merge_threshold(MDBX_env *env) {
+  const size_t bytes = page_space(env);
+  env->me_merge_threshold =
+      (uint16_t)(bytes -
+                 (bytes * env->me_options.merge_threshold_16dot16_percent >>
+                  16));
+  env->me_merge_threshold_gc =
+      (uint16_t)(bytes -
+                 ((env->me_options.merge_threshold_16dot16_percent > 19005)
+                      ? bytes / 3 /* 33 % */
+                      : bytes / 4 /* 25 % */));
+}
 
-    rc = MDBX_SUCCESS;
-  } else {
-    /* apply new params to opened environment */
-    ENSURE(env, pagesize == (intptr_t)env->me_psize);
-    MDBX_meta meta;
-    memset(&meta, 0, sizeof(meta));
-    const MDBX_geo *current_geo;
-    if (!inside_txn) {
-      eASSERT(env, need_unlock);
-      const meta_ptr_t head = meta_recent(env, &env->me_txn0->tw.troika);
+__cold static void setup_pagesize(MDBX_env *env, const size_t pagesize) {
+  STATIC_ASSERT(PTRDIFF_MAX > MAX_MAPSIZE);
+  STATIC_ASSERT(MIN_PAGESIZE > sizeof(MDBX_page) + sizeof(MDBX_meta));
+  ENSURE(env, is_powerof2(pagesize));
+  ENSURE(env, pagesize >= MIN_PAGESIZE);
+  ENSURE(env, pagesize <= MAX_PAGESIZE);
+  env->me_psize = (unsigned)pagesize;
+  if (env->me_pbuf) {
+    osal_memalign_free(env->me_pbuf);
+    env->me_pbuf = nullptr;
+  }
 
-      uint64_t timestamp = 0;
-      while ("workaround for "
-             "https://libmdbx.dqdkfa.ru/dead-github/issues/269") {
-        meta = *head.ptr_c;
-        rc = coherency_check_readed(env, head.txnid, meta.mm_dbs, &meta,
-                                    &timestamp);
-        if (likely(rc == MDBX_SUCCESS))
-          break;
-        if (unlikely(rc != MDBX_RESULT_TRUE))
-          goto bailout;
-      }
-      const txnid_t txnid = safe64_txnid_next(head.txnid);
-      if (unlikely(txnid > MAX_TXNID)) {
-        rc = MDBX_TXN_FULL;
-        ERROR("txnid overflow, raise %d", rc);
-        goto bailout;
-      }
-      meta_set_txnid(env, &meta, txnid);
-      current_geo = &meta.mm_geo;
-    } else {
-      current_geo = &env->me_txn->mt_geo;
-    }
-
-    /* update env-geo to avoid influences */
-    env->me_dbgeo.now = pgno2bytes(env, current_geo->now);
-    env->me_dbgeo.lower = pgno2bytes(env, current_geo->lower);
-    env->me_dbgeo.upper = pgno2bytes(env, current_geo->upper);
-    env->me_dbgeo.grow = pgno2bytes(env, pv2pages(current_geo->grow_pv));
-    env->me_dbgeo.shrink = pgno2bytes(env, pv2pages(current_geo->shrink_pv));
-
-    MDBX_geo new_geo;
-    new_geo.lower = bytes2pgno(env, size_lower);
-    new_geo.now = bytes2pgno(env, size_now);
-    new_geo.upper = bytes2pgno(env, size_upper);
-    new_geo.grow_pv = pages2pv(bytes2pgno(env, growth_step));
-    new_geo.shrink_pv = pages2pv(bytes2pgno(env, shrink_threshold));
-    new_geo.next = current_geo->next;
-
-    ENSURE(env, pgno_align2os_bytes(env, new_geo.lower) == (size_t)size_lower);
-    ENSURE(env, pgno_align2os_bytes(env, new_geo.upper) == (size_t)size_upper);
-    ENSURE(env, pgno_align2os_bytes(env, new_geo.now) == (size_t)size_now);
-    ENSURE(env, new_geo.grow_pv == pages2pv(pv2pages(new_geo.grow_pv)));
-    ENSURE(env, new_geo.shrink_pv == pages2pv(pv2pages(new_geo.shrink_pv)));
-
-    ENSURE(env, (size_t)size_lower >= MIN_MAPSIZE);
-    ENSURE(env, new_geo.lower >= MIN_PAGENO);
-    ENSURE(env, (size_t)size_upper <= MAX_MAPSIZE);
-    ENSURE(env, new_geo.upper <= MAX_PAGENO + 1);
-    ENSURE(env, new_geo.now >= new_geo.next);
-    ENSURE(env, new_geo.upper >= new_geo.now);
-    ENSURE(env, new_geo.now >= new_geo.lower);
-
-    if (memcmp(current_geo, &new_geo, sizeof(MDBX_geo)) != 0) {
-#if defined(_WIN32) || defined(_WIN64)
-      /* Was DB shrinking disabled before and now it will be enabled? */
-      if (new_geo.lower < new_geo.upper && new_geo.shrink_pv &&
-          !(current_geo->lower < current_geo->upper &&
-            current_geo->shrink_pv)) {
-        if (!env->me_lck_mmap.lck) {
-          rc = MDBX_EPERM;
-          goto bailout;
-        }
-        int err = osal_rdt_lock(env);
-        if (unlikely(MDBX_IS_ERROR(err))) {
-          rc = err;
-          goto bailout;
-        }
-
-        /* Check if there are any reading threads that do not use the SRWL */
-        const size_t CurrentTid = GetCurrentThreadId();
-        const MDBX_reader *const begin = env->me_lck_mmap.lck->mti_readers;
-        const MDBX_reader *const end =
-            begin + atomic_load32(&env->me_lck_mmap.lck->mti_numreaders,
-                                  mo_AcquireRelease);
-        for (const MDBX_reader *reader = begin; reader < end; ++reader) {
-          if (reader->mr_pid.weak == env->me_pid && reader->mr_tid.weak &&
-              reader->mr_tid.weak != CurrentTid) {
-            /* At least one thread may don't use SRWL */
-            rc = MDBX_EPERM;
-            break;
-          }
-        }
+  STATIC_ASSERT(MAX_GC1OVPAGE(MIN_PAGESIZE) > 4);
+  STATIC_ASSERT(MAX_GC1OVPAGE(MAX_PAGESIZE) < MDBX_PGL_LIMIT);
+  const intptr_t maxgc_ov1page = (pagesize - PAGEHDRSZ) / sizeof(pgno_t) - 1;
+  ENSURE(env,
+         maxgc_ov1page > 42 && maxgc_ov1page < (intptr_t)MDBX_PGL_LIMIT / 4);
+  env->me_maxgc_ov1page = (unsigned)maxgc_ov1page;
+  env->me_maxgc_per_branch =
+      (unsigned)((pagesize - PAGEHDRSZ) /
+                 (sizeof(indx_t) + sizeof(MDBX_node) + sizeof(txnid_t)));
 
-        osal_rdt_unlock(env);
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto bailout;
-      }
-#endif
+  STATIC_ASSERT(LEAF_NODE_MAX(MIN_PAGESIZE) > sizeof(MDBX_db) + NODESIZE + 42);
+  STATIC_ASSERT(LEAF_NODE_MAX(MAX_PAGESIZE) < UINT16_MAX);
+  STATIC_ASSERT(LEAF_NODE_MAX(MIN_PAGESIZE) >= BRANCH_NODE_MAX(MIN_PAGESIZE));
+  STATIC_ASSERT(BRANCH_NODE_MAX(MAX_PAGESIZE) > NODESIZE + 42);
+  STATIC_ASSERT(BRANCH_NODE_MAX(MAX_PAGESIZE) < UINT16_MAX);
+  const intptr_t branch_nodemax = BRANCH_NODE_MAX(pagesize);
+  const intptr_t leaf_nodemax = LEAF_NODE_MAX(pagesize);
+  ENSURE(env, branch_nodemax > (intptr_t)(NODESIZE + 42) &&
+                  branch_nodemax % 2 == 0 &&
+                  leaf_nodemax > (intptr_t)(sizeof(MDBX_db) + NODESIZE + 42) &&
+                  leaf_nodemax >= branch_nodemax &&
+                  leaf_nodemax < (int)UINT16_MAX && leaf_nodemax % 2 == 0);
+  env->me_leaf_nodemax = (unsigned)leaf_nodemax;
+  env->me_branch_nodemax = (unsigned)branch_nodemax;
+  env->me_psize2log = (uint8_t)log2n_powerof2(pagesize);
+  eASSERT(env, pgno2bytes(env, 1) == pagesize);
+  eASSERT(env, bytes2pgno(env, pagesize + pagesize) == 2);
+  recalculate_merge_threshold(env);
 
-      if (new_geo.now != current_geo->now ||
-          new_geo.upper != current_geo->upper) {
-        rc = dxb_resize(env, current_geo->next, new_geo.now, new_geo.upper,
-                        explicit_resize);
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto bailout;
-      }
-      if (inside_txn) {
-        env->me_txn->mt_geo = new_geo;
-        env->me_txn->mt_flags |= MDBX_TXN_DIRTY;
-      } else {
-        meta.mm_geo = new_geo;
-        rc = sync_locked(env, env->me_flags, &meta, &env->me_txn0->tw.troika);
-        if (likely(rc == MDBX_SUCCESS)) {
-          env->me_dbgeo.now = pgno2bytes(env, new_geo.now = meta.mm_geo.now);
-          env->me_dbgeo.upper =
-              pgno2bytes(env, new_geo.upper = meta.mm_geo.upper);
-        }
-      }
-    }
-    if (likely(rc == MDBX_SUCCESS)) {
-      /* update env-geo to avoid influences */
-      eASSERT(env, env->me_dbgeo.now == pgno2bytes(env, new_geo.now));
-      env->me_dbgeo.lower = pgno2bytes(env, new_geo.lower);
-      eASSERT(env, env->me_dbgeo.upper == pgno2bytes(env, new_geo.upper));
-      env->me_dbgeo.grow = pgno2bytes(env, pv2pages(new_geo.grow_pv));
-      env->me_dbgeo.shrink = pgno2bytes(env, pv2pages(new_geo.shrink_pv));
+  const pgno_t max_pgno = bytes2pgno(env, MAX_MAPSIZE);
+  if (!env->me_options.flags.non_auto.dp_limit) {
+    /* auto-setup dp_limit by "The42" ;-) */
+    intptr_t total_ram_pages, avail_ram_pages;
+    int err = mdbx_get_sysraminfo(nullptr, &total_ram_pages, &avail_ram_pages);
+    if (unlikely(err != MDBX_SUCCESS))
+      ERROR("mdbx_get_sysraminfo(), rc %d", err);
+    else {
+      size_t reasonable_dpl_limit =
+          (size_t)(total_ram_pages + avail_ram_pages) / 42;
+      if (pagesize > env->me_os_psize)
+        reasonable_dpl_limit /= pagesize / env->me_os_psize;
+      else if (pagesize < env->me_os_psize)
+        reasonable_dpl_limit *= env->me_os_psize / pagesize;
+      reasonable_dpl_limit = (reasonable_dpl_limit < MDBX_PGL_LIMIT)
+                                 ? reasonable_dpl_limit
+                                 : MDBX_PGL_LIMIT;
+      reasonable_dpl_limit = (reasonable_dpl_limit > CURSOR_STACK * 4)
+                                 ? reasonable_dpl_limit
+                                 : CURSOR_STACK * 4;
+      env->me_options.dp_limit = (unsigned)reasonable_dpl_limit;
     }
   }
-
-bailout:
-  if (need_unlock)
-    mdbx_txn_unlock(env);
-  return rc;
-}
-
-#ifndef LIBMDBX_NO_EXPORTS_LEGACY_API
-__cold int mdbx_env_set_mapsize(MDBX_env *env, size_t size) {
-  return __inline_mdbx_env_set_mapsize(env, size);
+  if (env->me_options.dp_limit > max_pgno - NUM_METAS)
+    env->me_options.dp_limit = max_pgno - NUM_METAS;
+  if (env->me_options.dp_initial > env->me_options.dp_limit)
+    env->me_options.dp_initial = env->me_options.dp_limit;
 }
 
-__cold int mdbx_env_set_maxdbs(MDBX_env *env, MDBX_dbi dbs) {
-  return __inline_mdbx_env_set_maxdbs(env, dbs);
+static __inline MDBX_CONST_FUNCTION MDBX_lockinfo *
+lckless_stub(const MDBX_env *env) {
+  uintptr_t stub = (uintptr_t)&env->x_lckless_stub;
+  /* align to avoid false-positive alarm from UndefinedBehaviorSanitizer */
+  stub = (stub + MDBX_CACHELINE_SIZE - 1) & ~(MDBX_CACHELINE_SIZE - 1);
+  return (MDBX_lockinfo *)stub;
 }
 
-__cold int mdbx_env_get_maxdbs(const MDBX_env *env, MDBX_dbi *dbs) {
-  return __inline_mdbx_env_get_maxdbs(env, dbs);
-}
+__cold int mdbx_env_create(MDBX_env **penv) {
+  if (unlikely(!penv))
+    return MDBX_EINVAL;
+  *penv = nullptr;
 
-__cold int mdbx_env_set_maxreaders(MDBX_env *env, unsigned readers) {
-  return __inline_mdbx_env_set_maxreaders(env, readers);
-}
+#ifdef MDBX_HAVE_C11ATOMICS
+  if (unlikely(!atomic_is_lock_free((const volatile uint32_t *)penv))) {
+    ERROR("lock-free atomic ops for %u-bit types is required", 32);
+    return MDBX_INCOMPATIBLE;
+  }
+#if MDBX_64BIT_ATOMIC
+  if (unlikely(!atomic_is_lock_free((const volatile uint64_t *)penv))) {
+    ERROR("lock-free atomic ops for %u-bit types is required", 64);
+    return MDBX_INCOMPATIBLE;
+  }
+#endif /* MDBX_64BIT_ATOMIC */
+#endif /* MDBX_HAVE_C11ATOMICS */
 
-__cold int mdbx_env_get_maxreaders(const MDBX_env *env, unsigned *readers) {
-  return __inline_mdbx_env_get_maxreaders(env, readers);
-}
-#endif /* LIBMDBX_NO_EXPORTS_LEGACY_API */
+  const size_t os_psize = osal_syspagesize();
+  if (unlikely(!is_powerof2(os_psize) || os_psize < MIN_PAGESIZE)) {
+    ERROR("unsuitable system pagesize %" PRIuPTR, os_psize);
+    return MDBX_INCOMPATIBLE;
+  }
 
-__cold static int alloc_page_buf(MDBX_env *env) {
-  return env->me_pbuf ? MDBX_SUCCESS
-                      : osal_memalign_alloc(env->me_os_psize,
-                                            env->me_psize * (size_t)NUM_METAS,
-                                            &env->me_pbuf);
-}
+#if defined(__linux__) || defined(__gnu_linux__)
+  if (unlikely(linux_kernel_version < 0x04000000)) {
+    /* 2022-09-01: Прошло уже больше двух после окончания какой-либо поддержки
+     * самого "долгоиграющего" ядра 3.16.85 ветки 3.x */
+    ERROR("too old linux kernel %u.%u.%u.%u, the >= 4.0.0 is required",
+          linux_kernel_version >> 24, (linux_kernel_version >> 16) & 255,
+          (linux_kernel_version >> 8) & 255, linux_kernel_version & 255);
+    return MDBX_INCOMPATIBLE;
+  }
+#endif /* Linux */
 
-/* Further setup required for opening an MDBX environment */
-__cold static int setup_dxb(MDBX_env *env, const int lck_rc,
-                            const mdbx_mode_t mode_bits) {
-  MDBX_meta header;
-  int rc = MDBX_RESULT_FALSE;
-  int err = read_header(env, &header, lck_rc, mode_bits);
-  if (unlikely(err != MDBX_SUCCESS)) {
-    if (lck_rc != /* lck exclusive */ MDBX_RESULT_TRUE || err != MDBX_ENODATA ||
-        (env->me_flags & MDBX_RDONLY) != 0 ||
-        /* recovery mode */ env->me_stuck_meta >= 0)
-      return err;
+  MDBX_env *env = osal_calloc(1, sizeof(MDBX_env));
+  if (unlikely(!env))
+    return MDBX_ENOMEM;
 
-    DEBUG("%s", "create new database");
-    rc = /* new database */ MDBX_RESULT_TRUE;
+  env->me_maxreaders = DEFAULT_READERS;
+  env->me_maxdbs = env->me_numdbs = CORE_DBS;
+  env->me_lazy_fd = env->me_dsync_fd = env->me_fd4meta = env->me_lfd =
+      env->me_vlog.fd = INVALID_HANDLE_VALUE;
+  env->me_pid = osal_getpid();
+  env->me_stuck_meta = -1;
 
-    if (!env->me_dbgeo.now) {
-      /* set defaults if not configured */
-      err = mdbx_env_set_geometry(env, 0, -1, DEFAULT_MAPSIZE, -1, -1, -1);
-      if (unlikely(err != MDBX_SUCCESS))
-        return err;
-    }
+  env->me_options.rp_augment_limit = MDBX_PNL_INITIAL;
+  env->me_options.dp_reserve_limit = MDBX_PNL_INITIAL;
+  env->me_options.dp_initial = MDBX_PNL_INITIAL;
+  env->me_options.spill_max_denominator = 8;
+  env->me_options.spill_min_denominator = 8;
+  env->me_options.spill_parent4child_denominator = 0;
+  env->me_options.dp_loose_limit = 64;
+  env->me_options.merge_threshold_16dot16_percent = 65536 / 4 /* 25% */;
 
-    err = alloc_page_buf(env);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
+#if !(defined(_WIN32) || defined(_WIN64))
+  env->me_options.writethrough_threshold =
+#if defined(__linux__) || defined(__gnu_linux__)
+      mdbx_RunningOnWSL1 ? MAX_PAGENO :
+#endif /* Linux */
+                         MDBX_WRITETHROUGH_THRESHOLD_DEFAULT;
+#endif /* Windows */
 
-    header = *init_metas(env, env->me_pbuf);
-    err = osal_pwrite(env->me_lazy_fd, env->me_pbuf,
-                      env->me_psize * (size_t)NUM_METAS, 0);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
+  env->me_os_psize = (unsigned)os_psize;
+  setup_pagesize(env, (env->me_os_psize < MAX_PAGESIZE) ? env->me_os_psize
+                                                        : MAX_PAGESIZE);
 
-    err = osal_ftruncate(env->me_lazy_fd, env->me_dxb_mmap.filesize =
-                                              env->me_dxb_mmap.current =
-                                                  env->me_dbgeo.now);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
+  int rc = osal_fastmutex_init(&env->me_dbi_lock);
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto bailout;
+  rc = osal_fastmutex_init(&env->me_disjoint.lock);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    osal_fastmutex_destroy(&env->me_dbi_lock);
+    goto bailout;
+  }
+  rc = osal_fastmutex_init(&env->me_vlog.lock);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    osal_fastmutex_destroy(&env->me_disjoint.lock);
+    osal_fastmutex_destroy(&env->me_dbi_lock);
+    goto bailout;
+  }
 
-#ifndef NDEBUG /* just for checking */
-    err = read_header(env, &header, lck_rc, mode_bits);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
-#endif
+#if defined(_WIN32) || defined(_WIN64)
+  osal_srwlock_Init(&env->me_remap_guard);
+  InitializeCriticalSection(&env->me_windowsbug_lock);
+#else
+  rc = osal_fastmutex_init(&env->me_remap_guard);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    osal_fastmutex_destroy(&env->me_vlog.lock);
+    osal_fastmutex_destroy(&env->me_disjoint.lock);
+    osal_fastmutex_destroy(&env->me_dbi_lock);
+    goto bailout;
   }
 
-  VERBOSE("header: root %" PRIaPGNO "/%" PRIaPGNO ", geo %" PRIaPGNO
-          "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO " +%u -%u, txn_id %" PRIaTXN
-          ", %s",
-          header.mm_dbs[MAIN_DBI].md_root, header.mm_dbs[FREE_DBI].md_root,
-          header.mm_geo.lower, header.mm_geo.next, header.mm_geo.now,
-          header.mm_geo.upper, pv2pages(header.mm_geo.grow_pv),
-          pv2pages(header.mm_geo.shrink_pv),
-          unaligned_peek_u64(4, header.mm_txnid_a), durable_caption(&header));
+#if MDBX_LOCKING > MDBX_LOCKING_SYSV
+  MDBX_lockinfo *const stub = lckless_stub(env);
+  rc = osal_ipclock_stub(&stub->mti_wlock);
+#endif /* MDBX_LOCKING */
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    osal_fastmutex_destroy(&env->me_remap_guard);
+    osal_fastmutex_destroy(&env->me_vlog.lock);
+    osal_fastmutex_destroy(&env->me_disjoint.lock);
+    osal_fastmutex_destroy(&env->me_dbi_lock);
+    goto bailout;
+  }
+#endif /* Windows */
 
-  if (env->me_psize != header.mm_psize)
-    setup_pagesize(env, header.mm_psize);
-  const size_t used_bytes = pgno2bytes(env, header.mm_geo.next);
-  const size_t used_aligned2os_bytes =
-      ceil_powerof2(used_bytes, env->me_os_psize);
-  if ((env->me_flags & MDBX_RDONLY) /* readonly */
-      || lck_rc != MDBX_RESULT_TRUE /* not exclusive */
-      || /* recovery mode */ env->me_stuck_meta >= 0) {
-    /* use present params from db */
-    const size_t pagesize = header.mm_psize;
-    err = mdbx_env_set_geometry(
-        env, header.mm_geo.lower * pagesize, header.mm_geo.now * pagesize,
-        header.mm_geo.upper * pagesize,
-        pv2pages(header.mm_geo.grow_pv) * pagesize,
-        pv2pages(header.mm_geo.shrink_pv) * pagesize, header.mm_psize);
-    if (unlikely(err != MDBX_SUCCESS)) {
-      ERROR("%s: err %d", "could not apply geometry from db", err);
-      return (err == MDBX_EINVAL) ? MDBX_INCOMPATIBLE : err;
-    }
-  } else if (env->me_dbgeo.now) {
-    /* silently growth to last used page */
-    if (env->me_dbgeo.now < used_aligned2os_bytes)
-      env->me_dbgeo.now = used_aligned2os_bytes;
-    if (env->me_dbgeo.upper < used_aligned2os_bytes)
-      env->me_dbgeo.upper = used_aligned2os_bytes;
+  VALGRIND_CREATE_MEMPOOL(env, 0, 0);
+  env->me_signature.weak = MDBX_ME_SIGNATURE;
+  *penv = env;
+  return MDBX_SUCCESS;
 
-    /* apply preconfigured params, but only if substantial changes:
-     *  - upper or lower limit changes
-     *  - shrink threshold or growth step
-     * But ignore change just a 'now/current' size. */
-    if (bytes_align2os_bytes(env, env->me_dbgeo.upper) !=
-            pgno2bytes(env, header.mm_geo.upper) ||
-        bytes_align2os_bytes(env, env->me_dbgeo.lower) !=
-            pgno2bytes(env, header.mm_geo.lower) ||
-        bytes_align2os_bytes(env, env->me_dbgeo.shrink) !=
-            pgno2bytes(env, pv2pages(header.mm_geo.shrink_pv)) ||
-        bytes_align2os_bytes(env, env->me_dbgeo.grow) !=
-            pgno2bytes(env, pv2pages(header.mm_geo.grow_pv))) {
+bailout:
+  osal_free(env);
+  return rc;
+}
 
-      if (env->me_dbgeo.shrink && env->me_dbgeo.now > used_bytes)
-        /* pre-shrink if enabled */
-        env->me_dbgeo.now = used_bytes + env->me_dbgeo.shrink -
-                            used_bytes % env->me_dbgeo.shrink;
+__cold static intptr_t get_reasonable_db_maxsize(intptr_t *cached_result) {
+  if (*cached_result == 0) {
+    intptr_t pagesize, total_ram_pages;
+    if (unlikely(mdbx_get_sysraminfo(&pagesize, &total_ram_pages, nullptr) !=
+                 MDBX_SUCCESS))
+      return *cached_result = MAX_MAPSIZE32 /* the 32-bit limit is good enough
+                                               for fallback */
+          ;
 
-      err = mdbx_env_set_geometry(env, env->me_dbgeo.lower, env->me_dbgeo.now,
-                                  env->me_dbgeo.upper, env->me_dbgeo.grow,
-                                  env->me_dbgeo.shrink, header.mm_psize);
-      if (unlikely(err != MDBX_SUCCESS)) {
-        ERROR("%s: err %d", "could not apply preconfigured db-geometry", err);
-        return (err == MDBX_EINVAL) ? MDBX_INCOMPATIBLE : err;
-      }
+    if (unlikely((size_t)total_ram_pages * 2 > MAX_MAPSIZE / (size_t)pagesize))
+      return *cached_result = MAX_MAPSIZE;
+    assert(MAX_MAPSIZE >= (size_t)(total_ram_pages * pagesize * 2));
 
-      /* update meta fields */
-      header.mm_geo.now = bytes2pgno(env, env->me_dbgeo.now);
-      header.mm_geo.lower = bytes2pgno(env, env->me_dbgeo.lower);
-      header.mm_geo.upper = bytes2pgno(env, env->me_dbgeo.upper);
-      header.mm_geo.grow_pv = pages2pv(bytes2pgno(env, env->me_dbgeo.grow));
-      header.mm_geo.shrink_pv = pages2pv(bytes2pgno(env, env->me_dbgeo.shrink));
+    /* Suggesting should not be more than golden ratio of the size of RAM. */
+    *cached_result = (intptr_t)((size_t)total_ram_pages * 207 >> 7) * pagesize;
 
-      VERBOSE("amended: root %" PRIaPGNO "/%" PRIaPGNO ", geo %" PRIaPGNO
-              "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO
-              " +%u -%u, txn_id %" PRIaTXN ", %s",
-              header.mm_dbs[MAIN_DBI].md_root, header.mm_dbs[FREE_DBI].md_root,
-              header.mm_geo.lower, header.mm_geo.next, header.mm_geo.now,
-              header.mm_geo.upper, pv2pages(header.mm_geo.grow_pv),
-              pv2pages(header.mm_geo.shrink_pv),
-              unaligned_peek_u64(4, header.mm_txnid_a),
-              durable_caption(&header));
-    } else {
-      /* fetch back 'now/current' size, since it was ignored during comparison
-       * and may differ. */
-      env->me_dbgeo.now = pgno_align2os_bytes(env, header.mm_geo.now);
+    /* Round to the nearest human-readable granulation. */
+    for (size_t unit = MEGABYTE; unit; unit <<= 5) {
+      const size_t floor = floor_powerof2(*cached_result, unit);
+      const size_t ceil = ceil_powerof2(*cached_result, unit);
+      const size_t threshold = (size_t)*cached_result >> 4;
+      const bool down =
+          *cached_result - floor < ceil - *cached_result || ceil > MAX_MAPSIZE;
+      if (threshold < (down ? *cached_result - floor : ceil - *cached_result))
+        break;
+      *cached_result = down ? floor : ceil;
     }
-    ENSURE(env, header.mm_geo.now >= header.mm_geo.next);
-  } else {
-    /* geo-params are not pre-configured by user,
-     * get current values from the meta. */
-    env->me_dbgeo.now = pgno2bytes(env, header.mm_geo.now);
-    env->me_dbgeo.lower = pgno2bytes(env, header.mm_geo.lower);
-    env->me_dbgeo.upper = pgno2bytes(env, header.mm_geo.upper);
-    env->me_dbgeo.grow = pgno2bytes(env, pv2pages(header.mm_geo.grow_pv));
-    env->me_dbgeo.shrink = pgno2bytes(env, pv2pages(header.mm_geo.shrink_pv));
   }
+  return *cached_result;
+}
 
-  ENSURE(env, pgno_align2os_bytes(env, header.mm_geo.now) == env->me_dbgeo.now);
-  ENSURE(env, env->me_dbgeo.now >= used_bytes);
-  const uint64_t filesize_before = env->me_dxb_mmap.filesize;
-  if (unlikely(filesize_before != env->me_dbgeo.now)) {
-    if (lck_rc != /* lck exclusive */ MDBX_RESULT_TRUE) {
-      VERBOSE("filesize mismatch (expect %" PRIuPTR "b/%" PRIaPGNO
-              "p, have %" PRIu64 "b/%" PRIaPGNO "p), "
-              "assume other process working",
-              env->me_dbgeo.now, bytes2pgno(env, env->me_dbgeo.now),
-              filesize_before, bytes2pgno(env, (size_t)filesize_before));
-    } else {
-      WARNING("filesize mismatch (expect %" PRIuSIZE "b/%" PRIaPGNO
-              "p, have %" PRIu64 "b/%" PRIaPGNO "p)",
-              env->me_dbgeo.now, bytes2pgno(env, env->me_dbgeo.now),
-              filesize_before, bytes2pgno(env, (size_t)filesize_before));
-      if (filesize_before < used_bytes) {
-        ERROR("last-page beyond end-of-file (last %" PRIaPGNO
-              ", have %" PRIaPGNO ")",
-              header.mm_geo.next, bytes2pgno(env, (size_t)filesize_before));
-        return MDBX_CORRUPTED;
-      }
+__cold LIBMDBX_API int
+mdbx_env_set_geometry(MDBX_env *env, intptr_t size_lower, intptr_t size_now,
+                      intptr_t size_upper, intptr_t growth_step,
+                      intptr_t shrink_threshold, intptr_t pagesize) {
+  int rc = check_env(env, false);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-      if (env->me_flags & MDBX_RDONLY) {
-        if (filesize_before & (env->me_os_psize - 1)) {
-          ERROR("%s", "filesize should be rounded-up to system page");
-          return MDBX_WANNA_RECOVERY;
-        }
-        WARNING("%s", "ignore filesize mismatch in readonly-mode");
-      } else {
-        VERBOSE("will resize datafile to %" PRIuSIZE " bytes, %" PRIaPGNO
-                " pages",
-                env->me_dbgeo.now, bytes2pgno(env, env->me_dbgeo.now));
-      }
-    }
-  }
+  const bool inside_txn =
+      (env->me_txn0 && env->me_txn0->mt_owner == osal_thread_self());
 
-  VERBOSE("current boot-id %" PRIx64 "-%" PRIx64 " (%savailable)", bootid.x,
-          bootid.y, (bootid.x | bootid.y) ? "" : "not-");
+#if MDBX_DEBUG
+  if (growth_step < 0) {
+    growth_step = 1;
+    if (shrink_threshold < 0)
+      shrink_threshold = 1;
+  }
+#endif /* MDBX_DEBUG */
 
-#if MDBX_ENABLE_MADVISE
-  /* calculate readahead hint before mmap with zero redundant pages */
-  const bool readahead =
-      !(env->me_flags & MDBX_NORDAHEAD) &&
-      mdbx_is_readahead_reasonable(used_bytes, 0) == MDBX_RESULT_TRUE;
-#endif /* MDBX_ENABLE_MADVISE */
+  intptr_t reasonable_maxsize = 0;
+  bool need_unlock = false;
+  if (env->me_map) {
+    /* env already mapped */
+    if (unlikely(env->me_flags & MDBX_RDONLY))
+      return MDBX_EACCESS;
 
-  err = osal_mmap(env->me_flags, &env->me_dxb_mmap, env->me_dbgeo.now,
-                  env->me_dbgeo.upper, lck_rc ? MMAP_OPTION_TRUNCATE : 0);
-  if (unlikely(err != MDBX_SUCCESS))
-    return err;
+    if (!inside_txn) {
+      int err = mdbx_txn_lock(env, false);
+      if (unlikely(err != MDBX_SUCCESS))
+        return err;
+      need_unlock = true;
+      env->me_txn0->tw.troika = meta_tap(env);
+      eASSERT(env, !env->me_txn && !env->me_txn0->mt_child);
+      env->me_txn0->mt_txnid =
+          env->me_txn0->tw.troika.txnid[env->me_txn0->tw.troika.recent];
+      txn_oldest_reader(env->me_txn0);
+    }
 
-#if MDBX_ENABLE_MADVISE
-#if defined(MADV_DONTDUMP)
-  err = madvise(env->me_map, env->me_dxb_mmap.limit, MADV_DONTDUMP)
-            ? ignore_enosys(errno)
-            : MDBX_SUCCESS;
-  if (unlikely(MDBX_IS_ERROR(err)))
-    return err;
-#endif /* MADV_DONTDUMP */
-#if defined(MADV_DODUMP)
-  if (runtime_flags & MDBX_DBG_DUMP) {
-    const size_t meta_length_aligned2os = pgno_align2os_bytes(env, NUM_METAS);
-    err = madvise(env->me_map, meta_length_aligned2os, MADV_DODUMP)
-              ? ignore_enosys(errno)
-              : MDBX_SUCCESS;
-    if (unlikely(MDBX_IS_ERROR(err)))
-      return err;
+    /* get untouched params from current TXN or DB */
+    if (pagesize <= 0 || pagesize >= INT_MAX)
+      pagesize = env->me_psize;
+    const MDBX_geo *const geo =
+        inside_txn ? &env->me_txn->mt_geo
+                   : &meta_recent(env, &env->me_txn0->tw.troika).ptr_c->mm_geo;
+    if (size_lower < 0)
+      size_lower = pgno2bytes(env, geo->lower);
+    if (size_now < 0)
+      size_now = pgno2bytes(env, geo->now);
+    if (size_upper < 0)
+      size_upper = pgno2bytes(env, geo->upper);
+    if (growth_step < 0)
+      growth_step = pgno2bytes(env, pv2pages(geo->grow_pv));
+    if (shrink_threshold < 0)
+      shrink_threshold = pgno2bytes(env, pv2pages(geo->shrink_pv));
+
+    if (pagesize != (intptr_t)env->me_psize) {
+      rc = MDBX_EINVAL;
+      goto bailout;
+    }
+    const size_t usedbytes =
+        pgno2bytes(env, find_largest_snapshot(env, geo->next));
+    if ((size_t)size_upper < usedbytes) {
+      rc = MDBX_MAP_FULL;
+      goto bailout;
+    }
+    if ((size_t)size_now < usedbytes)
+      size_now = usedbytes;
+  } else {
+    /* env NOT yet mapped */
+    if (unlikely(inside_txn))
+      return MDBX_PANIC;
+
+    /* is requested some auto-value for pagesize ? */
+    if (pagesize >= INT_MAX /* maximal */)
+      pagesize = MAX_PAGESIZE;
+    else if (pagesize <= 0) {
+      if (pagesize < 0 /* default */) {
+        pagesize = env->me_os_psize;
+        if ((uintptr_t)pagesize > MAX_PAGESIZE)
+          pagesize = MAX_PAGESIZE;
+        eASSERT(env, (uintptr_t)pagesize >= MIN_PAGESIZE);
+      } else if (pagesize == 0 /* minimal */)
+        pagesize = MIN_PAGESIZE;
+
+      /* choose pagesize */
+      intptr_t max_size = (size_now > size_lower) ? size_now : size_lower;
+      max_size = (size_upper > max_size) ? size_upper : max_size;
+      if (max_size < 0 /* default */)
+        max_size = DEFAULT_MAPSIZE;
+      else if (max_size == 0 /* minimal */)
+        max_size = MIN_MAPSIZE;
+      else if (max_size >= (intptr_t)MAX_MAPSIZE /* maximal */)
+        max_size = get_reasonable_db_maxsize(&reasonable_maxsize);
+
+      while (max_size > pagesize * (int64_t)(MAX_PAGENO + 1) &&
+             pagesize < MAX_PAGESIZE)
+        pagesize <<= 1;
+    }
   }
-#endif /* MADV_DODUMP */
-#endif /* MDBX_ENABLE_MADVISE */
 
-#ifdef MDBX_USE_VALGRIND
-  env->me_valgrind_handle =
-      VALGRIND_CREATE_BLOCK(env->me_map, env->me_dxb_mmap.limit, "mdbx");
-#endif /* MDBX_USE_VALGRIND */
+  if (pagesize < (intptr_t)MIN_PAGESIZE || pagesize > (intptr_t)MAX_PAGESIZE ||
+      !is_powerof2(pagesize)) {
+    rc = MDBX_EINVAL;
+    goto bailout;
+  }
 
-  eASSERT(env, used_bytes >= pgno2bytes(env, NUM_METAS) &&
-                   used_bytes <= env->me_dxb_mmap.limit);
-#if defined(MDBX_USE_VALGRIND) || defined(__SANITIZE_ADDRESS__)
-  if (env->me_dxb_mmap.filesize > used_bytes &&
-      env->me_dxb_mmap.filesize < env->me_dxb_mmap.limit) {
-    VALGRIND_MAKE_MEM_NOACCESS(ptr_disp(env->me_map, used_bytes),
-                               env->me_dxb_mmap.filesize - used_bytes);
-    MDBX_ASAN_POISON_MEMORY_REGION(ptr_disp(env->me_map, used_bytes),
-                                   env->me_dxb_mmap.filesize - used_bytes);
+  if (size_lower <= 0) {
+    size_lower = MIN_MAPSIZE;
+    if (MIN_MAPSIZE / pagesize < MIN_PAGENO)
+      size_lower = MIN_PAGENO * pagesize;
+  }
+  if (size_lower >= INTPTR_MAX) {
+    size_lower = get_reasonable_db_maxsize(&reasonable_maxsize);
+    if ((size_t)size_lower / pagesize > MAX_PAGENO + 1)
+      size_lower = pagesize * (MAX_PAGENO + 1);
   }
-  env->me_poison_edge =
-      bytes2pgno(env, (env->me_dxb_mmap.filesize < env->me_dxb_mmap.limit)
-                          ? env->me_dxb_mmap.filesize
-                          : env->me_dxb_mmap.limit);
-#endif /* MDBX_USE_VALGRIND || __SANITIZE_ADDRESS__ */
 
-  meta_troika_t troika = meta_tap(env);
-#if MDBX_DEBUG
-  meta_troika_dump(env, &troika);
-#endif
-  eASSERT(env, !env->me_txn && !env->me_txn0);
-  //-------------------------------- validate/rollback head & steady meta-pages
-  if (unlikely(env->me_stuck_meta >= 0)) {
-    /* recovery mode */
-    MDBX_meta clone;
-    MDBX_meta const *const target = METAPAGE(env, env->me_stuck_meta);
-    err = validate_meta_copy(env, target, &clone);
-    if (unlikely(err != MDBX_SUCCESS)) {
-      ERROR("target meta[%u] is corrupted",
-            bytes2pgno(env, ptr_dist(data_page(target), env->me_map)));
-      meta_troika_dump(env, &troika);
-      return MDBX_CORRUPTED;
+  if (size_now <= 0) {
+    size_now = size_lower;
+    if (size_upper >= size_lower && size_now > size_upper)
+      size_now = size_upper;
+  }
+  if (size_now >= INTPTR_MAX) {
+    size_now = get_reasonable_db_maxsize(&reasonable_maxsize);
+    if ((size_t)size_now / pagesize > MAX_PAGENO + 1)
+      size_now = pagesize * (MAX_PAGENO + 1);
+  }
+
+  if (size_upper <= 0) {
+    if (size_now >= get_reasonable_db_maxsize(&reasonable_maxsize) / 2)
+      size_upper = get_reasonable_db_maxsize(&reasonable_maxsize);
+    else if (MAX_MAPSIZE != MAX_MAPSIZE32 &&
+             (size_t)size_now >= MAX_MAPSIZE32 / 2 &&
+             (size_t)size_now <= MAX_MAPSIZE32 / 4 * 3)
+      size_upper = MAX_MAPSIZE32;
+    else {
+      size_upper = size_now + size_now;
+      if ((size_t)size_upper < DEFAULT_MAPSIZE * 2)
+        size_upper = DEFAULT_MAPSIZE * 2;
     }
-  } else /* not recovery mode */
-    while (1) {
-      const unsigned meta_clash_mask = meta_eq_mask(&troika);
-      if (unlikely(meta_clash_mask)) {
-        ERROR("meta-pages are clashed: mask 0x%d", meta_clash_mask);
-        meta_troika_dump(env, &troika);
-        return MDBX_CORRUPTED;
-      }
+    if ((size_t)size_upper / pagesize > (MAX_PAGENO + 1))
+      size_upper = pagesize * (MAX_PAGENO + 1);
+  } else if (size_upper >= INTPTR_MAX) {
+    size_upper = get_reasonable_db_maxsize(&reasonable_maxsize);
+    if ((size_t)size_upper / pagesize > MAX_PAGENO + 1)
+      size_upper = pagesize * (MAX_PAGENO + 1);
+  }
 
-      if (lck_rc != /* lck exclusive */ MDBX_RESULT_TRUE) {
-        /* non-exclusive mode,
-         * meta-pages should be validated by a first process opened the DB */
-        if (troika.recent == troika.prefer_steady)
-          break;
+  if (unlikely(size_lower < (intptr_t)MIN_MAPSIZE || size_lower > size_upper)) {
+    rc = MDBX_EINVAL;
+    goto bailout;
+  }
 
-        if (!env->me_lck_mmap.lck) {
-          /* LY: without-lck (read-only) mode, so it is impossible that other
-           * process made weak checkpoint. */
-          ERROR("%s", "without-lck, unable recovery/rollback");
-          meta_troika_dump(env, &troika);
-          return MDBX_WANNA_RECOVERY;
-        }
+  if ((uint64_t)size_lower / pagesize < MIN_PAGENO) {
+    size_lower = pagesize * MIN_PAGENO;
+    if (unlikely(size_lower > size_upper)) {
+      rc = MDBX_EINVAL;
+      goto bailout;
+    }
+    if (size_now < size_lower)
+      size_now = size_lower;
+  }
 
-        /* LY: assume just have a collision with other running process,
-         *     or someone make a weak checkpoint */
-        VERBOSE("%s", "assume collision or online weak checkpoint");
-        break;
-      }
-      eASSERT(env, lck_rc == MDBX_RESULT_TRUE);
-      /* exclusive mode */
+  if (unlikely((size_t)size_upper > MAX_MAPSIZE ||
+               (uint64_t)size_upper / pagesize > MAX_PAGENO + 1)) {
+    rc = MDBX_TOO_LARGE;
+    goto bailout;
+  }
 
-      const meta_ptr_t recent = meta_recent(env, &troika);
-      const meta_ptr_t prefer_steady = meta_prefer_steady(env, &troika);
-      MDBX_meta clone;
-      if (prefer_steady.is_steady) {
-        err = validate_meta_copy(env, prefer_steady.ptr_c, &clone);
-        if (unlikely(err != MDBX_SUCCESS)) {
-          ERROR("meta[%u] with %s txnid %" PRIaTXN " is corrupted, %s needed",
-                bytes2pgno(env, ptr_dist(prefer_steady.ptr_c, env->me_map)),
-                "steady", prefer_steady.txnid, "manual recovery");
-          meta_troika_dump(env, &troika);
-          return MDBX_CORRUPTED;
-        }
-        if (prefer_steady.ptr_c == recent.ptr_c)
-          break;
-      }
+  const size_t unit = (env->me_os_psize > (size_t)pagesize) ? env->me_os_psize
+                                                            : (size_t)pagesize;
+  size_lower = ceil_powerof2(size_lower, unit);
+  size_upper = ceil_powerof2(size_upper, unit);
+  size_now = ceil_powerof2(size_now, unit);
 
-      const pgno_t pgno = bytes2pgno(env, ptr_dist(recent.ptr_c, env->me_map));
-      const bool last_valid =
-          validate_meta_copy(env, recent.ptr_c, &clone) == MDBX_SUCCESS;
-      eASSERT(env,
-              !prefer_steady.is_steady || recent.txnid != prefer_steady.txnid);
-      if (unlikely(!last_valid)) {
-        if (unlikely(!prefer_steady.is_steady)) {
-          ERROR("%s for open or automatic rollback, %s",
-                "there are no suitable meta-pages",
-                "manual recovery is required");
-          meta_troika_dump(env, &troika);
-          return MDBX_CORRUPTED;
-        }
-        WARNING("meta[%u] with last txnid %" PRIaTXN
-                " is corrupted, rollback needed",
-                pgno, recent.txnid);
-        meta_troika_dump(env, &troika);
-        goto purge_meta_head;
-      }
+  /* LY: подбираем значение size_upper:
+   *  - кратное размеру страницы
+   *  - без нарушения MAX_MAPSIZE и MAX_PAGENO */
+  while (unlikely((size_t)size_upper > MAX_MAPSIZE ||
+                  (uint64_t)size_upper / pagesize > MAX_PAGENO + 1)) {
+    if ((size_t)size_upper < unit + MIN_MAPSIZE ||
+        (size_t)size_upper < (size_t)pagesize * (MIN_PAGENO + 1)) {
+      /* паранойа на случай переполнения при невероятных значениях */
+      rc = MDBX_EINVAL;
+      goto bailout;
+    }
+    size_upper -= unit;
+    if ((size_t)size_upper < (size_t)size_lower)
+      size_lower = size_upper;
+  }
+  eASSERT(env, (size_upper - size_lower) % env->me_os_psize == 0);
 
-      if (meta_bootid_match(recent.ptr_c)) {
-        if (env->me_flags & MDBX_RDONLY) {
-          ERROR("%s, but boot-id(%016" PRIx64 "-%016" PRIx64 ") is MATCH: "
-                "rollback NOT needed, steady-sync NEEDED%s",
-                "opening after an unclean shutdown", bootid.x, bootid.y,
-                ", but unable in read-only mode");
-          meta_troika_dump(env, &troika);
-          return MDBX_WANNA_RECOVERY;
-        }
-        WARNING("%s, but boot-id(%016" PRIx64 "-%016" PRIx64 ") is MATCH: "
-                "rollback NOT needed, steady-sync NEEDED%s",
-                "opening after an unclean shutdown", bootid.x, bootid.y, "");
-        header = clone;
-        env->me_lck->mti_unsynced_pages.weak = header.mm_geo.next;
-        if (!env->me_lck->mti_eoos_timestamp.weak)
-          env->me_lck->mti_eoos_timestamp.weak = osal_monotime();
-        break;
-      }
-      if (unlikely(!prefer_steady.is_steady)) {
-        ERROR("%s, but %s for automatic rollback: %s",
-              "opening after an unclean shutdown",
-              "there are no suitable meta-pages",
-              "manual recovery is required");
-        meta_troika_dump(env, &troika);
-        return MDBX_CORRUPTED;
-      }
-      if (env->me_flags & MDBX_RDONLY) {
-        ERROR("%s and rollback needed: (from head %" PRIaTXN
-              " to steady %" PRIaTXN ")%s",
-              "opening after an unclean shutdown", recent.txnid,
-              prefer_steady.txnid, ", but unable in read-only mode");
-        meta_troika_dump(env, &troika);
-        return MDBX_WANNA_RECOVERY;
-      }
-
-    purge_meta_head:
-      NOTICE("%s and doing automatic rollback: "
-             "purge%s meta[%u] with%s txnid %" PRIaTXN,
-             "opening after an unclean shutdown", last_valid ? "" : " invalid",
-             pgno, last_valid ? " weak" : "", recent.txnid);
-      meta_troika_dump(env, &troika);
-      ENSURE(env, prefer_steady.is_steady);
-      err = override_meta(env, pgno, 0,
-                          last_valid ? recent.ptr_c : prefer_steady.ptr_c);
-      if (err) {
-        ERROR("rollback: overwrite meta[%u] with txnid %" PRIaTXN ", error %d",
-              pgno, recent.txnid, err);
-        return err;
-      }
-      troika = meta_tap(env);
-      ENSURE(env, 0 == meta_txnid(recent.ptr_v));
-      ENSURE(env, 0 == meta_eq_mask(&troika));
-    }
+  if (size_now < size_lower)
+    size_now = size_lower;
+  if (size_now > size_upper)
+    size_now = size_upper;
 
-  if (lck_rc == /* lck exclusive */ MDBX_RESULT_TRUE) {
-    //-------------------------------------------------- shrink DB & update geo
-    /* re-check size after mmap */
-    if ((env->me_dxb_mmap.current & (env->me_os_psize - 1)) != 0 ||
-        env->me_dxb_mmap.current < used_bytes) {
-      ERROR("unacceptable/unexpected datafile size %" PRIuPTR,
-            env->me_dxb_mmap.current);
-      return MDBX_PROBLEM;
-    }
-    if (env->me_dxb_mmap.current != env->me_dbgeo.now) {
-      header.mm_geo.now = bytes2pgno(env, env->me_dxb_mmap.current);
-      NOTICE("need update meta-geo to filesize %" PRIuPTR " bytes, %" PRIaPGNO
-             " pages",
-             env->me_dxb_mmap.current, header.mm_geo.now);
-    }
+  if (growth_step < 0) {
+    growth_step = ((size_t)(size_upper - size_lower)) / 42;
+    if (growth_step > size_lower && size_lower < (intptr_t)MEGABYTE)
+      growth_step = size_lower;
+    if (growth_step < 65536)
+      growth_step = 65536;
+    if ((size_t)growth_step > MAX_MAPSIZE / 64)
+      growth_step = MAX_MAPSIZE / 64;
+  }
+  if (growth_step == 0 && shrink_threshold > 0)
+    growth_step = 1;
+  growth_step = ceil_powerof2(growth_step, unit);
 
-    const meta_ptr_t recent = meta_recent(env, &troika);
-    if (memcmp(&header.mm_geo, &recent.ptr_c->mm_geo, sizeof(header.mm_geo))) {
-      if ((env->me_flags & MDBX_RDONLY) != 0 ||
-          /* recovery mode */ env->me_stuck_meta >= 0) {
-        WARNING("skipped update meta.geo in %s mode: from l%" PRIaPGNO
-                "-n%" PRIaPGNO "-u%" PRIaPGNO "/s%u-g%u, to l%" PRIaPGNO
-                "-n%" PRIaPGNO "-u%" PRIaPGNO "/s%u-g%u",
-                (env->me_stuck_meta < 0) ? "read-only" : "recovery",
-                recent.ptr_c->mm_geo.lower, recent.ptr_c->mm_geo.now,
-                recent.ptr_c->mm_geo.upper,
-                pv2pages(recent.ptr_c->mm_geo.shrink_pv),
-                pv2pages(recent.ptr_c->mm_geo.grow_pv), header.mm_geo.lower,
-                header.mm_geo.now, header.mm_geo.upper,
-                pv2pages(header.mm_geo.shrink_pv),
-                pv2pages(header.mm_geo.grow_pv));
-      } else {
-        const txnid_t next_txnid = safe64_txnid_next(recent.txnid);
-        if (unlikely(next_txnid > MAX_TXNID)) {
-          ERROR("txnid overflow, raise %d", MDBX_TXN_FULL);
-          return MDBX_TXN_FULL;
-        }
-        NOTICE("updating meta.geo: "
-               "from l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
-               "/s%u-g%u (txn#%" PRIaTXN "), "
-               "to l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
-               "/s%u-g%u (txn#%" PRIaTXN ")",
-               recent.ptr_c->mm_geo.lower, recent.ptr_c->mm_geo.now,
-               recent.ptr_c->mm_geo.upper,
-               pv2pages(recent.ptr_c->mm_geo.shrink_pv),
-               pv2pages(recent.ptr_c->mm_geo.grow_pv), recent.txnid,
-               header.mm_geo.lower, header.mm_geo.now, header.mm_geo.upper,
-               pv2pages(header.mm_geo.shrink_pv),
-               pv2pages(header.mm_geo.grow_pv), next_txnid);
+  if (shrink_threshold < 0)
+    shrink_threshold = growth_step + growth_step;
+  shrink_threshold = ceil_powerof2(shrink_threshold, unit);
 
-        ENSURE(env, header.unsafe_txnid == recent.txnid);
-        meta_set_txnid(env, &header, next_txnid);
-        err = sync_locked(env, env->me_flags | MDBX_SHRINK_ALLOWED, &header,
-                          &troika);
-        if (err) {
-          ERROR("error %d, while updating meta.geo: "
-                "from l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
-                "/s%u-g%u (txn#%" PRIaTXN "), "
-                "to l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
-                "/s%u-g%u (txn#%" PRIaTXN ")",
-                err, recent.ptr_c->mm_geo.lower, recent.ptr_c->mm_geo.now,
-                recent.ptr_c->mm_geo.upper,
-                pv2pages(recent.ptr_c->mm_geo.shrink_pv),
-                pv2pages(recent.ptr_c->mm_geo.grow_pv), recent.txnid,
-                header.mm_geo.lower, header.mm_geo.now, header.mm_geo.upper,
-                pv2pages(header.mm_geo.shrink_pv),
-                pv2pages(header.mm_geo.grow_pv), header.unsafe_txnid);
-          return err;
-        }
-      }
-    }
+  //----------------------------------------------------------------------------
 
-    atomic_store32(&env->me_lck->mti_discarded_tail,
-                   bytes2pgno(env, used_aligned2os_bytes), mo_Relaxed);
+  if (!env->me_map) {
+    /* save user's geo-params for future open/create */
+    if (pagesize != (intptr_t)env->me_psize)
+      setup_pagesize(env, pagesize);
+    env->me_dbgeo.lower = size_lower;
+    env->me_dbgeo.now = size_now;
+    env->me_dbgeo.upper = size_upper;
+    env->me_dbgeo.grow =
+        pgno2bytes(env, pv2pages(pages2pv(bytes2pgno(env, growth_step))));
+    env->me_dbgeo.shrink =
+        pgno2bytes(env, pv2pages(pages2pv(bytes2pgno(env, shrink_threshold))));
+    adjust_defaults(env);
 
-    if ((env->me_flags & MDBX_RDONLY) == 0 && env->me_stuck_meta < 0 &&
-        (runtime_flags & MDBX_DBG_DONT_UPGRADE) == 0) {
-      for (int n = 0; n < NUM_METAS; ++n) {
-        MDBX_meta *const meta = METAPAGE(env, n);
-        if (unlikely(unaligned_peek_u64(4, &meta->mm_magic_and_version) !=
-                     MDBX_DATA_MAGIC)) {
-          const txnid_t txnid = constmeta_txnid(meta);
-          NOTICE("%s %s"
-                 "meta[%u], txnid %" PRIaTXN,
-                 "updating db-format signature for",
-                 META_IS_STEADY(meta) ? "stead-" : "weak-", n, txnid);
-          err = override_meta(env, n, txnid, meta);
-          if (unlikely(err != MDBX_SUCCESS) &&
-              /* Just ignore the MDBX_PROBLEM error, since here it is
-               * returned only in case of the attempt to upgrade an obsolete
-               * meta-page that is invalid for current state of a DB,
-               * e.g. after shrinking DB file */
-              err != MDBX_PROBLEM) {
-            ERROR("%s meta[%u], txnid %" PRIaTXN ", error %d",
-                  "updating db-format signature for", n, txnid, err);
-            return err;
-          }
-          troika = meta_tap(env);
-        }
-      }
-    }
-  } /* lck exclusive, lck_rc == MDBX_RESULT_TRUE */
+    ENSURE(env, env->me_dbgeo.lower >= MIN_MAPSIZE);
+    ENSURE(env, env->me_dbgeo.lower / (unsigned)pagesize >= MIN_PAGENO);
+    ENSURE(env, env->me_dbgeo.lower % (unsigned)pagesize == 0);
+    ENSURE(env, env->me_dbgeo.lower % env->me_os_psize == 0);
 
-  //---------------------------------------------------- setup madvise/readahead
-#if MDBX_ENABLE_MADVISE
-  if (used_aligned2os_bytes < env->me_dxb_mmap.current) {
-#if defined(MADV_REMOVE)
-    if (lck_rc && (env->me_flags & MDBX_WRITEMAP) != 0 &&
-        /* not recovery mode */ env->me_stuck_meta < 0) {
-      NOTICE("open-MADV_%s %u..%u", "REMOVE (deallocate file space)",
-             env->me_lck->mti_discarded_tail.weak,
-             bytes2pgno(env, env->me_dxb_mmap.current));
-      err =
-          madvise(ptr_disp(env->me_map, used_aligned2os_bytes),
-                  env->me_dxb_mmap.current - used_aligned2os_bytes, MADV_REMOVE)
-              ? ignore_enosys(errno)
-              : MDBX_SUCCESS;
-      if (unlikely(MDBX_IS_ERROR(err)))
-        return err;
-    }
-#endif /* MADV_REMOVE */
-#if defined(MADV_DONTNEED)
-    NOTICE("open-MADV_%s %u..%u", "DONTNEED",
-           env->me_lck->mti_discarded_tail.weak,
-           bytes2pgno(env, env->me_dxb_mmap.current));
-    err =
-        madvise(ptr_disp(env->me_map, used_aligned2os_bytes),
-                env->me_dxb_mmap.current - used_aligned2os_bytes, MADV_DONTNEED)
-            ? ignore_enosys(errno)
-            : MDBX_SUCCESS;
-    if (unlikely(MDBX_IS_ERROR(err)))
-      return err;
-#elif defined(POSIX_MADV_DONTNEED)
-    err = ignore_enosys(posix_madvise(
-        ptr_disp(env->me_map, used_aligned2os_bytes),
-        env->me_dxb_mmap.current - used_aligned2os_bytes, POSIX_MADV_DONTNEED));
-    if (unlikely(MDBX_IS_ERROR(err)))
-      return err;
-#elif defined(POSIX_FADV_DONTNEED)
-    err = ignore_enosys(posix_fadvise(
-        env->me_lazy_fd, used_aligned2os_bytes,
-        env->me_dxb_mmap.current - used_aligned2os_bytes, POSIX_FADV_DONTNEED));
-    if (unlikely(MDBX_IS_ERROR(err)))
-      return err;
-#endif /* MADV_DONTNEED */
-  }
+    ENSURE(env, env->me_dbgeo.upper <= MAX_MAPSIZE);
+    ENSURE(env, env->me_dbgeo.upper / (unsigned)pagesize <= MAX_PAGENO + 1);
+    ENSURE(env, env->me_dbgeo.upper % (unsigned)pagesize == 0);
+    ENSURE(env, env->me_dbgeo.upper % env->me_os_psize == 0);
 
-  err = set_readahead(env, bytes2pgno(env, used_bytes), readahead, true);
-  if (unlikely(err != MDBX_SUCCESS))
-    return err;
-#endif /* MDBX_ENABLE_MADVISE */
+    ENSURE(env, env->me_dbgeo.now >= env->me_dbgeo.lower);
+    ENSURE(env, env->me_dbgeo.now <= env->me_dbgeo.upper);
+    ENSURE(env, env->me_dbgeo.now % (unsigned)pagesize == 0);
+    ENSURE(env, env->me_dbgeo.now % env->me_os_psize == 0);
 
-  return rc;
-}
+    ENSURE(env, env->me_dbgeo.grow % (unsigned)pagesize == 0);
+    ENSURE(env, env->me_dbgeo.grow % env->me_os_psize == 0);
+    ENSURE(env, env->me_dbgeo.shrink % (unsigned)pagesize == 0);
+    ENSURE(env, env->me_dbgeo.shrink % env->me_os_psize == 0);
 
-/******************************************************************************/
+    rc = MDBX_SUCCESS;
+  } else {
+    /* apply new params to opened environment */
+    ENSURE(env, pagesize == (intptr_t)env->me_psize);
+    MDBX_meta meta;
+    memset(&meta, 0, sizeof(meta));
+    const MDBX_geo *current_geo;
+    if (!inside_txn) {
+      eASSERT(env, need_unlock);
+      const meta_ptr_t head = meta_recent(env, &env->me_txn0->tw.troika);
 
-/* Open and/or initialize the lock region for the environment. */
-__cold static int setup_lck(MDBX_env *env, pathchar_t *lck_pathname,
-                            mdbx_mode_t mode) {
-  eASSERT(env, env->me_lazy_fd != INVALID_HANDLE_VALUE);
-  eASSERT(env, env->me_lfd == INVALID_HANDLE_VALUE);
-
-  int err = osal_openfile(MDBX_OPEN_LCK, env, lck_pathname, &env->me_lfd, mode);
-  if (err != MDBX_SUCCESS) {
-    switch (err) {
-    default:
-      return err;
-    case MDBX_ENOFILE:
-    case MDBX_EACCESS:
-    case MDBX_EPERM:
-      if (!F_ISSET(env->me_flags, MDBX_RDONLY | MDBX_EXCLUSIVE))
-        return err;
-      break;
-    case MDBX_EROFS:
-      if ((env->me_flags & MDBX_RDONLY) == 0)
-        return err;
-      break;
-    }
-
-    if (err != MDBX_ENOFILE) {
-      /* ENSURE the file system is read-only */
-      err = osal_check_fs_rdonly(env->me_lazy_fd, lck_pathname, err);
-      if (err != MDBX_SUCCESS &&
-          /* ignore ERROR_NOT_SUPPORTED for exclusive mode */
-          !(err == MDBX_ENOSYS && (env->me_flags & MDBX_EXCLUSIVE)))
-        return err;
+      uint64_t timestamp = 0;
+      while ("workaround for "
+             "https://libmdbx.dqdkfa.ru/dead-github/issues/269") {
+        meta = *head.ptr_c;
+        rc = coherency_check_readed(env, head.txnid, meta.mm_dbs, &meta,
+                                    &timestamp);
+        if (likely(rc == MDBX_SUCCESS))
+          break;
+        if (unlikely(rc != MDBX_RESULT_TRUE))
+          goto bailout;
+      }
+      const txnid_t txnid = safe64_txnid_next(head.txnid);
+      if (unlikely(txnid > MAX_TXNID)) {
+        rc = MDBX_TXN_FULL;
+        ERROR("txnid overflow, raise %d", rc);
+        goto bailout;
+      }
+      meta_set_txnid(env, &meta, txnid);
+      current_geo = &meta.mm_geo;
+    } else {
+      current_geo = &env->me_txn->mt_geo;
     }
 
-    /* LY: without-lck mode (e.g. exclusive or on read-only filesystem) */
-    /* beginning of a locked section ---------------------------------------- */
-    lcklist_lock();
-    eASSERT(env, env->me_lcklist_next == nullptr);
-    env->me_lfd = INVALID_HANDLE_VALUE;
-    const int rc = osal_lck_seize(env);
-    if (MDBX_IS_ERROR(rc)) {
-      /* Calling lcklist_detach_locked() is required to restore POSIX-filelock
-       * and this job will be done by env_close(). */
-      lcklist_unlock();
-      return rc;
-    }
-    /* insert into inprocess lck-list */
-    env->me_lcklist_next = inprocess_lcklist_head;
-    inprocess_lcklist_head = env;
-    lcklist_unlock();
-    /* end of a locked section ---------------------------------------------- */
+    /* update env-geo to avoid influences */
+    env->me_dbgeo.now = pgno2bytes(env, current_geo->now);
+    env->me_dbgeo.lower = pgno2bytes(env, current_geo->lower);
+    env->me_dbgeo.upper = pgno2bytes(env, current_geo->upper);
+    env->me_dbgeo.grow = pgno2bytes(env, pv2pages(current_geo->grow_pv));
+    env->me_dbgeo.shrink = pgno2bytes(env, pv2pages(current_geo->shrink_pv));
 
-    env->me_lck = lckless_stub(env);
-    env->me_maxreaders = UINT_MAX;
-    DEBUG("lck-setup:%s%s%s", " lck-less",
-          (env->me_flags & MDBX_RDONLY) ? " readonly" : "",
-          (rc == MDBX_RESULT_TRUE) ? " exclusive" : " cooperative");
-    return rc;
-  }
+    MDBX_geo new_geo;
+    new_geo.lower = bytes2pgno(env, size_lower);
+    new_geo.now = bytes2pgno(env, size_now);
+    new_geo.upper = bytes2pgno(env, size_upper);
+    new_geo.grow_pv = pages2pv(bytes2pgno(env, growth_step));
+    new_geo.shrink_pv = pages2pv(bytes2pgno(env, shrink_threshold));
+    new_geo.next = current_geo->next;
 
-  /* beginning of a locked section ------------------------------------------ */
-  lcklist_lock();
-  eASSERT(env, env->me_lcklist_next == nullptr);
+    ENSURE(env, pgno_align2os_bytes(env, new_geo.lower) == (size_t)size_lower);
+    ENSURE(env, pgno_align2os_bytes(env, new_geo.upper) == (size_t)size_upper);
+    ENSURE(env, pgno_align2os_bytes(env, new_geo.now) == (size_t)size_now);
+    ENSURE(env, new_geo.grow_pv == pages2pv(pv2pages(new_geo.grow_pv)));
+    ENSURE(env, new_geo.shrink_pv == pages2pv(pv2pages(new_geo.shrink_pv)));
 
-  /* Try to get exclusive lock. If we succeed, then
-   * nobody is using the lock region and we should initialize it. */
-  err = osal_lck_seize(env);
-  if (MDBX_IS_ERROR(err)) {
-  bailout:
-    /* Calling lcklist_detach_locked() is required to restore POSIX-filelock
-     * and this job will be done by env_close(). */
-    lcklist_unlock();
-    return err;
-  }
+    ENSURE(env, (size_t)size_lower >= MIN_MAPSIZE);
+    ENSURE(env, new_geo.lower >= MIN_PAGENO);
+    ENSURE(env, (size_t)size_upper <= MAX_MAPSIZE);
+    ENSURE(env, new_geo.upper <= MAX_PAGENO + 1);
+    ENSURE(env, new_geo.now >= new_geo.next);
+    ENSURE(env, new_geo.upper >= new_geo.now);
+    ENSURE(env, new_geo.now >= new_geo.lower);
 
-  MDBX_env *inprocess_neighbor = nullptr;
-  if (err == MDBX_RESULT_TRUE) {
-    err = uniq_check(&env->me_lck_mmap, &inprocess_neighbor);
-    if (MDBX_IS_ERROR(err))
-      goto bailout;
-    if (inprocess_neighbor &&
-        ((runtime_flags & MDBX_DBG_LEGACY_MULTIOPEN) == 0 ||
-         (inprocess_neighbor->me_flags & MDBX_EXCLUSIVE) != 0)) {
-      err = MDBX_BUSY;
-      goto bailout;
-    }
-  }
-  const int lck_seize_rc = err;
+    if (memcmp(current_geo, &new_geo, sizeof(MDBX_geo)) != 0) {
+#if defined(_WIN32) || defined(_WIN64)
+      /* Was DB shrinking disabled before and now it will be enabled? */
+      if (new_geo.lower < new_geo.upper && new_geo.shrink_pv &&
+          !(current_geo->lower < current_geo->upper &&
+            current_geo->shrink_pv)) {
+        if (!env->me_lck_mmap.lck) {
+          rc = MDBX_EPERM;
+          goto bailout;
+        }
+        int err = osal_rdt_lock(env);
+        if (unlikely(MDBX_IS_ERROR(err))) {
+          rc = err;
+          goto bailout;
+        }
 
-  DEBUG("lck-setup:%s%s%s", " with-lck",
-        (env->me_flags & MDBX_RDONLY) ? " readonly" : "",
-        (lck_seize_rc == MDBX_RESULT_TRUE) ? " exclusive" : " cooperative");
+        /* Check if there are any reading threads that do not use the SRWL */
+        const size_t CurrentTid = GetCurrentThreadId();
+        const MDBX_reader *const begin = env->me_lck_mmap.lck->mti_readers;
+        const MDBX_reader *const end =
+            begin + atomic_load32(&env->me_lck_mmap.lck->mti_numreaders,
+                                  mo_AcquireRelease);
+        for (const MDBX_reader *reader = begin; reader < end; ++reader) {
+          if (reader->mr_pid.weak == env->me_pid && reader->mr_tid.weak &&
+              reader->mr_tid.weak != CurrentTid) {
+            /* At least one thread may don't use SRWL */
+            rc = MDBX_EPERM;
+            break;
+          }
+        }
 
-  uint64_t size = 0;
-  err = osal_filesize(env->me_lfd, &size);
-  if (unlikely(err != MDBX_SUCCESS))
-    goto bailout;
+        osal_rdt_unlock(env);
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto bailout;
+      }
+#endif
 
-  if (lck_seize_rc == MDBX_RESULT_TRUE) {
-    size = ceil_powerof2(env->me_maxreaders * sizeof(MDBX_reader) +
-                             sizeof(MDBX_lockinfo),
-                         env->me_os_psize);
-    jitter4testing(false);
-  } else {
-    if (env->me_flags & MDBX_EXCLUSIVE) {
-      err = MDBX_BUSY;
-      goto bailout;
+      if (new_geo.now != current_geo->now ||
+          new_geo.upper != current_geo->upper) {
+        rc = dxb_resize(env, current_geo->next, new_geo.now, new_geo.upper,
+                        explicit_resize);
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto bailout;
+      }
+      if (inside_txn) {
+        env->me_txn->mt_geo = new_geo;
+        env->me_txn->mt_flags |= MDBX_TXN_DIRTY;
+      } else {
+        meta.mm_geo = new_geo;
+        rc = sync_locked(env, env->me_flags, &meta, &env->me_txn0->tw.troika);
+        if (likely(rc == MDBX_SUCCESS)) {
+          env->me_dbgeo.now = pgno2bytes(env, new_geo.now = meta.mm_geo.now);
+          env->me_dbgeo.upper =
+              pgno2bytes(env, new_geo.upper = meta.mm_geo.upper);
+        }
+      }
     }
-    if (size > INT_MAX || (size & (env->me_os_psize - 1)) != 0 ||
-        size < env->me_os_psize) {
-      ERROR("lck-file has invalid size %" PRIu64 " bytes", size);
-      err = MDBX_PROBLEM;
-      goto bailout;
+    if (likely(rc == MDBX_SUCCESS)) {
+      /* update env-geo to avoid influences */
+      eASSERT(env, env->me_dbgeo.now == pgno2bytes(env, new_geo.now));
+      env->me_dbgeo.lower = pgno2bytes(env, new_geo.lower);
+      eASSERT(env, env->me_dbgeo.upper == pgno2bytes(env, new_geo.upper));
+      env->me_dbgeo.grow = pgno2bytes(env, pv2pages(new_geo.grow_pv));
+      env->me_dbgeo.shrink = pgno2bytes(env, pv2pages(new_geo.shrink_pv));
     }
   }
 
-  const size_t maxreaders =
-      ((size_t)size - sizeof(MDBX_lockinfo)) / sizeof(MDBX_reader);
-  if (maxreaders < 4) {
-    ERROR("lck-size too small (up to %" PRIuPTR " readers)", maxreaders);
-    err = MDBX_PROBLEM;
-    goto bailout;
-  }
-  env->me_maxreaders = (maxreaders <= MDBX_READERS_LIMIT)
-                           ? (unsigned)maxreaders
-                           : (unsigned)MDBX_READERS_LIMIT;
+bailout:
+  if (need_unlock)
+    mdbx_txn_unlock(env);
+  return rc;
+}
 
-  err = osal_mmap((env->me_flags & MDBX_EXCLUSIVE) | MDBX_WRITEMAP,
-                  &env->me_lck_mmap, (size_t)size, (size_t)size,
-                  lck_seize_rc ? MMAP_OPTION_TRUNCATE | MMAP_OPTION_SEMAPHORE
-                               : MMAP_OPTION_SEMAPHORE);
-  if (unlikely(err != MDBX_SUCCESS))
-    goto bailout;
+#ifndef LIBMDBX_NO_EXPORTS_LEGACY_API
+__cold int mdbx_env_set_mapsize(MDBX_env *env, size_t size) {
+  return __inline_mdbx_env_set_mapsize(env, size);
+}
 
-#if MDBX_ENABLE_MADVISE
-#ifdef MADV_DODUMP
-  err = madvise(env->me_lck_mmap.lck, size, MADV_DODUMP) ? ignore_enosys(errno)
-                                                         : MDBX_SUCCESS;
-  if (unlikely(MDBX_IS_ERROR(err)))
-    goto bailout;
-#endif /* MADV_DODUMP */
+__cold int mdbx_env_set_maxdbs(MDBX_env *env, MDBX_dbi dbs) {
+  return __inline_mdbx_env_set_maxdbs(env, dbs);
+}
 
-#ifdef MADV_WILLNEED
-  err = madvise(env->me_lck_mmap.lck, size, MADV_WILLNEED)
-            ? ignore_enosys(errno)
-            : MDBX_SUCCESS;
-  if (unlikely(MDBX_IS_ERROR(err)))
-    goto bailout;
-#elif defined(POSIX_MADV_WILLNEED)
-  err = ignore_enosys(
-      posix_madvise(env->me_lck_mmap.lck, size, POSIX_MADV_WILLNEED));
-  if (unlikely(MDBX_IS_ERROR(err)))
-    goto bailout;
-#endif /* MADV_WILLNEED */
-#endif /* MDBX_ENABLE_MADVISE */
+__cold int mdbx_env_get_maxdbs(const MDBX_env *env, MDBX_dbi *dbs) {
+  return __inline_mdbx_env_get_maxdbs(env, dbs);
+}
 
-  struct MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
-  if (lck_seize_rc == MDBX_RESULT_TRUE) {
-    /* LY: exclusive mode, check and reset lck content */
-    memset(lck, 0, (size_t)size);
-    jitter4testing(false);
-    lck->mti_magic_and_version = MDBX_LOCK_MAGIC;
-    lck->mti_os_and_format = MDBX_LOCK_FORMAT;
-#if MDBX_ENABLE_PGOP_STAT
-    lck->mti_pgop_stat.wops.weak = 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-    err = osal_msync(&env->me_lck_mmap, 0, (size_t)size,
-                     MDBX_SYNC_DATA | MDBX_SYNC_SIZE);
-    if (unlikely(err != MDBX_SUCCESS)) {
-      ERROR("initial-%s for lck-file failed, err %d", "msync/fsync", err);
-      goto bailout;
-    }
-  } else {
-    if (lck->mti_magic_and_version != MDBX_LOCK_MAGIC) {
-      const bool invalid = (lck->mti_magic_and_version >> 8) != MDBX_MAGIC;
-      ERROR("lock region has %s",
-            invalid
-                ? "invalid magic"
-                : "incompatible version (only applications with nearly or the "
-                  "same versions of libmdbx can share the same database)");
-      err = invalid ? MDBX_INVALID : MDBX_VERSION_MISMATCH;
-      goto bailout;
-    }
-    if (lck->mti_os_and_format != MDBX_LOCK_FORMAT) {
-      ERROR("lock region has os/format signature 0x%" PRIx32
-            ", expected 0x%" PRIx32,
-            lck->mti_os_and_format, MDBX_LOCK_FORMAT);
-      err = MDBX_VERSION_MISMATCH;
-      goto bailout;
-    }
-  }
-
-  err = osal_lck_init(env, inprocess_neighbor, lck_seize_rc);
-  if (MDBX_IS_ERROR(err))
-    goto bailout;
+__cold int mdbx_env_set_maxreaders(MDBX_env *env, unsigned readers) {
+  return __inline_mdbx_env_set_maxreaders(env, readers);
+}
 
-  ENSURE(env, env->me_lcklist_next == nullptr);
-  /* insert into inprocess lck-list */
-  env->me_lcklist_next = inprocess_lcklist_head;
-  inprocess_lcklist_head = env;
-  lcklist_unlock();
-  /* end of a locked section ------------------------------------------------ */
+__cold int mdbx_env_get_maxreaders(const MDBX_env *env, unsigned *readers) {
+  return __inline_mdbx_env_get_maxreaders(env, readers);
+}
+#endif /* LIBMDBX_NO_EXPORTS_LEGACY_API */
 
-  eASSERT(env, !MDBX_IS_ERROR(lck_seize_rc));
-  env->me_lck = lck;
-  return lck_seize_rc;
+__cold static int alloc_page_buf(MDBX_env *env) {
+  return env->me_pbuf ? MDBX_SUCCESS
+                      : osal_memalign_alloc(env->me_os_psize,
+                                            env->me_psize * (size_t)NUM_METAS,
+                                            &env->me_pbuf);
 }
 
-__cold int mdbx_is_readahead_reasonable(size_t volume, intptr_t redundancy) {
-  if (volume <= 1024 * 1024 * 4ul)
-    return MDBX_RESULT_TRUE;
+/* Further setup required for opening an MDBX environment */
+__cold static int setup_dxb(MDBX_env *env, const int lck_rc,
+                            const mdbx_mode_t mode_bits) {
+  MDBX_meta header;
+  int rc = MDBX_RESULT_FALSE;
+  int err = read_header(env, &header, lck_rc, mode_bits);
+  if (unlikely(err != MDBX_SUCCESS)) {
+    if (lck_rc != /* lck exclusive */ MDBX_RESULT_TRUE || err != MDBX_ENODATA ||
+        (env->me_flags & MDBX_RDONLY) != 0 ||
+        /* recovery mode */ env->me_stuck_meta >= 0)
+      return err;
 
-  intptr_t pagesize, total_ram_pages;
-  int err = mdbx_get_sysraminfo(&pagesize, &total_ram_pages, nullptr);
-  if (unlikely(err != MDBX_SUCCESS))
-    return err;
+    DEBUG("%s", "create new database");
+    rc = /* new database */ MDBX_RESULT_TRUE;
 
-  const int log2page = log2n_powerof2(pagesize);
-  const intptr_t volume_pages = (volume + pagesize - 1) >> log2page;
-  const intptr_t redundancy_pages =
-      (redundancy < 0) ? -(intptr_t)((-redundancy + pagesize - 1) >> log2page)
-                       : (intptr_t)(redundancy + pagesize - 1) >> log2page;
-  if (volume_pages >= total_ram_pages ||
-      volume_pages + redundancy_pages >= total_ram_pages)
-    return MDBX_RESULT_FALSE;
+    if (!env->me_dbgeo.now) {
+      /* set defaults if not configured */
+      err = mdbx_env_set_geometry(env, 0, -1, DEFAULT_MAPSIZE, -1, -1, -1);
+      if (unlikely(err != MDBX_SUCCESS))
+        return err;
+    }
 
-  intptr_t avail_ram_pages;
-  err = mdbx_get_sysraminfo(nullptr, nullptr, &avail_ram_pages);
-  if (unlikely(err != MDBX_SUCCESS))
-    return err;
+    err = alloc_page_buf(env);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
 
-  return (volume_pages + redundancy_pages >= avail_ram_pages)
-             ? MDBX_RESULT_FALSE
-             : MDBX_RESULT_TRUE;
-}
+    header = *init_metas(env, env->me_pbuf);
+    err = osal_pwrite(env->me_lazy_fd, env->me_pbuf,
+                      env->me_psize * (size_t)NUM_METAS, 0);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
 
-/* Merge sync flags */
-static uint32_t merge_sync_flags(const uint32_t a, const uint32_t b) {
-  uint32_t r = a | b;
+    err = osal_ftruncate(env->me_lazy_fd, env->me_dxb_mmap.filesize =
+                                              env->me_dxb_mmap.current =
+                                                  env->me_dbgeo.now);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
 
-  /* avoid false MDBX_UTTERLY_NOSYNC */
-  if (F_ISSET(r, MDBX_UTTERLY_NOSYNC) && !F_ISSET(a, MDBX_UTTERLY_NOSYNC) &&
-      !F_ISSET(b, MDBX_UTTERLY_NOSYNC))
-    r = (r - MDBX_UTTERLY_NOSYNC) | MDBX_SAFE_NOSYNC;
+#ifndef NDEBUG /* just for checking */
+    err = read_header(env, &header, lck_rc, mode_bits);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
+#endif
+  }
 
-  /* convert MDBX_DEPRECATED_MAPASYNC to MDBX_SAFE_NOSYNC */
-  if ((r & (MDBX_WRITEMAP | MDBX_DEPRECATED_MAPASYNC)) ==
-          (MDBX_WRITEMAP | MDBX_DEPRECATED_MAPASYNC) &&
-      !F_ISSET(r, MDBX_UTTERLY_NOSYNC))
-    r = (r - MDBX_DEPRECATED_MAPASYNC) | MDBX_SAFE_NOSYNC;
+  VERBOSE("header: root %" PRIaPGNO "/%" PRIaPGNO ", geo %" PRIaPGNO
+          "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO " +%u -%u, txn_id %" PRIaTXN
+          ", %s",
+          header.mm_dbs[MAIN_DBI].md_root, header.mm_dbs[FREE_DBI].md_root,
+          header.mm_geo.lower, header.mm_geo.next, header.mm_geo.now,
+          header.mm_geo.upper, pv2pages(header.mm_geo.grow_pv),
+          pv2pages(header.mm_geo.shrink_pv),
+          unaligned_peek_u64(4, header.mm_txnid_a), durable_caption(&header));
 
-  /* force MDBX_NOMETASYNC if NOSYNC enabled */
-  if (r & (MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC))
-    r |= MDBX_NOMETASYNC;
+  if (env->me_psize != header.mm_psize)
+    setup_pagesize(env, header.mm_psize);
+  const size_t used_bytes = pgno2bytes(env, header.mm_geo.next);
+  const size_t used_aligned2os_bytes =
+      ceil_powerof2(used_bytes, env->me_os_psize);
+  if ((env->me_flags & MDBX_RDONLY) /* readonly */
+      || lck_rc != MDBX_RESULT_TRUE /* not exclusive */
+      || /* recovery mode */ env->me_stuck_meta >= 0) {
+    /* use present params from db */
+    const size_t pagesize = header.mm_psize;
+    err = mdbx_env_set_geometry(
+        env, header.mm_geo.lower * pagesize, header.mm_geo.now * pagesize,
+        header.mm_geo.upper * pagesize,
+        pv2pages(header.mm_geo.grow_pv) * pagesize,
+        pv2pages(header.mm_geo.shrink_pv) * pagesize, header.mm_psize);
+    if (unlikely(err != MDBX_SUCCESS)) {
+      ERROR("%s: err %d", "could not apply geometry from db", err);
+      return (err == MDBX_EINVAL) ? MDBX_INCOMPATIBLE : err;
+    }
+  } else if (env->me_dbgeo.now) {
+    /* silently growth to last used page */
+    if (env->me_dbgeo.now < used_aligned2os_bytes)
+      env->me_dbgeo.now = used_aligned2os_bytes;
+    if (env->me_dbgeo.upper < used_aligned2os_bytes)
+      env->me_dbgeo.upper = used_aligned2os_bytes;
 
-  assert(!(F_ISSET(r, MDBX_UTTERLY_NOSYNC) &&
-           !F_ISSET(a, MDBX_UTTERLY_NOSYNC) &&
-           !F_ISSET(b, MDBX_UTTERLY_NOSYNC)));
-  return r;
-}
+    /* apply preconfigured params, but only if substantial changes:
+     *  - upper or lower limit changes
+     *  - shrink threshold or growth step
+     * But ignore change just a 'now/current' size. */
+    if (bytes_align2os_bytes(env, env->me_dbgeo.upper) !=
+            pgno2bytes(env, header.mm_geo.upper) ||
+        bytes_align2os_bytes(env, env->me_dbgeo.lower) !=
+            pgno2bytes(env, header.mm_geo.lower) ||
+        bytes_align2os_bytes(env, env->me_dbgeo.shrink) !=
+            pgno2bytes(env, pv2pages(header.mm_geo.shrink_pv)) ||
+        bytes_align2os_bytes(env, env->me_dbgeo.grow) !=
+            pgno2bytes(env, pv2pages(header.mm_geo.grow_pv))) {
 
-__cold static int __must_check_result override_meta(MDBX_env *env,
-                                                    size_t target,
-                                                    txnid_t txnid,
-                                                    const MDBX_meta *shape) {
-  int rc = alloc_page_buf(env);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-  MDBX_page *const page = env->me_pbuf;
-  meta_model(env, page, target);
-  MDBX_meta *const model = page_meta(page);
-  meta_set_txnid(env, model, txnid);
-  if (txnid)
-    eASSERT(env, coherency_check_meta(env, model, true));
-  if (shape) {
-    if (txnid && unlikely(!coherency_check_meta(env, shape, false))) {
-      ERROR("bailout overriding meta-%zu since model failed "
-            "freedb/maindb %s-check for txnid #%" PRIaTXN,
-            target, "pre", constmeta_txnid(shape));
-      return MDBX_PROBLEM;
-    }
-    if (runtime_flags & MDBX_DBG_DONT_UPGRADE)
-      memcpy(&model->mm_magic_and_version, &shape->mm_magic_and_version,
-             sizeof(model->mm_magic_and_version));
-    model->mm_extra_flags = shape->mm_extra_flags;
-    model->mm_validator_id = shape->mm_validator_id;
-    model->mm_extra_pagehdr = shape->mm_extra_pagehdr;
-    memcpy(&model->mm_geo, &shape->mm_geo, sizeof(model->mm_geo));
-    memcpy(&model->mm_dbs, &shape->mm_dbs, sizeof(model->mm_dbs));
-    memcpy(&model->mm_canary, &shape->mm_canary, sizeof(model->mm_canary));
-    memcpy(&model->mm_pages_retired, &shape->mm_pages_retired,
-           sizeof(model->mm_pages_retired));
-    if (txnid) {
-      if ((!model->mm_dbs[FREE_DBI].md_mod_txnid &&
-           model->mm_dbs[FREE_DBI].md_root != P_INVALID) ||
-          (!model->mm_dbs[MAIN_DBI].md_mod_txnid &&
-           model->mm_dbs[MAIN_DBI].md_root != P_INVALID))
-        memcpy(&model->mm_magic_and_version, &shape->mm_magic_and_version,
-               sizeof(model->mm_magic_and_version));
-      if (unlikely(!coherency_check_meta(env, model, false))) {
-        ERROR("bailout overriding meta-%zu since model failed "
-              "freedb/maindb %s-check for txnid #%" PRIaTXN,
-              target, "post", txnid);
-        return MDBX_PROBLEM;
+      if (env->me_dbgeo.shrink && env->me_dbgeo.now > used_bytes)
+        /* pre-shrink if enabled */
+        env->me_dbgeo.now = used_bytes + env->me_dbgeo.shrink -
+                            used_bytes % env->me_dbgeo.shrink;
+
+      err = mdbx_env_set_geometry(env, env->me_dbgeo.lower, env->me_dbgeo.now,
+                                  env->me_dbgeo.upper, env->me_dbgeo.grow,
+                                  env->me_dbgeo.shrink, header.mm_psize);
+      if (unlikely(err != MDBX_SUCCESS)) {
+        ERROR("%s: err %d", "could not apply preconfigured db-geometry", err);
+        return (err == MDBX_EINVAL) ? MDBX_INCOMPATIBLE : err;
       }
-    }
-  }
-  unaligned_poke_u64(4, model->mm_sign, meta_sign(model));
-  rc = validate_meta(env, model, page, (pgno_t)target, nullptr);
-  if (unlikely(MDBX_IS_ERROR(rc)))
-    return MDBX_PROBLEM;
 
-  if (shape && memcmp(model, shape, sizeof(MDBX_meta)) == 0)
-    return MDBX_SUCCESS;
+      /* update meta fields */
+      header.mm_geo.now = bytes2pgno(env, env->me_dbgeo.now);
+      header.mm_geo.lower = bytes2pgno(env, env->me_dbgeo.lower);
+      header.mm_geo.upper = bytes2pgno(env, env->me_dbgeo.upper);
+      header.mm_geo.grow_pv = pages2pv(bytes2pgno(env, env->me_dbgeo.grow));
+      header.mm_geo.shrink_pv = pages2pv(bytes2pgno(env, env->me_dbgeo.shrink));
 
-  if (env->me_flags & MDBX_WRITEMAP) {
-#if MDBX_ENABLE_PGOP_STAT
-    env->me_lck->mti_pgop_stat.msync.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-    rc = osal_msync(&env->me_dxb_mmap, 0,
-                    pgno_align2os_bytes(env, model->mm_geo.next),
-                    MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    /* override_meta() called only while current process have exclusive
-     * lock of a DB file. So meta-page could be updated directly without
-     * clearing consistency flag by mdbx_meta_update_begin() */
-    memcpy(pgno2page(env, target), page, env->me_psize);
-    osal_flush_incoherent_cpu_writeback();
-#if MDBX_ENABLE_PGOP_STAT
-    env->me_lck->mti_pgop_stat.msync.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-    rc = osal_msync(&env->me_dxb_mmap, 0, pgno_align2os_bytes(env, target + 1),
-                    MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
-  } else {
-#if MDBX_ENABLE_PGOP_STAT
-    env->me_lck->mti_pgop_stat.wops.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-    rc = osal_pwrite(env->me_fd4meta, page, env->me_psize,
-                     pgno2bytes(env, target));
-    if (rc == MDBX_SUCCESS && env->me_fd4meta == env->me_lazy_fd) {
-#if MDBX_ENABLE_PGOP_STAT
-      env->me_lck->mti_pgop_stat.fsync.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-      rc = osal_fsync(env->me_lazy_fd, MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
+      VERBOSE("amended: root %" PRIaPGNO "/%" PRIaPGNO ", geo %" PRIaPGNO
+              "/%" PRIaPGNO "-%" PRIaPGNO "/%" PRIaPGNO
+              " +%u -%u, txn_id %" PRIaTXN ", %s",
+              header.mm_dbs[MAIN_DBI].md_root, header.mm_dbs[FREE_DBI].md_root,
+              header.mm_geo.lower, header.mm_geo.next, header.mm_geo.now,
+              header.mm_geo.upper, pv2pages(header.mm_geo.grow_pv),
+              pv2pages(header.mm_geo.shrink_pv),
+              unaligned_peek_u64(4, header.mm_txnid_a),
+              durable_caption(&header));
+    } else {
+      /* fetch back 'now/current' size, since it was ignored during comparison
+       * and may differ. */
+      env->me_dbgeo.now = pgno_align2os_bytes(env, header.mm_geo.now);
     }
-    osal_flush_incoherent_mmap(env->me_map, pgno2bytes(env, NUM_METAS),
-                               env->me_os_psize);
+    ENSURE(env, header.mm_geo.now >= header.mm_geo.next);
+  } else {
+    /* geo-params are not pre-configured by user,
+     * get current values from the meta. */
+    env->me_dbgeo.now = pgno2bytes(env, header.mm_geo.now);
+    env->me_dbgeo.lower = pgno2bytes(env, header.mm_geo.lower);
+    env->me_dbgeo.upper = pgno2bytes(env, header.mm_geo.upper);
+    env->me_dbgeo.grow = pgno2bytes(env, pv2pages(header.mm_geo.grow_pv));
+    env->me_dbgeo.shrink = pgno2bytes(env, pv2pages(header.mm_geo.shrink_pv));
   }
-  eASSERT(env, !env->me_txn && !env->me_txn0);
-  return rc;
-}
-
-__cold int mdbx_env_turn_for_recovery(MDBX_env *env, unsigned target) {
-  if (unlikely(target >= NUM_METAS))
-    return MDBX_EINVAL;
-  int rc = check_env(env, true);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
 
-  if (unlikely((env->me_flags & (MDBX_EXCLUSIVE | MDBX_RDONLY)) !=
-               MDBX_EXCLUSIVE))
-    return MDBX_EPERM;
-
-  const MDBX_meta *target_meta = METAPAGE(env, target);
-  txnid_t new_txnid = safe64_txnid_next(constmeta_txnid(target_meta));
-  for (size_t n = 0; n < NUM_METAS; ++n) {
-    if (n == target)
-      continue;
-    MDBX_meta meta = *METAPAGE(env, target);
-    if (validate_meta(env, &meta, pgno2page(env, n), (pgno_t)n, nullptr) !=
-        MDBX_SUCCESS) {
-      int err = override_meta(env, n, 0, nullptr);
-      if (unlikely(err != MDBX_SUCCESS))
-        return err;
+  ENSURE(env, pgno_align2os_bytes(env, header.mm_geo.now) == env->me_dbgeo.now);
+  ENSURE(env, env->me_dbgeo.now >= used_bytes);
+  const uint64_t filesize_before = env->me_dxb_mmap.filesize;
+  if (unlikely(filesize_before != env->me_dbgeo.now)) {
+    if (lck_rc != /* lck exclusive */ MDBX_RESULT_TRUE) {
+      VERBOSE("filesize mismatch (expect %" PRIuPTR "b/%" PRIaPGNO
+              "p, have %" PRIu64 "b/%" PRIaPGNO "p), "
+              "assume other process working",
+              env->me_dbgeo.now, bytes2pgno(env, env->me_dbgeo.now),
+              filesize_before, bytes2pgno(env, (size_t)filesize_before));
     } else {
-      txnid_t txnid = constmeta_txnid(&meta);
-      if (new_txnid <= txnid)
-        new_txnid = safe64_txnid_next(txnid);
-    }
-  }
+      WARNING("filesize mismatch (expect %" PRIuSIZE "b/%" PRIaPGNO
+              "p, have %" PRIu64 "b/%" PRIaPGNO "p)",
+              env->me_dbgeo.now, bytes2pgno(env, env->me_dbgeo.now),
+              filesize_before, bytes2pgno(env, (size_t)filesize_before));
+      if (filesize_before < used_bytes) {
+        ERROR("last-page beyond end-of-file (last %" PRIaPGNO
+              ", have %" PRIaPGNO ")",
+              header.mm_geo.next, bytes2pgno(env, (size_t)filesize_before));
+        return MDBX_CORRUPTED;
+      }
 
-  if (unlikely(new_txnid > MAX_TXNID)) {
-    ERROR("txnid overflow, raise %d", MDBX_TXN_FULL);
-    return MDBX_TXN_FULL;
+      if (env->me_flags & MDBX_RDONLY) {
+        if (filesize_before & (env->me_os_psize - 1)) {
+          ERROR("%s", "filesize should be rounded-up to system page");
+          return MDBX_WANNA_RECOVERY;
+        }
+        WARNING("%s", "ignore filesize mismatch in readonly-mode");
+      } else {
+        VERBOSE("will resize datafile to %" PRIuSIZE " bytes, %" PRIaPGNO
+                " pages",
+                env->me_dbgeo.now, bytes2pgno(env, env->me_dbgeo.now));
+      }
+    }
   }
-  return override_meta(env, target, new_txnid, target_meta);
-}
 
-__cold int mdbx_env_open_for_recovery(MDBX_env *env, const char *pathname,
-                                      unsigned target_meta, bool writeable) {
-#if defined(_WIN32) || defined(_WIN64)
-  wchar_t *pathnameW = nullptr;
-  int rc = osal_mb2w(pathname, &pathnameW);
-  if (likely(rc == MDBX_SUCCESS)) {
-    rc = mdbx_env_open_for_recoveryW(env, pathnameW, target_meta, writeable);
-    osal_free(pathnameW);
-  }
-  return rc;
-}
+  VERBOSE("current boot-id %" PRIx64 "-%" PRIx64 " (%savailable)", bootid.x,
+          bootid.y, (bootid.x | bootid.y) ? "" : "not-");
 
-__cold int mdbx_env_open_for_recoveryW(MDBX_env *env, const wchar_t *pathname,
-                                       unsigned target_meta, bool writeable) {
-#endif /* Windows */
+#if MDBX_ENABLE_MADVISE
+  /* calculate readahead hint before mmap with zero redundant pages */
+  const bool readahead =
+      !(env->me_flags & MDBX_NORDAHEAD) &&
+      mdbx_is_readahead_reasonable(used_bytes, 0) == MDBX_RESULT_TRUE;
+#endif /* MDBX_ENABLE_MADVISE */
 
-  if (unlikely(target_meta >= NUM_METAS))
-    return MDBX_EINVAL;
-  int rc = check_env(env, false);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-  if (unlikely(env->me_map))
-    return MDBX_EPERM;
+  err = osal_mmap(env->me_flags, &env->me_dxb_mmap, env->me_dbgeo.now,
+                  env->me_dbgeo.upper, lck_rc ? MMAP_OPTION_TRUNCATE : 0);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
 
-  env->me_stuck_meta = (int8_t)target_meta;
-  return
-#if defined(_WIN32) || defined(_WIN64)
-      mdbx_env_openW
-#else
-      mdbx_env_open
-#endif /* Windows */
-      (env, pathname, writeable ? MDBX_EXCLUSIVE : MDBX_EXCLUSIVE | MDBX_RDONLY,
-       0);
-}
+#if MDBX_ENABLE_MADVISE
+#if defined(MADV_DONTDUMP)
+  err = madvise(env->me_map, env->me_dxb_mmap.limit, MADV_DONTDUMP)
+            ? ignore_enosys(errno)
+            : MDBX_SUCCESS;
+  if (unlikely(MDBX_IS_ERROR(err)))
+    return err;
+#endif /* MADV_DONTDUMP */
+#if defined(MADV_DODUMP)
+  if (runtime_flags & MDBX_DBG_DUMP) {
+    const size_t meta_length_aligned2os = pgno_align2os_bytes(env, NUM_METAS);
+    err = madvise(env->me_map, meta_length_aligned2os, MADV_DODUMP)
+              ? ignore_enosys(errno)
+              : MDBX_SUCCESS;
+    if (unlikely(MDBX_IS_ERROR(err)))
+      return err;
+  }
+#endif /* MADV_DODUMP */
+#endif /* MDBX_ENABLE_MADVISE */
 
-typedef struct {
-  void *buffer_for_free;
-  pathchar_t *lck, *dxb;
-  size_t ent_len;
-} MDBX_handle_env_pathname;
+#ifdef MDBX_USE_VALGRIND
+  env->me_valgrind_handle =
+      VALGRIND_CREATE_BLOCK(env->me_map, env->me_dxb_mmap.limit, "mdbx");
+#endif /* MDBX_USE_VALGRIND */
 
-__cold static int check_alternative_lck_absent(const pathchar_t *lck_pathname) {
-  int err = osal_fileexists(lck_pathname);
-  if (unlikely(err != MDBX_RESULT_FALSE)) {
-    if (err == MDBX_RESULT_TRUE)
-      err = MDBX_DUPLICATED_CLK;
-    ERROR("Alternative/Duplicate LCK-file '%" MDBX_PRIsPATH "' error %d",
-          lck_pathname, err);
+  eASSERT(env, used_bytes >= pgno2bytes(env, NUM_METAS) &&
+                   used_bytes <= env->me_dxb_mmap.limit);
+#if defined(MDBX_USE_VALGRIND) || defined(__SANITIZE_ADDRESS__)
+  if (env->me_dxb_mmap.filesize > used_bytes &&
+      env->me_dxb_mmap.filesize < env->me_dxb_mmap.limit) {
+    VALGRIND_MAKE_MEM_NOACCESS(ptr_disp(env->me_map, used_bytes),
+                               env->me_dxb_mmap.filesize - used_bytes);
+    MDBX_ASAN_POISON_MEMORY_REGION(ptr_disp(env->me_map, used_bytes),
+                                   env->me_dxb_mmap.filesize - used_bytes);
   }
-  return err;
-}
+  env->me_poison_edge =
+      bytes2pgno(env, (env->me_dxb_mmap.filesize < env->me_dxb_mmap.limit)
+                          ? env->me_dxb_mmap.filesize
+                          : env->me_dxb_mmap.limit);
+#endif /* MDBX_USE_VALGRIND || __SANITIZE_ADDRESS__ */
 
-__cold static int handle_env_pathname(MDBX_handle_env_pathname *ctx,
-                                      const pathchar_t *pathname,
-                                      MDBX_env_flags_t *flags,
-                                      const mdbx_mode_t mode) {
-  memset(ctx, 0, sizeof(*ctx));
-  if (unlikely(!pathname || !*pathname))
-    return MDBX_EINVAL;
+  meta_troika_t troika = meta_tap(env);
+#if MDBX_DEBUG
+  meta_troika_dump(env, &troika);
+#endif
+  eASSERT(env, !env->me_txn && !env->me_txn0);
+  //-------------------------------- validate/rollback head & steady meta-pages
+  if (unlikely(env->me_stuck_meta >= 0)) {
+    /* recovery mode */
+    MDBX_meta clone;
+    MDBX_meta const *const target = METAPAGE(env, env->me_stuck_meta);
+    err = validate_meta_copy(env, target, &clone);
+    if (unlikely(err != MDBX_SUCCESS)) {
+      ERROR("target meta[%u] is corrupted",
+            bytes2pgno(env, ptr_dist(data_page(target), env->me_map)));
+      meta_troika_dump(env, &troika);
+      return MDBX_CORRUPTED;
+    }
+  } else /* not recovery mode */
+    while (1) {
+      const unsigned meta_clash_mask = meta_eq_mask(&troika);
+      if (unlikely(meta_clash_mask)) {
+        ERROR("meta-pages are clashed: mask 0x%d", meta_clash_mask);
+        meta_troika_dump(env, &troika);
+        return MDBX_CORRUPTED;
+      }
 
-  int rc;
-#if defined(_WIN32) || defined(_WIN64)
-  const DWORD dwAttrib = GetFileAttributesW(pathname);
-  if (dwAttrib == INVALID_FILE_ATTRIBUTES) {
-    rc = GetLastError();
-    if (rc != MDBX_ENOFILE)
-      return rc;
-    if (mode == 0 || (*flags & MDBX_RDONLY) != 0)
-      /* can't open existing */
-      return rc;
+      if (lck_rc != /* lck exclusive */ MDBX_RESULT_TRUE) {
+        /* non-exclusive mode,
+         * meta-pages should be validated by a first process opened the DB */
+        if (troika.recent == troika.prefer_steady)
+          break;
 
-    /* auto-create directory if requested */
-    if ((*flags & MDBX_NOSUBDIR) == 0 && !CreateDirectoryW(pathname, nullptr)) {
-      rc = GetLastError();
-      if (rc != ERROR_ALREADY_EXISTS)
-        return rc;
-    }
-  } else {
-    /* ignore passed MDBX_NOSUBDIR flag and set it automatically */
-    *flags |= MDBX_NOSUBDIR;
-    if (dwAttrib & FILE_ATTRIBUTE_DIRECTORY)
-      *flags -= MDBX_NOSUBDIR;
-  }
-#else
-  struct stat st;
-  if (stat(pathname, &st) != 0) {
-    rc = errno;
-    if (rc != MDBX_ENOFILE)
-      return rc;
-    if (mode == 0 || (*flags & MDBX_RDONLY) != 0)
-      /* can't open non-existing */
-      return rc /* MDBX_ENOFILE */;
+        if (!env->me_lck_mmap.lck) {
+          /* LY: without-lck (read-only) mode, so it is impossible that other
+           * process made weak checkpoint. */
+          ERROR("%s", "without-lck, unable recovery/rollback");
+          meta_troika_dump(env, &troika);
+          return MDBX_WANNA_RECOVERY;
+        }
 
-    /* auto-create directory if requested */
-    const mdbx_mode_t dir_mode =
-        (/* inherit read/write permissions for group and others */ mode &
-         (S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) |
-        /* always add read/write/search for owner */ S_IRWXU |
-        ((mode & S_IRGRP) ? /* +search if readable by group */ S_IXGRP : 0) |
-        ((mode & S_IROTH) ? /* +search if readable by others */ S_IXOTH : 0);
-    if ((*flags & MDBX_NOSUBDIR) == 0 && mkdir(pathname, dir_mode)) {
-      rc = errno;
-      if (rc != EEXIST)
-        return rc;
-    }
-  } else {
-    /* ignore passed MDBX_NOSUBDIR flag and set it automatically */
-    *flags |= MDBX_NOSUBDIR;
-    if (S_ISDIR(st.st_mode))
-      *flags -= MDBX_NOSUBDIR;
-  }
-#endif
+        /* LY: assume just have a collision with other running process,
+         *     or someone make a weak checkpoint */
+        VERBOSE("%s", "assume collision or online weak checkpoint");
+        break;
+      }
+      eASSERT(env, lck_rc == MDBX_RESULT_TRUE);
+      /* exclusive mode */
 
-  static const pathchar_t dxb_name[] = MDBX_DATANAME;
-  static const pathchar_t lck_name[] = MDBX_LOCKNAME;
-  static const pathchar_t lock_suffix[] = MDBX_LOCK_SUFFIX;
+      const meta_ptr_t recent = meta_recent(env, &troika);
+      const meta_ptr_t prefer_steady = meta_prefer_steady(env, &troika);
+      MDBX_meta clone;
+      if (prefer_steady.is_steady) {
+        err = validate_meta_copy(env, prefer_steady.ptr_c, &clone);
+        if (unlikely(err != MDBX_SUCCESS)) {
+          ERROR("meta[%u] with %s txnid %" PRIaTXN " is corrupted, %s needed",
+                bytes2pgno(env, ptr_dist(prefer_steady.ptr_c, env->me_map)),
+                "steady", prefer_steady.txnid, "manual recovery");
+          meta_troika_dump(env, &troika);
+          return MDBX_CORRUPTED;
+        }
+        if (prefer_steady.ptr_c == recent.ptr_c)
+          break;
+      }
 
-#if defined(_WIN32) || defined(_WIN64)
-  assert(dxb_name[0] == '\\' && lck_name[0] == '\\');
-  const size_t pathname_len = wcslen(pathname);
-#else
-  assert(dxb_name[0] == '/' && lck_name[0] == '/');
-  const size_t pathname_len = strlen(pathname);
-#endif
-  assert(!osal_isdirsep(lock_suffix[0]));
-  ctx->ent_len = pathname_len;
-  static const size_t dxb_name_len = ARRAY_LENGTH(dxb_name) - 1;
-  if (*flags & MDBX_NOSUBDIR) {
-    if (ctx->ent_len > dxb_name_len &&
-        osal_pathequal(pathname + ctx->ent_len - dxb_name_len, dxb_name,
-                       dxb_name_len)) {
-      *flags -= MDBX_NOSUBDIR;
-      ctx->ent_len -= dxb_name_len;
-    } else if (ctx->ent_len == dxb_name_len - 1 && osal_isdirsep(dxb_name[0]) &&
-               osal_isdirsep(lck_name[0]) &&
-               osal_pathequal(pathname + ctx->ent_len - dxb_name_len + 1,
-                              dxb_name + 1, dxb_name_len - 1)) {
-      *flags -= MDBX_NOSUBDIR;
-      ctx->ent_len -= dxb_name_len - 1;
-    }
-  }
+      const pgno_t pgno = bytes2pgno(env, ptr_dist(recent.ptr_c, env->me_map));
+      const bool last_valid =
+          validate_meta_copy(env, recent.ptr_c, &clone) == MDBX_SUCCESS;
+      eASSERT(env,
+              !prefer_steady.is_steady || recent.txnid != prefer_steady.txnid);
+      if (unlikely(!last_valid)) {
+        if (unlikely(!prefer_steady.is_steady)) {
+          ERROR("%s for open or automatic rollback, %s",
+                "there are no suitable meta-pages",
+                "manual recovery is required");
+          meta_troika_dump(env, &troika);
+          return MDBX_CORRUPTED;
+        }
+        WARNING("meta[%u] with last txnid %" PRIaTXN
+                " is corrupted, rollback needed",
+                pgno, recent.txnid);
+        meta_troika_dump(env, &troika);
+        goto purge_meta_head;
+      }
 
-  const size_t suflen_with_NOSUBDIR = sizeof(lock_suffix) + sizeof(pathchar_t);
-  const size_t suflen_without_NOSUBDIR = sizeof(lck_name) + sizeof(dxb_name);
-  const size_t enogh4any = (suflen_with_NOSUBDIR > suflen_without_NOSUBDIR)
-                               ? suflen_with_NOSUBDIR
-                               : suflen_without_NOSUBDIR;
-  const size_t bytes_needed = sizeof(pathchar_t) * ctx->ent_len * 2 + enogh4any;
-  ctx->buffer_for_free = osal_malloc(bytes_needed);
-  if (!ctx->buffer_for_free)
-    return MDBX_ENOMEM;
+      if (meta_bootid_match(recent.ptr_c)) {
+        if (env->me_flags & MDBX_RDONLY) {
+          ERROR("%s, but boot-id(%016" PRIx64 "-%016" PRIx64 ") is MATCH: "
+                "rollback NOT needed, steady-sync NEEDED%s",
+                "opening after an unclean shutdown", bootid.x, bootid.y,
+                ", but unable in read-only mode");
+          meta_troika_dump(env, &troika);
+          return MDBX_WANNA_RECOVERY;
+        }
+        WARNING("%s, but boot-id(%016" PRIx64 "-%016" PRIx64 ") is MATCH: "
+                "rollback NOT needed, steady-sync NEEDED%s",
+                "opening after an unclean shutdown", bootid.x, bootid.y, "");
+        header = clone;
+        env->me_lck->mti_unsynced_pages.weak = header.mm_geo.next;
+        if (!env->me_lck->mti_eoos_timestamp.weak)
+          env->me_lck->mti_eoos_timestamp.weak = osal_monotime();
+        break;
+      }
+      if (unlikely(!prefer_steady.is_steady)) {
+        ERROR("%s, but %s for automatic rollback: %s",
+              "opening after an unclean shutdown",
+              "there are no suitable meta-pages",
+              "manual recovery is required");
+        meta_troika_dump(env, &troika);
+        return MDBX_CORRUPTED;
+      }
+      if (env->me_flags & MDBX_RDONLY) {
+        ERROR("%s and rollback needed: (from head %" PRIaTXN
+              " to steady %" PRIaTXN ")%s",
+              "opening after an unclean shutdown", recent.txnid,
+              prefer_steady.txnid, ", but unable in read-only mode");
+        meta_troika_dump(env, &troika);
+        return MDBX_WANNA_RECOVERY;
+      }
 
-  ctx->dxb = ctx->buffer_for_free;
-  ctx->lck = ctx->dxb + ctx->ent_len + dxb_name_len + 1;
-  pathchar_t *const buf = ctx->buffer_for_free;
-  rc = MDBX_SUCCESS;
-  if (ctx->ent_len) {
-    memcpy(buf + /* shutting up goofy MSVC static analyzer */ 0, pathname,
-           sizeof(pathchar_t) * pathname_len);
-    if (*flags & MDBX_NOSUBDIR) {
-      const pathchar_t *const lck_ext =
-          osal_fileext(lck_name, ARRAY_LENGTH(lck_name));
-      if (lck_ext) {
-        pathchar_t *pathname_ext = osal_fileext(buf, pathname_len);
-        memcpy(pathname_ext ? pathname_ext : buf + pathname_len, lck_ext,
-               sizeof(pathchar_t) * (ARRAY_END(lck_name) - lck_ext));
-        rc = check_alternative_lck_absent(buf);
+    purge_meta_head:
+      NOTICE("%s and doing automatic rollback: "
+             "purge%s meta[%u] with%s txnid %" PRIaTXN,
+             "opening after an unclean shutdown", last_valid ? "" : " invalid",
+             pgno, last_valid ? " weak" : "", recent.txnid);
+      meta_troika_dump(env, &troika);
+      ENSURE(env, prefer_steady.is_steady);
+      err = override_meta(env, pgno, 0,
+                          last_valid ? recent.ptr_c : prefer_steady.ptr_c);
+      if (err) {
+        ERROR("rollback: overwrite meta[%u] with txnid %" PRIaTXN ", error %d",
+              pgno, recent.txnid, err);
+        return err;
       }
-    } else {
-      memcpy(buf + ctx->ent_len, dxb_name, sizeof(dxb_name));
-      memcpy(buf + ctx->ent_len + dxb_name_len, lock_suffix,
-             sizeof(lock_suffix));
-      rc = check_alternative_lck_absent(buf);
+      troika = meta_tap(env);
+      ENSURE(env, 0 == meta_txnid(recent.ptr_v));
+      ENSURE(env, 0 == meta_eq_mask(&troika));
     }
 
-    memcpy(ctx->dxb + /* shutting up goofy MSVC static analyzer */ 0, pathname,
-           sizeof(pathchar_t) * (ctx->ent_len + 1));
-    memcpy(ctx->lck, pathname, sizeof(pathchar_t) * ctx->ent_len);
-    if (*flags & MDBX_NOSUBDIR) {
-      memcpy(ctx->lck + ctx->ent_len, lock_suffix, sizeof(lock_suffix));
-    } else {
-      memcpy(ctx->dxb + ctx->ent_len, dxb_name, sizeof(dxb_name));
-      memcpy(ctx->lck + ctx->ent_len, lck_name, sizeof(lck_name));
+  if (lck_rc == /* lck exclusive */ MDBX_RESULT_TRUE) {
+    //-------------------------------------------------- shrink DB & update geo
+    /* re-check size after mmap */
+    if ((env->me_dxb_mmap.current & (env->me_os_psize - 1)) != 0 ||
+        env->me_dxb_mmap.current < used_bytes) {
+      ERROR("unacceptable/unexpected datafile size %" PRIuPTR,
+            env->me_dxb_mmap.current);
+      return MDBX_PROBLEM;
+    }
+    if (env->me_dxb_mmap.current != env->me_dbgeo.now) {
+      header.mm_geo.now = bytes2pgno(env, env->me_dxb_mmap.current);
+      NOTICE("need update meta-geo to filesize %" PRIuPTR " bytes, %" PRIaPGNO
+             " pages",
+             env->me_dxb_mmap.current, header.mm_geo.now);
     }
-  } else {
-    assert(!(*flags & MDBX_NOSUBDIR));
-    memcpy(buf + /* shutting up goofy MSVC static analyzer */ 0, dxb_name + 1,
-           sizeof(dxb_name) - sizeof(pathchar_t));
-    memcpy(buf + dxb_name_len - 1, lock_suffix, sizeof(lock_suffix));
-    rc = check_alternative_lck_absent(buf);
-
-    memcpy(ctx->dxb + /* shutting up goofy MSVC static analyzer */ 0,
-           dxb_name + 1, sizeof(dxb_name) - sizeof(pathchar_t));
-    memcpy(ctx->lck, lck_name + 1, sizeof(lck_name) - sizeof(pathchar_t));
-  }
-  return rc;
-}
-
-__cold int mdbx_env_delete(const char *pathname, MDBX_env_delete_mode_t mode) {
-#if defined(_WIN32) || defined(_WIN64)
-  wchar_t *pathnameW = nullptr;
-  int rc = osal_mb2w(pathname, &pathnameW);
-  if (likely(rc == MDBX_SUCCESS)) {
-    rc = mdbx_env_deleteW(pathnameW, mode);
-    osal_free(pathnameW);
-  }
-  return rc;
-}
-
-__cold int mdbx_env_deleteW(const wchar_t *pathname,
-                            MDBX_env_delete_mode_t mode) {
-#endif /* Windows */
-
-  switch (mode) {
-  default:
-    return MDBX_EINVAL;
-  case MDBX_ENV_JUST_DELETE:
-  case MDBX_ENV_ENSURE_UNUSED:
-  case MDBX_ENV_WAIT_FOR_UNUSED:
-    break;
-  }
 
-#ifdef __e2k__ /* https://bugs.mcst.ru/bugzilla/show_bug.cgi?id=6011 */
-  MDBX_env *const dummy_env = alloca(sizeof(MDBX_env));
-#else
-  MDBX_env dummy_env_silo, *const dummy_env = &dummy_env_silo;
-#endif
-  memset(dummy_env, 0, sizeof(*dummy_env));
-  dummy_env->me_flags =
-      (mode == MDBX_ENV_ENSURE_UNUSED) ? MDBX_EXCLUSIVE : MDBX_ENV_DEFAULTS;
-  dummy_env->me_os_psize = (unsigned)osal_syspagesize();
-  dummy_env->me_psize = (unsigned)mdbx_default_pagesize();
-  dummy_env->me_pathname = (pathchar_t *)pathname;
+    const meta_ptr_t recent = meta_recent(env, &troika);
+    if (memcmp(&header.mm_geo, &recent.ptr_c->mm_geo, sizeof(header.mm_geo))) {
+      if ((env->me_flags & MDBX_RDONLY) != 0 ||
+          /* recovery mode */ env->me_stuck_meta >= 0) {
+        WARNING("skipped update meta.geo in %s mode: from l%" PRIaPGNO
+                "-n%" PRIaPGNO "-u%" PRIaPGNO "/s%u-g%u, to l%" PRIaPGNO
+                "-n%" PRIaPGNO "-u%" PRIaPGNO "/s%u-g%u",
+                (env->me_stuck_meta < 0) ? "read-only" : "recovery",
+                recent.ptr_c->mm_geo.lower, recent.ptr_c->mm_geo.now,
+                recent.ptr_c->mm_geo.upper,
+                pv2pages(recent.ptr_c->mm_geo.shrink_pv),
+                pv2pages(recent.ptr_c->mm_geo.grow_pv), header.mm_geo.lower,
+                header.mm_geo.now, header.mm_geo.upper,
+                pv2pages(header.mm_geo.shrink_pv),
+                pv2pages(header.mm_geo.grow_pv));
+      } else {
+        const txnid_t next_txnid = safe64_txnid_next(recent.txnid);
+        if (unlikely(next_txnid > MAX_TXNID)) {
+          ERROR("txnid overflow, raise %d", MDBX_TXN_FULL);
+          return MDBX_TXN_FULL;
+        }
+        NOTICE("updating meta.geo: "
+               "from l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
+               "/s%u-g%u (txn#%" PRIaTXN "), "
+               "to l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
+               "/s%u-g%u (txn#%" PRIaTXN ")",
+               recent.ptr_c->mm_geo.lower, recent.ptr_c->mm_geo.now,
+               recent.ptr_c->mm_geo.upper,
+               pv2pages(recent.ptr_c->mm_geo.shrink_pv),
+               pv2pages(recent.ptr_c->mm_geo.grow_pv), recent.txnid,
+               header.mm_geo.lower, header.mm_geo.now, header.mm_geo.upper,
+               pv2pages(header.mm_geo.shrink_pv),
+               pv2pages(header.mm_geo.grow_pv), next_txnid);
 
-  MDBX_handle_env_pathname env_pathname;
-  STATIC_ASSERT(sizeof(dummy_env->me_flags) == sizeof(MDBX_env_flags_t));
-  int rc = MDBX_RESULT_TRUE,
-      err = handle_env_pathname(&env_pathname, pathname,
-                                (MDBX_env_flags_t *)&dummy_env->me_flags, 0);
-  if (likely(err == MDBX_SUCCESS)) {
-    mdbx_filehandle_t clk_handle = INVALID_HANDLE_VALUE,
-                      dxb_handle = INVALID_HANDLE_VALUE;
-    if (mode > MDBX_ENV_JUST_DELETE) {
-      err = osal_openfile(MDBX_OPEN_DELETE, dummy_env, env_pathname.dxb,
-                          &dxb_handle, 0);
-      err = (err == MDBX_ENOFILE) ? MDBX_SUCCESS : err;
-      if (err == MDBX_SUCCESS) {
-        err = osal_openfile(MDBX_OPEN_DELETE, dummy_env, env_pathname.lck,
-                            &clk_handle, 0);
-        err = (err == MDBX_ENOFILE) ? MDBX_SUCCESS : err;
+        ENSURE(env, header.unsafe_txnid == recent.txnid);
+        meta_set_txnid(env, &header, next_txnid);
+        err = sync_locked(env, env->me_flags | MDBX_SHRINK_ALLOWED, &header,
+                          &troika);
+        if (err) {
+          ERROR("error %d, while updating meta.geo: "
+                "from l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
+                "/s%u-g%u (txn#%" PRIaTXN "), "
+                "to l%" PRIaPGNO "-n%" PRIaPGNO "-u%" PRIaPGNO
+                "/s%u-g%u (txn#%" PRIaTXN ")",
+                err, recent.ptr_c->mm_geo.lower, recent.ptr_c->mm_geo.now,
+                recent.ptr_c->mm_geo.upper,
+                pv2pages(recent.ptr_c->mm_geo.shrink_pv),
+                pv2pages(recent.ptr_c->mm_geo.grow_pv), recent.txnid,
+                header.mm_geo.lower, header.mm_geo.now, header.mm_geo.upper,
+                pv2pages(header.mm_geo.shrink_pv),
+                pv2pages(header.mm_geo.grow_pv), header.unsafe_txnid);
+          return err;
+        }
       }
-      if (err == MDBX_SUCCESS && clk_handle != INVALID_HANDLE_VALUE)
-        err = osal_lockfile(clk_handle, mode == MDBX_ENV_WAIT_FOR_UNUSED);
-      if (err == MDBX_SUCCESS && dxb_handle != INVALID_HANDLE_VALUE)
-        err = osal_lockfile(dxb_handle, mode == MDBX_ENV_WAIT_FOR_UNUSED);
     }
 
-    if (err == MDBX_SUCCESS) {
-      err = osal_removefile(env_pathname.dxb);
-      if (err == MDBX_SUCCESS)
-        rc = MDBX_SUCCESS;
-      else if (err == MDBX_ENOFILE)
-        err = MDBX_SUCCESS;
-    }
+    atomic_store32(&env->me_lck->mti_discarded_tail,
+                   bytes2pgno(env, used_aligned2os_bytes), mo_Relaxed);
 
-    if (err == MDBX_SUCCESS) {
-      err = osal_removefile(env_pathname.lck);
-      if (err == MDBX_SUCCESS)
-        rc = MDBX_SUCCESS;
-      else if (err == MDBX_ENOFILE)
-        err = MDBX_SUCCESS;
+    if ((env->me_flags & MDBX_RDONLY) == 0 && env->me_stuck_meta < 0 &&
+        (runtime_flags & MDBX_DBG_DONT_UPGRADE) == 0) {
+      for (int n = 0; n < NUM_METAS; ++n) {
+        MDBX_meta *const meta = METAPAGE(env, n);
+        if (unlikely(unaligned_peek_u64(4, &meta->mm_magic_and_version) !=
+                     MDBX_DATA_MAGIC)) {
+          const txnid_t txnid = constmeta_txnid(meta);
+          NOTICE("%s %s"
+                 "meta[%u], txnid %" PRIaTXN,
+                 "updating db-format signature for",
+                 META_IS_STEADY(meta) ? "stead-" : "weak-", n, txnid);
+          err = override_meta(env, n, txnid, meta);
+          if (unlikely(err != MDBX_SUCCESS) &&
+              /* Just ignore the MDBX_PROBLEM error, since here it is
+               * returned only in case of the attempt to upgrade an obsolete
+               * meta-page that is invalid for current state of a DB,
+               * e.g. after shrinking DB file */
+              err != MDBX_PROBLEM) {
+            ERROR("%s meta[%u], txnid %" PRIaTXN ", error %d",
+                  "updating db-format signature for", n, txnid, err);
+            return err;
+          }
+          troika = meta_tap(env);
+        }
+      }
     }
+  } /* lck exclusive, lck_rc == MDBX_RESULT_TRUE */
 
-    if (err == MDBX_SUCCESS && !(dummy_env->me_flags & MDBX_NOSUBDIR)) {
-      err = osal_removedirectory(pathname);
-      if (err == MDBX_SUCCESS)
-        rc = MDBX_SUCCESS;
-      else if (err == MDBX_ENOFILE)
-        err = MDBX_SUCCESS;
+  //---------------------------------------------------- setup madvise/readahead
+#if MDBX_ENABLE_MADVISE
+  if (used_aligned2os_bytes < env->me_dxb_mmap.current) {
+#if defined(MADV_REMOVE)
+    if (lck_rc && (env->me_flags & MDBX_WRITEMAP) != 0 &&
+        /* not recovery mode */ env->me_stuck_meta < 0) {
+      NOTICE("open-MADV_%s %u..%u", "REMOVE (deallocate file space)",
+             env->me_lck->mti_discarded_tail.weak,
+             bytes2pgno(env, env->me_dxb_mmap.current));
+      err =
+          madvise(ptr_disp(env->me_map, used_aligned2os_bytes),
+                  env->me_dxb_mmap.current - used_aligned2os_bytes, MADV_REMOVE)
+              ? ignore_enosys(errno)
+              : MDBX_SUCCESS;
+      if (unlikely(MDBX_IS_ERROR(err)))
+        return err;
     }
+#endif /* MADV_REMOVE */
+#if defined(MADV_DONTNEED)
+    NOTICE("open-MADV_%s %u..%u", "DONTNEED",
+           env->me_lck->mti_discarded_tail.weak,
+           bytes2pgno(env, env->me_dxb_mmap.current));
+    err =
+        madvise(ptr_disp(env->me_map, used_aligned2os_bytes),
+                env->me_dxb_mmap.current - used_aligned2os_bytes, MADV_DONTNEED)
+            ? ignore_enosys(errno)
+            : MDBX_SUCCESS;
+    if (unlikely(MDBX_IS_ERROR(err)))
+      return err;
+#elif defined(POSIX_MADV_DONTNEED)
+    err = ignore_enosys(posix_madvise(
+        ptr_disp(env->me_map, used_aligned2os_bytes),
+        env->me_dxb_mmap.current - used_aligned2os_bytes, POSIX_MADV_DONTNEED));
+    if (unlikely(MDBX_IS_ERROR(err)))
+      return err;
+#elif defined(POSIX_FADV_DONTNEED)
+    err = ignore_enosys(posix_fadvise(
+        env->me_lazy_fd, used_aligned2os_bytes,
+        env->me_dxb_mmap.current - used_aligned2os_bytes, POSIX_FADV_DONTNEED));
+    if (unlikely(MDBX_IS_ERROR(err)))
+      return err;
+#endif /* MADV_DONTNEED */
+  }
 
-    if (dxb_handle != INVALID_HANDLE_VALUE)
-      osal_closefile(dxb_handle);
-    if (clk_handle != INVALID_HANDLE_VALUE)
-      osal_closefile(clk_handle);
-  } else if (err == MDBX_ENOFILE)
-    err = MDBX_SUCCESS;
-
-  osal_free(env_pathname.buffer_for_free);
-  return (err == MDBX_SUCCESS) ? rc : err;
-}
+  err = set_readahead(env, bytes2pgno(env, used_bytes), readahead, true);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
+#endif /* MDBX_ENABLE_MADVISE */
 
-__cold int mdbx_env_open(MDBX_env *env, const char *pathname,
-                         MDBX_env_flags_t flags, mdbx_mode_t mode) {
-#if defined(_WIN32) || defined(_WIN64)
-  wchar_t *pathnameW = nullptr;
-  int rc = osal_mb2w(pathname, &pathnameW);
-  if (likely(rc == MDBX_SUCCESS)) {
-    rc = mdbx_env_openW(env, pathnameW, flags, mode);
-    osal_free(pathnameW);
-    if (rc == MDBX_SUCCESS)
-      /* force to make cache of the multi-byte pathname representation */
-      mdbx_env_get_path(env, &pathname);
-  }
   return rc;
 }
 
-__cold int mdbx_env_openW(MDBX_env *env, const wchar_t *pathname,
-                          MDBX_env_flags_t flags, mdbx_mode_t mode) {
-#endif /* Windows */
+/******************************************************************************/
 
-  int rc = check_env(env, false);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+/* Open and/or initialize the lock region for the environment. */
+__cold static int setup_lck(MDBX_env *env, pathchar_t *lck_pathname,
+                            mdbx_mode_t mode) {
+  eASSERT(env, env->me_lazy_fd != INVALID_HANDLE_VALUE);
+  eASSERT(env, env->me_lfd == INVALID_HANDLE_VALUE);
 
-  if (unlikely(flags & ~ENV_USABLE_FLAGS))
-    return MDBX_EINVAL;
+  int err = osal_openfile(MDBX_OPEN_LCK, env, lck_pathname, &env->me_lfd, mode);
+  if (err != MDBX_SUCCESS) {
+    switch (err) {
+    default:
+      return err;
+    case MDBX_ENOFILE:
+    case MDBX_EACCESS:
+    case MDBX_EPERM:
+      if (!F_ISSET(env->me_flags, MDBX_RDONLY | MDBX_EXCLUSIVE))
+        return err;
+      break;
+    case MDBX_EROFS:
+      if ((env->me_flags & MDBX_RDONLY) == 0)
+        return err;
+      break;
+    }
 
-  if (unlikely(env->me_lazy_fd != INVALID_HANDLE_VALUE ||
-               (env->me_flags & MDBX_ENV_ACTIVE) != 0 || env->me_map))
-    return MDBX_EPERM;
+    if (err != MDBX_ENOFILE) {
+      /* ENSURE the file system is read-only */
+      err = osal_check_fs_rdonly(env->me_lazy_fd, lck_pathname, err);
+      if (err != MDBX_SUCCESS &&
+          /* ignore ERROR_NOT_SUPPORTED for exclusive mode */
+          !(err == MDBX_ENOSYS && (env->me_flags & MDBX_EXCLUSIVE)))
+        return err;
+    }
 
-  /* Pickup previously mdbx_env_set_flags(),
-   * but avoid MDBX_UTTERLY_NOSYNC by disjunction */
-  const uint32_t saved_me_flags = env->me_flags;
-  flags = merge_sync_flags(flags | MDBX_DEPRECATED_COALESCE, env->me_flags);
+    /* LY: without-lck mode (e.g. exclusive or on read-only filesystem) */
+    /* beginning of a locked section ---------------------------------------- */
+    lcklist_lock();
+    eASSERT(env, env->me_lcklist_next == nullptr);
+    env->me_lfd = INVALID_HANDLE_VALUE;
+    const int rc = osal_lck_seize(env);
+    if (MDBX_IS_ERROR(rc)) {
+      /* Calling lcklist_detach_locked() is required to restore POSIX-filelock
+       * and this job will be done by env_close(). */
+      lcklist_unlock();
+      return rc;
+    }
+    /* insert into inprocess lck-list */
+    env->me_lcklist_next = inprocess_lcklist_head;
+    inprocess_lcklist_head = env;
+    lcklist_unlock();
+    /* end of a locked section ---------------------------------------------- */
 
-  if (flags & MDBX_RDONLY) {
-    /* Silently ignore irrelevant flags when we're only getting read access */
-    flags &= ~(MDBX_WRITEMAP | MDBX_DEPRECATED_MAPASYNC | MDBX_SAFE_NOSYNC |
-               MDBX_NOMETASYNC | MDBX_DEPRECATED_COALESCE | MDBX_LIFORECLAIM |
-               MDBX_NOMEMINIT | MDBX_ACCEDE);
-    mode = 0;
-  } else {
-#if MDBX_MMAP_INCOHERENT_FILE_WRITE
-    /* Temporary `workaround` for OpenBSD kernel's flaw.
-     * See https://libmdbx.dqdkfa.ru/dead-github/issues/67 */
-    if ((flags & MDBX_WRITEMAP) == 0) {
-      if (flags & MDBX_ACCEDE)
-        flags |= MDBX_WRITEMAP;
-      else {
-        debug_log(MDBX_LOG_ERROR, __func__, __LINE__,
-                  "System (i.e. OpenBSD) requires MDBX_WRITEMAP because "
-                  "of an internal flaw(s) in a file/buffer/page cache.\n");
-        return 42 /* ENOPROTOOPT */;
-      }
-    }
-#endif /* MDBX_MMAP_INCOHERENT_FILE_WRITE */
+    env->me_lck = lckless_stub(env);
+    env->me_maxreaders = UINT_MAX;
+    DEBUG("lck-setup:%s%s%s", " lck-less",
+          (env->me_flags & MDBX_RDONLY) ? " readonly" : "",
+          (rc == MDBX_RESULT_TRUE) ? " exclusive" : " cooperative");
+    return rc;
   }
 
-  MDBX_handle_env_pathname env_pathname;
-  rc = handle_env_pathname(&env_pathname, pathname, &flags, mode);
-  if (unlikely(rc != MDBX_SUCCESS))
-    goto bailout;
+  /* beginning of a locked section ------------------------------------------ */
+  lcklist_lock();
+  eASSERT(env, env->me_lcklist_next == nullptr);
 
-  env->me_flags = (flags & ~MDBX_FATAL_ERROR) | MDBX_ENV_ACTIVE;
-  env->me_pathname = osal_calloc(env_pathname.ent_len + 1, sizeof(pathchar_t));
-  env->me_dbxs = osal_calloc(env->me_maxdbs, sizeof(MDBX_dbx));
-  env->me_dbflags = osal_calloc(env->me_maxdbs, sizeof(env->me_dbflags[0]));
-  env->me_dbiseqs = osal_calloc(env->me_maxdbs, sizeof(env->me_dbiseqs[0]));
-  if (!(env->me_dbxs && env->me_pathname && env->me_dbflags &&
-        env->me_dbiseqs)) {
-    rc = MDBX_ENOMEM;
-    goto bailout;
+  /* Try to get exclusive lock. If we succeed, then
+   * nobody is using the lock region and we should initialize it. */
+  err = osal_lck_seize(env);
+  if (MDBX_IS_ERROR(err)) {
+  bailout:
+    /* Calling lcklist_detach_locked() is required to restore POSIX-filelock
+     * and this job will be done by env_close(). */
+    lcklist_unlock();
+    return err;
   }
-  memcpy(env->me_pathname, env_pathname.dxb,
-         env_pathname.ent_len * sizeof(pathchar_t));
-  env->me_dbxs[FREE_DBI].md_cmp = cmp_int_align4; /* aligned MDBX_INTEGERKEY */
-  env->me_dbxs[FREE_DBI].md_dcmp = cmp_lenfast;
-  env->me_dbxs[FREE_DBI].md_klen_max = env->me_dbxs[FREE_DBI].md_klen_min = 8;
-  env->me_dbxs[FREE_DBI].md_vlen_min = 4;
-  env->me_dbxs[FREE_DBI].md_vlen_max =
-      mdbx_env_get_maxvalsize_ex(env, MDBX_INTEGERKEY);
-
-  /* Использование O_DSYNC или FILE_FLAG_WRITE_THROUGH:
-   *
-   *   0) Если размер страниц БД меньше системной страницы ОЗУ, то ядру ОС
-   *      придется чаще обновлять страницы в unified page cache.
-   *
-   *      Однако, O_DSYNC не предполагает отключение unified page cache,
-   *      поэтому подобные затруднения будем считать проблемой ОС и/или
-   *      ожидаемым пенальти из-за использования мелких страниц БД.
-   *
-   *   1) В режиме MDBX_SYNC_DURABLE - O_DSYNC для записи как данных,
-   *      так и мета-страниц. Однако, на Linux отказ от O_DSYNC с последующим
-   *      fdatasync() может быть выгоднее при использовании HDD, так как
-   *      позволяет io-scheduler переупорядочить запись с учетом актуального
-   *      расположения файла БД на носителе.
-   *
-   *   2) В режиме MDBX_NOMETASYNC - O_DSYNC можно использовать для данных,
-   *      но в этом может не быть смысла, так как fdatasync() всё равно
-   *      требуется для гарантии фиксации мета после предыдущей транзакции.
-   *
-   *      В итоге на нормальных системах (не Windows) есть два варианта:
-   *       - при возможности O_DIRECT и/или io_ring для данных, скорее всего,
-   *         есть смысл вызвать fdatasync() перед записью данных, а затем
-   *         использовать O_DSYNC;
-   *       - не использовать O_DSYNC и вызывать fdatasync() после записи данных.
-   *
-   *      На Windows же следует минимизировать использование FlushFileBuffers()
-   *      из-за проблем с производительностью. Поэтому на Windows в режиме
-   *      MDBX_NOMETASYNC:
-   *       - мета обновляется через дескриптор без FILE_FLAG_WRITE_THROUGH;
-   *       - перед началом записи данных вызывается FlushFileBuffers(), если
-   *         mti_meta_sync_txnid не совпадает с последней записанной мета;
-   *       - данные записываются через дескриптор с FILE_FLAG_WRITE_THROUGH.
-   *
-   *   3) В режиме MDBX_SAFE_NOSYNC - O_DSYNC нет смысла использовать, пока не
-   *      будет реализована возможность полностью асинхронной "догоняющей"
-   *      записи в выделенном процессе-сервере с io-ring очередями внутри.
-   *
-   * -----
-   *
-   * Использование O_DIRECT или FILE_FLAG_NO_BUFFERING:
-   *
-   *   Назначение этих флагов в отключении файлового дескриптора от
-   *   unified page cache, т.е. от отображенных в память данных в случае
-   *   libmdbx.
-   *
-   *   Поэтому, использование direct i/o в libmdbx без MDBX_WRITEMAP лишено
-   *   смысла и контр-продуктивно, ибо так мы провоцируем ядро ОС на
-   *   не-когерентность отображения в память с содержимым файла на носителе,
-   *   либо требуем дополнительных проверок и действий направленных на
-   *   фактическое отключение O_DIRECT для отображенных в память данных.
-   *
-   *   В режиме MDBX_WRITEMAP когерентность отображенных данных обеспечивается
-   *   физически. Поэтому использование direct i/o может иметь смысл, если у
-   *   ядра ОС есть какие-то проблемы с msync(), в том числе с
-   *   производительностью:
-   *    - использование io_ring или gather-write может быть дешевле, чем
-   *      просмотр PTE ядром и запись измененных/грязных;
-   *    - но проблема в том, что записываемые из user mode страницы либо не
-   *      будут помечены чистыми (и соответственно будут записаны ядром
-   *      еще раз), либо ядру необходимо искать и чистить PTE при получении
-   *      запроса на запись.
-   *
-   *   Поэтому O_DIRECT или FILE_FLAG_NO_BUFFERING используется:
-   *    - только в режиме MDBX_SYNC_DURABLE с MDBX_WRITEMAP;
-   *    - когда me_psize >= me_os_psize;
-   *    - опция сборки MDBX_AVOID_MSYNC != 0, которая по-умолчанию включена
-   *      только на Windows (см ниже).
-   *
-   * -----
-   *
-   * Использование FILE_FLAG_OVERLAPPED на Windows:
-   *
-   * У Windows очень плохо с I/O (за исключением прямых постраничных
-   * scatter/gather, которые работают в обход проблемного unified page
-   * cache и поэтому почти бесполезны в libmdbx).
-   *
-   * При этом всё еще хуже при использовании FlushFileBuffers(), что также
-   * требуется после FlushViewOfFile() в режиме MDBX_WRITEMAP. Поэтому
-   * на Windows вместо FlushViewOfFile() и FlushFileBuffers() следует
-   * использовать запись через дескриптор с FILE_FLAG_WRITE_THROUGH.
-   *
-   * В свою очередь, запись с FILE_FLAG_WRITE_THROUGH дешевле/быстрее
-   * при использовании FILE_FLAG_OVERLAPPED. В результате, на Windows
-   * в durable-режимах запись данных всегда в overlapped-режиме,
-   * при этом для записи мета требуется отдельный не-overlapped дескриптор.
-   */
-
-  rc = osal_openfile((flags & MDBX_RDONLY) ? MDBX_OPEN_DXB_READ
-                                           : MDBX_OPEN_DXB_LAZY,
-                     env, env_pathname.dxb, &env->me_lazy_fd, mode);
-  if (rc != MDBX_SUCCESS)
-    goto bailout;
 
-#if MDBX_LOCKING == MDBX_LOCKING_SYSV
-  env->me_sysv_ipc.key = ftok(env_pathname.dxb, 42);
-  if (env->me_sysv_ipc.key == -1) {
-    rc = errno;
-    goto bailout;
+  MDBX_env *inprocess_neighbor = nullptr;
+  if (err == MDBX_RESULT_TRUE) {
+    err = uniq_check(&env->me_lck_mmap, &inprocess_neighbor);
+    if (MDBX_IS_ERROR(err))
+      goto bailout;
+    if (inprocess_neighbor &&
+        ((runtime_flags & MDBX_DBG_LEGACY_MULTIOPEN) == 0 ||
+         (inprocess_neighbor->me_flags & MDBX_EXCLUSIVE) != 0)) {
+      err = MDBX_BUSY;
+      goto bailout;
+    }
   }
-#endif /* MDBX_LOCKING */
+  const int lck_seize_rc = err;
 
-  /* Set the position in files outside of the data to avoid corruption
-   * due to erroneous use of file descriptors in the application code. */
-  const uint64_t safe_parking_lot_offset = UINT64_C(0x7fffFFFF80000000);
-  osal_fseek(env->me_lazy_fd, safe_parking_lot_offset);
+  DEBUG("lck-setup:%s%s%s", " with-lck",
+        (env->me_flags & MDBX_RDONLY) ? " readonly" : "",
+        (lck_seize_rc == MDBX_RESULT_TRUE) ? " exclusive" : " cooperative");
 
-  env->me_fd4meta = env->me_lazy_fd;
-#if defined(_WIN32) || defined(_WIN64)
-  eASSERT(env, env->me_overlapped_fd == 0);
-  bool ior_direct = false;
-  if (!(flags &
-        (MDBX_RDONLY | MDBX_SAFE_NOSYNC | MDBX_NOMETASYNC | MDBX_EXCLUSIVE))) {
-    if (MDBX_AVOID_MSYNC && (flags & MDBX_WRITEMAP)) {
-      /* Запрошен режим MDBX_SAFE_NOSYNC | MDBX_WRITEMAP при активной опции
-       * MDBX_AVOID_MSYNC.
-       *
-       * 1) В этой комбинации наиболее выгодно использовать WriteFileGather(),
-       * но для этого необходимо открыть файл с флагом FILE_FLAG_NO_BUFFERING и
-       * после обеспечивать выравнивание адресов и размера данных на границу
-       * системной страницы, что в свою очередь возможно если размер страницы БД
-       * не меньше размера системной страницы ОЗУ. Поэтому для открытия файла в
-       * нужном режиме требуется знать размер страницы БД.
-       *
-       * 2) Кроме этого, в Windows запись в заблокированный регион файла
-       * возможно только через тот-же дескриптор. Поэтому изначальный захват
-       * блокировок посредством osal_lck_seize(), захват/освобождение блокировок
-       * во время пишущих транзакций и запись данных должны выполнятся через
-       * один дескриптор.
-       *
-       * Таким образом, требуется прочитать волатильный заголовок БД, чтобы
-       * узнать размер страницы, чтобы открыть дескриптор файла в режиме нужном
-       * для записи данных, чтобы использовать именно этот дескриптор для
-       * изначального захвата блокировок. */
-      MDBX_meta header;
-      uint64_t dxb_filesize;
-      int err = read_header(env, &header, MDBX_SUCCESS, true);
-      if ((err == MDBX_SUCCESS && header.mm_psize >= env->me_os_psize) ||
-          (err == MDBX_ENODATA && mode && env->me_psize >= env->me_os_psize &&
-           osal_filesize(env->me_lazy_fd, &dxb_filesize) == MDBX_SUCCESS &&
-           dxb_filesize == 0))
-        /* Может быть коллизия, если два процесса пытаются одновременно создать
-         * БД с разным размером страницы, который у одного меньше системной
-         * страницы, а у другого НЕ меньше. Эта допустимая, но очень странная
-         * ситуация. Поэтому считаем её ошибочной и не пытаемся разрешить. */
-        ior_direct = true;
-    }
+  uint64_t size = 0;
+  err = osal_filesize(env->me_lfd, &size);
+  if (unlikely(err != MDBX_SUCCESS))
+    goto bailout;
 
-    rc = osal_openfile(ior_direct ? MDBX_OPEN_DXB_OVERLAPPED_DIRECT
-                                  : MDBX_OPEN_DXB_OVERLAPPED,
-                       env, env_pathname.dxb, &env->me_overlapped_fd, 0);
-    if (rc != MDBX_SUCCESS)
-      goto bailout;
-    env->me_data_lock_event = CreateEventW(nullptr, true, false, nullptr);
-    if (!env->me_data_lock_event) {
-      rc = (int)GetLastError();
+  /* The reader table consists of whole shards, the slots of which are
+   * followed by descriptors of the shards. */
+  const size_t shard_bytes =
+      MDBX_READERS_SHARD * sizeof(MDBX_reader) + sizeof(MDBX_rshard);
+  if (lck_seize_rc == MDBX_RESULT_TRUE) {
+    size = ceil_powerof2(
+        (env->me_maxreaders + MDBX_READERS_SHARD - 1) / MDBX_READERS_SHARD *
+                shard_bytes +
+            sizeof(MDBX_lockinfo),
+        env->me_os_psize);
+    jitter4testing(false);
+  } else {
+    if (env->me_flags & MDBX_EXCLUSIVE) {
+      err = MDBX_BUSY;
       goto bailout;
     }
-    osal_fseek(env->me_overlapped_fd, safe_parking_lot_offset);
-  }
-#else
-  if (mode == 0) {
-    /* pickup mode for lck-file */
-    struct stat st;
-    if (fstat(env->me_lazy_fd, &st)) {
-      rc = errno;
+    if (size > INT_MAX || (size & (env->me_os_psize - 1)) != 0 ||
+        size < env->me_os_psize) {
+      ERROR("lck-file has invalid size %" PRIu64 " bytes", size);
+      err = MDBX_PROBLEM;
       goto bailout;
     }
-    mode = st.st_mode;
   }
-  mode = (/* inherit read permissions for group and others */ mode &
-          (S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) |
-         /* always add read/write for owner */ S_IRUSR | S_IWUSR |
-         ((mode & S_IRGRP) ? /* +write if readable by group */ S_IWGRP : 0) |
-         ((mode & S_IROTH) ? /* +write if readable by others */ S_IWOTH : 0);
-#endif /* !Windows */
-  const int lck_rc = setup_lck(env, env_pathname.lck, mode);
-  if (MDBX_IS_ERROR(lck_rc)) {
-    rc = lck_rc;
+
+  const size_t nshards =
+      ((size_t)size - sizeof(MDBX_lockinfo)) / shard_bytes;
+  const size_t maxreaders = nshards * MDBX_READERS_SHARD;
+  if (maxreaders < 4) {
+    ERROR("lck-size too small (up to %" PRIuPTR " readers)", maxreaders);
+    err = MDBX_PROBLEM;
     goto bailout;
   }
-  osal_fseek(env->me_lfd, safe_parking_lot_offset);
+  env->me_maxreaders = (maxreaders <= MDBX_READERS_LIMIT)
+                           ? (unsigned)maxreaders
+                           : (unsigned)MDBX_READERS_LIMIT;
 
-  eASSERT(env, env->me_dsync_fd == INVALID_HANDLE_VALUE);
-  if (!(flags & (MDBX_RDONLY | MDBX_SAFE_NOSYNC | MDBX_DEPRECATED_MAPASYNC
-#if defined(_WIN32) || defined(_WIN64)
-                 | MDBX_EXCLUSIVE
-#endif /* !Windows */
-                 ))) {
-    rc = osal_openfile(MDBX_OPEN_DXB_DSYNC, env, env_pathname.dxb,
-                       &env->me_dsync_fd, 0);
-    if (MDBX_IS_ERROR(rc))
-      goto bailout;
-    if (env->me_dsync_fd != INVALID_HANDLE_VALUE) {
-      if ((flags & MDBX_NOMETASYNC) == 0)
-        env->me_fd4meta = env->me_dsync_fd;
-      osal_fseek(env->me_dsync_fd, safe_parking_lot_offset);
-    }
-  }
+  err = osal_mmap((env->me_flags & MDBX_EXCLUSIVE) | MDBX_WRITEMAP,
+                  &env->me_lck_mmap, (size_t)size, (size_t)size,
+                  lck_seize_rc ? MMAP_OPTION_TRUNCATE | MMAP_OPTION_SEMAPHORE
+                               : MMAP_OPTION_SEMAPHORE);
+  if (unlikely(err != MDBX_SUCCESS))
+    goto bailout;
 
-  const MDBX_env_flags_t lazy_flags =
-      MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC | MDBX_NOMETASYNC;
-  const MDBX_env_flags_t mode_flags = lazy_flags | MDBX_LIFORECLAIM |
-                                      MDBX_NORDAHEAD | MDBX_RDONLY |
-                                      MDBX_WRITEMAP;
+#if MDBX_ENABLE_MADVISE
+#ifdef MADV_DODUMP
+  err = madvise(env->me_lck_mmap.lck, size, MADV_DODUMP) ? ignore_enosys(errno)
+                                                         : MDBX_SUCCESS;
+  if (unlikely(MDBX_IS_ERROR(err)))
+    goto bailout;
+#endif /* MADV_DODUMP */
 
-  MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
-  if (lck && lck_rc != MDBX_RESULT_TRUE && (env->me_flags & MDBX_RDONLY) == 0) {
-    MDBX_env_flags_t snap_flags;
-    while ((snap_flags = atomic_load32(&lck->mti_envmode, mo_AcquireRelease)) ==
-           MDBX_RDONLY) {
-      if (atomic_cas32(&lck->mti_envmode, MDBX_RDONLY,
-                       (snap_flags = (env->me_flags & mode_flags)))) {
-        /* The case:
-         *  - let's assume that for some reason the DB file is smaller
-         *    than it should be according to the geometry,
-         *    but not smaller than the last page used;
-         *  - the first process that opens the database (lck_rc == RESULT_TRUE)
-         *    does this in readonly mode and therefore cannot bring
-         *    the file size back to normal;
-         *  - some next process (lck_rc != RESULT_TRUE) opens the DB in
-         *    read-write mode and now is here.
-         *
-         * FIXME: Should we re-check and set the size of DB-file right here? */
-        break;
-      }
-      atomic_yield();
-    }
+#ifdef MADV_WILLNEED
+  err = madvise(env->me_lck_mmap.lck, size, MADV_WILLNEED)
+            ? ignore_enosys(errno)
+            : MDBX_SUCCESS;
+  if (unlikely(MDBX_IS_ERROR(err)))
+    goto bailout;
+#elif defined(POSIX_MADV_WILLNEED)
+  err = ignore_enosys(
+      posix_madvise(env->me_lck_mmap.lck, size, POSIX_MADV_WILLNEED));
+  if (unlikely(MDBX_IS_ERROR(err)))
+    goto bailout;
+#endif /* MADV_WILLNEED */
+#endif /* MDBX_ENABLE_MADVISE */
 
-    if (env->me_flags & MDBX_ACCEDE) {
-      /* Pickup current mode-flags (MDBX_LIFORECLAIM, MDBX_NORDAHEAD, etc). */
-      const MDBX_env_flags_t diff =
-          (snap_flags ^ env->me_flags) &
-          ((snap_flags & lazy_flags) ? mode_flags
-                                     : mode_flags & ~MDBX_WRITEMAP);
-      env->me_flags ^= diff;
-      NOTICE("accede mode-flags: 0x%X, 0x%X -> 0x%X", diff,
-             env->me_flags ^ diff, env->me_flags);
+  struct MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
+  env->me_rshards =
+      (MDBX_rshard *)&lck->mti_readers[nshards * MDBX_READERS_SHARD];
+  if (lck_seize_rc == MDBX_RESULT_TRUE) {
+    /* LY: exclusive mode, check and reset lck content */
+    memset(lck, 0, (size_t)size);
+    jitter4testing(false);
+    lck->mti_magic_and_version = MDBX_LOCK_MAGIC;
+    lck->mti_os_and_format = MDBX_LOCK_FORMAT;
+#if MDBX_ENABLE_PGOP_STAT
+    lck->mti_pgop_stat.wops.weak = 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+    err = osal_msync(&env->me_lck_mmap, 0, (size_t)size,
+                     MDBX_SYNC_DATA | MDBX_SYNC_SIZE);
+    if (unlikely(err != MDBX_SUCCESS)) {
+      ERROR("initial-%s for lck-file failed, err %d", "msync/fsync", err);
+      goto bailout;
     }
-
-    /* Ранее упущенный не очевидный момент: При работе БД в режимах
-     * не-синхронной/отложенной фиксации на диске, все процессы-писатели должны
-     * иметь одинаковый режим MDBX_WRITEMAP.
-     *
-     * В противном случае, сброс на диск следует выполнять дважды: сначала
-     * msync(), затем fdatasync(). При этом msync() не обязан отрабатывать
-     * в процессах без MDBX_WRITEMAP, так как файл в память отображен только
-     * для чтения. Поэтому, в общем случае, различия по MDBX_WRITEMAP не
-     * позволяют выполнить фиксацию данных на диск, после их изменения в другом
-     * процессе.
-     *
-     * В режиме MDBX_UTTERLY_NOSYNC позволять совместную работу с MDBX_WRITEMAP
-     * также не следует, поскольку никакой процесс (в том числе последний) не
-     * может гарантированно сбросить данные на диск, а следовательно не должен
-     * помечать какую-либо транзакцию как steady.
-     *
-     * В результате, требуется либо запретить совместную работу процессам с
-     * разным MDBX_WRITEMAP в режиме отложенной записи, либо отслеживать такое
-     * смешивание и блокировать steady-пометки - что контрпродуктивно. */
-    const MDBX_env_flags_t rigorous_flags =
-        (snap_flags & lazy_flags)
-            ? MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC | MDBX_WRITEMAP
-            : MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC;
-    const MDBX_env_flags_t rigorous_diff =
-        (snap_flags ^ env->me_flags) & rigorous_flags;
-    if (rigorous_diff) {
-      ERROR("current mode/flags 0x%X incompatible with requested 0x%X, "
-            "rigorous diff 0x%X",
-            env->me_flags, snap_flags, rigorous_diff);
-      rc = MDBX_INCOMPATIBLE;
+  } else {
+    if (lck->mti_magic_and_version != MDBX_LOCK_MAGIC) {
+      const bool invalid = (lck->mti_magic_and_version >> 8) != MDBX_MAGIC;
+      ERROR("lock region has %s",
+            invalid
+                ? "invalid magic"
+                : "incompatible version (only applications with nearly or the "
+                  "same versions of libmdbx can share the same database)");
+      err = invalid ? MDBX_INVALID : MDBX_VERSION_MISMATCH;
+      goto bailout;
+    }
+    if (lck->mti_os_and_format != MDBX_LOCK_FORMAT) {
+      ERROR("lock region has os/format signature 0x%" PRIx32
+            ", expected 0x%" PRIx32,
+            lck->mti_os_and_format, MDBX_LOCK_FORMAT);
+      err = MDBX_VERSION_MISMATCH;
       goto bailout;
     }
   }
 
-  mincore_clean_cache(env);
-  const int dxb_rc = setup_dxb(env, lck_rc, mode);
-  if (MDBX_IS_ERROR(dxb_rc)) {
-    rc = dxb_rc;
-    goto bailout;
-  }
-
-  rc = osal_check_fs_incore(env->me_lazy_fd);
-  env->me_incore = false;
-  if (rc == MDBX_RESULT_TRUE) {
-    env->me_incore = true;
-    NOTICE("%s", "in-core database");
-  } else if (unlikely(rc != MDBX_SUCCESS)) {
-    ERROR("check_fs_incore(), err %d", rc);
+  err = osal_lck_init(env, inprocess_neighbor, lck_seize_rc);
+  if (MDBX_IS_ERROR(err))
     goto bailout;
-  }
 
-  if (unlikely(/* recovery mode */ env->me_stuck_meta >= 0) &&
-      (lck_rc != /* exclusive */ MDBX_RESULT_TRUE ||
-       (flags & MDBX_EXCLUSIVE) == 0)) {
-    ERROR("%s", "recovery requires exclusive mode");
-    rc = MDBX_BUSY;
-    goto bailout;
-  }
+  ENSURE(env, env->me_lcklist_next == nullptr);
+  /* insert into inprocess lck-list */
+  env->me_lcklist_next = inprocess_lcklist_head;
+  inprocess_lcklist_head = env;
+  lcklist_unlock();
+  /* end of a locked section ------------------------------------------------ */
 
-  DEBUG("opened dbenv %p", (void *)env);
-  if (!lck || lck_rc == MDBX_RESULT_TRUE) {
-    env->me_lck->mti_envmode.weak = env->me_flags & mode_flags;
-    env->me_lck->mti_meta_sync_txnid.weak =
-        (uint32_t)recent_committed_txnid(env);
-    env->me_lck->mti_reader_check_timestamp.weak = osal_monotime();
-  }
-  if (lck) {
-    if (lck_rc == MDBX_RESULT_TRUE) {
-      rc = osal_lck_downgrade(env);
-      DEBUG("lck-downgrade-%s: rc %i",
-            (env->me_flags & MDBX_EXCLUSIVE) ? "partial" : "full", rc);
-      if (rc != MDBX_SUCCESS)
-        goto bailout;
-    } else {
-      rc = cleanup_dead_readers(env, false, NULL);
-      if (MDBX_IS_ERROR(rc))
-        goto bailout;
-    }
+  eASSERT(env, !MDBX_IS_ERROR(lck_seize_rc));
+  env->me_lck = lck;
+  return lck_seize_rc;
+}
 
-    if ((env->me_flags & MDBX_NOTLS) == 0) {
-      rc = rthc_alloc(&env->me_txkey, &lck->mti_readers[0],
-                      &lck->mti_readers[env->me_maxreaders]);
-      if (unlikely(rc != MDBX_SUCCESS))
-        goto bailout;
-      env->me_flags |= MDBX_ENV_TXKEY;
-    }
-  }
+__cold int mdbx_is_readahead_reasonable(size_t volume, intptr_t redundancy) {
+  if (volume <= 1024 * 1024 * 4ul)
+    return MDBX_RESULT_TRUE;
 
-  if ((flags & MDBX_RDONLY) == 0) {
-    const size_t tsize = sizeof(MDBX_txn) + sizeof(MDBX_cursor),
-                 size = tsize + env->me_maxdbs *
-                                    (sizeof(MDBX_db) + sizeof(MDBX_cursor *) +
-                                     sizeof(MDBX_atomic_uint32_t) + 1);
-    rc = alloc_page_buf(env);
-    if (rc == MDBX_SUCCESS) {
-      memset(env->me_pbuf, -1, env->me_psize * (size_t)2);
-      memset(ptr_disp(env->me_pbuf, env->me_psize * (size_t)2), 0,
-             env->me_psize);
-      MDBX_txn *txn = osal_calloc(1, size);
-      if (txn) {
-        txn->mt_dbs = ptr_disp(txn, tsize);
-        txn->mt_cursors =
-            ptr_disp(txn->mt_dbs, sizeof(MDBX_db) * env->me_maxdbs);
-        txn->mt_dbiseqs =
-            ptr_disp(txn->mt_cursors, sizeof(MDBX_cursor *) * env->me_maxdbs);
-        txn->mt_dbistate = ptr_disp(
-            txn->mt_dbiseqs, sizeof(MDBX_atomic_uint32_t) * env->me_maxdbs);
-        txn->mt_env = env;
-        txn->mt_dbxs = env->me_dbxs;
-        txn->mt_flags = MDBX_TXN_FINISHED;
-        env->me_txn0 = txn;
-        txn->tw.retired_pages = pnl_alloc(MDBX_PNL_INITIAL);
-        txn->tw.relist = pnl_alloc(MDBX_PNL_INITIAL);
-        if (unlikely(!txn->tw.retired_pages || !txn->tw.relist))
-          rc = MDBX_ENOMEM;
-      } else
-        rc = MDBX_ENOMEM;
-    }
-    if (rc == MDBX_SUCCESS)
-      rc = osal_ioring_create(&env->me_ioring
-#if defined(_WIN32) || defined(_WIN64)
-                              ,
-                              ior_direct, env->me_overlapped_fd
-#endif /* Windows */
-      );
-    if (rc == MDBX_SUCCESS)
-      adjust_defaults(env);
-  }
+  intptr_t pagesize, total_ram_pages;
+  int err = mdbx_get_sysraminfo(&pagesize, &total_ram_pages, nullptr);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
 
-#if MDBX_DEBUG
-  if (rc == MDBX_SUCCESS) {
-    const meta_troika_t troika = meta_tap(env);
-    const meta_ptr_t head = meta_recent(env, &troika);
-    const MDBX_db *db = &head.ptr_c->mm_dbs[MAIN_DBI];
+  const int log2page = log2n_powerof2(pagesize);
+  const intptr_t volume_pages = (volume + pagesize - 1) >> log2page;
+  const intptr_t redundancy_pages =
+      (redundancy < 0) ? -(intptr_t)((-redundancy + pagesize - 1) >> log2page)
+                       : (intptr_t)(redundancy + pagesize - 1) >> log2page;
+  if (volume_pages >= total_ram_pages ||
+      volume_pages + redundancy_pages >= total_ram_pages)
+    return MDBX_RESULT_FALSE;
 
-    DEBUG("opened database version %u, pagesize %u",
-          (uint8_t)unaligned_peek_u64(4, head.ptr_c->mm_magic_and_version),
-          env->me_psize);
-    DEBUG("using meta page %" PRIaPGNO ", txn %" PRIaTXN,
-          data_page(head.ptr_c)->mp_pgno, head.txnid);
-    DEBUG("depth: %u", db->md_depth);
-    DEBUG("entries: %" PRIu64, db->md_entries);
-    DEBUG("branch pages: %" PRIaPGNO, db->md_branch_pages);
-    DEBUG("leaf pages: %" PRIaPGNO, db->md_leaf_pages);
-    DEBUG("large/overflow pages: %" PRIaPGNO, db->md_overflow_pages);
-    DEBUG("root: %" PRIaPGNO, db->md_root);
-    DEBUG("schema_altered: %" PRIaTXN, db->md_mod_txnid);
-  }
-#endif
+  intptr_t avail_ram_pages;
+  err = mdbx_get_sysraminfo(nullptr, nullptr, &avail_ram_pages);
+  if (unlikely(err != MDBX_SUCCESS))
+    return err;
 
-bailout:
-  if (rc != MDBX_SUCCESS) {
-    rc = env_close(env) ? MDBX_PANIC : rc;
-    env->me_flags =
-        saved_me_flags | ((rc != MDBX_PANIC) ? 0 : MDBX_FATAL_ERROR);
-  } else {
-#if defined(MDBX_USE_VALGRIND) || defined(__SANITIZE_ADDRESS__)
-    txn_valgrind(env, nullptr);
-#endif
-  }
-  osal_free(env_pathname.buffer_for_free);
-  return rc;
+  return (volume_pages + redundancy_pages >= avail_ram_pages)
+             ? MDBX_RESULT_FALSE
+             : MDBX_RESULT_TRUE;
 }
 
-/* Destroy resources from mdbx_env_open(), clear our readers & DBIs */
-__cold static int env_close(MDBX_env *env) {
-  const unsigned flags = env->me_flags;
-  if (!(flags & MDBX_ENV_ACTIVE)) {
-    ENSURE(env, env->me_lcklist_next == nullptr);
-    return MDBX_SUCCESS;
-  }
-
-  env->me_flags &= ~ENV_INTERNAL_FLAGS;
-  if (flags & MDBX_ENV_TXKEY) {
-    rthc_remove(env->me_txkey);
-    env->me_txkey = (osal_thread_key_t)0;
-  }
-
-  munlock_all(env);
-  if (!(env->me_flags & MDBX_RDONLY))
-    osal_ioring_destroy(&env->me_ioring);
-
-  lcklist_lock();
-  const int rc = lcklist_detach_locked(env);
-  lcklist_unlock();
+/* Merge sync flags */
+static uint32_t merge_sync_flags(const uint32_t a, const uint32_t b) {
+  uint32_t r = a | b;
 
-  env->me_lck = nullptr;
-  if (env->me_lck_mmap.lck)
-    osal_munmap(&env->me_lck_mmap);
+  /* avoid false MDBX_UTTERLY_NOSYNC */
+  if (F_ISSET(r, MDBX_UTTERLY_NOSYNC) && !F_ISSET(a, MDBX_UTTERLY_NOSYNC) &&
+      !F_ISSET(b, MDBX_UTTERLY_NOSYNC))
+    r = (r - MDBX_UTTERLY_NOSYNC) | MDBX_SAFE_NOSYNC;
 
-  if (env->me_map) {
-    osal_munmap(&env->me_dxb_mmap);
-#ifdef MDBX_USE_VALGRIND
-    VALGRIND_DISCARD(env->me_valgrind_handle);
-    env->me_valgrind_handle = -1;
-#endif
-  }
+  /* convert MDBX_DEPRECATED_MAPASYNC to MDBX_SAFE_NOSYNC */
+  if ((r & (MDBX_WRITEMAP | MDBX_DEPRECATED_MAPASYNC)) ==
+          (MDBX_WRITEMAP | MDBX_DEPRECATED_MAPASYNC) &&
+      !F_ISSET(r, MDBX_UTTERLY_NOSYNC))
+    r = (r - MDBX_DEPRECATED_MAPASYNC) | MDBX_SAFE_NOSYNC;
 
-#if defined(_WIN32) || defined(_WIN64)
-  eASSERT(env, !env->me_overlapped_fd ||
-                   env->me_overlapped_fd == INVALID_HANDLE_VALUE);
-  if (env->me_data_lock_event != INVALID_HANDLE_VALUE) {
-    CloseHandle(env->me_data_lock_event);
-    env->me_data_lock_event = INVALID_HANDLE_VALUE;
-  }
-#endif /* Windows */
+  /* force MDBX_NOMETASYNC if NOSYNC enabled */
+  if (r & (MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC))
+    r |= MDBX_NOMETASYNC;
 
-  if (env->me_dsync_fd != INVALID_HANDLE_VALUE) {
-    (void)osal_closefile(env->me_dsync_fd);
-    env->me_dsync_fd = INVALID_HANDLE_VALUE;
-  }
+  assert(!(F_ISSET(r, MDBX_UTTERLY_NOSYNC) &&
+           !F_ISSET(a, MDBX_UTTERLY_NOSYNC) &&
+           !F_ISSET(b, MDBX_UTTERLY_NOSYNC)));
+  return r;
+}
 
-  if (env->me_lazy_fd != INVALID_HANDLE_VALUE) {
-    (void)osal_closefile(env->me_lazy_fd);
-    env->me_lazy_fd = INVALID_HANDLE_VALUE;
+__cold static int __must_check_result override_meta(MDBX_env *env,
+                                                    size_t target,
+                                                    txnid_t txnid,
+                                                    const MDBX_meta *shape) {
+  int rc = alloc_page_buf(env);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  MDBX_page *const page = env->me_pbuf;
+  meta_model(env, page, target);
+  MDBX_meta *const model = page_meta(page);
+  meta_set_txnid(env, model, txnid);
+  if (txnid)
+    eASSERT(env, coherency_check_meta(env, model, true));
+  if (shape) {
+    if (txnid && unlikely(!coherency_check_meta(env, shape, false))) {
+      ERROR("bailout overriding meta-%zu since model failed "
+            "freedb/maindb %s-check for txnid #%" PRIaTXN,
+            target, "pre", constmeta_txnid(shape));
+      return MDBX_PROBLEM;
+    }
+    if (runtime_flags & MDBX_DBG_DONT_UPGRADE)
+      memcpy(&model->mm_magic_and_version, &shape->mm_magic_and_version,
+             sizeof(model->mm_magic_and_version));
+    model->mm_extra_flags = shape->mm_extra_flags;
+    model->mm_validator_id = shape->mm_validator_id;
+    model->mm_extra_pagehdr = shape->mm_extra_pagehdr;
+    memcpy(&model->mm_geo, &shape->mm_geo, sizeof(model->mm_geo));
+    memcpy(&model->mm_dbs, &shape->mm_dbs, sizeof(model->mm_dbs));
+    memcpy(&model->mm_canary, &shape->mm_canary, sizeof(model->mm_canary));
+    memcpy(&model->mm_pages_retired, &shape->mm_pages_retired,
+           sizeof(model->mm_pages_retired));
+    if (txnid) {
+      if ((!model->mm_dbs[FREE_DBI].md_mod_txnid &&
+           model->mm_dbs[FREE_DBI].md_root != P_INVALID) ||
+          (!model->mm_dbs[MAIN_DBI].md_mod_txnid &&
+           model->mm_dbs[MAIN_DBI].md_root != P_INVALID))
+        memcpy(&model->mm_magic_and_version, &shape->mm_magic_and_version,
+               sizeof(model->mm_magic_and_version));
+      if (unlikely(!coherency_check_meta(env, model, false))) {
+        ERROR("bailout overriding meta-%zu since model failed "
+              "freedb/maindb %s-check for txnid #%" PRIaTXN,
+              target, "post", txnid);
+        return MDBX_PROBLEM;
+      }
+    }
   }
+  unaligned_poke_u64(4, model->mm_sign, meta_sign(model));
+  rc = validate_meta(env, model, page, (pgno_t)target, nullptr);
+  if (unlikely(MDBX_IS_ERROR(rc)))
+    return MDBX_PROBLEM;
 
-  if (env->me_lfd != INVALID_HANDLE_VALUE) {
-    (void)osal_closefile(env->me_lfd);
-    env->me_lfd = INVALID_HANDLE_VALUE;
-  }
+  if (shape && memcmp(model, shape, sizeof(MDBX_meta)) == 0)
+    return MDBX_SUCCESS;
 
-  if (env->me_dbxs) {
-    for (size_t i = CORE_DBS; i < env->me_numdbs; ++i)
-      if (env->me_dbxs[i].md_name.iov_len)
-        osal_free(env->me_dbxs[i].md_name.iov_base);
-    osal_free(env->me_dbxs);
-    env->me_numdbs = CORE_DBS;
-    env->me_dbxs = nullptr;
-  }
-  if (env->me_pbuf) {
-    osal_memalign_free(env->me_pbuf);
-    env->me_pbuf = nullptr;
-  }
-  if (env->me_dbiseqs) {
-    osal_free(env->me_dbiseqs);
-    env->me_dbiseqs = nullptr;
-  }
-  if (env->me_dbflags) {
-    osal_free(env->me_dbflags);
-    env->me_dbflags = nullptr;
-  }
-  if (env->me_pathname) {
-    osal_free(env->me_pathname);
-    env->me_pathname = nullptr;
-  }
-#if defined(_WIN32) || defined(_WIN64)
-  if (env->me_pathname_char) {
-    osal_free(env->me_pathname_char);
-    env->me_pathname_char = nullptr;
-  }
-#endif /* Windows */
-  if (env->me_txn0) {
-    dpl_free(env->me_txn0);
-    txl_free(env->me_txn0->tw.lifo_reclaimed);
-    pnl_free(env->me_txn0->tw.retired_pages);
-    pnl_free(env->me_txn0->tw.spilled.list);
-    pnl_free(env->me_txn0->tw.relist);
-    osal_free(env->me_txn0);
-    env->me_txn0 = nullptr;
+  if (env->me_flags & MDBX_WRITEMAP) {
+#if MDBX_ENABLE_PGOP_STAT
+    env->me_lck->mti_pgop_stat.msync.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+    rc = osal_msync(&env->me_dxb_mmap, 0,
+                    pgno_align2os_bytes(env, model->mm_geo.next),
+                    MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    /* override_meta() called only while current process have exclusive
+     * lock of a DB file. So meta-page could be updated directly without
+     * clearing consistency flag by mdbx_meta_update_begin() */
+    memcpy(pgno2page(env, target), page, env->me_psize);
+    osal_flush_incoherent_cpu_writeback();
+#if MDBX_ENABLE_PGOP_STAT
+    env->me_lck->mti_pgop_stat.msync.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+    rc = osal_msync(&env->me_dxb_mmap, 0, pgno_align2os_bytes(env, target + 1),
+                    MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
+  } else {
+#if MDBX_ENABLE_PGOP_STAT
+    env->me_lck->mti_pgop_stat.wops.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+    rc = osal_pwrite(env->me_fd4meta, page, env->me_psize,
+                     pgno2bytes(env, target));
+    if (rc == MDBX_SUCCESS && env->me_fd4meta == env->me_lazy_fd) {
+#if MDBX_ENABLE_PGOP_STAT
+      env->me_lck->mti_pgop_stat.fsync.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+      rc = osal_fsync(env->me_lazy_fd, MDBX_SYNC_DATA | MDBX_SYNC_IODQ);
+    }
+    osal_flush_incoherent_mmap(env->me_map, pgno2bytes(env, NUM_METAS),
+                               env->me_os_psize);
   }
-  env->me_stuck_meta = -1;
+  eASSERT(env, !env->me_txn && !env->me_txn0);
   return rc;
 }
 
-__cold int mdbx_env_close_ex(MDBX_env *env, bool dont_sync) {
-  MDBX_page *dp;
-  int rc = MDBX_SUCCESS;
-
-  if (unlikely(!env))
+__cold int mdbx_env_turn_for_recovery(MDBX_env *env, unsigned target) {
+  if (unlikely(target >= NUM_METAS))
     return MDBX_EINVAL;
+  int rc = check_env(env, true);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  if (unlikely(env->me_signature.weak != MDBX_ME_SIGNATURE))
-    return MDBX_EBADSIGN;
+  if (unlikely((env->me_flags & (MDBX_EXCLUSIVE | MDBX_RDONLY)) !=
+               MDBX_EXCLUSIVE))
+    return MDBX_EPERM;
 
-#if MDBX_ENV_CHECKPID || !(defined(_WIN32) || defined(_WIN64))
-  /* Check the PID even if MDBX_ENV_CHECKPID=0 on non-Windows
-   * platforms (i.e. where fork() is available).
-   * This is required to legitimize a call after fork()
-   * from a child process, that should be allowed to free resources. */
-  if (unlikely(env->me_pid != osal_getpid()))
-    env->me_flags |= MDBX_FATAL_ERROR;
-#endif /* MDBX_ENV_CHECKPID */
-
-  if (env->me_map && (env->me_flags & (MDBX_RDONLY | MDBX_FATAL_ERROR)) == 0 &&
-      env->me_txn0) {
-    if (env->me_txn0->mt_owner && env->me_txn0->mt_owner != osal_thread_self())
-      return MDBX_BUSY;
-  } else
-    dont_sync = true;
+  const MDBX_meta *target_meta = METAPAGE(env, target);
+  txnid_t new_txnid = safe64_txnid_next(constmeta_txnid(target_meta));
+  for (size_t n = 0; n < NUM_METAS; ++n) {
+    if (n == target)
+      continue;
+    MDBX_meta meta = *METAPAGE(env, target);
+    if (validate_meta(env, &meta, pgno2page(env, n), (pgno_t)n, nullptr) !=
+        MDBX_SUCCESS) {
+      int err = override_meta(env, n, 0, nullptr);
+      if (unlikely(err != MDBX_SUCCESS))
+        return err;
+    } else {
+      txnid_t txnid = constmeta_txnid(&meta);
+      if (new_txnid <= txnid)
+        new_txnid = safe64_txnid_next(txnid);
+    }
+  }
 
-  if (!atomic_cas32(&env->me_signature, MDBX_ME_SIGNATURE, 0))
-    return MDBX_EBADSIGN;
+  if (unlikely(new_txnid > MAX_TXNID)) {
+    ERROR("txnid overflow, raise %d", MDBX_TXN_FULL);
+    return MDBX_TXN_FULL;
+  }
+  return override_meta(env, target, new_txnid, target_meta);
+}
 
-  if (!dont_sync) {
+__cold int mdbx_env_open_for_recovery(MDBX_env *env, const char *pathname,
+                                      unsigned target_meta, bool writeable) {
 #if defined(_WIN32) || defined(_WIN64)
-    /* On windows, without blocking is impossible to determine whether another
-     * process is running a writing transaction or not.
-     * Because in the "owner died" condition kernel don't release
-     * file lock immediately. */
-    rc = env_sync(env, true, false);
-    rc = (rc == MDBX_RESULT_TRUE) ? MDBX_SUCCESS : rc;
-#else
-    struct stat st;
-    if (unlikely(fstat(env->me_lazy_fd, &st)))
-      rc = errno;
-    else if (st.st_nlink > 0 /* don't sync deleted files */) {
-      rc = env_sync(env, true, true);
-      rc = (rc == MDBX_BUSY || rc == EAGAIN || rc == EACCES || rc == EBUSY ||
-            rc == EWOULDBLOCK || rc == MDBX_RESULT_TRUE)
-               ? MDBX_SUCCESS
-               : rc;
-    }
-#endif /* Windows */
+  wchar_t *pathnameW = nullptr;
+  int rc = osal_mb2w(pathname, &pathnameW);
+  if (likely(rc == MDBX_SUCCESS)) {
+    rc = mdbx_env_open_for_recoveryW(env, pathnameW, target_meta, writeable);
+    osal_free(pathnameW);
   }
+  return rc;
+}
 
-  eASSERT(env, env->me_signature.weak == 0);
-  rc = env_close(env) ? MDBX_PANIC : rc;
-  ENSURE(env, osal_fastmutex_destroy(&env->me_dbi_lock) == MDBX_SUCCESS);
+__cold int mdbx_env_open_for_recoveryW(MDBX_env *env, const wchar_t *pathname,
+                                       unsigned target_meta, bool writeable) {
+#endif /* Windows */
+
+  if (unlikely(target_meta >= NUM_METAS))
+    return MDBX_EINVAL;
+  int rc = check_env(env, false);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely(env->me_map))
+    return MDBX_EPERM;
+
+  env->me_stuck_meta = (int8_t)target_meta;
+  return
 #if defined(_WIN32) || defined(_WIN64)
-  /* me_remap_guard don't have destructor (Slim Reader/Writer Lock) */
-  DeleteCriticalSection(&env->me_windowsbug_lock);
+      mdbx_env_openW
 #else
-  ENSURE(env, osal_fastmutex_destroy(&env->me_remap_guard) == MDBX_SUCCESS);
+      mdbx_env_open
 #endif /* Windows */
+      (env, pathname, writeable ? MDBX_EXCLUSIVE : MDBX_EXCLUSIVE | MDBX_RDONLY,
+       0);
+}
 
-#if MDBX_LOCKING > MDBX_LOCKING_SYSV
-  MDBX_lockinfo *const stub = lckless_stub(env);
-  ENSURE(env, osal_ipclock_destroy(&stub->mti_wlock) == 0);
-#endif /* MDBX_LOCKING */
+typedef struct {
+  void *buffer_for_free;
+  pathchar_t *lck, *dxb;
+  size_t ent_len;
+} MDBX_handle_env_pathname;
 
-  while ((dp = env->me_dp_reserve) != NULL) {
-    MDBX_ASAN_UNPOISON_MEMORY_REGION(dp, env->me_psize);
-    VALGRIND_MAKE_MEM_DEFINED(&mp_next(dp), sizeof(MDBX_page *));
-    env->me_dp_reserve = mp_next(dp);
-    void *const ptr = ptr_disp(dp, -(ptrdiff_t)sizeof(size_t));
-    osal_free(ptr);
+__cold static int check_alternative_lck_absent(const pathchar_t *lck_pathname) {
+  int err = osal_fileexists(lck_pathname);
+  if (unlikely(err != MDBX_RESULT_FALSE)) {
+    if (err == MDBX_RESULT_TRUE)
+      err = MDBX_DUPLICATED_CLK;
+    ERROR("Alternative/Duplicate LCK-file '%" MDBX_PRIsPATH "' error %d",
+          lck_pathname, err);
   }
-  VALGRIND_DESTROY_MEMPOOL(env);
-  ENSURE(env, env->me_lcklist_next == nullptr);
-  env->me_pid = 0;
-  osal_free(env);
-
-  return rc;
+  return err;
 }
 
-#ifndef LIBMDBX_NO_EXPORTS_LEGACY_API
-__cold int mdbx_env_close(MDBX_env *env) {
-  return __inline_mdbx_env_close(env);
-}
-#endif /* LIBMDBX_NO_EXPORTS_LEGACY_API */
+__cold static int handle_env_pathname(MDBX_handle_env_pathname *ctx,
+                                      const pathchar_t *pathname,
+                                      MDBX_env_flags_t *flags,
+                                      const mdbx_mode_t mode) {
+  memset(ctx, 0, sizeof(*ctx));
+  if (unlikely(!pathname || !*pathname))
+    return MDBX_EINVAL;
 
-/* Search for key within a page, using binary search.
- * Returns the smallest entry larger or equal to the key.
- * Updates the cursor index with the index of the found entry.
- * If no entry larger or equal to the key is found, returns NULL. */
-__hot static struct node_result node_search(MDBX_cursor *mc,
-                                            const MDBX_val *key) {
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  const intptr_t nkeys = page_numkeys(mp);
-  DKBUF_DEBUG;
+  int rc;
+#if defined(_WIN32) || defined(_WIN64)
+  const DWORD dwAttrib = GetFileAttributesW(pathname);
+  if (dwAttrib == INVALID_FILE_ATTRIBUTES) {
+    rc = GetLastError();
+    if (rc != MDBX_ENOFILE)
+      return rc;
+    if (mode == 0 || (*flags & MDBX_RDONLY) != 0)
+      /* can't open existing */
+      return rc;
 
-  DEBUG("searching %zu keys in %s %spage %" PRIaPGNO, nkeys,
-        IS_LEAF(mp) ? "leaf" : "branch", IS_SUBP(mp) ? "sub-" : "",
-        mp->mp_pgno);
+    /* auto-create directory if requested */
+    if ((*flags & MDBX_NOSUBDIR) == 0 && !CreateDirectoryW(pathname, nullptr)) {
+      rc = GetLastError();
+      if (rc != ERROR_ALREADY_EXISTS)
+        return rc;
+    }
+  } else {
+    /* ignore passed MDBX_NOSUBDIR flag and set it automatically */
+    *flags |= MDBX_NOSUBDIR;
+    if (dwAttrib & FILE_ATTRIBUTE_DIRECTORY)
+      *flags -= MDBX_NOSUBDIR;
+  }
+#else
+  struct stat st;
+  if (stat(pathname, &st) != 0) {
+    rc = errno;
+    if (rc != MDBX_ENOFILE)
+      return rc;
+    if (mode == 0 || (*flags & MDBX_RDONLY) != 0)
+      /* can't open non-existing */
+      return rc /* MDBX_ENOFILE */;
 
-  struct node_result ret;
-  ret.exact = false;
-  STATIC_ASSERT(P_BRANCH == 1);
-  intptr_t low = mp->mp_flags & P_BRANCH;
-  intptr_t high = nkeys - 1;
-  if (unlikely(high < low)) {
-    mc->mc_ki[mc->mc_top] = 0;
-    ret.node = NULL;
-    return ret;
+    /* auto-create directory if requested */
+    const mdbx_mode_t dir_mode =
+        (/* inherit read/write permissions for group and others */ mode &
+         (S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) |
+        /* always add read/write/search for owner */ S_IRWXU |
+        ((mode & S_IRGRP) ? /* +search if readable by group */ S_IXGRP : 0) |
+        ((mode & S_IROTH) ? /* +search if readable by others */ S_IXOTH : 0);
+    if ((*flags & MDBX_NOSUBDIR) == 0 && mkdir(pathname, dir_mode)) {
+      rc = errno;
+      if (rc != EEXIST)
+        return rc;
+    }
+  } else {
+    /* ignore passed MDBX_NOSUBDIR flag and set it automatically */
+    *flags |= MDBX_NOSUBDIR;
+    if (S_ISDIR(st.st_mode))
+      *flags -= MDBX_NOSUBDIR;
   }
+#endif
 
-  intptr_t i;
-  MDBX_cmp_func *cmp = mc->mc_dbx->md_cmp;
-  MDBX_val nodekey;
-  if (unlikely(IS_LEAF2(mp))) {
-    cASSERT(mc, mp->mp_leaf2_ksize == mc->mc_db->md_xsize);
-    nodekey.iov_len = mp->mp_leaf2_ksize;
-    do {
-      i = (low + high) >> 1;
-      nodekey.iov_base = page_leaf2key(mp, i, nodekey.iov_len);
-      cASSERT(mc, ptr_disp(mp, mc->mc_txn->mt_env->me_psize) >=
-                      ptr_disp(nodekey.iov_base, nodekey.iov_len));
-      int cr = cmp(key, &nodekey);
-      DEBUG("found leaf index %zu [%s], rc = %i", i, DKEY_DEBUG(&nodekey), cr);
-      if (cr > 0)
-        /* Found entry is less than the key. */
-        /* Skip to get the smallest entry larger than key. */
-        low = ++i;
-      else if (cr < 0)
-        high = i - 1;
-      else {
-        ret.exact = true;
-        break;
-      }
-    } while (likely(low <= high));
+  static const pathchar_t dxb_name[] = MDBX_DATANAME;
+  static const pathchar_t lck_name[] = MDBX_LOCKNAME;
+  static const pathchar_t lock_suffix[] = MDBX_LOCK_SUFFIX;
 
-    /* store the key index */
-    mc->mc_ki[mc->mc_top] = (indx_t)i;
-    ret.node = (i < nkeys)
-                   ? /* fake for LEAF2 */ (MDBX_node *)(intptr_t)-1
-                   : /* There is no entry larger or equal to the key. */ NULL;
-    return ret;
+#if defined(_WIN32) || defined(_WIN64)
+  assert(dxb_name[0] == '\\' && lck_name[0] == '\\');
+  const size_t pathname_len = wcslen(pathname);
+#else
+  assert(dxb_name[0] == '/' && lck_name[0] == '/');
+  const size_t pathname_len = strlen(pathname);
+#endif
+  assert(!osal_isdirsep(lock_suffix[0]));
+  ctx->ent_len = pathname_len;
+  static const size_t dxb_name_len = ARRAY_LENGTH(dxb_name) - 1;
+  if (*flags & MDBX_NOSUBDIR) {
+    if (ctx->ent_len > dxb_name_len &&
+        osal_pathequal(pathname + ctx->ent_len - dxb_name_len, dxb_name,
+                       dxb_name_len)) {
+      *flags -= MDBX_NOSUBDIR;
+      ctx->ent_len -= dxb_name_len;
+    } else if (ctx->ent_len == dxb_name_len - 1 && osal_isdirsep(dxb_name[0]) &&
+               osal_isdirsep(lck_name[0]) &&
+               osal_pathequal(pathname + ctx->ent_len - dxb_name_len + 1,
+                              dxb_name + 1, dxb_name_len - 1)) {
+      *flags -= MDBX_NOSUBDIR;
+      ctx->ent_len -= dxb_name_len - 1;
+    }
   }
 
-  if (IS_BRANCH(mp) && cmp == cmp_int_align2)
-    /* Branch pages have no data, so if using integer keys,
-     * alignment is guaranteed. Use faster cmp_int_align4(). */
-    cmp = cmp_int_align4;
+  const size_t suflen_with_NOSUBDIR = sizeof(lock_suffix) + sizeof(pathchar_t);
+  const size_t suflen_without_NOSUBDIR = sizeof(lck_name) + sizeof(dxb_name);
+  const size_t enogh4any = (suflen_with_NOSUBDIR > suflen_without_NOSUBDIR)
+                               ? suflen_with_NOSUBDIR
+                               : suflen_without_NOSUBDIR;
+  const size_t bytes_needed = sizeof(pathchar_t) * ctx->ent_len * 2 + enogh4any;
+  ctx->buffer_for_free = osal_malloc(bytes_needed);
+  if (!ctx->buffer_for_free)
+    return MDBX_ENOMEM;
 
-  MDBX_node *node;
-  do {
-    i = (low + high) >> 1;
-    node = page_node(mp, i);
-    nodekey.iov_len = node_ks(node);
-    nodekey.iov_base = node_key(node);
-    cASSERT(mc, ptr_disp(mp, mc->mc_txn->mt_env->me_psize) >=
-                    ptr_disp(nodekey.iov_base, nodekey.iov_len));
-    int cr = cmp(key, &nodekey);
-    if (IS_LEAF(mp))
-      DEBUG("found leaf index %zu [%s], rc = %i", i, DKEY_DEBUG(&nodekey), cr);
-    else
-      DEBUG("found branch index %zu [%s -> %" PRIaPGNO "], rc = %i", i,
-            DKEY_DEBUG(&nodekey), node_pgno(node), cr);
-    if (cr > 0)
-      /* Found entry is less than the key. */
-      /* Skip to get the smallest entry larger than key. */
-      low = ++i;
-    else if (cr < 0)
-      high = i - 1;
-    else {
-      ret.exact = true;
-      break;
+  ctx->dxb = ctx->buffer_for_free;
+  ctx->lck = ctx->dxb + ctx->ent_len + dxb_name_len + 1;
+  pathchar_t *const buf = ctx->buffer_for_free;
+  rc = MDBX_SUCCESS;
+  if (ctx->ent_len) {
+    memcpy(buf + /* shutting up goofy MSVC static analyzer */ 0, pathname,
+           sizeof(pathchar_t) * pathname_len);
+    if (*flags & MDBX_NOSUBDIR) {
+      const pathchar_t *const lck_ext =
+          osal_fileext(lck_name, ARRAY_LENGTH(lck_name));
+      if (lck_ext) {
+        pathchar_t *pathname_ext = osal_fileext(buf, pathname_len);
+        memcpy(pathname_ext ? pathname_ext : buf + pathname_len, lck_ext,
+               sizeof(pathchar_t) * (ARRAY_END(lck_name) - lck_ext));
+        rc = check_alternative_lck_absent(buf);
+      }
+    } else {
+      memcpy(buf + ctx->ent_len, dxb_name, sizeof(dxb_name));
+      memcpy(buf + ctx->ent_len + dxb_name_len, lock_suffix,
+             sizeof(lock_suffix));
+      rc = check_alternative_lck_absent(buf);
     }
-  } while (likely(low <= high));
-
-  /* store the key index */
-  mc->mc_ki[mc->mc_top] = (indx_t)i;
-  ret.node = (i < nkeys)
-                 ? page_node(mp, i)
-                 : /* There is no entry larger or equal to the key. */ NULL;
-  return ret;
-}
 
-/* Pop a page off the top of the cursor's stack. */
-static __inline void cursor_pop(MDBX_cursor *mc) {
-  if (likely(mc->mc_snum)) {
-    DEBUG("popped page %" PRIaPGNO " off db %d cursor %p",
-          mc->mc_pg[mc->mc_top]->mp_pgno, DDBI(mc), (void *)mc);
-    if (likely(--mc->mc_snum)) {
-      mc->mc_top--;
+    memcpy(ctx->dxb + /* shutting up goofy MSVC static analyzer */ 0, pathname,
+           sizeof(pathchar_t) * (ctx->ent_len + 1));
+    memcpy(ctx->lck, pathname, sizeof(pathchar_t) * ctx->ent_len);
+    if (*flags & MDBX_NOSUBDIR) {
+      memcpy(ctx->lck + ctx->ent_len, lock_suffix, sizeof(lock_suffix));
     } else {
-      mc->mc_flags &= ~C_INITIALIZED;
+      memcpy(ctx->dxb + ctx->ent_len, dxb_name, sizeof(dxb_name));
+      memcpy(ctx->lck + ctx->ent_len, lck_name, sizeof(lck_name));
     }
-  }
-}
-
-/* Push a page onto the top of the cursor's stack.
- * Set MDBX_TXN_ERROR on failure. */
-static __inline int cursor_push(MDBX_cursor *mc, MDBX_page *mp) {
-  DEBUG("pushing page %" PRIaPGNO " on db %d cursor %p", mp->mp_pgno, DDBI(mc),
-        (void *)mc);
+  } else {
+    assert(!(*flags & MDBX_NOSUBDIR));
+    memcpy(buf + /* shutting up goofy MSVC static analyzer */ 0, dxb_name + 1,
+           sizeof(dxb_name) - sizeof(pathchar_t));
+    memcpy(buf + dxb_name_len - 1, lock_suffix, sizeof(lock_suffix));
+    rc = check_alternative_lck_absent(buf);
 
-  if (unlikely(mc->mc_snum >= CURSOR_STACK)) {
-    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-    return MDBX_CURSOR_FULL;
+    memcpy(ctx->dxb + /* shutting up goofy MSVC static analyzer */ 0,
+           dxb_name + 1, sizeof(dxb_name) - sizeof(pathchar_t));
+    memcpy(ctx->lck, lck_name + 1, sizeof(lck_name) - sizeof(pathchar_t));
   }
-
-  mc->mc_top = mc->mc_snum++;
-  mc->mc_pg[mc->mc_top] = mp;
-  mc->mc_ki[mc->mc_top] = 0;
-  return MDBX_SUCCESS;
+  return rc;
 }
 
-__hot static __always_inline int page_get_checker_lite(const uint16_t ILL,
-                                                       const MDBX_page *page,
-                                                       MDBX_txn *const txn,
-                                                       const txnid_t front) {
-  if (unlikely(page->mp_flags & ILL)) {
-    if (ILL == P_ILL_BITS || (page->mp_flags & P_ILL_BITS))
-      return bad_page(page, "invalid page's flags (%u)\n", page->mp_flags);
-    else if (ILL & P_OVERFLOW) {
-      assert((ILL & (P_BRANCH | P_LEAF | P_LEAF2)) == 0);
-      assert(page->mp_flags & (P_BRANCH | P_LEAF | P_LEAF2));
-      return bad_page(page, "unexpected %s instead of %s (%u)\n",
-                      "large/overflow", "branch/leaf/leaf2", page->mp_flags);
-    } else if (ILL & (P_BRANCH | P_LEAF | P_LEAF2)) {
-      assert((ILL & P_BRANCH) && (ILL & P_LEAF) && (ILL & P_LEAF2));
-      assert(page->mp_flags & (P_BRANCH | P_LEAF | P_LEAF2));
-      return bad_page(page, "unexpected %s instead of %s (%u)\n",
-                      "branch/leaf/leaf2", "large/overflow", page->mp_flags);
-    } else {
-      assert(false);
-    }
-  }
-
-  if (unlikely(page->mp_txnid > front) &&
-      unlikely(page->mp_txnid > txn->mt_front || front < txn->mt_txnid))
-    return bad_page(
-        page,
-        "invalid page' txnid (%" PRIaTXN ") for %s' txnid (%" PRIaTXN ")\n",
-        page->mp_txnid,
-        (front == txn->mt_front && front != txn->mt_txnid) ? "front-txn"
-                                                           : "parent-page",
-        front);
-
-  if (((ILL & P_OVERFLOW) || !IS_OVERFLOW(page)) &&
-      (ILL & (P_BRANCH | P_LEAF | P_LEAF2)) == 0) {
-    if (unlikely(page->mp_upper < page->mp_lower ||
-                 ((page->mp_lower | page->mp_upper) & 1) ||
-                 PAGEHDRSZ + page->mp_upper > txn->mt_env->me_psize))
-      return bad_page(page,
-                      "invalid page' lower(%u)/upper(%u) with limit %zu\n",
-                      page->mp_lower, page->mp_upper, page_space(txn->mt_env));
-
-  } else if ((ILL & P_OVERFLOW) == 0) {
-    const pgno_t npages = page->mp_pages;
-    if (unlikely(npages < 1) || unlikely(npages >= MAX_PAGENO / 2))
-      return bad_page(page, "invalid n-pages (%u) for large-page\n", npages);
-    if (unlikely(page->mp_pgno + npages > txn->mt_next_pgno))
-      return bad_page(
-          page,
-          "end of large-page beyond (%u) allocated space (%u next-pgno)\n",
-          page->mp_pgno + npages, txn->mt_next_pgno);
-  } else {
-    assert(false);
+/* Журнал значений размещается рядом с файлом БД, см. mdbx_dbi_set_vlog() */
+__cold static pathchar_t *vlog_pathname(const pathchar_t *dxb_pathname) {
+  static const pathchar_t vlog_suffix[] = MDBX_VLOG_SUFFIX;
+#if defined(_WIN32) || defined(_WIN64)
+  const size_t len = wcslen(dxb_pathname);
+#else
+  const size_t len = strlen(dxb_pathname);
+#endif
+  pathchar_t *const pathname =
+      osal_malloc(sizeof(pathchar_t) * len + sizeof(vlog_suffix));
+  if (likely(pathname)) {
+    memcpy(pathname, dxb_pathname, sizeof(pathchar_t) * len);
+    memcpy(pathname + len, vlog_suffix, sizeof(vlog_suffix));
   }
-  return MDBX_SUCCESS;
+  return pathname;
 }
 
-__cold static __noinline pgr_t
-page_get_checker_full(const uint16_t ILL, MDBX_page *page,
-                      const MDBX_cursor *const mc, const txnid_t front) {
-  pgr_t r = {page, page_get_checker_lite(ILL, page, mc->mc_txn, front)};
-  if (likely(r.err == MDBX_SUCCESS))
-    r.err = page_check(mc, page);
-  if (unlikely(r.err != MDBX_SUCCESS))
-    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-  return r;
+__cold int mdbx_env_delete(const char *pathname, MDBX_env_delete_mode_t mode) {
+#if defined(_WIN32) || defined(_WIN64)
+  wchar_t *pathnameW = nullptr;
+  int rc = osal_mb2w(pathname, &pathnameW);
+  if (likely(rc == MDBX_SUCCESS)) {
+    rc = mdbx_env_deleteW(pathnameW, mode);
+    osal_free(pathnameW);
+  }
+  return rc;
 }
 
-__hot static __always_inline pgr_t page_get_inline(const uint16_t ILL,
-                                                   const MDBX_cursor *const mc,
-                                                   const pgno_t pgno,
-                                                   const txnid_t front) {
-  MDBX_txn *const txn = mc->mc_txn;
-  tASSERT(txn, front <= txn->mt_front);
+__cold int mdbx_env_deleteW(const wchar_t *pathname,
+                            MDBX_env_delete_mode_t mode) {
+#endif /* Windows */
 
-  pgr_t r;
-  if (unlikely(pgno >= txn->mt_next_pgno)) {
-    ERROR("page #%" PRIaPGNO " beyond next-pgno", pgno);
-    r.page = nullptr;
-    r.err = MDBX_PAGE_NOTFOUND;
-  bailout:
-    txn->mt_flags |= MDBX_TXN_ERROR;
-    return r;
+  switch (mode) {
+  default:
+    return MDBX_EINVAL;
+  case MDBX_ENV_JUST_DELETE:
+  case MDBX_ENV_ENSURE_UNUSED:
+  case MDBX_ENV_WAIT_FOR_UNUSED:
+    break;
   }
 
-  eASSERT(txn->mt_env,
-          ((txn->mt_flags ^ txn->mt_env->me_flags) & MDBX_WRITEMAP) == 0);
-  r.page = pgno2page(txn->mt_env, pgno);
-  if ((txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_WRITEMAP)) == 0) {
-    const MDBX_txn *spiller = txn;
-    do {
-      /* Spilled pages were dirtied in this txn and flushed
-       * because the dirty list got full. Bring this page
-       * back in from the map (but don't unspill it here,
-       * leave that unless page_touch happens again). */
-      if (unlikely(spiller->mt_flags & MDBX_TXN_SPILLS) &&
-          search_spilled(spiller, pgno))
-        break;
+#ifdef __e2k__ /* https://bugs.mcst.ru/bugzilla/show_bug.cgi?id=6011 */
+  MDBX_env *const dummy_env = alloca(sizeof(MDBX_env));
+#else
+  MDBX_env dummy_env_silo, *const dummy_env = &dummy_env_silo;
+#endif
+  memset(dummy_env, 0, sizeof(*dummy_env));
+  dummy_env->me_flags =
+      (mode == MDBX_ENV_ENSURE_UNUSED) ? MDBX_EXCLUSIVE : MDBX_ENV_DEFAULTS;
+  dummy_env->me_os_psize = (unsigned)osal_syspagesize();
+  dummy_env->me_psize = (unsigned)mdbx_default_pagesize();
+  dummy_env->me_pathname = (pathchar_t *)pathname;
 
-      const size_t i = dpl_search(spiller, pgno);
-      tASSERT(txn, (intptr_t)i > 0);
-      if (spiller->tw.dirtylist->items[i].pgno == pgno) {
-        r.page = spiller->tw.dirtylist->items[i].ptr;
-        break;
+  MDBX_handle_env_pathname env_pathname;
+  STATIC_ASSERT(sizeof(dummy_env->me_flags) == sizeof(MDBX_env_flags_t));
+  int rc = MDBX_RESULT_TRUE,
+      err = handle_env_pathname(&env_pathname, pathname,
+                                (MDBX_env_flags_t *)&dummy_env->me_flags, 0);
+  if (likely(err == MDBX_SUCCESS)) {
+    mdbx_filehandle_t clk_handle = INVALID_HANDLE_VALUE,
+                      dxb_handle = INVALID_HANDLE_VALUE;
+    if (mode > MDBX_ENV_JUST_DELETE) {
+      err = osal_openfile(MDBX_OPEN_DELETE, dummy_env, env_pathname.dxb,
+                          &dxb_handle, 0);
+      err = (err == MDBX_ENOFILE) ? MDBX_SUCCESS : err;
+      if (err == MDBX_SUCCESS) {
+        err = osal_openfile(MDBX_OPEN_DELETE, dummy_env, env_pathname.lck,
+                            &clk_handle, 0);
+        err = (err == MDBX_ENOFILE) ? MDBX_SUCCESS : err;
       }
+      if (err == MDBX_SUCCESS && clk_handle != INVALID_HANDLE_VALUE)
+        err = osal_lockfile(clk_handle, mode == MDBX_ENV_WAIT_FOR_UNUSED);
+      if (err == MDBX_SUCCESS && dxb_handle != INVALID_HANDLE_VALUE)
+        err = osal_lockfile(dxb_handle, mode == MDBX_ENV_WAIT_FOR_UNUSED);
+    }
 
-      spiller = spiller->mt_parent;
-    } while (spiller);
-  }
-
-  if (unlikely(r.page->mp_pgno != pgno)) {
-    r.err = bad_page(
-        r.page, "pgno mismatch (%" PRIaPGNO ") != expected (%" PRIaPGNO ")\n",
-        r.page->mp_pgno, pgno);
-    goto bailout;
-  }
-
-  if (unlikely(mc->mc_checking & CC_PAGECHECK))
-    return page_get_checker_full(ILL, r.page, mc, front);
-
-#if MDBX_DISABLE_VALIDATION
-  r.err = MDBX_SUCCESS;
-#else
-  r.err = page_get_checker_lite(ILL, r.page, txn, front);
-  if (unlikely(r.err != MDBX_SUCCESS))
-    goto bailout;
-#endif /* MDBX_DISABLE_VALIDATION */
-  return r;
-}
-
-/* Finish mdbx_page_search() / mdbx_page_search_lowest().
- * The cursor is at the root page, set up the rest of it. */
-__hot __noinline static int page_search_root(MDBX_cursor *mc,
-                                             const MDBX_val *key, int flags) {
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  int rc;
-  DKBUF_DEBUG;
-
-  while (IS_BRANCH(mp)) {
-    MDBX_node *node;
-    intptr_t i;
-
-    DEBUG("branch page %" PRIaPGNO " has %zu keys", mp->mp_pgno,
-          page_numkeys(mp));
-    /* Don't assert on branch pages in the GC. We can get here
-     * while in the process of rebalancing a GC branch page; we must
-     * let that proceed. ITS#8336 */
-    cASSERT(mc, !mc->mc_dbi || page_numkeys(mp) > 1);
-    DEBUG("found index 0 to page %" PRIaPGNO, node_pgno(page_node(mp, 0)));
-
-    if (flags & (MDBX_PS_FIRST | MDBX_PS_LAST)) {
-      i = 0;
-      if (flags & MDBX_PS_LAST) {
-        i = page_numkeys(mp) - 1;
-        /* if already init'd, see if we're already in right place */
-        if (mc->mc_flags & C_INITIALIZED) {
-          if (mc->mc_ki[mc->mc_top] == i) {
-            mc->mc_top = mc->mc_snum++;
-            mp = mc->mc_pg[mc->mc_top];
-            goto ready;
-          }
-        }
-      }
-    } else {
-      const struct node_result nsr = node_search(mc, key);
-      if (likely(nsr.node))
-        i = mc->mc_ki[mc->mc_top] + (intptr_t)nsr.exact - 1;
-      else
-        i = page_numkeys(mp) - 1;
-      DEBUG("following index %zu for key [%s]", i, DKEY_DEBUG(key));
+    if (err == MDBX_SUCCESS) {
+      err = osal_removefile(env_pathname.dxb);
+      if (err == MDBX_SUCCESS)
+        rc = MDBX_SUCCESS;
+      else if (err == MDBX_ENOFILE)
+        err = MDBX_SUCCESS;
     }
 
-    cASSERT(mc, i >= 0 && i < (int)page_numkeys(mp));
-    node = page_node(mp, i);
-
-    rc = page_get(mc, node_pgno(node), &mp, mp->mp_txnid);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-
-    mc->mc_ki[mc->mc_top] = (indx_t)i;
-    if (unlikely(rc = cursor_push(mc, mp)))
-      return rc;
+    if (err == MDBX_SUCCESS) {
+      err = osal_removefile(env_pathname.lck);
+      if (err == MDBX_SUCCESS)
+        rc = MDBX_SUCCESS;
+      else if (err == MDBX_ENOFILE)
+        err = MDBX_SUCCESS;
+    }
 
-  ready:
-    if (flags & MDBX_PS_MODIFY) {
-      rc = page_touch(mc);
-      if (unlikely(rc != MDBX_SUCCESS))
-        return rc;
-      mp = mc->mc_pg[mc->mc_top];
+    if (err == MDBX_SUCCESS) {
+      pathchar_t *const vlog = vlog_pathname(env_pathname.dxb);
+      err = vlog ? osal_removefile(vlog) : MDBX_ENOMEM;
+      osal_free(vlog);
+      if (err == MDBX_SUCCESS)
+        rc = MDBX_SUCCESS;
+      else if (err == MDBX_ENOFILE)
+        err = MDBX_SUCCESS;
     }
-  }
 
-  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-          mp->mp_pgno, mp->mp_flags);
-    return MDBX_CORRUPTED;
-  }
+    if (err == MDBX_SUCCESS && !(dummy_env->me_flags & MDBX_NOSUBDIR)) {
+      err = osal_removedirectory(pathname);
+      if (err == MDBX_SUCCESS)
+        rc = MDBX_SUCCESS;
+      else if (err == MDBX_ENOFILE)
+        err = MDBX_SUCCESS;
+    }
 
-  DEBUG("found leaf page %" PRIaPGNO " for key [%s]", mp->mp_pgno,
-        DKEY_DEBUG(key));
-  mc->mc_flags |= C_INITIALIZED;
-  mc->mc_flags &= ~C_EOF;
+    if (dxb_handle != INVALID_HANDLE_VALUE)
+      osal_closefile(dxb_handle);
+    if (clk_handle != INVALID_HANDLE_VALUE)
+      osal_closefile(clk_handle);
+  } else if (err == MDBX_ENOFILE)
+    err = MDBX_SUCCESS;
 
-  return MDBX_SUCCESS;
+  osal_free(env_pathname.buffer_for_free);
+  return (err == MDBX_SUCCESS) ? rc : err;
 }
 
-static int setup_dbx(MDBX_dbx *const dbx, const MDBX_db *const db,
-                     const unsigned pagesize) {
-  if (unlikely(!dbx->md_cmp)) {
-    dbx->md_cmp = get_default_keycmp(db->md_flags);
-    dbx->md_dcmp = get_default_datacmp(db->md_flags);
-  }
-
-  dbx->md_klen_min =
-      (db->md_flags & MDBX_INTEGERKEY) ? 4 /* sizeof(uint32_t) */ : 0;
-  dbx->md_klen_max = keysize_max(pagesize, db->md_flags);
-  assert(dbx->md_klen_max != (unsigned)-1);
-
-  dbx->md_vlen_min = (db->md_flags & MDBX_INTEGERDUP)
-                         ? 4 /* sizeof(uint32_t) */
-                         : ((db->md_flags & MDBX_DUPFIXED) ? 1 : 0);
-  dbx->md_vlen_max = valsize_max(pagesize, db->md_flags);
-  assert(dbx->md_vlen_max != (size_t)-1);
-
-  if ((db->md_flags & (MDBX_DUPFIXED | MDBX_INTEGERDUP)) != 0 && db->md_xsize) {
-    if (!MDBX_DISABLE_VALIDATION && unlikely(db->md_xsize < dbx->md_vlen_min ||
-                                             db->md_xsize > dbx->md_vlen_max)) {
-      ERROR("db.md_xsize (%u) <> min/max value-length (%zu/%zu)", db->md_xsize,
-            dbx->md_vlen_min, dbx->md_vlen_max);
-      return MDBX_CORRUPTED;
-    }
-    dbx->md_vlen_min = dbx->md_vlen_max = db->md_xsize;
+__cold int mdbx_env_open(MDBX_env *env, const char *pathname,
+                         MDBX_env_flags_t flags, mdbx_mode_t mode) {
+#if defined(_WIN32) || defined(_WIN64)
+  wchar_t *pathnameW = nullptr;
+  int rc = osal_mb2w(pathname, &pathnameW);
+  if (likely(rc == MDBX_SUCCESS)) {
+    rc = mdbx_env_openW(env, pathnameW, flags, mode);
+    osal_free(pathnameW);
+    if (rc == MDBX_SUCCESS)
+      /* force to make cache of the multi-byte pathname representation */
+      mdbx_env_get_path(env, &pathname);
   }
-  return MDBX_SUCCESS;
+  return rc;
 }
 
-static int fetch_sdb(MDBX_txn *txn, size_t dbi) {
-  MDBX_cursor_couple couple;
-  if (unlikely(dbi_changed(txn, dbi))) {
-    NOTICE("dbi %zu was changed for txn %" PRIaTXN, dbi, txn->mt_txnid);
-    return MDBX_BAD_DBI;
-  }
-  int rc = cursor_init(&couple.outer, txn, MAIN_DBI);
+__cold int mdbx_env_openW(MDBX_env *env, const wchar_t *pathname,
+                          MDBX_env_flags_t flags, mdbx_mode_t mode) {
+#endif /* Windows */
+
+  int rc = check_env(env, false);
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  MDBX_dbx *const dbx = &txn->mt_dbxs[dbi];
-  rc = page_search(&couple.outer, &dbx->md_name, 0);
-  if (unlikely(rc != MDBX_SUCCESS)) {
-  notfound:
-    NOTICE("dbi %zu refs to inaccessible subDB `%*s` for txn %" PRIaTXN
-           " (err %d)",
-           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
-           txn->mt_txnid, rc);
-    return (rc == MDBX_NOTFOUND) ? MDBX_BAD_DBI : rc;
-  }
+  if (unlikely(flags & ~ENV_USABLE_FLAGS))
+    return MDBX_EINVAL;
 
-  MDBX_val data;
-  struct node_result nsr = node_search(&couple.outer, &dbx->md_name);
-  if (unlikely(!nsr.exact)) {
-    rc = MDBX_NOTFOUND;
-    goto notfound;
-  }
-  if (unlikely((node_flags(nsr.node) & (F_DUPDATA | F_SUBDATA)) != F_SUBDATA)) {
-    NOTICE("dbi %zu refs to not a named subDB `%*s` for txn %" PRIaTXN " (%s)",
-           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
-           txn->mt_txnid, "wrong flags");
-    return MDBX_INCOMPATIBLE; /* not a named DB */
+  if (unlikely(env->me_lazy_fd != INVALID_HANDLE_VALUE ||
+               (env->me_flags & MDBX_ENV_ACTIVE) != 0 || env->me_map))
+    return MDBX_EPERM;
+
+  /* Pickup previously mdbx_env_set_flags(),
+   * but avoid MDBX_UTTERLY_NOSYNC by disjunction */
+  const uint32_t saved_me_flags = env->me_flags;
+  flags = merge_sync_flags(flags | MDBX_DEPRECATED_COALESCE, env->me_flags);
+
+  if (flags & MDBX_RDONLY) {
+    /* Silently ignore irrelevant flags when we're only getting read access */
+    flags &= ~(MDBX_WRITEMAP | MDBX_DEPRECATED_MAPASYNC | MDBX_SAFE_NOSYNC |
+               MDBX_NOMETASYNC | MDBX_DEPRECATED_COALESCE | MDBX_LIFORECLAIM |
+               MDBX_NOMEMINIT | MDBX_ACCEDE);
+    mode = 0;
+  } else {
+#if MDBX_MMAP_INCOHERENT_FILE_WRITE
+    /* Temporary `workaround` for OpenBSD kernel's flaw.
+     * See https://libmdbx.dqdkfa.ru/dead-github/issues/67 */
+    if ((flags & MDBX_WRITEMAP) == 0) {
+      if (flags & MDBX_ACCEDE)
+        flags |= MDBX_WRITEMAP;
+      else {
+        debug_log(MDBX_LOG_ERROR, __func__, __LINE__,
+                  "System (i.e. OpenBSD) requires MDBX_WRITEMAP because "
+                  "of an internal flaw(s) in a file/buffer/page cache.\n");
+        return 42 /* ENOPROTOOPT */;
+      }
+    }
+#endif /* MDBX_MMAP_INCOHERENT_FILE_WRITE */
   }
 
-  rc = node_read(&couple.outer, nsr.node, &data,
-                 couple.outer.mc_pg[couple.outer.mc_top]);
+  MDBX_handle_env_pathname env_pathname;
+  rc = handle_env_pathname(&env_pathname, pathname, &flags, mode);
   if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+    goto bailout;
 
-  if (unlikely(data.iov_len != sizeof(MDBX_db))) {
-    NOTICE("dbi %zu refs to not a named subDB `%*s` for txn %" PRIaTXN " (%s)",
-           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
-           txn->mt_txnid, "wrong rec-size");
-    return MDBX_INCOMPATIBLE; /* not a named DB */
+  env->me_flags = (flags & ~MDBX_FATAL_ERROR) | MDBX_ENV_ACTIVE;
+  env->me_pathname = osal_calloc(env_pathname.ent_len + 1, sizeof(pathchar_t));
+  env->me_dbxs = osal_calloc(env->me_maxdbs, sizeof(MDBX_dbx));
+  env->me_dbflags = osal_calloc(env->me_maxdbs, sizeof(env->me_dbflags[0]));
+  env->me_dbiseqs = osal_calloc(env->me_maxdbs, sizeof(env->me_dbiseqs[0]));
+  if (!(env->me_dbxs && env->me_pathname && env->me_dbflags &&
+        env->me_dbiseqs)) {
+    rc = MDBX_ENOMEM;
+    goto bailout;
   }
+  memcpy(env->me_pathname, env_pathname.dxb,
+         env_pathname.ent_len * sizeof(pathchar_t));
+  env->me_dbxs[FREE_DBI].md_cmp = cmp_int_align4; /* aligned MDBX_INTEGERKEY */
+  env->me_dbxs[FREE_DBI].md_dcmp = cmp_lenfast;
+  env->me_dbxs[FREE_DBI].md_klen_max = env->me_dbxs[FREE_DBI].md_klen_min = 8;
+  env->me_dbxs[FREE_DBI].md_vlen_min = 4;
+  env->me_dbxs[FREE_DBI].md_vlen_max =
+      mdbx_env_get_maxvalsize_ex(env, MDBX_INTEGERKEY);
 
-  uint16_t md_flags = UNALIGNED_PEEK_16(data.iov_base, MDBX_db, md_flags);
-  /* The txn may not know this DBI, or another process may
-   * have dropped and recreated the DB with other flags. */
-  MDBX_db *const db = &txn->mt_dbs[dbi];
-  if (unlikely((db->md_flags & DB_PERSISTENT_FLAGS) != md_flags)) {
-    NOTICE("dbi %zu refs to the re-created subDB `%*s` for txn %" PRIaTXN
-           " with different flags (present 0x%X != wanna 0x%X)",
-           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
-           txn->mt_txnid, db->md_flags & DB_PERSISTENT_FLAGS, md_flags);
-    return MDBX_INCOMPATIBLE;
-  }
-
-  memcpy(db, data.iov_base, sizeof(MDBX_db));
-#if !MDBX_DISABLE_VALIDATION
-  const txnid_t pp_txnid = couple.outer.mc_pg[couple.outer.mc_top]->mp_txnid;
-  tASSERT(txn, txn->mt_front >= pp_txnid);
-  if (unlikely(db->md_mod_txnid > pp_txnid)) {
-    ERROR("db.md_mod_txnid (%" PRIaTXN ") > page-txnid (%" PRIaTXN ")",
-          db->md_mod_txnid, pp_txnid);
-    return MDBX_CORRUPTED;
-  }
-#endif /* !MDBX_DISABLE_VALIDATION */
-  rc = setup_dbx(dbx, db, txn->mt_env->me_psize);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  txn->mt_dbistate[dbi] &= ~DBI_STALE;
-  return MDBX_SUCCESS;
-}
+  /* Использование O_DSYNC или FILE_FLAG_WRITE_THROUGH:
+   *
+   *   0) Если размер страниц БД меньше системной страницы ОЗУ, то ядру ОС
+   *      придется чаще обновлять страницы в unified page cache.
+   *
+   *      Однако, O_DSYNC не предполагает отключение unified page cache,
+   *      поэтому подобные затруднения будем считать проблемой ОС и/или
+   *      ожидаемым пенальти из-за использования мелких страниц БД.
+   *
+   *   1) В режиме MDBX_SYNC_DURABLE - O_DSYNC для записи как данных,
+   *      так и мета-страниц. Однако, на Linux отказ от O_DSYNC с последующим
+   *      fdatasync() может быть выгоднее при использовании HDD, так как
+   *      позволяет io-scheduler переупорядочить запись с учетом актуального
+   *      расположения файла БД на носителе.
+   *
+   *   2) В режиме MDBX_NOMETASYNC - O_DSYNC можно использовать для данных,
+   *      но в этом может не быть смысла, так как fdatasync() всё равно
+   *      требуется для гарантии фиксации мета после предыдущей транзакции.
+   *
+   *      В итоге на нормальных системах (не Windows) есть два варианта:
+   *       - при возможности O_DIRECT и/или io_ring для данных, скорее всего,
+   *         есть смысл вызвать fdatasync() перед записью данных, а затем
+   *         использовать O_DSYNC;
+   *       - не использовать O_DSYNC и вызывать fdatasync() после записи данных.
+   *
+   *      На Windows же следует минимизировать использование FlushFileBuffers()
+   *      из-за проблем с производительностью. Поэтому на Windows в режиме
+   *      MDBX_NOMETASYNC:
+   *       - мета обновляется через дескриптор без FILE_FLAG_WRITE_THROUGH;
+   *       - перед началом записи данных вызывается FlushFileBuffers(), если
+   *         mti_meta_sync_txnid не совпадает с последней записанной мета;
+   *       - данные записываются через дескриптор с FILE_FLAG_WRITE_THROUGH.
+   *
+   *   3) В режиме MDBX_SAFE_NOSYNC - O_DSYNC нет смысла использовать, пока не
+   *      будет реализована возможность полностью асинхронной "догоняющей"
+   *      записи в выделенном процессе-сервере с io-ring очередями внутри.
+   *
+   * -----
+   *
+   * Использование O_DIRECT или FILE_FLAG_NO_BUFFERING:
+   *
+   *   Назначение этих флагов в отключении файлового дескриптора от
+   *   unified page cache, т.е. от отображенных в память данных в случае
+   *   libmdbx.
+   *
+   *   Поэтому, использование direct i/o в libmdbx без MDBX_WRITEMAP лишено
+   *   смысла и контр-продуктивно, ибо так мы провоцируем ядро ОС на
+   *   не-когерентность отображения в память с содержимым файла на носителе,
+   *   либо требуем дополнительных проверок и действий направленных на
+   *   фактическое отключение O_DIRECT для отображенных в память данных.
+   *
+   *   В режиме MDBX_WRITEMAP когерентность отображенных данных обеспечивается
+   *   физически. Поэтому использование direct i/o может иметь смысл, если у
+   *   ядра ОС есть какие-то проблемы с msync(), в том числе с
+   *   производительностью:
+   *    - использование io_ring или gather-write может быть дешевле, чем
+   *      просмотр PTE ядром и запись измененных/грязных;
+   *    - но проблема в том, что записываемые из user mode страницы либо не
+   *      будут помечены чистыми (и соответственно будут записаны ядром
+   *      еще раз), либо ядру необходимо искать и чистить PTE при получении
+   *      запроса на запись.
+   *
+   *   Поэтому O_DIRECT или FILE_FLAG_NO_BUFFERING используется:
+   *    - только в режиме MDBX_SYNC_DURABLE с MDBX_WRITEMAP;
+   *    - когда me_psize >= me_os_psize;
+   *    - опция сборки MDBX_AVOID_MSYNC != 0, которая по-умолчанию включена
+   *      только на Windows (см ниже).
+   *
+   * -----
+   *
+   * Использование FILE_FLAG_OVERLAPPED на Windows:
+   *
+   * У Windows очень плохо с I/O (за исключением прямых постраничных
+   * scatter/gather, которые работают в обход проблемного unified page
+   * cache и поэтому почти бесполезны в libmdbx).
+   *
+   * При этом всё еще хуже при использовании FlushFileBuffers(), что также
+   * требуется после FlushViewOfFile() в режиме MDBX_WRITEMAP. Поэтому
+   * на Windows вместо FlushViewOfFile() и FlushFileBuffers() следует
+   * использовать запись через дескриптор с FILE_FLAG_WRITE_THROUGH.
+   *
+   * В свою очередь, запись с FILE_FLAG_WRITE_THROUGH дешевле/быстрее
+   * при использовании FILE_FLAG_OVERLAPPED. В результате, на Windows
+   * в durable-режимах запись данных всегда в overlapped-режиме,
+   * при этом для записи мета требуется отдельный не-overlapped дескриптор.
+   */
 
-/* Search for the lowest key under the current branch page.
- * This just bypasses a numkeys check in the current page
- * before calling mdbx_page_search_root(), because the callers
- * are all in situations where the current page is known to
- * be underfilled. */
-__hot static int page_search_lowest(MDBX_cursor *mc) {
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  cASSERT(mc, IS_BRANCH(mp));
-  MDBX_node *node = page_node(mp, 0);
+  rc = osal_openfile((flags & MDBX_RDONLY) ? MDBX_OPEN_DXB_READ
+                                           : MDBX_OPEN_DXB_LAZY,
+                     env, env_pathname.dxb, &env->me_lazy_fd, mode);
+  if (rc != MDBX_SUCCESS)
+    goto bailout;
 
-  int rc = page_get(mc, node_pgno(node), &mp, mp->mp_txnid);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+#if MDBX_LOCKING == MDBX_LOCKING_SYSV
+  env->me_sysv_ipc.key = ftok(env_pathname.dxb, 42);
+  if (env->me_sysv_ipc.key == -1) {
+    rc = errno;
+    goto bailout;
+  }
+#endif /* MDBX_LOCKING */
 
-  mc->mc_ki[mc->mc_top] = 0;
-  if (unlikely(rc = cursor_push(mc, mp)))
-    return rc;
-  return page_search_root(mc, NULL, MDBX_PS_FIRST);
-}
+  /* Set the position in files outside of the data to avoid corruption
+   * due to erroneous use of file descriptors in the application code. */
+  const uint64_t safe_parking_lot_offset = UINT64_C(0x7fffFFFF80000000);
+  osal_fseek(env->me_lazy_fd, safe_parking_lot_offset);
 
-/* Search for the page a given key should be in.
- * Push it and its parent pages on the cursor stack.
- *
- * [in,out] mc  the cursor for this operation.
- * [in] key     the key to search for, or NULL for first/last page.
- * [in] flags   If MDBX_PS_MODIFY is set, visited pages in the DB
- *              are touched (updated with new page numbers).
- *              If MDBX_PS_FIRST or MDBX_PS_LAST is set, find first or last
- * leaf.
- *              This is used by mdbx_cursor_first() and mdbx_cursor_last().
- *              If MDBX_PS_ROOTONLY set, just fetch root node, no further
- *              lookups.
- *
- * Returns 0 on success, non-zero on failure. */
-__hot static int page_search(MDBX_cursor *mc, const MDBX_val *key, int flags) {
-  int rc;
-  pgno_t root;
+  env->me_fd4meta = env->me_lazy_fd;
+#if defined(_WIN32) || defined(_WIN64)
+  eASSERT(env, env->me_overlapped_fd == 0);
+  bool ior_direct = false;
+  if (!(flags &
+        (MDBX_RDONLY | MDBX_SAFE_NOSYNC | MDBX_NOMETASYNC | MDBX_EXCLUSIVE))) {
+    if (MDBX_AVOID_MSYNC && (flags & MDBX_WRITEMAP)) {
+      /* Запрошен режим MDBX_SAFE_NOSYNC | MDBX_WRITEMAP при активной опции
+       * MDBX_AVOID_MSYNC.
+       *
+       * 1) В этой комбинации наиболее выгодно использовать WriteFileGather(),
+       * но для этого необходимо открыть файл с флагом FILE_FLAG_NO_BUFFERING и
+       * после обеспечивать выравнивание адресов и размера данных на границу
+       * системной страницы, что в свою очередь возможно если размер страницы БД
+       * не меньше размера системной страницы ОЗУ. Поэтому для открытия файла в
+       * нужном режиме требуется знать размер страницы БД.
+       *
+       * 2) Кроме этого, в Windows запись в заблокированный регион файла
+       * возможно только через тот-же дескриптор. Поэтому изначальный захват
+       * блокировок посредством osal_lck_seize(), захват/освобождение блокировок
+       * во время пишущих транзакций и запись данных должны выполнятся через
+       * один дескриптор.
+       *
+       * Таким образом, требуется прочитать волатильный заголовок БД, чтобы
+       * узнать размер страницы, чтобы открыть дескриптор файла в режиме нужном
+       * для записи данных, чтобы использовать именно этот дескриптор для
+       * изначального захвата блокировок. */
+      MDBX_meta header;
+      uint64_t dxb_filesize;
+      int err = read_header(env, &header, MDBX_SUCCESS, true);
+      if ((err == MDBX_SUCCESS && header.mm_psize >= env->me_os_psize) ||
+          (err == MDBX_ENODATA && mode && env->me_psize >= env->me_os_psize &&
+           osal_filesize(env->me_lazy_fd, &dxb_filesize) == MDBX_SUCCESS &&
+           dxb_filesize == 0))
+        /* Может быть коллизия, если два процесса пытаются одновременно создать
+         * БД с разным размером страницы, который у одного меньше системной
+         * страницы, а у другого НЕ меньше. Эта допустимая, но очень странная
+         * ситуация. Поэтому считаем её ошибочной и не пытаемся разрешить. */
+        ior_direct = true;
+    }
 
-  /* Make sure the txn is still viable, then find the root from
-   * the txn's db table and set it as the root of the cursor's stack. */
-  if (unlikely(mc->mc_txn->mt_flags & MDBX_TXN_BLOCKED)) {
-    DEBUG("%s", "transaction has failed, must abort");
-    return MDBX_BAD_TXN;
+    rc = osal_openfile(ior_direct ? MDBX_OPEN_DXB_OVERLAPPED_DIRECT
+                                  : MDBX_OPEN_DXB_OVERLAPPED,
+                       env, env_pathname.dxb, &env->me_overlapped_fd, 0);
+    if (rc != MDBX_SUCCESS)
+      goto bailout;
+    env->me_data_lock_event = CreateEventW(nullptr, true, false, nullptr);
+    if (!env->me_data_lock_event) {
+      rc = (int)GetLastError();
+      goto bailout;
+    }
+    osal_fseek(env->me_overlapped_fd, safe_parking_lot_offset);
   }
-
-  /* Make sure we're using an up-to-date root */
-  if (unlikely(*mc->mc_dbistate & DBI_STALE)) {
-    rc = fetch_sdb(mc->mc_txn, mc->mc_dbi);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
+#else
+  if (mode == 0) {
+    /* pickup mode for lck-file */
+    struct stat st;
+    if (fstat(env->me_lazy_fd, &st)) {
+      rc = errno;
+      goto bailout;
+    }
+    mode = st.st_mode;
+  }
+  mode = (/* inherit read permissions for group and others */ mode &
+          (S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) |
+         /* always add read/write for owner */ S_IRUSR | S_IWUSR |
+         ((mode & S_IRGRP) ? /* +write if readable by group */ S_IWGRP : 0) |
+         ((mode & S_IROTH) ? /* +write if readable by others */ S_IWOTH : 0);
+#endif /* !Windows */
+  const int lck_rc = setup_lck(env, env_pathname.lck, mode);
+  if (MDBX_IS_ERROR(lck_rc)) {
+    rc = lck_rc;
+    goto bailout;
   }
-  root = mc->mc_db->md_root;
 
-  if (unlikely(root == P_INVALID)) { /* Tree is empty. */
-    DEBUG("%s", "tree is empty");
-    return MDBX_NOTFOUND;
+  env->me_vlog.mode = mode;
+  env->me_vlog.pathname = vlog_pathname(env_pathname.dxb);
+  if (unlikely(!env->me_vlog.pathname)) {
+    rc = MDBX_ENOMEM;
+    goto bailout;
   }
+  osal_fseek(env->me_lfd, safe_parking_lot_offset);
 
-  cASSERT(mc, root >= NUM_METAS);
-  if (!mc->mc_snum || !(mc->mc_flags & C_INITIALIZED) ||
-      mc->mc_pg[0]->mp_pgno != root) {
-    txnid_t pp_txnid = mc->mc_db->md_mod_txnid;
-    pp_txnid = /* mc->mc_db->md_mod_txnid maybe zero in a legacy DB */ pp_txnid
-                   ? pp_txnid
-                   : mc->mc_txn->mt_txnid;
-    if ((mc->mc_txn->mt_flags & MDBX_TXN_RDONLY) == 0) {
-      MDBX_txn *scan = mc->mc_txn;
-      do
-        if ((scan->mt_flags & MDBX_TXN_DIRTY) &&
-            (mc->mc_dbi == MAIN_DBI ||
-             (scan->mt_dbistate[mc->mc_dbi] & DBI_DIRTY))) {
-          /* После коммита вложенных тразакций может быть mod_txnid > front */
-          pp_txnid = scan->mt_front;
-          break;
-        }
-      while (unlikely((scan = scan->mt_parent) != nullptr));
+  eASSERT(env, env->me_dsync_fd == INVALID_HANDLE_VALUE);
+  if (!(flags & (MDBX_RDONLY | MDBX_SAFE_NOSYNC | MDBX_DEPRECATED_MAPASYNC
+#if defined(_WIN32) || defined(_WIN64)
+                 | MDBX_EXCLUSIVE
+#endif /* !Windows */
+                 ))) {
+    rc = osal_openfile(MDBX_OPEN_DXB_DSYNC, env, env_pathname.dxb,
+                       &env->me_dsync_fd, 0);
+    if (MDBX_IS_ERROR(rc))
+      goto bailout;
+    if (env->me_dsync_fd != INVALID_HANDLE_VALUE) {
+      if ((flags & MDBX_NOMETASYNC) == 0)
+        env->me_fd4meta = env->me_dsync_fd;
+      osal_fseek(env->me_dsync_fd, safe_parking_lot_offset);
     }
-    if (unlikely((rc = page_get(mc, root, &mc->mc_pg[0], pp_txnid)) != 0))
-      return rc;
   }
 
-  mc->mc_snum = 1;
-  mc->mc_top = 0;
+  const MDBX_env_flags_t lazy_flags =
+      MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC | MDBX_NOMETASYNC;
+  const MDBX_env_flags_t mode_flags = lazy_flags | MDBX_LIFORECLAIM |
+                                      MDBX_NORDAHEAD | MDBX_RDONLY |
+                                      MDBX_WRITEMAP;
 
-  DEBUG("db %d root page %" PRIaPGNO " has flags 0x%X", DDBI(mc), root,
-        mc->mc_pg[0]->mp_flags);
+  MDBX_lockinfo *const lck = env->me_lck_mmap.lck;
+  if (lck && lck_rc != MDBX_RESULT_TRUE && (env->me_flags & MDBX_RDONLY) == 0) {
+    MDBX_env_flags_t snap_flags;
+    while ((snap_flags = atomic_load32(&lck->mti_envmode, mo_AcquireRelease)) ==
+           MDBX_RDONLY) {
+      if (atomic_cas32(&lck->mti_envmode, MDBX_RDONLY,
+                       (snap_flags = (env->me_flags & mode_flags)))) {
+        /* The case:
+         *  - let's assume that for some reason the DB file is smaller
+         *    than it should be according to the geometry,
+         *    but not smaller than the last page used;
+         *  - the first process that opens the database (lck_rc == RESULT_TRUE)
+         *    does this in readonly mode and therefore cannot bring
+         *    the file size back to normal;
+         *  - some next process (lck_rc != RESULT_TRUE) opens the DB in
+         *    read-write mode and now is here.
+         *
+         * FIXME: Should we re-check and set the size of DB-file right here? */
+        break;
+      }
+      atomic_yield();
+    }
 
-  if (flags & MDBX_PS_MODIFY) {
-    if (unlikely(rc = page_touch(mc)))
-      return rc;
+    if (env->me_flags & MDBX_ACCEDE) {
+      /* Pickup current mode-flags (MDBX_LIFORECLAIM, MDBX_NORDAHEAD, etc). */
+      const MDBX_env_flags_t diff =
+          (snap_flags ^ env->me_flags) &
+          ((snap_flags & lazy_flags) ? mode_flags
+                                     : mode_flags & ~MDBX_WRITEMAP);
+      env->me_flags ^= diff;
+      NOTICE("accede mode-flags: 0x%X, 0x%X -> 0x%X", diff,
+             env->me_flags ^ diff, env->me_flags);
+    }
+
+    /* Ранее упущенный не очевидный момент: При работе БД в режимах
+     * не-синхронной/отложенной фиксации на диске, все процессы-писатели должны
+     * иметь одинаковый режим MDBX_WRITEMAP.
+     *
+     * В противном случае, сброс на диск следует выполнять дважды: сначала
+     * msync(), затем fdatasync(). При этом msync() не обязан отрабатывать
+     * в процессах без MDBX_WRITEMAP, так как файл в память отображен только
+     * для чтения. Поэтому, в общем случае, различия по MDBX_WRITEMAP не
+     * позволяют выполнить фиксацию данных на диск, после их изменения в другом
+     * процессе.
+     *
+     * В режиме MDBX_UTTERLY_NOSYNC позволять совместную работу с MDBX_WRITEMAP
+     * также не следует, поскольку никакой процесс (в том числе последний) не
+     * может гарантированно сбросить данные на диск, а следовательно не должен
+     * помечать какую-либо транзакцию как steady.
+     *
+     * В результате, требуется либо запретить совместную работу процессам с
+     * разным MDBX_WRITEMAP в режиме отложенной записи, либо отслеживать такое
+     * смешивание и блокировать steady-пометки - что контрпродуктивно. */
+    const MDBX_env_flags_t rigorous_flags =
+        (snap_flags & lazy_flags)
+            ? MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC | MDBX_WRITEMAP
+            : MDBX_SAFE_NOSYNC | MDBX_UTTERLY_NOSYNC;
+    const MDBX_env_flags_t rigorous_diff =
+        (snap_flags ^ env->me_flags) & rigorous_flags;
+    if (rigorous_diff) {
+      ERROR("current mode/flags 0x%X incompatible with requested 0x%X, "
+            "rigorous diff 0x%X",
+            env->me_flags, snap_flags, rigorous_diff);
+      rc = MDBX_INCOMPATIBLE;
+      goto bailout;
+    }
   }
 
-  if (flags & MDBX_PS_ROOTONLY)
-    return MDBX_SUCCESS;
+  mincore_clean_cache(env);
+  const int dxb_rc = setup_dxb(env, lck_rc, mode);
+  if (MDBX_IS_ERROR(dxb_rc)) {
+    rc = dxb_rc;
+    goto bailout;
+  }
 
-  return page_search_root(mc, key, flags);
-}
+  rc = osal_check_fs_incore(env->me_lazy_fd);
+  env->me_incore = false;
+  if (rc == MDBX_RESULT_TRUE) {
+    env->me_incore = true;
+    NOTICE("%s", "in-core database");
+  } else if (unlikely(rc != MDBX_SUCCESS)) {
+    ERROR("check_fs_incore(), err %d", rc);
+    goto bailout;
+  }
 
-/* Read large/overflow node data. */
-static __noinline int node_read_bigdata(MDBX_cursor *mc, const MDBX_node *node,
-                                        MDBX_val *data, const MDBX_page *mp) {
-  cASSERT(mc, node_flags(node) == F_BIGDATA && data->iov_len == node_ds(node));
+  if (unlikely(/* recovery mode */ env->me_stuck_meta >= 0) &&
+      (lck_rc != /* exclusive */ MDBX_RESULT_TRUE ||
+       (flags & MDBX_EXCLUSIVE) == 0)) {
+    ERROR("%s", "recovery requires exclusive mode");
+    rc = MDBX_BUSY;
+    goto bailout;
+  }
 
-  pgr_t lp = page_get_large(mc, node_largedata_pgno(node), mp->mp_txnid);
-  if (unlikely((lp.err != MDBX_SUCCESS))) {
-    DEBUG("read large/overflow page %" PRIaPGNO " failed",
-          node_largedata_pgno(node));
-    return lp.err;
+  DEBUG("opened dbenv %p", (void *)env);
+  if (!lck || lck_rc == MDBX_RESULT_TRUE) {
+    env->me_lck->mti_envmode.weak = env->me_flags & mode_flags;
+    env->me_lck->mti_meta_sync_txnid.weak =
+        (uint32_t)recent_committed_txnid(env);
+    env->me_lck->mti_reader_check_timestamp.weak = osal_monotime();
   }
+  if (lck) {
+    if (lck_rc == MDBX_RESULT_TRUE) {
+      rc = osal_lck_downgrade(env);
+      DEBUG("lck-downgrade-%s: rc %i",
+            (env->me_flags & MDBX_EXCLUSIVE) ? "partial" : "full", rc);
+      if (rc != MDBX_SUCCESS)
+        goto bailout;
+    } else {
+      rc = cleanup_dead_readers(env, false, NULL);
+      if (MDBX_IS_ERROR(rc))
+        goto bailout;
+    }
 
-  cASSERT(mc, PAGETYPE_WHOLE(lp.page) == P_OVERFLOW);
-  data->iov_base = page_data(lp.page);
-  if (!MDBX_DISABLE_VALIDATION) {
-    const MDBX_env *env = mc->mc_txn->mt_env;
-    const size_t dsize = data->iov_len;
-    if (unlikely(node_size_len(node_ks(node), dsize) <= env->me_leaf_nodemax) &&
-        mc->mc_dbi != FREE_DBI)
-      poor_page(mp, "too small data (%zu bytes) for bigdata-node", dsize);
-    const unsigned npages = number_of_ovpages(env, dsize);
-    if (unlikely(lp.page->mp_pages != npages)) {
-      if (lp.page->mp_pages < npages)
-        return bad_page(lp.page,
-                        "too less n-pages %u for bigdata-node (%zu bytes)",
-                        lp.page->mp_pages, dsize);
-      else if (mc->mc_dbi != FREE_DBI)
-        poor_page(lp.page, "extra n-pages %u for bigdata-node (%zu bytes)",
-                  lp.page->mp_pages, dsize);
+    if ((env->me_flags & MDBX_NOTLS) == 0) {
+      rc = rthc_alloc(&env->me_txkey, &lck->mti_readers[0],
+                      &lck->mti_readers[env->me_maxreaders], env->me_rshards);
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto bailout;
+      env->me_flags |= MDBX_ENV_TXKEY;
     }
   }
-  return MDBX_SUCCESS;
-}
-
-/* Return the data associated with a given node. */
-static __always_inline int node_read(MDBX_cursor *mc, const MDBX_node *node,
-                                     MDBX_val *data, const MDBX_page *mp) {
-  data->iov_len = node_ds(node);
-  data->iov_base = node_data(node);
-  if (likely(node_flags(node) != F_BIGDATA))
-    return MDBX_SUCCESS;
-  return node_read_bigdata(mc, node, data, mp);
-}
 
-int mdbx_get(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key, MDBX_val *data) {
-  DKBUF_DEBUG;
-  DEBUG("===> get db %u key [%s]", dbi, DKEY_DEBUG(key));
+  if ((flags & MDBX_RDONLY) == 0) {
+    const size_t tsize = sizeof(MDBX_txn) + sizeof(MDBX_cursor),
+                 size = tsize + env->me_maxdbs *
+                                    (sizeof(MDBX_db) + sizeof(MDBX_cursor *) +
+                                     sizeof(MDBX_atomic_uint32_t) + 1);
+    rc = alloc_page_buf(env);
+    if (rc == MDBX_SUCCESS) {
+      memset(env->me_pbuf, -1, env->me_psize * (size_t)2);
+      memset(ptr_disp(env->me_pbuf, env->me_psize * (size_t)2), 0,
+             env->me_psize);
+      MDBX_txn *txn = osal_calloc(1, size);
+      if (txn) {
+        txn->mt_dbs = ptr_disp(txn, tsize);
+        txn->mt_cursors =
+            ptr_disp(txn->mt_dbs, sizeof(MDBX_db) * env->me_maxdbs);
+        txn->mt_dbiseqs =
+            ptr_disp(txn->mt_cursors, sizeof(MDBX_cursor *) * env->me_maxdbs);
+        txn->mt_dbistate = ptr_disp(
+            txn->mt_dbiseqs, sizeof(MDBX_atomic_uint32_t) * env->me_maxdbs);
+        txn->mt_env = env;
+        txn->mt_dbxs = env->me_dbxs;
+        txn->mt_flags = MDBX_TXN_FINISHED;
+        env->me_txn0 = txn;
+        txn->tw.retired_pages = pnl_alloc(MDBX_PNL_INITIAL);
+        txn->tw.relist = pnl_alloc(MDBX_PNL_INITIAL);
+        if (unlikely(!txn->tw.retired_pages || !txn->tw.relist))
+          rc = MDBX_ENOMEM;
+      } else
+        rc = MDBX_ENOMEM;
+    }
+    if (rc == MDBX_SUCCESS)
+      rc = osal_ioring_create(&env->me_ioring
+#if defined(_WIN32) || defined(_WIN64)
+                              ,
+                              ior_direct, env->me_overlapped_fd
+#endif /* Windows */
+      );
+    if (rc == MDBX_SUCCESS)
+      adjust_defaults(env);
+  }
 
-  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+#if MDBX_DEBUG
+  if (rc == MDBX_SUCCESS) {
+    const meta_troika_t troika = meta_tap(env);
+    const meta_ptr_t head = meta_recent(env, &troika);
+    const MDBX_db *db = &head.ptr_c->mm_dbs[MAIN_DBI];
 
-  if (unlikely(!key || !data))
-    return MDBX_EINVAL;
+    DEBUG("opened database version %u, pagesize %u",
+          (uint8_t)unaligned_peek_u64(4, head.ptr_c->mm_magic_and_version),
+          env->me_psize);
+    DEBUG("using meta page %" PRIaPGNO ", txn %" PRIaTXN,
+          data_page(head.ptr_c)->mp_pgno, head.txnid);
+    DEBUG("depth: %u", db->md_depth);
+    DEBUG("entries: %" PRIu64, db->md_entries);
+    DEBUG("branch pages: %" PRIaPGNO, db->md_branch_pages);
+    DEBUG("leaf pages: %" PRIaPGNO, db->md_leaf_pages);
+    DEBUG("large/overflow pages: %" PRIaPGNO, db->md_overflow_pages);
+    DEBUG("root: %" PRIaPGNO, db->md_root);
+    DEBUG("schema_altered: %" PRIaTXN, db->md_mod_txnid);
+  }
+#endif
 
-  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
-    return MDBX_BAD_DBI;
-
-  MDBX_cursor_couple cx;
-  rc = cursor_init(&cx.outer, txn, dbi);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  return cursor_set(&cx.outer, (MDBX_val *)key, data, MDBX_SET).err;
+bailout:
+  if (rc != MDBX_SUCCESS) {
+    rc = env_close(env) ? MDBX_PANIC : rc;
+    env->me_flags =
+        saved_me_flags | ((rc != MDBX_PANIC) ? 0 : MDBX_FATAL_ERROR);
+  } else {
+#if defined(MDBX_USE_VALGRIND) || defined(__SANITIZE_ADDRESS__)
+    txn_valgrind(env, nullptr);
+#endif
+  }
+  osal_free(env_pathname.buffer_for_free);
+  return rc;
 }
 
-int mdbx_get_equal_or_great(MDBX_txn *txn, MDBX_dbi dbi, MDBX_val *key,
-                            MDBX_val *data) {
-  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  if (unlikely(!key || !data))
-    return MDBX_EINVAL;
-
-  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
-    return MDBX_BAD_DBI;
-
-  if (unlikely(txn->mt_flags & MDBX_TXN_BLOCKED))
-    return MDBX_BAD_TXN;
-
-  MDBX_cursor_couple cx;
-  rc = cursor_init(&cx.outer, txn, dbi);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  return cursor_get(&cx.outer, key, data, MDBX_SET_LOWERBOUND);
-}
+/* Destroy resources from mdbx_env_open(), clear our readers & DBIs */
+__cold static int env_close(MDBX_env *env) {
+  const unsigned flags = env->me_flags;
+  if (!(flags & MDBX_ENV_ACTIVE)) {
+    ENSURE(env, env->me_lcklist_next == nullptr);
+    return MDBX_SUCCESS;
+  }
 
-int mdbx_get_ex(MDBX_txn *txn, MDBX_dbi dbi, MDBX_val *key, MDBX_val *data,
-                size_t *values_count) {
-  DKBUF_DEBUG;
-  DEBUG("===> get db %u key [%s]", dbi, DKEY_DEBUG(key));
+#if !(defined(_WIN32) || defined(_WIN64))
+  commit_watch_stop(env);
+#endif /* !Windows */
 
-  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+  env->me_flags &= ~ENV_INTERNAL_FLAGS;
+  if (flags & MDBX_ENV_TXKEY) {
+    rthc_remove(env->me_txkey);
+    env->me_txkey = (osal_thread_key_t)0;
+  }
 
-  if (unlikely(!key || !data))
-    return MDBX_EINVAL;
+  munlock_all(env);
+  if (!(env->me_flags & MDBX_RDONLY))
+    osal_ioring_destroy(&env->me_ioring);
 
-  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
-    return MDBX_BAD_DBI;
+  lcklist_lock();
+  const int rc = lcklist_detach_locked(env);
+  lcklist_unlock();
 
-  MDBX_cursor_couple cx;
-  rc = cursor_init(&cx.outer, txn, dbi);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+  env->me_lck = nullptr;
+  env->me_rshards = nullptr;
+  if (env->me_lck_mmap.lck)
+    osal_munmap(&env->me_lck_mmap);
 
-  rc = cursor_set(&cx.outer, key, data, MDBX_SET_KEY).err;
-  if (unlikely(rc != MDBX_SUCCESS)) {
-    if (rc == MDBX_NOTFOUND && values_count)
-      *values_count = 0;
-    return rc;
+  if (env->me_map) {
+    osal_munmap(&env->me_dxb_mmap);
+#ifdef MDBX_USE_VALGRIND
+    VALGRIND_DISCARD(env->me_valgrind_handle);
+    env->me_valgrind_handle = -1;
+#endif
   }
 
-  if (values_count) {
-    *values_count = 1;
-    if (cx.outer.mc_xcursor != NULL) {
-      MDBX_node *node = page_node(cx.outer.mc_pg[cx.outer.mc_top],
-                                  cx.outer.mc_ki[cx.outer.mc_top]);
-      if (node_flags(node) & F_DUPDATA) {
-        // coverity[uninit_use : FALSE]
-        tASSERT(txn, cx.outer.mc_xcursor == &cx.inner &&
-                         (cx.inner.mx_cursor.mc_flags & C_INITIALIZED));
-        // coverity[uninit_use : FALSE]
-        *values_count =
-            (sizeof(*values_count) >= sizeof(cx.inner.mx_db.md_entries) ||
-             cx.inner.mx_db.md_entries <= PTRDIFF_MAX)
-                ? (size_t)cx.inner.mx_db.md_entries
-                : PTRDIFF_MAX;
-      }
-    }
+#if defined(_WIN32) || defined(_WIN64)
+  eASSERT(env, !env->me_overlapped_fd ||
+                   env->me_overlapped_fd == INVALID_HANDLE_VALUE);
+  if (env->me_data_lock_event != INVALID_HANDLE_VALUE) {
+    CloseHandle(env->me_data_lock_event);
+    env->me_data_lock_event = INVALID_HANDLE_VALUE;
   }
-  return MDBX_SUCCESS;
-}
+#endif /* Windows */
 
-/* Find a sibling for a page.
- * Replaces the page at the top of the cursor's stack with the specified
- * sibling, if one exists.
- *
- * [in] mc    The cursor for this operation.
- * [in] dir   SIBLING_LEFT or SIBLING_RIGHT.
- *
- * Returns 0 on success, non-zero on failure. */
-static int cursor_sibling(MDBX_cursor *mc, int dir) {
-  int rc;
-  MDBX_node *node;
-  MDBX_page *mp;
-  assert(dir == SIBLING_LEFT || dir == SIBLING_RIGHT);
+  if (env->me_dsync_fd != INVALID_HANDLE_VALUE) {
+    (void)osal_closefile(env->me_dsync_fd);
+    env->me_dsync_fd = INVALID_HANDLE_VALUE;
+  }
 
-  if (unlikely(mc->mc_snum < 2))
-    return MDBX_NOTFOUND; /* root has no siblings */
+  if (env->me_lazy_fd != INVALID_HANDLE_VALUE) {
+    (void)osal_closefile(env->me_lazy_fd);
+    env->me_lazy_fd = INVALID_HANDLE_VALUE;
+  }
 
-  cursor_pop(mc);
-  DEBUG("parent page is page %" PRIaPGNO ", index %u",
-        mc->mc_pg[mc->mc_top]->mp_pgno, mc->mc_ki[mc->mc_top]);
+  if (env->me_lfd != INVALID_HANDLE_VALUE) {
+    (void)osal_closefile(env->me_lfd);
+    env->me_lfd = INVALID_HANDLE_VALUE;
+  }
 
-  if ((dir == SIBLING_RIGHT) ? (mc->mc_ki[mc->mc_top] + (size_t)1 >=
-                                page_numkeys(mc->mc_pg[mc->mc_top]))
-                             : (mc->mc_ki[mc->mc_top] == 0)) {
-    DEBUG("no more keys aside, moving to next %s sibling",
-          dir ? "right" : "left");
-    if (unlikely((rc = cursor_sibling(mc, dir)) != MDBX_SUCCESS)) {
-      /* undo cursor_pop before returning */
-      mc->mc_top++;
-      mc->mc_snum++;
-      return rc;
-    }
-  } else {
-    assert((dir - 1) == -1 || (dir - 1) == 1);
-    mc->mc_ki[mc->mc_top] += (indx_t)(dir - 1);
-    DEBUG("just moving to %s index key %u",
-          (dir == SIBLING_RIGHT) ? "right" : "left", mc->mc_ki[mc->mc_top]);
+  if (env->me_vlog.fd != INVALID_HANDLE_VALUE) {
+    (void)osal_closefile(env->me_vlog.fd);
+    env->me_vlog.fd = INVALID_HANDLE_VALUE;
   }
-  cASSERT(mc, IS_BRANCH(mc->mc_pg[mc->mc_top]));
+  if (env->me_vlog.pathname) {
+    osal_free(env->me_vlog.pathname);
+    env->me_vlog.pathname = nullptr;
+  }
+  env->me_vlog.dbi = 0;
 
-  node = page_node(mp = mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
-  rc = page_get(mc, node_pgno(node), &mp, mp->mp_txnid);
-  if (unlikely(rc != MDBX_SUCCESS)) {
-    /* mc will be inconsistent if caller does mc_snum++ as above */
-    mc->mc_flags &= ~(C_INITIALIZED | C_EOF);
-    return rc;
+  if (env->me_dbxs) {
+    for (size_t i = CORE_DBS; i < env->me_numdbs; ++i)
+      if (env->me_dbxs[i].md_name.iov_len)
+        osal_free(env->me_dbxs[i].md_name.iov_base);
+    for (size_t i = 0; i < env->me_maxdbs; ++i)
+      if (env->me_dbxs[i].md_split_hints)
+        osal_free(env->me_dbxs[i].md_split_hints);
+    osal_free(env->me_dbxs);
+    env->me_numdbs = CORE_DBS;
+    env->me_dbxs = nullptr;
+  }
+  if (env->me_pbuf) {
+    osal_memalign_free(env->me_pbuf);
+    env->me_pbuf = nullptr;
+  }
+  if (env->me_dbiseqs) {
+    osal_free(env->me_dbiseqs);
+    env->me_dbiseqs = nullptr;
+  }
+  if (env->me_dbflags) {
+    osal_free(env->me_dbflags);
+    env->me_dbflags = nullptr;
+  }
+  if (env->me_pathname) {
+    osal_free(env->me_pathname);
+    env->me_pathname = nullptr;
+  }
+#if defined(_WIN32) || defined(_WIN64)
+  if (env->me_pathname_char) {
+    osal_free(env->me_pathname_char);
+    env->me_pathname_char = nullptr;
+  }
+#endif /* Windows */
+  if (env->me_txn0) {
+    dpl_free(env->me_txn0);
+    txl_free(env->me_txn0->tw.lifo_reclaimed);
+    pnl_free(env->me_txn0->tw.retired_pages);
+    pnl_free(env->me_txn0->tw.spilled.list);
+    pnl_free(env->me_txn0->tw.relist);
+    osal_free(env->me_txn0);
+    env->me_txn0 = nullptr;
   }
+  env->me_stuck_meta = -1;
+  return rc;
+}
 
-  rc = cursor_push(mc, mp);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+__cold int mdbx_env_close_ex(MDBX_env *env, bool dont_sync) {
+  MDBX_page *dp;
+  int rc = MDBX_SUCCESS;
 
-  mc->mc_ki[mc->mc_top] =
-      (dir == SIBLING_LEFT) ? (indx_t)page_numkeys(mp) - 1 : 0;
-  return MDBX_SUCCESS;
-}
+  if (unlikely(!env))
+    return MDBX_EINVAL;
 
-/* Move the cursor to the next data item. */
-static int cursor_next(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
-                       MDBX_cursor_op op) {
-  MDBX_page *mp;
-  MDBX_node *node;
-  int rc;
+  if (unlikely(env->me_signature.weak != MDBX_ME_SIGNATURE))
+    return MDBX_EBADSIGN;
 
-  if (unlikely(mc->mc_flags & C_DEL) && op == MDBX_NEXT_DUP)
-    return MDBX_NOTFOUND;
+#if MDBX_ENV_CHECKPID || !(defined(_WIN32) || defined(_WIN64))
+  /* Check the PID even if MDBX_ENV_CHECKPID=0 on non-Windows
+   * platforms (i.e. where fork() is available).
+   * This is required to legitimize a call after fork()
+   * from a child process, that should be allowed to free resources. */
+  if (unlikely(env->me_pid != osal_getpid()))
+    env->me_flags |= MDBX_FATAL_ERROR;
+#endif /* MDBX_ENV_CHECKPID */
 
-  if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
-    return cursor_first(mc, key, data);
+  if (env->me_map && (env->me_flags & (MDBX_RDONLY | MDBX_FATAL_ERROR)) == 0 &&
+      env->me_txn0) {
+    if (env->me_txn0->mt_owner && env->me_txn0->mt_owner != osal_thread_self())
+      return MDBX_BUSY;
+  } else
+    dont_sync = true;
 
-  mp = mc->mc_pg[mc->mc_top];
-  if (unlikely(mc->mc_flags & C_EOF)) {
-    if (mc->mc_ki[mc->mc_top] + (size_t)1 >= page_numkeys(mp))
-      return MDBX_NOTFOUND;
-    mc->mc_flags ^= C_EOF;
-  }
+  if (!atomic_cas32(&env->me_signature, MDBX_ME_SIGNATURE, 0))
+    return MDBX_EBADSIGN;
 
-  if (mc->mc_db->md_flags & MDBX_DUPSORT) {
-    node = page_node(mp, mc->mc_ki[mc->mc_top]);
-    if (node_flags(node) & F_DUPDATA) {
-      if (op == MDBX_NEXT || op == MDBX_NEXT_DUP) {
-        rc = cursor_next(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_NEXT);
-        if (op != MDBX_NEXT || rc != MDBX_NOTFOUND) {
-          if (likely(rc == MDBX_SUCCESS))
-            get_key_optional(node, key);
-          return rc;
-        }
-      }
-    } else {
-      mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
-      if (op == MDBX_NEXT_DUP)
-        return MDBX_NOTFOUND;
-    }
-  }
-
-  DEBUG("cursor_next: top page is %" PRIaPGNO " in cursor %p", mp->mp_pgno,
-        (void *)mc);
-  if (mc->mc_flags & C_DEL) {
-    mc->mc_flags ^= C_DEL;
-    goto skip;
-  }
-
-  intptr_t ki = mc->mc_ki[mc->mc_top];
-  mc->mc_ki[mc->mc_top] = (indx_t)++ki;
-  const intptr_t numkeys = page_numkeys(mp);
-  if (unlikely(ki >= numkeys)) {
-    DEBUG("%s", "=====> move to next sibling page");
-    mc->mc_ki[mc->mc_top] = (indx_t)(numkeys - 1);
-    rc = cursor_sibling(mc, SIBLING_RIGHT);
-    if (unlikely(rc != MDBX_SUCCESS)) {
-      mc->mc_flags |= C_EOF;
-      return rc;
+  if (!dont_sync) {
+#if defined(_WIN32) || defined(_WIN64)
+    /* On windows, without blocking is impossible to determine whether another
+     * process is running a writing transaction or not.
+     * Because in the "owner died" condition kernel don't release
+     * file lock immediately. */
+    rc = env_sync(env, true, false);
+    rc = (rc == MDBX_RESULT_TRUE) ? MDBX_SUCCESS : rc;
+#else
+    struct stat st;
+    if (unlikely(fstat(env->me_lazy_fd, &st)))
+      rc = errno;
+    else if (st.st_nlink > 0 /* don't sync deleted files */) {
+      rc = env_sync(env, true, true);
+      rc = (rc == MDBX_BUSY || rc == EAGAIN || rc == EACCES || rc == EBUSY ||
+            rc == EWOULDBLOCK || rc == MDBX_RESULT_TRUE)
+               ? MDBX_SUCCESS
+               : rc;
     }
-    mp = mc->mc_pg[mc->mc_top];
-    DEBUG("next page is %" PRIaPGNO ", key index %u", mp->mp_pgno,
-          mc->mc_ki[mc->mc_top]);
+#endif /* Windows */
   }
 
-skip:
-  DEBUG("==> cursor points to page %" PRIaPGNO " with %zu keys, key index %u",
-        mp->mp_pgno, page_numkeys(mp), mc->mc_ki[mc->mc_top]);
-
-  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-          mp->mp_pgno, mp->mp_flags);
-    return MDBX_CORRUPTED;
-  }
+  eASSERT(env, env->me_signature.weak == 0);
+  rc = env_close(env) ? MDBX_PANIC : rc;
+  ENSURE(env, osal_fastmutex_destroy(&env->me_dbi_lock) == MDBX_SUCCESS);
+  ENSURE(env,
+         osal_fastmutex_destroy(&env->me_disjoint.lock) == MDBX_SUCCESS);
+  ENSURE(env, osal_fastmutex_destroy(&env->me_vlog.lock) == MDBX_SUCCESS);
+#if defined(_WIN32) || defined(_WIN64)
+  /* me_remap_guard don't have destructor (Slim Reader/Writer Lock) */
+  DeleteCriticalSection(&env->me_windowsbug_lock);
+#else
+  ENSURE(env, osal_fastmutex_destroy(&env->me_remap_guard) == MDBX_SUCCESS);
+#endif /* Windows */
 
-  if (IS_LEAF2(mp)) {
-    if (likely(key)) {
-      key->iov_len = mc->mc_db->md_xsize;
-      key->iov_base = page_leaf2key(mp, mc->mc_ki[mc->mc_top], key->iov_len);
-    }
-    return MDBX_SUCCESS;
-  }
+#if MDBX_LOCKING > MDBX_LOCKING_SYSV
+  MDBX_lockinfo *const stub = lckless_stub(env);
+  ENSURE(env, osal_ipclock_destroy(&stub->mti_wlock) == 0);
+#endif /* MDBX_LOCKING */
 
-  node = page_node(mp, mc->mc_ki[mc->mc_top]);
-  if (node_flags(node) & F_DUPDATA) {
-    rc = cursor_xinit1(mc, node, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    rc = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-  } else if (likely(data)) {
-    rc = node_read(mc, node, data, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
+  while ((dp = env->me_dp_reserve) != NULL) {
+    MDBX_ASAN_UNPOISON_MEMORY_REGION(dp, env->me_psize);
+    VALGRIND_MAKE_MEM_DEFINED(&mp_next(dp), sizeof(MDBX_page *));
+    env->me_dp_reserve = mp_next(dp);
+    void *const ptr = ptr_disp(dp, -(ptrdiff_t)sizeof(size_t));
+    osal_free(ptr);
   }
+  VALGRIND_DESTROY_MEMPOOL(env);
+  ENSURE(env, env->me_lcklist_next == nullptr);
+  env->me_pid = 0;
+  osal_free(env);
 
-  get_key_optional(node, key);
-  return MDBX_SUCCESS;
+  return rc;
 }
 
-/* Move the cursor to the previous data item. */
-static int cursor_prev(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
-                       MDBX_cursor_op op) {
-  MDBX_page *mp;
-  MDBX_node *node;
-  int rc;
+#ifndef LIBMDBX_NO_EXPORTS_LEGACY_API
+__cold int mdbx_env_close(MDBX_env *env) {
+  return __inline_mdbx_env_close(env);
+}
+#endif /* LIBMDBX_NO_EXPORTS_LEGACY_API */
 
-  if (unlikely(mc->mc_flags & C_DEL) && op == MDBX_PREV_DUP)
-    return MDBX_NOTFOUND;
+/* Оценивает позицию целочисленного ключа на странице линейной интерполяцией
+ * между ключами в позициях low и high. Для плотных последовательностей
+ * (например, идентификаторов строк 0..N) оценка сразу дает точную позицию,
+ * т.е. поиск превращается в вычисление индекса на каждом уровне дерева. */
+static __always_inline intptr_t int_key_guess(const MDBX_val *key,
+                                              const MDBX_val *first,
+                                              const MDBX_val *last,
+                                              intptr_t low, intptr_t high) {
+  if (unlikely(first->iov_len != key->iov_len ||
+               last->iov_len != key->iov_len))
+    return (low + high) >> 1;
+  uint64_t k, a, b;
+  if (key->iov_len == 8) {
+    k = unaligned_peek_u64(1, key->iov_base);
+    a = unaligned_peek_u64(1, first->iov_base);
+    b = unaligned_peek_u64(1, last->iov_base);
+  } else if (likely(key->iov_len == 4)) {
+    k = unaligned_peek_u32(1, key->iov_base);
+    a = unaligned_peek_u32(1, first->iov_base);
+    b = unaligned_peek_u32(1, last->iov_base);
+  } else
+    return (low + high) >> 1;
 
-  if (unlikely(!(mc->mc_flags & C_INITIALIZED))) {
-    rc = cursor_last(mc, key, data);
-    if (unlikely(rc))
-      return rc;
-    mc->mc_ki[mc->mc_top]++;
-  }
+  if (k <= a)
+    return low;
+  if (k >= b)
+    return high;
+  const uint64_t n = high - low, span = b - a, offset = k - a;
+  const uint64_t step = likely(offset <= UINT64_MAX / n) ? offset * n / span
+                                                         : offset / (span / n);
+  return low + (intptr_t)((step < n) ? step : n);
+}
 
-  mp = mc->mc_pg[mc->mc_top];
-  if ((mc->mc_db->md_flags & MDBX_DUPSORT) &&
-      mc->mc_ki[mc->mc_top] < page_numkeys(mp)) {
-    node = page_node(mp, mc->mc_ki[mc->mc_top]);
-    if (node_flags(node) & F_DUPDATA) {
-      if (op == MDBX_PREV || op == MDBX_PREV_DUP) {
-        rc = cursor_prev(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_PREV);
-        if (op != MDBX_PREV || rc != MDBX_NOTFOUND) {
-          if (likely(rc == MDBX_SUCCESS)) {
-            get_key_optional(node, key);
-            mc->mc_flags &= ~C_EOF;
-          }
-          return rc;
-        }
-      }
-    } else {
-      mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
-      if (op == MDBX_PREV_DUP)
-        return MDBX_NOTFOUND;
-    }
-  }
+static __always_inline bool is_cmp_int(MDBX_cmp_func *cmp) {
+  return cmp == cmp_int_align2 || cmp == cmp_int_align4 ||
+         cmp == cmp_int_unaligned;
+}
 
-  DEBUG("cursor_prev: top page is %" PRIaPGNO " in cursor %p", mp->mp_pgno,
-        (void *)mc);
+/* Search for key within a page, using binary search.
+ * For integer keys the first two probes are made at the interpolated position
+ * and next to it, so for dense keys the search takes one or two comparisons.
+ * Returns the smallest entry larger or equal to the key.
+ * Updates the cursor index with the index of the found entry.
+ * If no entry larger or equal to the key is found, returns NULL. */
+__hot static struct node_result node_search(MDBX_cursor *mc,
+                                            const MDBX_val *key) {
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  const intptr_t nkeys = page_numkeys(mp);
+  DKBUF_DEBUG;
 
-  mc->mc_flags &= ~(C_EOF | C_DEL);
+  DEBUG("searching %zu keys in %s %spage %" PRIaPGNO, nkeys,
+        IS_LEAF(mp) ? "leaf" : "branch", IS_SUBP(mp) ? "sub-" : "",
+        mp->mp_pgno);
 
-  int ki = mc->mc_ki[mc->mc_top];
-  mc->mc_ki[mc->mc_top] = (indx_t)--ki;
-  if (unlikely(ki < 0)) {
+  struct node_result ret;
+  ret.exact = false;
+  STATIC_ASSERT(P_BRANCH == 1);
+  intptr_t low = mp->mp_flags & P_BRANCH;
+  intptr_t high = nkeys - 1;
+  if (unlikely(high < low)) {
     mc->mc_ki[mc->mc_top] = 0;
-    DEBUG("%s", "=====> move to prev sibling page");
-    if ((rc = cursor_sibling(mc, SIBLING_LEFT)) != MDBX_SUCCESS)
-      return rc;
-    mp = mc->mc_pg[mc->mc_top];
-    DEBUG("prev page is %" PRIaPGNO ", key index %u", mp->mp_pgno,
-          mc->mc_ki[mc->mc_top]);
-  }
-  DEBUG("==> cursor points to page %" PRIaPGNO " with %zu keys, key index %u",
-        mp->mp_pgno, page_numkeys(mp), mc->mc_ki[mc->mc_top]);
-
-  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-          mp->mp_pgno, mp->mp_flags);
-    return MDBX_CORRUPTED;
+    ret.node = NULL;
+    return ret;
   }
 
-  if (IS_LEAF2(mp)) {
-    if (likely(key)) {
-      key->iov_len = mc->mc_db->md_xsize;
-      key->iov_base = page_leaf2key(mp, mc->mc_ki[mc->mc_top], key->iov_len);
+  intptr_t i, guess = 0, probes = 0;
+  MDBX_cmp_func *cmp = mc->mc_dbx->md_cmp;
+  const bool interpolate = is_cmp_int(cmp) && high - low > 2;
+  MDBX_val nodekey;
+  if (unlikely(IS_LEAF2(mp))) {
+    cASSERT(mc, mp->mp_leaf2_ksize == mc->mc_db->md_xsize ||
+                    ((mc->mc_db->md_flags & MDBX_FIXEDSIZE) &&
+                     mp->mp_leaf2_ksize > mc->mc_db->md_xsize));
+    nodekey.iov_len = mc->mc_db->md_xsize;
+    if (interpolate) {
+      const MDBX_val first = {page_leaf2key(mp, low, nodekey.iov_len),
+                              nodekey.iov_len};
+      const MDBX_val last = {page_leaf2key(mp, high, nodekey.iov_len),
+                             nodekey.iov_len};
+      guess = int_key_guess(key, &first, &last, low, high);
+      probes = 2;
     }
-    return MDBX_SUCCESS;
-  }
-
-  node = page_node(mp, mc->mc_ki[mc->mc_top]);
+    do {
+      i = likely(!probes) ? (low + high) >> 1 : guess;
+      nodekey.iov_base = page_leaf2key(mp, i, nodekey.iov_len);
+      cASSERT(mc, ptr_disp(mp, mc->mc_txn->mt_env->me_psize) >=
+                      ptr_disp(nodekey.iov_base, nodekey.iov_len));
+      int cr = cmp(key, &nodekey);
+      DEBUG("found leaf index %zu [%s], rc = %i", i, DKEY_DEBUG(&nodekey), cr);
+      if (cr > 0)
+        /* Found entry is less than the key. */
+        /* Skip to get the smallest entry larger than key. */
+        low = ++i;
+      else if (cr < 0)
+        high = i - 1;
+      else {
+        ret.exact = true;
+        break;
+      }
+      if (unlikely(probes) && --probes)
+        /* check the neighbour of the interpolated position */
+        guess = (cr > 0) ? low : high;
+    } while (likely(low <= high));
 
-  if (node_flags(node) & F_DUPDATA) {
-    rc = cursor_xinit1(mc, node, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    rc = cursor_last(&mc->mc_xcursor->mx_cursor, data, NULL);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-  } else if (likely(data)) {
-    rc = node_read(mc, node, data, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
+    /* store the key index */
+    mc->mc_ki[mc->mc_top] = (indx_t)i;
+    ret.node = (i < nkeys)
+                   ? /* fake for LEAF2 */ (MDBX_node *)(intptr_t)-1
+                   : /* There is no entry larger or equal to the key. */ NULL;
+    return ret;
   }
 
-  get_key_optional(node, key);
-  return MDBX_SUCCESS;
-}
-
-/* Set the cursor on a specific data item. */
-__hot static struct cursor_set_result
-cursor_set(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data, MDBX_cursor_op op) {
-  MDBX_page *mp;
-  MDBX_node *node = NULL;
-  DKBUF_DEBUG;
+  if (IS_BRANCH(mp) && cmp == cmp_int_align2)
+    /* Branch pages have no data, so if using integer keys,
+     * alignment is guaranteed. Use faster cmp_int_align4(). */
+    cmp = cmp_int_align4;
 
-  struct cursor_set_result ret;
-  ret.exact = false;
-  if (unlikely(key->iov_len < mc->mc_dbx->md_klen_min ||
-               key->iov_len > mc->mc_dbx->md_klen_max)) {
-    cASSERT(mc, !"Invalid key-size");
-    ret.err = MDBX_BAD_VALSIZE;
-    return ret;
+  MDBX_node *node;
+  if (interpolate) {
+    node = page_node(mp, low);
+    const MDBX_val first = {node_key(node), node_ks(node)};
+    node = page_node(mp, high);
+    const MDBX_val last = {node_key(node), node_ks(node)};
+    guess = int_key_guess(key, &first, &last, low, high);
+    probes = 2;
   }
-
-  MDBX_val aligned_key = *key;
-  uint64_t aligned_keybytes;
-  if (mc->mc_db->md_flags & MDBX_INTEGERKEY) {
-    switch (aligned_key.iov_len) {
-    default:
-      cASSERT(mc, !"key-size is invalid for MDBX_INTEGERKEY");
-      ret.err = MDBX_BAD_VALSIZE;
-      return ret;
-    case 4:
-      if (unlikely(3 & (uintptr_t)aligned_key.iov_base))
-        /* copy instead of return error to avoid break compatibility */
-        aligned_key.iov_base =
-            memcpy(&aligned_keybytes, aligned_key.iov_base, 4);
-      break;
-    case 8:
-      if (unlikely(7 & (uintptr_t)aligned_key.iov_base))
-        /* copy instead of return error to avoid break compatibility */
-        aligned_key.iov_base =
-            memcpy(&aligned_keybytes, aligned_key.iov_base, 8);
+  do {
+    i = likely(!probes) ? (low + high) >> 1 : guess;
+    node = page_node(mp, i);
+    nodekey.iov_len = node_ks(node);
+    nodekey.iov_base = node_key(node);
+    cASSERT(mc, ptr_disp(mp, mc->mc_txn->mt_env->me_psize) >=
+                    ptr_disp(nodekey.iov_base, nodekey.iov_len));
+    int cr = cmp(key, &nodekey);
+    if (IS_LEAF(mp))
+      DEBUG("found leaf index %zu [%s], rc = %i", i, DKEY_DEBUG(&nodekey), cr);
+    else
+      DEBUG("found branch index %zu [%s -> %" PRIaPGNO "], rc = %i", i,
+            DKEY_DEBUG(&nodekey), node_pgno(node), cr);
+    if (cr > 0)
+      /* Found entry is less than the key. */
+      /* Skip to get the smallest entry larger than key. */
+      low = ++i;
+    else if (cr < 0)
+      high = i - 1;
+    else {
+      ret.exact = true;
       break;
     }
-  }
-
-  if (mc->mc_xcursor)
-    mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
+    if (unlikely(probes) && --probes)
+      /* check the neighbour of the interpolated position */
+      guess = (cr > 0) ? low : high;
+  } while (likely(low <= high));
 
-  /* See if we're already on the right page */
-  if (mc->mc_flags & C_INITIALIZED) {
-    MDBX_val nodekey;
+  /* store the key index */
+  mc->mc_ki[mc->mc_top] = (indx_t)i;
+  ret.node = (i < nkeys)
+                 ? page_node(mp, i)
+                 : /* There is no entry larger or equal to the key. */ NULL;
+  return ret;
+}
 
-    cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
-    mp = mc->mc_pg[mc->mc_top];
-    if (unlikely(!page_numkeys(mp))) {
-      mc->mc_ki[mc->mc_top] = 0;
-      mc->mc_flags |= C_EOF;
-      ret.err = MDBX_NOTFOUND;
-      return ret;
-    }
-    if (IS_LEAF2(mp)) {
-      nodekey.iov_len = mc->mc_db->md_xsize;
-      nodekey.iov_base = page_leaf2key(mp, 0, nodekey.iov_len);
+/* Pop a page off the top of the cursor's stack. */
+static __inline void cursor_pop(MDBX_cursor *mc) {
+  if (likely(mc->mc_snum)) {
+    DEBUG("popped page %" PRIaPGNO " off db %d cursor %p",
+          mc->mc_pg[mc->mc_top]->mp_pgno, DDBI(mc), (void *)mc);
+    if (likely(--mc->mc_snum)) {
+      mc->mc_top--;
     } else {
-      node = page_node(mp, 0);
-      get_key(node, &nodekey);
-    }
-    int cmp = mc->mc_dbx->md_cmp(&aligned_key, &nodekey);
-    if (unlikely(cmp == 0)) {
-      /* Probably happens rarely, but first node on the page
-       * was the one we wanted. */
-      mc->mc_ki[mc->mc_top] = 0;
-      ret.exact = true;
-      cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
-                      (mc->mc_flags & C_EOF));
-      goto got_node;
-    }
-    if (cmp > 0) {
-      const size_t nkeys = page_numkeys(mp);
-      if (nkeys > 1) {
-        if (IS_LEAF2(mp)) {
-          nodekey.iov_base = page_leaf2key(mp, nkeys - 1, nodekey.iov_len);
-        } else {
-          node = page_node(mp, nkeys - 1);
-          get_key(node, &nodekey);
-        }
-        cmp = mc->mc_dbx->md_cmp(&aligned_key, &nodekey);
-        if (cmp == 0) {
-          /* last node was the one we wanted */
-          cASSERT(mc, nkeys >= 1 && nkeys <= UINT16_MAX + 1);
-          mc->mc_ki[mc->mc_top] = (indx_t)(nkeys - 1);
-          ret.exact = true;
-          cASSERT(mc,
-                  mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
-                      (mc->mc_flags & C_EOF));
-          goto got_node;
-        }
-        if (cmp < 0) {
-          if (mc->mc_ki[mc->mc_top] < page_numkeys(mp)) {
-            /* This is definitely the right page, skip search_page */
-            if (IS_LEAF2(mp)) {
-              nodekey.iov_base =
-                  page_leaf2key(mp, mc->mc_ki[mc->mc_top], nodekey.iov_len);
-            } else {
-              node = page_node(mp, mc->mc_ki[mc->mc_top]);
-              get_key(node, &nodekey);
-            }
-            cmp = mc->mc_dbx->md_cmp(&aligned_key, &nodekey);
-            if (cmp == 0) {
-              /* current node was the one we wanted */
-              ret.exact = true;
-              cASSERT(mc, mc->mc_ki[mc->mc_top] <
-                                  page_numkeys(mc->mc_pg[mc->mc_top]) ||
-                              (mc->mc_flags & C_EOF));
-              goto got_node;
-            }
-          }
-          mc->mc_flags &= ~C_EOF;
-          goto search_node;
-        }
-      }
-      /* If any parents have right-sibs, search.
-       * Otherwise, there's nothing further. */
-      size_t i;
-      for (i = 0; i < mc->mc_top; i++)
-        if (mc->mc_ki[i] < page_numkeys(mc->mc_pg[i]) - 1)
-          break;
-      if (i == mc->mc_top) {
-        /* There are no other pages */
-        cASSERT(mc, nkeys <= UINT16_MAX);
-        mc->mc_ki[mc->mc_top] = (uint16_t)nkeys;
-        mc->mc_flags |= C_EOF;
-        ret.err = MDBX_NOTFOUND;
-        return ret;
-      }
-    }
-    if (!mc->mc_top) {
-      /* There are no other pages */
-      mc->mc_ki[mc->mc_top] = 0;
-      if (op == MDBX_SET_RANGE)
-        goto got_node;
-
-      cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
-                      (mc->mc_flags & C_EOF));
-      ret.err = MDBX_NOTFOUND;
-      return ret;
+      mc->mc_flags &= ~C_INITIALIZED;
     }
-  } else {
-    mc->mc_pg[0] = nullptr;
   }
+}
 
-  ret.err = page_search(mc, &aligned_key, 0);
-  if (unlikely(ret.err != MDBX_SUCCESS))
-    return ret;
+/* Push a page onto the top of the cursor's stack.
+ * Set MDBX_TXN_ERROR on failure. */
+static __inline int cursor_push(MDBX_cursor *mc, MDBX_page *mp) {
+  DEBUG("pushing page %" PRIaPGNO " on db %d cursor %p", mp->mp_pgno, DDBI(mc),
+        (void *)mc);
 
-  mp = mc->mc_pg[mc->mc_top];
-  MDBX_ANALYSIS_ASSUME(mp != nullptr);
-  cASSERT(mc, IS_LEAF(mp));
+  if (unlikely(mc->mc_snum >= CURSOR_STACK)) {
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+    return MDBX_CURSOR_FULL;
+  }
 
-search_node:;
-  struct node_result nsr = node_search(mc, &aligned_key);
-  node = nsr.node;
-  ret.exact = nsr.exact;
-  if (!ret.exact) {
-    if (op != MDBX_SET_RANGE) {
-      /* MDBX_SET specified and not an exact match. */
-      if (unlikely(mc->mc_ki[mc->mc_top] >=
-                   page_numkeys(mc->mc_pg[mc->mc_top])))
-        mc->mc_flags |= C_EOF;
-      ret.err = MDBX_NOTFOUND;
-      return ret;
-    }
+  mc->mc_top = mc->mc_snum++;
+  mc->mc_pg[mc->mc_top] = mp;
+  mc->mc_ki[mc->mc_top] = 0;
+  return MDBX_SUCCESS;
+}
 
-    if (node == NULL) {
-      DEBUG("%s", "===> inexact leaf not found, goto sibling");
-      ret.err = cursor_sibling(mc, SIBLING_RIGHT);
-      if (unlikely(ret.err != MDBX_SUCCESS)) {
-        mc->mc_flags |= C_EOF;
-        return ret; /* no entries matched */
-      }
-      mp = mc->mc_pg[mc->mc_top];
-      cASSERT(mc, IS_LEAF(mp));
-      if (!IS_LEAF2(mp))
-        node = page_node(mp, 0);
+__hot static __always_inline int page_get_checker_lite(const uint16_t ILL,
+                                                       const MDBX_page *page,
+                                                       MDBX_txn *const txn,
+                                                       const txnid_t front) {
+  if (unlikely(page->mp_flags & ILL)) {
+    if (ILL == P_ILL_BITS || (page->mp_flags & P_ILL_BITS))
+      return bad_page(page, "invalid page's flags (%u)\n", page->mp_flags);
+    else if (ILL & P_OVERFLOW) {
+      assert((ILL & (P_BRANCH | P_LEAF | P_LEAF2)) == 0);
+      assert(page->mp_flags & (P_BRANCH | P_LEAF | P_LEAF2));
+      return bad_page(page, "unexpected %s instead of %s (%u)\n",
+                      "large/overflow", "branch/leaf/leaf2", page->mp_flags);
+    } else if (ILL & (P_BRANCH | P_LEAF | P_LEAF2)) {
+      assert((ILL & P_BRANCH) && (ILL & P_LEAF) && (ILL & P_LEAF2));
+      assert(page->mp_flags & (P_BRANCH | P_LEAF | P_LEAF2));
+      return bad_page(page, "unexpected %s instead of %s (%u)\n",
+                      "branch/leaf/leaf2", "large/overflow", page->mp_flags);
+    } else {
+      assert(false);
     }
   }
-  cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
-                  (mc->mc_flags & C_EOF));
-
-got_node:
-  mc->mc_flags |= C_INITIALIZED;
-  mc->mc_flags &= ~C_EOF;
 
-  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-          mp->mp_pgno, mp->mp_flags);
-    ret.err = MDBX_CORRUPTED;
-    return ret;
-  }
+  if (unlikely(page->mp_txnid > front) &&
+      unlikely(page->mp_txnid > txn->mt_front || front < txn->mt_txnid))
+    return bad_page(
+        page,
+        "invalid page' txnid (%" PRIaTXN ") for %s' txnid (%" PRIaTXN ")\n",
+        page->mp_txnid,
+        (front == txn->mt_front && front != txn->mt_txnid) ? "front-txn"
+                                                           : "parent-page",
+        front);
 
-  if (IS_LEAF2(mp)) {
-    if (op == MDBX_SET_RANGE || op == MDBX_SET_KEY) {
-      key->iov_len = mc->mc_db->md_xsize;
-      key->iov_base = page_leaf2key(mp, mc->mc_ki[mc->mc_top], key->iov_len);
-    }
-    ret.err = MDBX_SUCCESS;
-    return ret;
-  }
+  if (((ILL & P_OVERFLOW) || !IS_OVERFLOW(page)) &&
+      (ILL & (P_BRANCH | P_LEAF | P_LEAF2)) == 0) {
+    if (unlikely(page->mp_upper < page->mp_lower ||
+                 (page->mp_lower & 1) ||
+                 (!IS_LEAF2(page) && (page->mp_upper & 1)) ||
+                 PAGEHDRSZ + page->mp_upper > txn->mt_env->me_psize))
+      return bad_page(page,
+                      "invalid page' lower(%u)/upper(%u) with limit %zu\n",
+                      page->mp_lower, page->mp_upper, page_space(txn->mt_env));
 
-  if (node_flags(node) & F_DUPDATA) {
-    ret.err = cursor_xinit1(mc, node, mp);
-    if (unlikely(ret.err != MDBX_SUCCESS))
-      return ret;
-    if (op == MDBX_SET || op == MDBX_SET_KEY || op == MDBX_SET_RANGE) {
-      MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
-      ret.err = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
-      if (unlikely(ret.err != MDBX_SUCCESS))
-        return ret;
-    } else {
-      MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
-      ret = cursor_set(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_SET_RANGE);
-      if (unlikely(ret.err != MDBX_SUCCESS))
-        return ret;
-      if (op == MDBX_GET_BOTH && !ret.exact) {
-        ret.err = MDBX_NOTFOUND;
-        return ret;
-      }
-    }
-  } else if (likely(data)) {
-    if (op == MDBX_GET_BOTH || op == MDBX_GET_BOTH_RANGE) {
-      if (unlikely(data->iov_len < mc->mc_dbx->md_vlen_min ||
-                   data->iov_len > mc->mc_dbx->md_vlen_max)) {
-        cASSERT(mc, !"Invalid data-size");
-        ret.err = MDBX_BAD_VALSIZE;
-        return ret;
-      }
-      MDBX_val aligned_data = *data;
-      uint64_t aligned_databytes;
-      if (mc->mc_db->md_flags & MDBX_INTEGERDUP) {
-        switch (aligned_data.iov_len) {
-        default:
-          cASSERT(mc, !"data-size is invalid for MDBX_INTEGERDUP");
-          ret.err = MDBX_BAD_VALSIZE;
-          return ret;
-        case 4:
-          if (unlikely(3 & (uintptr_t)aligned_data.iov_base))
-            /* copy instead of return error to avoid break compatibility */
-            aligned_data.iov_base =
-                memcpy(&aligned_databytes, aligned_data.iov_base, 4);
-          break;
-        case 8:
-          if (unlikely(7 & (uintptr_t)aligned_data.iov_base))
-            /* copy instead of return error to avoid break compatibility */
-            aligned_data.iov_base =
-                memcpy(&aligned_databytes, aligned_data.iov_base, 8);
-          break;
-        }
-      }
-      MDBX_val actual_data;
-      ret.err = node_read(mc, node, &actual_data, mc->mc_pg[mc->mc_top]);
-      if (unlikely(ret.err != MDBX_SUCCESS))
-        return ret;
-      const int cmp = mc->mc_dbx->md_dcmp(&aligned_data, &actual_data);
-      if (cmp) {
-        cASSERT(mc,
-                mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
-                    (mc->mc_flags & C_EOF));
-        if (op != MDBX_GET_BOTH_RANGE || cmp > 0) {
-          ret.err = MDBX_NOTFOUND;
-          return ret;
-        }
-      }
-      *data = actual_data;
-    } else {
-      ret.err = node_read(mc, node, data, mc->mc_pg[mc->mc_top]);
-      if (unlikely(ret.err != MDBX_SUCCESS))
-        return ret;
-    }
+  } else if ((ILL & P_OVERFLOW) == 0) {
+    const pgno_t npages = page->mp_pages;
+    if (unlikely(npages < 1) || unlikely(npages >= MAX_PAGENO / 2))
+      return bad_page(page, "invalid n-pages (%u) for large-page\n", npages);
+    if (unlikely(page->mp_pgno + npages > txn->mt_next_pgno))
+      return bad_page(
+          page,
+          "end of large-page beyond (%u) allocated space (%u next-pgno)\n",
+          page->mp_pgno + npages, txn->mt_next_pgno);
+  } else {
+    assert(false);
   }
-
-  /* The key already matches in all other cases */
-  if (op == MDBX_SET_RANGE || op == MDBX_SET_KEY)
-    get_key_optional(node, key);
-
-  DEBUG("==> cursor placed on key [%s], data [%s]", DKEY_DEBUG(key),
-        DVAL_DEBUG(data));
-  ret.err = MDBX_SUCCESS;
-  return ret;
+  return MDBX_SUCCESS;
 }
 
-/* Move the cursor to the first item in the database. */
-static int cursor_first(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data) {
-  int rc;
+__cold static __noinline pgr_t
+page_get_checker_full(const uint16_t ILL, MDBX_page *page,
+                      const MDBX_cursor *const mc, const txnid_t front) {
+  pgr_t r = {page, page_get_checker_lite(ILL, page, mc->mc_txn, front)};
+  if (likely(r.err == MDBX_SUCCESS))
+    r.err = page_check(mc, page);
+  if (unlikely(r.err != MDBX_SUCCESS))
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+  return r;
+}
 
-  if (mc->mc_xcursor)
-    mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
+__hot static __always_inline pgr_t page_get_inline(const uint16_t ILL,
+                                                   const MDBX_cursor *const mc,
+                                                   const pgno_t pgno,
+                                                   const txnid_t front) {
+  MDBX_txn *const txn = mc->mc_txn;
+  tASSERT(txn, front <= txn->mt_front);
 
-  if (!(mc->mc_flags & C_INITIALIZED) || mc->mc_top) {
-    rc = page_search(mc, NULL, MDBX_PS_FIRST);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
+  pgr_t r;
+  if (unlikely(pgno >= txn->mt_next_pgno)) {
+    ERROR("page #%" PRIaPGNO " beyond next-pgno", pgno);
+    r.page = nullptr;
+    r.err = MDBX_PAGE_NOTFOUND;
+  bailout:
+    txn->mt_flags |= MDBX_TXN_ERROR;
+    return r;
   }
 
-  const MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-          mp->mp_pgno, mp->mp_flags);
-    return MDBX_CORRUPTED;
-  }
+  eASSERT(txn->mt_env,
+          ((txn->mt_flags ^ txn->mt_env->me_flags) & MDBX_WRITEMAP) == 0);
+  r.page = pgno2page(txn->mt_env, pgno);
+  if ((txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_WRITEMAP)) == 0) {
+    const MDBX_txn *spiller = txn;
+    do {
+      /* Spilled pages were dirtied in this txn and flushed
+       * because the dirty list got full. Bring this page
+       * back in from the map (but don't unspill it here,
+       * leave that unless page_touch happens again). */
+      if (unlikely(spiller->mt_flags & MDBX_TXN_SPILLS) &&
+          search_spilled(spiller, pgno))
+        break;
 
-  mc->mc_flags |= C_INITIALIZED;
-  mc->mc_flags &= ~C_EOF;
-  mc->mc_ki[mc->mc_top] = 0;
+      const size_t i = dpl_search(spiller, pgno);
+      tASSERT(txn, (intptr_t)i > 0);
+      if (spiller->tw.dirtylist->items[i].pgno == pgno) {
+        r.page = spiller->tw.dirtylist->items[i].ptr;
+        break;
+      }
 
-  if (IS_LEAF2(mp)) {
-    if (likely(key)) {
-      key->iov_len = mc->mc_db->md_xsize;
-      key->iov_base = page_leaf2key(mp, 0, key->iov_len);
-    }
-    return MDBX_SUCCESS;
+      spiller = spiller->mt_parent;
+    } while (spiller);
   }
 
-  MDBX_node *node = page_node(mp, 0);
-  if (node_flags(node) & F_DUPDATA) {
-    rc = cursor_xinit1(mc, node, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
-    rc = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
-    if (unlikely(rc))
-      return rc;
-  } else if (likely(data)) {
-    rc = node_read(mc, node, data, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
+  if (unlikely(r.page->mp_pgno != pgno)) {
+    r.err = bad_page(
+        r.page, "pgno mismatch (%" PRIaPGNO ") != expected (%" PRIaPGNO ")\n",
+        r.page->mp_pgno, pgno);
+    goto bailout;
   }
 
-  get_key_optional(node, key);
-  return MDBX_SUCCESS;
+  if (unlikely(mc->mc_checking & CC_PAGECHECK))
+    return page_get_checker_full(ILL, r.page, mc, front);
+
+#if MDBX_DISABLE_VALIDATION
+  r.err = MDBX_SUCCESS;
+#else
+  r.err = page_get_checker_lite(ILL, r.page, txn, front);
+  if (unlikely(r.err != MDBX_SUCCESS))
+    goto bailout;
+#endif /* MDBX_DISABLE_VALIDATION */
+  return r;
 }
 
-/* Move the cursor to the last item in the database. */
-static int cursor_last(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data) {
+/* Finish mdbx_page_search() / mdbx_page_search_lowest().
+ * The cursor is at the root page, set up the rest of it. */
+__hot __noinline static int page_search_root(MDBX_cursor *mc,
+                                             const MDBX_val *key, int flags) {
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
   int rc;
+  DKBUF_DEBUG;
 
-  if (mc->mc_xcursor)
-    mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
+  while (IS_BRANCH(mp)) {
+    MDBX_node *node;
+    intptr_t i;
 
-  if (!(mc->mc_flags & C_INITIALIZED) || mc->mc_top) {
-    rc = page_search(mc, NULL, MDBX_PS_LAST);
+    DEBUG("branch page %" PRIaPGNO " has %zu keys", mp->mp_pgno,
+          page_numkeys(mp));
+    /* Don't assert on branch pages in the GC. We can get here
+     * while in the process of rebalancing a GC branch page; we must
+     * let that proceed. ITS#8336 */
+    cASSERT(mc, !mc->mc_dbi || page_numkeys(mp) > 1);
+    DEBUG("found index 0 to page %" PRIaPGNO, node_pgno(page_node(mp, 0)));
+
+    if (flags & (MDBX_PS_FIRST | MDBX_PS_LAST)) {
+      i = 0;
+      if (flags & MDBX_PS_LAST) {
+        i = page_numkeys(mp) - 1;
+        /* if already init'd, see if we're already in right place */
+        if (mc->mc_flags & C_INITIALIZED) {
+          if (mc->mc_ki[mc->mc_top] == i) {
+            mc->mc_top = mc->mc_snum++;
+            mp = mc->mc_pg[mc->mc_top];
+            goto ready;
+          }
+        }
+      }
+    } else {
+      const struct node_result nsr = node_search(mc, key);
+      if (likely(nsr.node))
+        i = mc->mc_ki[mc->mc_top] + (intptr_t)nsr.exact - 1;
+      else
+        i = page_numkeys(mp) - 1;
+      DEBUG("following index %zu for key [%s]", i, DKEY_DEBUG(key));
+    }
+
+    cASSERT(mc, i >= 0 && i < (int)page_numkeys(mp));
+    node = page_node(mp, i);
+
+    rc = page_get(mc, node_pgno(node), &mp, mp->mp_txnid);
     if (unlikely(rc != MDBX_SUCCESS))
       return rc;
+
+    mc->mc_ki[mc->mc_top] = (indx_t)i;
+    if (unlikely(rc = cursor_push(mc, mp)))
+      return rc;
+
+  ready:
+    if (flags & MDBX_PS_MODIFY) {
+      rc = page_touch(mc);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      mp = mc->mc_pg[mc->mc_top];
+    }
   }
 
-  const MDBX_page *mp = mc->mc_pg[mc->mc_top];
   if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
     ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
           mp->mp_pgno, mp->mp_flags);
     return MDBX_CORRUPTED;
   }
 
-  mc->mc_ki[mc->mc_top] = (indx_t)page_numkeys(mp) - 1;
-  mc->mc_flags |= C_INITIALIZED | C_EOF;
+  DEBUG("found leaf page %" PRIaPGNO " for key [%s]", mp->mp_pgno,
+        DKEY_DEBUG(key));
+  mc->mc_flags |= C_INITIALIZED;
+  mc->mc_flags &= ~C_EOF;
 
-  if (IS_LEAF2(mp)) {
-    if (likely(key)) {
-      key->iov_len = mc->mc_db->md_xsize;
-      key->iov_base = page_leaf2key(mp, mc->mc_ki[mc->mc_top], key->iov_len);
-    }
-    return MDBX_SUCCESS;
+  return MDBX_SUCCESS;
+}
+
+static int setup_dbx(MDBX_dbx *const dbx, const MDBX_db *const db,
+                     const unsigned pagesize) {
+  if (unlikely(!dbx->md_cmp)) {
+    dbx->md_cmp = get_default_keycmp(db->md_flags);
+    dbx->md_dcmp = get_default_datacmp(db->md_flags);
   }
 
-  MDBX_node *node = page_node(mp, mc->mc_ki[mc->mc_top]);
-  if (node_flags(node) & F_DUPDATA) {
-    rc = cursor_xinit1(mc, node, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
-    rc = cursor_last(&mc->mc_xcursor->mx_cursor, data, NULL);
-    if (unlikely(rc))
-      return rc;
-  } else if (likely(data)) {
-    rc = node_read(mc, node, data, mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
+  dbx->md_klen_min =
+      (db->md_flags & MDBX_INTEGERKEY) ? 4 /* sizeof(uint32_t) */ : 0;
+  dbx->md_klen_max = keysize_max(pagesize, db->md_flags);
+  assert(dbx->md_klen_max != (unsigned)-1);
+
+  dbx->md_vlen_min = (db->md_flags & MDBX_INTEGERDUP)
+                         ? 4 /* sizeof(uint32_t) */
+                         : ((db->md_flags & MDBX_DUPFIXED) ? 1 : 0);
+  dbx->md_vlen_max = valsize_max(pagesize, db->md_flags);
+  assert(dbx->md_vlen_max != (size_t)-1);
+
+  if ((db->md_flags & (MDBX_DUPFIXED | MDBX_INTEGERDUP)) != 0 && db->md_xsize) {
+    if (!MDBX_DISABLE_VALIDATION && unlikely(db->md_xsize < dbx->md_vlen_min ||
+                                             db->md_xsize > dbx->md_vlen_max)) {
+      ERROR("db.md_xsize (%u) <> min/max value-length (%zu/%zu)", db->md_xsize,
+            dbx->md_vlen_min, dbx->md_vlen_max);
+      return MDBX_CORRUPTED;
+    }
+    dbx->md_vlen_min = dbx->md_vlen_max = db->md_xsize;
   }
 
-  get_key_optional(node, key);
+  if ((db->md_flags & MDBX_FIXEDSIZE) != 0 && db->md_xsize) {
+    /* Для MDBX_FIXEDSIZE в md_xsize хранится длина ключа, а длина всей
+     * записи (ключ и значение) задается mp_leaf2_ksize листовых страниц. */
+    if (!MDBX_DISABLE_VALIDATION && unlikely(db->md_xsize < dbx->md_klen_min ||
+                                             db->md_xsize > dbx->md_klen_max)) {
+      ERROR("db.md_xsize (%u) <> min/max key-length (%zu/%zu)", db->md_xsize,
+            dbx->md_klen_min, dbx->md_klen_max);
+      return MDBX_CORRUPTED;
+    }
+    dbx->md_klen_min = dbx->md_klen_max = db->md_xsize;
+  }
   return MDBX_SUCCESS;
 }
 
-static __hot int cursor_get(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
-                            MDBX_cursor_op op) {
-  int (*mfunc)(MDBX_cursor * mc, MDBX_val * key, MDBX_val * data);
+static int fetch_sdb(MDBX_txn *txn, size_t dbi) {
+  MDBX_cursor_couple couple;
+  if (unlikely(dbi_changed(txn, dbi))) {
+    NOTICE("dbi %zu was changed for txn %" PRIaTXN, dbi, txn->mt_txnid);
+    return MDBX_BAD_DBI;
+  }
+  int rc = cursor_init(&couple.outer, txn, MAIN_DBI);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  MDBX_dbx *const dbx = &txn->mt_dbxs[dbi];
+  rc = page_search(&couple.outer, &dbx->md_name, 0);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+  notfound:
+    NOTICE("dbi %zu refs to inaccessible subDB `%*s` for txn %" PRIaTXN
+           " (err %d)",
+           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
+           txn->mt_txnid, rc);
+    return (rc == MDBX_NOTFOUND) ? MDBX_BAD_DBI : rc;
+  }
+
+  MDBX_val data;
+  struct node_result nsr = node_search(&couple.outer, &dbx->md_name);
+  if (unlikely(!nsr.exact)) {
+    rc = MDBX_NOTFOUND;
+    goto notfound;
+  }
+  if (unlikely((node_flags(nsr.node) & (F_DUPDATA | F_SUBDATA)) != F_SUBDATA)) {
+    NOTICE("dbi %zu refs to not a named subDB `%*s` for txn %" PRIaTXN " (%s)",
+           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
+           txn->mt_txnid, "wrong flags");
+    return MDBX_INCOMPATIBLE; /* not a named DB */
+  }
+
+  rc = node_read(&couple.outer, nsr.node, &data,
+                 couple.outer.mc_pg[couple.outer.mc_top]);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(data.iov_len != sizeof(MDBX_db))) {
+    NOTICE("dbi %zu refs to not a named subDB `%*s` for txn %" PRIaTXN " (%s)",
+           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
+           txn->mt_txnid, "wrong rec-size");
+    return MDBX_INCOMPATIBLE; /* not a named DB */
+  }
+
+  uint16_t md_flags = UNALIGNED_PEEK_16(data.iov_base, MDBX_db, md_flags);
+  /* The txn may not know this DBI, or another process may
+   * have dropped and recreated the DB with other flags. */
+  MDBX_db *const db = &txn->mt_dbs[dbi];
+  if (unlikely((db->md_flags & DB_PERSISTENT_FLAGS) != md_flags)) {
+    NOTICE("dbi %zu refs to the re-created subDB `%*s` for txn %" PRIaTXN
+           " with different flags (present 0x%X != wanna 0x%X)",
+           dbi, (int)dbx->md_name.iov_len, (const char *)dbx->md_name.iov_base,
+           txn->mt_txnid, db->md_flags & DB_PERSISTENT_FLAGS, md_flags);
+    return MDBX_INCOMPATIBLE;
+  }
+
+  memcpy(db, data.iov_base, sizeof(MDBX_db));
+#if !MDBX_DISABLE_VALIDATION
+  const txnid_t pp_txnid = couple.outer.mc_pg[couple.outer.mc_top]->mp_txnid;
+  tASSERT(txn, txn->mt_front >= pp_txnid);
+  if (unlikely(db->md_mod_txnid > pp_txnid)) {
+    ERROR("db.md_mod_txnid (%" PRIaTXN ") > page-txnid (%" PRIaTXN ")",
+          db->md_mod_txnid, pp_txnid);
+    return MDBX_CORRUPTED;
+  }
+#endif /* !MDBX_DISABLE_VALIDATION */
+  rc = setup_dbx(dbx, db, txn->mt_env->me_psize);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  txn->mt_dbistate[dbi] &= ~DBI_STALE;
+  return MDBX_SUCCESS;
+}
+
+/* Search for the lowest key under the current branch page.
+ * This just bypasses a numkeys check in the current page
+ * before calling mdbx_page_search_root(), because the callers
+ * are all in situations where the current page is known to
+ * be underfilled. */
+__hot static int page_search_lowest(MDBX_cursor *mc) {
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  cASSERT(mc, IS_BRANCH(mp));
+  MDBX_node *node = page_node(mp, 0);
+
+  int rc = page_get(mc, node_pgno(node), &mp, mp->mp_txnid);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  mc->mc_ki[mc->mc_top] = 0;
+  if (unlikely(rc = cursor_push(mc, mp)))
+    return rc;
+  return page_search_root(mc, NULL, MDBX_PS_FIRST);
+}
+
+/* Search for the page a given key should be in.
+ * Push it and its parent pages on the cursor stack.
+ *
+ * [in,out] mc  the cursor for this operation.
+ * [in] key     the key to search for, or NULL for first/last page.
+ * [in] flags   If MDBX_PS_MODIFY is set, visited pages in the DB
+ *              are touched (updated with new page numbers).
+ *              If MDBX_PS_FIRST or MDBX_PS_LAST is set, find first or last
+ * leaf.
+ *              This is used by mdbx_cursor_first() and mdbx_cursor_last().
+ *              If MDBX_PS_ROOTONLY set, just fetch root node, no further
+ *              lookups.
+ *
+ * Returns 0 on success, non-zero on failure. */
+__hot static int page_search(MDBX_cursor *mc, const MDBX_val *key, int flags) {
   int rc;
+  pgno_t root;
 
-  switch (op) {
-  case MDBX_GET_CURRENT: {
-    if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
-      return MDBX_ENODATA;
-    const MDBX_page *mp = mc->mc_pg[mc->mc_top];
-    if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-      ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-            mp->mp_pgno, mp->mp_flags);
-      return MDBX_CORRUPTED;
-    }
-    const size_t nkeys = page_numkeys(mp);
-    if (unlikely(mc->mc_ki[mc->mc_top] >= nkeys)) {
-      cASSERT(mc, nkeys <= UINT16_MAX);
-      if (mc->mc_flags & C_EOF)
-        return MDBX_ENODATA;
-      mc->mc_ki[mc->mc_top] = (uint16_t)nkeys;
-      mc->mc_flags |= C_EOF;
-      return MDBX_NOTFOUND;
-    }
-    cASSERT(mc, nkeys > 0);
+  /* Make sure the txn is still viable, then find the root from
+   * the txn's db table and set it as the root of the cursor's stack. */
+  if (unlikely(mc->mc_txn->mt_flags & MDBX_TXN_BLOCKED)) {
+    DEBUG("%s", "transaction has failed, must abort");
+    return MDBX_BAD_TXN;
+  }
 
-    rc = MDBX_SUCCESS;
-    if (IS_LEAF2(mp)) {
-      key->iov_len = mc->mc_db->md_xsize;
-      key->iov_base = page_leaf2key(mp, mc->mc_ki[mc->mc_top], key->iov_len);
-    } else {
-      MDBX_node *node = page_node(mp, mc->mc_ki[mc->mc_top]);
-      get_key_optional(node, key);
-      if (data) {
-        if (node_flags(node) & F_DUPDATA) {
-          if (unlikely(!(mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED))) {
-            rc = cursor_xinit1(mc, node, mp);
-            if (unlikely(rc != MDBX_SUCCESS))
-              return rc;
-            rc = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
-            if (unlikely(rc))
-              return rc;
-          } else {
-            rc = cursor_get(&mc->mc_xcursor->mx_cursor, data, NULL,
-                            MDBX_GET_CURRENT);
-            if (unlikely(rc))
-              return rc;
-          }
-        } else {
-          rc = node_read(mc, node, data, mp);
-          if (unlikely(rc))
-            return rc;
+  /* Make sure we're using an up-to-date root */
+  if (unlikely(*mc->mc_dbistate & DBI_STALE)) {
+    rc = fetch_sdb(mc->mc_txn, mc->mc_dbi);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+  root = mc->mc_db->md_root;
+
+  if (unlikely(root == P_INVALID)) { /* Tree is empty. */
+    DEBUG("%s", "tree is empty");
+    return MDBX_NOTFOUND;
+  }
+
+  cASSERT(mc, root >= NUM_METAS);
+  if (!mc->mc_snum || !(mc->mc_flags & C_INITIALIZED) ||
+      mc->mc_pg[0]->mp_pgno != root) {
+    txnid_t pp_txnid = mc->mc_db->md_mod_txnid;
+    pp_txnid = /* mc->mc_db->md_mod_txnid maybe zero in a legacy DB */ pp_txnid
+                   ? pp_txnid
+                   : mc->mc_txn->mt_txnid;
+    if ((mc->mc_txn->mt_flags & MDBX_TXN_RDONLY) == 0) {
+      MDBX_txn *scan = mc->mc_txn;
+      do
+        if ((scan->mt_flags & MDBX_TXN_DIRTY) &&
+            (mc->mc_dbi == MAIN_DBI ||
+             (scan->mt_dbistate[mc->mc_dbi] & DBI_DIRTY))) {
+          /* После коммита вложенных тразакций может быть mod_txnid > front */
+          pp_txnid = scan->mt_front;
+          break;
         }
-      }
+      while (unlikely((scan = scan->mt_parent) != nullptr));
     }
-    break;
-  }
-  case MDBX_GET_BOTH:
-  case MDBX_GET_BOTH_RANGE:
-    if (unlikely(data == NULL))
-      return MDBX_EINVAL;
-    if (unlikely(mc->mc_xcursor == NULL))
-      return MDBX_INCOMPATIBLE;
-    /* fall through */
-    __fallthrough;
-  case MDBX_SET:
-  case MDBX_SET_KEY:
-  case MDBX_SET_RANGE:
-    if (unlikely(key == NULL))
-      return MDBX_EINVAL;
-    rc = cursor_set(mc, key, data, op).err;
-    if (mc->mc_flags & C_INITIALIZED) {
-      cASSERT(mc, mc->mc_snum > 0 && mc->mc_top < mc->mc_snum);
-      cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
-                      (mc->mc_flags & C_EOF));
-    }
-    break;
-  case MDBX_GET_MULTIPLE:
-    if (unlikely(data == NULL || !(mc->mc_flags & C_INITIALIZED)))
-      return MDBX_EINVAL;
-    if (unlikely(!(mc->mc_db->md_flags & MDBX_DUPFIXED)))
-      return MDBX_INCOMPATIBLE;
-    rc = MDBX_SUCCESS;
-    if ((mc->mc_xcursor->mx_cursor.mc_flags & (C_INITIALIZED | C_EOF)) !=
-        C_INITIALIZED)
-      break;
-    goto fetchm;
-  case MDBX_NEXT_MULTIPLE:
-    if (unlikely(data == NULL))
-      return MDBX_EINVAL;
-    if (unlikely(!(mc->mc_db->md_flags & MDBX_DUPFIXED)))
-      return MDBX_INCOMPATIBLE;
-    rc = cursor_next(mc, key, data, MDBX_NEXT_DUP);
-    if (rc == MDBX_SUCCESS) {
-      if (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED) {
-        MDBX_cursor *mx;
-      fetchm:
-        mx = &mc->mc_xcursor->mx_cursor;
-        data->iov_len =
-            page_numkeys(mx->mc_pg[mx->mc_top]) * mx->mc_db->md_xsize;
-        data->iov_base = page_data(mx->mc_pg[mx->mc_top]);
-        mx->mc_ki[mx->mc_top] = (indx_t)page_numkeys(mx->mc_pg[mx->mc_top]) - 1;
-      } else {
-        rc = MDBX_NOTFOUND;
-      }
-    }
-    break;
-  case MDBX_PREV_MULTIPLE:
-    if (data == NULL)
-      return MDBX_EINVAL;
-    if (!(mc->mc_db->md_flags & MDBX_DUPFIXED))
-      return MDBX_INCOMPATIBLE;
-    rc = MDBX_SUCCESS;
-    if (!(mc->mc_flags & C_INITIALIZED))
-      rc = cursor_last(mc, key, data);
-    if (rc == MDBX_SUCCESS) {
-      MDBX_cursor *mx = &mc->mc_xcursor->mx_cursor;
-      if (mx->mc_flags & C_INITIALIZED) {
-        rc = cursor_sibling(mx, SIBLING_LEFT);
-        if (rc == MDBX_SUCCESS)
-          goto fetchm;
-      } else {
-        rc = MDBX_NOTFOUND;
-      }
-    }
-    break;
-  case MDBX_NEXT:
-  case MDBX_NEXT_DUP:
-  case MDBX_NEXT_NODUP:
-    rc = cursor_next(mc, key, data, op);
-    break;
-  case MDBX_PREV:
-  case MDBX_PREV_DUP:
-  case MDBX_PREV_NODUP:
-    rc = cursor_prev(mc, key, data, op);
-    break;
-  case MDBX_FIRST:
-    rc = cursor_first(mc, key, data);
-    break;
-  case MDBX_FIRST_DUP:
-    mfunc = cursor_first;
-  move:
-    if (unlikely(data == NULL || !(mc->mc_flags & C_INITIALIZED)))
-      return MDBX_EINVAL;
-    if (unlikely(mc->mc_xcursor == NULL))
-      return MDBX_INCOMPATIBLE;
-    if (mc->mc_ki[mc->mc_top] >= page_numkeys(mc->mc_pg[mc->mc_top])) {
-      mc->mc_ki[mc->mc_top] = (indx_t)page_numkeys(mc->mc_pg[mc->mc_top]);
-      mc->mc_flags |= C_EOF;
-      return MDBX_NOTFOUND;
-    } else {
-      MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
-      if (!(node_flags(node) & F_DUPDATA)) {
-        get_key_optional(node, key);
-        rc = node_read(mc, node, data, mc->mc_pg[mc->mc_top]);
-        break;
-      }
-    }
-    if (unlikely(!(mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED)))
-      return MDBX_EINVAL;
-    rc = mfunc(&mc->mc_xcursor->mx_cursor, data, NULL);
-    break;
-  case MDBX_LAST:
-    rc = cursor_last(mc, key, data);
-    break;
-  case MDBX_LAST_DUP:
-    mfunc = cursor_last;
-    goto move;
-  case MDBX_SET_UPPERBOUND: /* mostly same as MDBX_SET_LOWERBOUND */
-  case MDBX_SET_LOWERBOUND: {
-    if (unlikely(key == NULL || data == NULL))
-      return MDBX_EINVAL;
-    MDBX_val save_data = *data;
-    struct cursor_set_result csr = cursor_set(mc, key, data, MDBX_SET_RANGE);
-    rc = csr.err;
-    if (rc == MDBX_SUCCESS && csr.exact && mc->mc_xcursor) {
-      mc->mc_flags &= ~C_DEL;
-      csr.exact = false;
-      if (!save_data.iov_base && (mc->mc_db->md_flags & MDBX_DUPFIXED)) {
-        /* Avoiding search nested dupfixed hive if no data provided.
-         * This is changes the semantic of MDBX_SET_LOWERBOUND but avoid
-         * returning MDBX_BAD_VALSIZE. */
-      } else if (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED) {
-        *data = save_data;
-        csr =
-            cursor_set(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_SET_RANGE);
-        rc = csr.err;
-        if (rc == MDBX_NOTFOUND) {
-          cASSERT(mc, !csr.exact);
-          rc = cursor_next(mc, key, data, MDBX_NEXT_NODUP);
-        }
-      } else {
-        int cmp = mc->mc_dbx->md_dcmp(&save_data, data);
-        csr.exact = (cmp == 0);
-        if (cmp > 0)
-          rc = cursor_next(mc, key, data, MDBX_NEXT_NODUP);
-      }
-    }
-    if (rc == MDBX_SUCCESS && !csr.exact)
-      rc = MDBX_RESULT_TRUE;
-    if (unlikely(op == MDBX_SET_UPPERBOUND)) {
-      /* minor fixups for MDBX_SET_UPPERBOUND */
-      if (rc == MDBX_RESULT_TRUE)
-        /* already at great-than by MDBX_SET_LOWERBOUND */
-        rc = MDBX_SUCCESS;
-      else if (rc == MDBX_SUCCESS)
-        /* exactly match, going next */
-        rc = cursor_next(mc, key, data, MDBX_NEXT);
-    }
-    break;
-  }
-  default:
-    DEBUG("unhandled/unimplemented cursor operation %u", op);
-    return MDBX_EINVAL;
+    if (unlikely((rc = page_get(mc, root, &mc->mc_pg[0], pp_txnid)) != 0))
+      return rc;
   }
 
-  mc->mc_flags &= ~C_DEL;
-  return rc;
-}
+  mc->mc_snum = 1;
+  mc->mc_top = 0;
 
-int mdbx_cursor_get(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
-                    MDBX_cursor_op op) {
-  if (unlikely(mc == NULL))
-    return MDBX_EINVAL;
+  DEBUG("db %d root page %" PRIaPGNO " has flags 0x%X", DDBI(mc), root,
+        mc->mc_pg[0]->mp_flags);
 
-  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
-    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
-                                                     : MDBX_EBADSIGN;
+  if (flags & MDBX_PS_MODIFY) {
+    if (unlikely(rc = page_touch(mc)))
+      return rc;
+  }
 
-  int rc = check_txn(mc->mc_txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+  if (flags & MDBX_PS_ROOTONLY)
+    return MDBX_SUCCESS;
 
-  return cursor_get(mc, key, data, op);
+  return page_search_root(mc, key, flags);
 }
 
-static int cursor_first_batch(MDBX_cursor *mc) {
-  if (!(mc->mc_flags & C_INITIALIZED) || mc->mc_top) {
-    int err = page_search(mc, NULL, MDBX_PS_FIRST);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
+/* Read large/overflow node data. */
+static __noinline int node_read_bigdata(MDBX_cursor *mc, const MDBX_node *node,
+                                        MDBX_val *data, const MDBX_page *mp) {
+  cASSERT(mc, (node_flags(node) & ~F_COMPRESSED) == F_BIGDATA &&
+                  data->iov_len == node_ds(node));
+
+  pgr_t lp = page_get_large(mc, node_largedata_pgno(node), mp->mp_txnid);
+  if (unlikely((lp.err != MDBX_SUCCESS))) {
+    DEBUG("read large/overflow page %" PRIaPGNO " failed",
+          node_largedata_pgno(node));
+    return lp.err;
   }
-  cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
 
-  mc->mc_flags |= C_INITIALIZED;
-  mc->mc_flags &= ~C_EOF;
-  mc->mc_ki[mc->mc_top] = 0;
+  cASSERT(mc, PAGETYPE_WHOLE(lp.page) == P_OVERFLOW);
+  const size_t align = valign(mc->mc_db->md_flags);
+  data->iov_base = ptr_disp(lp.page, largedata_offset(align));
+  if (!MDBX_DISABLE_VALIDATION) {
+    const MDBX_env *env = mc->mc_txn->mt_env;
+    const size_t dsize = data->iov_len;
+    if (unlikely(leaf_node_size(node_ks(node), dsize, align) <=
+                 env->me_leaf_nodemax) &&
+        mc->mc_dbi != FREE_DBI)
+      poor_page(mp, "too small data (%zu bytes) for bigdata-node", dsize);
+    const unsigned npages = largedata_npages(env, dsize, align);
+    if (unlikely(lp.page->mp_pages != npages)) {
+      if (lp.page->mp_pages < npages)
+        return bad_page(lp.page,
+                        "too less n-pages %u for bigdata-node (%zu bytes)",
+                        lp.page->mp_pages, dsize);
+      else if (mc->mc_dbi != FREE_DBI)
+        poor_page(lp.page, "extra n-pages %u for bigdata-node (%zu bytes)",
+                  lp.page->mp_pages, dsize);
+    }
+  }
   return MDBX_SUCCESS;
 }
 
-static int cursor_next_batch(MDBX_cursor *mc) {
-  if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
-    return cursor_first_batch(mc);
+/* Return the data associated with a given node. */
+static __always_inline int node_read(MDBX_cursor *mc, const MDBX_node *node,
+                                     MDBX_val *data, const MDBX_page *mp) {
+  data->iov_len = node_ds(node);
+  data->iov_base = node_data(node);
+  if (likely((node_flags(node) & F_BIGDATA) == 0))
+    return MDBX_SUCCESS;
+  return node_read_bigdata(mc, node, data, mp);
+}
 
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  if (unlikely(mc->mc_flags & C_EOF)) {
-    if ((size_t)mc->mc_ki[mc->mc_top] + 1 >= page_numkeys(mp))
-      return MDBX_NOTFOUND;
-    mc->mc_flags ^= C_EOF;
+/*----------------------------------------------------------------------------*/
+/* Values compression */
+
+/* Сжатое значение предваряется заголовком из байта с видом кодека и длины
+ * исходного значения (uint32_t, невыровненного). Значения сжатые встроенным
+ * кодеком читаются всегда, а пользовательским - только при заданном для
+ * таблицы кодеке. */
+#define CODEC_HEADER 5
+#define CODEC_BUILTIN 1
+#define CODEC_CUSTOM 2
+/* Ссылка на значение в журнале значений, см. mdbx_dbi_set_vlog(): вид,
+ * длина значения (uint32_t), его смещение в журнале (uint64_t) и контрольная
+ * сумма (uint32_t), все невыровненные. */
+#define CODEC_VLOG 3
+#define VLOG_REF_SIZE 17
+/* Короткие значения не сжимаются независимо от заданного порога */
+#define CODEC_MIN_VALUE 32
+
+/* Встроенный кодек - упрощенный LZ77 в стиле LZ4. Сжатые данные состоят из
+ * последовательностей: байт-токен (старшие 4 бита - количество литералов,
+ * младшие - длина совпадения за вычетом LZ_MINMATCH), продолжение количества
+ * литералов, литералы, 16-битное смещение совпадения и продолжение его длины.
+ * Продолжения кодируются байтами по 255 до первого меньшего. Последняя
+ * последовательность содержит только литералы. */
+#define LZ_MINMATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET UINT16_MAX
+
+static __always_inline uint8_t *lz_put_length(uint8_t *op, uint8_t *const end,
+                                              size_t length) {
+  for (;;) {
+    if (unlikely(op >= end))
+      return nullptr;
+    if (length < 255) {
+      *op++ = (uint8_t)length;
+      return op;
+    }
+    *op++ = 255;
+    length -= 255;
   }
+}
 
-  intptr_t ki = mc->mc_ki[mc->mc_top];
-  mc->mc_ki[mc->mc_top] = (indx_t)++ki;
-  const intptr_t numkeys = page_numkeys(mp);
-  if (likely(ki >= numkeys)) {
-    DEBUG("%s", "=====> move to next sibling page");
-    mc->mc_ki[mc->mc_top] = (indx_t)(numkeys - 1);
-    int err = cursor_sibling(mc, SIBLING_RIGHT);
-    if (unlikely(err != MDBX_SUCCESS)) {
-      mc->mc_flags |= C_EOF;
-      return err;
-    }
-    mp = mc->mc_pg[mc->mc_top];
-    DEBUG("next page is %" PRIaPGNO ", key index %u", mp->mp_pgno,
-          mc->mc_ki[mc->mc_top]);
-    if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-      ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-            mp->mp_pgno, mp->mp_flags);
-      return MDBX_CORRUPTED;
+static uint8_t *lz_put_sequence(uint8_t *op, uint8_t *const end,
+                                const uint8_t *literals, size_t nliterals,
+                                size_t offset, size_t match) {
+  if (unlikely(op >= end))
+    return nullptr;
+  uint8_t *const token = op++;
+  *token = (uint8_t)(((nliterals < 15) ? nliterals : 15) << 4);
+  if (nliterals >= 15 && !(op = lz_put_length(op, end, nliterals - 15)))
+    return nullptr;
+  if (unlikely((size_t)(end - op) < nliterals))
+    return nullptr;
+  if (nliterals) {
+    memcpy(op, literals, nliterals);
+    op += nliterals;
+  }
+  if (match) {
+    match -= LZ_MINMATCH;
+    *token |= (uint8_t)((match < 15) ? match : 15);
+    if (unlikely(end - op < 2))
+      return nullptr;
+    op[0] = (uint8_t)offset;
+    op[1] = (uint8_t)(offset >> 8);
+    op += 2;
+    if (match >= 15 && !(op = lz_put_length(op, end, match - 15)))
+      return nullptr;
+  }
+  return op;
+}
+
+static size_t lz_compress(void *ctx, const void *src, size_t src_len,
+                          void *dst, size_t dst_capacity) {
+  (void)ctx;
+  uint32_t table[1u << LZ_HASH_BITS];
+  memset(table, 0, sizeof(table));
+  const uint8_t *const begin = src, *const end = begin + src_len;
+  uint8_t *op = dst, *const op_end = op + dst_capacity;
+  const uint8_t *ip = begin, *anchor = begin;
+  while (end - ip >= LZ_MINMATCH) {
+    const uint32_t seq = unaligned_peek_u32(1, ip);
+    const size_t hash =
+        (uint32_t)(seq * UINT32_C(2654435761)) >> (32 - LZ_HASH_BITS);
+    const size_t candidate = table[hash];
+    table[hash] = (uint32_t)(ip - begin) + 1;
+    if (!candidate || (size_t)(ip - begin) - (candidate - 1) > LZ_MAX_OFFSET ||
+        unaligned_peek_u32(1, begin + candidate - 1) != seq) {
+      /* ускоряемся на несжимаемых участках */
+      ip += 1 + ((size_t)(ip - anchor) >> 6);
+      continue;
     }
+
+    const uint8_t *const ref = begin + candidate - 1;
+    size_t match = LZ_MINMATCH;
+    while (ip + match < end && ref[match] == ip[match])
+      ++match;
+    op = lz_put_sequence(op, op_end, anchor, ip - anchor, ip - ref, match);
+    if (unlikely(!op))
+      return 0;
+    anchor = ip += match;
   }
-  return MDBX_SUCCESS;
+  op = lz_put_sequence(op, op_end, anchor, end - anchor, 0, 0);
+  return op ? (size_t)(op - (uint8_t *)dst) : 0;
 }
 
-int mdbx_cursor_get_batch(MDBX_cursor *mc, size_t *count, MDBX_val *pairs,
-                          size_t limit, MDBX_cursor_op op) {
-  if (unlikely(mc == NULL || count == NULL || limit < 4))
-    return MDBX_EINVAL;
-
-  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
-    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
-                                                     : MDBX_EBADSIGN;
+static __always_inline const uint8_t *
+lz_get_length(const uint8_t *ip, const uint8_t *const end, size_t *length) {
+  unsigned byte;
+  do {
+    if (unlikely(ip >= end))
+      return nullptr;
+    byte = *ip++;
+    *length += byte;
+  } while (byte == 255);
+  return ip;
+}
+
+static int lz_decompress(void *ctx, const void *src, size_t src_len, void *dst,
+                         size_t dst_len) {
+  (void)ctx;
+  const uint8_t *ip = src, *const end = ip + src_len;
+  uint8_t *op = dst, *const op_end = op + dst_len;
+  while (ip < end) {
+    const unsigned token = *ip++;
+    size_t length = token >> 4;
+    if (length == 15 && unlikely(!(ip = lz_get_length(ip, end, &length))))
+      return MDBX_CORRUPTED;
+    if (unlikely(length > (size_t)(end - ip) ||
+                 length > (size_t)(op_end - op)))
+      return MDBX_CORRUPTED;
+    if (length) {
+      memcpy(op, ip, length);
+      ip += length;
+      op += length;
+    }
+    if (ip == end)
+      break;
 
-  int rc = check_txn(mc->mc_txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+    if (unlikely(end - ip < 2))
+      return MDBX_CORRUPTED;
+    const size_t offset = ip[0] | (size_t)ip[1] << 8;
+    ip += 2;
+    if (unlikely(offset == 0 || offset > (size_t)(op - (uint8_t *)dst)))
+      return MDBX_CORRUPTED;
+    length = token & 15;
+    if (length == 15 && unlikely(!(ip = lz_get_length(ip, end, &length))))
+      return MDBX_CORRUPTED;
+    length += LZ_MINMATCH;
+    if (unlikely(length > (size_t)(op_end - op)))
+      return MDBX_CORRUPTED;
+    const uint8_t *ref = op - offset;
+    if (offset >= length) {
+      memcpy(op, ref, length);
+      op += length;
+    } else
+      /* перекрывающееся совпадение, копируем побайтно */
+      do
+        *op++ = *ref++;
+      while (--length);
+  }
+  return likely(op == op_end) ? MDBX_SUCCESS : MDBX_CORRUPTED;
+}
 
-  if (unlikely(mc->mc_db->md_flags & MDBX_DUPSORT))
-    return MDBX_INCOMPATIBLE /* must be a non-dupsort subDB */;
+static const MDBX_codec codec_builtin = {lz_compress, lz_decompress, nullptr};
 
-  switch (op) {
-  case MDBX_FIRST:
-    rc = cursor_first_batch(mc);
-    break;
-  case MDBX_NEXT:
-    rc = cursor_next_batch(mc);
-    break;
-  case MDBX_GET_CURRENT:
-    rc = likely(mc->mc_flags & C_INITIALIZED) ? MDBX_SUCCESS : MDBX_ENODATA;
-    break;
-  default:
-    DEBUG("unhandled/unimplemented cursor operation %u", op);
-    rc = MDBX_EINVAL;
-    break;
-  }
+const MDBX_codec *mdbx_codec_builtin(void) { return &codec_builtin; }
 
-  if (unlikely(rc != MDBX_SUCCESS)) {
-    *count = 0;
-    return rc;
-  }
+/* Распакованные значения размещаются в участках памяти транзакции, которые
+ * освобождаются только по ее завершении, так как возвращенные приложению
+ * данные должны оставаться валидными. */
+typedef struct codec_chunk {
+  struct codec_chunk *next;
+  size_t size, used;
+} codec_chunk_t;
+#define CODEC_CHUNK_SIZE ((size_t)64 << 10)
 
-  const MDBX_page *const mp = mc->mc_pg[mc->mc_top];
-  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
-    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
-          mp->mp_pgno, mp->mp_flags);
-    return MDBX_CORRUPTED;
-  }
-  const size_t nkeys = page_numkeys(mp);
-  size_t i = mc->mc_ki[mc->mc_top], n = 0;
-  if (unlikely(i >= nkeys)) {
-    cASSERT(mc, op == MDBX_GET_CURRENT);
-    cASSERT(mc, mdbx_cursor_on_last(mc) == MDBX_RESULT_TRUE);
-    *count = 0;
-    if (mc->mc_flags & C_EOF) {
-      cASSERT(mc, mdbx_cursor_on_last(mc) == MDBX_RESULT_TRUE);
-      return MDBX_ENODATA;
+static void *codec_alloc(MDBX_txn *txn, size_t bytes) {
+  /* замороженная пишущая транзакция читается из нескольких потоков */
+  const bool shared = (txn->mt_flags & MDBX_TXN_FROZEN) != 0;
+  if (shared)
+    while (!atomic_cas32(&txn->mt_codec_lock, 0, 1))
+      atomic_yield();
+
+  bytes = ceil_powerof2(bytes, sizeof(uint64_t));
+  void *ptr = nullptr;
+  codec_chunk_t *const head = txn->mt_codec_arena;
+  if (head && head->size - head->used >= bytes) {
+    ptr = ptr_disp(head + 1, head->used);
+    head->used += bytes;
+  } else {
+    const size_t size =
+        (bytes > CODEC_CHUNK_SIZE / 4) ? bytes : CODEC_CHUNK_SIZE;
+    codec_chunk_t *const chunk = osal_malloc(sizeof(codec_chunk_t) + size);
+    if (likely(chunk)) {
+      chunk->size = size;
+      chunk->used = bytes;
+      ptr = chunk + 1;
+      if (head && size == bytes) {
+        /* большое значение не вытесняет текущий участок */
+        chunk->next = head->next;
+        head->next = chunk;
+      } else {
+        chunk->next = head;
+        txn->mt_codec_arena = chunk;
+      }
     }
-    if (mdbx_cursor_on_last(mc) != MDBX_RESULT_TRUE)
-      return MDBX_EINVAL /* again MDBX_GET_CURRENT after MDBX_GET_CURRENT */;
-    mc->mc_flags |= C_EOF;
-    return MDBX_NOTFOUND;
   }
 
-  do {
-    if (unlikely(n + 2 > limit)) {
-      rc = MDBX_RESULT_TRUE;
-      break;
-    }
-    const MDBX_node *leaf = page_node(mp, i);
-    get_key(leaf, &pairs[n]);
-    rc = node_read(mc, leaf, &pairs[n + 1], mp);
-    if (unlikely(rc != MDBX_SUCCESS))
-      break;
-    n += 2;
-  } while (++i < nkeys);
+  if (shared)
+    atomic_store32(&txn->mt_codec_lock, 0, mo_AcquireRelease);
+  return ptr;
+}
 
-  mc->mc_ki[mc->mc_top] = (indx_t)i;
-  *count = n;
-  return rc;
+static void codec_release(MDBX_txn *txn) {
+  while (txn->mt_codec_arena) {
+    codec_chunk_t *const chunk = txn->mt_codec_arena;
+    txn->mt_codec_arena = chunk->next;
+    osal_free(chunk);
+  }
+  if (txn->mt_codec_buf) {
+    osal_free(txn->mt_codec_buf);
+    txn->mt_codec_buf = nullptr;
+    txn->mt_codec_bufsize = 0;
+  }
 }
 
-static int touch_dbi(MDBX_cursor *mc) {
-  cASSERT(mc, (*mc->mc_dbistate & DBI_DIRTY) == 0);
-  *mc->mc_dbistate |= DBI_DIRTY;
-  mc->mc_txn->mt_flags |= MDBX_TXN_DIRTY;
-  if (mc->mc_dbi >= CORE_DBS) {
-    /* Touch DB record of named DB */
-    MDBX_cursor_couple cx;
-    int rc = cursor_init(&cx.outer, mc->mc_txn, MAIN_DBI);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    mc->mc_txn->mt_dbistate[MAIN_DBI] |= DBI_DIRTY;
-    rc = page_search(&cx.outer, &mc->mc_dbx->md_name, MDBX_PS_MODIFY);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
+/* Сжимает значение для записи в таблицу. Возвращает MDBX_RESULT_TRUE,
+ * если значение следует сохранить как есть. */
+static int codec_encode(MDBX_txn *txn, const MDBX_codec *codec,
+                        const MDBX_val *data, MDBX_val *packed) {
+  /* сжатие должно экономить хотя-бы 1/8 */
+  const size_t room = data->iov_len - data->iov_len / 8 - CODEC_HEADER;
+  if (txn->mt_codec_bufsize < CODEC_HEADER + room) {
+    void *const buf = osal_realloc(txn->mt_codec_buf, CODEC_HEADER + room);
+    if (unlikely(!buf))
+      return MDBX_ENOMEM;
+    txn->mt_codec_buf = buf;
+    txn->mt_codec_bufsize = CODEC_HEADER + room;
   }
+
+  uint8_t *const buf = txn->mt_codec_buf;
+  const size_t bytes = codec->compress(codec->ctx, data->iov_base,
+                                       data->iov_len, buf + CODEC_HEADER, room);
+  if (bytes == 0 || bytes > room)
+    return MDBX_RESULT_TRUE;
+
+  buf[0] = (codec == &codec_builtin) ? CODEC_BUILTIN : CODEC_CUSTOM;
+  unaligned_poke_u32(1, buf + 1, (uint32_t)data->iov_len);
+  packed->iov_base = buf;
+  packed->iov_len = CODEC_HEADER + bytes;
   return MDBX_SUCCESS;
 }
 
-static __hot int cursor_touch(MDBX_cursor *const mc, const MDBX_val *key,
-                              const MDBX_val *data) {
-  cASSERT(mc, (mc->mc_txn->mt_flags & MDBX_TXN_RDONLY) == 0);
-  cASSERT(mc, (mc->mc_flags & C_INITIALIZED) || mc->mc_snum == 0);
-  cASSERT(mc, cursor_is_tracked(mc));
+/* Распаковывает сжатое значение в память транзакции */
+static __noinline int codec_decode(MDBX_cursor *mc, const MDBX_val *packed,
+                                   MDBX_val *data) {
+  const uint8_t *const header = packed->iov_base;
+  if (unlikely(packed->iov_len <= CODEC_HEADER))
+    goto bailout;
 
-  if ((mc->mc_flags & C_SUB) == 0) {
-    MDBX_txn *const txn = mc->mc_txn;
-    txn_lru_turn(txn);
+  if (header[0] == CODEC_VLOG)
+    return vlog_fetch(mc, packed, data);
 
-    if (unlikely((*mc->mc_dbistate & DBI_DIRTY) == 0)) {
-      int err = touch_dbi(mc);
-      if (unlikely(err != MDBX_SUCCESS))
-        return err;
+  const MDBX_codec *codec = &codec_builtin;
+  if (header[0] != CODEC_BUILTIN) {
+    if (unlikely(header[0] != CODEC_CUSTOM))
+      goto bailout;
+    codec = mc->mc_dbx->md_codec;
+    if (unlikely(!codec || codec == &codec_builtin)) {
+      NOTICE("value of table %u is packed by a custom codec, "
+            "but no one is set",
+            mc->mc_dbi);
+      return MDBX_INCOMPATIBLE;
     }
+  }
 
-    /* Estimate how much space this operation will take: */
-    /* 1) Max b-tree height, reasonable enough with including dups' sub-tree */
-    size_t need = CURSOR_STACK + 3;
-    /* 2) GC/FreeDB for any payload */
-    if (mc->mc_dbi > FREE_DBI) {
-      need += txn->mt_dbs[FREE_DBI].md_depth + (size_t)3;
-      /* 3) Named DBs also dirty the main DB */
-      if (mc->mc_dbi > MAIN_DBI)
-        need += txn->mt_dbs[MAIN_DBI].md_depth + (size_t)3;
-    }
-#if xMDBX_DEBUG_SPILLING != 2
-    /* production mode */
-    /* 4) Double the page chain estimation
-     * for extensively splitting, rebalance and merging */
-    need += need;
-    /* 5) Factor the key+data which to be put in */
-    need += bytes2pgno(txn->mt_env, node_size(key, data)) + (size_t)1;
-#else
-    /* debug mode */
-    (void)key;
-    (void)data;
-    txn->mt_env->debug_dirtied_est = ++need;
-    txn->mt_env->debug_dirtied_act = 0;
-#endif /* xMDBX_DEBUG_SPILLING == 2 */
+  const size_t length = unaligned_peek_u32(1, header + 1);
+  if (unlikely(length > MDBX_MAXDATASIZE))
+    goto bailout;
+  void *const ptr = codec_alloc(mc->mc_txn, length);
+  if (unlikely(!ptr))
+    return MDBX_ENOMEM;
+  const int rc = codec->decompress(codec->ctx, header + CODEC_HEADER,
+                                   packed->iov_len - CODEC_HEADER, ptr, length);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  data->iov_base = ptr;
+  data->iov_len = length;
+  return MDBX_SUCCESS;
 
-    int err = txn_spill(txn, mc, need);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
-  }
+bailout:
+  ERROR("invalid packed value (%zu bytes) of table %u", packed->iov_len,
+        mc->mc_dbi);
+  return MDBX_CORRUPTED;
+}
 
-  int rc = MDBX_SUCCESS;
-  if (likely(mc->mc_snum)) {
-    mc->mc_top = 0;
-    do {
-      rc = page_touch(mc);
-      if (unlikely(rc != MDBX_SUCCESS))
-        break;
-      mc->mc_top += 1;
-    } while (mc->mc_top < mc->mc_snum);
-    mc->mc_top = mc->mc_snum - 1;
+/* Распаковывает значение в текущей позиции курсора, если оно хранится сжатым
+ * и data указывает на хранимые данные. Вызывается на границе API, так как
+ * внутренним операциям распакованное значение не требуется. */
+static int cursor_unpack(MDBX_cursor *mc, MDBX_val *data) {
+  if (!data || !(mc->mc_flags & C_INITIALIZED))
+    return MDBX_SUCCESS;
+  const MDBX_page *const mp = mc->mc_pg[mc->mc_top];
+  if (IS_LEAF2(mp) || mc->mc_ki[mc->mc_top] >= page_numkeys(mp))
+    return MDBX_SUCCESS;
+  const MDBX_node *const node = page_node(mp, mc->mc_ki[mc->mc_top]);
+  if (likely((node_flags(node) & F_COMPRESSED) == 0))
+    return MDBX_SUCCESS;
+
+  MDBX_val packed;
+  int rc = node_read(mc, node, &packed, mp);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (packed.iov_base != data->iov_base || packed.iov_len != data->iov_len)
+    return MDBX_SUCCESS /* data is not the stored value */;
+  return codec_decode(mc, &packed, data);
+}
+
+/* Признак сжатия значения в текущей позиции курсора */
+static __always_inline unsigned cursor_packed(const MDBX_cursor *mc) {
+  const MDBX_page *const mp = mc->mc_pg[mc->mc_top];
+  return IS_LEAF2(mp) ? 0
+                      : node_flags(page_node(mp, mc->mc_ki[mc->mc_top])) &
+                            F_COMPRESSED;
+}
+
+int mdbx_get(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key, MDBX_val *data) {
+  DKBUF_DEBUG;
+  DEBUG("===> get db %u key [%s]", dbi, DKEY_DEBUG(key));
+
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!key || !data))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(txn->mt_flags & MDBX_TXN_OPTIMISTIC))
+    return optimistic_get(txn, dbi, key, data);
+
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  rc = cursor_set(&cx.outer, (MDBX_val *)key, data, MDBX_SET).err;
+  return unlikely(rc != MDBX_SUCCESS) ? rc : cursor_unpack(&cx.outer, data);
+}
+
+int mdbx_get_equal_or_great(MDBX_txn *txn, MDBX_dbi dbi, MDBX_val *key,
+                            MDBX_val *data) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!key || !data))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(txn->mt_flags & MDBX_TXN_BLOCKED))
+    return MDBX_BAD_TXN;
+
+  if (unlikely(txn->mt_flags & MDBX_TXN_OPTIMISTIC))
+    return MDBX_INCOMPATIBLE;
+
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  rc = cursor_get(&cx.outer, key, data, MDBX_SET_LOWERBOUND);
+  if (rc == MDBX_SUCCESS || rc == MDBX_RESULT_TRUE) {
+    const int err = cursor_unpack(&cx.outer, data);
+    if (unlikely(err != MDBX_SUCCESS))
+      rc = err;
   }
   return rc;
 }
 
-static __hot int cursor_put_nochecklen(MDBX_cursor *mc, const MDBX_val *key,
-                                       MDBX_val *data, unsigned flags) {
-  MDBX_page *sub_root = nullptr;
-  MDBX_val xdata, *rdata, dkey, olddata;
-  MDBX_db nested_dupdb;
-  int err;
+int mdbx_get_ex(MDBX_txn *txn, MDBX_dbi dbi, MDBX_val *key, MDBX_val *data,
+                size_t *values_count) {
   DKBUF_DEBUG;
-  MDBX_env *const env = mc->mc_txn->mt_env;
-  DEBUG("==> put db %d key [%s], size %" PRIuPTR ", data [%s] size %" PRIuPTR,
-        DDBI(mc), DKEY_DEBUG(key), key->iov_len,
-        DVAL_DEBUG((flags & MDBX_RESERVE) ? nullptr : data), data->iov_len);
+  DEBUG("===> get db %u key [%s]", dbi, DKEY_DEBUG(key));
 
-  int dupdata_flag = 0;
-  if ((flags & MDBX_CURRENT) != 0 && (mc->mc_flags & C_SUB) == 0) {
-    if (unlikely(flags & (MDBX_APPEND | MDBX_NOOVERWRITE)))
-      return MDBX_EINVAL;
-    /* Опция MDBX_CURRENT означает, что запрошено обновление текущей записи,
-     * на которой сейчас стоит курсор. Проверяем что переданный ключ совпадает
-     * со значением в текущей позиции курсора.
-     * Здесь проще вызвать cursor_get(), так как для обслуживания таблиц
-     * с MDBX_DUPSORT также требуется текущий размер данных. */
-    MDBX_val current_key, current_data;
-    err = cursor_get(mc, &current_key, &current_data, MDBX_GET_CURRENT);
-    if (unlikely(err != MDBX_SUCCESS))
-      return err;
-    if (mc->mc_dbx->md_cmp(key, &current_key) != 0)
-      return MDBX_EKEYMISMATCH;
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-    if (unlikely((flags & MDBX_MULTIPLE)))
-      goto drop_current;
+  if (unlikely(!key || !data))
+    return MDBX_EINVAL;
 
-    if (mc->mc_db->md_flags & MDBX_DUPSORT) {
-      MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(txn->mt_flags & MDBX_TXN_OPTIMISTIC)) {
+    rc = optimistic_get(txn, dbi, key, data);
+    if (values_count)
+      *values_count = (rc == MDBX_SUCCESS);
+    return rc;
+  }
+
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  rc = cursor_set(&cx.outer, key, data, MDBX_SET_KEY).err;
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    if (rc == MDBX_NOTFOUND && values_count)
+      *values_count = 0;
+    return rc;
+  }
+  rc = cursor_unpack(&cx.outer, data);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (values_count) {
+    *values_count = 1;
+    if (cx.outer.mc_xcursor != NULL) {
+      MDBX_node *node = page_node(cx.outer.mc_pg[cx.outer.mc_top],
+                                  cx.outer.mc_ki[cx.outer.mc_top]);
       if (node_flags(node) & F_DUPDATA) {
-        cASSERT(mc, mc->mc_xcursor != NULL &&
-                        (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED));
-        /* Если за ключом более одного значения, либо если размер данных
-         * отличается, то вместо обновления требуется удаление и
-         * последующая вставка. */
-        if (mc->mc_xcursor->mx_db.md_entries > 1 ||
-            current_data.iov_len != data->iov_len) {
-        drop_current:
-          err = cursor_del(mc, flags & MDBX_ALLDUPS);
-          if (unlikely(err != MDBX_SUCCESS))
-            return err;
-          flags -= MDBX_CURRENT;
-          goto skip_check_samedata;
-        }
-      } else if (unlikely(node_size(key, data) > env->me_leaf_nodemax)) {
-        err = cursor_del(mc, 0);
-        if (unlikely(err != MDBX_SUCCESS))
-          return err;
-        flags -= MDBX_CURRENT;
-        goto skip_check_samedata;
+        // coverity[uninit_use : FALSE]
+        tASSERT(txn, cx.outer.mc_xcursor == &cx.inner &&
+                         (cx.inner.mx_cursor.mc_flags & C_INITIALIZED));
+        // coverity[uninit_use : FALSE]
+        *values_count =
+            (sizeof(*values_count) >= sizeof(cx.inner.mx_db.md_entries) ||
+             cx.inner.mx_db.md_entries <= PTRDIFF_MAX)
+                ? (size_t)cx.inner.mx_db.md_entries
+                : PTRDIFF_MAX;
       }
     }
-    if (!(flags & MDBX_RESERVE) &&
-        unlikely(cmp_lenfast(&current_data, data) == 0))
-      return MDBX_SUCCESS /* the same data, nothing to update */;
-  skip_check_samedata:;
   }
+  return MDBX_SUCCESS;
+}
 
-  int rc = MDBX_SUCCESS;
-  if (mc->mc_db->md_root == P_INVALID) {
-    /* new database, cursor has nothing to point to */
-    mc->mc_snum = 0;
-    mc->mc_top = 0;
-    mc->mc_flags &= ~C_INITIALIZED;
-    rc = MDBX_NO_ROOT;
-  } else if ((flags & MDBX_CURRENT) == 0) {
-    bool exact = false;
-    if ((flags & MDBX_APPEND) && mc->mc_db->md_entries > 0) {
-      rc = cursor_last(mc, &dkey, &olddata);
-      if (likely(rc == MDBX_SUCCESS)) {
-        const int cmp = mc->mc_dbx->md_cmp(key, &dkey);
-        if (likely(cmp > 0)) {
-          mc->mc_ki[mc->mc_top]++; /* step forward for appending */
-          rc = MDBX_NOTFOUND;
-        } else if (unlikely(cmp != 0)) {
-          /* new-key < last-key */
-          return MDBX_EKEYMISMATCH;
-        } else {
-          rc = MDBX_SUCCESS;
-          exact = true;
+/* Find a sibling for a page.
+ * Replaces the page at the top of the cursor's stack with the specified
+ * sibling, if one exists.
+ *
+ * [in] mc    The cursor for this operation.
+ * [in] dir   SIBLING_LEFT or SIBLING_RIGHT.
+ *
+ * Returns 0 on success, non-zero on failure. */
+static int cursor_sibling(MDBX_cursor *mc, int dir) {
+  int rc;
+  MDBX_node *node;
+  MDBX_page *mp;
+  assert(dir == SIBLING_LEFT || dir == SIBLING_RIGHT);
+
+  if (unlikely(mc->mc_snum < 2))
+    return MDBX_NOTFOUND; /* root has no siblings */
+
+  cursor_pop(mc);
+  DEBUG("parent page is page %" PRIaPGNO ", index %u",
+        mc->mc_pg[mc->mc_top]->mp_pgno, mc->mc_ki[mc->mc_top]);
+
+  if ((dir == SIBLING_RIGHT) ? (mc->mc_ki[mc->mc_top] + (size_t)1 >=
+                                page_numkeys(mc->mc_pg[mc->mc_top]))
+                             : (mc->mc_ki[mc->mc_top] == 0)) {
+    DEBUG("no more keys aside, moving to next %s sibling",
+          dir ? "right" : "left");
+    if (unlikely((rc = cursor_sibling(mc, dir)) != MDBX_SUCCESS)) {
+      /* undo cursor_pop before returning */
+      mc->mc_top++;
+      mc->mc_snum++;
+      return rc;
+    }
+  } else {
+    assert((dir - 1) == -1 || (dir - 1) == 1);
+    mc->mc_ki[mc->mc_top] += (indx_t)(dir - 1);
+    DEBUG("just moving to %s index key %u",
+          (dir == SIBLING_RIGHT) ? "right" : "left", mc->mc_ki[mc->mc_top]);
+  }
+  cASSERT(mc, IS_BRANCH(mc->mc_pg[mc->mc_top]));
+
+  node = page_node(mp = mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+  rc = page_get(mc, node_pgno(node), &mp, mp->mp_txnid);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    /* mc will be inconsistent if caller does mc_snum++ as above */
+    mc->mc_flags &= ~(C_INITIALIZED | C_EOF);
+    return rc;
+  }
+
+  rc = cursor_push(mc, mp);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  mc->mc_ki[mc->mc_top] =
+      (dir == SIBLING_LEFT) ? (indx_t)page_numkeys(mp) - 1 : 0;
+  return MDBX_SUCCESS;
+}
+
+/* Move the cursor to the next data item. */
+static int cursor_next(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
+                       MDBX_cursor_op op) {
+  MDBX_page *mp;
+  MDBX_node *node;
+  int rc;
+
+  if (unlikely(mc->mc_flags & C_DEL) && op == MDBX_NEXT_DUP)
+    return MDBX_NOTFOUND;
+
+  if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
+    return cursor_first(mc, key, data);
+
+  mp = mc->mc_pg[mc->mc_top];
+  if (unlikely(mc->mc_flags & C_EOF)) {
+    if (mc->mc_ki[mc->mc_top] + (size_t)1 >= page_numkeys(mp))
+      return MDBX_NOTFOUND;
+    mc->mc_flags ^= C_EOF;
+  }
+
+  if (mc->mc_db->md_flags & MDBX_DUPSORT) {
+    node = page_node(mp, mc->mc_ki[mc->mc_top]);
+    if (node_flags(node) & F_DUPDATA) {
+      if (op == MDBX_NEXT || op == MDBX_NEXT_DUP) {
+        rc = cursor_next(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_NEXT);
+        if (op != MDBX_NEXT || rc != MDBX_NOTFOUND) {
+          if (likely(rc == MDBX_SUCCESS))
+            get_key_optional(node, key);
+          return rc;
         }
       }
     } else {
-      struct cursor_set_result csr =
-          /* olddata may not be updated in case LEAF2-page of dupfixed-subDB */
-          cursor_set(mc, (MDBX_val *)key, &olddata, MDBX_SET);
-      rc = csr.err;
-      exact = csr.exact;
+      mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
+      if (op == MDBX_NEXT_DUP)
+        return MDBX_NOTFOUND;
     }
-    if (likely(rc == MDBX_SUCCESS)) {
-      if (exact) {
-        if (unlikely(flags & MDBX_NOOVERWRITE)) {
-          DEBUG("duplicate key [%s]", DKEY_DEBUG(key));
-          *data = olddata;
-          return MDBX_KEYEXIST;
-        }
-        if (unlikely(mc->mc_flags & C_SUB)) {
-          /* nested subtree of DUPSORT-database with the same key,
-           * nothing to update */
-          eASSERT(env, data->iov_len == 0 &&
-                           (olddata.iov_len == 0 ||
-                            /* olddata may not be updated in case LEAF2-page
-                               of dupfixed-subDB */
-                            (mc->mc_db->md_flags & MDBX_DUPFIXED)));
-          return MDBX_SUCCESS;
-        }
-        if (unlikely(flags & MDBX_ALLDUPS) && mc->mc_xcursor &&
-            (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED)) {
-          err = cursor_del(mc, MDBX_ALLDUPS);
-          if (unlikely(err != MDBX_SUCCESS))
-            return err;
-          flags -= MDBX_ALLDUPS;
-          rc = mc->mc_snum ? MDBX_NOTFOUND : MDBX_NO_ROOT;
-          exact = false;
-        } else if (!(flags & (MDBX_RESERVE | MDBX_MULTIPLE))) {
-          /* checking for early exit without dirtying pages */
-          if (unlikely(eq_fast(data, &olddata))) {
-            cASSERT(mc, mc->mc_dbx->md_dcmp(data, &olddata) == 0);
-            if (mc->mc_xcursor) {
-              if (flags & MDBX_NODUPDATA)
-                return MDBX_KEYEXIST;
-              if (flags & MDBX_APPENDDUP)
-                return MDBX_EKEYMISMATCH;
-            }
-            /* the same data, nothing to update */
-            return MDBX_SUCCESS;
-          }
-          cASSERT(mc, mc->mc_dbx->md_dcmp(data, &olddata) != 0);
-        }
-      }
-    } else if (unlikely(rc != MDBX_NOTFOUND))
-      return rc;
   }
 
-  mc->mc_flags &= ~C_DEL;
-  rdata = data;
-  size_t mcount = 0, dcount = 0;
-  if (unlikely(flags & MDBX_MULTIPLE)) {
-    dcount = data[1].iov_len;
-    data[1].iov_len = 0 /* reset done item counter */;
-    rdata = &xdata;
-    xdata.iov_len = data->iov_len * dcount;
+  DEBUG("cursor_next: top page is %" PRIaPGNO " in cursor %p", mp->mp_pgno,
+        (void *)mc);
+  if (mc->mc_flags & C_DEL) {
+    mc->mc_flags ^= C_DEL;
+    goto skip;
   }
 
-  /* Cursor is positioned, check for room in the dirty list */
-  err = cursor_touch(mc, key, rdata);
-  if (unlikely(err))
-    return err;
+  intptr_t ki = mc->mc_ki[mc->mc_top];
+  mc->mc_ki[mc->mc_top] = (indx_t)++ki;
+  const intptr_t numkeys = page_numkeys(mp);
+  if (unlikely(ki >= numkeys)) {
+    DEBUG("%s", "=====> move to next sibling page");
+    mc->mc_ki[mc->mc_top] = (indx_t)(numkeys - 1);
+    rc = cursor_sibling(mc, SIBLING_RIGHT);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      mc->mc_flags |= C_EOF;
+      return rc;
+    }
+    mp = mc->mc_pg[mc->mc_top];
+    DEBUG("next page is %" PRIaPGNO ", key index %u", mp->mp_pgno,
+          mc->mc_ki[mc->mc_top]);
+  }
 
-  if (unlikely(rc == MDBX_NO_ROOT)) {
-    /* new database, write a root leaf page */
-    DEBUG("%s", "allocating new root leaf page");
-    pgr_t npr = page_new(mc, P_LEAF);
-    if (unlikely(npr.err != MDBX_SUCCESS))
-      return npr.err;
-    npr.err = cursor_push(mc, npr.page);
-    if (unlikely(npr.err != MDBX_SUCCESS))
-      return npr.err;
-    mc->mc_db->md_root = npr.page->mp_pgno;
-    mc->mc_db->md_depth++;
-    if (mc->mc_db->md_flags & MDBX_INTEGERKEY) {
-      assert(key->iov_len >= mc->mc_dbx->md_klen_min &&
-             key->iov_len <= mc->mc_dbx->md_klen_max);
-      mc->mc_dbx->md_klen_min = mc->mc_dbx->md_klen_max = key->iov_len;
-    }
-    if (mc->mc_db->md_flags & (MDBX_INTEGERDUP | MDBX_DUPFIXED)) {
-      assert(data->iov_len >= mc->mc_dbx->md_vlen_min &&
-             data->iov_len <= mc->mc_dbx->md_vlen_max);
-      assert(mc->mc_xcursor != NULL);
-      mc->mc_db->md_xsize = mc->mc_xcursor->mx_db.md_xsize =
-          (unsigned)(mc->mc_dbx->md_vlen_min = mc->mc_dbx->md_vlen_max =
-                         mc->mc_xcursor->mx_dbx.md_klen_min =
-                             mc->mc_xcursor->mx_dbx.md_klen_max =
-                                 data->iov_len);
-    }
-    if ((mc->mc_db->md_flags & (MDBX_DUPSORT | MDBX_DUPFIXED)) == MDBX_DUPFIXED)
-      npr.page->mp_flags |= P_LEAF2;
-    mc->mc_flags |= C_INITIALIZED;
-  }
-
-  bool insert_key, insert_data, do_sub = false;
-  insert_key = insert_data = (rc != MDBX_SUCCESS);
-  uint16_t fp_flags = P_LEAF;
-  MDBX_page *fp = env->me_pbuf;
-  fp->mp_txnid = mc->mc_txn->mt_front;
-  if (insert_key) {
-    /* The key does not exist */
-    DEBUG("inserting key at index %i", mc->mc_ki[mc->mc_top]);
-    if ((mc->mc_db->md_flags & MDBX_DUPSORT) &&
-        node_size(key, data) > env->me_leaf_nodemax) {
-      /* Too big for a node, insert in sub-DB.  Set up an empty
-       * "old sub-page" for prep_subDB to expand to a full page. */
-      fp->mp_leaf2_ksize =
-          (mc->mc_db->md_flags & MDBX_DUPFIXED) ? (uint16_t)data->iov_len : 0;
-      fp->mp_lower = fp->mp_upper = 0;
-      olddata.iov_len = PAGEHDRSZ;
-      goto prep_subDB;
-    }
-  } else {
-    /* there's only a key anyway, so this is a no-op */
-    if (IS_LEAF2(mc->mc_pg[mc->mc_top])) {
-      size_t ksize = mc->mc_db->md_xsize;
-      if (unlikely(key->iov_len != ksize))
-        return MDBX_BAD_VALSIZE;
-      void *ptr =
-          page_leaf2key(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top], ksize);
-      memcpy(ptr, key->iov_base, ksize);
-    fix_parent:
-      /* if overwriting slot 0 of leaf, need to
-       * update branch key if there is a parent page */
-      if (mc->mc_top && !mc->mc_ki[mc->mc_top]) {
-        size_t dtop = 1;
-        mc->mc_top--;
-        /* slot 0 is always an empty key, find real slot */
-        while (mc->mc_top && !mc->mc_ki[mc->mc_top]) {
-          mc->mc_top--;
-          dtop++;
-        }
-        err = MDBX_SUCCESS;
-        if (mc->mc_ki[mc->mc_top])
-          err = update_key(mc, key);
-        cASSERT(mc, mc->mc_top + dtop < UINT16_MAX);
-        mc->mc_top += (uint8_t)dtop;
-        if (unlikely(err != MDBX_SUCCESS))
-          return err;
-      }
+skip:
+  DEBUG("==> cursor points to page %" PRIaPGNO " with %zu keys, key index %u",
+        mp->mp_pgno, page_numkeys(mp), mc->mc_ki[mc->mc_top]);
 
-      if (AUDIT_ENABLED()) {
-        err = cursor_check(mc);
-        if (unlikely(err != MDBX_SUCCESS))
-          return err;
-      }
-      return MDBX_SUCCESS;
-    }
+  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+          mp->mp_pgno, mp->mp_flags);
+    return MDBX_CORRUPTED;
+  }
 
-  more:;
-    if (AUDIT_ENABLED()) {
-      err = cursor_check(mc);
-      if (unlikely(err != MDBX_SUCCESS))
-        return err;
-    }
-    MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+  if (IS_LEAF2(mp)) {
+    leaf2_read(mc, mp, mc->mc_ki[mc->mc_top], key, data);
+    return MDBX_SUCCESS;
+  }
 
-    /* Large/Overflow page overwrites need special handling */
-    if (unlikely(node_flags(node) & F_BIGDATA)) {
-      const size_t dpages = (node_size(key, data) > env->me_leaf_nodemax)
-                                ? number_of_ovpages(env, data->iov_len)
-                                : 0;
+  node = page_node(mp, mc->mc_ki[mc->mc_top]);
+  if (node_flags(node) & F_DUPDATA) {
+    rc = cursor_xinit1(mc, node, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    rc = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  } else if (likely(data)) {
+    rc = node_read(mc, node, data, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
 
-      const pgno_t pgno = node_largedata_pgno(node);
-      pgr_t lp = page_get_large(mc, pgno, mc->mc_pg[mc->mc_top]->mp_txnid);
-      if (unlikely(lp.err != MDBX_SUCCESS))
-        return lp.err;
-      cASSERT(mc, PAGETYPE_WHOLE(lp.page) == P_OVERFLOW);
+  get_key_optional(node, key);
+  return MDBX_SUCCESS;
+}
 
-      /* Is the ov page from this txn (or a parent) and big enough? */
-      const size_t ovpages = lp.page->mp_pages;
-      const size_t extra_threshold =
-          (mc->mc_dbi == FREE_DBI)
-              ? 1
-              : /* LY: add configurable threshold to keep reserve space */ 0;
-      if (!IS_FROZEN(mc->mc_txn, lp.page) && ovpages >= dpages &&
-          ovpages <= dpages + extra_threshold) {
-        /* yes, overwrite it. */
-        if (!IS_MODIFIABLE(mc->mc_txn, lp.page)) {
-          if (IS_SPILLED(mc->mc_txn, lp.page)) {
-            lp = /* TODO: avoid search and get txn & spill-index from
-                     page_result */
-                page_unspill(mc->mc_txn, lp.page);
-            if (unlikely(lp.err))
-              return lp.err;
-          } else {
-            if (unlikely(!mc->mc_txn->mt_parent)) {
-              ERROR("Unexpected not frozen/modifiable/spilled but shadowed %s "
-                    "page %" PRIaPGNO " mod-txnid %" PRIaTXN ","
-                    " without parent transaction, current txn %" PRIaTXN
-                    " front %" PRIaTXN,
-                    "overflow/large", pgno, lp.page->mp_txnid,
-                    mc->mc_txn->mt_txnid, mc->mc_txn->mt_front);
-              return MDBX_PROBLEM;
-            }
+/* Move the cursor to the previous data item. */
+static int cursor_prev(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
+                       MDBX_cursor_op op) {
+  MDBX_page *mp;
+  MDBX_node *node;
+  int rc;
 
-            /* It is writable only in a parent txn */
-            MDBX_page *np = page_malloc(mc->mc_txn, ovpages);
-            if (unlikely(!np))
-              return MDBX_ENOMEM;
+  if (unlikely(mc->mc_flags & C_DEL) && op == MDBX_PREV_DUP)
+    return MDBX_NOTFOUND;
 
-            memcpy(np, lp.page, PAGEHDRSZ); /* Copy header of page */
-            err = page_dirty(mc->mc_txn, lp.page = np, ovpages);
-            if (unlikely(err != MDBX_SUCCESS))
-              return err;
+  if (unlikely(!(mc->mc_flags & C_INITIALIZED))) {
+    rc = cursor_last(mc, key, data);
+    if (unlikely(rc))
+      return rc;
+    mc->mc_ki[mc->mc_top]++;
+  }
 
-#if MDBX_ENABLE_PGOP_STAT
-            mc->mc_txn->mt_env->me_lck->mti_pgop_stat.clone.weak += ovpages;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-            cASSERT(mc, dirtylist_check(mc->mc_txn));
+  mp = mc->mc_pg[mc->mc_top];
+  if ((mc->mc_db->md_flags & MDBX_DUPSORT) &&
+      mc->mc_ki[mc->mc_top] < page_numkeys(mp)) {
+    node = page_node(mp, mc->mc_ki[mc->mc_top]);
+    if (node_flags(node) & F_DUPDATA) {
+      if (op == MDBX_PREV || op == MDBX_PREV_DUP) {
+        rc = cursor_prev(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_PREV);
+        if (op != MDBX_PREV || rc != MDBX_NOTFOUND) {
+          if (likely(rc == MDBX_SUCCESS)) {
+            get_key_optional(node, key);
+            mc->mc_flags &= ~C_EOF;
           }
+          return rc;
         }
-        node_set_ds(node, data->iov_len);
-        if (flags & MDBX_RESERVE)
-          data->iov_base = page_data(lp.page);
-        else
-          memcpy(page_data(lp.page), data->iov_base, data->iov_len);
-
-        if (AUDIT_ENABLED()) {
-          err = cursor_check(mc);
-          if (unlikely(err != MDBX_SUCCESS))
-            return err;
-        }
-        return MDBX_SUCCESS;
       }
-
-      if ((err = page_retire(mc, lp.page)) != MDBX_SUCCESS)
-        return err;
     } else {
-      olddata.iov_len = node_ds(node);
-      olddata.iov_base = node_data(node);
-      cASSERT(mc, ptr_disp(olddata.iov_base, olddata.iov_len) <=
-                      ptr_disp(mc->mc_pg[mc->mc_top], env->me_psize));
-
-      /* DB has dups? */
-      if (mc->mc_db->md_flags & MDBX_DUPSORT) {
-        /* Prepare (sub-)page/sub-DB to accept the new item, if needed.
-         * fp: old sub-page or a header faking it.
-         * mp: new (sub-)page.  offset: growth in page size.
-         * xdata: node data with new page or DB. */
-        size_t i;
-        size_t offset = 0;
-        MDBX_page *mp = fp = xdata.iov_base = env->me_pbuf;
-        mp->mp_pgno = mc->mc_pg[mc->mc_top]->mp_pgno;
+      mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
+      if (op == MDBX_PREV_DUP)
+        return MDBX_NOTFOUND;
+    }
+  }
 
-        /* Was a single item before, must convert now */
-        if (!(node_flags(node) & F_DUPDATA)) {
-          /* does data match? */
-          if (flags & MDBX_APPENDDUP) {
-            const int cmp = mc->mc_dbx->md_dcmp(data, &olddata);
-            cASSERT(mc, cmp != 0 || eq_fast(data, &olddata));
-            if (unlikely(cmp <= 0))
-              return MDBX_EKEYMISMATCH;
-          } else if (eq_fast(data, &olddata)) {
-            cASSERT(mc, mc->mc_dbx->md_dcmp(data, &olddata) == 0);
-            if (flags & MDBX_NODUPDATA)
-              return MDBX_KEYEXIST;
-            /* data is match exactly byte-to-byte, nothing to update */
-            rc = MDBX_SUCCESS;
-            if (likely((flags & MDBX_MULTIPLE) == 0))
-              return rc;
-            goto continue_multiple;
-          }
+  DEBUG("cursor_prev: top page is %" PRIaPGNO " in cursor %p", mp->mp_pgno,
+        (void *)mc);
 
-          /* Just overwrite the current item */
-          if (flags & MDBX_CURRENT) {
-            cASSERT(mc, node_size(key, data) <= env->me_leaf_nodemax);
-            goto current;
-          }
+  mc->mc_flags &= ~(C_EOF | C_DEL);
 
-          /* Back up original data item */
-          memcpy(dkey.iov_base = fp + 1, olddata.iov_base,
-                 dkey.iov_len = olddata.iov_len);
-          dupdata_flag = 1;
+  int ki = mc->mc_ki[mc->mc_top];
+  mc->mc_ki[mc->mc_top] = (indx_t)--ki;
+  if (unlikely(ki < 0)) {
+    mc->mc_ki[mc->mc_top] = 0;
+    DEBUG("%s", "=====> move to prev sibling page");
+    if ((rc = cursor_sibling(mc, SIBLING_LEFT)) != MDBX_SUCCESS)
+      return rc;
+    mp = mc->mc_pg[mc->mc_top];
+    DEBUG("prev page is %" PRIaPGNO ", key index %u", mp->mp_pgno,
+          mc->mc_ki[mc->mc_top]);
+  }
+  DEBUG("==> cursor points to page %" PRIaPGNO " with %zu keys, key index %u",
+        mp->mp_pgno, page_numkeys(mp), mc->mc_ki[mc->mc_top]);
 
-          /* Make sub-page header for the dup items, with dummy body */
-          fp->mp_flags = P_LEAF | P_SUBP;
-          fp->mp_lower = 0;
-          xdata.iov_len = PAGEHDRSZ + dkey.iov_len + data->iov_len;
-          if (mc->mc_db->md_flags & MDBX_DUPFIXED) {
-            fp->mp_flags |= P_LEAF2;
-            fp->mp_leaf2_ksize = (uint16_t)data->iov_len;
-            xdata.iov_len += 2 * data->iov_len; /* leave space for 2 more */
-            cASSERT(mc, xdata.iov_len <= env->me_psize);
-          } else {
-            xdata.iov_len += 2 * (sizeof(indx_t) + NODESIZE) +
-                             (dkey.iov_len & 1) + (data->iov_len & 1);
-            cASSERT(mc, xdata.iov_len <= env->me_psize);
-          }
-          fp->mp_upper = (uint16_t)(xdata.iov_len - PAGEHDRSZ);
-          olddata.iov_len = xdata.iov_len; /* pretend olddata is fp */
-        } else if (node_flags(node) & F_SUBDATA) {
-          /* Data is on sub-DB, just store it */
-          flags |= F_DUPDATA | F_SUBDATA;
-          goto put_sub;
-        } else {
-          /* Data is on sub-page */
-          fp = olddata.iov_base;
-          switch (flags) {
-          default:
-            if (!(mc->mc_db->md_flags & MDBX_DUPFIXED)) {
-              offset = node_size(data, nullptr) + sizeof(indx_t);
-              break;
-            }
-            offset = fp->mp_leaf2_ksize;
-            if (page_room(fp) < offset) {
-              offset *= 4; /* space for 4 more */
-              break;
-            }
-            /* FALLTHRU: Big enough MDBX_DUPFIXED sub-page */
-            __fallthrough;
-          case MDBX_CURRENT | MDBX_NODUPDATA:
-          case MDBX_CURRENT:
-            fp->mp_txnid = mc->mc_txn->mt_front;
-            fp->mp_pgno = mp->mp_pgno;
-            mc->mc_xcursor->mx_cursor.mc_pg[0] = fp;
-            flags |= F_DUPDATA;
-            goto put_sub;
-          }
-          xdata.iov_len = olddata.iov_len + offset;
-        }
+  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+          mp->mp_pgno, mp->mp_flags);
+    return MDBX_CORRUPTED;
+  }
 
-        fp_flags = fp->mp_flags;
-        if (node_size_len(node_ks(node), xdata.iov_len) >
-            env->me_leaf_nodemax) {
-          /* Too big for a sub-page, convert to sub-DB */
-          fp_flags &= ~P_SUBP;
-        prep_subDB:
-          nested_dupdb.md_xsize = 0;
-          nested_dupdb.md_flags = flags_db2sub(mc->mc_db->md_flags);
-          if (mc->mc_db->md_flags & MDBX_DUPFIXED) {
-            fp_flags |= P_LEAF2;
-            nested_dupdb.md_xsize = fp->mp_leaf2_ksize;
-          }
-          nested_dupdb.md_depth = 1;
-          nested_dupdb.md_branch_pages = 0;
-          nested_dupdb.md_leaf_pages = 1;
-          nested_dupdb.md_overflow_pages = 0;
-          nested_dupdb.md_entries = page_numkeys(fp);
-          xdata.iov_len = sizeof(nested_dupdb);
-          xdata.iov_base = &nested_dupdb;
-          const pgr_t par = page_alloc(mc);
-          mp = par.page;
-          if (unlikely(par.err != MDBX_SUCCESS))
-            return par.err;
-          mc->mc_db->md_leaf_pages += 1;
-          cASSERT(mc, env->me_psize > olddata.iov_len);
-          offset = env->me_psize - (unsigned)olddata.iov_len;
-          flags |= F_DUPDATA | F_SUBDATA;
-          nested_dupdb.md_root = mp->mp_pgno;
-          nested_dupdb.md_seq = 0;
-          nested_dupdb.md_mod_txnid = mc->mc_txn->mt_txnid;
-          sub_root = mp;
-        }
-        if (mp != fp) {
-          mp->mp_flags = fp_flags;
-          mp->mp_txnid = mc->mc_txn->mt_front;
-          mp->mp_leaf2_ksize = fp->mp_leaf2_ksize;
-          mp->mp_lower = fp->mp_lower;
-          cASSERT(mc, fp->mp_upper + offset <= UINT16_MAX);
-          mp->mp_upper = (indx_t)(fp->mp_upper + offset);
-          if (unlikely(fp_flags & P_LEAF2)) {
-            memcpy(page_data(mp), page_data(fp),
-                   page_numkeys(fp) * fp->mp_leaf2_ksize);
-          } else {
-            memcpy(ptr_disp(mp, mp->mp_upper + PAGEHDRSZ),
-                   ptr_disp(fp, fp->mp_upper + PAGEHDRSZ),
-                   olddata.iov_len - fp->mp_upper - PAGEHDRSZ);
-            memcpy(mp->mp_ptrs, fp->mp_ptrs,
-                   page_numkeys(fp) * sizeof(mp->mp_ptrs[0]));
-            for (i = 0; i < page_numkeys(fp); i++) {
-              cASSERT(mc, mp->mp_ptrs[i] + offset <= UINT16_MAX);
-              mp->mp_ptrs[i] += (indx_t)offset;
-            }
-          }
-        }
+  if (IS_LEAF2(mp)) {
+    leaf2_read(mc, mp, mc->mc_ki[mc->mc_top], key, data);
+    return MDBX_SUCCESS;
+  }
 
-        rdata = &xdata;
-        flags |= F_DUPDATA;
-        do_sub = true;
-        if (!insert_key)
-          node_del(mc, 0);
-        goto new_sub;
-      }
+  node = page_node(mp, mc->mc_ki[mc->mc_top]);
 
-      /* MDBX passes F_SUBDATA in 'flags' to write a DB record */
-      if (unlikely((node_flags(node) ^ flags) & F_SUBDATA))
-        return MDBX_INCOMPATIBLE;
+  if (node_flags(node) & F_DUPDATA) {
+    rc = cursor_xinit1(mc, node, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    rc = cursor_last(&mc->mc_xcursor->mx_cursor, data, NULL);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  } else if (likely(data)) {
+    rc = node_read(mc, node, data, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
 
-    current:
-      if (data->iov_len == olddata.iov_len) {
-        cASSERT(mc, EVEN(key->iov_len) == EVEN(node_ks(node)));
-        /* same size, just replace it. Note that we could
-         * also reuse this node if the new data is smaller,
-         * but instead we opt to shrink the node in that case. */
-        if (flags & MDBX_RESERVE)
-          data->iov_base = olddata.iov_base;
-        else if (!(mc->mc_flags & C_SUB))
-          memcpy(olddata.iov_base, data->iov_base, data->iov_len);
-        else {
-          cASSERT(mc, page_numkeys(mc->mc_pg[mc->mc_top]) == 1);
-          cASSERT(mc, PAGETYPE_COMPAT(mc->mc_pg[mc->mc_top]) == P_LEAF);
-          cASSERT(mc, node_ds(node) == 0);
-          cASSERT(mc, node_flags(node) == 0);
-          cASSERT(mc, key->iov_len < UINT16_MAX);
-          node_set_ks(node, key->iov_len);
-          memcpy(node_key(node), key->iov_base, key->iov_len);
-          cASSERT(mc, ptr_disp(node_key(node), node_ds(node)) <
-                          ptr_disp(mc->mc_pg[mc->mc_top], env->me_psize));
-          goto fix_parent;
-        }
+  get_key_optional(node, key);
+  return MDBX_SUCCESS;
+}
 
-        if (AUDIT_ENABLED()) {
-          err = cursor_check(mc);
-          if (unlikely(err != MDBX_SUCCESS))
-            return err;
-        }
-        return MDBX_SUCCESS;
-      }
-    }
-    node_del(mc, 0);
-  }
+/* Set the cursor on a specific data item. */
+__hot static struct cursor_set_result
+cursor_set(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data, MDBX_cursor_op op) {
+  MDBX_page *mp;
+  MDBX_node *node = NULL;
+  DKBUF_DEBUG;
 
-  rdata = data;
+  struct cursor_set_result ret;
+  ret.exact = false;
+  if (unlikely(key->iov_len < mc->mc_dbx->md_klen_min ||
+               key->iov_len > mc->mc_dbx->md_klen_max)) {
+    cASSERT(mc, !"Invalid key-size");
+    ret.err = MDBX_BAD_VALSIZE;
+    return ret;
+  }
 
-new_sub:;
-  const unsigned naf = flags & NODE_ADD_FLAGS;
-  size_t nsize = IS_LEAF2(mc->mc_pg[mc->mc_top]) ? key->iov_len
-                                                 : leaf_size(env, key, rdata);
-  if (page_room(mc->mc_pg[mc->mc_top]) < nsize) {
-    rc = page_split(mc, key, rdata, P_INVALID,
-                    insert_key ? naf : naf | MDBX_SPLIT_REPLACE);
-    if (rc == MDBX_SUCCESS && AUDIT_ENABLED())
-      rc = insert_key ? cursor_check(mc) : cursor_check_updating(mc);
-  } else {
-    /* There is room already in this leaf page. */
-    if (IS_LEAF2(mc->mc_pg[mc->mc_top])) {
-      cASSERT(mc, !(naf & (F_BIGDATA | F_SUBDATA | F_DUPDATA)) &&
-                      rdata->iov_len == 0);
-      rc = node_add_leaf2(mc, mc->mc_ki[mc->mc_top], key);
-    } else
-      rc = node_add_leaf(mc, mc->mc_ki[mc->mc_top], key, rdata, naf);
-    if (likely(rc == 0)) {
-      /* Adjust other cursors pointing to mp */
-      const MDBX_dbi dbi = mc->mc_dbi;
-      const size_t i = mc->mc_top;
-      MDBX_page *const mp = mc->mc_pg[i];
-      for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[dbi]; m2;
-           m2 = m2->mc_next) {
-        MDBX_cursor *m3 =
-            (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-        if (m3 == mc || m3->mc_snum < mc->mc_snum || m3->mc_pg[i] != mp)
-          continue;
-        if (m3->mc_ki[i] >= mc->mc_ki[i])
-          m3->mc_ki[i] += insert_key;
-        if (XCURSOR_INITED(m3))
-          XCURSOR_REFRESH(m3, mp, m3->mc_ki[i]);
-      }
+  MDBX_val aligned_key = *key;
+  uint64_t aligned_keybytes;
+  if (mc->mc_db->md_flags & MDBX_INTEGERKEY) {
+    switch (aligned_key.iov_len) {
+    default:
+      cASSERT(mc, !"key-size is invalid for MDBX_INTEGERKEY");
+      ret.err = MDBX_BAD_VALSIZE;
+      return ret;
+    case 4:
+      if (unlikely(3 & (uintptr_t)aligned_key.iov_base))
+        /* copy instead of return error to avoid break compatibility */
+        aligned_key.iov_base =
+            memcpy(&aligned_keybytes, aligned_key.iov_base, 4);
+      break;
+    case 8:
+      if (unlikely(7 & (uintptr_t)aligned_key.iov_base))
+        /* copy instead of return error to avoid break compatibility */
+        aligned_key.iov_base =
+            memcpy(&aligned_keybytes, aligned_key.iov_base, 8);
+      break;
     }
   }
 
-  if (likely(rc == MDBX_SUCCESS)) {
-    /* Now store the actual data in the child DB. Note that we're
-     * storing the user data in the keys field, so there are strict
-     * size limits on dupdata. The actual data fields of the child
-     * DB are all zero size. */
-    if (do_sub) {
-      int xflags;
-      size_t ecount;
-    put_sub:
-      xdata.iov_len = 0;
-      xdata.iov_base = nullptr;
-      MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
-#define SHIFT_MDBX_NODUPDATA_TO_MDBX_NOOVERWRITE 1
-      STATIC_ASSERT(
-          (MDBX_NODUPDATA >> SHIFT_MDBX_NODUPDATA_TO_MDBX_NOOVERWRITE) ==
-          MDBX_NOOVERWRITE);
-      xflags = MDBX_CURRENT | ((flags & MDBX_NODUPDATA) >>
-                               SHIFT_MDBX_NODUPDATA_TO_MDBX_NOOVERWRITE);
-      if ((flags & MDBX_CURRENT) == 0) {
-        xflags -= MDBX_CURRENT;
-        err = cursor_xinit1(mc, node, mc->mc_pg[mc->mc_top]);
-        if (unlikely(err != MDBX_SUCCESS))
-          return err;
-      }
-      if (sub_root)
-        mc->mc_xcursor->mx_cursor.mc_pg[0] = sub_root;
-      /* converted, write the original data first */
-      if (dupdata_flag) {
-        rc = cursor_put_nochecklen(&mc->mc_xcursor->mx_cursor, &dkey, &xdata,
-                                   xflags);
-        if (unlikely(rc))
-          goto bad_sub;
-        /* we've done our job */
-        dkey.iov_len = 0;
-      }
-      if (!(node_flags(node) & F_SUBDATA) || sub_root) {
-        /* Adjust other cursors pointing to mp */
-        MDBX_cursor *m2;
-        MDBX_xcursor *mx = mc->mc_xcursor;
-        size_t i = mc->mc_top;
-        MDBX_page *mp = mc->mc_pg[i];
-        const intptr_t nkeys = page_numkeys(mp);
+  if (mc->mc_xcursor)
+    mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
 
-        for (m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2; m2 = m2->mc_next) {
-          if (m2 == mc || m2->mc_snum < mc->mc_snum)
-            continue;
-          if (!(m2->mc_flags & C_INITIALIZED))
-            continue;
-          if (m2->mc_pg[i] == mp) {
-            if (m2->mc_ki[i] == mc->mc_ki[i]) {
-              err = cursor_xinit2(m2, mx, dupdata_flag);
-              if (unlikely(err != MDBX_SUCCESS))
-                return err;
-            } else if (!insert_key && m2->mc_ki[i] < nkeys) {
-              XCURSOR_REFRESH(m2, mp, m2->mc_ki[i]);
+  /* See if we're already on the right page */
+  if (mc->mc_flags & C_INITIALIZED) {
+    MDBX_val nodekey;
+
+    cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
+    mp = mc->mc_pg[mc->mc_top];
+    if (unlikely(!page_numkeys(mp))) {
+      mc->mc_ki[mc->mc_top] = 0;
+      mc->mc_flags |= C_EOF;
+      ret.err = MDBX_NOTFOUND;
+      return ret;
+    }
+    if (IS_LEAF2(mp)) {
+      nodekey.iov_len = mc->mc_db->md_xsize;
+      nodekey.iov_base = page_leaf2key(mp, 0, nodekey.iov_len);
+    } else {
+      node = page_node(mp, 0);
+      get_key(node, &nodekey);
+    }
+    int cmp = mc->mc_dbx->md_cmp(&aligned_key, &nodekey);
+    if (unlikely(cmp == 0)) {
+      /* Probably happens rarely, but first node on the page
+       * was the one we wanted. */
+      mc->mc_ki[mc->mc_top] = 0;
+      ret.exact = true;
+      cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
+                      (mc->mc_flags & C_EOF));
+      goto got_node;
+    }
+    if (cmp > 0) {
+      const size_t nkeys = page_numkeys(mp);
+      if (nkeys > 1) {
+        if (IS_LEAF2(mp)) {
+          nodekey.iov_base = page_leaf2key(mp, nkeys - 1, nodekey.iov_len);
+        } else {
+          node = page_node(mp, nkeys - 1);
+          get_key(node, &nodekey);
+        }
+        cmp = mc->mc_dbx->md_cmp(&aligned_key, &nodekey);
+        if (cmp == 0) {
+          /* last node was the one we wanted */
+          cASSERT(mc, nkeys >= 1 && nkeys <= UINT16_MAX + 1);
+          mc->mc_ki[mc->mc_top] = (indx_t)(nkeys - 1);
+          ret.exact = true;
+          cASSERT(mc,
+                  mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
+                      (mc->mc_flags & C_EOF));
+          goto got_node;
+        }
+        if (cmp < 0) {
+          if (mc->mc_ki[mc->mc_top] < page_numkeys(mp)) {
+            /* This is definitely the right page, skip search_page */
+            if (IS_LEAF2(mp)) {
+              nodekey.iov_base =
+                  page_leaf2key(mp, mc->mc_ki[mc->mc_top], nodekey.iov_len);
+            } else {
+              node = page_node(mp, mc->mc_ki[mc->mc_top]);
+              get_key(node, &nodekey);
+            }
+            cmp = mc->mc_dbx->md_cmp(&aligned_key, &nodekey);
+            if (cmp == 0) {
+              /* current node was the one we wanted */
+              ret.exact = true;
+              cASSERT(mc, mc->mc_ki[mc->mc_top] <
+                                  page_numkeys(mc->mc_pg[mc->mc_top]) ||
+                              (mc->mc_flags & C_EOF));
+              goto got_node;
             }
           }
+          mc->mc_flags &= ~C_EOF;
+          goto search_node;
         }
       }
-      cASSERT(mc, mc->mc_xcursor->mx_db.md_entries < PTRDIFF_MAX);
-      ecount = (size_t)mc->mc_xcursor->mx_db.md_entries;
-#define SHIFT_MDBX_APPENDDUP_TO_MDBX_APPEND 1
-      STATIC_ASSERT((MDBX_APPENDDUP >> SHIFT_MDBX_APPENDDUP_TO_MDBX_APPEND) ==
-                    MDBX_APPEND);
-      xflags |= (flags & MDBX_APPENDDUP) >> SHIFT_MDBX_APPENDDUP_TO_MDBX_APPEND;
-      rc = cursor_put_nochecklen(&mc->mc_xcursor->mx_cursor, data, &xdata,
-                                 xflags);
-      if (flags & F_SUBDATA) {
-        void *db = node_data(node);
-        mc->mc_xcursor->mx_db.md_mod_txnid = mc->mc_txn->mt_txnid;
-        memcpy(db, &mc->mc_xcursor->mx_db, sizeof(MDBX_db));
+      /* If any parents have right-sibs, search.
+       * Otherwise, there's nothing further. */
+      size_t i;
+      for (i = 0; i < mc->mc_top; i++)
+        if (mc->mc_ki[i] < page_numkeys(mc->mc_pg[i]) - 1)
+          break;
+      if (i == mc->mc_top) {
+        /* There are no other pages */
+        cASSERT(mc, nkeys <= UINT16_MAX);
+        mc->mc_ki[mc->mc_top] = (uint16_t)nkeys;
+        mc->mc_flags |= C_EOF;
+        ret.err = MDBX_NOTFOUND;
+        return ret;
       }
-      insert_data = (ecount != (size_t)mc->mc_xcursor->mx_db.md_entries);
-    }
-    /* Increment count unless we just replaced an existing item. */
-    if (insert_data)
-      mc->mc_db->md_entries++;
-    if (insert_key) {
-      /* Invalidate txn if we created an empty sub-DB */
-      if (unlikely(rc))
-        goto bad_sub;
-      /* If we succeeded and the key didn't exist before,
-       * make sure the cursor is marked valid. */
-      mc->mc_flags |= C_INITIALIZED;
-    }
-    if (unlikely(flags & MDBX_MULTIPLE)) {
-      if (likely(rc == MDBX_SUCCESS)) {
-      continue_multiple:
-        mcount++;
-        /* let caller know how many succeeded, if any */
-        data[1].iov_len = mcount;
-        if (mcount < dcount) {
-          data[0].iov_base = ptr_disp(data[0].iov_base, data[0].iov_len);
-          insert_key = insert_data = false;
-          goto more;
+
+      /* Вместо поиска от корня поднимаемся только до ближайшей страницы
+       * пути, в диапазон которой попадает ключ, что существенно ускоряет
+       * последовательные операции с упорядоченными ключами. */
+      size_t level = mc->mc_top;
+      for (i = mc->mc_top; i > 0; --i) {
+        const MDBX_page *const parent = mc->mc_pg[i - 1];
+        const size_t next = mc->mc_ki[i - 1] + (size_t)1;
+        if (next < page_numkeys(parent)) {
+          get_key(page_node(parent, next), &nodekey);
+          if (mc->mc_dbx->md_cmp(&aligned_key, &nodekey) < 0)
+            break;
+          level = i - 1;
         }
       }
+      mc->mc_flags &= ~C_EOF;
+      if (level < mc->mc_top) {
+        mc->mc_top = (uint8_t)level;
+        mc->mc_snum = (uint8_t)(level + 1);
+        ret.err = page_search_root(mc, &aligned_key, 0);
+        if (unlikely(ret.err != MDBX_SUCCESS))
+          return ret;
+        mp = mc->mc_pg[mc->mc_top];
+      }
+      goto search_node;
     }
-    if (rc == MDBX_SUCCESS && AUDIT_ENABLED())
-      rc = cursor_check(mc);
-    return rc;
-  bad_sub:
-    if (unlikely(rc == MDBX_KEYEXIST)) {
-      /* should not happen, we deleted that item */
-      ERROR("Unexpected %i error while put to nested dupsort's hive", rc);
-      rc = MDBX_PROBLEM;
+    if (!mc->mc_top) {
+      /* There are no other pages */
+      mc->mc_ki[mc->mc_top] = 0;
+      if (op == MDBX_SET_RANGE)
+        goto got_node;
+
+      cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
+                      (mc->mc_flags & C_EOF));
+      ret.err = MDBX_NOTFOUND;
+      return ret;
     }
+  } else {
+    mc->mc_pg[0] = nullptr;
   }
-  mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-  return rc;
-}
 
-static __hot int cursor_put_checklen(MDBX_cursor *mc, const MDBX_val *key,
-                                     MDBX_val *data, unsigned flags) {
-  cASSERT(mc, (mc->mc_flags & C_SUB) == 0);
-  uint64_t aligned_keybytes, aligned_databytes;
-  MDBX_val aligned_key, aligned_data;
-  if (unlikely(key->iov_len < mc->mc_dbx->md_klen_min ||
-               key->iov_len > mc->mc_dbx->md_klen_max)) {
-    cASSERT(mc, !"Invalid key-size");
-    return MDBX_BAD_VALSIZE;
-  }
-  if (unlikely(data->iov_len < mc->mc_dbx->md_vlen_min ||
-               data->iov_len > mc->mc_dbx->md_vlen_max)) {
-    cASSERT(mc, !"Invalid data-size");
-    return MDBX_BAD_VALSIZE;
-  }
+  ret.err = page_search(mc, &aligned_key, 0);
+  if (unlikely(ret.err != MDBX_SUCCESS))
+    return ret;
 
-  if (mc->mc_db->md_flags & MDBX_INTEGERKEY) {
-    switch (key->iov_len) {
-    default:
-      cASSERT(mc, !"key-size is invalid for MDBX_INTEGERKEY");
-      return MDBX_BAD_VALSIZE;
-    case 4:
-      if (unlikely(3 & (uintptr_t)key->iov_base)) {
-        /* copy instead of return error to avoid break compatibility */
-        aligned_key.iov_base =
-            memcpy(&aligned_keybytes, key->iov_base, aligned_key.iov_len = 4);
-        key = &aligned_key;
-      }
-      break;
-    case 8:
-      if (unlikely(7 & (uintptr_t)key->iov_base)) {
-        /* copy instead of return error to avoid break compatibility */
-        aligned_key.iov_base =
-            memcpy(&aligned_keybytes, key->iov_base, aligned_key.iov_len = 8);
-        key = &aligned_key;
+  mp = mc->mc_pg[mc->mc_top];
+  MDBX_ANALYSIS_ASSUME(mp != nullptr);
+  cASSERT(mc, IS_LEAF(mp));
+
+search_node:;
+  struct node_result nsr = node_search(mc, &aligned_key);
+  node = nsr.node;
+  ret.exact = nsr.exact;
+  if (!ret.exact) {
+    if (op != MDBX_SET_RANGE) {
+      /* MDBX_SET specified and not an exact match. */
+      if (unlikely(mc->mc_ki[mc->mc_top] >=
+                   page_numkeys(mc->mc_pg[mc->mc_top])))
+        mc->mc_flags |= C_EOF;
+      ret.err = MDBX_NOTFOUND;
+      return ret;
+    }
+
+    if (node == NULL) {
+      DEBUG("%s", "===> inexact leaf not found, goto sibling");
+      ret.err = cursor_sibling(mc, SIBLING_RIGHT);
+      if (unlikely(ret.err != MDBX_SUCCESS)) {
+        mc->mc_flags |= C_EOF;
+        return ret; /* no entries matched */
       }
-      break;
+      mp = mc->mc_pg[mc->mc_top];
+      cASSERT(mc, IS_LEAF(mp));
+      if (!IS_LEAF2(mp))
+        node = page_node(mp, 0);
     }
   }
-  if (mc->mc_db->md_flags & MDBX_INTEGERDUP) {
-    switch (data->iov_len) {
-    default:
-      cASSERT(mc, !"data-size is invalid for MDBX_INTEGERKEY");
-      return MDBX_BAD_VALSIZE;
-    case 4:
-      if (unlikely(3 & (uintptr_t)data->iov_base)) {
-        if (unlikely(flags & MDBX_MULTIPLE))
-          return MDBX_BAD_VALSIZE;
-        /* copy instead of return error to avoid break compatibility */
-        aligned_data.iov_base = memcpy(&aligned_databytes, data->iov_base,
-                                       aligned_data.iov_len = 4);
-        data = &aligned_data;
-      }
-      break;
-    case 8:
-      if (unlikely(7 & (uintptr_t)data->iov_base)) {
-        if (unlikely(flags & MDBX_MULTIPLE))
-          return MDBX_BAD_VALSIZE;
-        /* copy instead of return error to avoid break compatibility */
-        aligned_data.iov_base = memcpy(&aligned_databytes, data->iov_base,
-                                       aligned_data.iov_len = 8);
-        data = &aligned_data;
-      }
-      break;
-    }
-  }
-  return cursor_put_nochecklen(mc, key, data, flags);
-}
-
-int mdbx_cursor_put(MDBX_cursor *mc, const MDBX_val *key, MDBX_val *data,
-                    unsigned flags) {
-  if (unlikely(mc == NULL || key == NULL || data == NULL))
-    return MDBX_EINVAL;
-
-  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
-    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
-                                                     : MDBX_EBADSIGN;
-
-  int rc = check_txn_rw(mc->mc_txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+  cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
+                  (mc->mc_flags & C_EOF));
 
-  if (unlikely(dbi_changed(mc->mc_txn, mc->mc_dbi)))
-    return MDBX_BAD_DBI;
+got_node:
+  mc->mc_flags |= C_INITIALIZED;
+  mc->mc_flags &= ~C_EOF;
 
-  cASSERT(mc, cursor_is_tracked(mc));
+  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+          mp->mp_pgno, mp->mp_flags);
+    ret.err = MDBX_CORRUPTED;
+    return ret;
+  }
 
-  /* Check this first so counter will always be zero on any early failures. */
-  if (unlikely(flags & MDBX_MULTIPLE)) {
-    if (unlikely(flags & MDBX_RESERVE))
-      return MDBX_EINVAL;
-    if (unlikely(!(mc->mc_db->md_flags & MDBX_DUPFIXED)))
-      return MDBX_INCOMPATIBLE;
-    const size_t dcount = data[1].iov_len;
-    if (unlikely(dcount < 2 || data->iov_len == 0))
-      return MDBX_BAD_VALSIZE;
-    if (unlikely(mc->mc_db->md_xsize != data->iov_len) && mc->mc_db->md_xsize)
-      return MDBX_BAD_VALSIZE;
-    if (unlikely(dcount > MAX_MAPSIZE / 2 /
-                              (BRANCH_NODE_MAX(MAX_PAGESIZE) - NODESIZE))) {
-      /* checking for multiplication overflow */
-      if (unlikely(dcount > MAX_MAPSIZE / 2 / data->iov_len))
-        return MDBX_TOO_LARGE;
+  if (IS_LEAF2(mp)) {
+    MDBX_val actual_data = {nullptr, 0};
+    leaf2_read(mc, mp, mc->mc_ki[mc->mc_top],
+               (op == MDBX_SET_RANGE || op == MDBX_SET_KEY) ? key : nullptr,
+               &actual_data);
+    if (data && (mc->mc_db->md_flags & MDBX_FIXEDSIZE)) {
+      if (op == MDBX_GET_BOTH || op == MDBX_GET_BOTH_RANGE) {
+        const int cmp = mc->mc_dbx->md_dcmp(data, &actual_data);
+        if (cmp && (op != MDBX_GET_BOTH_RANGE || cmp > 0)) {
+          ret.err = MDBX_NOTFOUND;
+          return ret;
+        }
+      }
+      *data = actual_data;
     }
+    ret.err = MDBX_SUCCESS;
+    return ret;
   }
 
-  if (flags & MDBX_RESERVE) {
-    if (unlikely(mc->mc_db->md_flags & (MDBX_DUPSORT | MDBX_REVERSEDUP |
-                                        MDBX_INTEGERDUP | MDBX_DUPFIXED)))
-      return MDBX_INCOMPATIBLE;
-    data->iov_base = nullptr;
+  if (node_flags(node) & F_DUPDATA) {
+    ret.err = cursor_xinit1(mc, node, mp);
+    if (unlikely(ret.err != MDBX_SUCCESS))
+      return ret;
+    if (op == MDBX_SET || op == MDBX_SET_KEY || op == MDBX_SET_RANGE) {
+      MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
+      ret.err = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
+      if (unlikely(ret.err != MDBX_SUCCESS))
+        return ret;
+    } else {
+      MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
+      ret = cursor_set(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_SET_RANGE);
+      if (unlikely(ret.err != MDBX_SUCCESS))
+        return ret;
+      if (op == MDBX_GET_BOTH && !ret.exact) {
+        ret.err = MDBX_NOTFOUND;
+        return ret;
+      }
+    }
+  } else if (likely(data)) {
+    if (op == MDBX_GET_BOTH || op == MDBX_GET_BOTH_RANGE) {
+      if (unlikely(data->iov_len < mc->mc_dbx->md_vlen_min ||
+                   data->iov_len > mc->mc_dbx->md_vlen_max)) {
+        cASSERT(mc, !"Invalid data-size");
+        ret.err = MDBX_BAD_VALSIZE;
+        return ret;
+      }
+      MDBX_val aligned_data = *data;
+      uint64_t aligned_databytes;
+      if (mc->mc_db->md_flags & MDBX_INTEGERDUP) {
+        switch (aligned_data.iov_len) {
+        default:
+          cASSERT(mc, !"data-size is invalid for MDBX_INTEGERDUP");
+          ret.err = MDBX_BAD_VALSIZE;
+          return ret;
+        case 4:
+          if (unlikely(3 & (uintptr_t)aligned_data.iov_base))
+            /* copy instead of return error to avoid break compatibility */
+            aligned_data.iov_base =
+                memcpy(&aligned_databytes, aligned_data.iov_base, 4);
+          break;
+        case 8:
+          if (unlikely(7 & (uintptr_t)aligned_data.iov_base))
+            /* copy instead of return error to avoid break compatibility */
+            aligned_data.iov_base =
+                memcpy(&aligned_databytes, aligned_data.iov_base, 8);
+          break;
+        }
+      }
+      MDBX_val actual_data;
+      ret.err = node_read(mc, node, &actual_data, mc->mc_pg[mc->mc_top]);
+      if (unlikely(node_flags(node) & F_COMPRESSED) &&
+          ret.err == MDBX_SUCCESS)
+        ret.err = codec_decode(mc, &actual_data, &actual_data);
+      if (unlikely(ret.err != MDBX_SUCCESS))
+        return ret;
+      const int cmp = mc->mc_dbx->md_dcmp(&aligned_data, &actual_data);
+      if (cmp) {
+        cASSERT(mc,
+                mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
+                    (mc->mc_flags & C_EOF));
+        if (op != MDBX_GET_BOTH_RANGE || cmp > 0) {
+          ret.err = MDBX_NOTFOUND;
+          return ret;
+        }
+      }
+      *data = actual_data;
+    } else {
+      ret.err = node_read(mc, node, data, mc->mc_pg[mc->mc_top]);
+      if (unlikely(ret.err != MDBX_SUCCESS))
+        return ret;
+    }
   }
 
-  if (unlikely(mc->mc_txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_BLOCKED)))
-    return (mc->mc_txn->mt_flags & MDBX_TXN_RDONLY) ? MDBX_EACCESS
-                                                    : MDBX_BAD_TXN;
+  /* The key already matches in all other cases */
+  if (op == MDBX_SET_RANGE || op == MDBX_SET_KEY)
+    get_key_optional(node, key);
 
-  return cursor_put_checklen(mc, key, data, flags);
+  DEBUG("==> cursor placed on key [%s], data [%s]", DKEY_DEBUG(key),
+        DVAL_DEBUG(data));
+  ret.err = MDBX_SUCCESS;
+  return ret;
 }
 
-int mdbx_cursor_del(MDBX_cursor *mc, MDBX_put_flags_t flags) {
-  if (unlikely(!mc))
-    return MDBX_EINVAL;
+/* Move the cursor to the first item in the database. */
+static int cursor_first(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data) {
+  int rc;
 
-  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
-    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
-                                                     : MDBX_EBADSIGN;
+  if (mc->mc_xcursor)
+    mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
 
-  int rc = check_txn_rw(mc->mc_txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+  if (!(mc->mc_flags & C_INITIALIZED) || mc->mc_top) {
+    rc = page_search(mc, NULL, MDBX_PS_FIRST);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
 
-  if (unlikely(dbi_changed(mc->mc_txn, mc->mc_dbi)))
-    return MDBX_BAD_DBI;
+  const MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+          mp->mp_pgno, mp->mp_flags);
+    return MDBX_CORRUPTED;
+  }
 
-  if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
-    return MDBX_ENODATA;
+  mc->mc_flags |= C_INITIALIZED;
+  mc->mc_flags &= ~C_EOF;
+  mc->mc_ki[mc->mc_top] = 0;
 
-  if (unlikely(mc->mc_ki[mc->mc_top] >= page_numkeys(mc->mc_pg[mc->mc_top])))
-    return MDBX_NOTFOUND;
+  if (IS_LEAF2(mp)) {
+    leaf2_read(mc, mp, 0, key, data);
+    return MDBX_SUCCESS;
+  }
 
-  return cursor_del(mc, flags);
+  MDBX_node *node = page_node(mp, 0);
+  if (node_flags(node) & F_DUPDATA) {
+    rc = cursor_xinit1(mc, node, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
+    rc = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
+    if (unlikely(rc))
+      return rc;
+  } else if (likely(data)) {
+    rc = node_read(mc, node, data, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+
+  get_key_optional(node, key);
+  return MDBX_SUCCESS;
 }
 
-static __hot int cursor_del(MDBX_cursor *mc, MDBX_put_flags_t flags) {
-  cASSERT(mc, mc->mc_flags & C_INITIALIZED);
-  cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]));
+/* Move the cursor to the last item in the database. */
+static int cursor_last(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data) {
+  int rc;
 
-  int rc = cursor_touch(mc, nullptr, nullptr);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+  if (mc->mc_xcursor)
+    mc->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
 
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  if (!(mc->mc_flags & C_INITIALIZED) || mc->mc_top) {
+    rc = page_search(mc, NULL, MDBX_PS_LAST);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+
+  const MDBX_page *mp = mc->mc_pg[mc->mc_top];
   if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
     ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
           mp->mp_pgno, mp->mp_flags);
     return MDBX_CORRUPTED;
   }
-  if (IS_LEAF2(mp))
-    goto del_key;
+
+  mc->mc_ki[mc->mc_top] = (indx_t)page_numkeys(mp) - 1;
+  mc->mc_flags |= C_INITIALIZED | C_EOF;
+
+  if (IS_LEAF2(mp)) {
+    leaf2_read(mc, mp, mc->mc_ki[mc->mc_top], key, data);
+    return MDBX_SUCCESS;
+  }
 
   MDBX_node *node = page_node(mp, mc->mc_ki[mc->mc_top]);
   if (node_flags(node) & F_DUPDATA) {
-    if (flags & (MDBX_ALLDUPS | /* for compatibility */ MDBX_NODUPDATA)) {
-      /* will subtract the final entry later */
-      mc->mc_db->md_entries -= mc->mc_xcursor->mx_db.md_entries - 1;
-      mc->mc_xcursor->mx_cursor.mc_flags &= ~C_INITIALIZED;
-    } else {
-      if (!(node_flags(node) & F_SUBDATA))
-        mc->mc_xcursor->mx_cursor.mc_pg[0] = node_data(node);
-      rc = cursor_del(&mc->mc_xcursor->mx_cursor, 0);
-      if (unlikely(rc))
-        return rc;
-      /* If sub-DB still has entries, we're done */
-      if (mc->mc_xcursor->mx_db.md_entries) {
-        if (node_flags(node) & F_SUBDATA) {
-          /* update subDB info */
-          mc->mc_xcursor->mx_db.md_mod_txnid = mc->mc_txn->mt_txnid;
-          memcpy(node_data(node), &mc->mc_xcursor->mx_db, sizeof(MDBX_db));
-        } else {
-          /* shrink fake page */
-          node_shrink(mp, mc->mc_ki[mc->mc_top]);
-          node = page_node(mp, mc->mc_ki[mc->mc_top]);
-          mc->mc_xcursor->mx_cursor.mc_pg[0] = node_data(node);
-          /* fix other sub-DB cursors pointed at fake pages on this page */
-          for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
-               m2 = m2->mc_next) {
-            if (m2 == mc || m2->mc_snum < mc->mc_snum)
-              continue;
-            if (!(m2->mc_flags & C_INITIALIZED))
-              continue;
-            if (m2->mc_pg[mc->mc_top] == mp) {
-              MDBX_node *inner = node;
-              if (m2->mc_ki[mc->mc_top] >= page_numkeys(mp))
-                continue;
-              if (m2->mc_ki[mc->mc_top] != mc->mc_ki[mc->mc_top]) {
-                inner = page_node(mp, m2->mc_ki[mc->mc_top]);
-                if (node_flags(inner) & F_SUBDATA)
-                  continue;
-              }
-              m2->mc_xcursor->mx_cursor.mc_pg[0] = node_data(inner);
-            }
-          }
-        }
-        mc->mc_db->md_entries--;
-        cASSERT(mc, mc->mc_db->md_entries > 0 && mc->mc_db->md_depth > 0 &&
-                        mc->mc_db->md_root != P_INVALID);
-        return rc;
-      } else {
-        mc->mc_xcursor->mx_cursor.mc_flags &= ~C_INITIALIZED;
-      }
-      /* otherwise fall thru and delete the sub-DB */
-    }
-
-    if (node_flags(node) & F_SUBDATA) {
-      /* add all the child DB's pages to the free list */
-      rc = drop_tree(&mc->mc_xcursor->mx_cursor, false);
-      if (unlikely(rc))
-        goto fail;
-    }
+    rc = cursor_xinit1(mc, node, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    MDBX_ANALYSIS_ASSUME(mc->mc_xcursor != nullptr);
+    rc = cursor_last(&mc->mc_xcursor->mx_cursor, data, NULL);
+    if (unlikely(rc))
+      return rc;
+  } else if (likely(data)) {
+    rc = node_read(mc, node, data, mp);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
   }
-  /* MDBX passes F_SUBDATA in 'flags' to delete a DB record */
-  else if (unlikely((node_flags(node) ^ flags) & F_SUBDATA))
-    return MDBX_INCOMPATIBLE;
 
-  /* add large/overflow pages to free list */
-  if (node_flags(node) & F_BIGDATA) {
-    pgr_t lp = page_get_large(mc, node_largedata_pgno(node), mp->mp_txnid);
-    if (unlikely((rc = lp.err) || (rc = page_retire(mc, lp.page))))
-      goto fail;
-  }
+  get_key_optional(node, key);
+  return MDBX_SUCCESS;
+}
 
-del_key:
-  mc->mc_db->md_entries--;
-  const MDBX_dbi dbi = mc->mc_dbi;
-  indx_t ki = mc->mc_ki[mc->mc_top];
-  mp = mc->mc_pg[mc->mc_top];
-  cASSERT(mc, IS_LEAF(mp));
-  node_del(mc, mc->mc_db->md_xsize);
+static __hot int cursor_get(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
+                            MDBX_cursor_op op) {
+  int (*mfunc)(MDBX_cursor * mc, MDBX_val * key, MDBX_val * data);
+  int rc;
 
-  /* Adjust other cursors pointing to mp */
-  for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
-    MDBX_cursor *m3 = (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-    if (m3 == mc || !(m2->mc_flags & m3->mc_flags & C_INITIALIZED))
-      continue;
-    if (m3->mc_snum < mc->mc_snum)
-      continue;
-    if (m3->mc_pg[mc->mc_top] == mp) {
-      if (m3->mc_ki[mc->mc_top] == ki) {
-        m3->mc_flags |= C_DEL;
-        if (mc->mc_db->md_flags & MDBX_DUPSORT) {
-          /* Sub-cursor referred into dataset which is gone */
-          m3->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
-        }
-        continue;
-      } else if (m3->mc_ki[mc->mc_top] > ki) {
-        m3->mc_ki[mc->mc_top]--;
-      }
-      if (XCURSOR_INITED(m3))
-        XCURSOR_REFRESH(m3, m3->mc_pg[mc->mc_top], m3->mc_ki[mc->mc_top]);
+  switch (op) {
+  case MDBX_GET_CURRENT: {
+    if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
+      return MDBX_ENODATA;
+    const MDBX_page *mp = mc->mc_pg[mc->mc_top];
+    if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+      ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+            mp->mp_pgno, mp->mp_flags);
+      return MDBX_CORRUPTED;
     }
-  }
-
-  rc = rebalance(mc);
-  if (unlikely(rc != MDBX_SUCCESS))
-    goto fail;
-
-  if (unlikely(!mc->mc_snum)) {
-    /* DB is totally empty now, just bail out.
-     * Other cursors adjustments were already done
-     * by rebalance and aren't needed here. */
-    cASSERT(mc, mc->mc_db->md_entries == 0 && mc->mc_db->md_depth == 0 &&
-                    mc->mc_db->md_root == P_INVALID);
-    mc->mc_flags |= C_EOF;
-    return MDBX_SUCCESS;
-  }
-
-  ki = mc->mc_ki[mc->mc_top];
-  mp = mc->mc_pg[mc->mc_top];
-  cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
-  size_t nkeys = page_numkeys(mp);
-  cASSERT(mc, (mc->mc_db->md_entries > 0 && nkeys > 0) ||
-                  ((mc->mc_flags & C_SUB) && mc->mc_db->md_entries == 0 &&
-                   nkeys == 0));
+    const size_t nkeys = page_numkeys(mp);
+    if (unlikely(mc->mc_ki[mc->mc_top] >= nkeys)) {
+      cASSERT(mc, nkeys <= UINT16_MAX);
+      if (mc->mc_flags & C_EOF)
+        return MDBX_ENODATA;
+      mc->mc_ki[mc->mc_top] = (uint16_t)nkeys;
+      mc->mc_flags |= C_EOF;
+      return MDBX_NOTFOUND;
+    }
+    cASSERT(mc, nkeys > 0);
 
-  /* Adjust this and other cursors pointing to mp */
-  for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
-    MDBX_cursor *m3 = (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-    if (!(m2->mc_flags & m3->mc_flags & C_INITIALIZED))
-      continue;
-    if (m3->mc_snum < mc->mc_snum)
-      continue;
-    if (m3->mc_pg[mc->mc_top] == mp) {
-      /* if m3 points past last node in page, find next sibling */
-      if (m3->mc_ki[mc->mc_top] >= nkeys) {
-        rc = cursor_sibling(m3, SIBLING_RIGHT);
-        if (rc == MDBX_NOTFOUND) {
-          m3->mc_flags |= C_EOF;
-          rc = MDBX_SUCCESS;
-          continue;
-        }
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto fail;
-      }
-      if (m3->mc_ki[mc->mc_top] >= ki ||
-          /* moved to right sibling */ m3->mc_pg[mc->mc_top] != mp) {
-        if (m3->mc_xcursor && !(m3->mc_flags & C_EOF)) {
-          node = page_node(m3->mc_pg[m3->mc_top], m3->mc_ki[m3->mc_top]);
-          /* If this node has dupdata, it may need to be reinited
-           * because its data has moved.
-           * If the xcursor was not inited it must be reinited.
-           * Else if node points to a subDB, nothing is needed. */
-          if (node_flags(node) & F_DUPDATA) {
-            if (m3->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED) {
-              if (!(node_flags(node) & F_SUBDATA))
-                m3->mc_xcursor->mx_cursor.mc_pg[0] = node_data(node);
-            } else {
-              rc = cursor_xinit1(m3, node, m3->mc_pg[m3->mc_top]);
-              if (unlikely(rc != MDBX_SUCCESS))
-                goto fail;
-              rc = cursor_first(&m3->mc_xcursor->mx_cursor, NULL, NULL);
-              if (unlikely(rc != MDBX_SUCCESS))
-                goto fail;
-            }
+    rc = MDBX_SUCCESS;
+    if (IS_LEAF2(mp)) {
+      leaf2_read(mc, mp, mc->mc_ki[mc->mc_top], key, data);
+    } else {
+      MDBX_node *node = page_node(mp, mc->mc_ki[mc->mc_top]);
+      get_key_optional(node, key);
+      if (data) {
+        if (node_flags(node) & F_DUPDATA) {
+          if (unlikely(!(mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED))) {
+            rc = cursor_xinit1(mc, node, mp);
+            if (unlikely(rc != MDBX_SUCCESS))
+              return rc;
+            rc = cursor_first(&mc->mc_xcursor->mx_cursor, data, NULL);
+            if (unlikely(rc))
+              return rc;
+          } else {
+            rc = cursor_get(&mc->mc_xcursor->mx_cursor, data, NULL,
+                            MDBX_GET_CURRENT);
+            if (unlikely(rc))
+              return rc;
           }
-          m3->mc_xcursor->mx_cursor.mc_flags |= C_DEL;
+        } else {
+          rc = node_read(mc, node, data, mp);
+          if (unlikely(rc))
+            return rc;
         }
-        m3->mc_flags |= C_DEL;
       }
     }
+    break;
   }
-
-  cASSERT(mc, rc == MDBX_SUCCESS);
-  if (AUDIT_ENABLED())
-    rc = cursor_check(mc);
-  return rc;
-
-fail:
-  mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-  return rc;
-}
-
-/* Allocate and initialize new pages for a database.
- * Set MDBX_TXN_ERROR on failure. */
-static pgr_t page_new(MDBX_cursor *mc, const unsigned flags) {
-  cASSERT(mc, (flags & P_OVERFLOW) == 0);
-  pgr_t ret = page_alloc(mc);
-  if (unlikely(ret.err != MDBX_SUCCESS))
-    return ret;
-
-  DEBUG("db %u allocated new page %" PRIaPGNO, mc->mc_dbi, ret.page->mp_pgno);
-  ret.page->mp_flags = (uint16_t)flags;
-  cASSERT(mc, *mc->mc_dbistate & DBI_DIRTY);
-  cASSERT(mc, mc->mc_txn->mt_flags & MDBX_TXN_DIRTY);
-#if MDBX_ENABLE_PGOP_STAT
-  mc->mc_txn->mt_env->me_lck->mti_pgop_stat.newly.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-
-  STATIC_ASSERT(P_BRANCH == 1);
-  const unsigned is_branch = flags & P_BRANCH;
-
-  ret.page->mp_lower = 0;
-  ret.page->mp_upper = (indx_t)(mc->mc_txn->mt_env->me_psize - PAGEHDRSZ);
-  mc->mc_db->md_branch_pages += is_branch;
-  mc->mc_db->md_leaf_pages += 1 - is_branch;
-  if (unlikely(mc->mc_flags & C_SUB)) {
-    MDBX_db *outer = outer_db(mc);
-    outer->md_branch_pages += is_branch;
-    outer->md_leaf_pages += 1 - is_branch;
-  }
-  return ret;
-}
-
-static pgr_t page_new_large(MDBX_cursor *mc, const size_t npages) {
-  pgr_t ret = likely(npages == 1)
-                  ? page_alloc(mc)
-                  : page_alloc_slowpath(mc, npages, MDBX_ALLOC_DEFAULT);
-  if (unlikely(ret.err != MDBX_SUCCESS))
-    return ret;
-
-  DEBUG("db %u allocated new large-page %" PRIaPGNO ", num %zu", mc->mc_dbi,
-        ret.page->mp_pgno, npages);
-  ret.page->mp_flags = P_OVERFLOW;
-  cASSERT(mc, *mc->mc_dbistate & DBI_DIRTY);
-  cASSERT(mc, mc->mc_txn->mt_flags & MDBX_TXN_DIRTY);
-#if MDBX_ENABLE_PGOP_STAT
-  mc->mc_txn->mt_env->me_lck->mti_pgop_stat.newly.weak += npages;
-#endif /* MDBX_ENABLE_PGOP_STAT */
-
-  mc->mc_db->md_overflow_pages += (pgno_t)npages;
-  ret.page->mp_pages = (pgno_t)npages;
-  cASSERT(mc, !(mc->mc_flags & C_SUB));
-  return ret;
-}
-
-__hot static int __must_check_result node_add_leaf2(MDBX_cursor *mc,
-                                                    size_t indx,
-                                                    const MDBX_val *key) {
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  MDBX_ANALYSIS_ASSUME(key != nullptr);
-  DKBUF_DEBUG;
-  DEBUG("add to leaf2-%spage %" PRIaPGNO " index %zi, "
-        " key size %" PRIuPTR " [%s]",
-        IS_SUBP(mp) ? "sub-" : "", mp->mp_pgno, indx, key ? key->iov_len : 0,
-        DKEY_DEBUG(key));
-
-  cASSERT(mc, key);
-  cASSERT(mc, PAGETYPE_COMPAT(mp) == (P_LEAF | P_LEAF2));
-  const size_t ksize = mc->mc_db->md_xsize;
-  cASSERT(mc, ksize == key->iov_len);
-  const size_t nkeys = page_numkeys(mp);
-
-  /* Just using these for counting */
-  const intptr_t lower = mp->mp_lower + sizeof(indx_t);
-  const intptr_t upper = mp->mp_upper - (ksize - sizeof(indx_t));
-  if (unlikely(lower > upper)) {
-    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-    return MDBX_PAGE_FULL;
+  case MDBX_GET_BOTH:
+  case MDBX_GET_BOTH_RANGE:
+    if (unlikely(data == NULL))
+      return MDBX_EINVAL;
+    if (unlikely(mc->mc_xcursor == NULL))
+      return MDBX_INCOMPATIBLE;
+    /* fall through */
+    __fallthrough;
+  case MDBX_SET:
+  case MDBX_SET_KEY:
+  case MDBX_SET_RANGE:
+    if (unlikely(key == NULL))
+      return MDBX_EINVAL;
+    rc = cursor_set(mc, key, data, op).err;
+    if (mc->mc_flags & C_INITIALIZED) {
+      cASSERT(mc, mc->mc_snum > 0 && mc->mc_top < mc->mc_snum);
+      cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]) ||
+                      (mc->mc_flags & C_EOF));
+    }
+    break;
+  case MDBX_GET_MULTIPLE:
+    if (unlikely(data == NULL || !(mc->mc_flags & C_INITIALIZED)))
+      return MDBX_EINVAL;
+    if (unlikely(!(mc->mc_db->md_flags & MDBX_DUPFIXED)))
+      return MDBX_INCOMPATIBLE;
+    rc = MDBX_SUCCESS;
+    if ((mc->mc_xcursor->mx_cursor.mc_flags & (C_INITIALIZED | C_EOF)) !=
+        C_INITIALIZED)
+      break;
+    goto fetchm;
+  case MDBX_NEXT_MULTIPLE:
+    if (unlikely(data == NULL))
+      return MDBX_EINVAL;
+    if (unlikely(!(mc->mc_db->md_flags & MDBX_DUPFIXED)))
+      return MDBX_INCOMPATIBLE;
+    rc = cursor_next(mc, key, data, MDBX_NEXT_DUP);
+    if (rc == MDBX_SUCCESS) {
+      if (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED) {
+        MDBX_cursor *mx;
+      fetchm:
+        mx = &mc->mc_xcursor->mx_cursor;
+        data->iov_len =
+            page_numkeys(mx->mc_pg[mx->mc_top]) * mx->mc_db->md_xsize;
+        data->iov_base = page_data(mx->mc_pg[mx->mc_top]);
+        mx->mc_ki[mx->mc_top] = (indx_t)page_numkeys(mx->mc_pg[mx->mc_top]) - 1;
+      } else {
+        rc = MDBX_NOTFOUND;
+      }
+    }
+    break;
+  case MDBX_PREV_MULTIPLE:
+    if (data == NULL)
+      return MDBX_EINVAL;
+    if (!(mc->mc_db->md_flags & MDBX_DUPFIXED))
+      return MDBX_INCOMPATIBLE;
+    rc = MDBX_SUCCESS;
+    if (!(mc->mc_flags & C_INITIALIZED))
+      rc = cursor_last(mc, key, data);
+    if (rc == MDBX_SUCCESS) {
+      MDBX_cursor *mx = &mc->mc_xcursor->mx_cursor;
+      if (mx->mc_flags & C_INITIALIZED) {
+        rc = cursor_sibling(mx, SIBLING_LEFT);
+        if (rc == MDBX_SUCCESS)
+          goto fetchm;
+      } else {
+        rc = MDBX_NOTFOUND;
+      }
+    }
+    break;
+  case MDBX_NEXT:
+  case MDBX_NEXT_DUP:
+  case MDBX_NEXT_NODUP:
+    rc = cursor_next(mc, key, data, op);
+    break;
+  case MDBX_PREV:
+  case MDBX_PREV_DUP:
+  case MDBX_PREV_NODUP:
+    rc = cursor_prev(mc, key, data, op);
+    break;
+  case MDBX_FIRST:
+    rc = cursor_first(mc, key, data);
+    break;
+  case MDBX_FIRST_DUP:
+    mfunc = cursor_first;
+  move:
+    if (unlikely(data == NULL || !(mc->mc_flags & C_INITIALIZED)))
+      return MDBX_EINVAL;
+    if (unlikely(mc->mc_xcursor == NULL))
+      return MDBX_INCOMPATIBLE;
+    if (mc->mc_ki[mc->mc_top] >= page_numkeys(mc->mc_pg[mc->mc_top])) {
+      mc->mc_ki[mc->mc_top] = (indx_t)page_numkeys(mc->mc_pg[mc->mc_top]);
+      mc->mc_flags |= C_EOF;
+      return MDBX_NOTFOUND;
+    } else {
+      MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+      if (!(node_flags(node) & F_DUPDATA)) {
+        get_key_optional(node, key);
+        rc = node_read(mc, node, data, mc->mc_pg[mc->mc_top]);
+        break;
+      }
+    }
+    if (unlikely(!(mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED)))
+      return MDBX_EINVAL;
+    rc = mfunc(&mc->mc_xcursor->mx_cursor, data, NULL);
+    break;
+  case MDBX_LAST:
+    rc = cursor_last(mc, key, data);
+    break;
+  case MDBX_LAST_DUP:
+    mfunc = cursor_last;
+    goto move;
+  case MDBX_SET_UPPERBOUND: /* mostly same as MDBX_SET_LOWERBOUND */
+  case MDBX_SET_LOWERBOUND: {
+    if (unlikely(key == NULL || data == NULL))
+      return MDBX_EINVAL;
+    MDBX_val save_data = *data;
+    struct cursor_set_result csr = cursor_set(mc, key, data, MDBX_SET_RANGE);
+    rc = csr.err;
+    if (rc == MDBX_SUCCESS && csr.exact && mc->mc_xcursor) {
+      mc->mc_flags &= ~C_DEL;
+      csr.exact = false;
+      if (!save_data.iov_base && (mc->mc_db->md_flags & MDBX_DUPFIXED)) {
+        /* Avoiding search nested dupfixed hive if no data provided.
+         * This is changes the semantic of MDBX_SET_LOWERBOUND but avoid
+         * returning MDBX_BAD_VALSIZE. */
+      } else if (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED) {
+        *data = save_data;
+        csr =
+            cursor_set(&mc->mc_xcursor->mx_cursor, data, NULL, MDBX_SET_RANGE);
+        rc = csr.err;
+        if (rc == MDBX_NOTFOUND) {
+          cASSERT(mc, !csr.exact);
+          rc = cursor_next(mc, key, data, MDBX_NEXT_NODUP);
+        }
+      } else {
+        int cmp = mc->mc_dbx->md_dcmp(&save_data, data);
+        csr.exact = (cmp == 0);
+        if (cmp > 0)
+          rc = cursor_next(mc, key, data, MDBX_NEXT_NODUP);
+      }
+    }
+    if (rc == MDBX_SUCCESS && !csr.exact)
+      rc = MDBX_RESULT_TRUE;
+    if (unlikely(op == MDBX_SET_UPPERBOUND)) {
+      /* minor fixups for MDBX_SET_UPPERBOUND */
+      if (rc == MDBX_RESULT_TRUE)
+        /* already at great-than by MDBX_SET_LOWERBOUND */
+        rc = MDBX_SUCCESS;
+      else if (rc == MDBX_SUCCESS)
+        /* exactly match, going next */
+        rc = cursor_next(mc, key, data, MDBX_NEXT);
+    }
+    break;
+  }
+  default:
+    DEBUG("unhandled/unimplemented cursor operation %u", op);
+    return MDBX_EINVAL;
   }
-  mp->mp_lower = (indx_t)lower;
-  mp->mp_upper = (indx_t)upper;
 
-  void *const ptr = page_leaf2key(mp, indx, ksize);
-  cASSERT(mc, nkeys >= indx);
-  const size_t diff = nkeys - indx;
-  if (likely(diff > 0))
-    /* Move higher keys up one slot. */
-    memmove(ptr_disp(ptr, ksize), ptr, diff * ksize);
-  /* insert new key */
-  memcpy(ptr, key->iov_base, ksize);
-  return MDBX_SUCCESS;
+  mc->mc_flags &= ~C_DEL;
+  return rc;
 }
 
-static int __must_check_result node_add_branch(MDBX_cursor *mc, size_t indx,
-                                               const MDBX_val *key,
-                                               pgno_t pgno) {
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  DKBUF_DEBUG;
-  DEBUG("add to branch-%spage %" PRIaPGNO " index %zi, node-pgno %" PRIaPGNO
-        " key size %" PRIuPTR " [%s]",
-        IS_SUBP(mp) ? "sub-" : "", mp->mp_pgno, indx, pgno,
-        key ? key->iov_len : 0, DKEY_DEBUG(key));
+int mdbx_cursor_get(MDBX_cursor *mc, MDBX_val *key, MDBX_val *data,
+                    MDBX_cursor_op op) {
+  if (unlikely(mc == NULL))
+    return MDBX_EINVAL;
 
-  cASSERT(mc, PAGETYPE_WHOLE(mp) == P_BRANCH);
-  STATIC_ASSERT(NODESIZE % 2 == 0);
+  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
+    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
+                                                     : MDBX_EBADSIGN;
 
-  /* Move higher pointers up one slot. */
-  const size_t nkeys = page_numkeys(mp);
-  cASSERT(mc, nkeys >= indx);
-  for (size_t i = nkeys; i > indx; --i)
-    mp->mp_ptrs[i] = mp->mp_ptrs[i - 1];
+  int rc = check_txn(mc->mc_txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  /* Adjust free space offsets. */
-  const size_t branch_bytes = branch_size(mc->mc_txn->mt_env, key);
-  const intptr_t lower = mp->mp_lower + sizeof(indx_t);
-  const intptr_t upper = mp->mp_upper - (branch_bytes - sizeof(indx_t));
-  if (unlikely(lower > upper)) {
-    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-    return MDBX_PAGE_FULL;
+  rc = cursor_get(mc, key, data, op);
+  if (rc == MDBX_SUCCESS || rc == MDBX_RESULT_TRUE) {
+    const int err = cursor_unpack(mc, data);
+    if (unlikely(err != MDBX_SUCCESS))
+      rc = err;
   }
-  mp->mp_lower = (indx_t)lower;
-  mp->mp_ptrs[indx] = mp->mp_upper = (indx_t)upper;
+  return rc;
+}
 
-  /* Write the node data. */
-  MDBX_node *node = page_node(mp, indx);
-  node_set_pgno(node, pgno);
-  node_set_flags(node, 0);
-  UNALIGNED_POKE_8(node, MDBX_node, mn_extra, 0);
-  node_set_ks(node, 0);
-  if (likely(key != NULL)) {
-    node_set_ks(node, key->iov_len);
-    memcpy(node_key(node), key->iov_base, key->iov_len);
+static int cursor_first_batch(MDBX_cursor *mc) {
+  if (!(mc->mc_flags & C_INITIALIZED) || mc->mc_top) {
+    int err = page_search(mc, NULL, MDBX_PS_FIRST);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
   }
+  cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
+
+  mc->mc_flags |= C_INITIALIZED;
+  mc->mc_flags &= ~C_EOF;
+  mc->mc_ki[mc->mc_top] = 0;
   return MDBX_SUCCESS;
 }
 
-__hot static int __must_check_result node_add_leaf(MDBX_cursor *mc, size_t indx,
-                                                   const MDBX_val *key,
-                                                   MDBX_val *data,
-                                                   unsigned flags) {
-  MDBX_ANALYSIS_ASSUME(key != nullptr);
-  MDBX_ANALYSIS_ASSUME(data != nullptr);
+static int cursor_next_batch(MDBX_cursor *mc) {
+  if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
+    return cursor_first_batch(mc);
+
   MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  DKBUF_DEBUG;
-  DEBUG("add to leaf-%spage %" PRIaPGNO " index %zi, data size %" PRIuPTR
-        " key size %" PRIuPTR " [%s]",
-        IS_SUBP(mp) ? "sub-" : "", mp->mp_pgno, indx, data ? data->iov_len : 0,
-        key ? key->iov_len : 0, DKEY_DEBUG(key));
-  cASSERT(mc, key != NULL && data != NULL);
-  cASSERT(mc, PAGETYPE_COMPAT(mp) == P_LEAF);
-  MDBX_page *largepage = NULL;
-
-  size_t node_bytes;
-  if (unlikely(flags & F_BIGDATA)) {
-    /* Data already on large/overflow page. */
-    STATIC_ASSERT(sizeof(pgno_t) % 2 == 0);
-    node_bytes =
-        node_size_len(key->iov_len, 0) + sizeof(pgno_t) + sizeof(indx_t);
-    cASSERT(mc, page_room(mp) >= node_bytes);
-  } else if (unlikely(node_size(key, data) >
-                      mc->mc_txn->mt_env->me_leaf_nodemax)) {
-    /* Put data on large/overflow page. */
-    if (unlikely(mc->mc_db->md_flags & MDBX_DUPSORT)) {
-      ERROR("Unexpected target %s flags 0x%x for large data-item", "dupsort-db",
-            mc->mc_db->md_flags);
-      return MDBX_PROBLEM;
-    }
-    if (unlikely(flags & (F_DUPDATA | F_SUBDATA))) {
-      ERROR("Unexpected target %s flags 0x%x for large data-item", "node",
-            flags);
-      return MDBX_PROBLEM;
-    }
-    cASSERT(mc, page_room(mp) >= leaf_size(mc->mc_txn->mt_env, key, data));
-    const pgno_t ovpages = number_of_ovpages(mc->mc_txn->mt_env, data->iov_len);
-    const pgr_t npr = page_new_large(mc, ovpages);
-    if (unlikely(npr.err != MDBX_SUCCESS))
-      return npr.err;
-    largepage = npr.page;
-    DEBUG("allocated %u large/overflow page(s) %" PRIaPGNO "for %" PRIuPTR
-          " data bytes",
-          largepage->mp_pages, largepage->mp_pgno, data->iov_len);
-    flags |= F_BIGDATA;
-    node_bytes =
-        node_size_len(key->iov_len, 0) + sizeof(pgno_t) + sizeof(indx_t);
-    cASSERT(mc, node_bytes == leaf_size(mc->mc_txn->mt_env, key, data));
-  } else {
-    cASSERT(mc, page_room(mp) >= leaf_size(mc->mc_txn->mt_env, key, data));
-    node_bytes = node_size(key, data) + sizeof(indx_t);
-    cASSERT(mc, node_bytes == leaf_size(mc->mc_txn->mt_env, key, data));
-  }
-
-  /* Move higher pointers up one slot. */
-  const size_t nkeys = page_numkeys(mp);
-  cASSERT(mc, nkeys >= indx);
-  for (size_t i = nkeys; i > indx; --i)
-    mp->mp_ptrs[i] = mp->mp_ptrs[i - 1];
-
-  /* Adjust free space offsets. */
-  const intptr_t lower = mp->mp_lower + sizeof(indx_t);
-  const intptr_t upper = mp->mp_upper - (node_bytes - sizeof(indx_t));
-  if (unlikely(lower > upper)) {
-    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-    return MDBX_PAGE_FULL;
+  if (unlikely(mc->mc_flags & C_EOF)) {
+    if ((size_t)mc->mc_ki[mc->mc_top] + 1 >= page_numkeys(mp))
+      return MDBX_NOTFOUND;
+    mc->mc_flags ^= C_EOF;
   }
-  mp->mp_lower = (indx_t)lower;
-  mp->mp_ptrs[indx] = mp->mp_upper = (indx_t)upper;
-
-  /* Write the node data. */
-  MDBX_node *node = page_node(mp, indx);
-  node_set_ks(node, key->iov_len);
-  node_set_flags(node, (uint8_t)flags);
-  UNALIGNED_POKE_8(node, MDBX_node, mn_extra, 0);
-  node_set_ds(node, data->iov_len);
-  memcpy(node_key(node), key->iov_base, key->iov_len);
 
-  void *nodedata = node_data(node);
-  if (likely(largepage == NULL)) {
-    if (unlikely(flags & F_BIGDATA)) {
-      memcpy(nodedata, data->iov_base, sizeof(pgno_t));
-      return MDBX_SUCCESS;
+  intptr_t ki = mc->mc_ki[mc->mc_top];
+  mc->mc_ki[mc->mc_top] = (indx_t)++ki;
+  const intptr_t numkeys = page_numkeys(mp);
+  if (likely(ki >= numkeys)) {
+    DEBUG("%s", "=====> move to next sibling page");
+    mc->mc_ki[mc->mc_top] = (indx_t)(numkeys - 1);
+    int err = cursor_sibling(mc, SIBLING_RIGHT);
+    if (unlikely(err != MDBX_SUCCESS)) {
+      mc->mc_flags |= C_EOF;
+      return err;
+    }
+    mp = mc->mc_pg[mc->mc_top];
+    DEBUG("next page is %" PRIaPGNO ", key index %u", mp->mp_pgno,
+          mc->mc_ki[mc->mc_top]);
+    if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+      ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+            mp->mp_pgno, mp->mp_flags);
+      return MDBX_CORRUPTED;
     }
-  } else {
-    poke_pgno(nodedata, largepage->mp_pgno);
-    nodedata = page_data(largepage);
   }
-  if (unlikely(flags & MDBX_RESERVE))
-    data->iov_base = nodedata;
-  else if (likely(nodedata != data->iov_base &&
-                  data->iov_len /* to avoid UBSAN traps*/ != 0))
-    memcpy(nodedata, data->iov_base, data->iov_len);
   return MDBX_SUCCESS;
 }
 
-/* Delete the specified node from a page.
- * [in] mc Cursor pointing to the node to delete.
- * [in] ksize The size of a node. Only used if the page is
- * part of a MDBX_DUPFIXED database. */
-__hot static void node_del(MDBX_cursor *mc, size_t ksize) {
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  const size_t hole = mc->mc_ki[mc->mc_top];
-  const size_t nkeys = page_numkeys(mp);
-
-  DEBUG("delete node %zu on %s page %" PRIaPGNO, hole,
-        IS_LEAF(mp) ? "leaf" : "branch", mp->mp_pgno);
-  cASSERT(mc, hole < nkeys);
-
-  if (IS_LEAF2(mp)) {
-    cASSERT(mc, ksize >= sizeof(indx_t));
-    size_t diff = nkeys - 1 - hole;
-    void *const base = page_leaf2key(mp, hole, ksize);
-    if (diff)
-      memmove(base, ptr_disp(base, ksize), diff * ksize);
-    cASSERT(mc, mp->mp_lower >= sizeof(indx_t));
-    mp->mp_lower -= sizeof(indx_t);
-    cASSERT(mc, (size_t)UINT16_MAX - mp->mp_upper >= ksize - sizeof(indx_t));
-    mp->mp_upper += (indx_t)(ksize - sizeof(indx_t));
-    return;
-  }
-
-  MDBX_node *node = page_node(mp, hole);
-  cASSERT(mc, !IS_BRANCH(mp) || hole || node_ks(node) == 0);
-  size_t hole_size = NODESIZE + node_ks(node);
-  if (IS_LEAF(mp))
-    hole_size +=
-        (node_flags(node) & F_BIGDATA) ? sizeof(pgno_t) : node_ds(node);
-  hole_size = EVEN(hole_size);
+int mdbx_cursor_get_batch(MDBX_cursor *mc, size_t *count, MDBX_val *pairs,
+                          size_t limit, MDBX_cursor_op op) {
+  if (unlikely(mc == NULL || count == NULL || limit < 4))
+    return MDBX_EINVAL;
 
-  const indx_t hole_offset = mp->mp_ptrs[hole];
-  size_t r, w;
-  for (r = w = 0; r < nkeys; r++)
-    if (r != hole)
-      mp->mp_ptrs[w++] = (mp->mp_ptrs[r] < hole_offset)
-                             ? mp->mp_ptrs[r] + (indx_t)hole_size
-                             : mp->mp_ptrs[r];
+  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
+    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
+                                                     : MDBX_EBADSIGN;
 
-  void *const base = ptr_disp(mp, mp->mp_upper + PAGEHDRSZ);
-  memmove(ptr_disp(base, hole_size), base, hole_offset - mp->mp_upper);
+  int rc = check_txn(mc->mc_txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  cASSERT(mc, mp->mp_lower >= sizeof(indx_t));
-  mp->mp_lower -= sizeof(indx_t);
-  cASSERT(mc, (size_t)UINT16_MAX - mp->mp_upper >= hole_size);
-  mp->mp_upper += (indx_t)hole_size;
+  if (unlikely(mc->mc_db->md_flags & MDBX_DUPSORT))
+    return MDBX_INCOMPATIBLE /* must be a non-dupsort subDB */;
 
-  if (AUDIT_ENABLED()) {
-    const uint8_t checking = mc->mc_checking;
-    mc->mc_checking |= CC_UPDATING;
-    const int page_check_err = page_check(mc, mp);
-    mc->mc_checking = checking;
-    cASSERT(mc, page_check_err == MDBX_SUCCESS);
+  switch (op) {
+  case MDBX_FIRST:
+    rc = cursor_first_batch(mc);
+    break;
+  case MDBX_NEXT:
+    rc = cursor_next_batch(mc);
+    break;
+  case MDBX_GET_CURRENT:
+    rc = likely(mc->mc_flags & C_INITIALIZED) ? MDBX_SUCCESS : MDBX_ENODATA;
+    break;
+  default:
+    DEBUG("unhandled/unimplemented cursor operation %u", op);
+    rc = MDBX_EINVAL;
+    break;
   }
-}
-
-/* Compact the main page after deleting a node on a subpage.
- * [in] mp The main page to operate on.
- * [in] indx The index of the subpage on the main page. */
-static void node_shrink(MDBX_page *mp, size_t indx) {
-  MDBX_node *node;
-  MDBX_page *sp, *xp;
-  size_t nsize, delta, len, ptr;
-  intptr_t i;
 
-  node = page_node(mp, indx);
-  sp = (MDBX_page *)node_data(node);
-  delta = page_room(sp);
-  assert(delta > 0);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    *count = 0;
+    return rc;
+  }
 
-  /* Prepare to shift upward, set len = length(subpage part to shift) */
-  if (IS_LEAF2(sp)) {
-    delta &= /* do not make the node uneven-sized */ ~(size_t)1;
-    if (unlikely(delta) == 0)
-      return;
-    nsize = node_ds(node) - delta;
-    assert(nsize % 1 == 0);
-    len = nsize;
-  } else {
-    xp = ptr_disp(sp, delta); /* destination subpage */
-    for (i = page_numkeys(sp); --i >= 0;) {
-      assert(sp->mp_ptrs[i] >= delta);
-      xp->mp_ptrs[i] = (indx_t)(sp->mp_ptrs[i] - delta);
+  const MDBX_page *const mp = mc->mc_pg[mc->mc_top];
+  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+          mp->mp_pgno, mp->mp_flags);
+    return MDBX_CORRUPTED;
+  }
+  const size_t nkeys = page_numkeys(mp);
+  size_t i = mc->mc_ki[mc->mc_top], n = 0;
+  if (unlikely(i >= nkeys)) {
+    cASSERT(mc, op == MDBX_GET_CURRENT);
+    cASSERT(mc, mdbx_cursor_on_last(mc) == MDBX_RESULT_TRUE);
+    *count = 0;
+    if (mc->mc_flags & C_EOF) {
+      cASSERT(mc, mdbx_cursor_on_last(mc) == MDBX_RESULT_TRUE);
+      return MDBX_ENODATA;
     }
-    nsize = node_ds(node) - delta;
-    len = PAGEHDRSZ;
+    if (mdbx_cursor_on_last(mc) != MDBX_RESULT_TRUE)
+      return MDBX_EINVAL /* again MDBX_GET_CURRENT after MDBX_GET_CURRENT */;
+    mc->mc_flags |= C_EOF;
+    return MDBX_NOTFOUND;
   }
-  sp->mp_upper = sp->mp_lower;
-  sp->mp_pgno = mp->mp_pgno;
-  node_set_ds(node, nsize);
-
-  /* Shift <lower nodes...initial part of subpage> upward */
-  void *const base = ptr_disp(mp, mp->mp_upper + PAGEHDRSZ);
-  memmove(ptr_disp(base, delta), base, ptr_dist(sp, base) + len);
 
-  ptr = mp->mp_ptrs[indx];
-  for (i = page_numkeys(mp); --i >= 0;) {
-    if (mp->mp_ptrs[i] <= ptr) {
-      assert((size_t)UINT16_MAX - mp->mp_ptrs[i] >= delta);
-      mp->mp_ptrs[i] += (indx_t)delta;
+  do {
+    if (unlikely(n + 2 > limit)) {
+      rc = MDBX_RESULT_TRUE;
+      break;
     }
-  }
-  assert((size_t)UINT16_MAX - mp->mp_upper >= delta);
-  mp->mp_upper += (indx_t)delta;
+    if (IS_LEAF2(mp)) {
+      leaf2_read(mc, mp, i, &pairs[n], &pairs[n + 1]);
+      n += 2;
+      continue;
+    }
+    const MDBX_node *leaf = page_node(mp, i);
+    get_key(leaf, &pairs[n]);
+    rc = node_read(mc, leaf, &pairs[n + 1], mp);
+    if (unlikely(node_flags(leaf) & F_COMPRESSED) && rc == MDBX_SUCCESS)
+      rc = codec_decode(mc, &pairs[n + 1], &pairs[n + 1]);
+    if (unlikely(rc != MDBX_SUCCESS))
+      break;
+    n += 2;
+  } while (++i < nkeys);
+
+  mc->mc_ki[mc->mc_top] = (indx_t)i;
+  *count = n;
+  return rc;
 }
 
-/* Initial setup of a sorted-dups cursor.
- *
- * Sorted duplicates are implemented as a sub-database for the given key.
- * The duplicate data items are actually keys of the sub-database.
- * Operations on the duplicate data items are performed using a sub-cursor
- * initialized when the sub-database is first accessed. This function does
- * the preliminary setup of the sub-cursor, filling in the fields that
- * depend only on the parent DB.
- *
- * [in] mc The main cursor whose sorted-dups cursor is to be initialized. */
-static int cursor_xinit0(MDBX_cursor *mc) {
-  MDBX_xcursor *mx = mc->mc_xcursor;
-  if (!MDBX_DISABLE_VALIDATION && unlikely(mx == nullptr)) {
-    ERROR("unexpected dupsort-page for non-dupsort db/cursor (dbi %u)",
-          mc->mc_dbi);
-    return MDBX_CORRUPTED;
+static int touch_dbi(MDBX_cursor *mc) {
+  cASSERT(mc, (*mc->mc_dbistate & DBI_DIRTY) == 0);
+  *mc->mc_dbistate |= DBI_DIRTY;
+  mc->mc_txn->mt_flags |= MDBX_TXN_DIRTY;
+  /* Запись таблицы в MAIN_DBI для disjoint-транзакции будет обновлена
+   * при фиксации родительской транзакции */
+  if (mc->mc_dbi >= CORE_DBS &&
+      (mc->mc_txn->mt_flags & MDBX_TXN_DISJOINT) == 0) {
+    /* Touch DB record of named DB */
+    MDBX_cursor_couple cx;
+    int rc = cursor_init(&cx.outer, mc->mc_txn, MAIN_DBI);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    mc->mc_txn->mt_dbistate[MAIN_DBI] |= DBI_DIRTY;
+    rc = page_search(&cx.outer, &mc->mc_dbx->md_name, MDBX_PS_MODIFY);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
   }
-
-  mx->mx_cursor.mc_xcursor = NULL;
-  mx->mx_cursor.mc_next = NULL;
-  mx->mx_cursor.mc_txn = mc->mc_txn;
-  mx->mx_cursor.mc_db = &mx->mx_db;
-  mx->mx_cursor.mc_dbx = &mx->mx_dbx;
-  mx->mx_cursor.mc_dbi = mc->mc_dbi;
-  mx->mx_cursor.mc_dbistate = mc->mc_dbistate;
-  mx->mx_cursor.mc_snum = 0;
-  mx->mx_cursor.mc_top = 0;
-  mx->mx_cursor.mc_flags = C_SUB;
-  STATIC_ASSERT(MDBX_DUPFIXED * 2 == P_LEAF2);
-  cASSERT(mc, (mc->mc_checking & (P_BRANCH | P_LEAF | P_LEAF2)) == P_LEAF);
-  mx->mx_cursor.mc_checking =
-      mc->mc_checking + ((mc->mc_db->md_flags & MDBX_DUPFIXED) << 1);
-  mx->mx_dbx.md_name.iov_len = 0;
-  mx->mx_dbx.md_name.iov_base = NULL;
-  mx->mx_dbx.md_cmp = mc->mc_dbx->md_dcmp;
-  mx->mx_dbx.md_dcmp = NULL;
-  mx->mx_dbx.md_klen_min = INT_MAX;
-  mx->mx_dbx.md_vlen_min = mx->mx_dbx.md_klen_max = mx->mx_dbx.md_vlen_max = 0;
   return MDBX_SUCCESS;
 }
 
-/* Final setup of a sorted-dups cursor.
- * Sets up the fields that depend on the data from the main cursor.
- * [in] mc The main cursor whose sorted-dups cursor is to be initialized.
- * [in] node The data containing the MDBX_db record for the sorted-dup database.
- */
-static int cursor_xinit1(MDBX_cursor *mc, MDBX_node *node,
-                         const MDBX_page *mp) {
-  MDBX_xcursor *mx = mc->mc_xcursor;
-  if (!MDBX_DISABLE_VALIDATION && unlikely(mx == nullptr)) {
-    ERROR("unexpected dupsort-page for non-dupsort db/cursor (dbi %u)",
-          mc->mc_dbi);
-    return MDBX_CORRUPTED;
-  }
+static __hot int cursor_touch(MDBX_cursor *const mc, const MDBX_val *key,
+                              const MDBX_val *data) {
+  cASSERT(mc, (mc->mc_txn->mt_flags & MDBX_TXN_RDONLY) == 0);
+  cASSERT(mc, (mc->mc_flags & C_INITIALIZED) || mc->mc_snum == 0);
+  cASSERT(mc, cursor_is_tracked(mc));
 
-  const uint8_t flags = node_flags(node);
-  switch (flags) {
-  default:
-    ERROR("invalid node flags %u", flags);
-    return MDBX_CORRUPTED;
-  case F_DUPDATA | F_SUBDATA:
-    if (!MDBX_DISABLE_VALIDATION &&
-        unlikely(node_ds(node) != sizeof(MDBX_db))) {
-      ERROR("invalid nested-db record size %zu", node_ds(node));
-      return MDBX_CORRUPTED;
-    }
-    memcpy(&mx->mx_db, node_data(node), sizeof(MDBX_db));
-    const txnid_t pp_txnid = mp->mp_txnid;
-    if (!MDBX_DISABLE_VALIDATION &&
-        unlikely(mx->mx_db.md_mod_txnid > pp_txnid)) {
-      ERROR("nested-db.md_mod_txnid (%" PRIaTXN ") > page-txnid (%" PRIaTXN ")",
-            mx->mx_db.md_mod_txnid, pp_txnid);
-      return MDBX_CORRUPTED;
-    }
-    mx->mx_cursor.mc_pg[0] = 0;
-    mx->mx_cursor.mc_snum = 0;
-    mx->mx_cursor.mc_top = 0;
-    mx->mx_cursor.mc_flags = C_SUB;
-    break;
-  case F_DUPDATA:
-    if (!MDBX_DISABLE_VALIDATION && unlikely(node_ds(node) <= PAGEHDRSZ)) {
-      ERROR("invalid nested-page size %zu", node_ds(node));
-      return MDBX_CORRUPTED;
-    }
-    MDBX_page *fp = node_data(node);
-    mx->mx_db.md_depth = 1;
-    mx->mx_db.md_branch_pages = 0;
-    mx->mx_db.md_leaf_pages = 1;
-    mx->mx_db.md_overflow_pages = 0;
-    mx->mx_db.md_entries = page_numkeys(fp);
-    mx->mx_db.md_root = fp->mp_pgno;
-    mx->mx_db.md_mod_txnid = mp->mp_txnid;
-    mx->mx_cursor.mc_snum = 1;
-    mx->mx_cursor.mc_top = 0;
-    mx->mx_cursor.mc_flags = C_SUB | C_INITIALIZED;
-    mx->mx_cursor.mc_pg[0] = fp;
-    mx->mx_cursor.mc_ki[0] = 0;
-    mx->mx_db.md_flags = flags_db2sub(mc->mc_db->md_flags);
-    mx->mx_db.md_xsize =
-        (mc->mc_db->md_flags & MDBX_DUPFIXED) ? fp->mp_leaf2_ksize : 0;
-    break;
-  }
+  if ((mc->mc_flags & C_SUB) == 0) {
+    MDBX_txn *const txn = mc->mc_txn;
+    if (unlikely(!dbi_writable(txn, mc->mc_dbi)))
+      return MDBX_EACCESS;
+    txn_lru_turn(txn);
 
-  if (unlikely(mx->mx_db.md_xsize != mc->mc_db->md_xsize)) {
-    if (!MDBX_DISABLE_VALIDATION && unlikely(mc->mc_db->md_xsize != 0)) {
-      ERROR("cursor mismatched nested-db md_xsize %u", mc->mc_db->md_xsize);
-      return MDBX_CORRUPTED;
-    }
-    if (!MDBX_DISABLE_VALIDATION &&
-        unlikely((mc->mc_db->md_flags & MDBX_DUPFIXED) == 0)) {
-      ERROR("mismatched nested-db md_flags %u", mc->mc_db->md_flags);
-      return MDBX_CORRUPTED;
-    }
-    if (!MDBX_DISABLE_VALIDATION &&
-        unlikely(mx->mx_db.md_xsize < mc->mc_dbx->md_vlen_min ||
-                 mx->mx_db.md_xsize > mc->mc_dbx->md_vlen_max)) {
-      ERROR("mismatched nested-db.md_xsize (%u) <> min/max value-length "
-            "(%zu/%zu)",
-            mx->mx_db.md_xsize, mc->mc_dbx->md_vlen_min,
-            mc->mc_dbx->md_vlen_max);
-      return MDBX_CORRUPTED;
+    if (unlikely((*mc->mc_dbistate & DBI_DIRTY) == 0)) {
+      int err = touch_dbi(mc);
+      if (unlikely(err != MDBX_SUCCESS))
+        return err;
     }
-    mc->mc_db->md_xsize = mx->mx_db.md_xsize;
-    mc->mc_dbx->md_vlen_min = mc->mc_dbx->md_vlen_max = mx->mx_db.md_xsize;
-  }
-  mx->mx_dbx.md_klen_min = mc->mc_dbx->md_vlen_min;
-  mx->mx_dbx.md_klen_max = mc->mc_dbx->md_vlen_max;
 
-  DEBUG("Sub-db -%u root page %" PRIaPGNO, mx->mx_cursor.mc_dbi,
-        mx->mx_db.md_root);
-  return MDBX_SUCCESS;
-}
+    /* Estimate how much space this operation will take: */
+    /* 1) Max b-tree height, reasonable enough with including dups' sub-tree */
+    size_t need = CURSOR_STACK + 3;
+    /* 2) GC/FreeDB for any payload */
+    if (mc->mc_dbi > FREE_DBI) {
+      need += txn->mt_dbs[FREE_DBI].md_depth + (size_t)3;
+      /* 3) Named DBs also dirty the main DB */
+      if (mc->mc_dbi > MAIN_DBI)
+        need += txn->mt_dbs[MAIN_DBI].md_depth + (size_t)3;
+    }
+#if xMDBX_DEBUG_SPILLING != 2
+    /* production mode */
+    /* 4) Double the page chain estimation
+     * for extensively splitting, rebalance and merging */
+    need += need;
+    /* 5) Factor the key+data which to be put in */
+    need += bytes2pgno(txn->mt_env, node_size(key, data)) + (size_t)1;
+#else
+    /* debug mode */
+    (void)key;
+    (void)data;
+    txn->mt_env->debug_dirtied_est = ++need;
+    txn->mt_env->debug_dirtied_act = 0;
+#endif /* xMDBX_DEBUG_SPILLING == 2 */
 
-/* Fixup a sorted-dups cursor due to underlying update.
- * Sets up some fields that depend on the data from the main cursor.
- * Almost the same as init1, but skips initialization steps if the
- * xcursor had already been used.
- * [in] mc The main cursor whose sorted-dups cursor is to be fixed up.
- * [in] src_mx The xcursor of an up-to-date cursor.
- * [in] new_dupdata True if converting from a non-F_DUPDATA item. */
-static int cursor_xinit2(MDBX_cursor *mc, MDBX_xcursor *src_mx,
-                         bool new_dupdata) {
-  MDBX_xcursor *mx = mc->mc_xcursor;
-  if (!MDBX_DISABLE_VALIDATION && unlikely(mx == nullptr)) {
-    ERROR("unexpected dupsort-page for non-dupsort db/cursor (dbi %u)",
-          mc->mc_dbi);
-    return MDBX_CORRUPTED;
+    int err = txn_spill(txn, mc, need);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
   }
 
-  if (new_dupdata) {
-    mx->mx_cursor.mc_snum = 1;
-    mx->mx_cursor.mc_top = 0;
-    mx->mx_cursor.mc_flags = C_SUB | C_INITIALIZED;
-    mx->mx_cursor.mc_ki[0] = 0;
+  int rc = MDBX_SUCCESS;
+  if (likely(mc->mc_snum)) {
+    mc->mc_top = 0;
+    do {
+      rc = page_touch(mc);
+      if (unlikely(rc != MDBX_SUCCESS))
+        break;
+      mc->mc_top += 1;
+    } while (mc->mc_top < mc->mc_snum);
+    mc->mc_top = mc->mc_snum - 1;
   }
+  return rc;
+}
 
-  mx->mx_dbx.md_klen_min = src_mx->mx_dbx.md_klen_min;
-  mx->mx_dbx.md_klen_max = src_mx->mx_dbx.md_klen_max;
-  mx->mx_dbx.md_cmp = src_mx->mx_dbx.md_cmp;
-  mx->mx_db = src_mx->mx_db;
-  mx->mx_cursor.mc_pg[0] = src_mx->mx_cursor.mc_pg[0];
-  if (mx->mx_cursor.mc_flags & C_INITIALIZED) {
-    DEBUG("Sub-db -%u root page %" PRIaPGNO, mx->mx_cursor.mc_dbi,
-          mx->mx_db.md_root);
+/* Запоминает позицию только что вставленного в листовую страницу узла,
+ * с коррекцией ранее запомненных позиций после неё. */
+static __always_inline void split_hint_track(MDBX_cursor *mc) {
+  split_hint_t *hints = mc->mc_dbx->md_split_hints;
+  if (unlikely(!hints)) {
+    /* Для вложенных деревьев история не ведется */
+    if (mc->mc_flags & C_SUB)
+      return;
+    hints = mc->mc_dbx->md_split_hints =
+        osal_calloc(SPLIT_HINT_SLOTS, sizeof(split_hint_t));
+    if (unlikely(!hints))
+      return;
   }
-  return MDBX_SUCCESS;
+  const MDBX_page *const mp = mc->mc_pg[mc->mc_top];
+  split_hint_t *const hint = &hints[mp->mp_pgno % SPLIT_HINT_SLOTS];
+  const indx_t ki = mc->mc_ki[mc->mc_top];
+  if (hint->pgno != mp->mp_pgno) {
+    hint->pgno = mp->mp_pgno;
+    hint->count = hint->appends = 0;
+  }
+  if (ki + (size_t)1 < page_numkeys(mp))
+    hint->appends = 0;
+  else if (hint->appends < UINT16_MAX)
+    hint->appends += 1;
+  const size_t n =
+      (hint->count < SPLIT_HINT_DEPTH) ? hint->count++ : SPLIT_HINT_DEPTH - 1;
+  for (size_t i = n; i > 0; --i)
+    hint->pos[i] = (indx_t)(hint->pos[i - 1] + (hint->pos[i - 1] >= ki));
+  hint->pos[0] = ki;
 }
 
-static __inline int couple_init(MDBX_cursor_couple *couple, const size_t dbi,
-                                MDBX_txn *const txn, MDBX_db *const db,
-                                MDBX_dbx *const dbx, uint8_t *const dbstate) {
-  couple->outer.mc_signature = MDBX_MC_LIVE;
-  couple->outer.mc_next = NULL;
-  couple->outer.mc_backup = NULL;
-  couple->outer.mc_dbi = (MDBX_dbi)dbi;
-  couple->outer.mc_txn = txn;
-  couple->outer.mc_db = db;
-  couple->outer.mc_dbx = dbx;
-  couple->outer.mc_dbistate = dbstate;
-  couple->outer.mc_snum = 0;
-  couple->outer.mc_top = 0;
-  couple->outer.mc_pg[0] = 0;
-  couple->outer.mc_flags = 0;
-  STATIC_ASSERT(CC_BRANCH == P_BRANCH && CC_LEAF == P_LEAF &&
-                CC_OVERFLOW == P_OVERFLOW && CC_LEAF2 == P_LEAF2);
-  couple->outer.mc_checking =
-      (AUDIT_ENABLED() || (txn->mt_env->me_flags & MDBX_VALIDATION))
-          ? CC_PAGECHECK | CC_LEAF
-          : CC_LEAF;
-  couple->outer.mc_ki[0] = 0;
-  couple->outer.mc_xcursor = NULL;
+static __hot int cursor_put_nochecklen(MDBX_cursor *mc, const MDBX_val *key,
+                                       MDBX_val *data, unsigned flags) {
+  MDBX_page *sub_root = nullptr;
+  MDBX_val xdata, *rdata, dkey, olddata;
+  MDBX_db nested_dupdb;
+  int err;
+  DKBUF_DEBUG;
+  MDBX_env *const env = mc->mc_txn->mt_env;
+  DEBUG("==> put db %d key [%s], size %" PRIuPTR ", data [%s] size %" PRIuPTR,
+        DDBI(mc), DKEY_DEBUG(key), key->iov_len,
+        DVAL_DEBUG((flags & MDBX_RESERVE) ? nullptr : data), data->iov_len);
 
-  int rc = MDBX_SUCCESS;
-  if (unlikely(*couple->outer.mc_dbistate & DBI_STALE)) {
-    rc = page_search(&couple->outer, NULL, MDBX_PS_ROOTONLY);
-    rc = (rc != MDBX_NOTFOUND) ? rc : MDBX_SUCCESS;
-  } else if (unlikely(dbx->md_klen_max == 0)) {
-    rc = setup_dbx(dbx, db, txn->mt_env->me_psize);
-  }
-
-  if (couple->outer.mc_db->md_flags & MDBX_DUPSORT) {
-    couple->inner.mx_cursor.mc_signature = MDBX_MC_LIVE;
-    couple->outer.mc_xcursor = &couple->inner;
-    rc = cursor_xinit0(&couple->outer);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    couple->inner.mx_dbx.md_klen_min = couple->outer.mc_dbx->md_vlen_min;
-    couple->inner.mx_dbx.md_klen_max = couple->outer.mc_dbx->md_vlen_max;
-  }
-  return rc;
-}
-
-/* Initialize a cursor for a given transaction and database. */
-static int cursor_init(MDBX_cursor *mc, MDBX_txn *txn, size_t dbi) {
-  STATIC_ASSERT(offsetof(MDBX_cursor_couple, outer) == 0);
-  return couple_init(container_of(mc, MDBX_cursor_couple, outer), dbi, txn,
-                     &txn->mt_dbs[dbi], &txn->mt_dbxs[dbi],
-                     &txn->mt_dbistate[dbi]);
-}
-
-MDBX_cursor *mdbx_cursor_create(void *context) {
-  MDBX_cursor_couple *couple = osal_calloc(1, sizeof(MDBX_cursor_couple));
-  if (unlikely(!couple))
-    return nullptr;
-
-  couple->outer.mc_signature = MDBX_MC_READY4CLOSE;
-  couple->outer.mc_dbi = UINT_MAX;
-  couple->mc_userctx = context;
-  return &couple->outer;
-}
-
-int mdbx_cursor_set_userctx(MDBX_cursor *mc, void *ctx) {
-  if (unlikely(!mc))
-    return MDBX_EINVAL;
-
-  if (unlikely(mc->mc_signature != MDBX_MC_READY4CLOSE &&
-               mc->mc_signature != MDBX_MC_LIVE))
-    return MDBX_EBADSIGN;
-
-  MDBX_cursor_couple *couple = container_of(mc, MDBX_cursor_couple, outer);
-  couple->mc_userctx = ctx;
-  return MDBX_SUCCESS;
-}
-
-void *mdbx_cursor_get_userctx(const MDBX_cursor *mc) {
-  if (unlikely(!mc))
-    return nullptr;
-
-  if (unlikely(mc->mc_signature != MDBX_MC_READY4CLOSE &&
-               mc->mc_signature != MDBX_MC_LIVE))
-    return nullptr;
-
-  MDBX_cursor_couple *couple = container_of(mc, MDBX_cursor_couple, outer);
-  return couple->mc_userctx;
-}
-
-int mdbx_cursor_bind(MDBX_txn *txn, MDBX_cursor *mc, MDBX_dbi dbi) {
-  if (unlikely(!mc))
-    return MDBX_EINVAL;
-
-  if (unlikely(mc->mc_signature != MDBX_MC_READY4CLOSE &&
-               mc->mc_signature != MDBX_MC_LIVE))
-    return MDBX_EBADSIGN;
-
-  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  if (unlikely(!check_dbi(txn, dbi, DBI_VALID)))
-    return MDBX_BAD_DBI;
-
-  if (unlikely(dbi == FREE_DBI && !(txn->mt_flags & MDBX_TXN_RDONLY)))
-    return MDBX_EACCESS;
-
-  if (unlikely(mc->mc_backup)) /* Cursor from parent transaction */ {
-    cASSERT(mc, mc->mc_signature == MDBX_MC_LIVE);
-    if (unlikely(mc->mc_dbi != dbi ||
-                 /* paranoia */ mc->mc_signature != MDBX_MC_LIVE ||
-                 mc->mc_txn != txn))
+  int dupdata_flag = 0;
+  if ((flags & MDBX_CURRENT) != 0 && (mc->mc_flags & C_SUB) == 0) {
+    if (unlikely(flags & (MDBX_APPEND | MDBX_NOOVERWRITE)))
       return MDBX_EINVAL;
+    /* Опция MDBX_CURRENT означает, что запрошено обновление текущей записи,
+     * на которой сейчас стоит курсор. Проверяем что переданный ключ совпадает
+     * со значением в текущей позиции курсора.
+     * Здесь проще вызвать cursor_get(), так как для обслуживания таблиц
+     * с MDBX_DUPSORT также требуется текущий размер данных. */
+    MDBX_val current_key, current_data;
+    err = cursor_get(mc, &current_key, &current_data, MDBX_GET_CURRENT);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
+    if (mc->mc_dbx->md_cmp(key, &current_key) != 0)
+      return MDBX_EKEYMISMATCH;
 
-    assert(mc->mc_db == &txn->mt_dbs[dbi]);
-    assert(mc->mc_dbx == &txn->mt_dbxs[dbi]);
-    assert(mc->mc_dbi == dbi);
-    assert(mc->mc_dbistate == &txn->mt_dbistate[dbi]);
-    return likely(mc->mc_dbi == dbi &&
-                  /* paranoia */ mc->mc_signature == MDBX_MC_LIVE &&
-                  mc->mc_txn == txn)
-               ? MDBX_SUCCESS
-               : MDBX_EINVAL /* Disallow change DBI in nested transactions */;
-  }
+    if (unlikely((flags & MDBX_MULTIPLE)))
+      goto drop_current;
 
-  if (mc->mc_signature == MDBX_MC_LIVE) {
-    if (unlikely(!mc->mc_txn ||
-                 mc->mc_txn->mt_signature != MDBX_MT_SIGNATURE)) {
-      ERROR("Wrong cursor's transaction %p 0x%x",
-            __Wpedantic_format_voidptr(mc->mc_txn),
-            mc->mc_txn ? mc->mc_txn->mt_signature : 0);
-      return MDBX_PROBLEM;
-    }
-    if (mc->mc_flags & C_UNTRACK) {
-      MDBX_cursor **prev = &mc->mc_txn->mt_cursors[mc->mc_dbi];
-      while (*prev && *prev != mc)
-        prev = &(*prev)->mc_next;
-      cASSERT(mc, *prev == mc);
-      *prev = mc->mc_next;
+    if (mc->mc_db->md_flags & MDBX_DUPSORT) {
+      MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+      if (node_flags(node) & F_DUPDATA) {
+        cASSERT(mc, mc->mc_xcursor != NULL &&
+                        (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED));
+        /* Если за ключом более одного значения, либо если размер данных
+         * отличается, то вместо обновления требуется удаление и
+         * последующая вставка. */
+        if (mc->mc_xcursor->mx_db.md_entries > 1 ||
+            current_data.iov_len != data->iov_len) {
+        drop_current:
+          err = cursor_del(mc, flags & MDBX_ALLDUPS);
+          if (unlikely(err != MDBX_SUCCESS))
+            return err;
+          flags -= MDBX_CURRENT;
+          goto skip_check_samedata;
+        }
+      } else if (unlikely(leaf_node_size(key->iov_len, data->iov_len,
+                                         valign(mc->mc_db->md_flags)) >
+                          env->me_leaf_nodemax)) {
+        err = cursor_del(mc, 0);
+        if (unlikely(err != MDBX_SUCCESS))
+          return err;
+        flags -= MDBX_CURRENT;
+        goto skip_check_samedata;
+      }
     }
-    mc->mc_signature = MDBX_MC_READY4CLOSE;
-    mc->mc_flags = 0;
-    mc->mc_dbi = UINT_MAX;
-    mc->mc_next = NULL;
-    mc->mc_db = NULL;
-    mc->mc_dbx = NULL;
-    mc->mc_dbistate = NULL;
+    if (!(flags & MDBX_RESERVE) &&
+        unlikely(cmp_lenfast(&current_data, data) == 0) &&
+        cursor_packed(mc) == (flags & F_COMPRESSED))
+      return MDBX_SUCCESS /* the same data, nothing to update */;
+    if (unlikely(cursor_packed(mc)))
+      vlog_release(mc,
+                   page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]));
+  skip_check_samedata:;
   }
-  cASSERT(mc, !(mc->mc_flags & C_UNTRACK));
 
-  rc = cursor_init(mc, txn, dbi);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+  int rc = MDBX_SUCCESS;
+  if (mc->mc_db->md_root == P_INVALID) {
+    /* new database, cursor has nothing to point to */
+    mc->mc_snum = 0;
+    mc->mc_top = 0;
+    mc->mc_flags &= ~C_INITIALIZED;
+    rc = MDBX_NO_ROOT;
+  } else if ((flags & MDBX_CURRENT) == 0) {
+    bool exact = false;
+    if ((flags & MDBX_APPEND) && mc->mc_db->md_entries > 0) {
+      rc = cursor_last(mc, &dkey, &olddata);
+      if (likely(rc == MDBX_SUCCESS)) {
+        const int cmp = mc->mc_dbx->md_cmp(key, &dkey);
+        if (likely(cmp > 0)) {
+          mc->mc_ki[mc->mc_top]++; /* step forward for appending */
+          rc = MDBX_NOTFOUND;
+        } else if (unlikely(cmp != 0)) {
+          /* new-key < last-key */
+          return MDBX_EKEYMISMATCH;
+        } else {
+          rc = MDBX_SUCCESS;
+          exact = true;
+        }
+      }
+    } else {
+      struct cursor_set_result csr =
+          /* olddata may not be updated in case LEAF2-page of dupfixed-subDB */
+          cursor_set(mc, (MDBX_val *)key, &olddata, MDBX_SET);
+      rc = csr.err;
+      exact = csr.exact;
+    }
+    if (likely(rc == MDBX_SUCCESS)) {
+      if (exact) {
+        if (unlikely(flags & MDBX_NOOVERWRITE)) {
+          DEBUG("duplicate key [%s]", DKEY_DEBUG(key));
+          *data = olddata;
+          return MDBX_KEYEXIST;
+        }
+        if (unlikely(mc->mc_flags & C_SUB)) {
+          /* nested subtree of DUPSORT-database with the same key,
+           * nothing to update */
+          eASSERT(env, data->iov_len == 0 &&
+                           (olddata.iov_len == 0 ||
+                            /* olddata may not be updated in case LEAF2-page
+                               of dupfixed-subDB */
+                            (mc->mc_db->md_flags & MDBX_DUPFIXED)));
+          return MDBX_SUCCESS;
+        }
+        if (unlikely(flags & MDBX_ALLDUPS) && mc->mc_xcursor &&
+            (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED)) {
+          err = cursor_del(mc, MDBX_ALLDUPS);
+          if (unlikely(err != MDBX_SUCCESS))
+            return err;
+          flags -= MDBX_ALLDUPS;
+          rc = mc->mc_snum ? MDBX_NOTFOUND : MDBX_NO_ROOT;
+          exact = false;
+        } else if (!(flags & (MDBX_RESERVE | MDBX_MULTIPLE))) {
+          /* checking for early exit without dirtying pages */
+          if (unlikely(eq_fast(data, &olddata)) &&
+              cursor_packed(mc) == (flags & F_COMPRESSED)) {
+            cASSERT(mc, mc->mc_dbx->md_dcmp(data, &olddata) == 0);
+            if (mc->mc_xcursor) {
+              if (flags & MDBX_NODUPDATA)
+                return MDBX_KEYEXIST;
+              if (flags & MDBX_APPENDDUP)
+                return MDBX_EKEYMISMATCH;
+            }
+            /* the same data, nothing to update */
+            return MDBX_SUCCESS;
+          }
+          cASSERT(mc, mc->mc_dbx->md_dcmp(data, &olddata) != 0 ||
+                          cursor_packed(mc) != (flags & F_COMPRESSED));
+        }
+        if (exact && unlikely(cursor_packed(mc)))
+          vlog_release(mc,
+                       page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]));
+      }
+    } else if (unlikely(rc != MDBX_NOTFOUND))
+      return rc;
+  }
 
-  mc->mc_next = txn->mt_cursors[dbi];
-  txn->mt_cursors[dbi] = mc;
-  mc->mc_flags |= C_UNTRACK;
+  if (unlikely(mc->mc_db->md_flags & MDBX_FIXEDSIZE)) {
+    /* Длина ключа задается первой вставкой и хранится в md_xsize, а длина
+     * записи целиком (ключ и значение) в mp_leaf2_ksize листовых страниц. */
+    cASSERT(mc, (mc->mc_flags & C_SUB) == 0);
+    const size_t klen = mc->mc_db->md_xsize;
+    if (rc == MDBX_NO_ROOT) {
+      if (unlikely((klen && key->iov_len != klen) || key->iov_len == 0 ||
+                   key->iov_len + data->iov_len >
+                       keysize_max(env->me_psize, 0)))
+        return MDBX_BAD_VALSIZE;
+    } else if (unlikely(key->iov_len != klen ||
+                        key->iov_len + data->iov_len !=
+                            mc->mc_pg[mc->mc_top]->mp_leaf2_ksize))
+      return MDBX_BAD_VALSIZE;
+  }
 
-  return MDBX_SUCCESS;
-}
+  mc->mc_flags &= ~C_DEL;
+  rdata = data;
+  size_t mcount = 0, dcount = 0;
+  if (unlikely(flags & MDBX_MULTIPLE)) {
+    dcount = data[1].iov_len;
+    data[1].iov_len = 0 /* reset done item counter */;
+    rdata = &xdata;
+    xdata.iov_len = data->iov_len * dcount;
+  } else if (unlikely(flags & F_BIGDATA)) {
+    /* the data is already on a large page, only a node is to be put in */
+    rdata = &xdata;
+    xdata.iov_len = sizeof(pgno_t);
+  }
 
-int mdbx_cursor_open(MDBX_txn *txn, MDBX_dbi dbi, MDBX_cursor **ret) {
-  if (unlikely(!ret))
-    return MDBX_EINVAL;
-  *ret = NULL;
+  /* Cursor is positioned, check for room in the dirty list */
+  err = cursor_touch(mc, key, rdata);
+  if (unlikely(err))
+    return err;
 
-  MDBX_cursor *const mc = mdbx_cursor_create(nullptr);
-  if (unlikely(!mc))
-    return MDBX_ENOMEM;
-
-  int rc = mdbx_cursor_bind(txn, mc, dbi);
-  if (unlikely(rc != MDBX_SUCCESS)) {
-    mdbx_cursor_close(mc);
-    return rc;
-  }
-
-  *ret = mc;
-  return MDBX_SUCCESS;
-}
-
-int mdbx_cursor_renew(MDBX_txn *txn, MDBX_cursor *mc) {
-  return likely(mc) ? mdbx_cursor_bind(txn, mc, mc->mc_dbi) : MDBX_EINVAL;
-}
-
-int mdbx_cursor_copy(const MDBX_cursor *src, MDBX_cursor *dest) {
-  if (unlikely(!src))
-    return MDBX_EINVAL;
-  if (unlikely(src->mc_signature != MDBX_MC_LIVE))
-    return (src->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
-                                                      : MDBX_EBADSIGN;
-
-  int rc = mdbx_cursor_bind(src->mc_txn, dest, src->mc_dbi);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  assert(dest->mc_db == src->mc_db);
-  assert(dest->mc_dbi == src->mc_dbi);
-  assert(dest->mc_dbx == src->mc_dbx);
-  assert(dest->mc_dbistate == src->mc_dbistate);
-again:
-  assert(dest->mc_txn == src->mc_txn);
-  dest->mc_flags ^= (dest->mc_flags ^ src->mc_flags) & ~C_UNTRACK;
-  dest->mc_top = src->mc_top;
-  dest->mc_snum = src->mc_snum;
-  for (size_t i = 0; i < src->mc_snum; ++i) {
-    dest->mc_ki[i] = src->mc_ki[i];
-    dest->mc_pg[i] = src->mc_pg[i];
-  }
-
-  if (src->mc_xcursor) {
-    dest->mc_xcursor->mx_db = src->mc_xcursor->mx_db;
-    dest->mc_xcursor->mx_dbx = src->mc_xcursor->mx_dbx;
-    src = &src->mc_xcursor->mx_cursor;
-    dest = &dest->mc_xcursor->mx_cursor;
-    goto again;
+  if (unlikely(rc == MDBX_NO_ROOT)) {
+    /* new database, write a root leaf page */
+    DEBUG("%s", "allocating new root leaf page");
+    pgr_t npr = page_new(mc, P_LEAF);
+    if (unlikely(npr.err != MDBX_SUCCESS))
+      return npr.err;
+    npr.err = cursor_push(mc, npr.page);
+    if (unlikely(npr.err != MDBX_SUCCESS))
+      return npr.err;
+    mc->mc_db->md_root = npr.page->mp_pgno;
+    mc->mc_db->md_depth++;
+    if (mc->mc_db->md_flags & MDBX_INTEGERKEY) {
+      assert(key->iov_len >= mc->mc_dbx->md_klen_min &&
+             key->iov_len <= mc->mc_dbx->md_klen_max);
+      mc->mc_dbx->md_klen_min = mc->mc_dbx->md_klen_max = key->iov_len;
+    }
+    if (mc->mc_db->md_flags & (MDBX_INTEGERDUP | MDBX_DUPFIXED)) {
+      assert(data->iov_len >= mc->mc_dbx->md_vlen_min &&
+             data->iov_len <= mc->mc_dbx->md_vlen_max);
+      assert(mc->mc_xcursor != NULL);
+      mc->mc_db->md_xsize = mc->mc_xcursor->mx_db.md_xsize =
+          (unsigned)(mc->mc_dbx->md_vlen_min = mc->mc_dbx->md_vlen_max =
+                         mc->mc_xcursor->mx_dbx.md_klen_min =
+                             mc->mc_xcursor->mx_dbx.md_klen_max =
+                                 data->iov_len);
+    }
+    if ((mc->mc_db->md_flags & (MDBX_DUPSORT | MDBX_DUPFIXED)) == MDBX_DUPFIXED)
+      npr.page->mp_flags |= P_LEAF2;
+    if (mc->mc_db->md_flags & MDBX_FIXEDSIZE) {
+      npr.page->mp_flags |= P_LEAF2;
+      npr.page->mp_leaf2_ksize = (uint16_t)(key->iov_len + data->iov_len);
+      mc->mc_db->md_xsize = (uint32_t)(mc->mc_dbx->md_klen_min =
+                                           mc->mc_dbx->md_klen_max =
+                                               key->iov_len);
+    }
+    mc->mc_flags |= C_INITIALIZED;
   }
 
-  return MDBX_SUCCESS;
-}
+  bool insert_key, insert_data, do_sub = false;
+  insert_key = insert_data = (rc != MDBX_SUCCESS);
+  uint16_t fp_flags = P_LEAF;
+  MDBX_page *fp = txn_scratch(mc->mc_txn);
+  fp->mp_txnid = mc->mc_txn->mt_front;
+  if (insert_key) {
+    /* The key does not exist */
+    DEBUG("inserting key at index %i", mc->mc_ki[mc->mc_top]);
+    if ((mc->mc_db->md_flags & MDBX_DUPSORT) &&
+        node_size(key, data) > env->me_leaf_nodemax) {
+      /* Too big for a node, insert in sub-DB.  Set up an empty
+       * "old sub-page" for prep_subDB to expand to a full page. */
+      fp->mp_leaf2_ksize =
+          (mc->mc_db->md_flags & MDBX_DUPFIXED) ? (uint16_t)data->iov_len : 0;
+      fp->mp_lower = fp->mp_upper = 0;
+      olddata.iov_len = PAGEHDRSZ;
+      goto prep_subDB;
+    }
+  } else {
+    /* there's only a key anyway, so this is a no-op */
+    if (IS_LEAF2(mc->mc_pg[mc->mc_top])) {
+      size_t ksize = mc->mc_db->md_xsize;
+      if (unlikely(key->iov_len != ksize))
+        return MDBX_BAD_VALSIZE;
+      void *ptr =
+          page_leaf2key(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top], ksize);
+      leaf2_fill(ptr, key,
+                 (mc->mc_db->md_flags & MDBX_FIXEDSIZE) ? data : nullptr,
+                 flags);
+    fix_parent:
+      /* if overwriting slot 0 of leaf, need to
+       * update branch key if there is a parent page */
+      if (mc->mc_top && !mc->mc_ki[mc->mc_top]) {
+        size_t dtop = 1;
+        mc->mc_top--;
+        /* slot 0 is always an empty key, find real slot */
+        while (mc->mc_top && !mc->mc_ki[mc->mc_top]) {
+          mc->mc_top--;
+          dtop++;
+        }
+        err = MDBX_SUCCESS;
+        if (mc->mc_ki[mc->mc_top])
+          err = update_key(mc, key);
+        cASSERT(mc, mc->mc_top + dtop < UINT16_MAX);
+        mc->mc_top += (uint8_t)dtop;
+        if (unlikely(err != MDBX_SUCCESS))
+          return err;
+      }
 
-void mdbx_cursor_close(MDBX_cursor *mc) {
-  if (likely(mc)) {
-    ENSURE(NULL, mc->mc_signature == MDBX_MC_LIVE ||
-                     mc->mc_signature == MDBX_MC_READY4CLOSE);
-    MDBX_txn *const txn = mc->mc_txn;
-    if (!mc->mc_backup) {
-      mc->mc_txn = NULL;
-      /* Unlink from txn, if tracked. */
-      if (mc->mc_flags & C_UNTRACK) {
-        ENSURE(txn->mt_env, check_txn(txn, 0) == MDBX_SUCCESS);
-        MDBX_cursor **prev = &txn->mt_cursors[mc->mc_dbi];
-        while (*prev && *prev != mc)
-          prev = &(*prev)->mc_next;
-        tASSERT(txn, *prev == mc);
-        *prev = mc->mc_next;
+      if (AUDIT_ENABLED()) {
+        err = cursor_check(mc);
+        if (unlikely(err != MDBX_SUCCESS))
+          return err;
       }
-      mc->mc_signature = 0;
-      mc->mc_next = mc;
-      osal_free(mc);
-    } else {
-      /* Cursor closed before nested txn ends */
-      tASSERT(txn, mc->mc_signature == MDBX_MC_LIVE);
-      ENSURE(txn->mt_env, check_txn_rw(txn, 0) == MDBX_SUCCESS);
-      mc->mc_signature = MDBX_MC_WAIT4EOT;
+      return MDBX_SUCCESS;
     }
-  }
-}
 
-MDBX_txn *mdbx_cursor_txn(const MDBX_cursor *mc) {
-  if (unlikely(!mc || mc->mc_signature != MDBX_MC_LIVE))
-    return NULL;
-  MDBX_txn *txn = mc->mc_txn;
-  if (unlikely(!txn || txn->mt_signature != MDBX_MT_SIGNATURE))
-    return NULL;
-  if (unlikely(txn->mt_flags & MDBX_TXN_FINISHED))
-    return NULL;
-  return txn;
-}
+  more:;
+    if (AUDIT_ENABLED()) {
+      err = cursor_check(mc);
+      if (unlikely(err != MDBX_SUCCESS))
+        return err;
+    }
+    MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
 
-MDBX_dbi mdbx_cursor_dbi(const MDBX_cursor *mc) {
-  if (unlikely(!mc || mc->mc_signature != MDBX_MC_LIVE))
-    return UINT_MAX;
-  return mc->mc_dbi;
-}
+    /* Large/Overflow page overwrites need special handling */
+    if (unlikely(node_flags(node) & F_BIGDATA)) {
+      const size_t align = valign(mc->mc_db->md_flags);
+      const size_t dpages =
+          (leaf_node_size(key->iov_len, data->iov_len, align) >
+           env->me_leaf_nodemax)
+              ? largedata_npages(env, data->iov_len, align)
+              : 0;
 
-/* Return the count of duplicate data items for the current key */
-int mdbx_cursor_count(const MDBX_cursor *mc, size_t *countp) {
-  if (unlikely(mc == NULL))
-    return MDBX_EINVAL;
+      const pgno_t pgno = node_largedata_pgno(node);
+      pgr_t lp = page_get_large(mc, pgno, mc->mc_pg[mc->mc_top]->mp_txnid);
+      if (unlikely(lp.err != MDBX_SUCCESS))
+        return lp.err;
+      cASSERT(mc, PAGETYPE_WHOLE(lp.page) == P_OVERFLOW);
 
-  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
-    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
-                                                     : MDBX_EBADSIGN;
+      /* Is the ov page from this txn (or a parent) and big enough? */
+      const size_t ovpages = lp.page->mp_pages;
+      const size_t extra_threshold =
+          (mc->mc_dbi == FREE_DBI)
+              ? 1
+              : /* LY: add configurable threshold to keep reserve space */ 0;
+      if (!IS_FROZEN(mc->mc_txn, lp.page) && ovpages >= dpages &&
+          ovpages <= dpages + extra_threshold) {
+        /* yes, overwrite it. */
+        if (!IS_MODIFIABLE(mc->mc_txn, lp.page)) {
+          if (IS_SPILLED(mc->mc_txn, lp.page)) {
+            lp = /* TODO: avoid search and get txn & spill-index from
+                     page_result */
+                page_unspill(mc->mc_txn, lp.page);
+            if (unlikely(lp.err))
+              return lp.err;
+          } else {
+            if (unlikely(!mc->mc_txn->mt_parent)) {
+              ERROR("Unexpected not frozen/modifiable/spilled but shadowed %s "
+                    "page %" PRIaPGNO " mod-txnid %" PRIaTXN ","
+                    " without parent transaction, current txn %" PRIaTXN
+                    " front %" PRIaTXN,
+                    "overflow/large", pgno, lp.page->mp_txnid,
+                    mc->mc_txn->mt_txnid, mc->mc_txn->mt_front);
+              return MDBX_PROBLEM;
+            }
 
-  int rc = check_txn(mc->mc_txn, MDBX_TXN_BLOCKED);
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
+            /* It is writable only in a parent txn */
+            MDBX_page *np = page_malloc(mc->mc_txn, ovpages);
+            if (unlikely(!np))
+              return MDBX_ENOMEM;
 
-  if (unlikely(countp == NULL || !(mc->mc_flags & C_INITIALIZED)))
-    return MDBX_EINVAL;
+            memcpy(np, lp.page, PAGEHDRSZ); /* Copy header of page */
+            err = page_dirty(mc->mc_txn, lp.page = np, ovpages);
+            if (unlikely(err != MDBX_SUCCESS))
+              return err;
 
-  if (!mc->mc_snum) {
-    *countp = 0;
-    return MDBX_NOTFOUND;
-  }
+#if MDBX_ENABLE_PGOP_STAT
+            mc->mc_txn->mt_env->me_lck->mti_pgop_stat.clone.weak += ovpages;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+            cASSERT(mc, dirtylist_check(mc->mc_txn));
+          }
+        }
+        node_set_ds(node, data->iov_len);
+        node_set_flags(node, F_BIGDATA | (flags & F_COMPRESSED));
+        if (flags & MDBX_RESERVE)
+          data->iov_base = ptr_disp(lp.page, largedata_offset(align));
+        else
+          memcpy(ptr_disp(lp.page, largedata_offset(align)), data->iov_base,
+                 data->iov_len);
 
-  MDBX_page *mp = mc->mc_pg[mc->mc_top];
-  if ((mc->mc_flags & C_EOF) && mc->mc_ki[mc->mc_top] >= page_numkeys(mp)) {
-    *countp = 0;
-    return MDBX_NOTFOUND;
-  }
+        if (AUDIT_ENABLED()) {
+          err = cursor_check(mc);
+          if (unlikely(err != MDBX_SUCCESS))
+            return err;
+        }
+        return MDBX_SUCCESS;
+      }
 
-  *countp = 1;
-  if (mc->mc_xcursor != NULL) {
-    MDBX_node *node = page_node(mp, mc->mc_ki[mc->mc_top]);
-    if (node_flags(node) & F_DUPDATA) {
-      cASSERT(mc, mc->mc_xcursor &&
-                      (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED));
-      *countp = unlikely(mc->mc_xcursor->mx_db.md_entries > PTRDIFF_MAX)
-                    ? PTRDIFF_MAX
-                    : (size_t)mc->mc_xcursor->mx_db.md_entries;
-    }
-  }
-  return MDBX_SUCCESS;
-}
+      if ((err = page_retire(mc, lp.page)) != MDBX_SUCCESS)
+        return err;
+    } else {
+      olddata.iov_len = node_ds(node);
+      olddata.iov_base = node_data(node);
+      cASSERT(mc, ptr_disp(olddata.iov_base, olddata.iov_len) <=
+                      ptr_disp(mc->mc_pg[mc->mc_top], env->me_psize));
 
-/* Replace the key for a branch node with a new key.
- * Set MDBX_TXN_ERROR on failure.
- * [in] mc Cursor pointing to the node to operate on.
- * [in] key The new key to use.
- * Returns 0 on success, non-zero on failure. */
-static int update_key(MDBX_cursor *mc, const MDBX_val *key) {
-  MDBX_page *mp;
-  MDBX_node *node;
-  size_t len;
-  ptrdiff_t delta, ksize, oksize;
-  intptr_t ptr, i, nkeys, indx;
-  DKBUF_DEBUG;
+      /* DB has dups? */
+      if (mc->mc_db->md_flags & MDBX_DUPSORT) {
+        /* Prepare (sub-)page/sub-DB to accept the new item, if needed.
+         * fp: old sub-page or a header faking it.
+         * mp: new (sub-)page.  offset: growth in page size.
+         * xdata: node data with new page or DB. */
+        size_t i;
+        size_t offset = 0;
+        MDBX_page *mp = fp = xdata.iov_base = txn_scratch(mc->mc_txn);
+        mp->mp_pgno = mc->mc_pg[mc->mc_top]->mp_pgno;
 
-  cASSERT(mc, cursor_is_tracked(mc));
-  indx = mc->mc_ki[mc->mc_top];
-  mp = mc->mc_pg[mc->mc_top];
-  node = page_node(mp, indx);
-  ptr = mp->mp_ptrs[indx];
-#if MDBX_DEBUG
-  MDBX_val k2;
-  k2.iov_base = node_key(node);
-  k2.iov_len = node_ks(node);
-  DEBUG("update key %zi (offset %zu) [%s] to [%s] on page %" PRIaPGNO, indx,
-        ptr, DVAL_DEBUG(&k2), DKEY_DEBUG(key), mp->mp_pgno);
-#endif /* MDBX_DEBUG */
+        /* Was a single item before, must convert now */
+        if (!(node_flags(node) & F_DUPDATA)) {
+          /* does data match? */
+          if (flags & MDBX_APPENDDUP) {
+            const int cmp = mc->mc_dbx->md_dcmp(data, &olddata);
+            cASSERT(mc, cmp != 0 || eq_fast(data, &olddata));
+            if (unlikely(cmp <= 0))
+              return MDBX_EKEYMISMATCH;
+          } else if (eq_fast(data, &olddata)) {
+            cASSERT(mc, mc->mc_dbx->md_dcmp(data, &olddata) == 0);
+            if (flags & MDBX_NODUPDATA)
+              return MDBX_KEYEXIST;
+            /* data is match exactly byte-to-byte, nothing to update */
+            rc = MDBX_SUCCESS;
+            if (likely((flags & MDBX_MULTIPLE) == 0))
+              return rc;
+            goto continue_multiple;
+          }
 
-  /* Sizes must be 2-byte aligned. */
-  ksize = EVEN(key->iov_len);
-  oksize = EVEN(node_ks(node));
-  delta = ksize - oksize;
+          /* Just overwrite the current item */
+          if (flags & MDBX_CURRENT) {
+            cASSERT(mc, node_size(key, data) <= env->me_leaf_nodemax);
+            goto current;
+          }
 
-  /* Shift node contents if EVEN(key length) changed. */
-  if (delta) {
-    if (delta > (int)page_room(mp)) {
-      /* not enough space left, do a delete and split */
-      DEBUG("Not enough room, delta = %zd, splitting...", delta);
-      pgno_t pgno = node_pgno(node);
-      node_del(mc, 0);
-      int err = page_split(mc, key, NULL, pgno, MDBX_SPLIT_REPLACE);
-      if (err == MDBX_SUCCESS && AUDIT_ENABLED())
-        err = cursor_check_updating(mc);
-      return err;
-    }
+          /* Back up original data item */
+          memcpy(dkey.iov_base = fp + 1, olddata.iov_base,
+                 dkey.iov_len = olddata.iov_len);
+          dupdata_flag = 1;
 
-    nkeys = page_numkeys(mp);
-    for (i = 0; i < nkeys; i++) {
-      if (mp->mp_ptrs[i] <= ptr) {
-        cASSERT(mc, mp->mp_ptrs[i] >= delta);
-        mp->mp_ptrs[i] -= (indx_t)delta;
+          /* Make sub-page header for the dup items, with dummy body */
+          fp->mp_flags = P_LEAF | P_SUBP;
+          fp->mp_lower = 0;
+          xdata.iov_len = PAGEHDRSZ + dkey.iov_len + data->iov_len;
+          if (mc->mc_db->md_flags & MDBX_DUPFIXED) {
+            fp->mp_flags |= P_LEAF2;
+            fp->mp_leaf2_ksize = (uint16_t)data->iov_len;
+            xdata.iov_len += 2 * data->iov_len; /* leave space for 2 more */
+            cASSERT(mc, xdata.iov_len <= env->me_psize);
+          } else {
+            xdata.iov_len += 2 * (sizeof(indx_t) + NODESIZE) +
+                             (dkey.iov_len & 1) + (data->iov_len & 1);
+            cASSERT(mc, xdata.iov_len <= env->me_psize);
+          }
+          fp->mp_upper = (uint16_t)(xdata.iov_len - PAGEHDRSZ);
+          olddata.iov_len = xdata.iov_len; /* pretend olddata is fp */
+        } else if (node_flags(node) & F_SUBDATA) {
+          /* Data is on sub-DB, just store it */
+          flags |= F_DUPDATA | F_SUBDATA;
+          goto put_sub;
+        } else {
+          /* Data is on sub-page */
+          fp = olddata.iov_base;
+          switch (flags) {
+          default:
+            if (!(mc->mc_db->md_flags & MDBX_DUPFIXED)) {
+              offset = node_size(data, nullptr) + sizeof(indx_t);
+              break;
+            }
+            offset = fp->mp_leaf2_ksize;
+            if (page_room(fp) < offset) {
+              offset *= 4; /* space for 4 more */
+              break;
+            }
+            /* FALLTHRU: Big enough MDBX_DUPFIXED sub-page */
+            __fallthrough;
+          case MDBX_CURRENT | MDBX_NODUPDATA:
+          case MDBX_CURRENT:
+            fp->mp_txnid = mc->mc_txn->mt_front;
+            fp->mp_pgno = mp->mp_pgno;
+            mc->mc_xcursor->mx_cursor.mc_pg[0] = fp;
+            flags |= F_DUPDATA;
+            goto put_sub;
+          }
+          xdata.iov_len = olddata.iov_len + offset;
+        }
+
+        fp_flags = fp->mp_flags;
+        if (node_size_len(node_ks(node), xdata.iov_len) >
+            env->me_leaf_nodemax) {
+          /* Too big for a sub-page, convert to sub-DB */
+          fp_flags &= ~P_SUBP;
+        prep_subDB:
+          nested_dupdb.md_xsize = 0;
+          nested_dupdb.md_flags = flags_db2sub(mc->mc_db->md_flags);
+          if (mc->mc_db->md_flags & MDBX_DUPFIXED) {
+            fp_flags |= P_LEAF2;
+            nested_dupdb.md_xsize = fp->mp_leaf2_ksize;
+          }
+          nested_dupdb.md_depth = 1;
+          nested_dupdb.md_branch_pages = 0;
+          nested_dupdb.md_leaf_pages = 1;
+          nested_dupdb.md_overflow_pages = 0;
+          nested_dupdb.md_entries = page_numkeys(fp);
+          xdata.iov_len = sizeof(nested_dupdb);
+          xdata.iov_base = &nested_dupdb;
+          const pgr_t par = page_alloc(mc);
+          mp = par.page;
+          if (unlikely(par.err != MDBX_SUCCESS))
+            return par.err;
+          mc->mc_db->md_leaf_pages += 1;
+          cASSERT(mc, env->me_psize > olddata.iov_len);
+          offset = env->me_psize - (unsigned)olddata.iov_len;
+          flags |= F_DUPDATA | F_SUBDATA;
+          nested_dupdb.md_root = mp->mp_pgno;
+          nested_dupdb.md_seq = 0;
+          nested_dupdb.md_mod_txnid = mc->mc_txn->mt_txnid;
+          sub_root = mp;
+        }
+        if (mp != fp) {
+          mp->mp_flags = fp_flags;
+          mp->mp_txnid = mc->mc_txn->mt_front;
+          mp->mp_leaf2_ksize = fp->mp_leaf2_ksize;
+          mp->mp_lower = fp->mp_lower;
+          cASSERT(mc, fp->mp_upper + offset <= UINT16_MAX);
+          mp->mp_upper = (indx_t)(fp->mp_upper + offset);
+          if (unlikely(fp_flags & P_LEAF2)) {
+            memcpy(page_data(mp), page_data(fp),
+                   page_numkeys(fp) * fp->mp_leaf2_ksize);
+          } else {
+            memcpy(ptr_disp(mp, mp->mp_upper + PAGEHDRSZ),
+                   ptr_disp(fp, fp->mp_upper + PAGEHDRSZ),
+                   olddata.iov_len - fp->mp_upper - PAGEHDRSZ);
+            memcpy(mp->mp_ptrs, fp->mp_ptrs,
+                   page_numkeys(fp) * sizeof(mp->mp_ptrs[0]));
+            for (i = 0; i < page_numkeys(fp); i++) {
+              cASSERT(mc, mp->mp_ptrs[i] + offset <= UINT16_MAX);
+              mp->mp_ptrs[i] += (indx_t)offset;
+            }
+          }
+        }
+
+        rdata = &xdata;
+        flags |= F_DUPDATA;
+        do_sub = true;
+        if (!insert_key)
+          node_del(mc, 0);
+        goto new_sub;
       }
-    }
 
-    void *const base = ptr_disp(mp, mp->mp_upper + PAGEHDRSZ);
-    len = ptr - mp->mp_upper + NODESIZE;
-    memmove(ptr_disp(base, -delta), base, len);
-    cASSERT(mc, mp->mp_upper >= delta);
-    mp->mp_upper -= (indx_t)delta;
+      /* MDBX passes F_SUBDATA in 'flags' to write a DB record */
+      if (unlikely((node_flags(node) ^ flags) & F_SUBDATA))
+        return MDBX_INCOMPATIBLE;
 
-    node = page_node(mp, indx);
+    current:
+      if (data->iov_len == olddata.iov_len) {
+        cASSERT(mc, EVEN(key->iov_len) == EVEN(node_ks(node)));
+        /* same size, just replace it. Note that we could
+         * also reuse this node if the new data is smaller,
+         * but instead we opt to shrink the node in that case. */
+        if (!(mc->mc_flags & C_SUB))
+          node_set_flags(node,
+                         (node_flags(node) & ~F_COMPRESSED) |
+                             (flags & F_COMPRESSED));
+        if (flags & MDBX_RESERVE)
+          data->iov_base = olddata.iov_base;
+        else if (!(mc->mc_flags & C_SUB))
+          memcpy(olddata.iov_base, data->iov_base, data->iov_len);
+        else {
+          cASSERT(mc, page_numkeys(mc->mc_pg[mc->mc_top]) == 1);
+          cASSERT(mc, PAGETYPE_COMPAT(mc->mc_pg[mc->mc_top]) == P_LEAF);
+          cASSERT(mc, node_ds(node) == 0);
+          cASSERT(mc, node_flags(node) == 0);
+          cASSERT(mc, key->iov_len < UINT16_MAX);
+          node_set_ks(node, key->iov_len);
+          memcpy(node_key(node), key->iov_base, key->iov_len);
+          cASSERT(mc, ptr_disp(node_key(node), node_ds(node)) <
+                          ptr_disp(mc->mc_pg[mc->mc_top], env->me_psize));
+          goto fix_parent;
+        }
+
+        if (AUDIT_ENABLED()) {
+          err = cursor_check(mc);
+          if (unlikely(err != MDBX_SUCCESS))
+            return err;
+        }
+        return MDBX_SUCCESS;
+      }
+    }
+    node_del(mc, 0);
   }
 
-  /* But even if no shift was needed, update ksize */
-  node_set_ks(node, key->iov_len);
+  rdata = data;
 
-  if (likely(key->iov_len /* to avoid UBSAN traps*/ != 0))
-    memcpy(node_key(node), key->iov_base, key->iov_len);
-  return MDBX_SUCCESS;
-}
-
-/* Move a node from csrc to cdst. */
-static int node_move(MDBX_cursor *csrc, MDBX_cursor *cdst, bool fromleft) {
-  int rc;
-  DKBUF_DEBUG;
-
-  MDBX_page *psrc = csrc->mc_pg[csrc->mc_top];
-  MDBX_page *pdst = cdst->mc_pg[cdst->mc_top];
-  cASSERT(csrc, PAGETYPE_WHOLE(psrc) == PAGETYPE_WHOLE(pdst));
-  cASSERT(csrc, csrc->mc_dbi == cdst->mc_dbi);
-  cASSERT(csrc, csrc->mc_top == cdst->mc_top);
-  if (unlikely(PAGETYPE_WHOLE(psrc) != PAGETYPE_WHOLE(pdst))) {
-  bailout:
-    ERROR("Wrong or mismatch pages's types (src %d, dst %d) to move node",
-          PAGETYPE_WHOLE(psrc), PAGETYPE_WHOLE(pdst));
-    csrc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-    return MDBX_PROBLEM;
+new_sub:;
+  const unsigned naf = flags & NODE_ADD_FLAGS;
+  size_t nsize = IS_LEAF2(mc->mc_pg[mc->mc_top])
+                     ? key->iov_len + rdata->iov_len
+                     : leaf_size(env, key, rdata, valign(mc->mc_db->md_flags));
+  if (page_room(mc->mc_pg[mc->mc_top]) < nsize) {
+    rc = page_split(mc, key, rdata, P_INVALID,
+                    insert_key ? naf : naf | MDBX_SPLIT_REPLACE);
+    if (rc == MDBX_SUCCESS && AUDIT_ENABLED())
+      rc = insert_key ? cursor_check(mc) : cursor_check_updating(mc);
+  } else {
+    /* There is room already in this leaf page. */
+    if (IS_LEAF2(mc->mc_pg[mc->mc_top])) {
+      cASSERT(mc, !(naf & (F_BIGDATA | F_SUBDATA | F_DUPDATA)) &&
+                      (rdata->iov_len == 0 ||
+                       (mc->mc_db->md_flags & MDBX_FIXEDSIZE)));
+      rc = node_add_leaf2(mc, mc->mc_ki[mc->mc_top], key, rdata, naf);
+    } else
+      rc = node_add_leaf(mc, mc->mc_ki[mc->mc_top], key, rdata, naf);
+    if (likely(rc == 0)) {
+      /* Adjust other cursors pointing to mp */
+      const MDBX_dbi dbi = mc->mc_dbi;
+      const size_t i = mc->mc_top;
+      MDBX_page *const mp = mc->mc_pg[i];
+      for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[dbi]; m2;
+           m2 = m2->mc_next) {
+        MDBX_cursor *m3 =
+            (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+        if (m3 == mc || m3->mc_snum < mc->mc_snum || m3->mc_pg[i] != mp)
+          continue;
+        if (m3->mc_ki[i] >= mc->mc_ki[i])
+          m3->mc_ki[i] += insert_key;
+        if (XCURSOR_INITED(m3))
+          XCURSOR_REFRESH(m3, mp, m3->mc_ki[i]);
+      }
+    }
   }
 
-  MDBX_val key4move;
-  switch (PAGETYPE_WHOLE(psrc)) {
-  case P_BRANCH: {
-    const MDBX_node *srcnode = page_node(psrc, csrc->mc_ki[csrc->mc_top]);
-    cASSERT(csrc, node_flags(srcnode) == 0);
-    const pgno_t srcpg = node_pgno(srcnode);
-    key4move.iov_len = node_ks(srcnode);
-    key4move.iov_base = node_key(srcnode);
+  if (likely(rc == MDBX_SUCCESS) && insert_key)
+    split_hint_track(mc);
 
-    if (csrc->mc_ki[csrc->mc_top] == 0) {
-      const size_t snum = csrc->mc_snum;
-      cASSERT(csrc, snum > 0);
-      /* must find the lowest key below src */
-      rc = page_search_lowest(csrc);
-      MDBX_page *lowest_page = csrc->mc_pg[csrc->mc_top];
-      if (unlikely(rc))
-        return rc;
-      cASSERT(csrc, IS_LEAF(lowest_page));
-      if (unlikely(!IS_LEAF(lowest_page)))
-        goto bailout;
-      if (IS_LEAF2(lowest_page)) {
-        key4move.iov_len = csrc->mc_db->md_xsize;
-        key4move.iov_base = page_leaf2key(lowest_page, 0, key4move.iov_len);
-      } else {
-        const MDBX_node *lowest_node = page_node(lowest_page, 0);
-        key4move.iov_len = node_ks(lowest_node);
-        key4move.iov_base = node_key(lowest_node);
+  if (likely(rc == MDBX_SUCCESS)) {
+    /* Now store the actual data in the child DB. Note that we're
+     * storing the user data in the keys field, so there are strict
+     * size limits on dupdata. The actual data fields of the child
+     * DB are all zero size. */
+    if (do_sub) {
+      int xflags;
+      size_t ecount;
+    put_sub:
+      xdata.iov_len = 0;
+      xdata.iov_base = nullptr;
+      MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
+#define SHIFT_MDBX_NODUPDATA_TO_MDBX_NOOVERWRITE 1
+      STATIC_ASSERT(
+          (MDBX_NODUPDATA >> SHIFT_MDBX_NODUPDATA_TO_MDBX_NOOVERWRITE) ==
+          MDBX_NOOVERWRITE);
+      xflags = MDBX_CURRENT | ((flags & MDBX_NODUPDATA) >>
+                               SHIFT_MDBX_NODUPDATA_TO_MDBX_NOOVERWRITE);
+      if ((flags & MDBX_CURRENT) == 0) {
+        xflags -= MDBX_CURRENT;
+        err = cursor_xinit1(mc, node, mc->mc_pg[mc->mc_top]);
+        if (unlikely(err != MDBX_SUCCESS))
+          return err;
       }
+      if (sub_root)
+        mc->mc_xcursor->mx_cursor.mc_pg[0] = sub_root;
+      /* converted, write the original data first */
+      if (dupdata_flag) {
+        rc = cursor_put_nochecklen(&mc->mc_xcursor->mx_cursor, &dkey, &xdata,
+                                   xflags);
+        if (unlikely(rc))
+          goto bad_sub;
+        /* we've done our job */
+        dkey.iov_len = 0;
+      }
+      if (!(node_flags(node) & F_SUBDATA) || sub_root) {
+        /* Adjust other cursors pointing to mp */
+        MDBX_cursor *m2;
+        MDBX_xcursor *mx = mc->mc_xcursor;
+        size_t i = mc->mc_top;
+        MDBX_page *mp = mc->mc_pg[i];
+        const intptr_t nkeys = page_numkeys(mp);
 
-      /* restore cursor after mdbx_page_search_lowest() */
-      csrc->mc_snum = (uint8_t)snum;
-      csrc->mc_top = (uint8_t)snum - 1;
-      csrc->mc_ki[csrc->mc_top] = 0;
-
-      /* paranoia */
-      cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
-      cASSERT(csrc, IS_BRANCH(psrc));
-      if (unlikely(!IS_BRANCH(psrc)))
-        goto bailout;
+        for (m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2; m2 = m2->mc_next) {
+          if (m2 == mc || m2->mc_snum < mc->mc_snum)
+            continue;
+          if (!(m2->mc_flags & C_INITIALIZED))
+            continue;
+          if (m2->mc_pg[i] == mp) {
+            if (m2->mc_ki[i] == mc->mc_ki[i]) {
+              err = cursor_xinit2(m2, mx, dupdata_flag);
+              if (unlikely(err != MDBX_SUCCESS))
+                return err;
+            } else if (!insert_key && m2->mc_ki[i] < nkeys) {
+              XCURSOR_REFRESH(m2, mp, m2->mc_ki[i]);
+            }
+          }
+        }
+      }
+      cASSERT(mc, mc->mc_xcursor->mx_db.md_entries < PTRDIFF_MAX);
+      ecount = (size_t)mc->mc_xcursor->mx_db.md_entries;
+#define SHIFT_MDBX_APPENDDUP_TO_MDBX_APPEND 1
+      STATIC_ASSERT((MDBX_APPENDDUP >> SHIFT_MDBX_APPENDDUP_TO_MDBX_APPEND) ==
+                    MDBX_APPEND);
+      xflags |= (flags & MDBX_APPENDDUP) >> SHIFT_MDBX_APPENDDUP_TO_MDBX_APPEND;
+      rc = cursor_put_nochecklen(&mc->mc_xcursor->mx_cursor, data, &xdata,
+                                 xflags);
+      if (flags & F_SUBDATA) {
+        void *db = node_data(node);
+        mc->mc_xcursor->mx_db.md_mod_txnid = mc->mc_txn->mt_txnid;
+        memcpy(db, &mc->mc_xcursor->mx_db, sizeof(MDBX_db));
+      }
+      insert_data = (ecount != (size_t)mc->mc_xcursor->mx_db.md_entries);
     }
-
-    if (cdst->mc_ki[cdst->mc_top] == 0) {
-      const size_t snum = cdst->mc_snum;
-      cASSERT(csrc, snum > 0);
-      MDBX_cursor mn;
-      cursor_copy(cdst, &mn);
-      /* must find the lowest key below dst */
-      rc = page_search_lowest(&mn);
+    /* Increment count unless we just replaced an existing item. */
+    if (insert_data)
+      mc->mc_db->md_entries++;
+    if (insert_key) {
+      /* Invalidate txn if we created an empty sub-DB */
       if (unlikely(rc))
-        return rc;
-      MDBX_page *const lowest_page = mn.mc_pg[mn.mc_top];
-      cASSERT(cdst, IS_LEAF(lowest_page));
-      if (unlikely(!IS_LEAF(lowest_page)))
-        goto bailout;
-      MDBX_val key;
-      if (IS_LEAF2(lowest_page)) {
-        key.iov_len = mn.mc_db->md_xsize;
-        key.iov_base = page_leaf2key(lowest_page, 0, key.iov_len);
-      } else {
-        MDBX_node *lowest_node = page_node(lowest_page, 0);
-        key.iov_len = node_ks(lowest_node);
-        key.iov_base = node_key(lowest_node);
+        goto bad_sub;
+      /* If we succeeded and the key didn't exist before,
+       * make sure the cursor is marked valid. */
+      mc->mc_flags |= C_INITIALIZED;
+    }
+    if (unlikely(flags & MDBX_MULTIPLE)) {
+      if (likely(rc == MDBX_SUCCESS)) {
+      continue_multiple:
+        mcount++;
+        /* let caller know how many succeeded, if any */
+        data[1].iov_len = mcount;
+        if (mcount < dcount) {
+          data[0].iov_base = ptr_disp(data[0].iov_base, data[0].iov_len);
+          insert_key = insert_data = false;
+          goto more;
+        }
       }
-
-      /* restore cursor after mdbx_page_search_lowest() */
-      mn.mc_snum = (uint8_t)snum;
-      mn.mc_top = (uint8_t)snum - 1;
-      mn.mc_ki[mn.mc_top] = 0;
-
-      const intptr_t delta =
-          EVEN(key.iov_len) - EVEN(node_ks(page_node(mn.mc_pg[mn.mc_top], 0)));
-      const intptr_t needed =
-          branch_size(cdst->mc_txn->mt_env, &key4move) + delta;
-      const intptr_t have = page_room(pdst);
-      if (unlikely(needed > have))
-        return MDBX_RESULT_TRUE;
-
-      if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
-        return rc;
-      psrc = csrc->mc_pg[csrc->mc_top];
-      pdst = cdst->mc_pg[cdst->mc_top];
-
-      WITH_CURSOR_TRACKING(mn, rc = update_key(&mn, &key));
-      if (unlikely(rc))
-        return rc;
-    } else {
-      const size_t needed = branch_size(cdst->mc_txn->mt_env, &key4move);
-      const size_t have = page_room(pdst);
-      if (unlikely(needed > have))
-        return MDBX_RESULT_TRUE;
-
-      if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
-        return rc;
-      psrc = csrc->mc_pg[csrc->mc_top];
-      pdst = cdst->mc_pg[cdst->mc_top];
     }
+    if (rc == MDBX_SUCCESS && AUDIT_ENABLED())
+      rc = cursor_check(mc);
+    return rc;
+  bad_sub:
+    if (unlikely(rc == MDBX_KEYEXIST)) {
+      /* should not happen, we deleted that item */
+      ERROR("Unexpected %i error while put to nested dupsort's hive", rc);
+      rc = MDBX_PROBLEM;
+    }
+  }
+  mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+  return rc;
+}
 
-    DEBUG("moving %s-node %u [%s] on page %" PRIaPGNO
-          " to node %u on page %" PRIaPGNO,
-          "branch", csrc->mc_ki[csrc->mc_top], DKEY_DEBUG(&key4move),
-          psrc->mp_pgno, cdst->mc_ki[cdst->mc_top], pdst->mp_pgno);
-    /* Add the node to the destination page. */
-    rc = node_add_branch(cdst, cdst->mc_ki[cdst->mc_top], &key4move, srcpg);
-  } break;
-
-  case P_LEAF: {
-    /* Mark src and dst as dirty. */
-    if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
-      return rc;
-    psrc = csrc->mc_pg[csrc->mc_top];
-    pdst = cdst->mc_pg[cdst->mc_top];
-    const MDBX_node *srcnode = page_node(psrc, csrc->mc_ki[csrc->mc_top]);
-    MDBX_val data;
-    data.iov_len = node_ds(srcnode);
-    data.iov_base = node_data(srcnode);
-    key4move.iov_len = node_ks(srcnode);
-    key4move.iov_base = node_key(srcnode);
-    DEBUG("moving %s-node %u [%s] on page %" PRIaPGNO
-          " to node %u on page %" PRIaPGNO,
-          "leaf", csrc->mc_ki[csrc->mc_top], DKEY_DEBUG(&key4move),
-          psrc->mp_pgno, cdst->mc_ki[cdst->mc_top], pdst->mp_pgno);
-    /* Add the node to the destination page. */
-    rc = node_add_leaf(cdst, cdst->mc_ki[cdst->mc_top], &key4move, &data,
-                       node_flags(srcnode));
-  } break;
-
-  case P_LEAF | P_LEAF2: {
-    /* Mark src and dst as dirty. */
-    if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
-      return rc;
-    psrc = csrc->mc_pg[csrc->mc_top];
-    pdst = cdst->mc_pg[cdst->mc_top];
-    key4move.iov_len = csrc->mc_db->md_xsize;
-    key4move.iov_base =
-        page_leaf2key(psrc, csrc->mc_ki[csrc->mc_top], key4move.iov_len);
-    DEBUG("moving %s-node %u [%s] on page %" PRIaPGNO
-          " to node %u on page %" PRIaPGNO,
-          "leaf2", csrc->mc_ki[csrc->mc_top], DKEY_DEBUG(&key4move),
-          psrc->mp_pgno, cdst->mc_ki[cdst->mc_top], pdst->mp_pgno);
-    /* Add the node to the destination page. */
-    rc = node_add_leaf2(cdst, cdst->mc_ki[cdst->mc_top], &key4move);
-  } break;
-
-  default:
-    assert(false);
-    goto bailout;
+static __hot int cursor_put_checklen(MDBX_cursor *mc, const MDBX_val *key,
+                                     MDBX_val *data, unsigned flags) {
+  cASSERT(mc, (mc->mc_flags & C_SUB) == 0);
+  uint64_t aligned_keybytes, aligned_databytes;
+  MDBX_val aligned_key, aligned_data;
+  if (unlikely(key->iov_len < mc->mc_dbx->md_klen_min ||
+               key->iov_len > mc->mc_dbx->md_klen_max)) {
+    cASSERT(mc, !"Invalid key-size");
+    return MDBX_BAD_VALSIZE;
+  }
+  if (unlikely(data->iov_len < mc->mc_dbx->md_vlen_min ||
+               data->iov_len > mc->mc_dbx->md_vlen_max)) {
+    cASSERT(mc, !"Invalid data-size");
+    return MDBX_BAD_VALSIZE;
   }
 
-  if (unlikely(rc != MDBX_SUCCESS))
-    return rc;
-
-  /* Delete the node from the source page. */
-  node_del(csrc, key4move.iov_len);
-
-  cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
-  cASSERT(cdst, pdst == cdst->mc_pg[cdst->mc_top]);
-  cASSERT(csrc, PAGETYPE_WHOLE(psrc) == PAGETYPE_WHOLE(pdst));
-
-  {
-    /* Adjust other cursors pointing to mp */
-    MDBX_cursor *m2, *m3;
-    const MDBX_dbi dbi = csrc->mc_dbi;
-    cASSERT(csrc, csrc->mc_top == cdst->mc_top);
-    if (fromleft) {
-      /* If we're adding on the left, bump others up */
-      for (m2 = csrc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
-        m3 = (csrc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-        if (!(m3->mc_flags & C_INITIALIZED) || m3->mc_top < csrc->mc_top)
-          continue;
-        if (m3 != cdst && m3->mc_pg[csrc->mc_top] == pdst &&
-            m3->mc_ki[csrc->mc_top] >= cdst->mc_ki[csrc->mc_top]) {
-          m3->mc_ki[csrc->mc_top]++;
-        }
-        if (m3 != csrc && m3->mc_pg[csrc->mc_top] == psrc &&
-            m3->mc_ki[csrc->mc_top] == csrc->mc_ki[csrc->mc_top]) {
-          m3->mc_pg[csrc->mc_top] = pdst;
-          m3->mc_ki[csrc->mc_top] = cdst->mc_ki[cdst->mc_top];
-          cASSERT(csrc, csrc->mc_top > 0);
-          m3->mc_ki[csrc->mc_top - 1]++;
-        }
-        if (XCURSOR_INITED(m3) && IS_LEAF(psrc))
-          XCURSOR_REFRESH(m3, m3->mc_pg[csrc->mc_top], m3->mc_ki[csrc->mc_top]);
+  if (mc->mc_db->md_flags & MDBX_INTEGERKEY) {
+    switch (key->iov_len) {
+    default:
+      cASSERT(mc, !"key-size is invalid for MDBX_INTEGERKEY");
+      return MDBX_BAD_VALSIZE;
+    case 4:
+      if (unlikely(3 & (uintptr_t)key->iov_base)) {
+        /* copy instead of return error to avoid break compatibility */
+        aligned_key.iov_base =
+            memcpy(&aligned_keybytes, key->iov_base, aligned_key.iov_len = 4);
+        key = &aligned_key;
       }
-    } else {
-      /* Adding on the right, bump others down */
-      for (m2 = csrc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
-        m3 = (csrc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-        if (m3 == csrc)
-          continue;
-        if (!(m3->mc_flags & C_INITIALIZED) || m3->mc_top < csrc->mc_top)
-          continue;
-        if (m3->mc_pg[csrc->mc_top] == psrc) {
-          if (!m3->mc_ki[csrc->mc_top]) {
-            m3->mc_pg[csrc->mc_top] = pdst;
-            m3->mc_ki[csrc->mc_top] = cdst->mc_ki[cdst->mc_top];
-            cASSERT(csrc, csrc->mc_top > 0);
-            m3->mc_ki[csrc->mc_top - 1]--;
-          } else {
-            m3->mc_ki[csrc->mc_top]--;
-          }
-          if (XCURSOR_INITED(m3) && IS_LEAF(psrc))
-            XCURSOR_REFRESH(m3, m3->mc_pg[csrc->mc_top],
-                            m3->mc_ki[csrc->mc_top]);
-        }
+      break;
+    case 8:
+      if (unlikely(7 & (uintptr_t)key->iov_base)) {
+        /* copy instead of return error to avoid break compatibility */
+        aligned_key.iov_base =
+            memcpy(&aligned_keybytes, key->iov_base, aligned_key.iov_len = 8);
+        key = &aligned_key;
       }
+      break;
     }
   }
-
-  /* Update the parent separators. */
-  if (csrc->mc_ki[csrc->mc_top] == 0) {
-    cASSERT(csrc, csrc->mc_top > 0);
-    if (csrc->mc_ki[csrc->mc_top - 1] != 0) {
-      MDBX_val key;
-      if (IS_LEAF2(psrc)) {
-        key.iov_len = psrc->mp_leaf2_ksize;
-        key.iov_base = page_leaf2key(psrc, 0, key.iov_len);
-      } else {
-        MDBX_node *srcnode = page_node(psrc, 0);
-        key.iov_len = node_ks(srcnode);
-        key.iov_base = node_key(srcnode);
+  if (mc->mc_db->md_flags & MDBX_INTEGERDUP) {
+    switch (data->iov_len) {
+    default:
+      cASSERT(mc, !"data-size is invalid for MDBX_INTEGERKEY");
+      return MDBX_BAD_VALSIZE;
+    case 4:
+      if (unlikely(3 & (uintptr_t)data->iov_base)) {
+        if (unlikely(flags & MDBX_MULTIPLE))
+          return MDBX_BAD_VALSIZE;
+        /* copy instead of return error to avoid break compatibility */
+        aligned_data.iov_base = memcpy(&aligned_databytes, data->iov_base,
+                                       aligned_data.iov_len = 4);
+        data = &aligned_data;
       }
-      DEBUG("update separator for source page %" PRIaPGNO " to [%s]",
-            psrc->mp_pgno, DKEY_DEBUG(&key));
-      MDBX_cursor mn;
-      cursor_copy(csrc, &mn);
-      cASSERT(csrc, mn.mc_snum > 0);
-      mn.mc_snum--;
-      mn.mc_top--;
-      /* We want rebalance to find mn when doing fixups */
-      WITH_CURSOR_TRACKING(mn, rc = update_key(&mn, &key));
-      if (unlikely(rc != MDBX_SUCCESS))
-        return rc;
-    }
-    if (IS_BRANCH(psrc)) {
-      const MDBX_val nullkey = {0, 0};
-      const indx_t ix = csrc->mc_ki[csrc->mc_top];
-      csrc->mc_ki[csrc->mc_top] = 0;
-      rc = update_key(csrc, &nullkey);
-      csrc->mc_ki[csrc->mc_top] = ix;
-      cASSERT(csrc, rc == MDBX_SUCCESS);
-    }
-  }
-
-  if (cdst->mc_ki[cdst->mc_top] == 0) {
-    cASSERT(cdst, cdst->mc_top > 0);
-    if (cdst->mc_ki[cdst->mc_top - 1] != 0) {
-      MDBX_val key;
-      if (IS_LEAF2(pdst)) {
-        key.iov_len = pdst->mp_leaf2_ksize;
-        key.iov_base = page_leaf2key(pdst, 0, key.iov_len);
-      } else {
-        MDBX_node *srcnode = page_node(pdst, 0);
-        key.iov_len = node_ks(srcnode);
-        key.iov_base = node_key(srcnode);
+      break;
+    case 8:
+      if (unlikely(7 & (uintptr_t)data->iov_base)) {
+        if (unlikely(flags & MDBX_MULTIPLE))
+          return MDBX_BAD_VALSIZE;
+        /* copy instead of return error to avoid break compatibility */
+        aligned_data.iov_base = memcpy(&aligned_databytes, data->iov_base,
+                                       aligned_data.iov_len = 8);
+        data = &aligned_data;
       }
-      DEBUG("update separator for destination page %" PRIaPGNO " to [%s]",
-            pdst->mp_pgno, DKEY_DEBUG(&key));
-      MDBX_cursor mn;
-      cursor_copy(cdst, &mn);
-      cASSERT(cdst, mn.mc_snum > 0);
-      mn.mc_snum--;
-      mn.mc_top--;
-      /* We want rebalance to find mn when doing fixups */
-      WITH_CURSOR_TRACKING(mn, rc = update_key(&mn, &key));
-      if (unlikely(rc != MDBX_SUCCESS))
-        return rc;
-    }
-    if (IS_BRANCH(pdst)) {
-      const MDBX_val nullkey = {0, 0};
-      const indx_t ix = cdst->mc_ki[cdst->mc_top];
-      cdst->mc_ki[cdst->mc_top] = 0;
-      rc = update_key(cdst, &nullkey);
-      cdst->mc_ki[cdst->mc_top] = ix;
-      cASSERT(cdst, rc == MDBX_SUCCESS);
+      break;
     }
   }
 
-  return MDBX_SUCCESS;
-}
-
-/* Merge one page into another.
- *
- * The nodes from the page pointed to by csrc will be copied to the page
- * pointed to by cdst and then the csrc page will be freed.
- *
- * [in] csrc Cursor pointing to the source page.
- * [in] cdst Cursor pointing to the destination page.
- *
- * Returns 0 on success, non-zero on failure. */
-static int page_merge(MDBX_cursor *csrc, MDBX_cursor *cdst) {
-  MDBX_val key;
   int rc;
+  MDBX_val packed;
+  uint8_t ref[VLOG_REF_SIZE];
+  if (unlikely(mc->mc_dbx->md_vlog_threshold) &&
+      data->iov_len >= mc->mc_dbx->md_vlog_threshold &&
+      !(flags & (MDBX_RESERVE | MDBX_MULTIPLE | F_SUBDATA | F_BIGDATA)) &&
+      !(mc->mc_txn->mt_flags & MDBX_TXN_DISJOINT)) {
+    rc = vlog_append(mc, key, data, ref);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    packed.iov_base = ref;
+    packed.iov_len = sizeof(ref);
+    rc = cursor_put_nochecklen(mc, key, &packed, flags | F_COMPRESSED);
+    if (rc == MDBX_KEYEXIST)
+      *data = packed;
+  } else if (unlikely(mc->mc_dbx->md_codec) &&
+             data->iov_len >= mc->mc_dbx->md_codec_threshold &&
+             !(flags &
+               (MDBX_RESERVE | MDBX_MULTIPLE | F_SUBDATA | F_BIGDATA)) &&
+             (rc = codec_encode(mc->mc_txn, mc->mc_dbx->md_codec, data,
+                                &packed)) != MDBX_RESULT_TRUE) {
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    rc = cursor_put_nochecklen(mc, key, &packed, flags | F_COMPRESSED);
+    if (rc == MDBX_KEYEXIST)
+      *data = packed;
+  } else
+    rc = cursor_put_nochecklen(mc, key, data, flags);
 
-  cASSERT(csrc, csrc != cdst);
-  cASSERT(csrc, cursor_is_tracked(csrc));
-  cASSERT(cdst, cursor_is_tracked(cdst));
-  const MDBX_page *const psrc = csrc->mc_pg[csrc->mc_top];
-  MDBX_page *pdst = cdst->mc_pg[cdst->mc_top];
-  DEBUG("merging page %" PRIaPGNO " into %" PRIaPGNO, psrc->mp_pgno,
-        pdst->mp_pgno);
+  if (unlikely(rc == MDBX_KEYEXIST)) {
+    /* возвращается имеющееся значение, которое может быть сжатым */
+    const int err = cursor_unpack(mc, data);
+    if (unlikely(err != MDBX_SUCCESS))
+      rc = err;
+  }
+  return rc;
+}
 
-  cASSERT(csrc, PAGETYPE_WHOLE(psrc) == PAGETYPE_WHOLE(pdst));
-  cASSERT(csrc, csrc->mc_dbi == cdst->mc_dbi && csrc->mc_db == cdst->mc_db);
-  cASSERT(csrc, csrc->mc_snum > 1); /* can't merge root page */
-  cASSERT(cdst, cdst->mc_snum > 1);
-  cASSERT(cdst, cdst->mc_snum < cdst->mc_db->md_depth ||
-                    IS_LEAF(cdst->mc_pg[cdst->mc_db->md_depth - 1]));
-  cASSERT(csrc, csrc->mc_snum < csrc->mc_db->md_depth ||
-                    IS_LEAF(csrc->mc_pg[csrc->mc_db->md_depth - 1]));
-  cASSERT(cdst, page_room(pdst) >= page_used(cdst->mc_txn->mt_env, psrc));
-  const int pagetype = PAGETYPE_WHOLE(psrc);
+int mdbx_cursor_put(MDBX_cursor *mc, const MDBX_val *key, MDBX_val *data,
+                    unsigned flags) {
+  if (unlikely(mc == NULL || key == NULL || data == NULL))
+    return MDBX_EINVAL;
 
-  /* Move all nodes from src to dst */
-  const size_t dst_nkeys = page_numkeys(pdst);
-  const size_t src_nkeys = page_numkeys(psrc);
-  cASSERT(cdst, dst_nkeys + src_nkeys >= (IS_LEAF(psrc) ? 1u : 2u));
-  if (likely(src_nkeys)) {
-    size_t j = dst_nkeys;
-    if (unlikely(pagetype & P_LEAF2)) {
-      /* Mark dst as dirty. */
-      if (unlikely(rc = page_touch(cdst)))
-        return rc;
-
-      key.iov_len = csrc->mc_db->md_xsize;
-      key.iov_base = page_data(psrc);
-      size_t i = 0;
-      do {
-        rc = node_add_leaf2(cdst, j++, &key);
-        if (unlikely(rc != MDBX_SUCCESS))
-          return rc;
-        key.iov_base = ptr_disp(key.iov_base, key.iov_len);
-      } while (++i != src_nkeys);
-    } else {
-      MDBX_node *srcnode = page_node(psrc, 0);
-      key.iov_len = node_ks(srcnode);
-      key.iov_base = node_key(srcnode);
-      if (pagetype & P_BRANCH) {
-        MDBX_cursor mn;
-        cursor_copy(csrc, &mn);
-        /* must find the lowest key below src */
-        rc = page_search_lowest(&mn);
-        if (unlikely(rc))
-          return rc;
-
-        const MDBX_page *mp = mn.mc_pg[mn.mc_top];
-        if (likely(!IS_LEAF2(mp))) {
-          cASSERT(&mn, IS_LEAF(mp));
-          const MDBX_node *lowest = page_node(mp, 0);
-          key.iov_len = node_ks(lowest);
-          key.iov_base = node_key(lowest);
-        } else {
-          cASSERT(&mn, mn.mc_top > csrc->mc_top);
-          key.iov_len = mp->mp_leaf2_ksize;
-          key.iov_base = page_leaf2key(mp, mn.mc_ki[mn.mc_top], key.iov_len);
-        }
-        cASSERT(&mn, key.iov_len >= csrc->mc_dbx->md_klen_min);
-        cASSERT(&mn, key.iov_len <= csrc->mc_dbx->md_klen_max);
+  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
+    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
+                                                     : MDBX_EBADSIGN;
 
-        const size_t dst_room = page_room(pdst);
-        const size_t src_used = page_used(cdst->mc_txn->mt_env, psrc);
-        const size_t space_needed = src_used - node_ks(srcnode) + key.iov_len;
-        if (unlikely(space_needed > dst_room))
-          return MDBX_RESULT_TRUE;
-      }
+  int rc = check_txn_rw(mc->mc_txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-      /* Mark dst as dirty. */
-      if (unlikely(rc = page_touch(cdst)))
-        return rc;
+  if (unlikely(dbi_changed(mc->mc_txn, mc->mc_dbi)))
+    return MDBX_BAD_DBI;
 
-      size_t i = 0;
-      while (true) {
-        if (pagetype & P_LEAF) {
-          MDBX_val data;
-          data.iov_len = node_ds(srcnode);
-          data.iov_base = node_data(srcnode);
-          rc = node_add_leaf(cdst, j++, &key, &data, node_flags(srcnode));
-        } else {
-          cASSERT(csrc, node_flags(srcnode) == 0);
-          rc = node_add_branch(cdst, j++, &key, node_pgno(srcnode));
-        }
-        if (unlikely(rc != MDBX_SUCCESS))
-          return rc;
+  cASSERT(mc, cursor_is_tracked(mc));
 
-        if (++i == src_nkeys)
-          break;
-        srcnode = page_node(psrc, i);
-        key.iov_len = node_ks(srcnode);
-        key.iov_base = node_key(srcnode);
-      }
+  /* Check this first so counter will always be zero on any early failures. */
+  if (unlikely(flags & MDBX_MULTIPLE)) {
+    if (unlikely(flags & MDBX_RESERVE))
+      return MDBX_EINVAL;
+    if (unlikely(!(mc->mc_db->md_flags & MDBX_DUPFIXED)))
+      return MDBX_INCOMPATIBLE;
+    const size_t dcount = data[1].iov_len;
+    if (unlikely(dcount < 2 || data->iov_len == 0))
+      return MDBX_BAD_VALSIZE;
+    if (unlikely(mc->mc_db->md_xsize != data->iov_len) && mc->mc_db->md_xsize)
+      return MDBX_BAD_VALSIZE;
+    if (unlikely(dcount > MAX_MAPSIZE / 2 /
+                              (BRANCH_NODE_MAX(MAX_PAGESIZE) - NODESIZE))) {
+      /* checking for multiplication overflow */
+      if (unlikely(dcount > MAX_MAPSIZE / 2 / data->iov_len))
+        return MDBX_TOO_LARGE;
     }
-
-    pdst = cdst->mc_pg[cdst->mc_top];
-    DEBUG("dst page %" PRIaPGNO " now has %zu keys (%.1f%% filled)",
-          pdst->mp_pgno, page_numkeys(pdst),
-          page_fill(cdst->mc_txn->mt_env, pdst));
-
-    cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
-    cASSERT(cdst, pdst == cdst->mc_pg[cdst->mc_top]);
   }
 
-  /* Unlink the src page from parent and add to free list. */
-  csrc->mc_top--;
-  node_del(csrc, 0);
-  if (csrc->mc_ki[csrc->mc_top] == 0) {
-    const MDBX_val nullkey = {0, 0};
-    rc = update_key(csrc, &nullkey);
-    if (unlikely(rc)) {
-      csrc->mc_top++;
-      return rc;
-    }
+  if (flags & MDBX_RESERVE) {
+    if (unlikely(mc->mc_db->md_flags & (MDBX_DUPSORT | MDBX_REVERSEDUP |
+                                        MDBX_INTEGERDUP | MDBX_DUPFIXED)))
+      return MDBX_INCOMPATIBLE;
+    data->iov_base = nullptr;
   }
-  csrc->mc_top++;
-
-  cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
-  cASSERT(cdst, pdst == cdst->mc_pg[cdst->mc_top]);
 
-  {
-    /* Adjust other cursors pointing to mp */
-    MDBX_cursor *m2, *m3;
-    const MDBX_dbi dbi = csrc->mc_dbi;
-    const size_t top = csrc->mc_top;
+  if (unlikely(mc->mc_txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_BLOCKED)))
+    return (mc->mc_txn->mt_flags & MDBX_TXN_RDONLY) ? MDBX_EACCESS
+                                                    : MDBX_BAD_TXN;
 
-    for (m2 = csrc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
-      m3 = (csrc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-      if (m3 == csrc || top >= m3->mc_snum)
-        continue;
-      if (m3->mc_pg[top] == psrc) {
-        m3->mc_pg[top] = pdst;
-        cASSERT(m3, dst_nkeys + m3->mc_ki[top] <= UINT16_MAX);
-        m3->mc_ki[top] += (indx_t)dst_nkeys;
-        m3->mc_ki[top - 1] = cdst->mc_ki[top - 1];
-      } else if (m3->mc_pg[top - 1] == csrc->mc_pg[top - 1] &&
-                 m3->mc_ki[top - 1] > csrc->mc_ki[top - 1]) {
-        m3->mc_ki[top - 1]--;
-      }
-      if (XCURSOR_INITED(m3) && IS_LEAF(psrc))
-        XCURSOR_REFRESH(m3, m3->mc_pg[top], m3->mc_ki[top]);
-    }
-  }
+  /* F_BIGDATA is internal and should never come from the user */
+  if (unlikely(flags & F_BIGDATA))
+    return MDBX_EINVAL;
 
-  rc = page_retire(csrc, (MDBX_page *)psrc);
-  if (unlikely(rc))
-    return rc;
+  return cursor_put_checklen(mc, key, data, flags);
+}
 
-  cASSERT(cdst, cdst->mc_db->md_entries > 0);
-  cASSERT(cdst, cdst->mc_snum <= cdst->mc_db->md_depth);
-  cASSERT(cdst, cdst->mc_top > 0);
-  cASSERT(cdst, cdst->mc_snum == cdst->mc_top + 1);
-  MDBX_page *const top_page = cdst->mc_pg[cdst->mc_top];
-  const indx_t top_indx = cdst->mc_ki[cdst->mc_top];
-  const unsigned save_snum = cdst->mc_snum;
-  const uint16_t save_depth = cdst->mc_db->md_depth;
-  cursor_pop(cdst);
-  rc = rebalance(cdst);
-  if (unlikely(rc))
-    return rc;
+int mdbx_cursor_del(MDBX_cursor *mc, MDBX_put_flags_t flags) {
+  if (unlikely(!mc))
+    return MDBX_EINVAL;
 
-  cASSERT(cdst, cdst->mc_db->md_entries > 0);
-  cASSERT(cdst, cdst->mc_snum <= cdst->mc_db->md_depth);
-  cASSERT(cdst, cdst->mc_snum == cdst->mc_top + 1);
+  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
+    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
+                                                     : MDBX_EBADSIGN;
 
-#if MDBX_ENABLE_PGOP_STAT
-  cdst->mc_txn->mt_env->me_lck->mti_pgop_stat.merge.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
+  int rc = check_txn_rw(mc->mc_txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  if (IS_LEAF(cdst->mc_pg[cdst->mc_top])) {
-    /* LY: don't touch cursor if top-page is a LEAF */
-    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
-                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
-    return MDBX_SUCCESS;
-  }
+  if (unlikely(dbi_changed(mc->mc_txn, mc->mc_dbi)))
+    return MDBX_BAD_DBI;
 
-  cASSERT(cdst, page_numkeys(top_page) == dst_nkeys + src_nkeys);
+  if (unlikely(!(mc->mc_flags & C_INITIALIZED)))
+    return MDBX_ENODATA;
 
-  if (unlikely(pagetype != PAGETYPE_WHOLE(top_page))) {
-    /* LY: LEAF-page becomes BRANCH, unable restore cursor's stack */
-    goto bailout;
-  }
+  if (unlikely(mc->mc_ki[mc->mc_top] >= page_numkeys(mc->mc_pg[mc->mc_top])))
+    return MDBX_NOTFOUND;
 
-  if (top_page == cdst->mc_pg[cdst->mc_top]) {
-    /* LY: don't touch cursor if prev top-page already on the top */
-    cASSERT(cdst, cdst->mc_ki[cdst->mc_top] == top_indx);
-    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
-                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
-    return MDBX_SUCCESS;
-  }
+  return cursor_del(mc, flags);
+}
 
-  const int new_snum = save_snum - save_depth + cdst->mc_db->md_depth;
-  if (unlikely(new_snum < 1 || new_snum > cdst->mc_db->md_depth)) {
-    /* LY: out of range, unable restore cursor's stack */
-    goto bailout;
-  }
+static __hot int cursor_del(MDBX_cursor *mc, MDBX_put_flags_t flags) {
+  cASSERT(mc, mc->mc_flags & C_INITIALIZED);
+  cASSERT(mc, mc->mc_ki[mc->mc_top] < page_numkeys(mc->mc_pg[mc->mc_top]));
 
-  if (top_page == cdst->mc_pg[new_snum - 1]) {
-    cASSERT(cdst, cdst->mc_ki[new_snum - 1] == top_indx);
-    /* LY: restore cursor stack */
-    cdst->mc_snum = (uint8_t)new_snum;
-    cdst->mc_top = (uint8_t)new_snum - 1;
-    cASSERT(cdst, cdst->mc_snum < cdst->mc_db->md_depth ||
-                      IS_LEAF(cdst->mc_pg[cdst->mc_db->md_depth - 1]));
-    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
-                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
-    return MDBX_SUCCESS;
-  }
+  int rc = cursor_touch(mc, nullptr, nullptr);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  MDBX_page *const stub_page = (MDBX_page *)(~(uintptr_t)top_page);
-  const indx_t stub_indx = top_indx;
-  if (save_depth > cdst->mc_db->md_depth &&
-      ((cdst->mc_pg[save_snum - 1] == top_page &&
-        cdst->mc_ki[save_snum - 1] == top_indx) ||
-       (cdst->mc_pg[save_snum - 1] == stub_page &&
-        cdst->mc_ki[save_snum - 1] == stub_indx))) {
-    /* LY: restore cursor stack */
-    cdst->mc_pg[new_snum - 1] = top_page;
-    cdst->mc_ki[new_snum - 1] = top_indx;
-    cdst->mc_pg[new_snum] = (MDBX_page *)(~(uintptr_t)cdst->mc_pg[new_snum]);
-    cdst->mc_ki[new_snum] = ~cdst->mc_ki[new_snum];
-    cdst->mc_snum = (uint8_t)new_snum;
-    cdst->mc_top = (uint8_t)new_snum - 1;
-    cASSERT(cdst, cdst->mc_snum < cdst->mc_db->md_depth ||
-                      IS_LEAF(cdst->mc_pg[cdst->mc_db->md_depth - 1]));
-    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
-                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
-    return MDBX_SUCCESS;
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  if (!MDBX_DISABLE_VALIDATION && unlikely(!CHECK_LEAF_TYPE(mc, mp))) {
+    ERROR("unexpected leaf-page #%" PRIaPGNO " type 0x%x seen by cursor",
+          mp->mp_pgno, mp->mp_flags);
+    return MDBX_CORRUPTED;
   }
+  if (IS_LEAF2(mp))
+    goto del_key;
 
-bailout:
-  /* LY: unable restore cursor's stack */
-  cdst->mc_flags &= ~C_INITIALIZED;
-  return MDBX_CURSOR_FULL;
-}
-
-static void cursor_restore(const MDBX_cursor *csrc, MDBX_cursor *cdst) {
-  cASSERT(cdst, cdst->mc_dbi == csrc->mc_dbi);
-  cASSERT(cdst, cdst->mc_txn == csrc->mc_txn);
-  cASSERT(cdst, cdst->mc_db == csrc->mc_db);
-  cASSERT(cdst, cdst->mc_dbx == csrc->mc_dbx);
-  cASSERT(cdst, cdst->mc_dbistate == csrc->mc_dbistate);
-  cdst->mc_snum = csrc->mc_snum;
-  cdst->mc_top = csrc->mc_top;
-  cdst->mc_flags = csrc->mc_flags;
-  cdst->mc_checking = csrc->mc_checking;
+  MDBX_node *node = page_node(mp, mc->mc_ki[mc->mc_top]);
+  if (node_flags(node) & F_DUPDATA) {
+    if (flags & (MDBX_ALLDUPS | /* for compatibility */ MDBX_NODUPDATA)) {
+      /* will subtract the final entry later */
+      mc->mc_db->md_entries -= mc->mc_xcursor->mx_db.md_entries - 1;
+      mc->mc_xcursor->mx_cursor.mc_flags &= ~C_INITIALIZED;
+    } else {
+      if (!(node_flags(node) & F_SUBDATA))
+        mc->mc_xcursor->mx_cursor.mc_pg[0] = node_data(node);
+      rc = cursor_del(&mc->mc_xcursor->mx_cursor, 0);
+      if (unlikely(rc))
+        return rc;
+      /* If sub-DB still has entries, we're done */
+      if (mc->mc_xcursor->mx_db.md_entries) {
+        if (node_flags(node) & F_SUBDATA) {
+          /* update subDB info */
+          mc->mc_xcursor->mx_db.md_mod_txnid = mc->mc_txn->mt_txnid;
+          memcpy(node_data(node), &mc->mc_xcursor->mx_db, sizeof(MDBX_db));
+        } else {
+          /* shrink fake page */
+          node_shrink(mp, mc->mc_ki[mc->mc_top]);
+          node = page_node(mp, mc->mc_ki[mc->mc_top]);
+          mc->mc_xcursor->mx_cursor.mc_pg[0] = node_data(node);
+          /* fix other sub-DB cursors pointed at fake pages on this page */
+          for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
+               m2 = m2->mc_next) {
+            if (m2 == mc || m2->mc_snum < mc->mc_snum)
+              continue;
+            if (!(m2->mc_flags & C_INITIALIZED))
+              continue;
+            if (m2->mc_pg[mc->mc_top] == mp) {
+              MDBX_node *inner = node;
+              if (m2->mc_ki[mc->mc_top] >= page_numkeys(mp))
+                continue;
+              if (m2->mc_ki[mc->mc_top] != mc->mc_ki[mc->mc_top]) {
+                inner = page_node(mp, m2->mc_ki[mc->mc_top]);
+                if (node_flags(inner) & F_SUBDATA)
+                  continue;
+              }
+              m2->mc_xcursor->mx_cursor.mc_pg[0] = node_data(inner);
+            }
+          }
+        }
+        mc->mc_db->md_entries--;
+        cASSERT(mc, mc->mc_db->md_entries > 0 && mc->mc_db->md_depth > 0 &&
+                        mc->mc_db->md_root != P_INVALID);
+        return rc;
+      } else {
+        mc->mc_xcursor->mx_cursor.mc_flags &= ~C_INITIALIZED;
+      }
+      /* otherwise fall thru and delete the sub-DB */
+    }
 
-  for (size_t i = 0; i < csrc->mc_snum; i++) {
-    cdst->mc_pg[i] = csrc->mc_pg[i];
-    cdst->mc_ki[i] = csrc->mc_ki[i];
+    if (node_flags(node) & F_SUBDATA) {
+      /* add all the child DB's pages to the free list */
+      rc = drop_tree(&mc->mc_xcursor->mx_cursor, false);
+      if (unlikely(rc))
+        goto fail;
+    }
   }
-}
+  /* MDBX passes F_SUBDATA in 'flags' to delete a DB record */
+  else if (unlikely((node_flags(node) ^ flags) & F_SUBDATA))
+    return MDBX_INCOMPATIBLE;
 
-/* Copy the contents of a cursor.
- * [in] csrc The cursor to copy from.
- * [out] cdst The cursor to copy to. */
-static void cursor_copy(const MDBX_cursor *csrc, MDBX_cursor *cdst) {
-  cASSERT(csrc, csrc->mc_txn->mt_txnid >=
-                    csrc->mc_txn->mt_env->me_lck->mti_oldest_reader.weak);
-  cdst->mc_dbi = csrc->mc_dbi;
-  cdst->mc_next = NULL;
-  cdst->mc_backup = NULL;
-  cdst->mc_xcursor = NULL;
-  cdst->mc_txn = csrc->mc_txn;
-  cdst->mc_db = csrc->mc_db;
-  cdst->mc_dbx = csrc->mc_dbx;
-  cdst->mc_dbistate = csrc->mc_dbistate;
-  cursor_restore(csrc, cdst);
-}
+  if (unlikely(node_flags(node) & F_COMPRESSED))
+    vlog_release(mc, node);
 
-/* Rebalance the tree after a delete operation.
- * [in] mc Cursor pointing to the page where rebalancing should begin.
- * Returns 0 on success, non-zero on failure. */
-static int rebalance(MDBX_cursor *mc) {
-  cASSERT(mc, cursor_is_tracked(mc));
-  cASSERT(mc, mc->mc_snum > 0);
-  cASSERT(mc, mc->mc_snum < mc->mc_db->md_depth ||
-                  IS_LEAF(mc->mc_pg[mc->mc_db->md_depth - 1]));
-  const int pagetype = PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]);
+  /* add large/overflow pages to free list */
+  if (node_flags(node) & F_BIGDATA) {
+    pgr_t lp = page_get_large(mc, node_largedata_pgno(node), mp->mp_txnid);
+    if (unlikely((rc = lp.err) || (rc = page_retire(mc, lp.page))))
+      goto fail;
+  }
 
-  STATIC_ASSERT(P_BRANCH == 1);
-  const size_t minkeys = (pagetype & P_BRANCH) + (size_t)1;
+del_key:
+  mc->mc_db->md_entries--;
+  const MDBX_dbi dbi = mc->mc_dbi;
+  indx_t ki = mc->mc_ki[mc->mc_top];
+  mp = mc->mc_pg[mc->mc_top];
+  cASSERT(mc, IS_LEAF(mp));
+  node_del(mc, mp->mp_leaf2_ksize);
 
-  /* Pages emptier than this are candidates for merging. */
-  size_t room_threshold = likely(mc->mc_dbi != FREE_DBI)
-                              ? mc->mc_txn->mt_env->me_merge_threshold
-                              : mc->mc_txn->mt_env->me_merge_threshold_gc;
+  /* Adjust other cursors pointing to mp */
+  for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
+    MDBX_cursor *m3 = (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+    if (m3 == mc || !(m2->mc_flags & m3->mc_flags & C_INITIALIZED))
+      continue;
+    if (m3->mc_snum < mc->mc_snum)
+      continue;
+    if (m3->mc_pg[mc->mc_top] == mp) {
+      if (m3->mc_ki[mc->mc_top] == ki) {
+        m3->mc_flags |= C_DEL;
+        if (mc->mc_db->md_flags & MDBX_DUPSORT) {
+          /* Sub-cursor referred into dataset which is gone */
+          m3->mc_xcursor->mx_cursor.mc_flags &= ~(C_INITIALIZED | C_EOF);
+        }
+        continue;
+      } else if (m3->mc_ki[mc->mc_top] > ki) {
+        m3->mc_ki[mc->mc_top]--;
+      }
+      if (XCURSOR_INITED(m3))
+        XCURSOR_REFRESH(m3, m3->mc_pg[mc->mc_top], m3->mc_ki[mc->mc_top]);
+    }
+  }
 
-  const MDBX_page *const tp = mc->mc_pg[mc->mc_top];
-  const size_t numkeys = page_numkeys(tp);
-  const size_t room = page_room(tp);
-  DEBUG("rebalancing %s page %" PRIaPGNO
-        " (has %zu keys, full %.1f%%, used %zu, room %zu bytes )",
-        (pagetype & P_LEAF) ? "leaf" : "branch", tp->mp_pgno, numkeys,
-        page_fill(mc->mc_txn->mt_env, tp), page_used(mc->mc_txn->mt_env, tp),
-        room);
-  cASSERT(mc, IS_MODIFIABLE(mc->mc_txn, tp));
+  rc = rebalance(mc);
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto fail;
 
-  if (unlikely(numkeys < minkeys)) {
-    DEBUG("page %" PRIaPGNO " must be merged due keys < %zu threshold",
-          tp->mp_pgno, minkeys);
-  } else if (unlikely(room > room_threshold)) {
-    DEBUG("page %" PRIaPGNO " should be merged due room %zu > %zu threshold",
-          tp->mp_pgno, room, room_threshold);
-  } else {
-    DEBUG("no need to rebalance page %" PRIaPGNO ", room %zu < %zu threshold",
-          tp->mp_pgno, room, room_threshold);
-    cASSERT(mc, mc->mc_db->md_entries > 0);
+  if (unlikely(!mc->mc_snum)) {
+    /* DB is totally empty now, just bail out.
+     * Other cursors adjustments were already done
+     * by rebalance and aren't needed here. */
+    cASSERT(mc, mc->mc_db->md_entries == 0 && mc->mc_db->md_depth == 0 &&
+                    mc->mc_db->md_root == P_INVALID);
+    mc->mc_flags |= C_EOF;
     return MDBX_SUCCESS;
   }
 
-  int rc;
-  if (mc->mc_snum < 2) {
-    MDBX_page *const mp = mc->mc_pg[0];
-    const size_t nkeys = page_numkeys(mp);
-    cASSERT(mc, (mc->mc_db->md_entries == 0) == (nkeys == 0));
-    if (IS_SUBP(mp)) {
-      DEBUG("%s", "Can't rebalance a subpage, ignoring");
-      cASSERT(mc, pagetype & P_LEAF);
-      return MDBX_SUCCESS;
-    }
-    if (nkeys == 0) {
-      cASSERT(mc, IS_LEAF(mp));
-      DEBUG("%s", "tree is completely empty");
-      cASSERT(mc, (*mc->mc_dbistate & DBI_DIRTY) != 0);
-      mc->mc_db->md_root = P_INVALID;
-      mc->mc_db->md_depth = 0;
-      cASSERT(mc, mc->mc_db->md_branch_pages == 0 &&
-                      mc->mc_db->md_overflow_pages == 0 &&
-                      mc->mc_db->md_leaf_pages == 1);
-      /* Adjust cursors pointing to mp */
-      for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
-           m2 = m2->mc_next) {
-        MDBX_cursor *m3 =
-            (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-        if (m3 == mc || !(m3->mc_flags & C_INITIALIZED))
+  ki = mc->mc_ki[mc->mc_top];
+  mp = mc->mc_pg[mc->mc_top];
+  cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]));
+  size_t nkeys = page_numkeys(mp);
+  cASSERT(mc, (mc->mc_db->md_entries > 0 && nkeys > 0) ||
+                  ((mc->mc_flags & C_SUB) && mc->mc_db->md_entries == 0 &&
+                   nkeys == 0));
+
+  /* Adjust this and other cursors pointing to mp */
+  for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
+    MDBX_cursor *m3 = (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+    if (!(m2->mc_flags & m3->mc_flags & C_INITIALIZED))
+      continue;
+    if (m3->mc_snum < mc->mc_snum)
+      continue;
+    if (m3->mc_pg[mc->mc_top] == mp) {
+      /* if m3 points past last node in page, find next sibling */
+      if (m3->mc_ki[mc->mc_top] >= nkeys) {
+        rc = cursor_sibling(m3, SIBLING_RIGHT);
+        if (rc == MDBX_NOTFOUND) {
+          m3->mc_flags |= C_EOF;
+          rc = MDBX_SUCCESS;
           continue;
-        if (m3->mc_pg[0] == mp) {
-          m3->mc_snum = 0;
-          m3->mc_top = 0;
-          m3->mc_flags &= ~C_INITIALIZED;
+        }
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto fail;
+      }
+      if (m3->mc_ki[mc->mc_top] >= ki ||
+          /* moved to right sibling */ m3->mc_pg[mc->mc_top] != mp) {
+        if (m3->mc_xcursor && !(m3->mc_flags & C_EOF)) {
+          node = page_node(m3->mc_pg[m3->mc_top], m3->mc_ki[m3->mc_top]);
+          /* If this node has dupdata, it may need to be reinited
+           * because its data has moved.
+           * If the xcursor was not inited it must be reinited.
+           * Else if node points to a subDB, nothing is needed. */
+          if (node_flags(node) & F_DUPDATA) {
+            if (m3->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED) {
+              if (!(node_flags(node) & F_SUBDATA))
+                m3->mc_xcursor->mx_cursor.mc_pg[0] = node_data(node);
+            } else {
+              rc = cursor_xinit1(m3, node, m3->mc_pg[m3->mc_top]);
+              if (unlikely(rc != MDBX_SUCCESS))
+                goto fail;
+              rc = cursor_first(&m3->mc_xcursor->mx_cursor, NULL, NULL);
+              if (unlikely(rc != MDBX_SUCCESS))
+                goto fail;
+            }
+          }
+          m3->mc_xcursor->mx_cursor.mc_flags |= C_DEL;
+        }
+        m3->mc_flags |= C_DEL;
+      }
+    }
+  }
+
+  cASSERT(mc, rc == MDBX_SUCCESS);
+  if (AUDIT_ENABLED())
+    rc = cursor_check(mc);
+  return rc;
+
+fail:
+  mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+  return rc;
+}
+
+/* Allocate and initialize new pages for a database.
+ * Set MDBX_TXN_ERROR on failure. */
+static pgr_t page_new(MDBX_cursor *mc, const unsigned flags) {
+  cASSERT(mc, (flags & P_OVERFLOW) == 0);
+  pgr_t ret = page_alloc(mc);
+  if (unlikely(ret.err != MDBX_SUCCESS))
+    return ret;
+
+  DEBUG("db %u allocated new page %" PRIaPGNO, mc->mc_dbi, ret.page->mp_pgno);
+  ret.page->mp_flags = (uint16_t)flags;
+  cASSERT(mc, *mc->mc_dbistate & DBI_DIRTY);
+  cASSERT(mc, mc->mc_txn->mt_flags & MDBX_TXN_DIRTY);
+#if MDBX_ENABLE_PGOP_STAT
+  mc->mc_txn->mt_env->me_lck->mti_pgop_stat.newly.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+
+  STATIC_ASSERT(P_BRANCH == 1);
+  const unsigned is_branch = flags & P_BRANCH;
+
+  ret.page->mp_lower = 0;
+  ret.page->mp_upper = (indx_t)(mc->mc_txn->mt_env->me_psize - PAGEHDRSZ);
+  mc->mc_db->md_branch_pages += is_branch;
+  mc->mc_db->md_leaf_pages += 1 - is_branch;
+  if (unlikely(mc->mc_flags & C_SUB)) {
+    MDBX_db *outer = outer_db(mc);
+    outer->md_branch_pages += is_branch;
+    outer->md_leaf_pages += 1 - is_branch;
+  }
+  return ret;
+}
+
+static pgr_t page_new_large(MDBX_cursor *mc, const size_t npages) {
+  pgr_t ret = likely(npages == 1)
+                  ? page_alloc(mc)
+                  : page_alloc_slowpath(mc, npages, MDBX_ALLOC_DEFAULT);
+  if (unlikely(ret.err != MDBX_SUCCESS))
+    return ret;
+
+  DEBUG("db %u allocated new large-page %" PRIaPGNO ", num %zu", mc->mc_dbi,
+        ret.page->mp_pgno, npages);
+  ret.page->mp_flags = P_OVERFLOW;
+  cASSERT(mc, *mc->mc_dbistate & DBI_DIRTY);
+  cASSERT(mc, mc->mc_txn->mt_flags & MDBX_TXN_DIRTY);
+#if MDBX_ENABLE_PGOP_STAT
+  mc->mc_txn->mt_env->me_lck->mti_pgop_stat.newly.weak += npages;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+
+  mc->mc_db->md_overflow_pages += (pgno_t)npages;
+  ret.page->mp_pages = (pgno_t)npages;
+  cASSERT(mc, !(mc->mc_flags & C_SUB));
+  return ret;
+}
+
+__hot static int __must_check_result node_add_leaf2(MDBX_cursor *mc,
+                                                    size_t indx,
+                                                    const MDBX_val *key,
+                                                    MDBX_val *data,
+                                                    unsigned flags) {
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  MDBX_ANALYSIS_ASSUME(key != nullptr);
+  DKBUF_DEBUG;
+  DEBUG("add to leaf2-%spage %" PRIaPGNO " index %zi, "
+        " key size %" PRIuPTR " [%s]",
+        IS_SUBP(mp) ? "sub-" : "", mp->mp_pgno, indx, key ? key->iov_len : 0,
+        DKEY_DEBUG(key));
+
+  cASSERT(mc, key);
+  cASSERT(mc, PAGETYPE_COMPAT(mp) == (P_LEAF | P_LEAF2));
+  const size_t ksize = mp->mp_leaf2_ksize;
+  cASSERT(mc, ksize == key->iov_len + (data ? data->iov_len : 0));
+  const size_t nkeys = page_numkeys(mp);
+
+  /* Just using these for counting */
+  const intptr_t lower = mp->mp_lower + sizeof(indx_t);
+  const intptr_t upper = mp->mp_upper - (ksize - sizeof(indx_t));
+  if (unlikely(lower > upper)) {
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+    return MDBX_PAGE_FULL;
+  }
+  mp->mp_lower = (indx_t)lower;
+  mp->mp_upper = (indx_t)upper;
+
+  void *const ptr = page_leaf2key(mp, indx, ksize);
+  cASSERT(mc, nkeys >= indx);
+  const size_t diff = nkeys - indx;
+  if (likely(diff > 0))
+    /* Move higher keys up one slot. */
+    memmove(ptr_disp(ptr, ksize), ptr, diff * ksize);
+  /* insert new key */
+  leaf2_fill(ptr, key, data, flags);
+  return MDBX_SUCCESS;
+}
+
+static int __must_check_result node_add_branch(MDBX_cursor *mc, size_t indx,
+                                               const MDBX_val *key,
+                                               pgno_t pgno) {
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  DKBUF_DEBUG;
+  DEBUG("add to branch-%spage %" PRIaPGNO " index %zi, node-pgno %" PRIaPGNO
+        " key size %" PRIuPTR " [%s]",
+        IS_SUBP(mp) ? "sub-" : "", mp->mp_pgno, indx, pgno,
+        key ? key->iov_len : 0, DKEY_DEBUG(key));
+
+  cASSERT(mc, PAGETYPE_WHOLE(mp) == P_BRANCH);
+  STATIC_ASSERT(NODESIZE % 2 == 0);
+
+  /* Move higher pointers up one slot. */
+  const size_t nkeys = page_numkeys(mp);
+  cASSERT(mc, nkeys >= indx);
+  for (size_t i = nkeys; i > indx; --i)
+    mp->mp_ptrs[i] = mp->mp_ptrs[i - 1];
+
+  /* Adjust free space offsets. */
+  const size_t branch_bytes = branch_size(mc->mc_txn->mt_env, key);
+  const intptr_t lower = mp->mp_lower + sizeof(indx_t);
+  const intptr_t upper = mp->mp_upper - (branch_bytes - sizeof(indx_t));
+  if (unlikely(lower > upper)) {
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+    return MDBX_PAGE_FULL;
+  }
+  mp->mp_lower = (indx_t)lower;
+  mp->mp_ptrs[indx] = mp->mp_upper = (indx_t)upper;
+
+  /* Write the node data. */
+  MDBX_node *node = page_node(mp, indx);
+  node_set_pgno(node, pgno);
+  node_set_flags(node, 0);
+  UNALIGNED_POKE_8(node, MDBX_node, mn_extra, 0);
+  node_set_ks(node, 0);
+  if (likely(key != NULL)) {
+    node_set_ks(node, key->iov_len);
+    memcpy(node_key(node), key->iov_base, key->iov_len);
+  }
+  return MDBX_SUCCESS;
+}
+
+__hot static int __must_check_result node_add_leaf(MDBX_cursor *mc, size_t indx,
+                                                   const MDBX_val *key,
+                                                   MDBX_val *data,
+                                                   unsigned flags) {
+  MDBX_ANALYSIS_ASSUME(key != nullptr);
+  MDBX_ANALYSIS_ASSUME(data != nullptr);
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  DKBUF_DEBUG;
+  DEBUG("add to leaf-%spage %" PRIaPGNO " index %zi, data size %" PRIuPTR
+        " key size %" PRIuPTR " [%s]",
+        IS_SUBP(mp) ? "sub-" : "", mp->mp_pgno, indx, data ? data->iov_len : 0,
+        key ? key->iov_len : 0, DKEY_DEBUG(key));
+  cASSERT(mc, key != NULL && data != NULL);
+  cASSERT(mc, PAGETYPE_COMPAT(mp) == P_LEAF);
+  MDBX_page *largepage = NULL;
+
+  const size_t align = valign(mc->mc_db->md_flags);
+  size_t node_bytes, key_pad = 0;
+  if (unlikely(flags & F_BIGDATA)) {
+    /* Data already on large/overflow page. */
+    STATIC_ASSERT(sizeof(pgno_t) % 2 == 0);
+    node_bytes = leaf_bignode_size(key->iov_len, align) + sizeof(indx_t);
+    cASSERT(mc, page_room(mp) >= node_bytes);
+  } else if (unlikely(leaf_node_size(key->iov_len, data->iov_len, align) >
+                      mc->mc_txn->mt_env->me_leaf_nodemax)) {
+    /* Put data on large/overflow page. */
+    if (unlikely(mc->mc_db->md_flags & MDBX_DUPSORT)) {
+      ERROR("Unexpected target %s flags 0x%x for large data-item", "dupsort-db",
+            mc->mc_db->md_flags);
+      return MDBX_PROBLEM;
+    }
+    if (unlikely(flags & (F_DUPDATA | F_SUBDATA))) {
+      ERROR("Unexpected target %s flags 0x%x for large data-item", "node",
+            flags);
+      return MDBX_PROBLEM;
+    }
+    cASSERT(mc, page_room(mp) >=
+                    leaf_size(mc->mc_txn->mt_env, key, data, align));
+    const pgno_t ovpages =
+        largedata_npages(mc->mc_txn->mt_env, data->iov_len, align);
+    const pgr_t npr = page_new_large(mc, ovpages);
+    if (unlikely(npr.err != MDBX_SUCCESS))
+      return npr.err;
+    largepage = npr.page;
+    DEBUG("allocated %u large/overflow page(s) %" PRIaPGNO "for %" PRIuPTR
+          " data bytes",
+          largepage->mp_pages, largepage->mp_pgno, data->iov_len);
+    flags |= F_BIGDATA;
+    node_bytes = leaf_bignode_size(key->iov_len, align) + sizeof(indx_t);
+    cASSERT(mc, node_bytes == leaf_size(mc->mc_txn->mt_env, key, data, align));
+  } else {
+    cASSERT(mc, page_room(mp) >=
+                    leaf_size(mc->mc_txn->mt_env, key, data, align));
+    node_bytes =
+        leaf_node_size(key->iov_len, data->iov_len, align) + sizeof(indx_t);
+    cASSERT(mc, node_bytes == leaf_size(mc->mc_txn->mt_env, key, data, align));
+    if (unlikely(align))
+      key_pad = ceil_powerof2(NODESIZE + key->iov_len, align) - NODESIZE -
+                key->iov_len;
+  }
+
+  /* Move higher pointers up one slot. */
+  const size_t nkeys = page_numkeys(mp);
+  cASSERT(mc, nkeys >= indx);
+  for (size_t i = nkeys; i > indx; --i)
+    mp->mp_ptrs[i] = mp->mp_ptrs[i - 1];
+
+  /* Adjust free space offsets. */
+  const intptr_t lower = mp->mp_lower + sizeof(indx_t);
+  const intptr_t upper = mp->mp_upper - (node_bytes - sizeof(indx_t));
+  if (unlikely(lower > upper)) {
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+    return MDBX_PAGE_FULL;
+  }
+  mp->mp_lower = (indx_t)lower;
+  mp->mp_ptrs[indx] = mp->mp_upper = (indx_t)upper;
+
+  /* Write the node data. */
+  MDBX_node *node = page_node(mp, indx);
+  node_set_ks(node, key->iov_len);
+  node_set_flags(node, (uint8_t)flags);
+  UNALIGNED_POKE_8(node, MDBX_node, mn_extra, (uint8_t)key_pad);
+  node_set_ds(node, data->iov_len);
+  memcpy(node_key(node), key->iov_base, key->iov_len);
+
+  void *nodedata = node_data(node);
+  if (unlikely(align)) {
+    /* зануляем выравнивающие промежутки, чтобы не сохранять мусор в БД */
+    cASSERT(mc, (PAGEHDRSZ + mp->mp_ptrs[indx]) % align == 0);
+    memset(ptr_disp(nodedata, -(ptrdiff_t)key_pad), 0, key_pad);
+    const size_t tail = (flags & F_BIGDATA) ? sizeof(pgno_t) : data->iov_len;
+    memset(ptr_disp(nodedata, tail), 0,
+           node_bytes - sizeof(indx_t) - NODESIZE - key->iov_len - key_pad -
+               tail);
+  }
+  if (likely(largepage == NULL)) {
+    if (unlikely(flags & F_BIGDATA)) {
+      memcpy(nodedata, data->iov_base, sizeof(pgno_t));
+      return MDBX_SUCCESS;
+    }
+  } else {
+    poke_pgno(nodedata, largepage->mp_pgno);
+    nodedata = ptr_disp(largepage, largedata_offset(align));
+    memset(page_data(largepage), 0, largedata_offset(align) - PAGEHDRSZ);
+  }
+  if (unlikely(flags & MDBX_RESERVE))
+    data->iov_base = nodedata;
+  else if (likely(nodedata != data->iov_base &&
+                  data->iov_len /* to avoid UBSAN traps*/ != 0))
+    memcpy(nodedata, data->iov_base, data->iov_len);
+  return MDBX_SUCCESS;
+}
+
+/* Delete the specified node from a page.
+ * [in] mc Cursor pointing to the node to delete.
+ * [in] ksize The size of a node. Only used if the page is
+ * part of a MDBX_DUPFIXED database. */
+__hot static void node_del(MDBX_cursor *mc, size_t ksize) {
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  const size_t hole = mc->mc_ki[mc->mc_top];
+  const size_t nkeys = page_numkeys(mp);
+
+  DEBUG("delete node %zu on %s page %" PRIaPGNO, hole,
+        IS_LEAF(mp) ? "leaf" : "branch", mp->mp_pgno);
+  cASSERT(mc, hole < nkeys);
+
+  if (IS_LEAF2(mp)) {
+    cASSERT(mc, ksize > 0 && ksize == mp->mp_leaf2_ksize);
+    size_t diff = nkeys - 1 - hole;
+    void *const base = page_leaf2key(mp, hole, ksize);
+    if (diff)
+      memmove(base, ptr_disp(base, ksize), diff * ksize);
+    cASSERT(mc, mp->mp_lower >= sizeof(indx_t));
+    mp->mp_lower -= sizeof(indx_t);
+    cASSERT(mc, (size_t)UINT16_MAX - mp->mp_upper + sizeof(indx_t) >= ksize);
+    mp->mp_upper += (indx_t)(ksize - sizeof(indx_t));
+    return;
+  }
+
+  MDBX_node *node = page_node(mp, hole);
+  cASSERT(mc, !IS_BRANCH(mp) || hole || node_ks(node) == 0);
+  const size_t hole_size = IS_LEAF(mp)
+                               ? leaf_node_bytes(node, valign(mc->mc_db->md_flags))
+                               : EVEN(NODESIZE + node_ks(node));
+
+  const indx_t hole_offset = mp->mp_ptrs[hole];
+  size_t r, w;
+  for (r = w = 0; r < nkeys; r++)
+    if (r != hole)
+      mp->mp_ptrs[w++] = (mp->mp_ptrs[r] < hole_offset)
+                             ? mp->mp_ptrs[r] + (indx_t)hole_size
+                             : mp->mp_ptrs[r];
+
+  void *const base = ptr_disp(mp, mp->mp_upper + PAGEHDRSZ);
+  memmove(ptr_disp(base, hole_size), base, hole_offset - mp->mp_upper);
+
+  cASSERT(mc, mp->mp_lower >= sizeof(indx_t));
+  mp->mp_lower -= sizeof(indx_t);
+  cASSERT(mc, (size_t)UINT16_MAX - mp->mp_upper >= hole_size);
+  mp->mp_upper += (indx_t)hole_size;
+
+  if (AUDIT_ENABLED()) {
+    const uint8_t checking = mc->mc_checking;
+    mc->mc_checking |= CC_UPDATING;
+    const int page_check_err = page_check(mc, mp);
+    mc->mc_checking = checking;
+    cASSERT(mc, page_check_err == MDBX_SUCCESS);
+  }
+}
+
+/* Compact the main page after deleting a node on a subpage.
+ * [in] mp The main page to operate on.
+ * [in] indx The index of the subpage on the main page. */
+static void node_shrink(MDBX_page *mp, size_t indx) {
+  MDBX_node *node;
+  MDBX_page *sp, *xp;
+  size_t nsize, delta, len, ptr;
+  intptr_t i;
+
+  node = page_node(mp, indx);
+  sp = (MDBX_page *)node_data(node);
+  delta = page_room(sp);
+  assert(delta > 0);
+
+  /* Prepare to shift upward, set len = length(subpage part to shift) */
+  if (IS_LEAF2(sp)) {
+    delta &= /* do not make the node uneven-sized */ ~(size_t)1;
+    if (unlikely(delta) == 0)
+      return;
+    nsize = node_ds(node) - delta;
+    assert(nsize % 1 == 0);
+    len = nsize;
+  } else {
+    xp = ptr_disp(sp, delta); /* destination subpage */
+    for (i = page_numkeys(sp); --i >= 0;) {
+      assert(sp->mp_ptrs[i] >= delta);
+      xp->mp_ptrs[i] = (indx_t)(sp->mp_ptrs[i] - delta);
+    }
+    nsize = node_ds(node) - delta;
+    len = PAGEHDRSZ;
+  }
+  sp->mp_upper = sp->mp_lower;
+  sp->mp_pgno = mp->mp_pgno;
+  node_set_ds(node, nsize);
+
+  /* Shift <lower nodes...initial part of subpage> upward */
+  void *const base = ptr_disp(mp, mp->mp_upper + PAGEHDRSZ);
+  memmove(ptr_disp(base, delta), base, ptr_dist(sp, base) + len);
+
+  ptr = mp->mp_ptrs[indx];
+  for (i = page_numkeys(mp); --i >= 0;) {
+    if (mp->mp_ptrs[i] <= ptr) {
+      assert((size_t)UINT16_MAX - mp->mp_ptrs[i] >= delta);
+      mp->mp_ptrs[i] += (indx_t)delta;
+    }
+  }
+  assert((size_t)UINT16_MAX - mp->mp_upper >= delta);
+  mp->mp_upper += (indx_t)delta;
+}
+
+/* Initial setup of a sorted-dups cursor.
+ *
+ * Sorted duplicates are implemented as a sub-database for the given key.
+ * The duplicate data items are actually keys of the sub-database.
+ * Operations on the duplicate data items are performed using a sub-cursor
+ * initialized when the sub-database is first accessed. This function does
+ * the preliminary setup of the sub-cursor, filling in the fields that
+ * depend only on the parent DB.
+ *
+ * [in] mc The main cursor whose sorted-dups cursor is to be initialized. */
+static int cursor_xinit0(MDBX_cursor *mc) {
+  MDBX_xcursor *mx = mc->mc_xcursor;
+  if (!MDBX_DISABLE_VALIDATION && unlikely(mx == nullptr)) {
+    ERROR("unexpected dupsort-page for non-dupsort db/cursor (dbi %u)",
+          mc->mc_dbi);
+    return MDBX_CORRUPTED;
+  }
+
+  mx->mx_cursor.mc_xcursor = NULL;
+  mx->mx_cursor.mc_next = NULL;
+  mx->mx_cursor.mc_txn = mc->mc_txn;
+  mx->mx_cursor.mc_db = &mx->mx_db;
+  mx->mx_cursor.mc_dbx = &mx->mx_dbx;
+  mx->mx_cursor.mc_dbi = mc->mc_dbi;
+  mx->mx_cursor.mc_dbistate = mc->mc_dbistate;
+  mx->mx_cursor.mc_snum = 0;
+  mx->mx_cursor.mc_top = 0;
+  mx->mx_cursor.mc_flags = C_SUB;
+  STATIC_ASSERT(MDBX_DUPFIXED * 2 == P_LEAF2);
+  cASSERT(mc, (mc->mc_checking & (P_BRANCH | P_LEAF | P_LEAF2)) == P_LEAF);
+  mx->mx_cursor.mc_checking =
+      mc->mc_checking + ((mc->mc_db->md_flags & MDBX_DUPFIXED) << 1);
+  mx->mx_dbx.md_name.iov_len = 0;
+  mx->mx_dbx.md_name.iov_base = NULL;
+  mx->mx_dbx.md_cmp = mc->mc_dbx->md_dcmp;
+  mx->mx_dbx.md_dcmp = NULL;
+  mx->mx_dbx.md_klen_min = INT_MAX;
+  mx->mx_dbx.md_vlen_min = mx->mx_dbx.md_klen_max = mx->mx_dbx.md_vlen_max = 0;
+  mx->mx_dbx.md_split_hints = nullptr;
+  mx->mx_dbx.md_codec = nullptr;
+  return MDBX_SUCCESS;
+}
+
+/* Final setup of a sorted-dups cursor.
+ * Sets up the fields that depend on the data from the main cursor.
+ * [in] mc The main cursor whose sorted-dups cursor is to be initialized.
+ * [in] node The data containing the MDBX_db record for the sorted-dup database.
+ */
+static int cursor_xinit1(MDBX_cursor *mc, MDBX_node *node,
+                         const MDBX_page *mp) {
+  MDBX_xcursor *mx = mc->mc_xcursor;
+  if (!MDBX_DISABLE_VALIDATION && unlikely(mx == nullptr)) {
+    ERROR("unexpected dupsort-page for non-dupsort db/cursor (dbi %u)",
+          mc->mc_dbi);
+    return MDBX_CORRUPTED;
+  }
+
+  const uint8_t flags = node_flags(node);
+  switch (flags) {
+  default:
+    ERROR("invalid node flags %u", flags);
+    return MDBX_CORRUPTED;
+  case F_DUPDATA | F_SUBDATA:
+    if (!MDBX_DISABLE_VALIDATION &&
+        unlikely(node_ds(node) != sizeof(MDBX_db))) {
+      ERROR("invalid nested-db record size %zu", node_ds(node));
+      return MDBX_CORRUPTED;
+    }
+    memcpy(&mx->mx_db, node_data(node), sizeof(MDBX_db));
+    const txnid_t pp_txnid = mp->mp_txnid;
+    if (!MDBX_DISABLE_VALIDATION &&
+        unlikely(mx->mx_db.md_mod_txnid > pp_txnid)) {
+      ERROR("nested-db.md_mod_txnid (%" PRIaTXN ") > page-txnid (%" PRIaTXN ")",
+            mx->mx_db.md_mod_txnid, pp_txnid);
+      return MDBX_CORRUPTED;
+    }
+    mx->mx_cursor.mc_pg[0] = 0;
+    mx->mx_cursor.mc_snum = 0;
+    mx->mx_cursor.mc_top = 0;
+    mx->mx_cursor.mc_flags = C_SUB;
+    break;
+  case F_DUPDATA:
+    if (!MDBX_DISABLE_VALIDATION && unlikely(node_ds(node) <= PAGEHDRSZ)) {
+      ERROR("invalid nested-page size %zu", node_ds(node));
+      return MDBX_CORRUPTED;
+    }
+    MDBX_page *fp = node_data(node);
+    mx->mx_db.md_depth = 1;
+    mx->mx_db.md_branch_pages = 0;
+    mx->mx_db.md_leaf_pages = 1;
+    mx->mx_db.md_overflow_pages = 0;
+    mx->mx_db.md_entries = page_numkeys(fp);
+    mx->mx_db.md_root = fp->mp_pgno;
+    mx->mx_db.md_mod_txnid = mp->mp_txnid;
+    mx->mx_cursor.mc_snum = 1;
+    mx->mx_cursor.mc_top = 0;
+    mx->mx_cursor.mc_flags = C_SUB | C_INITIALIZED;
+    mx->mx_cursor.mc_pg[0] = fp;
+    mx->mx_cursor.mc_ki[0] = 0;
+    mx->mx_db.md_flags = flags_db2sub(mc->mc_db->md_flags);
+    mx->mx_db.md_xsize =
+        (mc->mc_db->md_flags & MDBX_DUPFIXED) ? fp->mp_leaf2_ksize : 0;
+    break;
+  }
+
+  if (unlikely(mx->mx_db.md_xsize != mc->mc_db->md_xsize)) {
+    if (!MDBX_DISABLE_VALIDATION && unlikely(mc->mc_db->md_xsize != 0)) {
+      ERROR("cursor mismatched nested-db md_xsize %u", mc->mc_db->md_xsize);
+      return MDBX_CORRUPTED;
+    }
+    if (!MDBX_DISABLE_VALIDATION &&
+        unlikely((mc->mc_db->md_flags & MDBX_DUPFIXED) == 0)) {
+      ERROR("mismatched nested-db md_flags %u", mc->mc_db->md_flags);
+      return MDBX_CORRUPTED;
+    }
+    if (!MDBX_DISABLE_VALIDATION &&
+        unlikely(mx->mx_db.md_xsize < mc->mc_dbx->md_vlen_min ||
+                 mx->mx_db.md_xsize > mc->mc_dbx->md_vlen_max)) {
+      ERROR("mismatched nested-db.md_xsize (%u) <> min/max value-length "
+            "(%zu/%zu)",
+            mx->mx_db.md_xsize, mc->mc_dbx->md_vlen_min,
+            mc->mc_dbx->md_vlen_max);
+      return MDBX_CORRUPTED;
+    }
+    mc->mc_db->md_xsize = mx->mx_db.md_xsize;
+    mc->mc_dbx->md_vlen_min = mc->mc_dbx->md_vlen_max = mx->mx_db.md_xsize;
+  }
+  mx->mx_dbx.md_klen_min = mc->mc_dbx->md_vlen_min;
+  mx->mx_dbx.md_klen_max = mc->mc_dbx->md_vlen_max;
+
+  DEBUG("Sub-db -%u root page %" PRIaPGNO, mx->mx_cursor.mc_dbi,
+        mx->mx_db.md_root);
+  return MDBX_SUCCESS;
+}
+
+/* Fixup a sorted-dups cursor due to underlying update.
+ * Sets up some fields that depend on the data from the main cursor.
+ * Almost the same as init1, but skips initialization steps if the
+ * xcursor had already been used.
+ * [in] mc The main cursor whose sorted-dups cursor is to be fixed up.
+ * [in] src_mx The xcursor of an up-to-date cursor.
+ * [in] new_dupdata True if converting from a non-F_DUPDATA item. */
+static int cursor_xinit2(MDBX_cursor *mc, MDBX_xcursor *src_mx,
+                         bool new_dupdata) {
+  MDBX_xcursor *mx = mc->mc_xcursor;
+  if (!MDBX_DISABLE_VALIDATION && unlikely(mx == nullptr)) {
+    ERROR("unexpected dupsort-page for non-dupsort db/cursor (dbi %u)",
+          mc->mc_dbi);
+    return MDBX_CORRUPTED;
+  }
+
+  if (new_dupdata) {
+    mx->mx_cursor.mc_snum = 1;
+    mx->mx_cursor.mc_top = 0;
+    mx->mx_cursor.mc_flags = C_SUB | C_INITIALIZED;
+    mx->mx_cursor.mc_ki[0] = 0;
+  }
+
+  mx->mx_dbx.md_klen_min = src_mx->mx_dbx.md_klen_min;
+  mx->mx_dbx.md_klen_max = src_mx->mx_dbx.md_klen_max;
+  mx->mx_dbx.md_cmp = src_mx->mx_dbx.md_cmp;
+  mx->mx_db = src_mx->mx_db;
+  mx->mx_cursor.mc_pg[0] = src_mx->mx_cursor.mc_pg[0];
+  if (mx->mx_cursor.mc_flags & C_INITIALIZED) {
+    DEBUG("Sub-db -%u root page %" PRIaPGNO, mx->mx_cursor.mc_dbi,
+          mx->mx_db.md_root);
+  }
+  return MDBX_SUCCESS;
+}
+
+static __inline int couple_init(MDBX_cursor_couple *couple, const size_t dbi,
+                                MDBX_txn *const txn, MDBX_db *const db,
+                                MDBX_dbx *const dbx, uint8_t *const dbstate) {
+  couple->outer.mc_signature = MDBX_MC_LIVE;
+  couple->outer.mc_next = NULL;
+  couple->outer.mc_backup = NULL;
+  couple->outer.mc_dbi = (MDBX_dbi)dbi;
+  couple->outer.mc_txn = txn;
+  couple->outer.mc_db = db;
+  couple->outer.mc_dbx = dbx;
+  couple->outer.mc_dbistate = dbstate;
+  couple->outer.mc_snum = 0;
+  couple->outer.mc_top = 0;
+  couple->outer.mc_pg[0] = 0;
+  couple->outer.mc_flags = 0;
+  STATIC_ASSERT(CC_BRANCH == P_BRANCH && CC_LEAF == P_LEAF &&
+                CC_OVERFLOW == P_OVERFLOW && CC_LEAF2 == P_LEAF2);
+  couple->outer.mc_checking =
+      (AUDIT_ENABLED() || (txn->mt_env->me_flags & MDBX_VALIDATION))
+          ? CC_PAGECHECK | CC_LEAF
+          : CC_LEAF;
+  if (db->md_flags & MDBX_FIXEDSIZE)
+    couple->outer.mc_checking |= CC_LEAF2;
+  couple->outer.mc_ki[0] = 0;
+  couple->outer.mc_xcursor = NULL;
+
+  int rc = MDBX_SUCCESS;
+  if (unlikely(*couple->outer.mc_dbistate & DBI_STALE)) {
+    rc = page_search(&couple->outer, NULL, MDBX_PS_ROOTONLY);
+    rc = (rc != MDBX_NOTFOUND) ? rc : MDBX_SUCCESS;
+  } else if (unlikely(dbx->md_klen_max == 0)) {
+    rc = setup_dbx(dbx, db, txn->mt_env->me_psize);
+  }
+
+  if (couple->outer.mc_db->md_flags & MDBX_DUPSORT) {
+    couple->inner.mx_cursor.mc_signature = MDBX_MC_LIVE;
+    couple->outer.mc_xcursor = &couple->inner;
+    rc = cursor_xinit0(&couple->outer);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    couple->inner.mx_dbx.md_klen_min = couple->outer.mc_dbx->md_vlen_min;
+    couple->inner.mx_dbx.md_klen_max = couple->outer.mc_dbx->md_vlen_max;
+  }
+  return rc;
+}
+
+/* Initialize a cursor for a given transaction and database. */
+static int cursor_init(MDBX_cursor *mc, MDBX_txn *txn, size_t dbi) {
+  STATIC_ASSERT(offsetof(MDBX_cursor_couple, outer) == 0);
+  return couple_init(container_of(mc, MDBX_cursor_couple, outer), dbi, txn,
+                     &txn->mt_dbs[dbi], &txn->mt_dbxs[dbi],
+                     &txn->mt_dbistate[dbi]);
+}
+
+MDBX_cursor *mdbx_cursor_create(void *context) {
+  MDBX_cursor_couple *couple = osal_calloc(1, sizeof(MDBX_cursor_couple));
+  if (unlikely(!couple))
+    return nullptr;
+
+  couple->outer.mc_signature = MDBX_MC_READY4CLOSE;
+  couple->outer.mc_dbi = UINT_MAX;
+  couple->mc_userctx = context;
+  return &couple->outer;
+}
+
+int mdbx_cursor_set_userctx(MDBX_cursor *mc, void *ctx) {
+  if (unlikely(!mc))
+    return MDBX_EINVAL;
+
+  if (unlikely(mc->mc_signature != MDBX_MC_READY4CLOSE &&
+               mc->mc_signature != MDBX_MC_LIVE))
+    return MDBX_EBADSIGN;
+
+  MDBX_cursor_couple *couple = container_of(mc, MDBX_cursor_couple, outer);
+  couple->mc_userctx = ctx;
+  return MDBX_SUCCESS;
+}
+
+void *mdbx_cursor_get_userctx(const MDBX_cursor *mc) {
+  if (unlikely(!mc))
+    return nullptr;
+
+  if (unlikely(mc->mc_signature != MDBX_MC_READY4CLOSE &&
+               mc->mc_signature != MDBX_MC_LIVE))
+    return nullptr;
+
+  MDBX_cursor_couple *couple = container_of(mc, MDBX_cursor_couple, outer);
+  return couple->mc_userctx;
+}
+
+int mdbx_cursor_bind(MDBX_txn *txn, MDBX_cursor *mc, MDBX_dbi dbi) {
+  if (unlikely(!mc))
+    return MDBX_EINVAL;
+
+  if (unlikely(mc->mc_signature != MDBX_MC_READY4CLOSE &&
+               mc->mc_signature != MDBX_MC_LIVE))
+    return MDBX_EBADSIGN;
+
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_VALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(dbi == FREE_DBI && !(txn->mt_flags & MDBX_TXN_RDONLY)))
+    return MDBX_EACCESS;
+
+  if (unlikely(txn->mt_flags & MDBX_TXN_OPTIMISTIC))
+    return MDBX_INCOMPATIBLE;
+
+  if (unlikely(mc->mc_backup)) /* Cursor from parent transaction */ {
+    cASSERT(mc, mc->mc_signature == MDBX_MC_LIVE);
+    if (unlikely(mc->mc_dbi != dbi ||
+                 /* paranoia */ mc->mc_signature != MDBX_MC_LIVE ||
+                 mc->mc_txn != txn))
+      return MDBX_EINVAL;
+
+    assert(mc->mc_db == &txn->mt_dbs[dbi]);
+    assert(mc->mc_dbx == &txn->mt_dbxs[dbi]);
+    assert(mc->mc_dbi == dbi);
+    assert(mc->mc_dbistate == &txn->mt_dbistate[dbi]);
+    return likely(mc->mc_dbi == dbi &&
+                  /* paranoia */ mc->mc_signature == MDBX_MC_LIVE &&
+                  mc->mc_txn == txn)
+               ? MDBX_SUCCESS
+               : MDBX_EINVAL /* Disallow change DBI in nested transactions */;
+  }
+
+  if (mc->mc_signature == MDBX_MC_LIVE) {
+    if (unlikely(!mc->mc_txn ||
+                 mc->mc_txn->mt_signature != MDBX_MT_SIGNATURE)) {
+      ERROR("Wrong cursor's transaction %p 0x%x",
+            __Wpedantic_format_voidptr(mc->mc_txn),
+            mc->mc_txn ? mc->mc_txn->mt_signature : 0);
+      return MDBX_PROBLEM;
+    }
+    if (mc->mc_flags & C_UNTRACK) {
+      MDBX_cursor **prev = &mc->mc_txn->mt_cursors[mc->mc_dbi];
+      while (*prev && *prev != mc)
+        prev = &(*prev)->mc_next;
+      cASSERT(mc, *prev == mc);
+      *prev = mc->mc_next;
+    } else if (mc->mc_flags & C_VIEW)
+      atomic_sub32(&mc->mc_txn->tw.views, 1);
+    mc->mc_signature = MDBX_MC_READY4CLOSE;
+    mc->mc_flags = 0;
+    mc->mc_dbi = UINT_MAX;
+    mc->mc_next = NULL;
+    mc->mc_db = NULL;
+    mc->mc_dbx = NULL;
+    mc->mc_dbistate = NULL;
+  }
+  cASSERT(mc, !(mc->mc_flags & C_UNTRACK));
+
+  rc = cursor_init(mc, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(txn->mt_flags & MDBX_TXN_FROZEN)) {
+    /* the list of txn's cursors must not be changed concurrently */
+    atomic_add32(&txn->tw.views, 1);
+    mc->mc_flags |= C_VIEW;
+    return MDBX_SUCCESS;
+  }
+
+  mc->mc_next = txn->mt_cursors[dbi];
+  txn->mt_cursors[dbi] = mc;
+  mc->mc_flags |= C_UNTRACK;
+
+  return MDBX_SUCCESS;
+}
+
+int mdbx_cursor_open(MDBX_txn *txn, MDBX_dbi dbi, MDBX_cursor **ret) {
+  if (unlikely(!ret))
+    return MDBX_EINVAL;
+  *ret = NULL;
+
+  MDBX_cursor *const mc = mdbx_cursor_create(nullptr);
+  if (unlikely(!mc))
+    return MDBX_ENOMEM;
+
+  int rc = mdbx_cursor_bind(txn, mc, dbi);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    mdbx_cursor_close(mc);
+    return rc;
+  }
+
+  *ret = mc;
+  return MDBX_SUCCESS;
+}
+
+int mdbx_cursor_renew(MDBX_txn *txn, MDBX_cursor *mc) {
+  return likely(mc) ? mdbx_cursor_bind(txn, mc, mc->mc_dbi) : MDBX_EINVAL;
+}
+
+int mdbx_cursor_copy(const MDBX_cursor *src, MDBX_cursor *dest) {
+  if (unlikely(!src))
+    return MDBX_EINVAL;
+  if (unlikely(src->mc_signature != MDBX_MC_LIVE))
+    return (src->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
+                                                      : MDBX_EBADSIGN;
+
+  int rc = mdbx_cursor_bind(src->mc_txn, dest, src->mc_dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  assert(dest->mc_db == src->mc_db);
+  assert(dest->mc_dbi == src->mc_dbi);
+  assert(dest->mc_dbx == src->mc_dbx);
+  assert(dest->mc_dbistate == src->mc_dbistate);
+again:
+  assert(dest->mc_txn == src->mc_txn);
+  dest->mc_flags ^= (dest->mc_flags ^ src->mc_flags) & ~(C_UNTRACK | C_VIEW);
+  dest->mc_top = src->mc_top;
+  dest->mc_snum = src->mc_snum;
+  for (size_t i = 0; i < src->mc_snum; ++i) {
+    dest->mc_ki[i] = src->mc_ki[i];
+    dest->mc_pg[i] = src->mc_pg[i];
+  }
+
+  if (src->mc_xcursor) {
+    dest->mc_xcursor->mx_db = src->mc_xcursor->mx_db;
+    dest->mc_xcursor->mx_dbx = src->mc_xcursor->mx_dbx;
+    src = &src->mc_xcursor->mx_cursor;
+    dest = &dest->mc_xcursor->mx_cursor;
+    goto again;
+  }
+
+  return MDBX_SUCCESS;
+}
+
+void mdbx_cursor_close(MDBX_cursor *mc) {
+  if (likely(mc)) {
+    ENSURE(NULL, mc->mc_signature == MDBX_MC_LIVE ||
+                     mc->mc_signature == MDBX_MC_READY4CLOSE);
+    MDBX_txn *const txn = mc->mc_txn;
+    if (!mc->mc_backup) {
+      mc->mc_txn = NULL;
+      /* Unlink from txn, if tracked. */
+      if (mc->mc_flags & C_UNTRACK) {
+        ENSURE(txn->mt_env, check_txn(txn, 0) == MDBX_SUCCESS);
+        MDBX_cursor **prev = &txn->mt_cursors[mc->mc_dbi];
+        while (*prev && *prev != mc)
+          prev = &(*prev)->mc_next;
+        tASSERT(txn, *prev == mc);
+        *prev = mc->mc_next;
+      } else if (mc->mc_flags & C_VIEW)
+        atomic_sub32(&txn->tw.views, 1);
+      mc->mc_signature = 0;
+      mc->mc_next = mc;
+      osal_free(mc);
+    } else {
+      /* Cursor closed before nested txn ends */
+      tASSERT(txn, mc->mc_signature == MDBX_MC_LIVE);
+      ENSURE(txn->mt_env, check_txn(txn, 0) == MDBX_SUCCESS &&
+                              (txn->mt_flags & MDBX_TXN_RDONLY) == 0);
+      mc->mc_signature = MDBX_MC_WAIT4EOT;
+    }
+  }
+}
+
+MDBX_txn *mdbx_cursor_txn(const MDBX_cursor *mc) {
+  if (unlikely(!mc || mc->mc_signature != MDBX_MC_LIVE))
+    return NULL;
+  MDBX_txn *txn = mc->mc_txn;
+  if (unlikely(!txn || txn->mt_signature != MDBX_MT_SIGNATURE))
+    return NULL;
+  if (unlikely(txn->mt_flags & MDBX_TXN_FINISHED))
+    return NULL;
+  return txn;
+}
+
+MDBX_dbi mdbx_cursor_dbi(const MDBX_cursor *mc) {
+  if (unlikely(!mc || mc->mc_signature != MDBX_MC_LIVE))
+    return UINT_MAX;
+  return mc->mc_dbi;
+}
+
+/* Return the count of duplicate data items for the current key */
+int mdbx_cursor_count(const MDBX_cursor *mc, size_t *countp) {
+  if (unlikely(mc == NULL))
+    return MDBX_EINVAL;
+
+  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
+    return (mc->mc_signature == MDBX_MC_READY4CLOSE) ? MDBX_EINVAL
+                                                     : MDBX_EBADSIGN;
+
+  int rc = check_txn(mc->mc_txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(countp == NULL || !(mc->mc_flags & C_INITIALIZED)))
+    return MDBX_EINVAL;
+
+  if (!mc->mc_snum) {
+    *countp = 0;
+    return MDBX_NOTFOUND;
+  }
+
+  MDBX_page *mp = mc->mc_pg[mc->mc_top];
+  if ((mc->mc_flags & C_EOF) && mc->mc_ki[mc->mc_top] >= page_numkeys(mp)) {
+    *countp = 0;
+    return MDBX_NOTFOUND;
+  }
+
+  *countp = 1;
+  if (mc->mc_xcursor != NULL) {
+    MDBX_node *node = page_node(mp, mc->mc_ki[mc->mc_top]);
+    if (node_flags(node) & F_DUPDATA) {
+      cASSERT(mc, mc->mc_xcursor &&
+                      (mc->mc_xcursor->mx_cursor.mc_flags & C_INITIALIZED));
+      *countp = unlikely(mc->mc_xcursor->mx_db.md_entries > PTRDIFF_MAX)
+                    ? PTRDIFF_MAX
+                    : (size_t)mc->mc_xcursor->mx_db.md_entries;
+    }
+  }
+  return MDBX_SUCCESS;
+}
+
+/* Replace the key for a branch node with a new key.
+ * Set MDBX_TXN_ERROR on failure.
+ * [in] mc Cursor pointing to the node to operate on.
+ * [in] key The new key to use.
+ * Returns 0 on success, non-zero on failure. */
+static int update_key(MDBX_cursor *mc, const MDBX_val *key) {
+  MDBX_page *mp;
+  MDBX_node *node;
+  size_t len;
+  ptrdiff_t delta, ksize, oksize;
+  intptr_t ptr, i, nkeys, indx;
+  DKBUF_DEBUG;
+
+  cASSERT(mc, cursor_is_tracked(mc));
+  indx = mc->mc_ki[mc->mc_top];
+  mp = mc->mc_pg[mc->mc_top];
+  node = page_node(mp, indx);
+  ptr = mp->mp_ptrs[indx];
+#if MDBX_DEBUG
+  MDBX_val k2;
+  k2.iov_base = node_key(node);
+  k2.iov_len = node_ks(node);
+  DEBUG("update key %zi (offset %zu) [%s] to [%s] on page %" PRIaPGNO, indx,
+        ptr, DVAL_DEBUG(&k2), DKEY_DEBUG(key), mp->mp_pgno);
+#endif /* MDBX_DEBUG */
+
+  /* Sizes must be 2-byte aligned. */
+  ksize = EVEN(key->iov_len);
+  oksize = EVEN(node_ks(node));
+  delta = ksize - oksize;
+
+  /* Shift node contents if EVEN(key length) changed. */
+  if (delta) {
+    if (delta > (int)page_room(mp)) {
+      /* not enough space left, do a delete and split */
+      DEBUG("Not enough room, delta = %zd, splitting...", delta);
+      pgno_t pgno = node_pgno(node);
+      node_del(mc, 0);
+      int err = page_split(mc, key, NULL, pgno, MDBX_SPLIT_REPLACE);
+      if (err == MDBX_SUCCESS && AUDIT_ENABLED())
+        err = cursor_check_updating(mc);
+      return err;
+    }
+
+    nkeys = page_numkeys(mp);
+    for (i = 0; i < nkeys; i++) {
+      if (mp->mp_ptrs[i] <= ptr) {
+        cASSERT(mc, mp->mp_ptrs[i] >= delta);
+        mp->mp_ptrs[i] -= (indx_t)delta;
+      }
+    }
+
+    void *const base = ptr_disp(mp, mp->mp_upper + PAGEHDRSZ);
+    len = ptr - mp->mp_upper + NODESIZE;
+    memmove(ptr_disp(base, -delta), base, len);
+    cASSERT(mc, mp->mp_upper >= delta);
+    mp->mp_upper -= (indx_t)delta;
+
+    node = page_node(mp, indx);
+  }
+
+  /* But even if no shift was needed, update ksize */
+  node_set_ks(node, key->iov_len);
+
+  if (likely(key->iov_len /* to avoid UBSAN traps*/ != 0))
+    memcpy(node_key(node), key->iov_base, key->iov_len);
+  return MDBX_SUCCESS;
+}
+
+/* Move a node from csrc to cdst. */
+static int node_move(MDBX_cursor *csrc, MDBX_cursor *cdst, bool fromleft) {
+  int rc;
+  DKBUF_DEBUG;
+
+  MDBX_page *psrc = csrc->mc_pg[csrc->mc_top];
+  MDBX_page *pdst = cdst->mc_pg[cdst->mc_top];
+  cASSERT(csrc, PAGETYPE_WHOLE(psrc) == PAGETYPE_WHOLE(pdst));
+  cASSERT(csrc, csrc->mc_dbi == cdst->mc_dbi);
+  cASSERT(csrc, csrc->mc_top == cdst->mc_top);
+  if (unlikely(PAGETYPE_WHOLE(psrc) != PAGETYPE_WHOLE(pdst))) {
+  bailout:
+    ERROR("Wrong or mismatch pages's types (src %d, dst %d) to move node",
+          PAGETYPE_WHOLE(psrc), PAGETYPE_WHOLE(pdst));
+    csrc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+    return MDBX_PROBLEM;
+  }
+
+  MDBX_val key4move;
+  switch (PAGETYPE_WHOLE(psrc)) {
+  case P_BRANCH: {
+    const MDBX_node *srcnode = page_node(psrc, csrc->mc_ki[csrc->mc_top]);
+    cASSERT(csrc, node_flags(srcnode) == 0);
+    const pgno_t srcpg = node_pgno(srcnode);
+    key4move.iov_len = node_ks(srcnode);
+    key4move.iov_base = node_key(srcnode);
+
+    if (csrc->mc_ki[csrc->mc_top] == 0) {
+      const size_t snum = csrc->mc_snum;
+      cASSERT(csrc, snum > 0);
+      /* must find the lowest key below src */
+      rc = page_search_lowest(csrc);
+      MDBX_page *lowest_page = csrc->mc_pg[csrc->mc_top];
+      if (unlikely(rc))
+        return rc;
+      cASSERT(csrc, IS_LEAF(lowest_page));
+      if (unlikely(!IS_LEAF(lowest_page)))
+        goto bailout;
+      if (IS_LEAF2(lowest_page)) {
+        key4move.iov_len = csrc->mc_db->md_xsize;
+        key4move.iov_base = page_leaf2key(lowest_page, 0, key4move.iov_len);
+      } else {
+        const MDBX_node *lowest_node = page_node(lowest_page, 0);
+        key4move.iov_len = node_ks(lowest_node);
+        key4move.iov_base = node_key(lowest_node);
+      }
+
+      /* restore cursor after mdbx_page_search_lowest() */
+      csrc->mc_snum = (uint8_t)snum;
+      csrc->mc_top = (uint8_t)snum - 1;
+      csrc->mc_ki[csrc->mc_top] = 0;
+
+      /* paranoia */
+      cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
+      cASSERT(csrc, IS_BRANCH(psrc));
+      if (unlikely(!IS_BRANCH(psrc)))
+        goto bailout;
+    }
+
+    if (cdst->mc_ki[cdst->mc_top] == 0) {
+      const size_t snum = cdst->mc_snum;
+      cASSERT(csrc, snum > 0);
+      MDBX_cursor mn;
+      cursor_copy(cdst, &mn);
+      /* must find the lowest key below dst */
+      rc = page_search_lowest(&mn);
+      if (unlikely(rc))
+        return rc;
+      MDBX_page *const lowest_page = mn.mc_pg[mn.mc_top];
+      cASSERT(cdst, IS_LEAF(lowest_page));
+      if (unlikely(!IS_LEAF(lowest_page)))
+        goto bailout;
+      MDBX_val key;
+      if (IS_LEAF2(lowest_page)) {
+        key.iov_len = mn.mc_db->md_xsize;
+        key.iov_base = page_leaf2key(lowest_page, 0, key.iov_len);
+      } else {
+        MDBX_node *lowest_node = page_node(lowest_page, 0);
+        key.iov_len = node_ks(lowest_node);
+        key.iov_base = node_key(lowest_node);
+      }
+
+      /* restore cursor after mdbx_page_search_lowest() */
+      mn.mc_snum = (uint8_t)snum;
+      mn.mc_top = (uint8_t)snum - 1;
+      mn.mc_ki[mn.mc_top] = 0;
+
+      const intptr_t delta =
+          EVEN(key.iov_len) - EVEN(node_ks(page_node(mn.mc_pg[mn.mc_top], 0)));
+      const intptr_t needed =
+          branch_size(cdst->mc_txn->mt_env, &key4move) + delta;
+      const intptr_t have = page_room(pdst);
+      if (unlikely(needed > have))
+        return MDBX_RESULT_TRUE;
+
+      if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
+        return rc;
+      psrc = csrc->mc_pg[csrc->mc_top];
+      pdst = cdst->mc_pg[cdst->mc_top];
+
+      WITH_CURSOR_TRACKING(mn, rc = update_key(&mn, &key));
+      if (unlikely(rc))
+        return rc;
+    } else {
+      const size_t needed = branch_size(cdst->mc_txn->mt_env, &key4move);
+      const size_t have = page_room(pdst);
+      if (unlikely(needed > have))
+        return MDBX_RESULT_TRUE;
+
+      if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
+        return rc;
+      psrc = csrc->mc_pg[csrc->mc_top];
+      pdst = cdst->mc_pg[cdst->mc_top];
+    }
+
+    DEBUG("moving %s-node %u [%s] on page %" PRIaPGNO
+          " to node %u on page %" PRIaPGNO,
+          "branch", csrc->mc_ki[csrc->mc_top], DKEY_DEBUG(&key4move),
+          psrc->mp_pgno, cdst->mc_ki[cdst->mc_top], pdst->mp_pgno);
+    /* Add the node to the destination page. */
+    rc = node_add_branch(cdst, cdst->mc_ki[cdst->mc_top], &key4move, srcpg);
+  } break;
+
+  case P_LEAF: {
+    /* Mark src and dst as dirty. */
+    if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
+      return rc;
+    psrc = csrc->mc_pg[csrc->mc_top];
+    pdst = cdst->mc_pg[cdst->mc_top];
+    const MDBX_node *srcnode = page_node(psrc, csrc->mc_ki[csrc->mc_top]);
+    MDBX_val data;
+    data.iov_len = node_ds(srcnode);
+    data.iov_base = node_data(srcnode);
+    key4move.iov_len = node_ks(srcnode);
+    key4move.iov_base = node_key(srcnode);
+    DEBUG("moving %s-node %u [%s] on page %" PRIaPGNO
+          " to node %u on page %" PRIaPGNO,
+          "leaf", csrc->mc_ki[csrc->mc_top], DKEY_DEBUG(&key4move),
+          psrc->mp_pgno, cdst->mc_ki[cdst->mc_top], pdst->mp_pgno);
+    /* Add the node to the destination page. */
+    rc = node_add_leaf(cdst, cdst->mc_ki[cdst->mc_top], &key4move, &data,
+                       node_flags(srcnode));
+  } break;
+
+  case P_LEAF | P_LEAF2: {
+    /* Mark src and dst as dirty. */
+    if (unlikely((rc = page_touch(csrc)) || (rc = page_touch(cdst))))
+      return rc;
+    psrc = csrc->mc_pg[csrc->mc_top];
+    pdst = cdst->mc_pg[cdst->mc_top];
+    /* для MDBX_FIXEDSIZE элемент перемещается целиком вместе с данными */
+    key4move.iov_len = psrc->mp_leaf2_ksize;
+    key4move.iov_base =
+        page_leaf2key(psrc, csrc->mc_ki[csrc->mc_top], key4move.iov_len);
+    DEBUG("moving %s-node %u [%s] on page %" PRIaPGNO
+          " to node %u on page %" PRIaPGNO,
+          "leaf2", csrc->mc_ki[csrc->mc_top], DKEY_DEBUG(&key4move),
+          psrc->mp_pgno, cdst->mc_ki[cdst->mc_top], pdst->mp_pgno);
+    /* Add the node to the destination page. */
+    rc = node_add_leaf2(cdst, cdst->mc_ki[cdst->mc_top], &key4move, nullptr,
+                        0);
+  } break;
+
+  default:
+    assert(false);
+    goto bailout;
+  }
+
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  /* Delete the node from the source page. */
+  node_del(csrc, key4move.iov_len);
+
+  cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
+  cASSERT(cdst, pdst == cdst->mc_pg[cdst->mc_top]);
+  cASSERT(csrc, PAGETYPE_WHOLE(psrc) == PAGETYPE_WHOLE(pdst));
+
+  {
+    /* Adjust other cursors pointing to mp */
+    MDBX_cursor *m2, *m3;
+    const MDBX_dbi dbi = csrc->mc_dbi;
+    cASSERT(csrc, csrc->mc_top == cdst->mc_top);
+    if (fromleft) {
+      /* If we're adding on the left, bump others up */
+      for (m2 = csrc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
+        m3 = (csrc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+        if (!(m3->mc_flags & C_INITIALIZED) || m3->mc_top < csrc->mc_top)
+          continue;
+        if (m3 != cdst && m3->mc_pg[csrc->mc_top] == pdst &&
+            m3->mc_ki[csrc->mc_top] >= cdst->mc_ki[csrc->mc_top]) {
+          m3->mc_ki[csrc->mc_top]++;
+        }
+        if (m3 != csrc && m3->mc_pg[csrc->mc_top] == psrc &&
+            m3->mc_ki[csrc->mc_top] == csrc->mc_ki[csrc->mc_top]) {
+          m3->mc_pg[csrc->mc_top] = pdst;
+          m3->mc_ki[csrc->mc_top] = cdst->mc_ki[cdst->mc_top];
+          cASSERT(csrc, csrc->mc_top > 0);
+          m3->mc_ki[csrc->mc_top - 1]++;
+        }
+        if (XCURSOR_INITED(m3) && IS_LEAF(psrc))
+          XCURSOR_REFRESH(m3, m3->mc_pg[csrc->mc_top], m3->mc_ki[csrc->mc_top]);
+      }
+    } else {
+      /* Adding on the right, bump others down */
+      for (m2 = csrc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
+        m3 = (csrc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+        if (m3 == csrc)
+          continue;
+        if (!(m3->mc_flags & C_INITIALIZED) || m3->mc_top < csrc->mc_top)
+          continue;
+        if (m3->mc_pg[csrc->mc_top] == psrc) {
+          if (!m3->mc_ki[csrc->mc_top]) {
+            m3->mc_pg[csrc->mc_top] = pdst;
+            m3->mc_ki[csrc->mc_top] = cdst->mc_ki[cdst->mc_top];
+            cASSERT(csrc, csrc->mc_top > 0);
+            m3->mc_ki[csrc->mc_top - 1]--;
+          } else {
+            m3->mc_ki[csrc->mc_top]--;
+          }
+          if (XCURSOR_INITED(m3) && IS_LEAF(psrc))
+            XCURSOR_REFRESH(m3, m3->mc_pg[csrc->mc_top],
+                            m3->mc_ki[csrc->mc_top]);
+        }
+      }
+    }
+  }
+
+  /* Update the parent separators. */
+  if (csrc->mc_ki[csrc->mc_top] == 0) {
+    cASSERT(csrc, csrc->mc_top > 0);
+    if (csrc->mc_ki[csrc->mc_top - 1] != 0) {
+      MDBX_val key;
+      if (IS_LEAF2(psrc)) {
+        key.iov_len = csrc->mc_db->md_xsize;
+        key.iov_base = page_leaf2key(psrc, 0, key.iov_len);
+      } else {
+        MDBX_node *srcnode = page_node(psrc, 0);
+        key.iov_len = node_ks(srcnode);
+        key.iov_base = node_key(srcnode);
+      }
+      DEBUG("update separator for source page %" PRIaPGNO " to [%s]",
+            psrc->mp_pgno, DKEY_DEBUG(&key));
+      MDBX_cursor mn;
+      cursor_copy(csrc, &mn);
+      cASSERT(csrc, mn.mc_snum > 0);
+      mn.mc_snum--;
+      mn.mc_top--;
+      /* We want rebalance to find mn when doing fixups */
+      WITH_CURSOR_TRACKING(mn, rc = update_key(&mn, &key));
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+    if (IS_BRANCH(psrc)) {
+      const MDBX_val nullkey = {0, 0};
+      const indx_t ix = csrc->mc_ki[csrc->mc_top];
+      csrc->mc_ki[csrc->mc_top] = 0;
+      rc = update_key(csrc, &nullkey);
+      csrc->mc_ki[csrc->mc_top] = ix;
+      cASSERT(csrc, rc == MDBX_SUCCESS);
+    }
+  }
+
+  if (cdst->mc_ki[cdst->mc_top] == 0) {
+    cASSERT(cdst, cdst->mc_top > 0);
+    if (cdst->mc_ki[cdst->mc_top - 1] != 0) {
+      MDBX_val key;
+      if (IS_LEAF2(pdst)) {
+        key.iov_len = cdst->mc_db->md_xsize;
+        key.iov_base = page_leaf2key(pdst, 0, key.iov_len);
+      } else {
+        MDBX_node *srcnode = page_node(pdst, 0);
+        key.iov_len = node_ks(srcnode);
+        key.iov_base = node_key(srcnode);
+      }
+      DEBUG("update separator for destination page %" PRIaPGNO " to [%s]",
+            pdst->mp_pgno, DKEY_DEBUG(&key));
+      MDBX_cursor mn;
+      cursor_copy(cdst, &mn);
+      cASSERT(cdst, mn.mc_snum > 0);
+      mn.mc_snum--;
+      mn.mc_top--;
+      /* We want rebalance to find mn when doing fixups */
+      WITH_CURSOR_TRACKING(mn, rc = update_key(&mn, &key));
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+    if (IS_BRANCH(pdst)) {
+      const MDBX_val nullkey = {0, 0};
+      const indx_t ix = cdst->mc_ki[cdst->mc_top];
+      cdst->mc_ki[cdst->mc_top] = 0;
+      rc = update_key(cdst, &nullkey);
+      cdst->mc_ki[cdst->mc_top] = ix;
+      cASSERT(cdst, rc == MDBX_SUCCESS);
+    }
+  }
+
+  return MDBX_SUCCESS;
+}
+
+/* Merge one page into another.
+ *
+ * The nodes from the page pointed to by csrc will be copied to the page
+ * pointed to by cdst and then the csrc page will be freed.
+ *
+ * [in] csrc Cursor pointing to the source page.
+ * [in] cdst Cursor pointing to the destination page.
+ *
+ * Returns 0 on success, non-zero on failure. */
+static int page_merge(MDBX_cursor *csrc, MDBX_cursor *cdst) {
+  MDBX_val key;
+  int rc;
+
+  cASSERT(csrc, csrc != cdst);
+  cASSERT(csrc, cursor_is_tracked(csrc));
+  cASSERT(cdst, cursor_is_tracked(cdst));
+  const MDBX_page *const psrc = csrc->mc_pg[csrc->mc_top];
+  MDBX_page *pdst = cdst->mc_pg[cdst->mc_top];
+  DEBUG("merging page %" PRIaPGNO " into %" PRIaPGNO, psrc->mp_pgno,
+        pdst->mp_pgno);
+
+  cASSERT(csrc, PAGETYPE_WHOLE(psrc) == PAGETYPE_WHOLE(pdst));
+  cASSERT(csrc, csrc->mc_dbi == cdst->mc_dbi && csrc->mc_db == cdst->mc_db);
+  cASSERT(csrc, csrc->mc_snum > 1); /* can't merge root page */
+  cASSERT(cdst, cdst->mc_snum > 1);
+  cASSERT(cdst, cdst->mc_snum < cdst->mc_db->md_depth ||
+                    IS_LEAF(cdst->mc_pg[cdst->mc_db->md_depth - 1]));
+  cASSERT(csrc, csrc->mc_snum < csrc->mc_db->md_depth ||
+                    IS_LEAF(csrc->mc_pg[csrc->mc_db->md_depth - 1]));
+  cASSERT(cdst, page_room(pdst) >= page_used(cdst->mc_txn->mt_env, psrc));
+  const int pagetype = PAGETYPE_WHOLE(psrc);
+
+  /* Move all nodes from src to dst */
+  const size_t dst_nkeys = page_numkeys(pdst);
+  const size_t src_nkeys = page_numkeys(psrc);
+  cASSERT(cdst, dst_nkeys + src_nkeys >= (IS_LEAF(psrc) ? 1u : 2u));
+  if (likely(src_nkeys)) {
+    size_t j = dst_nkeys;
+    if (unlikely(pagetype & P_LEAF2)) {
+      /* Mark dst as dirty. */
+      if (unlikely(rc = page_touch(cdst)))
+        return rc;
+
+      key.iov_len = psrc->mp_leaf2_ksize;
+      key.iov_base = page_data(psrc);
+      size_t i = 0;
+      do {
+        rc = node_add_leaf2(cdst, j++, &key, nullptr, 0);
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+        key.iov_base = ptr_disp(key.iov_base, key.iov_len);
+      } while (++i != src_nkeys);
+    } else {
+      MDBX_node *srcnode = page_node(psrc, 0);
+      key.iov_len = node_ks(srcnode);
+      key.iov_base = node_key(srcnode);
+      if (pagetype & P_BRANCH) {
+        MDBX_cursor mn;
+        cursor_copy(csrc, &mn);
+        /* must find the lowest key below src */
+        rc = page_search_lowest(&mn);
+        if (unlikely(rc))
+          return rc;
+
+        const MDBX_page *mp = mn.mc_pg[mn.mc_top];
+        if (likely(!IS_LEAF2(mp))) {
+          cASSERT(&mn, IS_LEAF(mp));
+          const MDBX_node *lowest = page_node(mp, 0);
+          key.iov_len = node_ks(lowest);
+          key.iov_base = node_key(lowest);
+        } else {
+          cASSERT(&mn, mn.mc_top > csrc->mc_top);
+          key.iov_len = mn.mc_db->md_xsize;
+          key.iov_base = page_leaf2key(mp, mn.mc_ki[mn.mc_top], key.iov_len);
+        }
+        cASSERT(&mn, key.iov_len >= csrc->mc_dbx->md_klen_min);
+        cASSERT(&mn, key.iov_len <= csrc->mc_dbx->md_klen_max);
+
+        const size_t dst_room = page_room(pdst);
+        const size_t src_used = page_used(cdst->mc_txn->mt_env, psrc);
+        const size_t space_needed = src_used - node_ks(srcnode) + key.iov_len;
+        if (unlikely(space_needed > dst_room))
+          return MDBX_RESULT_TRUE;
+      }
+
+      /* Mark dst as dirty. */
+      if (unlikely(rc = page_touch(cdst)))
+        return rc;
+
+      size_t i = 0;
+      while (true) {
+        if (pagetype & P_LEAF) {
+          MDBX_val data;
+          data.iov_len = node_ds(srcnode);
+          data.iov_base = node_data(srcnode);
+          rc = node_add_leaf(cdst, j++, &key, &data, node_flags(srcnode));
+        } else {
+          cASSERT(csrc, node_flags(srcnode) == 0);
+          rc = node_add_branch(cdst, j++, &key, node_pgno(srcnode));
+        }
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+
+        if (++i == src_nkeys)
+          break;
+        srcnode = page_node(psrc, i);
+        key.iov_len = node_ks(srcnode);
+        key.iov_base = node_key(srcnode);
+      }
+    }
+
+    pdst = cdst->mc_pg[cdst->mc_top];
+    DEBUG("dst page %" PRIaPGNO " now has %zu keys (%.1f%% filled)",
+          pdst->mp_pgno, page_numkeys(pdst),
+          page_fill(cdst->mc_txn->mt_env, pdst));
+
+    cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
+    cASSERT(cdst, pdst == cdst->mc_pg[cdst->mc_top]);
+  }
+
+  /* Unlink the src page from parent and add to free list. */
+  csrc->mc_top--;
+  node_del(csrc, 0);
+  if (csrc->mc_ki[csrc->mc_top] == 0) {
+    const MDBX_val nullkey = {0, 0};
+    rc = update_key(csrc, &nullkey);
+    if (unlikely(rc)) {
+      csrc->mc_top++;
+      return rc;
+    }
+  }
+  csrc->mc_top++;
+
+  cASSERT(csrc, psrc == csrc->mc_pg[csrc->mc_top]);
+  cASSERT(cdst, pdst == cdst->mc_pg[cdst->mc_top]);
+
+  {
+    /* Adjust other cursors pointing to mp */
+    MDBX_cursor *m2, *m3;
+    const MDBX_dbi dbi = csrc->mc_dbi;
+    const size_t top = csrc->mc_top;
+
+    for (m2 = csrc->mc_txn->mt_cursors[dbi]; m2; m2 = m2->mc_next) {
+      m3 = (csrc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+      if (m3 == csrc || top >= m3->mc_snum)
+        continue;
+      if (m3->mc_pg[top] == psrc) {
+        m3->mc_pg[top] = pdst;
+        cASSERT(m3, dst_nkeys + m3->mc_ki[top] <= UINT16_MAX);
+        m3->mc_ki[top] += (indx_t)dst_nkeys;
+        m3->mc_ki[top - 1] = cdst->mc_ki[top - 1];
+      } else if (m3->mc_pg[top - 1] == csrc->mc_pg[top - 1] &&
+                 m3->mc_ki[top - 1] > csrc->mc_ki[top - 1]) {
+        m3->mc_ki[top - 1]--;
+      }
+      if (XCURSOR_INITED(m3) && IS_LEAF(psrc))
+        XCURSOR_REFRESH(m3, m3->mc_pg[top], m3->mc_ki[top]);
+    }
+  }
+
+  rc = page_retire(csrc, (MDBX_page *)psrc);
+  if (unlikely(rc))
+    return rc;
+
+  cASSERT(cdst, cdst->mc_db->md_entries > 0);
+  cASSERT(cdst, cdst->mc_snum <= cdst->mc_db->md_depth);
+  cASSERT(cdst, cdst->mc_top > 0);
+  cASSERT(cdst, cdst->mc_snum == cdst->mc_top + 1);
+  MDBX_page *const top_page = cdst->mc_pg[cdst->mc_top];
+  const indx_t top_indx = cdst->mc_ki[cdst->mc_top];
+  const unsigned save_snum = cdst->mc_snum;
+  const uint16_t save_depth = cdst->mc_db->md_depth;
+  cursor_pop(cdst);
+  rc = rebalance(cdst);
+  if (unlikely(rc))
+    return rc;
+
+  cASSERT(cdst, cdst->mc_db->md_entries > 0);
+  cASSERT(cdst, cdst->mc_snum <= cdst->mc_db->md_depth);
+  cASSERT(cdst, cdst->mc_snum == cdst->mc_top + 1);
+
+#if MDBX_ENABLE_PGOP_STAT
+  cdst->mc_txn->mt_env->me_lck->mti_pgop_stat.merge.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+
+  if (IS_LEAF(cdst->mc_pg[cdst->mc_top])) {
+    /* LY: don't touch cursor if top-page is a LEAF */
+    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
+                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
+    return MDBX_SUCCESS;
+  }
+
+  cASSERT(cdst, page_numkeys(top_page) == dst_nkeys + src_nkeys);
+
+  if (unlikely(pagetype != PAGETYPE_WHOLE(top_page))) {
+    /* LY: LEAF-page becomes BRANCH, unable restore cursor's stack */
+    goto bailout;
+  }
+
+  if (top_page == cdst->mc_pg[cdst->mc_top]) {
+    /* LY: don't touch cursor if prev top-page already on the top */
+    cASSERT(cdst, cdst->mc_ki[cdst->mc_top] == top_indx);
+    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
+                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
+    return MDBX_SUCCESS;
+  }
+
+  const int new_snum = save_snum - save_depth + cdst->mc_db->md_depth;
+  if (unlikely(new_snum < 1 || new_snum > cdst->mc_db->md_depth)) {
+    /* LY: out of range, unable restore cursor's stack */
+    goto bailout;
+  }
+
+  if (top_page == cdst->mc_pg[new_snum - 1]) {
+    cASSERT(cdst, cdst->mc_ki[new_snum - 1] == top_indx);
+    /* LY: restore cursor stack */
+    cdst->mc_snum = (uint8_t)new_snum;
+    cdst->mc_top = (uint8_t)new_snum - 1;
+    cASSERT(cdst, cdst->mc_snum < cdst->mc_db->md_depth ||
+                      IS_LEAF(cdst->mc_pg[cdst->mc_db->md_depth - 1]));
+    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
+                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
+    return MDBX_SUCCESS;
+  }
+
+  MDBX_page *const stub_page = (MDBX_page *)(~(uintptr_t)top_page);
+  const indx_t stub_indx = top_indx;
+  if (save_depth > cdst->mc_db->md_depth &&
+      ((cdst->mc_pg[save_snum - 1] == top_page &&
+        cdst->mc_ki[save_snum - 1] == top_indx) ||
+       (cdst->mc_pg[save_snum - 1] == stub_page &&
+        cdst->mc_ki[save_snum - 1] == stub_indx))) {
+    /* LY: restore cursor stack */
+    cdst->mc_pg[new_snum - 1] = top_page;
+    cdst->mc_ki[new_snum - 1] = top_indx;
+    cdst->mc_pg[new_snum] = (MDBX_page *)(~(uintptr_t)cdst->mc_pg[new_snum]);
+    cdst->mc_ki[new_snum] = ~cdst->mc_ki[new_snum];
+    cdst->mc_snum = (uint8_t)new_snum;
+    cdst->mc_top = (uint8_t)new_snum - 1;
+    cASSERT(cdst, cdst->mc_snum < cdst->mc_db->md_depth ||
+                      IS_LEAF(cdst->mc_pg[cdst->mc_db->md_depth - 1]));
+    cASSERT(cdst, IS_LEAF(cdst->mc_pg[cdst->mc_top]) ||
+                      PAGETYPE_WHOLE(cdst->mc_pg[cdst->mc_top]) == pagetype);
+    return MDBX_SUCCESS;
+  }
+
+bailout:
+  /* LY: unable restore cursor's stack */
+  cdst->mc_flags &= ~C_INITIALIZED;
+  return MDBX_CURSOR_FULL;
+}
+
+static void cursor_restore(const MDBX_cursor *csrc, MDBX_cursor *cdst) {
+  cASSERT(cdst, cdst->mc_dbi == csrc->mc_dbi);
+  cASSERT(cdst, cdst->mc_txn == csrc->mc_txn);
+  cASSERT(cdst, cdst->mc_db == csrc->mc_db);
+  cASSERT(cdst, cdst->mc_dbx == csrc->mc_dbx);
+  cASSERT(cdst, cdst->mc_dbistate == csrc->mc_dbistate);
+  cdst->mc_snum = csrc->mc_snum;
+  cdst->mc_top = csrc->mc_top;
+  cdst->mc_flags = csrc->mc_flags;
+  cdst->mc_checking = csrc->mc_checking;
+
+  for (size_t i = 0; i < csrc->mc_snum; i++) {
+    cdst->mc_pg[i] = csrc->mc_pg[i];
+    cdst->mc_ki[i] = csrc->mc_ki[i];
+  }
+}
+
+/* Copy the contents of a cursor.
+ * [in] csrc The cursor to copy from.
+ * [out] cdst The cursor to copy to. */
+static void cursor_copy(const MDBX_cursor *csrc, MDBX_cursor *cdst) {
+  cASSERT(csrc, csrc->mc_txn->mt_txnid >=
+                    csrc->mc_txn->mt_env->me_lck->mti_oldest_reader.weak);
+  cdst->mc_dbi = csrc->mc_dbi;
+  cdst->mc_next = NULL;
+  cdst->mc_backup = NULL;
+  cdst->mc_xcursor = NULL;
+  cdst->mc_txn = csrc->mc_txn;
+  cdst->mc_db = csrc->mc_db;
+  cdst->mc_dbx = csrc->mc_dbx;
+  cdst->mc_dbistate = csrc->mc_dbistate;
+  cursor_restore(csrc, cdst);
+}
+
+/* Rebalance the tree after a delete operation.
+ * [in] mc Cursor pointing to the page where rebalancing should begin.
+ * Returns 0 on success, non-zero on failure. */
+static int rebalance(MDBX_cursor *mc) {
+  cASSERT(mc, cursor_is_tracked(mc));
+  cASSERT(mc, mc->mc_snum > 0);
+  cASSERT(mc, mc->mc_snum < mc->mc_db->md_depth ||
+                  IS_LEAF(mc->mc_pg[mc->mc_db->md_depth - 1]));
+  const int pagetype = PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]);
+
+  STATIC_ASSERT(P_BRANCH == 1);
+  const size_t minkeys = (pagetype & P_BRANCH) + (size_t)1;
+
+  /* Pages emptier than this are candidates for merging. */
+  size_t room_threshold = likely(mc->mc_dbi != FREE_DBI)
+                              ? mc->mc_txn->mt_env->me_merge_threshold
+                              : mc->mc_txn->mt_env->me_merge_threshold_gc;
+
+  const MDBX_page *const tp = mc->mc_pg[mc->mc_top];
+  const size_t numkeys = page_numkeys(tp);
+  const size_t room = page_room(tp);
+  DEBUG("rebalancing %s page %" PRIaPGNO
+        " (has %zu keys, full %.1f%%, used %zu, room %zu bytes )",
+        (pagetype & P_LEAF) ? "leaf" : "branch", tp->mp_pgno, numkeys,
+        page_fill(mc->mc_txn->mt_env, tp), page_used(mc->mc_txn->mt_env, tp),
+        room);
+  cASSERT(mc, IS_MODIFIABLE(mc->mc_txn, tp));
+
+  if (unlikely(numkeys < minkeys)) {
+    DEBUG("page %" PRIaPGNO " must be merged due keys < %zu threshold",
+          tp->mp_pgno, minkeys);
+  } else if (unlikely(room > room_threshold)) {
+    DEBUG("page %" PRIaPGNO " should be merged due room %zu > %zu threshold",
+          tp->mp_pgno, room, room_threshold);
+  } else {
+    DEBUG("no need to rebalance page %" PRIaPGNO ", room %zu < %zu threshold",
+          tp->mp_pgno, room, room_threshold);
+    cASSERT(mc, mc->mc_db->md_entries > 0);
+    return MDBX_SUCCESS;
+  }
+
+  int rc;
+  if (mc->mc_snum < 2) {
+    MDBX_page *const mp = mc->mc_pg[0];
+    const size_t nkeys = page_numkeys(mp);
+    cASSERT(mc, (mc->mc_db->md_entries == 0) == (nkeys == 0));
+    if (IS_SUBP(mp)) {
+      DEBUG("%s", "Can't rebalance a subpage, ignoring");
+      cASSERT(mc, pagetype & P_LEAF);
+      return MDBX_SUCCESS;
+    }
+    if (nkeys == 0) {
+      cASSERT(mc, IS_LEAF(mp));
+      DEBUG("%s", "tree is completely empty");
+      cASSERT(mc, (*mc->mc_dbistate & DBI_DIRTY) != 0);
+      mc->mc_db->md_root = P_INVALID;
+      mc->mc_db->md_depth = 0;
+      cASSERT(mc, mc->mc_db->md_branch_pages == 0 &&
+                      mc->mc_db->md_overflow_pages == 0 &&
+                      mc->mc_db->md_leaf_pages == 1);
+      /* Adjust cursors pointing to mp */
+      for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
+           m2 = m2->mc_next) {
+        MDBX_cursor *m3 =
+            (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+        if (m3 == mc || !(m3->mc_flags & C_INITIALIZED))
+          continue;
+        if (m3->mc_pg[0] == mp) {
+          m3->mc_snum = 0;
+          m3->mc_top = 0;
+          m3->mc_flags &= ~C_INITIALIZED;
+        }
+      }
+      mc->mc_snum = 0;
+      mc->mc_top = 0;
+      mc->mc_flags &= ~C_INITIALIZED;
+
+      rc = page_retire(mc, mp);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    } else if (IS_BRANCH(mp) && nkeys == 1) {
+      DEBUG("%s", "collapsing root page!");
+      mc->mc_db->md_root = node_pgno(page_node(mp, 0));
+      rc = page_get(mc, mc->mc_db->md_root, &mc->mc_pg[0], mp->mp_txnid);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      mc->mc_db->md_depth--;
+      mc->mc_ki[0] = mc->mc_ki[1];
+      for (int i = 1; i < mc->mc_db->md_depth; i++) {
+        mc->mc_pg[i] = mc->mc_pg[i + 1];
+        mc->mc_ki[i] = mc->mc_ki[i + 1];
+      }
+
+      /* Adjust other cursors pointing to mp */
+      for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
+           m2 = m2->mc_next) {
+        MDBX_cursor *m3 =
+            (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+        if (m3 == mc || !(m3->mc_flags & C_INITIALIZED))
+          continue;
+        if (m3->mc_pg[0] == mp) {
+          for (int i = 0; i < mc->mc_db->md_depth; i++) {
+            m3->mc_pg[i] = m3->mc_pg[i + 1];
+            m3->mc_ki[i] = m3->mc_ki[i + 1];
+          }
+          m3->mc_snum--;
+          m3->mc_top--;
+        }
+      }
+      cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]) ||
+                      PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]) == pagetype);
+      cASSERT(mc, mc->mc_snum < mc->mc_db->md_depth ||
+                      IS_LEAF(mc->mc_pg[mc->mc_db->md_depth - 1]));
+
+      rc = page_retire(mc, mp);
+      if (likely(rc == MDBX_SUCCESS))
+        rc = page_touch(mc);
+      return rc;
+    } else {
+      DEBUG("root page %" PRIaPGNO " doesn't need rebalancing (flags 0x%x)",
+            mp->mp_pgno, mp->mp_flags);
+    }
+    return MDBX_SUCCESS;
+  }
+
+  /* The parent (branch page) must have at least 2 pointers,
+   * otherwise the tree is invalid. */
+  const size_t pre_top = mc->mc_top - 1;
+  cASSERT(mc, IS_BRANCH(mc->mc_pg[pre_top]));
+  cASSERT(mc, !IS_SUBP(mc->mc_pg[0]));
+  cASSERT(mc, page_numkeys(mc->mc_pg[pre_top]) > 1);
+
+  /* Leaf page fill factor is below the threshold.
+   * Try to move keys from left or right neighbor, or
+   * merge with a neighbor page. */
+
+  /* Find neighbors. */
+  MDBX_cursor mn;
+  cursor_copy(mc, &mn);
+
+  MDBX_page *left = nullptr, *right = nullptr;
+  if (mn.mc_ki[pre_top] > 0) {
+    rc = page_get(
+        &mn, node_pgno(page_node(mn.mc_pg[pre_top], mn.mc_ki[pre_top] - 1)),
+        &left, mc->mc_pg[mc->mc_top]->mp_txnid);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    cASSERT(mc, PAGETYPE_WHOLE(left) == PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]));
+  }
+  if (mn.mc_ki[pre_top] + (size_t)1 < page_numkeys(mn.mc_pg[pre_top])) {
+    rc = page_get(
+        &mn,
+        node_pgno(page_node(mn.mc_pg[pre_top], mn.mc_ki[pre_top] + (size_t)1)),
+        &right, mc->mc_pg[mc->mc_top]->mp_txnid);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    cASSERT(mc, PAGETYPE_WHOLE(right) == PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]));
+  }
+  cASSERT(mc, left || right);
+
+  const size_t ki_top = mc->mc_ki[mc->mc_top];
+  const size_t ki_pre_top = mn.mc_ki[pre_top];
+  const size_t nkeys = page_numkeys(mn.mc_pg[mn.mc_top]);
+
+  const size_t left_room = left ? page_room(left) : 0;
+  const size_t right_room = right ? page_room(right) : 0;
+  const size_t left_nkeys = left ? page_numkeys(left) : 0;
+  const size_t right_nkeys = right ? page_numkeys(right) : 0;
+  bool involve = false;
+retry:
+  if (left_room > room_threshold && left_room >= right_room &&
+      (IS_MODIFIABLE(mc->mc_txn, left) || involve)) {
+    /* try merge with left */
+    cASSERT(mc, left_nkeys >= minkeys);
+    mn.mc_pg[mn.mc_top] = left;
+    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top - 1);
+    mn.mc_ki[mn.mc_top] = (indx_t)(left_nkeys - 1);
+    mc->mc_ki[mc->mc_top] = 0;
+    const size_t new_ki = ki_top + left_nkeys;
+    mn.mc_ki[mn.mc_top] += mc->mc_ki[mn.mc_top] + 1;
+    /* We want rebalance to find mn when doing fixups */
+    WITH_CURSOR_TRACKING(mn, rc = page_merge(mc, &mn));
+    if (likely(rc != MDBX_RESULT_TRUE)) {
+      cursor_restore(&mn, mc);
+      mc->mc_ki[mc->mc_top] = (indx_t)new_ki;
+      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
+      return rc;
+    }
+  }
+  if (right_room > room_threshold &&
+      (IS_MODIFIABLE(mc->mc_txn, right) || involve)) {
+    /* try merge with right */
+    cASSERT(mc, right_nkeys >= minkeys);
+    mn.mc_pg[mn.mc_top] = right;
+    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top + 1);
+    mn.mc_ki[mn.mc_top] = 0;
+    mc->mc_ki[mc->mc_top] = (indx_t)nkeys;
+    WITH_CURSOR_TRACKING(mn, rc = page_merge(&mn, mc));
+    if (likely(rc != MDBX_RESULT_TRUE)) {
+      mc->mc_ki[mc->mc_top] = (indx_t)ki_top;
+      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
+      return rc;
+    }
+  }
+
+  if (left_nkeys > minkeys &&
+      (right_nkeys <= left_nkeys || right_room >= left_room) &&
+      (IS_MODIFIABLE(mc->mc_txn, left) || involve)) {
+    /* try move from left */
+    mn.mc_pg[mn.mc_top] = left;
+    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top - 1);
+    mn.mc_ki[mn.mc_top] = (indx_t)(left_nkeys - 1);
+    mc->mc_ki[mc->mc_top] = 0;
+    WITH_CURSOR_TRACKING(mn, rc = node_move(&mn, mc, true));
+    if (likely(rc != MDBX_RESULT_TRUE)) {
+      mc->mc_ki[mc->mc_top] = (indx_t)(ki_top + 1);
+      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
+      return rc;
+    }
+  }
+  if (right_nkeys > minkeys && (IS_MODIFIABLE(mc->mc_txn, right) || involve)) {
+    /* try move from right */
+    mn.mc_pg[mn.mc_top] = right;
+    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top + 1);
+    mn.mc_ki[mn.mc_top] = 0;
+    mc->mc_ki[mc->mc_top] = (indx_t)nkeys;
+    WITH_CURSOR_TRACKING(mn, rc = node_move(&mn, mc, false));
+    if (likely(rc != MDBX_RESULT_TRUE)) {
+      mc->mc_ki[mc->mc_top] = (indx_t)ki_top;
+      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
+      return rc;
+    }
+  }
+
+  if (nkeys >= minkeys) {
+    mc->mc_ki[mc->mc_top] = (indx_t)ki_top;
+    if (AUDIT_ENABLED())
+      return cursor_check_updating(mc);
+    return MDBX_SUCCESS;
+  }
+
+  if (likely(!involve)) {
+    involve = true;
+    goto retry;
+  }
+  if (likely(room_threshold > 0)) {
+    room_threshold = 0;
+    goto retry;
+  }
+  ERROR("Unable to merge/rebalance %s page %" PRIaPGNO
+        " (has %zu keys, full %.1f%%, used %zu, room %zu bytes )",
+        (pagetype & P_LEAF) ? "leaf" : "branch", tp->mp_pgno, numkeys,
+        page_fill(mc->mc_txn->mt_env, tp), page_used(mc->mc_txn->mt_env, tp),
+        room);
+  return MDBX_PROBLEM;
+}
+
+__cold static int page_check(const MDBX_cursor *const mc,
+                             const MDBX_page *const mp) {
+  DKBUF;
+  int rc = MDBX_SUCCESS;
+  if (unlikely(mp->mp_pgno < MIN_PAGENO || mp->mp_pgno > MAX_PAGENO))
+    rc = bad_page(mp, "invalid pgno (%u)\n", mp->mp_pgno);
+
+  MDBX_env *const env = mc->mc_txn->mt_env;
+  const ptrdiff_t offset = ptr_dist(mp, env->me_map);
+  unsigned flags_mask = P_ILL_BITS;
+  unsigned flags_expected = 0;
+  if (offset < 0 ||
+      offset > (ptrdiff_t)(pgno2bytes(env, mc->mc_txn->mt_next_pgno) -
+                           ((mp->mp_flags & P_SUBP) ? PAGEHDRSZ + 1
+                                                    : env->me_psize))) {
+    /* should be dirty page without MDBX_WRITEMAP, or a subpage of. */
+    flags_mask -= P_SUBP;
+    if ((env->me_flags & MDBX_WRITEMAP) != 0 ||
+        (!IS_SHADOWED(mc->mc_txn, mp) && !(mp->mp_flags & P_SUBP)))
+      rc = bad_page(mp, "invalid page-address %p, offset %zi\n",
+                    __Wpedantic_format_voidptr(mp), offset);
+  } else if (offset & (env->me_psize - 1))
+    flags_expected = P_SUBP;
+
+  if (unlikely((mp->mp_flags & flags_mask) != flags_expected))
+    rc = bad_page(mp, "unknown/extra page-flags (have 0x%x, expect 0x%x)\n",
+                  mp->mp_flags & flags_mask, flags_expected);
+
+  cASSERT(mc, (mc->mc_checking & CC_LEAF2) == 0 || (mc->mc_flags & C_SUB) != 0 ||
+                  (mc->mc_db->md_flags & MDBX_FIXEDSIZE) != 0);
+  const uint8_t type = PAGETYPE_WHOLE(mp);
+  switch (type) {
+  default:
+    return bad_page(mp, "invalid type (%u)\n", type);
+  case P_OVERFLOW:
+    if (unlikely(mc->mc_flags & C_SUB))
+      rc = bad_page(mp, "unexpected %s-page for %s (db-flags 0x%x)\n", "large",
+                    "nested dupsort tree", mc->mc_db->md_flags);
+    const pgno_t npages = mp->mp_pages;
+    if (unlikely(npages < 1 || npages >= MAX_PAGENO / 2))
+      rc = bad_page(mp, "invalid n-pages (%u) for large-page\n", npages);
+    if (unlikely(mp->mp_pgno + npages > mc->mc_txn->mt_next_pgno))
+      rc = bad_page(
+          mp, "end of large-page beyond (%u) allocated space (%u next-pgno)\n",
+          mp->mp_pgno + npages, mc->mc_txn->mt_next_pgno);
+    return rc; //-------------------------- end of large/overflow page handling
+  case P_LEAF | P_SUBP:
+    if (unlikely(mc->mc_db->md_depth != 1))
+      rc = bad_page(mp, "unexpected %s-page for %s (db-flags 0x%x)\n",
+                    "leaf-sub", "nested dupsort db", mc->mc_db->md_flags);
+    /* fall through */
+    __fallthrough;
+  case P_LEAF:
+    if (unlikely((mc->mc_checking & CC_LEAF2) != 0))
+      rc = bad_page(
+          mp, "unexpected leaf-page for dupfixed subtree (db-lags 0x%x)\n",
+          mc->mc_db->md_flags);
+    break;
+  case P_LEAF | P_LEAF2 | P_SUBP:
+    if (unlikely(mc->mc_db->md_depth != 1))
+      rc = bad_page(mp, "unexpected %s-page for %s (db-flags 0x%x)\n",
+                    "leaf2-sub", "nested dupsort db", mc->mc_db->md_flags);
+    /* fall through */
+    __fallthrough;
+  case P_LEAF | P_LEAF2:
+    if (unlikely((mc->mc_checking & CC_LEAF2) == 0))
+      rc = bad_page(
+          mp,
+          "unexpected leaf2-page for non-dupfixed (sub)tree (db-flags 0x%x)\n",
+          mc->mc_db->md_flags);
+    break;
+  case P_BRANCH:
+    break;
+  }
+
+  /* на LEAF2-страницах с элементами нечётной длины mp_upper также нечётный */
+  if (unlikely(mp->mp_upper < mp->mp_lower || (mp->mp_lower & 1) ||
+               (!IS_LEAF2(mp) && (mp->mp_upper & 1)) ||
+               PAGEHDRSZ + mp->mp_upper > env->me_psize))
+    rc = bad_page(mp, "invalid page lower(%u)/upper(%u) with limit %zu\n",
+                  mp->mp_lower, mp->mp_upper, page_space(env));
+
+  const char *const end_of_page = ptr_disp(mp, env->me_psize);
+  const size_t nkeys = page_numkeys(mp);
+  const size_t align = valign(mc->mc_db->md_flags);
+  STATIC_ASSERT(P_BRANCH == 1);
+  if (unlikely(nkeys <= (uint8_t)(mp->mp_flags & P_BRANCH))) {
+    if ((!(mc->mc_flags & C_SUB) || mc->mc_db->md_entries) &&
+        (!(mc->mc_checking & CC_UPDATING) ||
+         !(IS_MODIFIABLE(mc->mc_txn, mp) || (mp->mp_flags & P_SUBP))))
+      rc =
+          bad_page(mp, "%s-page nkeys (%zu) < %u\n",
+                   IS_BRANCH(mp) ? "branch" : "leaf", nkeys, 1 + IS_BRANCH(mp));
+  }
+  if (!IS_LEAF2(mp) && unlikely(PAGEHDRSZ + mp->mp_upper +
+                                    nkeys * sizeof(MDBX_node) + nkeys - 1 >
+                                env->me_psize))
+    rc = bad_page(mp, "invalid page upper (%u) for nkeys %zu with limit %zu\n",
+                  mp->mp_upper, nkeys, page_space(env));
+
+  const size_t ksize_max = keysize_max(env->me_psize, 0);
+  const size_t leaf2_ksize = mp->mp_leaf2_ksize;
+  /* для MDBX_FIXEDSIZE элемент содержит ключ длиной md_xsize и данные */
+  const size_t leaf2_klen = (mc->mc_db->md_flags & MDBX_FIXEDSIZE)
+                                ? mc->mc_db->md_xsize
+                                : leaf2_ksize;
+  if (IS_LEAF2(mp)) {
+    if (unlikely((mc->mc_db->md_flags & MDBX_FIXEDSIZE)
+                     ? (mc->mc_flags & C_SUB) != 0 || leaf2_klen < 1 ||
+                           leaf2_klen > leaf2_ksize
+                     : (mc->mc_flags & C_SUB) == 0 ||
+                           (mc->mc_db->md_flags & MDBX_DUPFIXED) == 0))
+      rc = bad_page(mp, "unexpected leaf2-page (db-flags 0x%x)\n",
+                    mc->mc_db->md_flags);
+    if (unlikely(leaf2_ksize < 1 || leaf2_ksize > ksize_max))
+      rc = bad_page(mp, "invalid leaf2-key length (%zu)\n", leaf2_ksize);
+  }
+
+  MDBX_val here, prev = {0, 0};
+  for (size_t i = 0; i < nkeys; ++i) {
+    if (IS_LEAF2(mp)) {
+      const char *const key = page_leaf2key(mp, i, leaf2_ksize);
+      if (unlikely(end_of_page < key + leaf2_ksize)) {
+        rc = bad_page(mp, "leaf2-key beyond (%zu) page-end\n",
+                      key + leaf2_ksize - end_of_page);
+        continue;
+      }
+
+      if (unlikely(leaf2_klen != mc->mc_dbx->md_klen_min)) {
+        if (unlikely(leaf2_klen < mc->mc_dbx->md_klen_min ||
+                     leaf2_klen > mc->mc_dbx->md_klen_max))
+          rc = bad_page(
+              mp, "leaf2-key size (%zu) <> min/max key-length (%zu/%zu)\n",
+              leaf2_klen, mc->mc_dbx->md_klen_min, mc->mc_dbx->md_klen_max);
+        else
+          mc->mc_dbx->md_klen_min = mc->mc_dbx->md_klen_max = leaf2_klen;
+      }
+      if ((mc->mc_checking & CC_SKIPORD) == 0) {
+        here.iov_base = (void *)key;
+        here.iov_len = leaf2_klen;
+        if (prev.iov_base && unlikely(mc->mc_dbx->md_cmp(&prev, &here) >= 0))
+          rc = bad_page(mp, "leaf2-key #%zu wrong order (%s >= %s)\n", i,
+                        DKEY(&prev), DVAL(&here));
+        prev = here;
+      }
+    } else {
+      const MDBX_node *const node = page_node(mp, i);
+      const char *const node_end = ptr_disp(node, NODESIZE);
+      if (unlikely(node_end > end_of_page)) {
+        rc = bad_page(mp, "node[%zu] (%zu) beyond page-end\n", i,
+                      node_end - end_of_page);
+        continue;
+      }
+      const size_t ksize = node_ks(node);
+      if (unlikely(ksize > ksize_max))
+        rc = bad_page(mp, "node[%zu] too long key (%zu)\n", i, ksize);
+      const char *const key = node_key(node);
+      if (unlikely(end_of_page < key + ksize)) {
+        rc = bad_page(mp, "node[%zu] key (%zu) beyond page-end\n", i,
+                      key + ksize - end_of_page);
+        continue;
+      }
+      if ((IS_LEAF(mp) || i > 0)) {
+        if (unlikely(ksize < mc->mc_dbx->md_klen_min ||
+                     ksize > mc->mc_dbx->md_klen_max))
+          rc = bad_page(
+              mp, "node[%zu] key size (%zu) <> min/max key-length (%zu/%zu)\n",
+              i, ksize, mc->mc_dbx->md_klen_min, mc->mc_dbx->md_klen_max);
+        if ((mc->mc_checking & CC_SKIPORD) == 0) {
+          here.iov_base = (void *)key;
+          here.iov_len = ksize;
+          if (prev.iov_base && unlikely(mc->mc_dbx->md_cmp(&prev, &here) >= 0))
+            rc = bad_page(mp, "node[%zu] key wrong order (%s >= %s)\n", i,
+                          DKEY(&prev), DVAL(&here));
+          prev = here;
+        }
+      }
+      if (IS_BRANCH(mp)) {
+        if ((mc->mc_checking & CC_UPDATING) == 0 && i == 0 &&
+            unlikely(ksize != 0))
+          rc = bad_page(mp, "branch-node[%zu] wrong 0-node key-length (%zu)\n",
+                        i, ksize);
+        const pgno_t ref = node_pgno(node);
+        if (unlikely(ref < MIN_PAGENO) ||
+            (unlikely(ref >= mc->mc_txn->mt_next_pgno) &&
+             (unlikely(ref >= mc->mc_txn->mt_geo.now) ||
+              !(mc->mc_checking & CC_RETIRING))))
+          rc = bad_page(mp, "branch-node[%zu] wrong pgno (%u)\n", i, ref);
+        if (unlikely(node_flags(node)))
+          rc = bad_page(mp, "branch-node[%zu] wrong flags (%u)\n", i,
+                        node_flags(node));
+        continue;
+      }
+
+      switch (node_flags(node)) {
+      default:
+        rc =
+            bad_page(mp, "invalid node[%zu] flags (%u)\n", i, node_flags(node));
+        break;
+      case F_BIGDATA /* data on large-page */:
+      case F_BIGDATA | F_COMPRESSED /* packed data on large-page */:
+      case 0 /* usual */:
+      case F_COMPRESSED /* packed data */:
+      case F_SUBDATA /* sub-db */:
+      case F_SUBDATA | F_DUPDATA /* dupsorted sub-tree */:
+      case F_DUPDATA /* short sub-page */:
+        break;
+      }
+
+      const size_t dsize = node_ds(node);
+      const char *const data = node_data(node);
+      if (unlikely(align)) {
+        if (unlikely(ptr_dist(node, mp) % align ||
+                     (!(node_flags(node) & F_BIGDATA) &&
+                      ptr_dist(data, mp) % align)))
+          rc = bad_page(mp, "node[%zu] misaligned for %zu-aligned values\n",
+                        i, align);
+      } else if (unlikely(UNALIGNED_PEEK_8(node, MDBX_node, mn_extra)))
+        rc = bad_page(mp, "node[%zu] unexpected key padding (%u)\n", i,
+                      UNALIGNED_PEEK_8(node, MDBX_node, mn_extra));
+      if (node_flags(node) & F_BIGDATA) {
+        if (unlikely(end_of_page < data + sizeof(pgno_t))) {
+          rc = bad_page(
+              mp, "node-%s(%zu of %zu, %zu bytes) beyond (%zu) page-end\n",
+              "bigdata-pgno", i, nkeys, dsize, data + dsize - end_of_page);
+          continue;
+        }
+        if (unlikely(dsize <= mc->mc_dbx->md_vlen_min ||
+                     dsize > mc->mc_dbx->md_vlen_max))
+          rc = bad_page(
+              mp,
+              "big-node data size (%zu) <> min/max value-length (%zu/%zu)\n",
+              dsize, mc->mc_dbx->md_vlen_min, mc->mc_dbx->md_vlen_max);
+        if (unlikely(leaf_node_size(node_ks(node), dsize, align) <=
+                     mc->mc_txn->mt_env->me_leaf_nodemax) &&
+            mc->mc_dbi != FREE_DBI)
+          poor_page(mp, "too small data (%zu bytes) for bigdata-node", dsize);
+
+        if ((mc->mc_checking & CC_RETIRING) == 0) {
+          const pgr_t lp =
+              page_get_large(mc, node_largedata_pgno(node), mp->mp_txnid);
+          if (unlikely(lp.err != MDBX_SUCCESS))
+            return lp.err;
+          cASSERT(mc, PAGETYPE_WHOLE(lp.page) == P_OVERFLOW);
+          const unsigned npages = largedata_npages(env, dsize, align);
+          if (unlikely(lp.page->mp_pages != npages)) {
+            if (lp.page->mp_pages < npages)
+              rc = bad_page(lp.page,
+                            "too less n-pages %u for bigdata-node (%zu bytes)",
+                            lp.page->mp_pages, dsize);
+            else if (mc->mc_dbi != FREE_DBI)
+              poor_page(lp.page,
+                        "extra n-pages %u for bigdata-node (%zu bytes)",
+                        lp.page->mp_pages, dsize);
+          }
+        }
+        continue;
+      }
+
+      if (unlikely(end_of_page < data + dsize)) {
+        rc = bad_page(mp,
+                      "node-%s(%zu of %zu, %zu bytes) beyond (%zu) page-end\n",
+                      "data", i, nkeys, dsize, data + dsize - end_of_page);
+        continue;
+      }
+
+      switch (node_flags(node)) {
+      default:
+        /* wrong, but already handled */
+        continue;
+      case 0 /* usual */:
+        if (unlikely(dsize < mc->mc_dbx->md_vlen_min ||
+                     dsize > mc->mc_dbx->md_vlen_max)) {
+          rc = bad_page(
+              mp, "node-data size (%zu) <> min/max value-length (%zu/%zu)\n",
+              dsize, mc->mc_dbx->md_vlen_min, mc->mc_dbx->md_vlen_max);
+          continue;
+        }
+        break;
+      case F_SUBDATA /* sub-db */:
+        if (unlikely(dsize != sizeof(MDBX_db))) {
+          rc = bad_page(mp, "invalid sub-db record size (%zu)\n", dsize);
+          continue;
+        }
+        break;
+      case F_SUBDATA | F_DUPDATA /* dupsorted sub-tree */:
+        if (unlikely(dsize != sizeof(MDBX_db))) {
+          rc = bad_page(mp, "invalid nested-db record size (%zu)\n", dsize);
+          continue;
+        }
+        break;
+      case F_DUPDATA /* short sub-page */:
+        if (unlikely(dsize <= PAGEHDRSZ)) {
+          rc = bad_page(mp, "invalid nested/sub-page record size (%zu)\n",
+                        dsize);
+          continue;
+        } else {
+          const MDBX_page *const sp = (MDBX_page *)data;
+          switch (sp->mp_flags &
+                  /* ignore legacy P_DIRTY flag */ ~P_LEGACY_DIRTY) {
+          case P_LEAF | P_SUBP:
+          case P_LEAF | P_LEAF2 | P_SUBP:
+            break;
+          default:
+            rc = bad_page(mp, "invalid nested/sub-page flags (0x%02x)\n",
+                          sp->mp_flags);
+            continue;
+          }
+
+          const char *const end_of_subpage = data + dsize;
+          const intptr_t nsubkeys = page_numkeys(sp);
+          if (unlikely(nsubkeys == 0) && !(mc->mc_checking & CC_UPDATING) &&
+              mc->mc_db->md_entries)
+            rc = bad_page(mp, "no keys on a %s-page\n",
+                          IS_LEAF2(sp) ? "leaf2-sub" : "leaf-sub");
+
+          MDBX_val sub_here, sub_prev = {0, 0};
+          for (int j = 0; j < nsubkeys; j++) {
+            if (IS_LEAF2(sp)) {
+              /* LEAF2 pages have no mp_ptrs[] or node headers */
+              const size_t sub_ksize = sp->mp_leaf2_ksize;
+              const char *const sub_key = page_leaf2key(sp, j, sub_ksize);
+              if (unlikely(end_of_subpage < sub_key + sub_ksize)) {
+                rc = bad_page(mp, "nested-leaf2-key beyond (%zu) nested-page\n",
+                              sub_key + sub_ksize - end_of_subpage);
+                continue;
+              }
+
+              if (unlikely(sub_ksize != mc->mc_dbx->md_vlen_min)) {
+                if (unlikely(sub_ksize < mc->mc_dbx->md_vlen_min ||
+                             sub_ksize > mc->mc_dbx->md_vlen_max))
+                  rc = bad_page(mp,
+                                "nested-leaf2-key size (%zu) <> min/max "
+                                "value-length (%zu/%zu)\n",
+                                sub_ksize, mc->mc_dbx->md_vlen_min,
+                                mc->mc_dbx->md_vlen_max);
+                else
+                  mc->mc_dbx->md_vlen_min = mc->mc_dbx->md_vlen_max = sub_ksize;
+              }
+              if ((mc->mc_checking & CC_SKIPORD) == 0) {
+                sub_here.iov_base = (void *)sub_key;
+                sub_here.iov_len = sub_ksize;
+                if (sub_prev.iov_base &&
+                    unlikely(mc->mc_dbx->md_dcmp(&sub_prev, &sub_here) >= 0))
+                  rc = bad_page(mp,
+                                "nested-leaf2-key #%u wrong order (%s >= %s)\n",
+                                j, DKEY(&sub_prev), DVAL(&sub_here));
+                sub_prev = sub_here;
+              }
+            } else {
+              const MDBX_node *const sub_node = page_node(sp, j);
+              const char *const sub_node_end = ptr_disp(sub_node, NODESIZE);
+              if (unlikely(sub_node_end > end_of_subpage)) {
+                rc = bad_page(mp, "nested-node beyond (%zu) nested-page\n",
+                              end_of_subpage - sub_node_end);
+                continue;
+              }
+              if (unlikely(node_flags(sub_node) != 0))
+                rc = bad_page(mp, "nested-node invalid flags (%u)\n",
+                              node_flags(sub_node));
+
+              const size_t sub_ksize = node_ks(sub_node);
+              const char *const sub_key = node_key(sub_node);
+              const size_t sub_dsize = node_ds(sub_node);
+              /* char *sub_data = node_data(sub_node); */
+
+              if (unlikely(sub_ksize < mc->mc_dbx->md_vlen_min ||
+                           sub_ksize > mc->mc_dbx->md_vlen_max))
+                rc = bad_page(mp,
+                              "nested-node-key size (%zu) <> min/max "
+                              "value-length (%zu/%zu)\n",
+                              sub_ksize, mc->mc_dbx->md_vlen_min,
+                              mc->mc_dbx->md_vlen_max);
+              if ((mc->mc_checking & CC_SKIPORD) == 0) {
+                sub_here.iov_base = (void *)sub_key;
+                sub_here.iov_len = sub_ksize;
+                if (sub_prev.iov_base &&
+                    unlikely(mc->mc_dbx->md_dcmp(&sub_prev, &sub_here) >= 0))
+                  rc = bad_page(mp,
+                                "nested-node-key #%u wrong order (%s >= %s)\n",
+                                j, DKEY(&sub_prev), DVAL(&sub_here));
+                sub_prev = sub_here;
+              }
+              if (unlikely(sub_dsize != 0))
+                rc = bad_page(mp, "nested-node non-empty data size (%zu)\n",
+                              sub_dsize);
+              if (unlikely(end_of_subpage < sub_key + sub_ksize))
+                rc = bad_page(mp, "nested-node-key beyond (%zu) nested-page\n",
+                              sub_key + sub_ksize - end_of_subpage);
+            }
+          }
+        }
+        break;
+      }
+    }
+  }
+  return rc;
+}
+
+__cold static int cursor_check(const MDBX_cursor *mc) {
+  if (!mc->mc_txn->tw.dirtylist) {
+    cASSERT(mc,
+            (mc->mc_txn->mt_flags & MDBX_WRITEMAP) != 0 && !MDBX_AVOID_MSYNC);
+  } else {
+    cASSERT(mc,
+            (mc->mc_txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
+    cASSERT(mc, mc->mc_txn->tw.dirtyroom + mc->mc_txn->tw.dirtylist->length ==
+                    (mc->mc_txn->mt_parent
+                         ? mc->mc_txn->mt_parent->tw.dirtyroom
+                         : mc->mc_txn->mt_env->me_options.dp_limit));
+  }
+  cASSERT(mc, mc->mc_top == mc->mc_snum - 1 || (mc->mc_checking & CC_UPDATING));
+  if (unlikely(mc->mc_top != mc->mc_snum - 1) &&
+      (mc->mc_checking & CC_UPDATING) == 0)
+    return MDBX_CURSOR_FULL;
+  cASSERT(mc, (mc->mc_checking & CC_UPDATING)
+                  ? mc->mc_snum <= mc->mc_db->md_depth
+                  : mc->mc_snum == mc->mc_db->md_depth);
+  if (unlikely((mc->mc_checking & CC_UPDATING)
+                   ? mc->mc_snum > mc->mc_db->md_depth
+                   : mc->mc_snum != mc->mc_db->md_depth))
+    return MDBX_CURSOR_FULL;
+
+  for (int n = 0; n < (int)mc->mc_snum; ++n) {
+    MDBX_page *mp = mc->mc_pg[n];
+    const size_t nkeys = page_numkeys(mp);
+    const bool expect_branch = (n < mc->mc_db->md_depth - 1) ? true : false;
+    const bool expect_nested_leaf =
+        (n + 1 == mc->mc_db->md_depth - 1) ? true : false;
+    const bool branch = IS_BRANCH(mp) ? true : false;
+    cASSERT(mc, branch == expect_branch);
+    if (unlikely(branch != expect_branch))
+      return MDBX_CURSOR_FULL;
+    if ((mc->mc_checking & CC_UPDATING) == 0) {
+      cASSERT(mc, nkeys > mc->mc_ki[n] || (!branch && nkeys == mc->mc_ki[n] &&
+                                           (mc->mc_flags & C_EOF) != 0));
+      if (unlikely(nkeys <= mc->mc_ki[n] &&
+                   !(!branch && nkeys == mc->mc_ki[n] &&
+                     (mc->mc_flags & C_EOF) != 0)))
+        return MDBX_CURSOR_FULL;
+    } else {
+      cASSERT(mc, nkeys + 1 >= mc->mc_ki[n]);
+      if (unlikely(nkeys + 1 < mc->mc_ki[n]))
+        return MDBX_CURSOR_FULL;
+    }
+
+    int err = page_check(mc, mp);
+    if (unlikely(err != MDBX_SUCCESS))
+      return err;
+
+    for (size_t i = 0; i < nkeys; ++i) {
+      if (branch) {
+        MDBX_node *node = page_node(mp, i);
+        cASSERT(mc, node_flags(node) == 0);
+        if (unlikely(node_flags(node) != 0))
+          return MDBX_CURSOR_FULL;
+        pgno_t pgno = node_pgno(node);
+        MDBX_page *np;
+        err = page_get(mc, pgno, &np, mp->mp_txnid);
+        cASSERT(mc, err == MDBX_SUCCESS);
+        if (unlikely(err != MDBX_SUCCESS))
+          return err;
+        const bool nested_leaf = IS_LEAF(np) ? true : false;
+        cASSERT(mc, nested_leaf == expect_nested_leaf);
+        if (unlikely(nested_leaf != expect_nested_leaf))
+          return MDBX_CURSOR_FULL;
+        err = page_check(mc, np);
+        if (unlikely(err != MDBX_SUCCESS))
+          return err;
+      }
+    }
+  }
+  return MDBX_SUCCESS;
+}
+
+__cold static int cursor_check_updating(MDBX_cursor *mc) {
+  const uint8_t checking = mc->mc_checking;
+  mc->mc_checking |= CC_UPDATING;
+  const int rc = cursor_check(mc);
+  mc->mc_checking = checking;
+  return rc;
+}
+
+int mdbx_del(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+             const MDBX_val *data) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!key))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(txn->mt_flags &
+               (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN | MDBX_TXN_BLOCKED))) {
+    if (txn->mt_flags & MDBX_TXN_OPTIMISTIC)
+      return optimistic_del(txn, dbi, key, data);
+    return (txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN))
+               ? MDBX_EACCESS
+               : MDBX_BAD_TXN;
+  }
+
+  return delete (txn, dbi, key, data, 0);
+}
+
+static int delete(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                  const MDBX_val *data, unsigned flags) {
+  MDBX_cursor_couple cx;
+  MDBX_cursor_op op;
+  MDBX_val rdata;
+  int rc;
+  DKBUF_DEBUG;
+
+  DEBUG("====> delete db %u key [%s], data [%s]", dbi, DKEY_DEBUG(key),
+        DVAL_DEBUG(data));
+
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (data) {
+    op = MDBX_GET_BOTH;
+    rdata = *data;
+    data = &rdata;
+  } else {
+    op = MDBX_SET;
+    flags |= MDBX_ALLDUPS;
+  }
+  rc = cursor_set(&cx.outer, (MDBX_val *)key, (MDBX_val *)data, op).err;
+  if (likely(rc == MDBX_SUCCESS)) {
+    /* let mdbx_page_split know about this cursor if needed:
+     * delete will trigger a rebalance; if it needs to move
+     * a node from one page to another, it will have to
+     * update the parent's separator key(s). If the new sepkey
+     * is larger than the current one, the parent page may
+     * run out of space, triggering a split. We need this
+     * cursor to be consistent until the end of the rebalance. */
+    cx.outer.mc_next = txn->mt_cursors[dbi];
+    txn->mt_cursors[dbi] = &cx.outer;
+    rc = cursor_del(&cx.outer, flags);
+    txn->mt_cursors[dbi] = cx.outer.mc_next;
+  }
+  return rc;
+}
+
+/* Split a page and insert a new node.
+ * Set MDBX_TXN_ERROR on failure.
+ * [in,out] mc Cursor pointing to the page and desired insertion index.
+ * The cursor will be updated to point to the actual page and index where
+ * the node got inserted after the split.
+ * [in] newkey The key for the newly inserted node.
+ * [in] newdata The data for the newly inserted node.
+ * [in] newpgno The page number, if the new node is a branch node.
+ * [in] naf The NODE_ADD_FLAGS for the new node.
+ * Returns 0 on success, non-zero on failure. */
+static int page_split(MDBX_cursor *mc, const MDBX_val *const newkey,
+                      MDBX_val *const newdata, pgno_t newpgno,
+                      const unsigned naf) {
+  unsigned flags;
+  int rc = MDBX_SUCCESS, foliage = 0;
+  size_t i, ptop;
+  MDBX_env *const env = mc->mc_txn->mt_env;
+  MDBX_val rkey, xdata;
+  MDBX_page *tmp_ki_copy = NULL;
+  DKBUF;
+
+  MDBX_page *const mp = mc->mc_pg[mc->mc_top];
+  const size_t newindx = mc->mc_ki[mc->mc_top];
+  size_t nkeys = page_numkeys(mp);
+  if (AUDIT_ENABLED()) {
+    rc = cursor_check_updating(mc);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+  STATIC_ASSERT(P_BRANCH == 1);
+  const size_t minkeys = (mp->mp_flags & P_BRANCH) + (size_t)1;
+
+  DEBUG(">> splitting %s-page %" PRIaPGNO
+        " and adding %zu+%zu [%s] at %i, nkeys %zi",
+        IS_LEAF(mp) ? "leaf" : "branch", mp->mp_pgno, newkey->iov_len,
+        newdata ? newdata->iov_len : 0, DKEY_DEBUG(newkey),
+        mc->mc_ki[mc->mc_top], nkeys);
+  cASSERT(mc, nkeys + 1 >= minkeys * 2);
+
+  /* Create a new sibling page. */
+  pgr_t npr = page_new(mc, mp->mp_flags);
+  if (unlikely(npr.err != MDBX_SUCCESS))
+    return npr.err;
+  MDBX_page *const sister = npr.page;
+  sister->mp_leaf2_ksize = mp->mp_leaf2_ksize;
+  DEBUG("new sibling: page %" PRIaPGNO, sister->mp_pgno);
+
+  /* Usually when splitting the root page, the cursor
+   * height is 1. But when called from update_key,
+   * the cursor height may be greater because it walks
+   * up the stack while finding the branch slot to update. */
+  if (mc->mc_top < 1) {
+    npr = page_new(mc, P_BRANCH);
+    rc = npr.err;
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto done;
+    MDBX_page *const pp = npr.page;
+    /* shift current top to make room for new parent */
+    cASSERT(mc, mc->mc_snum < 2 && mc->mc_db->md_depth > 0);
+#if MDBX_DEBUG
+    memset(mc->mc_pg + 3, 0, sizeof(mc->mc_pg) - sizeof(mc->mc_pg[0]) * 3);
+    memset(mc->mc_ki + 3, -1, sizeof(mc->mc_ki) - sizeof(mc->mc_ki[0]) * 3);
+#endif
+    mc->mc_pg[2] = mc->mc_pg[1];
+    mc->mc_ki[2] = mc->mc_ki[1];
+    mc->mc_pg[1] = mc->mc_pg[0];
+    mc->mc_ki[1] = mc->mc_ki[0];
+    mc->mc_pg[0] = pp;
+    mc->mc_ki[0] = 0;
+    mc->mc_db->md_root = pp->mp_pgno;
+    DEBUG("root split! new root = %" PRIaPGNO, pp->mp_pgno);
+    foliage = mc->mc_db->md_depth++;
+
+    /* Add left (implicit) pointer. */
+    rc = node_add_branch(mc, 0, NULL, mp->mp_pgno);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      /* undo the pre-push */
+      mc->mc_pg[0] = mc->mc_pg[1];
+      mc->mc_ki[0] = mc->mc_ki[1];
+      mc->mc_db->md_root = mp->mp_pgno;
+      mc->mc_db->md_depth--;
+      goto done;
+    }
+    mc->mc_snum++;
+    mc->mc_top++;
+    ptop = 0;
+    if (AUDIT_ENABLED()) {
+      rc = cursor_check_updating(mc);
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto done;
+    }
+  } else {
+    ptop = mc->mc_top - 1;
+    DEBUG("parent branch page is %" PRIaPGNO, mc->mc_pg[ptop]->mp_pgno);
+  }
+
+  MDBX_cursor mn;
+  cursor_copy(mc, &mn);
+  mn.mc_pg[mn.mc_top] = sister;
+  mn.mc_ki[mn.mc_top] = 0;
+  mn.mc_ki[ptop] = mc->mc_ki[ptop] + 1;
+
+  size_t split_indx =
+      (newindx < nkeys)
+          ? /* split at the middle */ (nkeys + 1) >> 1
+          : /* split at the end (i.e. like append-mode ) */ nkeys - minkeys + 1;
+  if (IS_LEAF(mp) && !(naf & MDBX_SPLIT_REPLACE)) {
+    /* Выбор точки разделения по истории недавних вставок в страницу:
+     *  - если вставки идут подряд одна за другой в середину страницы, т.е.
+     *    перед "холодным" хвостом ранее добавленных ключей, то в новую
+     *    страницу переносим только этот хвост, а оставшаяся будет
+     *    дозаполняться продолжающимися вставками;
+     *  - если все недавние вставки пришлись на правую половину страницы, то
+     *    вероятно это возрастающие ключи с небольшим беспорядком, либо
+     *    несколько чередующихся возрастающих последовательностей. Тогда делим
+     *    страницу по началу этой "горячей" области, оставляя левую страницу
+     *    заполненной, а не наполовину пустой. Это же делается и при вставке
+     *    в конец страницы, если недавние вставки были не только в конец, так
+     *    как иначе запоздавшие ключи придется вставлять в заполненную
+     *    страницу. */
+    const split_hint_t *const hint =
+        mc->mc_dbx->md_split_hints
+            ? &mc->mc_dbx->md_split_hints[mp->mp_pgno % SPLIT_HINT_SLOTS]
+            : nullptr;
+    if (hint && hint->pgno == mp->mp_pgno && hint->count >= SPLIT_HINT_DEPTH &&
+        (newindx < nkeys || hint->appends < SPLIT_HINT_DEPTH)) {
+      size_t hot = newindx, last = 0;
+      for (i = 0; i < SPLIT_HINT_DEPTH; ++i) {
+        hot = (hint->pos[i] < hot) ? hint->pos[i] : hot;
+        last = (hint->pos[i] > last) ? hint->pos[i] : last;
+      }
+      if (newindx + 1 < nkeys && last < newindx &&
+          hint->pos[0] + (size_t)1 == newindx) {
+        TRACE("split the cold tail at %zu instead of %zu", newindx + 1,
+              split_indx);
+        split_indx = newindx + 1;
+      } else if (hot > (nkeys + 1) >> 1 && hot != split_indx) {
+        TRACE("split the hot area at %zu instead of %zu", hot, split_indx);
+        split_indx = hot;
+      }
+    }
+  }
+  eASSERT(env, split_indx >= minkeys && split_indx <= nkeys - minkeys + 1);
+
+  cASSERT(mc, !IS_BRANCH(mp) || newindx > 0);
+  MDBX_val sepkey = {nullptr, 0};
+  /* It is reasonable and possible to split the page at the begin */
+  if (unlikely(newindx < minkeys)) {
+    split_indx = minkeys;
+    if (newindx == 0 && foliage == 0 && !(naf & MDBX_SPLIT_REPLACE)) {
+      split_indx = 0;
+      /* Checking for ability of splitting by the left-side insertion
+       * of a pure page with the new key */
+      for (i = 0; i < mc->mc_top; ++i)
+        if (mc->mc_ki[i]) {
+          get_key(page_node(mc->mc_pg[i], mc->mc_ki[i]), &sepkey);
+          if (mc->mc_dbx->md_cmp(newkey, &sepkey) >= 0)
+            split_indx = minkeys;
+          break;
+        }
+      if (split_indx == 0) {
+        /* Save the current first key which was omitted on the parent branch
+         * page and should be updated if the new first entry will be added */
+        if (IS_LEAF2(mp)) {
+          sepkey.iov_len = mc->mc_db->md_xsize;
+          sepkey.iov_base = page_leaf2key(mp, 0, sepkey.iov_len);
+        } else
+          get_key(page_node(mp, 0), &sepkey);
+        cASSERT(mc, mc->mc_dbx->md_cmp(newkey, &sepkey) < 0);
+        /* Avoiding rare complex cases of split the parent page */
+        if (page_room(mn.mc_pg[ptop]) < branch_size(env, &sepkey))
+          split_indx = minkeys;
+      }
+    }
+  }
+
+  const bool pure_right = split_indx == nkeys;
+  const bool pure_left = split_indx == 0;
+  if (unlikely(pure_right)) {
+    /* newindx == split_indx == nkeys */
+    TRACE("no-split, but add new pure page at the %s", "right/after");
+    cASSERT(mc, newindx == nkeys && split_indx == nkeys && minkeys == 1);
+    sepkey = *newkey;
+  } else if (unlikely(pure_left)) {
+    /* newindx == split_indx == 0 */
+    TRACE("no-split, but add new pure page at the %s", "left/before");
+    cASSERT(mc, newindx == 0 && split_indx == 0 && minkeys == 1);
+    TRACE("old-first-key is %s", DKEY_DEBUG(&sepkey));
+  } else {
+    if (IS_LEAF2(sister)) {
+      /* Move half of the keys to the right sibling */
+      const intptr_t distance = mc->mc_ki[mc->mc_top] - split_indx;
+      size_t ksize = mp->mp_leaf2_ksize;
+      void *const split = page_leaf2key(mp, split_indx, ksize);
+      size_t rsize = (nkeys - split_indx) * ksize;
+      size_t lsize = (nkeys - split_indx) * sizeof(indx_t);
+      cASSERT(mc, mp->mp_lower >= lsize);
+      mp->mp_lower -= (indx_t)lsize;
+      cASSERT(mc, sister->mp_lower + lsize <= UINT16_MAX);
+      sister->mp_lower += (indx_t)lsize;
+      cASSERT(mc, mp->mp_upper + rsize - lsize <= UINT16_MAX);
+      mp->mp_upper += (indx_t)(rsize - lsize);
+      cASSERT(mc, sister->mp_upper >= rsize - lsize);
+      sister->mp_upper -= (indx_t)(rsize - lsize);
+      sepkey.iov_len = mc->mc_db->md_xsize;
+      sepkey.iov_base = (newindx != split_indx) ? split : newkey->iov_base;
+      if (distance < 0) {
+        cASSERT(mc, ksize > 0);
+        void *const ins = page_leaf2key(mp, mc->mc_ki[mc->mc_top], ksize);
+        memcpy(sister->mp_ptrs, split, rsize);
+        sepkey.iov_base = sister->mp_ptrs;
+        memmove(ptr_disp(ins, ksize), ins,
+                (split_indx - mc->mc_ki[mc->mc_top]) * ksize);
+        leaf2_fill(ins, newkey, newdata, naf);
+        cASSERT(mc, UINT16_MAX - mp->mp_lower >= (int)sizeof(indx_t));
+        mp->mp_lower += sizeof(indx_t);
+        cASSERT(mc, mp->mp_upper + sizeof(indx_t) >= ksize);
+        mp->mp_upper -= (indx_t)(ksize - sizeof(indx_t));
+      } else {
+        memcpy(sister->mp_ptrs, split, distance * ksize);
+        void *const ins = page_leaf2key(sister, distance, ksize);
+        leaf2_fill(ins, newkey, newdata, naf);
+        memcpy(ptr_disp(ins, ksize), ptr_disp(split, distance * ksize),
+               rsize - distance * ksize);
+        cASSERT(mc, UINT16_MAX - sister->mp_lower >= (int)sizeof(indx_t));
+        sister->mp_lower += sizeof(indx_t);
+        cASSERT(mc, sister->mp_upper + sizeof(indx_t) >= ksize);
+        sister->mp_upper -= (indx_t)(ksize - sizeof(indx_t));
+        cASSERT(mc, distance <= (int)UINT16_MAX);
+        mc->mc_ki[mc->mc_top] = (indx_t)distance;
+      }
+
+      if (AUDIT_ENABLED()) {
+        rc = cursor_check_updating(mc);
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto done;
+        rc = cursor_check_updating(&mn);
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto done;
+      }
+    } else {
+      /* grab a page to hold a temporary copy */
+      tmp_ki_copy = page_malloc(mc->mc_txn, 1);
+      if (unlikely(tmp_ki_copy == NULL)) {
+        rc = MDBX_ENOMEM;
+        goto done;
+      }
+
+      const size_t max_space = page_space(env);
+      const size_t align = valign(mc->mc_db->md_flags);
+      const size_t new_size = IS_LEAF(mp)
+                                  ? leaf_size(env, newkey, newdata, align)
+                                  : branch_size(env, newkey);
+
+      /* prepare to insert */
+      for (i = 0; i < newindx; ++i)
+        tmp_ki_copy->mp_ptrs[i] = mp->mp_ptrs[i];
+      tmp_ki_copy->mp_ptrs[i] = (indx_t)-1;
+      while (++i <= nkeys)
+        tmp_ki_copy->mp_ptrs[i] = mp->mp_ptrs[i - 1];
+      tmp_ki_copy->mp_pgno = mp->mp_pgno;
+      tmp_ki_copy->mp_flags = mp->mp_flags;
+      tmp_ki_copy->mp_txnid = INVALID_TXNID;
+      tmp_ki_copy->mp_lower = 0;
+      tmp_ki_copy->mp_upper = (indx_t)max_space;
+
+      /* Добавляемый узел может не поместиться в страницу-половину вместе
+       * с количественной половиной узлов из исходной страницы. В худшем случае,
+       * в страницу-половину с добавляемым узлом могут попасть самые больше узлы
+       * из исходной страницы, а другую половину только узлы с самыми короткими
+       * ключами и с пустыми данными. Поэтому, чтобы найти подходящую границу
+       * разреза требуется итерировать узлы и считая их объем.
+       *
+       * Однако, при простом количественном делении (без учета размера ключей
+       * и данных) на страницах-половинах будет примерно вдвое меньше узлов.
+       * Поэтому добавляемый узел точно поместится, если его размер не больше
+       * чем место "освобождающееся" от заголовков узлов, которые переедут
+       * в другую страницу-половину. Кроме этого, как минимум по одному байту
+       * будет в каждом ключе, в худшем случае кроме одного, который может быть
+       * нулевого размера. */
+
+      if (newindx == split_indx && nkeys >= 5) {
+        STATIC_ASSERT(P_BRANCH == 1);
+        split_indx += mp->mp_flags & P_BRANCH;
+      }
+      eASSERT(env, split_indx >= minkeys && split_indx <= nkeys + 1 - minkeys);
+      const size_t dim_nodes =
+          (newindx >= split_indx) ? split_indx : nkeys - split_indx;
+      const size_t dim_used = (sizeof(indx_t) + NODESIZE + 1) * dim_nodes;
+      if (new_size >= dim_used) {
+        /* Search for best acceptable split point */
+        i = (newindx < split_indx) ? 0 : nkeys;
+        intptr_t dir = (newindx < split_indx) ? 1 : -1;
+        size_t before = 0, after = new_size + page_used(env, mp);
+        size_t best_split = split_indx;
+        size_t best_shift = INT_MAX;
+
+        TRACE("seek separator from %zu, step %zi, default %zu, new-idx %zu, "
+              "new-size %zu",
+              i, dir, split_indx, newindx, new_size);
+        do {
+          cASSERT(mc, i <= nkeys);
+          size_t size = new_size;
+          if (i != newindx) {
+            MDBX_node *node = ptr_disp(mp, tmp_ki_copy->mp_ptrs[i] + PAGEHDRSZ);
+            size = (IS_LEAF(mp) ? leaf_node_bytes(node, align)
+                                : EVEN(NODESIZE + node_ks(node))) +
+                   sizeof(indx_t);
+          }
+
+          before += size;
+          after -= size;
+          TRACE("step %zu, size %zu, before %zu, after %zu, max %zu", i, size,
+                before, after, max_space);
+
+          if (before <= max_space && after <= max_space) {
+            const size_t split = i + (dir > 0);
+            if (split >= minkeys && split <= nkeys + 1 - minkeys) {
+              const size_t shift = branchless_abs(split_indx - split);
+              if (shift >= best_shift)
+                break;
+              best_shift = shift;
+              best_split = split;
+              if (!best_shift)
+                break;
+            }
+          }
+          i += dir;
+        } while (i < nkeys);
+
+        split_indx = best_split;
+        TRACE("chosen %zu", split_indx);
+      }
+      eASSERT(env, split_indx >= minkeys && split_indx <= nkeys + 1 - minkeys);
+
+      sepkey = *newkey;
+      if (split_indx != newindx) {
+        MDBX_node *node =
+            ptr_disp(mp, tmp_ki_copy->mp_ptrs[split_indx] + PAGEHDRSZ);
+        sepkey.iov_len = node_ks(node);
+        sepkey.iov_base = node_key(node);
+      }
+    }
+  }
+  DEBUG("separator is %zd [%s]", split_indx, DKEY_DEBUG(&sepkey));
+
+  bool did_split_parent = false;
+  /* Copy separator key to the parent. */
+  if (page_room(mn.mc_pg[ptop]) < branch_size(env, &sepkey)) {
+    TRACE("need split parent branch-page for key %s", DKEY_DEBUG(&sepkey));
+    cASSERT(mc, page_numkeys(mn.mc_pg[ptop]) > 2);
+    cASSERT(mc, !pure_left);
+    const int snum = mc->mc_snum;
+    const int depth = mc->mc_db->md_depth;
+    mn.mc_snum--;
+    mn.mc_top--;
+    did_split_parent = true;
+    /* We want other splits to find mn when doing fixups */
+    WITH_CURSOR_TRACKING(
+        mn, rc = page_split(&mn, &sepkey, NULL, sister->mp_pgno, 0));
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto done;
+    cASSERT(mc, (int)mc->mc_snum - snum == mc->mc_db->md_depth - depth);
+    if (AUDIT_ENABLED()) {
+      rc = cursor_check_updating(mc);
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto done;
+    }
+
+    /* root split? */
+    ptop += mc->mc_snum - (size_t)snum;
+
+    /* Right page might now have changed parent.
+     * Check if left page also changed parent. */
+    if (mn.mc_pg[ptop] != mc->mc_pg[ptop] &&
+        mc->mc_ki[ptop] >= page_numkeys(mc->mc_pg[ptop])) {
+      for (i = 0; i < ptop; i++) {
+        mc->mc_pg[i] = mn.mc_pg[i];
+        mc->mc_ki[i] = mn.mc_ki[i];
+      }
+      mc->mc_pg[ptop] = mn.mc_pg[ptop];
+      if (mn.mc_ki[ptop]) {
+        mc->mc_ki[ptop] = mn.mc_ki[ptop] - 1;
+      } else {
+        /* find right page's left sibling */
+        mc->mc_ki[ptop] = mn.mc_ki[ptop];
+        rc = cursor_sibling(mc, SIBLING_LEFT);
+        if (unlikely(rc != MDBX_SUCCESS)) {
+          if (rc == MDBX_NOTFOUND) /* improper mdbx_cursor_sibling() result */ {
+            ERROR("unexpected %i error going left sibling", rc);
+            rc = MDBX_PROBLEM;
+          }
+          goto done;
+        }
+      }
+    }
+  } else if (unlikely(pure_left)) {
+    MDBX_page *ptop_page = mc->mc_pg[ptop];
+    DEBUG("adding to parent page %u node[%u] left-leaf page #%u key %s",
+          ptop_page->mp_pgno, mc->mc_ki[ptop], sister->mp_pgno,
+          DKEY(mc->mc_ki[ptop] ? newkey : NULL));
+    mc->mc_top--;
+    rc = node_add_branch(mc, mc->mc_ki[ptop], mc->mc_ki[ptop] ? newkey : NULL,
+                         sister->mp_pgno);
+    cASSERT(mc, mp == mc->mc_pg[ptop + 1] && newindx == mc->mc_ki[ptop + 1] &&
+                    ptop == mc->mc_top);
+
+    if (likely(rc == MDBX_SUCCESS) && mc->mc_ki[ptop] == 0) {
+      DEBUG("update prev-first key on parent %s", DKEY(&sepkey));
+      MDBX_node *node = page_node(mc->mc_pg[ptop], 1);
+      cASSERT(mc, node_ks(node) == 0 && node_pgno(node) == mp->mp_pgno);
+      cASSERT(mc, mc->mc_top == ptop && mc->mc_ki[ptop] == 0);
+      mc->mc_ki[ptop] = 1;
+      rc = update_key(mc, &sepkey);
+      cASSERT(mc, mc->mc_top == ptop && mc->mc_ki[ptop] == 1);
+      cASSERT(mc, mp == mc->mc_pg[ptop + 1] && newindx == mc->mc_ki[ptop + 1]);
+      mc->mc_ki[ptop] = 0;
+    }
+
+    mc->mc_top++;
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto done;
+
+    MDBX_node *node = page_node(mc->mc_pg[ptop], mc->mc_ki[ptop] + (size_t)1);
+    cASSERT(mc, node_pgno(node) == mp->mp_pgno && mc->mc_pg[ptop] == ptop_page);
+  } else {
+    mn.mc_top--;
+    TRACE("add-to-parent the right-entry[%u] for new sibling-page",
+          mn.mc_ki[ptop]);
+    rc = node_add_branch(&mn, mn.mc_ki[ptop], &sepkey, sister->mp_pgno);
+    mn.mc_top++;
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto done;
+  }
+
+  if (unlikely(pure_left | pure_right)) {
+    mc->mc_pg[mc->mc_top] = sister;
+    mc->mc_ki[mc->mc_top] = 0;
+    switch (PAGETYPE_WHOLE(sister)) {
+    case P_LEAF: {
+      cASSERT(mc, newpgno == 0 || newpgno == P_INVALID);
+      rc = node_add_leaf(mc, 0, newkey, newdata, naf);
+    } break;
+    case P_LEAF | P_LEAF2: {
+      cASSERT(mc, (naf & (F_BIGDATA | F_SUBDATA | F_DUPDATA)) == 0);
+      cASSERT(mc, newpgno == 0 || newpgno == P_INVALID);
+      rc = node_add_leaf2(mc, 0, newkey, newdata, naf);
+    } break;
+    default:
+      rc = bad_page(sister, "wrong page-type %u\n", PAGETYPE_WHOLE(sister));
+    }
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto done;
+
+    if (pure_right) {
+      for (i = 0; i < mc->mc_top; i++)
+        mc->mc_ki[i] = mn.mc_ki[i];
+    } else if (mc->mc_ki[mc->mc_top - 1] == 0) {
+      for (i = 2; i <= mc->mc_top; ++i)
+        if (mc->mc_ki[mc->mc_top - i]) {
+          get_key(
+              page_node(mc->mc_pg[mc->mc_top - i], mc->mc_ki[mc->mc_top - i]),
+              &sepkey);
+          if (mc->mc_dbx->md_cmp(newkey, &sepkey) < 0) {
+            mc->mc_top -= (uint8_t)i;
+            DEBUG("update new-first on parent [%i] page %u key %s",
+                  mc->mc_ki[mc->mc_top], mc->mc_pg[mc->mc_top]->mp_pgno,
+                  DKEY(newkey));
+            rc = update_key(mc, newkey);
+            mc->mc_top += (uint8_t)i;
+            if (unlikely(rc != MDBX_SUCCESS))
+              goto done;
+          }
+          break;
+        }
+    }
+  } else if (tmp_ki_copy /* !IS_LEAF2(mp) */) {
+    /* Move nodes */
+    mc->mc_pg[mc->mc_top] = sister;
+    i = split_indx;
+    size_t n = 0;
+    do {
+      TRACE("i %zu, nkeys %zu => n %zu, rp #%u", i, nkeys, n, sister->mp_pgno);
+      pgno_t pgno = 0;
+      MDBX_val *rdata = NULL;
+      if (i == newindx) {
+        rkey = *newkey;
+        if (IS_LEAF(mp))
+          rdata = newdata;
+        else
+          pgno = newpgno;
+        flags = naf;
+        /* Update index for the new key. */
+        mc->mc_ki[mc->mc_top] = (indx_t)n;
+      } else {
+        MDBX_node *node = ptr_disp(mp, tmp_ki_copy->mp_ptrs[i] + PAGEHDRSZ);
+        rkey.iov_base = node_key(node);
+        rkey.iov_len = node_ks(node);
+        if (IS_LEAF(mp)) {
+          xdata.iov_base = node_data(node);
+          xdata.iov_len = node_ds(node);
+          rdata = &xdata;
+        } else
+          pgno = node_pgno(node);
+        flags = node_flags(node);
+      }
+
+      switch (PAGETYPE_WHOLE(sister)) {
+      case P_BRANCH: {
+        cASSERT(mc, 0 == (uint16_t)flags);
+        /* First branch index doesn't need key data. */
+        rc = node_add_branch(mc, n, n ? &rkey : NULL, pgno);
+      } break;
+      case P_LEAF: {
+        cASSERT(mc, pgno == 0);
+        cASSERT(mc, rdata != NULL);
+        rc = node_add_leaf(mc, n, &rkey, rdata, flags);
+      } break;
+      /* case P_LEAF | P_LEAF2: {
+        cASSERT(mc, (nflags & (F_BIGDATA | F_SUBDATA | F_DUPDATA)) == 0);
+        cASSERT(mc, gno == 0);
+        rc = mdbx_node_add_leaf2(mc, n, &rkey);
+      } break; */
+      default:
+        rc = bad_page(sister, "wrong page-type %u\n", PAGETYPE_WHOLE(sister));
+      }
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto done;
+
+      ++n;
+      if (++i > nkeys) {
+        i = 0;
+        n = 0;
+        mc->mc_pg[mc->mc_top] = tmp_ki_copy;
+        TRACE("switch to mp #%u", tmp_ki_copy->mp_pgno);
+      }
+    } while (i != split_indx);
+
+    TRACE("i %zu, nkeys %zu, n %zu, pgno #%u", i, nkeys, n,
+          mc->mc_pg[mc->mc_top]->mp_pgno);
+
+    nkeys = page_numkeys(tmp_ki_copy);
+    for (i = 0; i < nkeys; i++)
+      mp->mp_ptrs[i] = tmp_ki_copy->mp_ptrs[i];
+    mp->mp_lower = tmp_ki_copy->mp_lower;
+    mp->mp_upper = tmp_ki_copy->mp_upper;
+    memcpy(page_node(mp, nkeys - 1), page_node(tmp_ki_copy, nkeys - 1),
+           env->me_psize - tmp_ki_copy->mp_upper - PAGEHDRSZ);
+
+    /* reset back to original page */
+    if (newindx < split_indx) {
+      mc->mc_pg[mc->mc_top] = mp;
+    } else {
+      mc->mc_pg[mc->mc_top] = sister;
+      mc->mc_ki[ptop]++;
+      /* Make sure mc_ki is still valid. */
+      if (mn.mc_pg[ptop] != mc->mc_pg[ptop] &&
+          mc->mc_ki[ptop] >= page_numkeys(mc->mc_pg[ptop])) {
+        for (i = 0; i <= ptop; i++) {
+          mc->mc_pg[i] = mn.mc_pg[i];
+          mc->mc_ki[i] = mn.mc_ki[i];
         }
       }
-      mc->mc_snum = 0;
-      mc->mc_top = 0;
-      mc->mc_flags &= ~C_INITIALIZED;
+    }
+  } else if (newindx >= split_indx) {
+    mc->mc_pg[mc->mc_top] = sister;
+    mc->mc_ki[ptop]++;
+    /* Make sure mc_ki is still valid. */
+    if (mn.mc_pg[ptop] != mc->mc_pg[ptop] &&
+        mc->mc_ki[ptop] >= page_numkeys(mc->mc_pg[ptop])) {
+      for (i = 0; i <= ptop; i++) {
+        mc->mc_pg[i] = mn.mc_pg[i];
+        mc->mc_ki[i] = mn.mc_ki[i];
+      }
+    }
+  }
 
-      rc = page_retire(mc, mp);
-      if (unlikely(rc != MDBX_SUCCESS))
-        return rc;
-    } else if (IS_BRANCH(mp) && nkeys == 1) {
-      DEBUG("%s", "collapsing root page!");
-      mc->mc_db->md_root = node_pgno(page_node(mp, 0));
-      rc = page_get(mc, mc->mc_db->md_root, &mc->mc_pg[0], mp->mp_txnid);
-      if (unlikely(rc != MDBX_SUCCESS))
-        return rc;
-      mc->mc_db->md_depth--;
-      mc->mc_ki[0] = mc->mc_ki[1];
-      for (int i = 1; i < mc->mc_db->md_depth; i++) {
-        mc->mc_pg[i] = mc->mc_pg[i + 1];
-        mc->mc_ki[i] = mc->mc_ki[i + 1];
+  /* Adjust other cursors pointing to mp and/or to parent page */
+  nkeys = page_numkeys(mp);
+  for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
+       m2 = m2->mc_next) {
+    MDBX_cursor *m3 = (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
+    if (m3 == mc)
+      continue;
+    if (!(m2->mc_flags & m3->mc_flags & C_INITIALIZED))
+      continue;
+    if (foliage) {
+      /* sub cursors may be on different DB */
+      if (m3->mc_pg[0] != mp)
+        continue;
+      /* root split */
+      for (int k = foliage; k >= 0; k--) {
+        m3->mc_ki[k + 1] = m3->mc_ki[k];
+        m3->mc_pg[k + 1] = m3->mc_pg[k];
       }
+      m3->mc_ki[0] = m3->mc_ki[0] >= nkeys;
+      m3->mc_pg[0] = mc->mc_pg[0];
+      m3->mc_snum++;
+      m3->mc_top++;
+    }
 
-      /* Adjust other cursors pointing to mp */
-      for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
-           m2 = m2->mc_next) {
-        MDBX_cursor *m3 =
-            (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-        if (m3 == mc || !(m3->mc_flags & C_INITIALIZED))
-          continue;
-        if (m3->mc_pg[0] == mp) {
-          for (int i = 0; i < mc->mc_db->md_depth; i++) {
-            m3->mc_pg[i] = m3->mc_pg[i + 1];
-            m3->mc_ki[i] = m3->mc_ki[i + 1];
-          }
-          m3->mc_snum--;
-          m3->mc_top--;
+    if (m3->mc_top >= mc->mc_top && m3->mc_pg[mc->mc_top] == mp && !pure_left) {
+      if (m3->mc_ki[mc->mc_top] >= newindx && !(naf & MDBX_SPLIT_REPLACE))
+        m3->mc_ki[mc->mc_top]++;
+      if (m3->mc_ki[mc->mc_top] >= nkeys) {
+        m3->mc_pg[mc->mc_top] = sister;
+        cASSERT(mc, m3->mc_ki[mc->mc_top] >= nkeys);
+        m3->mc_ki[mc->mc_top] -= (indx_t)nkeys;
+        for (i = 0; i < mc->mc_top; i++) {
+          m3->mc_ki[i] = mn.mc_ki[i];
+          m3->mc_pg[i] = mn.mc_pg[i];
         }
       }
-      cASSERT(mc, IS_LEAF(mc->mc_pg[mc->mc_top]) ||
-                      PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]) == pagetype);
-      cASSERT(mc, mc->mc_snum < mc->mc_db->md_depth ||
-                      IS_LEAF(mc->mc_pg[mc->mc_db->md_depth - 1]));
+    } else if (!did_split_parent && m3->mc_top >= ptop &&
+               m3->mc_pg[ptop] == mc->mc_pg[ptop] &&
+               m3->mc_ki[ptop] >= mc->mc_ki[ptop]) {
+      m3->mc_ki[ptop]++; /* also for the `pure-left` case */
+    }
+    if (XCURSOR_INITED(m3) && IS_LEAF(mp))
+      XCURSOR_REFRESH(m3, m3->mc_pg[mc->mc_top], m3->mc_ki[mc->mc_top]);
+  }
+  TRACE("mp #%u left: %zd, sister #%u left: %zd", mp->mp_pgno, page_room(mp),
+        sister->mp_pgno, page_room(sister));
 
-      rc = page_retire(mc, mp);
-      if (likely(rc == MDBX_SUCCESS))
-        rc = page_touch(mc);
-      return rc;
-    } else {
-      DEBUG("root page %" PRIaPGNO " doesn't need rebalancing (flags 0x%x)",
-            mp->mp_pgno, mp->mp_flags);
+done:
+  if (tmp_ki_copy)
+    dpage_free(env, tmp_ki_copy, 1);
+
+  if (unlikely(rc != MDBX_SUCCESS))
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+  else {
+    if (AUDIT_ENABLED())
+      rc = cursor_check_updating(mc);
+    if (unlikely(naf & MDBX_RESERVE)) {
+      const MDBX_page *const leaf = mc->mc_pg[mc->mc_top];
+      if (IS_LEAF2(leaf))
+        leaf2_read(mc, leaf, mc->mc_ki[mc->mc_top], nullptr, newdata);
+      else {
+        MDBX_node *node = page_node(leaf, mc->mc_ki[mc->mc_top]);
+        if (!(node_flags(node) & F_BIGDATA))
+          newdata->iov_base = node_data(node);
+      }
     }
-    return MDBX_SUCCESS;
+#if MDBX_ENABLE_PGOP_STAT
+    env->me_lck->mti_pgop_stat.split.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
   }
 
-  /* The parent (branch page) must have at least 2 pointers,
-   * otherwise the tree is invalid. */
-  const size_t pre_top = mc->mc_top - 1;
-  cASSERT(mc, IS_BRANCH(mc->mc_pg[pre_top]));
-  cASSERT(mc, !IS_SUBP(mc->mc_pg[0]));
-  cASSERT(mc, page_numkeys(mc->mc_pg[pre_top]) > 1);
+  DEBUG("<< mp #%u, rc %d", mp->mp_pgno, rc);
+  return rc;
+}
 
-  /* Leaf page fill factor is below the threshold.
-   * Try to move keys from left or right neighbor, or
-   * merge with a neighbor page. */
+int mdbx_put(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key, MDBX_val *data,
+             unsigned flags) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-  /* Find neighbors. */
-  MDBX_cursor mn;
-  cursor_copy(mc, &mn);
+  if (unlikely(!key || !data))
+    return MDBX_EINVAL;
 
-  MDBX_page *left = nullptr, *right = nullptr;
-  if (mn.mc_ki[pre_top] > 0) {
-    rc = page_get(
-        &mn, node_pgno(page_node(mn.mc_pg[pre_top], mn.mc_ki[pre_top] - 1)),
-        &left, mc->mc_pg[mc->mc_top]->mp_txnid);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    cASSERT(mc, PAGETYPE_WHOLE(left) == PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]));
-  }
-  if (mn.mc_ki[pre_top] + (size_t)1 < page_numkeys(mn.mc_pg[pre_top])) {
-    rc = page_get(
-        &mn,
-        node_pgno(page_node(mn.mc_pg[pre_top], mn.mc_ki[pre_top] + (size_t)1)),
-        &right, mc->mc_pg[mc->mc_top]->mp_txnid);
-    if (unlikely(rc != MDBX_SUCCESS))
-      return rc;
-    cASSERT(mc, PAGETYPE_WHOLE(right) == PAGETYPE_WHOLE(mc->mc_pg[mc->mc_top]));
-  }
-  cASSERT(mc, left || right);
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
 
-  const size_t ki_top = mc->mc_ki[mc->mc_top];
-  const size_t ki_pre_top = mn.mc_ki[pre_top];
-  const size_t nkeys = page_numkeys(mn.mc_pg[mn.mc_top]);
+  if (unlikely(flags & ~(MDBX_NOOVERWRITE | MDBX_NODUPDATA | MDBX_ALLDUPS |
+                         MDBX_ALLDUPS | MDBX_RESERVE | MDBX_APPEND |
+                         MDBX_APPENDDUP | MDBX_CURRENT | MDBX_MULTIPLE)))
+    return MDBX_EINVAL;
 
-  const size_t left_room = left ? page_room(left) : 0;
-  const size_t right_room = right ? page_room(right) : 0;
-  const size_t left_nkeys = left ? page_numkeys(left) : 0;
-  const size_t right_nkeys = right ? page_numkeys(right) : 0;
-  bool involve = false;
-retry:
-  if (left_room > room_threshold && left_room >= right_room &&
-      (IS_MODIFIABLE(mc->mc_txn, left) || involve)) {
-    /* try merge with left */
-    cASSERT(mc, left_nkeys >= minkeys);
-    mn.mc_pg[mn.mc_top] = left;
-    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top - 1);
-    mn.mc_ki[mn.mc_top] = (indx_t)(left_nkeys - 1);
-    mc->mc_ki[mc->mc_top] = 0;
-    const size_t new_ki = ki_top + left_nkeys;
-    mn.mc_ki[mn.mc_top] += mc->mc_ki[mn.mc_top] + 1;
-    /* We want rebalance to find mn when doing fixups */
-    WITH_CURSOR_TRACKING(mn, rc = page_merge(mc, &mn));
-    if (likely(rc != MDBX_RESULT_TRUE)) {
-      cursor_restore(&mn, mc);
-      mc->mc_ki[mc->mc_top] = (indx_t)new_ki;
-      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
-      return rc;
-    }
-  }
-  if (right_room > room_threshold &&
-      (IS_MODIFIABLE(mc->mc_txn, right) || involve)) {
-    /* try merge with right */
-    cASSERT(mc, right_nkeys >= minkeys);
-    mn.mc_pg[mn.mc_top] = right;
-    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top + 1);
-    mn.mc_ki[mn.mc_top] = 0;
-    mc->mc_ki[mc->mc_top] = (indx_t)nkeys;
-    WITH_CURSOR_TRACKING(mn, rc = page_merge(&mn, mc));
-    if (likely(rc != MDBX_RESULT_TRUE)) {
-      mc->mc_ki[mc->mc_top] = (indx_t)ki_top;
-      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
-      return rc;
-    }
+  if (unlikely(txn->mt_flags &
+               (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN | MDBX_TXN_BLOCKED))) {
+    if (txn->mt_flags & MDBX_TXN_OPTIMISTIC)
+      return optimistic_put(txn, dbi, key, data, flags);
+    return (txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN))
+               ? MDBX_EACCESS
+               : MDBX_BAD_TXN;
   }
 
-  if (left_nkeys > minkeys &&
-      (right_nkeys <= left_nkeys || right_room >= left_room) &&
-      (IS_MODIFIABLE(mc->mc_txn, left) || involve)) {
-    /* try move from left */
-    mn.mc_pg[mn.mc_top] = left;
-    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top - 1);
-    mn.mc_ki[mn.mc_top] = (indx_t)(left_nkeys - 1);
-    mc->mc_ki[mc->mc_top] = 0;
-    WITH_CURSOR_TRACKING(mn, rc = node_move(&mn, mc, true));
-    if (likely(rc != MDBX_RESULT_TRUE)) {
-      mc->mc_ki[mc->mc_top] = (indx_t)(ki_top + 1);
-      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
-      return rc;
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  cx.outer.mc_next = txn->mt_cursors[dbi];
+  txn->mt_cursors[dbi] = &cx.outer;
+
+  /* LY: support for update (explicit overwrite) */
+  if (flags & MDBX_CURRENT) {
+    rc = cursor_set(&cx.outer, (MDBX_val *)key, NULL, MDBX_SET).err;
+    if (likely(rc == MDBX_SUCCESS) &&
+        (txn->mt_dbs[dbi].md_flags & MDBX_DUPSORT) &&
+        (flags & MDBX_ALLDUPS) == 0) {
+      /* LY: allows update (explicit overwrite) only for unique keys */
+      MDBX_node *node = page_node(cx.outer.mc_pg[cx.outer.mc_top],
+                                  cx.outer.mc_ki[cx.outer.mc_top]);
+      if (node_flags(node) & F_DUPDATA) {
+        tASSERT(txn, XCURSOR_INITED(&cx.outer) &&
+                         cx.outer.mc_xcursor->mx_db.md_entries > 1);
+        rc = MDBX_EMULTIVAL;
+      }
     }
   }
-  if (right_nkeys > minkeys && (IS_MODIFIABLE(mc->mc_txn, right) || involve)) {
-    /* try move from right */
-    mn.mc_pg[mn.mc_top] = right;
-    mn.mc_ki[mn.mc_top - 1] = (indx_t)(ki_pre_top + 1);
-    mn.mc_ki[mn.mc_top] = 0;
-    mc->mc_ki[mc->mc_top] = (indx_t)nkeys;
-    WITH_CURSOR_TRACKING(mn, rc = node_move(&mn, mc, false));
-    if (likely(rc != MDBX_RESULT_TRUE)) {
-      mc->mc_ki[mc->mc_top] = (indx_t)ki_top;
-      cASSERT(mc, rc || page_numkeys(mc->mc_pg[mc->mc_top]) >= minkeys);
-      return rc;
+
+  if (likely(rc == MDBX_SUCCESS))
+    rc = cursor_put_checklen(&cx.outer, key, data, flags);
+  txn->mt_cursors[dbi] = cx.outer.mc_next;
+
+  return rc;
+}
+
+int mdbx_put_sorted_batch(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *pairs,
+                          size_t count, MDBX_put_flags_t flags) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!pairs && count))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(flags & ~(MDBX_NOOVERWRITE | MDBX_NODUPDATA | MDBX_ALLDUPS |
+                         MDBX_APPEND | MDBX_APPENDDUP)))
+    return MDBX_EINVAL;
+
+  if (unlikely(txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN |
+                                MDBX_TXN_BLOCKED)) &&
+      !(txn->mt_flags & MDBX_TXN_OPTIMISTIC))
+    return (txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN))
+               ? MDBX_EACCESS
+               : MDBX_BAD_TXN;
+
+  /* Инициализация курсора также актуализирует ограничения размеров ключей
+   * и данных, которые нужны для проверки пакета. */
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  /* Проверяем весь пакет заранее, чтобы не применять его частично
+   * из-за ошибок в данных. */
+  const MDBX_dbx *const dbx = &txn->mt_dbxs[dbi];
+  const unsigned db_flags = txn->mt_dbs[dbi].md_flags;
+  MDBX_cmp_func *const cmp =
+      (dbx->md_cmp == cmp_int_align2) ? cmp_int_unaligned : dbx->md_cmp;
+  for (size_t i = 0; i < count; ++i) {
+    const MDBX_val *const key = pairs + i * 2, *const data = key + 1;
+    if (unlikely(key->iov_len < dbx->md_klen_min ||
+                 key->iov_len > dbx->md_klen_max ||
+                 data->iov_len < dbx->md_vlen_min ||
+                 data->iov_len > dbx->md_vlen_max))
+      return MDBX_BAD_VALSIZE;
+    if (unlikely((db_flags & MDBX_INTEGERKEY) && key->iov_len != 4 &&
+                 key->iov_len != 8))
+      return MDBX_BAD_VALSIZE;
+    if (unlikely((db_flags & MDBX_INTEGERDUP) && data->iov_len != 4 &&
+                 data->iov_len != 8))
+      return MDBX_BAD_VALSIZE;
+    if (i) {
+      const int diff = cmp(key - 2, key);
+      if (unlikely(diff > 0 || (diff == 0 && !(db_flags & MDBX_DUPSORT))))
+        return MDBX_EKEYMISMATCH;
     }
   }
 
-  if (nkeys >= minkeys) {
-    mc->mc_ki[mc->mc_top] = (indx_t)ki_top;
-    if (AUDIT_ENABLED())
-      return cursor_check_updating(mc);
-    return MDBX_SUCCESS;
+  bool skipped = false;
+  if (unlikely(txn->mt_flags & MDBX_TXN_OPTIMISTIC)) {
+    for (size_t i = 0; i < count; ++i) {
+      MDBX_val data = pairs[i * 2 + 1];
+      rc = optimistic_put(txn, dbi, pairs + i * 2, &data, flags);
+      if (rc == MDBX_KEYEXIST) {
+        skipped = true;
+        rc = MDBX_SUCCESS;
+      } else if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+    return skipped ? MDBX_RESULT_TRUE : MDBX_SUCCESS;
   }
 
-  if (likely(!involve)) {
-    involve = true;
-    goto retry;
-  }
-  if (likely(room_threshold > 0)) {
-    room_threshold = 0;
-    goto retry;
+  /* Все пары вставляются одним курсором, поэтому поиск каждого следующего
+   * ключа начинается с текущей позиции, см. cursor_set(). */
+  cx.outer.mc_next = txn->mt_cursors[dbi];
+  txn->mt_cursors[dbi] = &cx.outer;
+
+  for (size_t i = 0; i < count; ++i) {
+    MDBX_val data = pairs[i * 2 + 1];
+    rc = cursor_put_checklen(&cx.outer, pairs + i * 2, &data, flags);
+    if (rc == MDBX_KEYEXIST) {
+      skipped = true;
+      rc = MDBX_SUCCESS;
+    } else if (unlikely(rc != MDBX_SUCCESS))
+      break;
   }
-  ERROR("Unable to merge/rebalance %s page %" PRIaPGNO
-        " (has %zu keys, full %.1f%%, used %zu, room %zu bytes )",
-        (pagetype & P_LEAF) ? "leaf" : "branch", tp->mp_pgno, numkeys,
-        page_fill(mc->mc_txn->mt_env, tp), page_used(mc->mc_txn->mt_env, tp),
-        room);
-  return MDBX_PROBLEM;
-}
+  txn->mt_cursors[dbi] = cx.outer.mc_next;
 
-__cold static int page_check(const MDBX_cursor *const mc,
-                             const MDBX_page *const mp) {
-  DKBUF;
-  int rc = MDBX_SUCCESS;
-  if (unlikely(mp->mp_pgno < MIN_PAGENO || mp->mp_pgno > MAX_PAGENO))
-    rc = bad_page(mp, "invalid pgno (%u)\n", mp->mp_pgno);
+  return (rc == MDBX_SUCCESS && skipped) ? MDBX_RESULT_TRUE : rc;
+}
 
-  MDBX_env *const env = mc->mc_txn->mt_env;
-  const ptrdiff_t offset = ptr_dist(mp, env->me_map);
-  unsigned flags_mask = P_ILL_BITS;
-  unsigned flags_expected = 0;
-  if (offset < 0 ||
-      offset > (ptrdiff_t)(pgno2bytes(env, mc->mc_txn->mt_next_pgno) -
-                           ((mp->mp_flags & P_SUBP) ? PAGEHDRSZ + 1
-                                                    : env->me_psize))) {
-    /* should be dirty page without MDBX_WRITEMAP, or a subpage of. */
-    flags_mask -= P_SUBP;
-    if ((env->me_flags & MDBX_WRITEMAP) != 0 ||
-        (!IS_SHADOWED(mc->mc_txn, mp) && !(mp->mp_flags & P_SUBP)))
-      rc = bad_page(mp, "invalid page-address %p, offset %zi\n",
-                    __Wpedantic_format_voidptr(mp), offset);
-  } else if (offset & (env->me_psize - 1))
-    flags_expected = P_SUBP;
+/**** BULK LOADING ************************************************************/
 
-  if (unlikely((mp->mp_flags & flags_mask) != flags_expected))
-    rc = bad_page(mp, "unknown/extra page-flags (have 0x%x, expect 0x%x)\n",
-                  mp->mp_flags & flags_mask, flags_expected);
+struct MDBX_bulk {
+  MDBX_cursor *cursor;
+  /* предельный объем данных в странице согласно коэффициенту заполнения */
+  size_t fill_limit;
+  /* два буфера для ключей-разделителей, переносимых на вышележащие уровни */
+  uint8_t *keybuf[2];
+};
 
-  cASSERT(mc, (mc->mc_checking & CC_LEAF2) == 0 || (mc->mc_flags & C_SUB) != 0);
-  const uint8_t type = PAGETYPE_WHOLE(mp);
-  switch (type) {
-  default:
-    return bad_page(mp, "invalid type (%u)\n", type);
-  case P_OVERFLOW:
-    if (unlikely(mc->mc_flags & C_SUB))
-      rc = bad_page(mp, "unexpected %s-page for %s (db-flags 0x%x)\n", "large",
-                    "nested dupsort tree", mc->mc_db->md_flags);
-    const pgno_t npages = mp->mp_pages;
-    if (unlikely(npages < 1 || npages >= MAX_PAGENO / 2))
-      rc = bad_page(mp, "invalid n-pages (%u) for large-page\n", npages);
-    if (unlikely(mp->mp_pgno + npages > mc->mc_txn->mt_next_pgno))
-      rc = bad_page(
-          mp, "end of large-page beyond (%u) allocated space (%u next-pgno)\n",
-          mp->mp_pgno + npages, mc->mc_txn->mt_next_pgno);
-    return rc; //-------------------------- end of large/overflow page handling
-  case P_LEAF | P_SUBP:
-    if (unlikely(mc->mc_db->md_depth != 1))
-      rc = bad_page(mp, "unexpected %s-page for %s (db-flags 0x%x)\n",
-                    "leaf-sub", "nested dupsort db", mc->mc_db->md_flags);
-    /* fall through */
-    __fallthrough;
-  case P_LEAF:
-    if (unlikely((mc->mc_checking & CC_LEAF2) != 0))
-      rc = bad_page(
-          mp, "unexpected leaf-page for dupfixed subtree (db-lags 0x%x)\n",
-          mc->mc_db->md_flags);
-    break;
-  case P_LEAF | P_LEAF2 | P_SUBP:
-    if (unlikely(mc->mc_db->md_depth != 1))
-      rc = bad_page(mp, "unexpected %s-page for %s (db-flags 0x%x)\n",
-                    "leaf2-sub", "nested dupsort db", mc->mc_db->md_flags);
-    /* fall through */
-    __fallthrough;
-  case P_LEAF | P_LEAF2:
-    if (unlikely((mc->mc_checking & CC_LEAF2) == 0))
-      rc = bad_page(
-          mp,
-          "unexpected leaf2-page for non-dupfixed (sub)tree (db-flags 0x%x)\n",
-          mc->mc_db->md_flags);
-    break;
-  case P_BRANCH:
-    break;
-  }
+static __always_inline bool bulk_fits(const MDBX_bulk *bulk,
+                                      const MDBX_page *mp, size_t bytes,
+                                      size_t minkeys) {
+  return page_room(mp) >= bytes &&
+         (page_numkeys(mp) < minkeys ||
+          page_used(bulk->cursor->mc_txn->mt_env, mp) + bytes <=
+              bulk->fill_limit);
+}
 
-  if (unlikely(mp->mp_upper < mp->mp_lower ||
-               ((mp->mp_lower | mp->mp_upper) & 1) ||
-               PAGEHDRSZ + mp->mp_upper > env->me_psize))
-    rc = bad_page(mp, "invalid page lower(%u)/upper(%u) with limit %zu\n",
-                  mp->mp_lower, mp->mp_upper, page_space(env));
+/* Проверяет что курсор построителя по-прежнему стоит на самом правом пути,
+ * т.е. таблица не изменялась в обход построителя. */
+static bool bulk_positioned(const MDBX_cursor *mc) {
+  if (unlikely(mc->mc_snum != mc->mc_db->md_depth ||
+               mc->mc_pg[0]->mp_pgno != mc->mc_db->md_root))
+    return false;
+  for (size_t i = 0; i < mc->mc_snum; ++i)
+    if (unlikely(mc->mc_ki[i] + (size_t)1 != page_numkeys(mc->mc_pg[i])))
+      return false;
+  return true;
+}
 
-  const char *const end_of_page = ptr_disp(mp, env->me_psize);
-  const size_t nkeys = page_numkeys(mp);
-  STATIC_ASSERT(P_BRANCH == 1);
-  if (unlikely(nkeys <= (uint8_t)(mp->mp_flags & P_BRANCH))) {
-    if ((!(mc->mc_flags & C_SUB) || mc->mc_db->md_entries) &&
-        (!(mc->mc_checking & CC_UPDATING) ||
-         !(IS_MODIFIABLE(mc->mc_txn, mp) || (mp->mp_flags & P_SUBP))))
-      rc =
-          bad_page(mp, "%s-page nkeys (%zu) < %u\n",
-                   IS_BRANCH(mp) ? "branch" : "leaf", nkeys, 1 + IS_BRANCH(mp));
-  }
-  if (!IS_LEAF2(mp) && unlikely(PAGEHDRSZ + mp->mp_upper +
-                                    nkeys * sizeof(MDBX_node) + nkeys - 1 >
-                                env->me_psize))
-    rc = bad_page(mp, "invalid page upper (%u) for nkeys %zu with limit %zu\n",
-                  mp->mp_upper, nkeys, page_space(env));
+/* Начинает новую листовую страницу и добавляет ссылку на неё в вышележащие
+ * уровни снизу вверх, при необходимости начиная новые branch-страницы и новый
+ * корень. Вместо деления заполненной branch-страницы в новую переносится
+ * только её последний элемент, чтобы в каждой было не менее двух элементов.
+ * Для этого в заполненной странице всегда не менее трёх элементов, что
+ * гарантируется ограничением BRANCH_NODE_MAX. */
+static int bulk_grow(MDBX_bulk *bulk, MDBX_cursor *mc, const MDBX_val *key) {
+  MDBX_env *const env = mc->mc_txn->mt_env;
+  pgr_t npr = page_new(mc, P_LEAF);
+  if (unlikely(npr.err != MDBX_SUCCESS))
+    return npr.err;
 
-  const size_t ksize_max = keysize_max(env->me_psize, 0);
-  const size_t leaf2_ksize = mp->mp_leaf2_ksize;
-  if (IS_LEAF2(mp)) {
-    if (unlikely((mc->mc_flags & C_SUB) == 0 ||
-                 (mc->mc_db->md_flags & MDBX_DUPFIXED) == 0))
-      rc = bad_page(mp, "unexpected leaf2-page (db-flags 0x%x)\n",
-                    mc->mc_db->md_flags);
-    if (unlikely(leaf2_ksize < 1 || leaf2_ksize > ksize_max))
-      rc = bad_page(mp, "invalid leaf2-key length (%zu)\n", leaf2_ksize);
-  }
+  size_t level = mc->mc_top;
+  mc->mc_pg[level] = npr.page;
+  mc->mc_ki[level] = 0;
+  pgno_t pgno = npr.page->mp_pgno;
+  MDBX_val sep = *key;
+  int rc, toggle = 0;
+  while (level > 0) {
+    mc->mc_top = (uint8_t)--level;
+    MDBX_page *const mp = mc->mc_pg[level];
+    const size_t nkeys = page_numkeys(mp);
+    if (bulk_fits(bulk, mp, branch_size(env, &sep), 3)) {
+      rc = node_add_branch(mc, nkeys, &sep, pgno);
+      mc->mc_ki[level] = (indx_t)nkeys;
+      goto done;
+    }
 
-  MDBX_val here, prev = {0, 0};
-  for (size_t i = 0; i < nkeys; ++i) {
-    if (IS_LEAF2(mp)) {
-      const char *const key = page_leaf2key(mp, i, leaf2_ksize);
-      if (unlikely(end_of_page < key + leaf2_ksize)) {
-        rc = bad_page(mp, "leaf2-key beyond (%zu) page-end\n",
-                      key + leaf2_ksize - end_of_page);
-        continue;
-      }
+    cASSERT(mc, nkeys > 2);
+    const MDBX_node *const node = page_node(mp, nkeys - 1);
+    const pgno_t moved = node_pgno(node);
+    MDBX_val next;
+    get_key(node, &next);
+    next.iov_base = memcpy(bulk->keybuf[toggle], next.iov_base, next.iov_len);
+    toggle ^= 1;
+    mc->mc_ki[level] = (indx_t)(nkeys - 1);
+    node_del(mc, 0);
 
-      if (unlikely(leaf2_ksize != mc->mc_dbx->md_klen_min)) {
-        if (unlikely(leaf2_ksize < mc->mc_dbx->md_klen_min ||
-                     leaf2_ksize > mc->mc_dbx->md_klen_max))
-          rc = bad_page(
-              mp, "leaf2-key size (%zu) <> min/max key-length (%zu/%zu)\n",
-              leaf2_ksize, mc->mc_dbx->md_klen_min, mc->mc_dbx->md_klen_max);
-        else
-          mc->mc_dbx->md_klen_min = mc->mc_dbx->md_klen_max = leaf2_ksize;
-      }
-      if ((mc->mc_checking & CC_SKIPORD) == 0) {
-        here.iov_base = (void *)key;
-        here.iov_len = leaf2_ksize;
-        if (prev.iov_base && unlikely(mc->mc_dbx->md_cmp(&prev, &here) >= 0))
-          rc = bad_page(mp, "leaf2-key #%zu wrong order (%s >= %s)\n", i,
-                        DKEY(&prev), DVAL(&here));
-        prev = here;
-      }
-    } else {
-      const MDBX_node *const node = page_node(mp, i);
-      const char *const node_end = ptr_disp(node, NODESIZE);
-      if (unlikely(node_end > end_of_page)) {
-        rc = bad_page(mp, "node[%zu] (%zu) beyond page-end\n", i,
-                      node_end - end_of_page);
-        continue;
-      }
-      const size_t ksize = node_ks(node);
-      if (unlikely(ksize > ksize_max))
-        rc = bad_page(mp, "node[%zu] too long key (%zu)\n", i, ksize);
-      const char *const key = node_key(node);
-      if (unlikely(end_of_page < key + ksize)) {
-        rc = bad_page(mp, "node[%zu] key (%zu) beyond page-end\n", i,
-                      key + ksize - end_of_page);
-        continue;
-      }
-      if ((IS_LEAF(mp) || i > 0)) {
-        if (unlikely(ksize < mc->mc_dbx->md_klen_min ||
-                     ksize > mc->mc_dbx->md_klen_max))
-          rc = bad_page(
-              mp, "node[%zu] key size (%zu) <> min/max key-length (%zu/%zu)\n",
-              i, ksize, mc->mc_dbx->md_klen_min, mc->mc_dbx->md_klen_max);
-        if ((mc->mc_checking & CC_SKIPORD) == 0) {
-          here.iov_base = (void *)key;
-          here.iov_len = ksize;
-          if (prev.iov_base && unlikely(mc->mc_dbx->md_cmp(&prev, &here) >= 0))
-            rc = bad_page(mp, "node[%zu] key wrong order (%s >= %s)\n", i,
-                          DKEY(&prev), DVAL(&here));
-          prev = here;
-        }
-      }
-      if (IS_BRANCH(mp)) {
-        if ((mc->mc_checking & CC_UPDATING) == 0 && i == 0 &&
-            unlikely(ksize != 0))
-          rc = bad_page(mp, "branch-node[%zu] wrong 0-node key-length (%zu)\n",
-                        i, ksize);
-        const pgno_t ref = node_pgno(node);
-        if (unlikely(ref < MIN_PAGENO) ||
-            (unlikely(ref >= mc->mc_txn->mt_next_pgno) &&
-             (unlikely(ref >= mc->mc_txn->mt_geo.now) ||
-              !(mc->mc_checking & CC_RETIRING))))
-          rc = bad_page(mp, "branch-node[%zu] wrong pgno (%u)\n", i, ref);
-        if (unlikely(node_flags(node)))
-          rc = bad_page(mp, "branch-node[%zu] wrong flags (%u)\n", i,
-                        node_flags(node));
-        continue;
-      }
+    npr = page_new(mc, P_BRANCH);
+    if (unlikely(npr.err != MDBX_SUCCESS))
+      return npr.err;
+    mc->mc_pg[level] = npr.page;
+    rc = node_add_branch(mc, 0, nullptr, moved);
+    if (likely(rc == MDBX_SUCCESS))
+      rc = node_add_branch(mc, 1, &sep, pgno);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    mc->mc_ki[level] = 1;
+    pgno = npr.page->mp_pgno;
+    sep = next;
+  }
 
-      switch (node_flags(node)) {
-      default:
-        rc =
-            bad_page(mp, "invalid node[%zu] flags (%u)\n", i, node_flags(node));
-        break;
-      case F_BIGDATA /* data on large-page */:
-      case 0 /* usual */:
-      case F_SUBDATA /* sub-db */:
-      case F_SUBDATA | F_DUPDATA /* dupsorted sub-tree */:
-      case F_DUPDATA /* short sub-page */:
-        break;
-      }
+  if (unlikely(mc->mc_snum >= CURSOR_STACK)) {
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+    return MDBX_CURSOR_FULL;
+  }
+  npr = page_new(mc, P_BRANCH);
+  if (unlikely(npr.err != MDBX_SUCCESS))
+    return npr.err;
+  memmove(mc->mc_pg + 1, mc->mc_pg, mc->mc_snum * sizeof(mc->mc_pg[0]));
+  memmove(mc->mc_ki + 1, mc->mc_ki, mc->mc_snum * sizeof(mc->mc_ki[0]));
+  mc->mc_snum += 1;
+  mc->mc_top = 0;
+  mc->mc_pg[0] = npr.page;
+  rc = node_add_branch(mc, 0, nullptr, mc->mc_db->md_root);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = node_add_branch(mc, 1, &sep, pgno);
+  mc->mc_ki[0] = 1;
+  mc->mc_db->md_root = npr.page->mp_pgno;
+  mc->mc_db->md_depth += 1;
 
-      const size_t dsize = node_ds(node);
-      const char *const data = node_data(node);
-      if (node_flags(node) & F_BIGDATA) {
-        if (unlikely(end_of_page < data + sizeof(pgno_t))) {
-          rc = bad_page(
-              mp, "node-%s(%zu of %zu, %zu bytes) beyond (%zu) page-end\n",
-              "bigdata-pgno", i, nkeys, dsize, data + dsize - end_of_page);
-          continue;
-        }
-        if (unlikely(dsize <= mc->mc_dbx->md_vlen_min ||
-                     dsize > mc->mc_dbx->md_vlen_max))
-          rc = bad_page(
-              mp,
-              "big-node data size (%zu) <> min/max value-length (%zu/%zu)\n",
-              dsize, mc->mc_dbx->md_vlen_min, mc->mc_dbx->md_vlen_max);
-        if (unlikely(node_size_len(node_ks(node), dsize) <=
-                     mc->mc_txn->mt_env->me_leaf_nodemax) &&
-            mc->mc_dbi != FREE_DBI)
-          poor_page(mp, "too small data (%zu bytes) for bigdata-node", dsize);
+done:
+  mc->mc_top = mc->mc_snum - 1;
+  return rc;
+}
 
-        if ((mc->mc_checking & CC_RETIRING) == 0) {
-          const pgr_t lp =
-              page_get_large(mc, node_largedata_pgno(node), mp->mp_txnid);
-          if (unlikely(lp.err != MDBX_SUCCESS))
-            return lp.err;
-          cASSERT(mc, PAGETYPE_WHOLE(lp.page) == P_OVERFLOW);
-          const unsigned npages = number_of_ovpages(env, dsize);
-          if (unlikely(lp.page->mp_pages != npages)) {
-            if (lp.page->mp_pages < npages)
-              rc = bad_page(lp.page,
-                            "too less n-pages %u for bigdata-node (%zu bytes)",
-                            lp.page->mp_pages, dsize);
-            else if (mc->mc_dbi != FREE_DBI)
-              poor_page(lp.page,
-                        "extra n-pages %u for bigdata-node (%zu bytes)",
-                        lp.page->mp_pages, dsize);
-          }
-        }
-        continue;
-      }
+int mdbx_bulk_begin(MDBX_txn *txn, MDBX_dbi dbi, unsigned fill_percent,
+                    MDBX_bulk **ret) {
+  if (unlikely(!ret))
+    return MDBX_EINVAL;
+  *ret = nullptr;
 
-      if (unlikely(end_of_page < data + dsize)) {
-        rc = bad_page(mp,
-                      "node-%s(%zu of %zu, %zu bytes) beyond (%zu) page-end\n",
-                      "data", i, nkeys, dsize, data + dsize - end_of_page);
-        continue;
-      }
+  int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-      switch (node_flags(node)) {
-      default:
-        /* wrong, but already handled */
-        continue;
-      case 0 /* usual */:
-        if (unlikely(dsize < mc->mc_dbx->md_vlen_min ||
-                     dsize > mc->mc_dbx->md_vlen_max)) {
-          rc = bad_page(
-              mp, "node-data size (%zu) <> min/max value-length (%zu/%zu)\n",
-              dsize, mc->mc_dbx->md_vlen_min, mc->mc_dbx->md_vlen_max);
-          continue;
-        }
-        break;
-      case F_SUBDATA /* sub-db */:
-        if (unlikely(dsize != sizeof(MDBX_db))) {
-          rc = bad_page(mp, "invalid sub-db record size (%zu)\n", dsize);
-          continue;
-        }
-        break;
-      case F_SUBDATA | F_DUPDATA /* dupsorted sub-tree */:
-        if (unlikely(dsize != sizeof(MDBX_db))) {
-          rc = bad_page(mp, "invalid nested-db record size (%zu)\n", dsize);
-          continue;
-        }
-        break;
-      case F_DUPDATA /* short sub-page */:
-        if (unlikely(dsize <= PAGEHDRSZ)) {
-          rc = bad_page(mp, "invalid nested/sub-page record size (%zu)\n",
-                        dsize);
-          continue;
-        } else {
-          const MDBX_page *const sp = (MDBX_page *)data;
-          switch (sp->mp_flags &
-                  /* ignore legacy P_DIRTY flag */ ~P_LEGACY_DIRTY) {
-          case P_LEAF | P_SUBP:
-          case P_LEAF | P_LEAF2 | P_SUBP:
-            break;
-          default:
-            rc = bad_page(mp, "invalid nested/sub-page flags (0x%02x)\n",
-                          sp->mp_flags);
-            continue;
-          }
+  if (unlikely(fill_percent > 100))
+    return MDBX_EINVAL;
 
-          const char *const end_of_subpage = data + dsize;
-          const intptr_t nsubkeys = page_numkeys(sp);
-          if (unlikely(nsubkeys == 0) && !(mc->mc_checking & CC_UPDATING) &&
-              mc->mc_db->md_entries)
-            rc = bad_page(mp, "no keys on a %s-page\n",
-                          IS_LEAF2(sp) ? "leaf2-sub" : "leaf-sub");
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
 
-          MDBX_val sub_here, sub_prev = {0, 0};
-          for (int j = 0; j < nsubkeys; j++) {
-            if (IS_LEAF2(sp)) {
-              /* LEAF2 pages have no mp_ptrs[] or node headers */
-              const size_t sub_ksize = sp->mp_leaf2_ksize;
-              const char *const sub_key = page_leaf2key(sp, j, sub_ksize);
-              if (unlikely(end_of_subpage < sub_key + sub_ksize)) {
-                rc = bad_page(mp, "nested-leaf2-key beyond (%zu) nested-page\n",
-                              sub_key + sub_ksize - end_of_subpage);
-                continue;
-              }
+  if (unlikely(txn->mt_dbs[dbi].md_flags &
+               (MDBX_DUPSORT | MDBX_FIXEDSIZE | DB_ALIGNVALUE_FLAGS)))
+    return MDBX_INCOMPATIBLE;
 
-              if (unlikely(sub_ksize != mc->mc_dbx->md_vlen_min)) {
-                if (unlikely(sub_ksize < mc->mc_dbx->md_vlen_min ||
-                             sub_ksize > mc->mc_dbx->md_vlen_max))
-                  rc = bad_page(mp,
-                                "nested-leaf2-key size (%zu) <> min/max "
-                                "value-length (%zu/%zu)\n",
-                                sub_ksize, mc->mc_dbx->md_vlen_min,
-                                mc->mc_dbx->md_vlen_max);
-                else
-                  mc->mc_dbx->md_vlen_min = mc->mc_dbx->md_vlen_max = sub_ksize;
-              }
-              if ((mc->mc_checking & CC_SKIPORD) == 0) {
-                sub_here.iov_base = (void *)sub_key;
-                sub_here.iov_len = sub_ksize;
-                if (sub_prev.iov_base &&
-                    unlikely(mc->mc_dbx->md_dcmp(&sub_prev, &sub_here) >= 0))
-                  rc = bad_page(mp,
-                                "nested-leaf2-key #%u wrong order (%s >= %s)\n",
-                                j, DKEY(&sub_prev), DVAL(&sub_here));
-                sub_prev = sub_here;
-              }
-            } else {
-              const MDBX_node *const sub_node = page_node(sp, j);
-              const char *const sub_node_end = ptr_disp(sub_node, NODESIZE);
-              if (unlikely(sub_node_end > end_of_subpage)) {
-                rc = bad_page(mp, "nested-node beyond (%zu) nested-page\n",
-                              end_of_subpage - sub_node_end);
-                continue;
-              }
-              if (unlikely(node_flags(sub_node) != 0))
-                rc = bad_page(mp, "nested-node invalid flags (%u)\n",
-                              node_flags(sub_node));
+  MDBX_env *const env = txn->mt_env;
+  MDBX_bulk *const bulk =
+      osal_malloc(sizeof(MDBX_bulk) + env->me_branch_nodemax * 2);
+  if (unlikely(!bulk))
+    return MDBX_ENOMEM;
+  bulk->keybuf[0] = ptr_disp(bulk, sizeof(MDBX_bulk));
+  bulk->keybuf[1] = bulk->keybuf[0] + env->me_branch_nodemax;
+  bulk->fill_limit =
+      fill_percent ? page_space(env) * fill_percent / 100 : page_space(env);
 
-              const size_t sub_ksize = node_ks(sub_node);
-              const char *const sub_key = node_key(sub_node);
-              const size_t sub_dsize = node_ds(sub_node);
-              /* char *sub_data = node_data(sub_node); */
+  rc = mdbx_cursor_open(txn, dbi, &bulk->cursor);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    osal_free(bulk);
+    return rc;
+  }
 
-              if (unlikely(sub_ksize < mc->mc_dbx->md_vlen_min ||
-                           sub_ksize > mc->mc_dbx->md_vlen_max))
-                rc = bad_page(mp,
-                              "nested-node-key size (%zu) <> min/max "
-                              "value-length (%zu/%zu)\n",
-                              sub_ksize, mc->mc_dbx->md_vlen_min,
-                              mc->mc_dbx->md_vlen_max);
-              if ((mc->mc_checking & CC_SKIPORD) == 0) {
-                sub_here.iov_base = (void *)sub_key;
-                sub_here.iov_len = sub_ksize;
-                if (sub_prev.iov_base &&
-                    unlikely(mc->mc_dbx->md_dcmp(&sub_prev, &sub_here) >= 0))
-                  rc = bad_page(mp,
-                                "nested-node-key #%u wrong order (%s >= %s)\n",
-                                j, DKEY(&sub_prev), DVAL(&sub_here));
-                sub_prev = sub_here;
-              }
-              if (unlikely(sub_dsize != 0))
-                rc = bad_page(mp, "nested-node non-empty data size (%zu)\n",
-                              sub_dsize);
-              if (unlikely(end_of_subpage < sub_key + sub_ksize))
-                rc = bad_page(mp, "nested-node-key beyond (%zu) nested-page\n",
-                              sub_key + sub_ksize - end_of_subpage);
-            }
-          }
-        }
-        break;
-      }
+  /* Встаем в конец таблицы, затрагивая (делая грязными) страницы пути */
+  MDBX_cursor *const mc = bulk->cursor;
+  MDBX_val stub = {nullptr, 0};
+  rc = (mc->mc_db->md_root != P_INVALID) ? cursor_last(mc, &stub, &stub)
+                                         : MDBX_SUCCESS;
+  if (likely(rc == MDBX_SUCCESS))
+    rc = cursor_touch(mc, &stub, &stub);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    mdbx_cursor_close(mc);
+    osal_free(bulk);
+    return rc;
+  }
+
+  *ret = bulk;
+  return MDBX_SUCCESS;
+}
+
+int mdbx_bulk_add(MDBX_bulk *bulk, const MDBX_val *key, const MDBX_val *data) {
+  if (unlikely(!bulk || !key || !data))
+    return MDBX_EINVAL;
+
+  MDBX_cursor *const mc = bulk->cursor;
+  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
+    return MDBX_BAD_TXN;
+
+  MDBX_txn *const txn = mc->mc_txn;
+  int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  /* Никакие другие курсоры таблицы не должны использоваться, так как
+   * построитель не корректирует их позиции. */
+  if (unlikely(txn->mt_cursors[mc->mc_dbi] != mc || mc->mc_next))
+    return MDBX_BUSY;
+
+  if (unlikely(key->iov_len < mc->mc_dbx->md_klen_min ||
+               key->iov_len > mc->mc_dbx->md_klen_max ||
+               data->iov_len < mc->mc_dbx->md_vlen_min ||
+               data->iov_len > mc->mc_dbx->md_vlen_max))
+    return MDBX_BAD_VALSIZE;
+
+  uint64_t aligned_keybytes;
+  MDBX_val aligned_key;
+  if (mc->mc_db->md_flags & MDBX_INTEGERKEY) {
+    if (unlikely(key->iov_len != 4 && key->iov_len != 8))
+      return MDBX_BAD_VALSIZE;
+    if (unlikely((key->iov_len - 1) & (uintptr_t)key->iov_base)) {
+      aligned_key.iov_base =
+          memcpy(&aligned_keybytes, key->iov_base, key->iov_len);
+      aligned_key.iov_len = key->iov_len;
+      key = &aligned_key;
+    }
+  }
+
+  unsigned nflags = 0;
+  MDBX_val packed;
+  uint8_t ref[VLOG_REF_SIZE];
+  if (unlikely(mc->mc_dbx->md_vlog_threshold) &&
+      data->iov_len >= mc->mc_dbx->md_vlog_threshold &&
+      !(txn->mt_flags & MDBX_TXN_DISJOINT)) {
+    rc = vlog_append(mc, key, data, ref);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    packed.iov_base = ref;
+    packed.iov_len = sizeof(ref);
+    data = &packed;
+    nflags = F_COMPRESSED;
+  } else if (unlikely(mc->mc_dbx->md_codec) &&
+             data->iov_len >= mc->mc_dbx->md_codec_threshold) {
+    rc = codec_encode(txn, mc->mc_dbx->md_codec, data, &packed);
+    if (rc == MDBX_SUCCESS) {
+      data = &packed;
+      nflags = F_COMPRESSED;
+    } else if (unlikely(rc != MDBX_RESULT_TRUE))
+      return rc;
+  }
+
+  MDBX_env *const env = txn->mt_env;
+  const size_t leaf_bytes = leaf_size(env, key, data, 0);
+  const bool large = node_size(key, data) > env->me_leaf_nodemax;
+  if (likely(mc->mc_flags & C_INITIALIZED)) {
+    if (unlikely(!bulk_positioned(mc)))
+      return MDBX_EINVAL;
+    const MDBX_page *const mp = mc->mc_pg[mc->mc_top];
+    MDBX_val last;
+    get_key(page_node(mp, page_numkeys(mp) - 1), &last);
+    if (unlikely(mc->mc_dbx->md_cmp(key, &last) <= 0))
+      return MDBX_EKEYMISMATCH;
+    if (likely(!large && IS_MODIFIABLE(txn, mp) &&
+               bulk_fits(bulk, mp, leaf_bytes, 1)))
+      goto add;
+  }
+
+  /* Потребуются новые страницы, т.е. возможно выталкивание */
+  rc = cursor_touch(mc, key, data);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely((mc->mc_flags & C_INITIALIZED) == 0)) {
+    const pgr_t npr = page_new(mc, P_LEAF);
+    if (unlikely(npr.err != MDBX_SUCCESS))
+      return npr.err;
+    mc->mc_db->md_root = npr.page->mp_pgno;
+    mc->mc_db->md_depth = 1;
+    mc->mc_snum = 1;
+    mc->mc_top = 0;
+    mc->mc_pg[0] = npr.page;
+    mc->mc_ki[0] = 0;
+    mc->mc_flags = (mc->mc_flags & ~(C_EOF | C_DEL)) | C_INITIALIZED;
+  } else if (!bulk_fits(bulk, mc->mc_pg[mc->mc_top], leaf_bytes, 1)) {
+    rc = bulk_grow(bulk, mc, key);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      txn->mt_flags |= MDBX_TXN_ERROR;
+      return rc;
     }
   }
+
+add:;
+  const size_t nkeys = page_numkeys(mc->mc_pg[mc->mc_top]);
+  rc = node_add_leaf(mc, nkeys, key, (MDBX_val *)data, nflags);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    txn->mt_flags |= MDBX_TXN_ERROR;
+    return rc;
+  }
+  mc->mc_ki[mc->mc_top] = (indx_t)nkeys;
+  mc->mc_db->md_entries += 1;
+  return MDBX_SUCCESS;
+}
+
+int mdbx_bulk_finish(MDBX_bulk *bulk) {
+  if (unlikely(!bulk))
+    return MDBX_EINVAL;
+
+  MDBX_cursor *const mc = bulk->cursor;
+  const int rc = (mc->mc_signature == MDBX_MC_LIVE)
+                     ? check_txn_rw(mc->mc_txn, MDBX_TXN_BLOCKED)
+                     : MDBX_BAD_TXN;
+  mdbx_cursor_close(mc);
+  osal_free(bulk);
   return rc;
 }
 
-__cold static int cursor_check(const MDBX_cursor *mc) {
-  if (!mc->mc_txn->tw.dirtylist) {
-    cASSERT(mc,
-            (mc->mc_txn->mt_flags & MDBX_WRITEMAP) != 0 && !MDBX_AVOID_MSYNC);
-  } else {
-    cASSERT(mc,
-            (mc->mc_txn->mt_flags & MDBX_WRITEMAP) == 0 || MDBX_AVOID_MSYNC);
-    cASSERT(mc, mc->mc_txn->tw.dirtyroom + mc->mc_txn->tw.dirtylist->length ==
-                    (mc->mc_txn->mt_parent
-                         ? mc->mc_txn->mt_parent->tw.dirtyroom
-                         : mc->mc_txn->mt_env->me_options.dp_limit));
+/**** STREAMING PUT ***********************************************************/
+
+/* Значения не длиннее этого накапливаются в памяти целиком и затем
+ * сохраняются обычным образом, а для более длинных (без MDBX_WRITEMAP) это
+ * размер буфера для записи large-страниц непосредственно в файл. */
+#define STREAM_BUFFER_BYTES ((size_t)1 << 20)
+
+struct MDBX_stream {
+  MDBX_cursor *cursor;
+  MDBX_val key;
+  size_t length;   /* полный размер значения */
+  size_t written;  /* объем уже полученных данных */
+  uint8_t *buf;    /* буфер, для коротких значений это всё значение */
+  size_t capacity; /* размер буфера */
+  size_t fill; /* объем данных в буфере, включая заголовок первой страницы */
+  pgno_t pgno; /* первая из large-страниц, либо 0 после сохранения */
+  pgno_t npages;  /* количество large-страниц, либо 0 для коротких значений */
+  pgno_t flushed; /* количество large-страниц, уже записанных в файл */
+  MDBX_put_flags_t flags;
+};
+
+/* Формирует в буфере заголовок первой large-страницы */
+static MDBX_page *stream_head(MDBX_stream *stream) {
+  MDBX_page *const head = (MDBX_page *)stream->buf;
+  memset(head, 0, PAGEHDRSZ);
+  head->mp_txnid = stream->cursor->mc_txn->mt_txnid;
+  head->mp_flags = P_OVERFLOW;
+  head->mp_pgno = stream->pgno;
+  head->mp_pages = stream->npages;
+  return head;
+}
+
+/* Записывает заполненную часть буфера в файл, в том числе последнюю неполную
+ * страницу, дополняя её нулями. Страницы уже учтены как вытесненные (spilled),
+ * поэтому далее читаются через отображение как и прочие такие страницы. */
+static int stream_flush(MDBX_stream *stream) {
+  MDBX_txn *const txn = stream->cursor->mc_txn;
+  MDBX_env *const env = txn->mt_env;
+  const size_t bytes = ceil_powerof2(stream->fill, env->me_psize);
+  memset(stream->buf + stream->fill, 0, bytes - stream->fill);
+  const size_t offset = pgno2bytes(env, stream->pgno + stream->flushed);
+  tASSERT(txn, stream->flushed + bytes2pgno(env, bytes) <= stream->npages);
+  const int err = osal_pwrite(env->me_lazy_fd, stream->buf, bytes, offset);
+  if (unlikely(err != MDBX_SUCCESS)) {
+    txn->mt_flags |= MDBX_TXN_ERROR;
+    return err;
   }
-  cASSERT(mc, mc->mc_top == mc->mc_snum - 1 || (mc->mc_checking & CC_UPDATING));
-  if (unlikely(mc->mc_top != mc->mc_snum - 1) &&
-      (mc->mc_checking & CC_UPDATING) == 0)
-    return MDBX_CURSOR_FULL;
-  cASSERT(mc, (mc->mc_checking & CC_UPDATING)
-                  ? mc->mc_snum <= mc->mc_db->md_depth
-                  : mc->mc_snum == mc->mc_db->md_depth);
-  if (unlikely((mc->mc_checking & CC_UPDATING)
-                   ? mc->mc_snum > mc->mc_db->md_depth
-                   : mc->mc_snum != mc->mc_db->md_depth))
-    return MDBX_CURSOR_FULL;
+  osal_flush_incoherent_mmap(ptr_disp(env->me_map, offset), bytes,
+                             env->me_os_psize);
+#if MDBX_ENABLE_PGOP_STAT
+  env->me_lck->mti_pgop_stat.wops.weak += 1;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+  env->me_lck->mti_unsynced_pages.weak += bytes2pgno(env, bytes);
+  stream->flushed += (pgno_t)bytes2pgno(env, bytes);
+  stream->fill = 0;
+  return MDBX_SUCCESS;
+}
 
-  for (int n = 0; n < (int)mc->mc_snum; ++n) {
-    MDBX_page *mp = mc->mc_pg[n];
-    const size_t nkeys = page_numkeys(mp);
-    const bool expect_branch = (n < mc->mc_db->md_depth - 1) ? true : false;
-    const bool expect_nested_leaf =
-        (n + 1 == mc->mc_db->md_depth - 1) ? true : false;
-    const bool branch = IS_BRANCH(mp) ? true : false;
-    cASSERT(mc, branch == expect_branch);
-    if (unlikely(branch != expect_branch))
-      return MDBX_CURSOR_FULL;
-    if ((mc->mc_checking & CC_UPDATING) == 0) {
-      cASSERT(mc, nkeys > mc->mc_ki[n] || (!branch && nkeys == mc->mc_ki[n] &&
-                                           (mc->mc_flags & C_EOF) != 0));
-      if (unlikely(nkeys <= mc->mc_ki[n] &&
-                   !(!branch && nkeys == mc->mc_ki[n] &&
-                     (mc->mc_flags & C_EOF) != 0)))
-        return MDBX_CURSOR_FULL;
-    } else {
-      cASSERT(mc, nkeys + 1 >= mc->mc_ki[n]);
-      if (unlikely(nkeys + 1 < mc->mc_ki[n]))
-        return MDBX_CURSOR_FULL;
-    }
+static int stream_setup(MDBX_stream *stream) {
+  MDBX_cursor *const mc = stream->cursor;
+  MDBX_txn *const txn = mc->mc_txn;
+  MDBX_env *const env = txn->mt_env;
+  if (unlikely(stream->key.iov_len < mc->mc_dbx->md_klen_min ||
+               stream->key.iov_len > mc->mc_dbx->md_klen_max ||
+               stream->length < mc->mc_dbx->md_vlen_min ||
+               stream->length > mc->mc_dbx->md_vlen_max))
+    return MDBX_BAD_VALSIZE;
+  if (unlikely((mc->mc_db->md_flags & MDBX_INTEGERKEY) &&
+               stream->key.iov_len != 4 && stream->key.iov_len != 8))
+    return MDBX_BAD_VALSIZE;
 
-    int err = page_check(mc, mp);
+  if (stream->flags & MDBX_NOOVERWRITE) {
+    MDBX_val present;
+    const int err = cursor_set(mc, &stream->key, &present, MDBX_SET).err;
+    if (err != MDBX_NOTFOUND)
+      return (err == MDBX_SUCCESS) ? MDBX_KEYEXIST : err;
+  }
+
+  if (stream->length <= STREAM_BUFFER_BYTES) {
+    stream->capacity = stream->length;
+    stream->buf = osal_malloc(stream->length ? stream->length : 1);
+    return stream->buf ? MDBX_SUCCESS : MDBX_ENOMEM;
+  }
+
+  if ((env->me_flags & MDBX_WRITEMAP) == 0) {
+    stream->capacity = STREAM_BUFFER_BYTES;
+    stream->buf = osal_malloc(stream->capacity);
+    if (unlikely(!stream->buf))
+      return MDBX_ENOMEM;
+  }
+
+  if (unlikely((*mc->mc_dbistate & DBI_DIRTY) == 0)) {
+    const int err = touch_dbi(mc);
     if (unlikely(err != MDBX_SUCCESS))
       return err;
+  }
 
-    for (size_t i = 0; i < nkeys; ++i) {
-      if (branch) {
-        MDBX_node *node = page_node(mp, i);
-        cASSERT(mc, node_flags(node) == 0);
-        if (unlikely(node_flags(node) != 0))
-          return MDBX_CURSOR_FULL;
-        pgno_t pgno = node_pgno(node);
-        MDBX_page *np;
-        err = page_get(mc, pgno, &np, mp->mp_txnid);
-        cASSERT(mc, err == MDBX_SUCCESS);
-        if (unlikely(err != MDBX_SUCCESS))
-          return err;
-        const bool nested_leaf = IS_LEAF(np) ? true : false;
-        cASSERT(mc, nested_leaf == expect_nested_leaf);
-        if (unlikely(nested_leaf != expect_nested_leaf))
-          return MDBX_CURSOR_FULL;
-        err = page_check(mc, np);
-        if (unlikely(err != MDBX_SUCCESS))
-          return err;
-      }
+  const size_t npages = number_of_ovpages(env, stream->length);
+  pgr_t lp;
+  if (env->me_flags & MDBX_WRITEMAP)
+    lp = page_new_large(mc, npages);
+  else {
+    /* Страницы сразу учитываются как вытесненные, без выделения памяти под
+     * грязные страницы, а данные записываются в файл через буфер. */
+    lp = page_alloc_slowpath(mc, npages, MDBX_ALLOC_SPILLED);
+    if (likely(lp.err == MDBX_SUCCESS)) {
+#if MDBX_ENABLE_PGOP_STAT
+      env->me_lck->mti_pgop_stat.newly.weak += npages;
+#endif /* MDBX_ENABLE_PGOP_STAT */
+      mc->mc_db->md_overflow_pages += (pgno_t)npages;
     }
   }
+  if (unlikely(lp.err != MDBX_SUCCESS))
+    return lp.err;
+
+  /* Без MDBX_WRITEMAP отображение доступно только для чтения и страница в нём
+   * еще не сформирована, поэтому номер определяется по адресу. */
+  stream->pgno = (pgno_t)bytes2pgno(env, ptr_dist(lp.page, env->me_map));
+  stream->npages = (pgno_t)npages;
+  if (stream->buf) {
+    stream_head(stream);
+    stream->fill = PAGEHDRSZ;
+  }
+  txn->tw.streams += 1;
   return MDBX_SUCCESS;
 }
 
-__cold static int cursor_check_updating(MDBX_cursor *mc) {
-  const uint8_t checking = mc->mc_checking;
-  mc->mc_checking |= CC_UPDATING;
-  const int rc = cursor_check(mc);
-  mc->mc_checking = checking;
-  return rc;
-}
+int mdbx_stream_begin(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                      size_t length, MDBX_put_flags_t flags,
+                      MDBX_stream **ret) {
+  if (unlikely(!ret))
+    return MDBX_EINVAL;
+  *ret = nullptr;
 
-int mdbx_del(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
-             const MDBX_val *data) {
   int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  if (unlikely(!key))
+  if (unlikely(!key || (flags & ~MDBX_NOOVERWRITE)))
     return MDBX_EINVAL;
 
   if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
     return MDBX_BAD_DBI;
 
-  if (unlikely(txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_BLOCKED)))
-    return (txn->mt_flags & MDBX_TXN_RDONLY) ? MDBX_EACCESS : MDBX_BAD_TXN;
+  if (unlikely(txn->mt_dbs[dbi].md_flags &
+               (MDBX_DUPSORT | MDBX_FIXEDSIZE | DB_ALIGNVALUE_FLAGS)))
+    return MDBX_INCOMPATIBLE;
 
-  return delete (txn, dbi, key, data, 0);
+  /* Страницы разделенной транзакции не могут вытесняться */
+  if (unlikely(txn->mt_flags & MDBX_TXN_DISJOINT))
+    return MDBX_INCOMPATIBLE;
+
+  MDBX_stream *const stream =
+      osal_calloc(1, sizeof(MDBX_stream) + key->iov_len);
+  if (unlikely(!stream))
+    return MDBX_ENOMEM;
+  stream->key.iov_base = ptr_disp(stream, sizeof(MDBX_stream));
+  stream->key.iov_len = key->iov_len;
+  if (key->iov_len)
+    memcpy(stream->key.iov_base, key->iov_base, key->iov_len);
+  stream->length = length;
+  stream->flags = flags;
+
+  rc = mdbx_cursor_open(txn, dbi, &stream->cursor);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    osal_free(stream);
+    return rc;
+  }
+
+  rc = stream_setup(stream);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    mdbx_cursor_close(stream->cursor);
+    osal_free(stream->buf);
+    osal_free(stream);
+    return rc;
+  }
+
+  *ret = stream;
+  return MDBX_SUCCESS;
 }
 
-static int delete(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
-                  const MDBX_val *data, unsigned flags) {
-  MDBX_cursor_couple cx;
-  MDBX_cursor_op op;
-  MDBX_val rdata;
-  int rc;
-  DKBUF_DEBUG;
+int mdbx_stream_write(MDBX_stream *stream, const void *chunk, size_t bytes) {
+  if (unlikely(!stream || (!chunk && bytes)))
+    return MDBX_EINVAL;
 
-  DEBUG("====> delete db %u key [%s], data [%s]", dbi, DKEY_DEBUG(key),
-        DVAL_DEBUG(data));
+  MDBX_cursor *const mc = stream->cursor;
+  if (unlikely(mc->mc_signature != MDBX_MC_LIVE))
+    return MDBX_BAD_TXN;
 
-  rc = cursor_init(&cx.outer, txn, dbi);
+  MDBX_txn *const txn = mc->mc_txn;
+  int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  if (data) {
-    op = MDBX_GET_BOTH;
-    rdata = *data;
-    data = &rdata;
-  } else {
-    op = MDBX_SET;
-    flags |= MDBX_ALLDUPS;
+  if (unlikely(bytes > stream->length - stream->written))
+    return MDBX_EINVAL;
+
+  MDBX_env *const env = txn->mt_env;
+  if (!stream->npages || (env->me_flags & MDBX_WRITEMAP)) {
+    /* Отображение может быть перемещено при росте БД,
+     * поэтому адрес страницы получается заново. */
+    void *const dest =
+        stream->npages
+            ? ptr_disp(page_data(pgno2page(env, stream->pgno)), stream->written)
+            : ptr_disp(stream->buf, stream->written);
+    memcpy(dest, chunk, bytes);
+    stream->written += bytes;
+    return MDBX_SUCCESS;
   }
-  rc = cursor_set(&cx.outer, (MDBX_val *)key, (MDBX_val *)data, op).err;
-  if (likely(rc == MDBX_SUCCESS)) {
-    /* let mdbx_page_split know about this cursor if needed:
-     * delete will trigger a rebalance; if it needs to move
-     * a node from one page to another, it will have to
-     * update the parent's separator key(s). If the new sepkey
-     * is larger than the current one, the parent page may
-     * run out of space, triggering a split. We need this
-     * cursor to be consistent until the end of the rebalance. */
-    cx.outer.mc_next = txn->mt_cursors[dbi];
-    txn->mt_cursors[dbi] = &cx.outer;
-    rc = cursor_del(&cx.outer, flags);
-    txn->mt_cursors[dbi] = cx.outer.mc_next;
+
+  while (bytes) {
+    const size_t left = stream->capacity - stream->fill;
+    const size_t n = (left < bytes) ? left : bytes;
+    memcpy(stream->buf + stream->fill, chunk, n);
+    chunk = ptr_disp(chunk, n);
+    bytes -= n;
+    stream->fill += n;
+    stream->written += n;
+    if (stream->fill == stream->capacity) {
+      rc = stream_flush(stream);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
   }
-  return rc;
+  return MDBX_SUCCESS;
 }
 
-/* Split a page and insert a new node.
- * Set MDBX_TXN_ERROR on failure.
- * [in,out] mc Cursor pointing to the page and desired insertion index.
- * The cursor will be updated to point to the actual page and index where
- * the node got inserted after the split.
- * [in] newkey The key for the newly inserted node.
- * [in] newdata The data for the newly inserted node.
- * [in] newpgno The page number, if the new node is a branch node.
- * [in] naf The NODE_ADD_FLAGS for the new node.
- * Returns 0 on success, non-zero on failure. */
-static int page_split(MDBX_cursor *mc, const MDBX_val *const newkey,
-                      MDBX_val *const newdata, pgno_t newpgno,
-                      const unsigned naf) {
-  unsigned flags;
-  int rc = MDBX_SUCCESS, foliage = 0;
-  size_t i, ptop;
-  MDBX_env *const env = mc->mc_txn->mt_env;
-  MDBX_val rkey, xdata;
-  MDBX_page *tmp_ki_copy = NULL;
-  DKBUF;
+static int stream_store(MDBX_stream *stream) {
+  MDBX_cursor *const mc = stream->cursor;
+  MDBX_val data;
+  if (!stream->npages) {
+    data.iov_base = stream->buf;
+    data.iov_len = stream->length;
+    return cursor_put_checklen(mc, &stream->key, &data, stream->flags);
+  }
 
-  MDBX_page *const mp = mc->mc_pg[mc->mc_top];
-  const size_t newindx = mc->mc_ki[mc->mc_top];
-  size_t nkeys = page_numkeys(mp);
-  if (AUDIT_ENABLED()) {
-    rc = cursor_check_updating(mc);
+  int rc;
+  if (stream->fill) {
+    rc = stream_flush(stream);
     if (unlikely(rc != MDBX_SUCCESS))
       return rc;
   }
-  STATIC_ASSERT(P_BRANCH == 1);
-  const size_t minkeys = (mp->mp_flags & P_BRANCH) + (size_t)1;
-
-  DEBUG(">> splitting %s-page %" PRIaPGNO
-        " and adding %zu+%zu [%s] at %i, nkeys %zi",
-        IS_LEAF(mp) ? "leaf" : "branch", mp->mp_pgno, newkey->iov_len,
-        newdata ? newdata->iov_len : 0, DKEY_DEBUG(newkey),
-        mc->mc_ki[mc->mc_top], nkeys);
-  cASSERT(mc, nkeys + 1 >= minkeys * 2);
-
-  /* Create a new sibling page. */
-  pgr_t npr = page_new(mc, mp->mp_flags);
-  if (unlikely(npr.err != MDBX_SUCCESS))
-    return npr.err;
-  MDBX_page *const sister = npr.page;
-  sister->mp_leaf2_ksize = mp->mp_leaf2_ksize;
-  DEBUG("new sibling: page %" PRIaPGNO, sister->mp_pgno);
+  cASSERT(mc, (mc->mc_txn->mt_flags & MDBX_WRITEMAP) ||
+                  stream->flushed == stream->npages);
 
-  /* Usually when splitting the root page, the cursor
-   * height is 1. But when called from update_key,
-   * the cursor height may be greater because it walks
-   * up the stack while finding the branch slot to update. */
-  if (mc->mc_top < 1) {
-    npr = page_new(mc, P_BRANCH);
-    rc = npr.err;
+  /* Имеющееся значение удаляется, а узел добавляется заново
+   * со ссылкой на уже заполненные large-страницы. */
+  rc = cursor_set(mc, &stream->key, &data, MDBX_SET).err;
+  if (rc == MDBX_SUCCESS) {
+    if (stream->flags & MDBX_NOOVERWRITE)
+      return MDBX_KEYEXIST;
+    rc = cursor_del(mc, 0);
     if (unlikely(rc != MDBX_SUCCESS))
-      goto done;
-    MDBX_page *const pp = npr.page;
-    /* shift current top to make room for new parent */
-    cASSERT(mc, mc->mc_snum < 2 && mc->mc_db->md_depth > 0);
-#if MDBX_DEBUG
-    memset(mc->mc_pg + 3, 0, sizeof(mc->mc_pg) - sizeof(mc->mc_pg[0]) * 3);
-    memset(mc->mc_ki + 3, -1, sizeof(mc->mc_ki) - sizeof(mc->mc_ki[0]) * 3);
-#endif
-    mc->mc_pg[2] = mc->mc_pg[1];
-    mc->mc_ki[2] = mc->mc_ki[1];
-    mc->mc_pg[1] = mc->mc_pg[0];
-    mc->mc_ki[1] = mc->mc_ki[0];
-    mc->mc_pg[0] = pp;
-    mc->mc_ki[0] = 0;
-    mc->mc_db->md_root = pp->mp_pgno;
-    DEBUG("root split! new root = %" PRIaPGNO, pp->mp_pgno);
-    foliage = mc->mc_db->md_depth++;
+      return rc;
+  } else if (unlikely(rc != MDBX_NOTFOUND))
+    return rc;
+
+  const pgno_t pgno = stream->pgno;
+  data.iov_base = (void *)&pgno;
+  data.iov_len = stream->length;
+  rc = cursor_put_checklen(mc, &stream->key, &data, F_BIGDATA);
+  if (likely(rc == MDBX_SUCCESS))
+    stream->pgno = 0;
+  return rc;
+}
 
-    /* Add left (implicit) pointer. */
-    rc = node_add_branch(mc, 0, NULL, mp->mp_pgno);
-    if (unlikely(rc != MDBX_SUCCESS)) {
-      /* undo the pre-push */
-      mc->mc_pg[0] = mc->mc_pg[1];
-      mc->mc_ki[0] = mc->mc_ki[1];
-      mc->mc_db->md_root = mp->mp_pgno;
-      mc->mc_db->md_depth--;
-      goto done;
-    }
-    mc->mc_snum++;
-    mc->mc_top++;
-    ptop = 0;
-    if (AUDIT_ENABLED()) {
-      rc = cursor_check_updating(mc);
-      if (unlikely(rc != MDBX_SUCCESS))
-        goto done;
+int mdbx_stream_finish(MDBX_stream *stream, bool discard) {
+  if (unlikely(!stream))
+    return MDBX_EINVAL;
+
+  MDBX_cursor *const mc = stream->cursor;
+  int rc = (mc->mc_signature == MDBX_MC_LIVE)
+               ? check_txn_rw(mc->mc_txn, MDBX_TXN_BLOCKED)
+               : MDBX_BAD_TXN;
+  if (likely(rc == MDBX_SUCCESS)) {
+    if (!discard)
+      rc = (stream->written == stream->length) ? stream_store(stream)
+                                               : MDBX_EINVAL;
+    if (stream->npages) {
+      MDBX_txn *const txn = mc->mc_txn;
+      if (stream->pgno && (txn->mt_flags & MDBX_TXN_ERROR) == 0) {
+        /* Без MDBX_WRITEMAP заголовок в файле может быть ещё не записан */
+        MDBX_page *const mp = (txn->mt_flags & MDBX_WRITEMAP)
+                                  ? pgno2page(txn->mt_env, stream->pgno)
+                                  : stream_head(stream);
+        const int err = page_retire(mc, mp);
+        rc = (rc == MDBX_SUCCESS) ? err : rc;
+      }
+      tASSERT(txn, txn->tw.streams > 0);
+      txn->tw.streams -= 1;
     }
-  } else {
-    ptop = mc->mc_top - 1;
-    DEBUG("parent branch page is %" PRIaPGNO, mc->mc_pg[ptop]->mp_pgno);
   }
 
-  MDBX_cursor mn;
-  cursor_copy(mc, &mn);
-  mn.mc_pg[mn.mc_top] = sister;
-  mn.mc_ki[mn.mc_top] = 0;
-  mn.mc_ki[ptop] = mc->mc_ki[ptop] + 1;
+  mdbx_cursor_close(mc);
+  osal_free(stream->buf);
+  osal_free(stream);
+  return rc;
+}
 
-  size_t split_indx =
-      (newindx < nkeys)
-          ? /* split at the middle */ (nkeys + 1) >> 1
-          : /* split at the end (i.e. like append-mode ) */ nkeys - minkeys + 1;
-  eASSERT(env, split_indx >= minkeys && split_indx <= nkeys - minkeys + 1);
+/**** VALUE LOG ***************************************************************/
 
-  cASSERT(mc, !IS_BRANCH(mp) || newindx > 0);
-  MDBX_val sepkey = {nullptr, 0};
-  /* It is reasonable and possible to split the page at the begin */
-  if (unlikely(newindx < minkeys)) {
-    split_indx = minkeys;
-    if (newindx == 0 && foliage == 0 && !(naf & MDBX_SPLIT_REPLACE)) {
-      split_indx = 0;
-      /* Checking for ability of splitting by the left-side insertion
-       * of a pure page with the new key */
-      for (i = 0; i < mc->mc_top; ++i)
-        if (mc->mc_ki[i]) {
-          get_key(page_node(mc->mc_pg[i], mc->mc_ki[i]), &sepkey);
-          if (mc->mc_dbx->md_cmp(newkey, &sepkey) >= 0)
-            split_indx = minkeys;
-          break;
-        }
-      if (split_indx == 0) {
-        /* Save the current first key which was omitted on the parent branch
-         * page and should be updated if the new first entry will be added */
-        if (IS_LEAF2(mp)) {
-          sepkey.iov_len = mp->mp_leaf2_ksize;
-          sepkey.iov_base = page_leaf2key(mp, 0, sepkey.iov_len);
-        } else
-          get_key(page_node(mp, 0), &sepkey);
-        cASSERT(mc, mc->mc_dbx->md_cmp(newkey, &sepkey) < 0);
-        /* Avoiding rare complex cases of split the parent page */
-        if (page_room(mn.mc_pg[ptop]) < branch_size(env, &sepkey))
-          split_indx = minkeys;
-      }
+/* Журнал значений - файл рядом с файлом БД, в конец которого дописываются
+ * длинные значения таблиц с заданным mdbx_dbi_set_vlog() порогом. В самой
+ * таблице сохраняется только ссылка, оформленная как значение сжатое кодеком
+ * вида CODEC_VLOG, поэтому она читается через codec_decode() наравне со
+ * сжатыми значениями.
+ *
+ * Каждое значение в журнале предваряется заголовком с именем таблицы и
+ * ключом, что позволяет при сборке мусора найти ссылку и проверить
+ * актуальность записи. Журнал разбит на сегменты, для которых во внутренней
+ * таблице (индексе) ведется учет объема живых записей. Запись относится
+ * к сегменту, в котором она начинается. Изменения учета копятся в транзакции
+ * и переносятся в индекс при её фиксации, а конец журнала определяется по
+ * последнему сегменту в индексе. Поэтому всё записанное в журнал после конца
+ * согласно индексу является мусором от прерванных транзакций и отрезается. */
+#define VLOG_MAGIC UINT32_C(0x474C5676)
+#define VLOG_INDEX_NAME "@vlog"
+
+typedef struct vlog_record {
+  uint32_t magic;
+  uint32_t checksum; /* контрольная сумма значения */
+  uint32_t length;   /* длина значения */
+  uint16_t name_len; /* длина имени таблицы */
+  uint16_t key_len;  /* длина ключа */
+} vlog_record_t;
+
+/* Учетная запись сегмента в индексе, ключом является номер сегмента */
+typedef struct vlog_segment {
+  uint64_t first;  /* начало первой записи сегмента */
+  uint64_t end;    /* конец последней записи сегмента */
+  uint64_t live;   /* объем живых записей, может быть завышен */
+  txnid_t retired; /* транзакция переместившая живые записи, либо 0 */
+} vlog_segment_t;
+
+typedef struct vlog_delta {
+  uint64_t segment, first, end;
+  int64_t live;
+} vlog_delta_t;
+
+static uint32_t vlog_checksum(const void *data, size_t bytes) {
+  const uint8_t *ptr = data;
+  uint64_t h = UINT64_C(0x9E3779B97F4A7C15) ^ bytes;
+  for (; bytes >= 8; bytes -= 8, ptr += 8) {
+    h ^= unaligned_peek_u64(1, ptr) * UINT64_C(0x87C37B91114253D5);
+    h = (h << 31 | h >> 33) * UINT64_C(0x4CF5AD432745937F);
+  }
+  uint64_t tail = 0;
+  while (bytes)
+    tail = tail << 8 | ptr[--bytes];
+  h ^= tail * UINT64_C(0x87C37B91114253D5);
+  h = (h ^ h >> 33) * UINT64_C(0xFF51AFD7ED558CCD);
+  h = (h ^ h >> 33) * UINT64_C(0xC4CEB9FE1A85EC53);
+  return (uint32_t)(h ^ h >> 32);
+}
+
+/* Файл открывается по первой необходимости, а создается только для записи.
+ * Для этого используется отдельная блокировка, так как сброс журнала может
+ * потребоваться при выделении страниц, в том числе внутри mdbx_dbi_open()
+ * при удерживаемой me_dbi_lock. */
+static int vlog_open(MDBX_env *env, bool create) {
+  if (likely(env->me_vlog.fd != INVALID_HANDLE_VALUE))
+    return MDBX_SUCCESS;
+  if (unlikely(!env->me_vlog.pathname))
+    return MDBX_ENOFILE;
+
+  int rc = osal_fastmutex_acquire(&env->me_vlog.lock);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (env->me_vlog.fd == INVALID_HANDLE_VALUE) {
+    mdbx_filehandle_t fd = INVALID_HANDLE_VALUE;
+    rc = osal_openfile((env->me_flags & MDBX_RDONLY) ? MDBX_OPEN_DXB_READ
+                                                     : MDBX_OPEN_DXB_LAZY,
+                       env, env->me_vlog.pathname, &fd,
+                       create ? env->me_vlog.mode : 0);
+    if (likely(rc == MDBX_SUCCESS)) {
+      osal_memory_fence(mo_AcquireRelease, true);
+      env->me_vlog.fd = fd;
     }
   }
+  ENSURE(env, osal_fastmutex_release(&env->me_vlog.lock) == MDBX_SUCCESS);
+  return rc;
+}
 
-  const bool pure_right = split_indx == nkeys;
-  const bool pure_left = split_indx == 0;
-  if (unlikely(pure_right)) {
-    /* newindx == split_indx == nkeys */
-    TRACE("no-split, but add new pure page at the %s", "right/after");
-    cASSERT(mc, newindx == nkeys && split_indx == nkeys && minkeys == 1);
-    sepkey = *newkey;
-  } else if (unlikely(pure_left)) {
-    /* newindx == split_indx == 0 */
-    TRACE("no-split, but add new pure page at the %s", "left/before");
-    cASSERT(mc, newindx == 0 && split_indx == 0 && minkeys == 1);
-    TRACE("old-first-key is %s", DKEY_DEBUG(&sepkey));
-  } else {
-    if (IS_LEAF2(sister)) {
-      /* Move half of the keys to the right sibling */
-      const intptr_t distance = mc->mc_ki[mc->mc_top] - split_indx;
-      size_t ksize = mc->mc_db->md_xsize;
-      void *const split = page_leaf2key(mp, split_indx, ksize);
-      size_t rsize = (nkeys - split_indx) * ksize;
-      size_t lsize = (nkeys - split_indx) * sizeof(indx_t);
-      cASSERT(mc, mp->mp_lower >= lsize);
-      mp->mp_lower -= (indx_t)lsize;
-      cASSERT(mc, sister->mp_lower + lsize <= UINT16_MAX);
-      sister->mp_lower += (indx_t)lsize;
-      cASSERT(mc, mp->mp_upper + rsize - lsize <= UINT16_MAX);
-      mp->mp_upper += (indx_t)(rsize - lsize);
-      cASSERT(mc, sister->mp_upper >= rsize - lsize);
-      sister->mp_upper -= (indx_t)(rsize - lsize);
-      sepkey.iov_len = ksize;
-      sepkey.iov_base = (newindx != split_indx) ? split : newkey->iov_base;
-      if (distance < 0) {
-        cASSERT(mc, ksize >= sizeof(indx_t));
-        void *const ins = page_leaf2key(mp, mc->mc_ki[mc->mc_top], ksize);
-        memcpy(sister->mp_ptrs, split, rsize);
-        sepkey.iov_base = sister->mp_ptrs;
-        memmove(ptr_disp(ins, ksize), ins,
-                (split_indx - mc->mc_ki[mc->mc_top]) * ksize);
-        memcpy(ins, newkey->iov_base, ksize);
-        cASSERT(mc, UINT16_MAX - mp->mp_lower >= (int)sizeof(indx_t));
-        mp->mp_lower += sizeof(indx_t);
-        cASSERT(mc, mp->mp_upper >= ksize - sizeof(indx_t));
-        mp->mp_upper -= (indx_t)(ksize - sizeof(indx_t));
-      } else {
-        memcpy(sister->mp_ptrs, split, distance * ksize);
-        void *const ins = page_leaf2key(sister, distance, ksize);
-        memcpy(ins, newkey->iov_base, ksize);
-        memcpy(ptr_disp(ins, ksize), ptr_disp(split, distance * ksize),
-               rsize - distance * ksize);
-        cASSERT(mc, UINT16_MAX - sister->mp_lower >= (int)sizeof(indx_t));
-        sister->mp_lower += sizeof(indx_t);
-        cASSERT(mc, sister->mp_upper >= ksize - sizeof(indx_t));
-        sister->mp_upper -= (indx_t)(ksize - sizeof(indx_t));
-        cASSERT(mc, distance <= (int)UINT16_MAX);
-        mc->mc_ki[mc->mc_top] = (indx_t)distance;
-      }
+static int vlog_sync(MDBX_env *env) {
+  /* Файл также сбрасывается при наличии, но без записей в этом процессе,
+   * так как они могли быть сделаны другим процессом в режиме
+   * MDBX_SAFE_NOSYNC. */
+  int rc = vlog_open(env, false);
+  if (rc == MDBX_ENOFILE)
+    return MDBX_SUCCESS;
+  if (likely(rc == MDBX_SUCCESS))
+    rc = osal_fsync(env->me_vlog.fd, MDBX_SYNC_DATA | MDBX_SYNC_SIZE);
+  return rc;
+}
 
-      if (AUDIT_ENABLED()) {
-        rc = cursor_check_updating(mc);
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto done;
-        rc = cursor_check_updating(&mn);
-        if (unlikely(rc != MDBX_SUCCESS))
-          goto done;
-      }
-    } else {
-      /* grab a page to hold a temporary copy */
-      tmp_ki_copy = page_malloc(mc->mc_txn, 1);
-      if (unlikely(tmp_ki_copy == NULL)) {
-        rc = MDBX_ENOMEM;
-        goto done;
-      }
+/* Возвращает дескриптор индекса, если он открыт в транзакции */
+static int vlog_index(MDBX_txn *txn, MDBX_dbi *dbi) {
+  const MDBX_dbi i = txn->mt_env->me_vlog.dbi;
+  if (likely(i >= CORE_DBS && check_dbi(txn, i, DBI_USRVALID))) {
+    const MDBX_val *const name = &txn->mt_dbxs[i].md_name;
+    if (likely(name->iov_len == sizeof(VLOG_INDEX_NAME) - 1 &&
+               memcmp(name->iov_base, VLOG_INDEX_NAME, name->iov_len) == 0)) {
+      *dbi = i;
+      return MDBX_SUCCESS;
+    }
+  }
+  return MDBX_BAD_DBI;
+}
+
+static int vlog_account(MDBX_txn *txn, uint64_t offset, int64_t bytes) {
+  const uint64_t segment = offset / MDBX_VLOG_SEGMENT_SIZE;
+  vlog_delta_t *delta = txn->tw.vlog.deltas + txn->tw.vlog.deltas_count;
+  while (delta > txn->tw.vlog.deltas && delta[-1].segment != segment)
+    --delta;
+  if (delta == txn->tw.vlog.deltas) {
+    if (txn->tw.vlog.deltas_count == txn->tw.vlog.deltas_limit) {
+      const size_t limit =
+          txn->tw.vlog.deltas_limit ? txn->tw.vlog.deltas_limit * 2 : 8;
+      vlog_delta_t *const deltas =
+          osal_realloc(txn->tw.vlog.deltas, limit * sizeof(vlog_delta_t));
+      if (unlikely(!deltas))
+        return MDBX_ENOMEM;
+      txn->tw.vlog.deltas = deltas;
+      txn->tw.vlog.deltas_limit = limit;
+    }
+    delta = txn->tw.vlog.deltas + txn->tw.vlog.deltas_count++;
+    delta->segment = segment;
+    delta->first = UINT64_MAX;
+    delta->end = 0;
+    delta->live = 0;
+  } else
+    delta -= 1;
 
-      const size_t max_space = page_space(env);
-      const size_t new_size = IS_LEAF(mp) ? leaf_size(env, newkey, newdata)
-                                          : branch_size(env, newkey);
+  delta->live += bytes;
+  if (bytes > 0) {
+    if (delta->first > offset)
+      delta->first = offset;
+    if (delta->end < offset + bytes)
+      delta->end = offset + bytes;
+  }
+  return MDBX_SUCCESS;
+}
 
-      /* prepare to insert */
-      for (i = 0; i < newindx; ++i)
-        tmp_ki_copy->mp_ptrs[i] = mp->mp_ptrs[i];
-      tmp_ki_copy->mp_ptrs[i] = (indx_t)-1;
-      while (++i <= nkeys)
-        tmp_ki_copy->mp_ptrs[i] = mp->mp_ptrs[i - 1];
-      tmp_ki_copy->mp_pgno = mp->mp_pgno;
-      tmp_ki_copy->mp_flags = mp->mp_flags;
-      tmp_ki_copy->mp_txnid = INVALID_TXNID;
-      tmp_ki_copy->mp_lower = 0;
-      tmp_ki_copy->mp_upper = (indx_t)max_space;
+/* Загружает из индекса положение конца журнала, отрезая мусор за ним */
+static int vlog_prepare(MDBX_txn *txn) {
+  if (likely(txn->tw.vlog.known))
+    return MDBX_SUCCESS;
 
-      /* Добавляемый узел может не поместиться в страницу-половину вместе
-       * с количественной половиной узлов из исходной страницы. В худшем случае,
-       * в страницу-половину с добавляемым узлом могут попасть самые больше узлы
-       * из исходной страницы, а другую половину только узлы с самыми короткими
-       * ключами и с пустыми данными. Поэтому, чтобы найти подходящую границу
-       * разреза требуется итерировать узлы и считая их объем.
-       *
-       * Однако, при простом количественном делении (без учета размера ключей
-       * и данных) на страницах-половинах будет примерно вдвое меньше узлов.
-       * Поэтому добавляемый узел точно поместится, если его размер не больше
-       * чем место "освобождающееся" от заголовков узлов, которые переедут
-       * в другую страницу-половину. Кроме этого, как минимум по одному байту
-       * будет в каждом ключе, в худшем случае кроме одного, который может быть
-       * нулевого размера. */
+  MDBX_dbi dbi;
+  int rc = vlog_index(txn, &dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  MDBX_env *const env = txn->mt_env;
+  rc = vlog_open(env, true);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-      if (newindx == split_indx && nkeys >= 5) {
-        STATIC_ASSERT(P_BRANCH == 1);
-        split_indx += mp->mp_flags & P_BRANCH;
-      }
-      eASSERT(env, split_indx >= minkeys && split_indx <= nkeys + 1 - minkeys);
-      const size_t dim_nodes =
-          (newindx >= split_indx) ? split_indx : nkeys - split_indx;
-      const size_t dim_used = (sizeof(indx_t) + NODESIZE + 1) * dim_nodes;
-      if (new_size >= dim_used) {
-        /* Search for best acceptable split point */
-        i = (newindx < split_indx) ? 0 : nkeys;
-        intptr_t dir = (newindx < split_indx) ? 1 : -1;
-        size_t before = 0, after = new_size + page_used(env, mp);
-        size_t best_split = split_indx;
-        size_t best_shift = INT_MAX;
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  uint64_t tail = 0;
+  MDBX_val key, data;
+  rc = cursor_last(&cx.outer, &key, &data);
+  if (rc == MDBX_SUCCESS) {
+    if (unlikely(data.iov_len != sizeof(vlog_segment_t)))
+      return MDBX_CORRUPTED;
+    tail = unaligned_peek_u64(1, ptr_disp(data.iov_base,
+                                          offsetof(vlog_segment_t, end)));
+  } else if (unlikely(rc != MDBX_NOTFOUND))
+    return rc;
 
-        TRACE("seek separator from %zu, step %zi, default %zu, new-idx %zu, "
-              "new-size %zu",
-              i, dir, split_indx, newindx, new_size);
-        do {
-          cASSERT(mc, i <= nkeys);
-          size_t size = new_size;
-          if (i != newindx) {
-            MDBX_node *node = ptr_disp(mp, tmp_ki_copy->mp_ptrs[i] + PAGEHDRSZ);
-            size = NODESIZE + node_ks(node) + sizeof(indx_t);
-            if (IS_LEAF(mp))
-              size += (node_flags(node) & F_BIGDATA) ? sizeof(pgno_t)
-                                                     : node_ds(node);
-            size = EVEN(size);
-          }
+  uint64_t filesize;
+  rc = osal_filesize(env->me_vlog.fd, &filesize);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely(filesize < tail)) {
+    ERROR("value log is shorter (%" PRIu64 ") than expected (%" PRIu64 ")",
+          filesize, tail);
+    return MDBX_CORRUPTED;
+  }
+  if (filesize > tail) {
+    NOTICE("truncate value log %" PRIu64 " -> %" PRIu64
+           " (uncommitted garbage)",
+           filesize, tail);
+    rc = osal_ftruncate(env->me_vlog.fd, tail);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
 
-          before += size;
-          after -= size;
-          TRACE("step %zu, size %zu, before %zu, after %zu, max %zu", i, size,
-                before, after, max_space);
+  txn->tw.vlog.known = true;
+  txn->tw.vlog.origin = txn->tw.vlog.tail = tail;
+  return MDBX_SUCCESS;
+}
 
-          if (before <= max_space && after <= max_space) {
-            const size_t split = i + (dir > 0);
-            if (split >= minkeys && split <= nkeys + 1 - minkeys) {
-              const size_t shift = branchless_abs(split_indx - split);
-              if (shift >= best_shift)
-                break;
-              best_shift = shift;
-              best_split = split;
-              if (!best_shift)
-                break;
-            }
-          }
-          i += dir;
-        } while (i < nkeys);
+/* Дописывает значение в журнал и формирует ссылку на него */
+static int vlog_append(MDBX_cursor *mc, const MDBX_val *key,
+                       const MDBX_val *data, uint8_t *ref) {
+  MDBX_txn *const txn = mc->mc_txn;
+  int rc = vlog_prepare(txn);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  const MDBX_val *const name = &mc->mc_dbx->md_name;
+  const size_t head = sizeof(vlog_record_t) + name->iov_len + key->iov_len;
+  if (txn->mt_codec_bufsize < head) {
+    void *const buf = osal_realloc(txn->mt_codec_buf, head);
+    if (unlikely(!buf))
+      return MDBX_ENOMEM;
+    txn->mt_codec_buf = buf;
+    txn->mt_codec_bufsize = head;
+  }
+
+  vlog_record_t *const rec = txn->mt_codec_buf;
+  rec->magic = VLOG_MAGIC;
+  rec->checksum = vlog_checksum(data->iov_base, data->iov_len);
+  rec->length = (uint32_t)data->iov_len;
+  rec->name_len = (uint16_t)name->iov_len;
+  rec->key_len = (uint16_t)key->iov_len;
+  if (name->iov_len)
+    memcpy(rec + 1, name->iov_base, name->iov_len);
+  memcpy(ptr_disp(rec + 1, name->iov_len), key->iov_base, key->iov_len);
+
+  MDBX_env *const env = txn->mt_env;
+  const uint64_t offset = txn->tw.vlog.tail;
+  rc = osal_pwrite(env->me_vlog.fd, rec, head, offset);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = osal_pwrite(env->me_vlog.fd, data->iov_base, data->iov_len,
+                     offset + head);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = vlog_account(txn, offset, head + data->iov_len);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  txn->tw.vlog.tail = offset + head + data->iov_len;
+
+  ref[0] = CODEC_VLOG;
+  unaligned_poke_u32(1, ref + 1, rec->length);
+  unaligned_poke_u64(1, ref + 5, offset + head);
+  unaligned_poke_u32(1, ref + 13, rec->checksum);
+  return MDBX_SUCCESS;
+}
 
-        split_indx = best_split;
-        TRACE("chosen %zu", split_indx);
-      }
-      eASSERT(env, split_indx >= minkeys && split_indx <= nkeys + 1 - minkeys);
+/* Читает значение из журнала в память транзакции */
+static int vlog_fetch(MDBX_cursor *mc, const MDBX_val *ref, MDBX_val *data) {
+  const uint8_t *const ptr = ref->iov_base;
+  const size_t length = (ref->iov_len == VLOG_REF_SIZE)
+                            ? unaligned_peek_u32(1, ptr + 1)
+                            : MDBX_MAXDATASIZE + 1;
+  if (unlikely(length > MDBX_MAXDATASIZE)) {
+    ERROR("invalid value log reference (%zu bytes) of table %u", ref->iov_len,
+          mc->mc_dbi);
+    return MDBX_CORRUPTED;
+  }
+  const uint64_t offset = unaligned_peek_u64(1, ptr + 5);
 
-      sepkey = *newkey;
-      if (split_indx != newindx) {
-        MDBX_node *node =
-            ptr_disp(mp, tmp_ki_copy->mp_ptrs[split_indx] + PAGEHDRSZ);
-        sepkey.iov_len = node_ks(node);
-        sepkey.iov_base = node_key(node);
-      }
-    }
+  MDBX_env *const env = mc->mc_txn->mt_env;
+  int rc = vlog_open(env, false);
+  if (unlikely(rc != MDBX_SUCCESS)) {
+    ERROR("unable open value log, error %d", rc);
+    return rc;
   }
-  DEBUG("separator is %zd [%s]", split_indx, DKEY_DEBUG(&sepkey));
+  void *const buf = codec_alloc(mc->mc_txn, length);
+  if (unlikely(!buf))
+    return MDBX_ENOMEM;
+  rc = osal_pread(env->me_vlog.fd, buf, length, offset);
+  if (unlikely(rc == MDBX_ENODATA ||
+               (rc == MDBX_SUCCESS && vlog_checksum(buf, length) !=
+                                          unaligned_peek_u32(1, ptr + 13)))) {
+    ERROR("value of table %u at %" PRIu64 " of value log is missing or damaged",
+          mc->mc_dbi, offset);
+    rc = MDBX_CORRUPTED;
+  }
+  data->iov_base = buf;
+  data->iov_len = length;
+  return rc;
+}
 
-  bool did_split_parent = false;
-  /* Copy separator key to the parent. */
-  if (page_room(mn.mc_pg[ptop]) < branch_size(env, &sepkey)) {
-    TRACE("need split parent branch-page for key %s", DKEY_DEBUG(&sepkey));
-    cASSERT(mc, page_numkeys(mn.mc_pg[ptop]) > 2);
-    cASSERT(mc, !pure_left);
-    const int snum = mc->mc_snum;
-    const int depth = mc->mc_db->md_depth;
-    mn.mc_snum--;
-    mn.mc_top--;
-    did_split_parent = true;
-    /* We want other splits to find mn when doing fixups */
-    WITH_CURSOR_TRACKING(
-        mn, rc = page_split(&mn, &sepkey, NULL, sister->mp_pgno, 0));
+/* Учитывает выбывание значения из журнала при удалении или перезаписи.
+ * Ошибки не важны, так как завышенный объем живых записей лишь откладывает
+ * сборку мусора, а актуальность записей при ней проверяется. */
+static void vlog_release(MDBX_cursor *mc, const MDBX_node *node) {
+  MDBX_txn *const txn = mc->mc_txn;
+  if ((node_flags(node) & (F_COMPRESSED | F_BIGDATA)) != F_COMPRESSED ||
+      node_ds(node) != VLOG_REF_SIZE || !txn->mt_env->me_vlog.dbi ||
+      (txn->mt_flags & MDBX_TXN_DISJOINT))
+    return;
+  const uint8_t *const ref = node_data(node);
+  if (ref[0] != CODEC_VLOG)
+    return;
+
+  const size_t head =
+      sizeof(vlog_record_t) + mc->mc_dbx->md_name.iov_len + node_ks(node);
+  const uint64_t offset = unaligned_peek_u64(1, ref + 5);
+  if (likely(offset >= head))
+    (void)vlog_account(txn, offset - head,
+                       -(int64_t)(head + unaligned_peek_u32(1, ref + 1)));
+}
+
+/* Переносит накопленные изменения учета в индекс */
+static int vlog_flush(MDBX_txn *txn) {
+  MDBX_dbi dbi;
+  int rc = vlog_index(txn, &dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  for (size_t i = 0; i < txn->tw.vlog.deltas_count; ++i) {
+    const vlog_delta_t *const delta = &txn->tw.vlog.deltas[i];
+    uint64_t segment = delta->segment;
+    MDBX_val key = {&segment, sizeof(segment)}, data;
+    vlog_segment_t seg = {UINT64_MAX, 0, 0, 0};
+    const struct cursor_set_result csr =
+        cursor_set(&cx.outer, &key, &data, MDBX_SET);
+    if (csr.err == MDBX_SUCCESS) {
+      if (unlikely(data.iov_len != sizeof(seg)))
+        return MDBX_CORRUPTED;
+      memcpy(&seg, data.iov_base, sizeof(seg));
+    } else if (unlikely(csr.err != MDBX_NOTFOUND))
+      return csr.err;
+
+    if (seg.first > delta->first)
+      seg.first = delta->first;
+    if (seg.end < delta->end)
+      seg.end = delta->end;
+    seg.live = (delta->live < 0 && (uint64_t)-delta->live > seg.live)
+                   ? 0
+                   : seg.live + delta->live;
+    if (unlikely(seg.end == 0))
+      /* только выбывание из уже освобожденного сегмента */
+      continue;
+    data.iov_base = &seg;
+    data.iov_len = sizeof(seg);
+    WITH_CURSOR_TRACKING(cx.outer,
+                         rc = cursor_put_nochecklen(&cx.outer, &key, &data, 0));
     if (unlikely(rc != MDBX_SUCCESS))
-      goto done;
-    cASSERT(mc, (int)mc->mc_snum - snum == mc->mc_db->md_depth - depth);
-    if (AUDIT_ENABLED()) {
-      rc = cursor_check_updating(mc);
-      if (unlikely(rc != MDBX_SUCCESS))
-        goto done;
+      return rc;
+  }
+  txn->tw.vlog.deltas_count = 0;
+  return MDBX_SUCCESS;
+}
+
+static void vlog_merge(MDBX_txn *parent, MDBX_txn *txn) {
+  tASSERT(txn, txn->tw.vlog.deltas_count == 0);
+  if (txn->tw.vlog.known) {
+    if (!parent->tw.vlog.known) {
+      parent->tw.vlog.known = true;
+      parent->tw.vlog.origin = txn->tw.vlog.origin;
     }
+    parent->tw.vlog.tail = txn->tw.vlog.tail;
+  }
+  vlog_end(txn, true);
+}
 
-    /* root split? */
-    ptop += mc->mc_snum - (size_t)snum;
+static void vlog_end(MDBX_txn *txn, bool commit) {
+  if (!commit && txn->tw.vlog.known &&
+      txn->tw.vlog.tail > txn->tw.vlog.origin) {
+    /* отрезаем записи прерванной транзакции, а в случае неудачи это будет
+     * сделано при следующей записи в журнал */
+    const int err =
+        osal_ftruncate(txn->mt_env->me_vlog.fd, txn->tw.vlog.origin);
+    if (unlikely(err != MDBX_SUCCESS))
+      WARNING("unable truncate value log, error %d", err);
+  }
+  osal_free(txn->tw.vlog.deltas);
+  txn->tw.vlog.deltas = nullptr;
+  txn->tw.vlog.deltas_count = txn->tw.vlog.deltas_limit = 0;
+  txn->tw.vlog.known = false;
+}
 
-    /* Right page might now have changed parent.
-     * Check if left page also changed parent. */
-    if (mn.mc_pg[ptop] != mc->mc_pg[ptop] &&
-        mc->mc_ki[ptop] >= page_numkeys(mc->mc_pg[ptop])) {
-      for (i = 0; i < ptop; i++) {
-        mc->mc_pg[i] = mn.mc_pg[i];
-        mc->mc_ki[i] = mn.mc_ki[i];
-      }
-      mc->mc_pg[ptop] = mn.mc_pg[ptop];
-      if (mn.mc_ki[ptop]) {
-        mc->mc_ki[ptop] = mn.mc_ki[ptop] - 1;
-      } else {
-        /* find right page's left sibling */
-        mc->mc_ki[ptop] = mn.mc_ki[ptop];
-        rc = cursor_sibling(mc, SIBLING_LEFT);
-        if (unlikely(rc != MDBX_SUCCESS)) {
-          if (rc == MDBX_NOTFOUND) /* improper mdbx_cursor_sibling() result */ {
-            ERROR("unexpected %i error going left sibling", rc);
-            rc = MDBX_PROBLEM;
-          }
-          goto done;
-        }
-      }
-    }
-  } else if (unlikely(pure_left)) {
-    MDBX_page *ptop_page = mc->mc_pg[ptop];
-    DEBUG("adding to parent page %u node[%u] left-leaf page #%u key %s",
-          ptop_page->mp_pgno, mc->mc_ki[ptop], sister->mp_pgno,
-          DKEY(mc->mc_ki[ptop] ? newkey : NULL));
-    mc->mc_top--;
-    rc = node_add_branch(mc, mc->mc_ki[ptop], mc->mc_ki[ptop] ? newkey : NULL,
-                         sister->mp_pgno);
-    cASSERT(mc, mp == mc->mc_pg[ptop + 1] && newindx == mc->mc_ki[ptop + 1] &&
-                    ptop == mc->mc_top);
+int mdbx_dbi_set_vlog(MDBX_txn *txn, MDBX_dbi dbi, size_t threshold) {
+  int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
-    if (likely(rc == MDBX_SUCCESS) && mc->mc_ki[ptop] == 0) {
-      DEBUG("update prev-first key on parent %s", DKEY(&sepkey));
-      MDBX_node *node = page_node(mc->mc_pg[ptop], 1);
-      cASSERT(mc, node_ks(node) == 0 && node_pgno(node) == mp->mp_pgno);
-      cASSERT(mc, mc->mc_top == ptop && mc->mc_ki[ptop] == 0);
-      mc->mc_ki[ptop] = 1;
-      rc = update_key(mc, &sepkey);
-      cASSERT(mc, mc->mc_top == ptop && mc->mc_ki[ptop] == 1);
-      cASSERT(mc, mp == mc->mc_pg[ptop + 1] && newindx == mc->mc_ki[ptop + 1]);
-      mc->mc_ki[ptop] = 0;
-    }
+  if (unlikely(txn->mt_flags & MDBX_TXN_DISJOINT))
+    return MDBX_EPERM;
 
-    mc->mc_top++;
-    if (unlikely(rc != MDBX_SUCCESS))
-      goto done;
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
 
-    MDBX_node *node = page_node(mc->mc_pg[ptop], mc->mc_ki[ptop] + (size_t)1);
-    cASSERT(mc, node_pgno(node) == mp->mp_pgno && mc->mc_pg[ptop] == ptop_page);
-  } else {
-    mn.mc_top--;
-    TRACE("add-to-parent the right-entry[%u] for new sibling-page",
-          mn.mc_ki[ptop]);
-    rc = node_add_branch(&mn, mn.mc_ki[ptop], &sepkey, sister->mp_pgno);
-    mn.mc_top++;
+  if (unlikely(txn->mt_dbistate[dbi] & DBI_STALE)) {
+    rc = fetch_sdb(txn, dbi);
     if (unlikely(rc != MDBX_SUCCESS))
-      goto done;
+      return rc;
   }
 
-  if (unlikely(pure_left | pure_right)) {
-    mc->mc_pg[mc->mc_top] = sister;
-    mc->mc_ki[mc->mc_top] = 0;
-    switch (PAGETYPE_WHOLE(sister)) {
-    case P_LEAF: {
-      cASSERT(mc, newpgno == 0 || newpgno == P_INVALID);
-      rc = node_add_leaf(mc, 0, newkey, newdata, naf);
-    } break;
-    case P_LEAF | P_LEAF2: {
-      cASSERT(mc, (naf & (F_BIGDATA | F_SUBDATA | F_DUPDATA)) == 0);
-      cASSERT(mc, newpgno == 0 || newpgno == P_INVALID);
-      rc = node_add_leaf2(mc, 0, newkey);
-    } break;
-    default:
-      rc = bad_page(sister, "wrong page-type %u\n", PAGETYPE_WHOLE(sister));
-    }
-    if (unlikely(rc != MDBX_SUCCESS))
-      goto done;
+  /* Порядок дубликатов определяется их значениями, а в MDBX_FIXEDSIZE-таблицах
+   * значения размещаются непосредственно в LEAF2-страницах. Значения из
+   * журнала не могут быть выровнены внутри страниц БД. */
+  if (unlikely(txn->mt_dbs[dbi].md_flags &
+               (MDBX_DUPSORT | MDBX_FIXEDSIZE | DB_ALIGNVALUE_FLAGS)))
+    return MDBX_INCOMPATIBLE;
 
-    if (pure_right) {
-      for (i = 0; i < mc->mc_top; i++)
-        mc->mc_ki[i] = mn.mc_ki[i];
-    } else if (mc->mc_ki[mc->mc_top - 1] == 0) {
-      for (i = 2; i <= mc->mc_top; ++i)
-        if (mc->mc_ki[mc->mc_top - i]) {
-          get_key(
-              page_node(mc->mc_pg[mc->mc_top - i], mc->mc_ki[mc->mc_top - i]),
-              &sepkey);
-          if (mc->mc_dbx->md_cmp(newkey, &sepkey) < 0) {
-            mc->mc_top -= (uint8_t)i;
-            DEBUG("update new-first on parent [%i] page %u key %s",
-                  mc->mc_ki[mc->mc_top], mc->mc_pg[mc->mc_top]->mp_pgno,
-                  DKEY(newkey));
-            rc = update_key(mc, newkey);
-            mc->mc_top += (uint8_t)i;
-            if (unlikely(rc != MDBX_SUCCESS))
-              goto done;
-          }
-          break;
-        }
+  if (threshold) {
+    MDBX_dbi index;
+    if (vlog_index(txn, &index) != MDBX_SUCCESS) {
+      static const MDBX_val name = {(void *)VLOG_INDEX_NAME,
+                                    sizeof(VLOG_INDEX_NAME) - 1};
+      rc = dbi_open(txn, &name, MDBX_CREATE | MDBX_INTEGERKEY, &index, nullptr,
+                    nullptr);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+      txn->mt_env->me_vlog.dbi = index;
     }
-  } else if (tmp_ki_copy /* !IS_LEAF2(mp) */) {
-    /* Move nodes */
-    mc->mc_pg[mc->mc_top] = sister;
-    i = split_indx;
-    size_t n = 0;
-    do {
-      TRACE("i %zu, nkeys %zu => n %zu, rp #%u", i, nkeys, n, sister->mp_pgno);
-      pgno_t pgno = 0;
-      MDBX_val *rdata = NULL;
-      if (i == newindx) {
-        rkey = *newkey;
-        if (IS_LEAF(mp))
-          rdata = newdata;
-        else
-          pgno = newpgno;
-        flags = naf;
-        /* Update index for the new key. */
-        mc->mc_ki[mc->mc_top] = (indx_t)n;
-      } else {
-        MDBX_node *node = ptr_disp(mp, tmp_ki_copy->mp_ptrs[i] + PAGEHDRSZ);
-        rkey.iov_base = node_key(node);
-        rkey.iov_len = node_ks(node);
-        if (IS_LEAF(mp)) {
-          xdata.iov_base = node_data(node);
-          xdata.iov_len = node_ds(node);
-          rdata = &xdata;
-        } else
-          pgno = node_pgno(node);
-        flags = node_flags(node);
-      }
+    if (threshold < CODEC_MIN_VALUE)
+      threshold = CODEC_MIN_VALUE;
+  }
+  txn->mt_dbxs[dbi].md_vlog_threshold = threshold;
+  return MDBX_SUCCESS;
+}
 
-      switch (PAGETYPE_WHOLE(sister)) {
-      case P_BRANCH: {
-        cASSERT(mc, 0 == (uint16_t)flags);
-        /* First branch index doesn't need key data. */
-        rc = node_add_branch(mc, n, n ? &rkey : NULL, pgno);
-      } break;
-      case P_LEAF: {
-        cASSERT(mc, pgno == 0);
-        cASSERT(mc, rdata != NULL);
-        rc = node_add_leaf(mc, n, &rkey, rdata, flags);
-      } break;
-      /* case P_LEAF | P_LEAF2: {
-        cASSERT(mc, (nflags & (F_BIGDATA | F_SUBDATA | F_DUPDATA)) == 0);
-        cASSERT(mc, gno == 0);
-        rc = mdbx_node_add_leaf2(mc, n, &rkey);
-      } break; */
-      default:
-        rc = bad_page(sister, "wrong page-type %u\n", PAGETYPE_WHOLE(sister));
-      }
-      if (unlikely(rc != MDBX_SUCCESS))
-        goto done;
+/* Возвращает дескриптор открытой таблицы по имени, либо 0 */
+static MDBX_dbi vlog_table(MDBX_txn *txn, const MDBX_val *name) {
+  if (name->iov_len == 0)
+    return MAIN_DBI;
+  MDBX_env *const env = txn->mt_env;
+  for (MDBX_dbi i = CORE_DBS; i < env->me_numdbs; ++i) {
+    const MDBX_val *const candidate = &env->me_dbxs[i].md_name;
+    if (candidate->iov_len == name->iov_len && candidate->iov_base &&
+        memcmp(candidate->iov_base, name->iov_base, name->iov_len) == 0 &&
+        check_dbi(txn, i, DBI_USRVALID))
+      return i;
+  }
+  return 0;
+}
 
-      ++n;
-      if (++i > nkeys) {
-        i = 0;
-        n = 0;
-        mc->mc_pg[mc->mc_top] = tmp_ki_copy;
-        TRACE("switch to mp #%u", tmp_ki_copy->mp_pgno);
+/* Перемещает живые записи сегмента в конец журнала. Возвращает
+ * MDBX_RESULT_TRUE, если актуальность записей невозможно проверить,
+ * так как таблица не открыта. */
+static int vlog_relocate(MDBX_txn *txn, const vlog_segment_t *seg) {
+  MDBX_env *const env = txn->mt_env;
+  void *buf = nullptr;
+  size_t buf_size = 0;
+  int rc = MDBX_SUCCESS;
+  for (uint64_t offset = seg->first; offset < seg->end;) {
+    vlog_record_t rec;
+    rc = osal_pread(env->me_vlog.fd, &rec, sizeof(rec), offset);
+    if (unlikely(rc != MDBX_SUCCESS || rec.magic != VLOG_MAGIC)) {
+      if (rc == MDBX_SUCCESS || rc == MDBX_ENODATA) {
+        ERROR("invalid record at %" PRIu64 " of value log", offset);
+        rc = MDBX_CORRUPTED;
       }
-    } while (i != split_indx);
-
-    TRACE("i %zu, nkeys %zu, n %zu, pgno #%u", i, nkeys, n,
-          mc->mc_pg[mc->mc_top]->mp_pgno);
-
-    nkeys = page_numkeys(tmp_ki_copy);
-    for (i = 0; i < nkeys; i++)
-      mp->mp_ptrs[i] = tmp_ki_copy->mp_ptrs[i];
-    mp->mp_lower = tmp_ki_copy->mp_lower;
-    mp->mp_upper = tmp_ki_copy->mp_upper;
-    memcpy(page_node(mp, nkeys - 1), page_node(tmp_ki_copy, nkeys - 1),
-           env->me_psize - tmp_ki_copy->mp_upper - PAGEHDRSZ);
+      break;
+    }
 
-    /* reset back to original page */
-    if (newindx < split_indx) {
-      mc->mc_pg[mc->mc_top] = mp;
-    } else {
-      mc->mc_pg[mc->mc_top] = sister;
-      mc->mc_ki[ptop]++;
-      /* Make sure mc_ki is still valid. */
-      if (mn.mc_pg[ptop] != mc->mc_pg[ptop] &&
-          mc->mc_ki[ptop] >= page_numkeys(mc->mc_pg[ptop])) {
-        for (i = 0; i <= ptop; i++) {
-          mc->mc_pg[i] = mn.mc_pg[i];
-          mc->mc_ki[i] = mn.mc_ki[i];
-        }
+    /* имя размещается так, чтобы ключ был выровнен */
+    const size_t name_room = ceil_powerof2(rec.name_len, sizeof(uint64_t));
+    const size_t need =
+        name_room + ceil_powerof2(rec.key_len, sizeof(uint64_t)) + rec.length;
+    if (buf_size < need) {
+      void *const ptr = osal_realloc(buf, need);
+      if (unlikely(!ptr)) {
+        rc = MDBX_ENOMEM;
+        break;
       }
+      buf = ptr;
+      buf_size = need;
     }
-  } else if (newindx >= split_indx) {
-    mc->mc_pg[mc->mc_top] = sister;
-    mc->mc_ki[ptop]++;
-    /* Make sure mc_ki is still valid. */
-    if (mn.mc_pg[ptop] != mc->mc_pg[ptop] &&
-        mc->mc_ki[ptop] >= page_numkeys(mc->mc_pg[ptop])) {
-      for (i = 0; i <= ptop; i++) {
-        mc->mc_pg[i] = mn.mc_pg[i];
-        mc->mc_ki[i] = mn.mc_ki[i];
+    MDBX_val name = {ptr_disp(buf, name_room - rec.name_len), rec.name_len};
+    MDBX_val key = {ptr_disp(buf, name_room), rec.key_len};
+    MDBX_val value = {ptr_disp(buf, need - rec.length), rec.length};
+    rc = osal_pread(env->me_vlog.fd, name.iov_base,
+                    rec.name_len + rec.key_len, offset + sizeof(rec));
+    if (unlikely(rc != MDBX_SUCCESS))
+      break;
+    const uint64_t value_offset =
+        offset + sizeof(rec) + rec.name_len + rec.key_len;
+    offset = value_offset + rec.length;
+
+    const MDBX_dbi dbi = vlog_table(txn, &name);
+    if (!dbi) {
+      /* пропускаем записи удаленной таблицы, но не таблицы которая просто
+       * не открыта */
+      MDBX_cursor_couple cx;
+      rc = cursor_init(&cx.outer, txn, MAIN_DBI);
+      if (unlikely(rc != MDBX_SUCCESS))
+        break;
+      rc = cursor_set(&cx.outer, &name, nullptr, MDBX_SET).err;
+      if (rc == MDBX_NOTFOUND) {
+        rc = MDBX_SUCCESS;
+        continue;
       }
+      if (rc == MDBX_SUCCESS)
+        rc = MDBX_RESULT_TRUE;
+      break;
     }
-  }
 
-  /* Adjust other cursors pointing to mp and/or to parent page */
-  nkeys = page_numkeys(mp);
-  for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
-       m2 = m2->mc_next) {
-    MDBX_cursor *m3 = (mc->mc_flags & C_SUB) ? &m2->mc_xcursor->mx_cursor : m2;
-    if (m3 == mc)
+    MDBX_cursor_couple cx;
+    rc = cursor_init(&cx.outer, txn, dbi);
+    if (unlikely(rc != MDBX_SUCCESS))
+      break;
+    if (cx.outer.mc_db->md_flags & MDBX_DUPSORT)
       continue;
-    if (!(m2->mc_flags & m3->mc_flags & C_INITIALIZED))
+    MDBX_val stored;
+    rc = cursor_set(&cx.outer, &key, &stored, MDBX_SET).err;
+    if (rc == MDBX_NOTFOUND) {
+      rc = MDBX_SUCCESS;
       continue;
-    if (foliage) {
-      /* sub cursors may be on different DB */
-      if (m3->mc_pg[0] != mp)
-        continue;
-      /* root split */
-      for (int k = foliage; k >= 0; k--) {
-        m3->mc_ki[k + 1] = m3->mc_ki[k];
-        m3->mc_pg[k + 1] = m3->mc_pg[k];
-      }
-      m3->mc_ki[0] = m3->mc_ki[0] >= nkeys;
-      m3->mc_pg[0] = mc->mc_pg[0];
-      m3->mc_snum++;
-      m3->mc_top++;
     }
-
-    if (m3->mc_top >= mc->mc_top && m3->mc_pg[mc->mc_top] == mp && !pure_left) {
-      if (m3->mc_ki[mc->mc_top] >= newindx && !(naf & MDBX_SPLIT_REPLACE))
-        m3->mc_ki[mc->mc_top]++;
-      if (m3->mc_ki[mc->mc_top] >= nkeys) {
-        m3->mc_pg[mc->mc_top] = sister;
-        cASSERT(mc, m3->mc_ki[mc->mc_top] >= nkeys);
-        m3->mc_ki[mc->mc_top] -= (indx_t)nkeys;
-        for (i = 0; i < mc->mc_top; i++) {
-          m3->mc_ki[i] = mn.mc_ki[i];
-          m3->mc_pg[i] = mn.mc_pg[i];
-        }
-      }
-    } else if (!did_split_parent && m3->mc_top >= ptop &&
-               m3->mc_pg[ptop] == mc->mc_pg[ptop] &&
-               m3->mc_ki[ptop] >= mc->mc_ki[ptop]) {
-      m3->mc_ki[ptop]++; /* also for the `pure-left` case */
+    if (unlikely(rc != MDBX_SUCCESS))
+      break;
+    const MDBX_node *const node = page_node(cx.outer.mc_pg[cx.outer.mc_top],
+                                            cx.outer.mc_ki[cx.outer.mc_top]);
+    if ((node_flags(node) & (F_COMPRESSED | F_BIGDATA)) != F_COMPRESSED ||
+        node_ds(node) != VLOG_REF_SIZE ||
+        *(const uint8_t *)node_data(node) != CODEC_VLOG ||
+        unaligned_peek_u64(1, ptr_disp(node_data(node), 5)) != value_offset)
+      continue /* the record is dead */;
+
+    rc = osal_pread(env->me_vlog.fd, value.iov_base, value.iov_len,
+                    value_offset);
+    if (unlikely(rc != MDBX_SUCCESS ||
+                 vlog_checksum(value.iov_base, value.iov_len) !=
+                     rec.checksum)) {
+      ERROR("value of table %u at %" PRIu64
+            " of value log is missing or damaged",
+            dbi, value_offset);
+      rc = MDBX_CORRUPTED;
+      break;
     }
-    if (XCURSOR_INITED(m3) && IS_LEAF(mp))
-      XCURSOR_REFRESH(m3, m3->mc_pg[mc->mc_top], m3->mc_ki[mc->mc_top]);
+    uint8_t ref[VLOG_REF_SIZE];
+    rc = vlog_append(&cx.outer, &key, &value, ref);
+    if (unlikely(rc != MDBX_SUCCESS))
+      break;
+    MDBX_val fresh = {ref, sizeof(ref)};
+    WITH_CURSOR_TRACKING(cx.outer,
+                         rc = cursor_put_nochecklen(&cx.outer, &key, &fresh,
+                                                    MDBX_CURRENT |
+                                                        F_COMPRESSED));
+    if (unlikely(rc != MDBX_SUCCESS))
+      break;
   }
-  TRACE("mp #%u left: %zd, sister #%u left: %zd", mp->mp_pgno, page_room(mp),
-        sister->mp_pgno, page_room(sister));
-
-done:
-  if (tmp_ki_copy)
-    dpage_free(env, tmp_ki_copy, 1);
+  osal_free(buf);
+  return rc;
+}
 
+/* Освобождает сегмент, записи которого уже перемещены, либо перемещает их */
+static int vlog_collect(MDBX_txn *txn, MDBX_dbi dbi, uint64_t segment,
+                        uint64_t *reclaimed) {
+  MDBX_cursor_couple cx;
+  int rc = cursor_init(&cx.outer, txn, dbi);
   if (unlikely(rc != MDBX_SUCCESS))
-    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
-  else {
-    if (AUDIT_ENABLED())
-      rc = cursor_check_updating(mc);
-    if (unlikely(naf & MDBX_RESERVE)) {
-      MDBX_node *node = page_node(mc->mc_pg[mc->mc_top], mc->mc_ki[mc->mc_top]);
-      if (!(node_flags(node) & F_BIGDATA))
-        newdata->iov_base = node_data(node);
-    }
-#if MDBX_ENABLE_PGOP_STAT
-    env->me_lck->mti_pgop_stat.split.weak += 1;
-#endif /* MDBX_ENABLE_PGOP_STAT */
+    return rc;
+  MDBX_val key = {&segment, sizeof(segment)}, data;
+  rc = cursor_set(&cx.outer, &key, &data, MDBX_SET).err;
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  vlog_segment_t seg;
+  if (unlikely(data.iov_len != sizeof(seg)))
+    return MDBX_CORRUPTED;
+  memcpy(&seg, data.iov_base, sizeof(seg));
+
+  if (seg.retired) {
+    rc = osal_punchhole(txn->mt_env->me_vlog.fd, seg.first,
+                        seg.end - seg.first);
+    if (rc == MDBX_SUCCESS)
+      *reclaimed += seg.end - seg.first;
+    else if (unlikely(rc != MDBX_RESULT_TRUE))
+      return rc;
+    WITH_CURSOR_TRACKING(cx.outer, rc = cursor_del(&cx.outer, 0));
+    return rc;
   }
 
-  DEBUG("<< mp #%u, rc %d", mp->mp_pgno, rc);
+  rc = vlog_relocate(txn, &seg);
+  if (rc != MDBX_SUCCESS)
+    return (rc == MDBX_RESULT_TRUE) ? MDBX_SUCCESS : rc;
+  /* выбывание перемещенных записей учитывается при фиксации транзакции,
+   * поэтому отметка ставится на прочитанную ранее учетную запись */
+  seg.retired = txn->mt_txnid;
+  data.iov_base = &seg;
+  data.iov_len = sizeof(seg);
+  WITH_CURSOR_TRACKING(cx.outer,
+                       rc = cursor_put_nochecklen(&cx.outer, &key, &data, 0));
   return rc;
 }
 
-int mdbx_put(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key, MDBX_val *data,
-             unsigned flags) {
+int mdbx_vlog_gc(MDBX_txn *txn, unsigned live_percent, uint64_t *reclaimed) {
   int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  if (unlikely(!key || !data))
+  if (unlikely(live_percent > 100))
     return MDBX_EINVAL;
 
-  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
-    return MDBX_BAD_DBI;
+  if (unlikely(txn->mt_flags & MDBX_TXN_DISJOINT))
+    return MDBX_EPERM;
 
-  if (unlikely(flags & ~(MDBX_NOOVERWRITE | MDBX_NODUPDATA | MDBX_ALLDUPS |
-                         MDBX_ALLDUPS | MDBX_RESERVE | MDBX_APPEND |
-                         MDBX_APPENDDUP | MDBX_CURRENT | MDBX_MULTIPLE)))
-    return MDBX_EINVAL;
+  uint64_t reclaimed_stub;
+  if (!reclaimed)
+    reclaimed = &reclaimed_stub;
+  *reclaimed = 0;
 
-  if (unlikely(txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_BLOCKED)))
-    return (txn->mt_flags & MDBX_TXN_RDONLY) ? MDBX_EACCESS : MDBX_BAD_TXN;
+  MDBX_dbi dbi;
+  rc = vlog_index(txn, &dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  rc = vlog_prepare(txn);
+  if (likely(rc == MDBX_SUCCESS) && txn->tw.vlog.deltas_count)
+    rc = vlog_flush(txn);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
 
+  /* Сначала собираются номера сегментов, так как при их обработке
+   * изменяются как другие таблицы, так и сам индекс. Сегмент в который
+   * ведется запись не обрабатывается, в том числе так сохраняется
+   * положение конца журнала в индексе. */
+  const txnid_t oldest = txn_oldest_reader(txn);
+  uint64_t *list = nullptr;
+  size_t count = 0, limit = 0;
   MDBX_cursor_couple cx;
   rc = cursor_init(&cx.outer, txn, dbi);
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
-  cx.outer.mc_next = txn->mt_cursors[dbi];
-  txn->mt_cursors[dbi] = &cx.outer;
-
-  /* LY: support for update (explicit overwrite) */
-  if (flags & MDBX_CURRENT) {
-    rc = cursor_set(&cx.outer, (MDBX_val *)key, NULL, MDBX_SET).err;
-    if (likely(rc == MDBX_SUCCESS) &&
-        (txn->mt_dbs[dbi].md_flags & MDBX_DUPSORT) &&
-        (flags & MDBX_ALLDUPS) == 0) {
-      /* LY: allows update (explicit overwrite) only for unique keys */
-      MDBX_node *node = page_node(cx.outer.mc_pg[cx.outer.mc_top],
-                                  cx.outer.mc_ki[cx.outer.mc_top]);
-      if (node_flags(node) & F_DUPDATA) {
-        tASSERT(txn, XCURSOR_INITED(&cx.outer) &&
-                         cx.outer.mc_xcursor->mx_db.md_entries > 1);
-        rc = MDBX_EMULTIVAL;
+  MDBX_val key, data;
+  for (rc = cursor_first(&cx.outer, &key, &data); rc == MDBX_SUCCESS;
+       rc = cursor_next(&cx.outer, &key, &data, MDBX_NEXT)) {
+    vlog_segment_t seg;
+    if (unlikely(data.iov_len != sizeof(seg) || key.iov_len != 8)) {
+      rc = MDBX_CORRUPTED;
+      break;
+    }
+    memcpy(&seg, data.iov_base, sizeof(seg));
+    if (seg.end >= txn->tw.vlog.tail ||
+        (seg.retired ? seg.retired >= oldest
+                     : seg.live * 100 >=
+                           (seg.end - seg.first) * (uint64_t)live_percent))
+      continue;
+    if (count == limit) {
+      limit = limit ? limit * 2 : 64;
+      void *const ptr = osal_realloc(list, limit * sizeof(uint64_t));
+      if (unlikely(!ptr)) {
+        rc = MDBX_ENOMEM;
+        break;
       }
+      list = ptr;
     }
+    list[count++] = unaligned_peek_u64(1, key.iov_base);
   }
 
-  if (likely(rc == MDBX_SUCCESS))
-    rc = cursor_put_checklen(&cx.outer, key, data, flags);
-  txn->mt_cursors[dbi] = cx.outer.mc_next;
-
+  if (rc == MDBX_NOTFOUND) {
+    rc = MDBX_SUCCESS;
+    for (size_t i = 0; i < count && rc == MDBX_SUCCESS; ++i)
+      rc = vlog_collect(txn, dbi, list[i], reclaimed);
+  }
+  osal_free(list);
   return rc;
 }
 
@@ -21298,11 +25031,11 @@ __cold static int compacting_walk_tree(mdbx_compacting_ctx *ctx,
     size_t n = page_numkeys(mp);
 
     if (IS_LEAF(mp)) {
-      if (!(mc->mc_flags &
-            C_SUB) /* may have nested F_SUBDATA or F_BIGDATA nodes */) {
+      if (!(mc->mc_flags & C_SUB) &&
+          !IS_LEAF2(mp) /* may have nested F_SUBDATA or F_BIGDATA nodes */) {
         for (size_t i = 0; i < n; i++) {
           MDBX_node *node = page_node(mp, i);
-          if (node_flags(node) == F_BIGDATA) {
+          if ((node_flags(node) & ~F_COMPRESSED) == F_BIGDATA) {
             /* Need writable leaf */
             if (mp != leaf) {
               mc->mc_pg[mc->mc_top] = leaf;
@@ -21315,10 +25048,13 @@ __cold static int compacting_walk_tree(mdbx_compacting_ctx *ctx,
                 page_get_large(mc, node_largedata_pgno(node), mp->mp_txnid);
             if (unlikely((rc = lp.err) != MDBX_SUCCESS))
               goto done;
+            const size_t align = valign(mc->mc_db->md_flags);
             const size_t datasize = node_ds(node);
-            const pgno_t npages = number_of_ovpages(ctx->mc_env, datasize);
+            const pgno_t npages =
+                largedata_npages(ctx->mc_env, datasize, align);
             poke_pgno(node_data(node), ctx->mc_next_pgno);
-            rc = compacting_put_page(ctx, lp.page, PAGEHDRSZ + datasize, 0,
+            rc = compacting_put_page(ctx, lp.page,
+                                     largedata_offset(align) + datasize, 0,
                                      npages);
             if (unlikely(rc != MDBX_SUCCESS))
               goto done;
@@ -21639,7 +25375,7 @@ __cold static int env_copy_asis(MDBX_env *env, MDBX_txn *read_txn,
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  rc = txn_renew(read_txn, MDBX_TXN_RDONLY);
+  rc = txn_renew(read_txn, MDBX_TXN_RDONLY, nullptr);
   if (unlikely(rc != MDBX_SUCCESS)) {
     mdbx_txn_unlock(env);
     return rc;
@@ -22088,7 +25824,8 @@ __cold static int stat_acc(const MDBX_txn *txn, MDBX_stat *st, size_t bytes) {
     if ((txn->mt_dbistate[dbi] & (DBI_VALID | DBI_STALE)) == DBI_VALID)
       stat_add(txn->mt_dbs + dbi, st, bytes);
 
-  if (!(txn->mt_dbs[MAIN_DBI].md_flags & (MDBX_DUPSORT | MDBX_INTEGERKEY)) &&
+  if (!(txn->mt_dbs[MAIN_DBI].md_flags &
+        (MDBX_DUPSORT | MDBX_INTEGERKEY | MDBX_FIXEDSIZE)) &&
       txn->mt_dbs[MAIN_DBI].md_entries /* TODO: use `md_subs` field */) {
     MDBX_cursor_couple cx;
     err = cursor_init(&cx.outer, (MDBX_txn *)txn, MAIN_DBI);
@@ -22194,6 +25931,8 @@ __cold int mdbx_dbi_dupsort_depthmask(MDBX_txn *txn, MDBX_dbi dbi,
     const unsigned flags = node_flags(node);
     switch (flags) {
     case F_BIGDATA:
+    case F_BIGDATA | F_COMPRESSED:
+    case F_COMPRESSED:
     case 0:
       /* single-value entry, deep = 0 */
       *mask |= 1 << 0;
@@ -22228,6 +25967,7 @@ __cold static int fetch_envinfo_ex(const MDBX_env *env, const MDBX_txn *txn,
 
   const size_t size_before_bootid = offsetof(MDBX_envinfo, mi_bootid);
   const size_t size_before_pgop_stat = offsetof(MDBX_envinfo, mi_pgop_stat);
+  const size_t size_before_lock_stat = offsetof(MDBX_envinfo, mi_lock_stat);
 
   /* is the environment open?
    * (https://libmdbx.dqdkfa.ru/dead-github/issues/171) */
@@ -22366,6 +26106,20 @@ __cold static int fetch_envinfo_ex(const MDBX_env *env, const MDBX_txn *txn,
 #endif /* MDBX_ENABLE_PGOP_STAT*/
   }
 
+  if (likely(bytes > size_before_lock_stat)) {
+    memset(&arg->mi_lock_stat, 0, sizeof(arg->mi_lock_stat));
+#if MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+    if (env->me_lck_mmap.lck) {
+      arg->mi_lock_stat.wlock_waiters =
+          atomic_load32(&lck->mti_wlock.ipc_waiters, mo_Relaxed);
+      arg->mi_lock_stat.rlock_waiters =
+          atomic_load32(&lck->mti_rlock.ipc_waiters, mo_Relaxed);
+      arg->mi_lock_stat.wlock_contended = lck->mti_wlock.ipc_contended;
+      arg->mi_lock_stat.rlock_contended = lck->mti_rlock.ipc_contended;
+    }
+#endif /* MDBX_LOCKING == MDBX_LOCKING_BENAPHORE */
+  }
+
   arg->mi_self_latter_reader_txnid = arg->mi_latter_reader_txnid =
       arg->mi_recent_txnid;
   if (env->me_lck_mmap.lck) {
@@ -22408,8 +26162,9 @@ __cold int mdbx_env_info_ex(const MDBX_env *env, const MDBX_txn *txn,
 
   const size_t size_before_bootid = offsetof(MDBX_envinfo, mi_bootid);
   const size_t size_before_pgop_stat = offsetof(MDBX_envinfo, mi_pgop_stat);
+  const size_t size_before_lock_stat = offsetof(MDBX_envinfo, mi_lock_stat);
   if (unlikely(bytes != sizeof(MDBX_envinfo)) && bytes != size_before_bootid &&
-      bytes != size_before_pgop_stat)
+      bytes != size_before_pgop_stat && bytes != size_before_lock_stat)
     return MDBX_EINVAL;
 
   MDBX_envinfo snap;
@@ -22424,6 +26179,8 @@ __cold int mdbx_env_info_ex(const MDBX_env *env, const MDBX_txn *txn,
     snap.mi_since_sync_seconds16dot16 = arg->mi_since_sync_seconds16dot16;
     snap.mi_since_reader_check_seconds16dot16 =
         arg->mi_since_reader_check_seconds16dot16;
+    if (bytes > size_before_lock_stat)
+      snap.mi_lock_stat = arg->mi_lock_stat;
     if (likely(memcmp(&snap, arg, bytes) == 0))
       return MDBX_SUCCESS;
     memcpy(&snap, arg, bytes);
@@ -22432,8 +26189,10 @@ __cold int mdbx_env_info_ex(const MDBX_env *env, const MDBX_txn *txn,
 
 static __inline MDBX_cmp_func *get_default_keycmp(unsigned flags) {
   return (flags & MDBX_REVERSEKEY)   ? cmp_reverse
-         : (flags & MDBX_INTEGERKEY) ? cmp_int_align2
-                                     : cmp_lexical;
+         : (flags & MDBX_INTEGERKEY)
+             ? /* в MDBX_FIXEDSIZE-таблице ключи могут быть не выровнены */
+             ((flags & MDBX_FIXEDSIZE) ? cmp_int_unaligned : cmp_int_align2)
+             : cmp_lexical;
 }
 
 static __inline MDBX_cmp_func *get_default_datacmp(unsigned flags) {
@@ -22466,8 +26225,20 @@ static int dbi_bind(MDBX_txn *txn, const MDBX_dbi dbi, unsigned user_flags,
       if (txn->mt_flags & MDBX_TXN_RDONLY)
         return /* FIXME: return extended info */ MDBX_EACCESS;
       /* make sure flags changes get committed */
+      const unsigned prev_flags = txn->mt_dbs[dbi].md_flags;
       txn->mt_dbs[dbi].md_flags = user_flags & DB_PERSISTENT_FLAGS;
       txn->mt_flags |= MDBX_TXN_DIRTY;
+      if ((prev_flags | user_flags) & MDBX_FIXEDSIZE) {
+        /* для MDBX_FIXEDSIZE в md_xsize хранится длина ключа, поэтому
+         * сбрасываем её и пересчитываем ограничения длин */
+        txn->mt_dbs[dbi].md_xsize = 0;
+        if (txn->mt_dbxs[dbi].md_klen_max) {
+          int err = setup_dbx(&txn->mt_dbxs[dbi], &txn->mt_dbs[dbi],
+                              txn->mt_env->me_psize);
+          if (unlikely(err != MDBX_SUCCESS))
+            return err;
+        }
+      }
     } else {
       return /* FIXME: return extended info */ MDBX_INCOMPATIBLE;
     }
@@ -22523,8 +26294,15 @@ static int dbi_open(MDBX_txn *txn, const MDBX_val *const table_name,
     goto bailout;
   }
 
+  /* Таблицы должны быть открыты до запуска disjoint-транзакций
+   * и до заморозки транзакции */
+  if (unlikely(txn->mt_flags & (MDBX_TXN_DISJOINT | MDBX_TXN_FROZEN))) {
+    rc = MDBX_EPERM;
+    goto bailout;
+  }
+
   switch (user_flags & (MDBX_INTEGERDUP | MDBX_DUPFIXED | MDBX_DUPSORT |
-                        MDBX_REVERSEDUP | MDBX_ACCEDE)) {
+                        MDBX_REVERSEDUP | MDBX_FIXEDSIZE | MDBX_ACCEDE)) {
   case MDBX_ACCEDE:
     if ((user_flags & MDBX_CREATE) == 0)
       break;
@@ -22539,10 +26317,20 @@ static int dbi_open(MDBX_txn *txn, const MDBX_val *const table_name,
   case MDBX_DUPSORT | MDBX_DUPFIXED | MDBX_REVERSEDUP:
   case MDBX_DUPSORT | MDBX_DUPFIXED | MDBX_INTEGERDUP:
   case MDBX_DUPSORT | MDBX_DUPFIXED | MDBX_INTEGERDUP | MDBX_REVERSEDUP:
+  case MDBX_FIXEDSIZE:
   case 0:
     break;
   }
 
+  /* Выравнивание значений задается только одним из флагов и неприменимо
+   * к таблицам с дубликатами и записями фиксированного размера. */
+  if (unlikely(user_flags & DB_ALIGNVALUE_FLAGS) &&
+      (!is_powerof2(user_flags & DB_ALIGNVALUE_FLAGS) ||
+       (user_flags & (MDBX_DUPSORT | MDBX_FIXEDSIZE)))) {
+    rc = MDBX_EINVAL;
+    goto bailout;
+  }
+
   /* main table? */
   if (table_name == MDBX_PGWALK_MAIN ||
       table_name->iov_base == MDBX_PGWALK_MAIN) {
@@ -22570,8 +26358,9 @@ static int dbi_open(MDBX_txn *txn, const MDBX_val *const table_name,
   if (key.iov_len > env->me_leaf_nodemax - NODESIZE - sizeof(MDBX_db))
     return MDBX_EINVAL;
 
-  /* Cannot mix named table(s) with DUPSORT flags */
-  if (unlikely(txn->mt_dbs[MAIN_DBI].md_flags & MDBX_DUPSORT)) {
+  /* Cannot mix named table(s) with DUPSORT, FIXEDSIZE or ALIGNVALUE flags */
+  if (unlikely(txn->mt_dbs[MAIN_DBI].md_flags &
+               (MDBX_DUPSORT | MDBX_FIXEDSIZE | DB_ALIGNVALUE_FLAGS))) {
     if ((user_flags & MDBX_CREATE) == 0) {
       rc = MDBX_NOTFOUND;
       goto bailout;
@@ -22719,7 +26508,9 @@ static int dbi_open(MDBX_txn *txn, const MDBX_val *const table_name,
   }
 
   /* Got info, register DBI in this txn */
+  split_hint_t *const split_hints = txn->mt_dbxs[slot].md_split_hints;
   memset(txn->mt_dbxs + slot, 0, sizeof(MDBX_dbx));
+  txn->mt_dbxs[slot].md_split_hints = split_hints;
   memcpy(&txn->mt_dbs[slot], data.iov_base, sizeof(MDBX_db));
   env->me_dbflags[slot] = 0;
   rc = dbi_bind(txn, slot, user_flags, keycmp, datacmp);
@@ -22816,6 +26607,85 @@ __cold int mdbx_dbi_stat(MDBX_txn *txn, MDBX_dbi dbi, MDBX_stat *dest,
   return MDBX_SUCCESS;
 }
 
+int mdbx_dbi_set_codec(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_codec *codec,
+                       size_t threshold) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(codec && (!codec->compress || !codec->decompress)))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(txn->mt_dbistate[dbi] & DBI_STALE)) {
+    rc = fetch_sdb(txn, dbi);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+
+  /* Порядок дубликатов определяется их значениями, поэтому сжимать их
+   * нельзя. Значения в MDBX_FIXEDSIZE-таблицах имеют фиксированную длину,
+   * а выровненные значения предназначены для доступа без копирования. */
+  if (unlikely(txn->mt_dbs[dbi].md_flags &
+               (MDBX_DUPSORT | MDBX_FIXEDSIZE | DB_ALIGNVALUE_FLAGS)))
+    return MDBX_INCOMPATIBLE;
+
+  MDBX_dbx *const dbx = &txn->mt_dbxs[dbi];
+  dbx->md_codec_threshold =
+      (threshold > CODEC_MIN_VALUE) ? threshold : CODEC_MIN_VALUE;
+  dbx->md_codec = codec;
+  return MDBX_SUCCESS;
+}
+
+__cold int mdbx_dbi_codec_stat(MDBX_txn *txn, MDBX_dbi dbi,
+                               MDBX_codec_stat *stat, size_t bytes) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!stat || bytes != sizeof(MDBX_codec_stat)))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  if (unlikely(cx.outer.mc_db->md_flags & (MDBX_DUPSORT | MDBX_FIXEDSIZE)))
+    return MDBX_INCOMPATIBLE;
+
+  memset(stat, 0, sizeof(MDBX_codec_stat));
+  rc = page_search(&cx.outer, NULL, MDBX_PS_FIRST);
+  while (rc == MDBX_SUCCESS) {
+    const MDBX_page *const mp = cx.outer.mc_pg[cx.outer.mc_top];
+    const size_t nkeys = page_numkeys(mp);
+    stat->cs_entries += nkeys;
+    for (size_t i = 0; i < nkeys; ++i) {
+      const MDBX_node *const node = page_node(mp, i);
+      if (node_flags(node) & F_COMPRESSED) {
+        MDBX_val packed;
+        rc = node_read(&cx.outer, node, &packed, mp);
+        if (unlikely(rc != MDBX_SUCCESS))
+          return rc;
+        if (unlikely(packed.iov_len <= CODEC_HEADER))
+          return MDBX_CORRUPTED;
+        if (*(const uint8_t *)packed.iov_base == CODEC_VLOG)
+          continue /* the value is in the value log */;
+        stat->cs_packed += 1;
+        stat->cs_packed_bytes += packed.iov_len;
+        stat->cs_unpacked_bytes +=
+            unaligned_peek_u32(1, ptr_disp(packed.iov_base, 1));
+      }
+    }
+    rc = cursor_sibling(&cx.outer, SIBLING_RIGHT);
+  }
+  return (rc == MDBX_NOTFOUND) ? MDBX_SUCCESS : rc;
+}
+
 static int dbi_close_locked(MDBX_env *env, MDBX_dbi dbi) {
   eASSERT(env, dbi >= CORE_DBS);
   if (unlikely(dbi >= env->me_numdbs))
@@ -22987,6 +26857,136 @@ static int drop_tree(MDBX_cursor *mc, const bool may_have_subDBs) {
   return rc;
 }
 
+/* Отправляет в retired все страницы поддерева, включая large/overflow
+ * страницы и вложенные dupsort-деревья, с подсчётом удаляемых записей. */
+static int tree_retire(MDBX_cursor *mc, const pgno_t pgno, const txnid_t front,
+                       uint64_t *entries) {
+  MDBX_page *mp;
+  int rc = page_get(mc, pgno, &mp, front);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  const size_t nkeys = page_numkeys(mp);
+  if (IS_BRANCH(mp)) {
+    for (size_t i = 0; i < nkeys; i++) {
+      rc = tree_retire(mc, node_pgno(page_node(mp, i)), mp->mp_txnid, entries);
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+  } else if (IS_LEAF2(mp)) {
+    *entries += nkeys;
+  } else {
+    for (size_t i = 0; i < nkeys; i++) {
+      MDBX_node *node = page_node(mp, i);
+      switch (node_flags(node)) {
+      case F_BIGDATA:
+      case F_BIGDATA | F_COMPRESSED:
+        rc = page_retire_ex(mc, node_largedata_pgno(node), nullptr, 0);
+        *entries += 1;
+        break;
+      case F_SUBDATA:
+        rc = /* disallowing implicit subDB deletion */ MDBX_INCOMPATIBLE;
+        break;
+      case F_DUPDATA:
+        *entries += page_numkeys((const MDBX_page *)node_data(node));
+        break;
+      case F_DUPDATA | F_SUBDATA:
+        rc = cursor_xinit1(mc, node, mp);
+        if (likely(rc == MDBX_SUCCESS)) {
+          *entries += mc->mc_xcursor->mx_db.md_entries;
+          rc = drop_tree(&mc->mc_xcursor->mx_cursor, false);
+        }
+        break;
+      default:
+        *entries += 1;
+      }
+      if (unlikely(rc != MDBX_SUCCESS))
+        return rc;
+    }
+  }
+  return page_retire(mc, mp);
+}
+
+/* Отрезает и отправляет в retired поддеревья [from, to) страницы на уровне
+ * level стека курсора, после чего выполняет rebalance() этой страницы.
+ * Страницы вдоль пути курсора должны быть модифицируемыми, а по завершении
+ * курсор остается не-позиционированным. */
+static int tree_cut(MDBX_cursor *mc, const size_t level, const size_t from,
+                    const size_t to) {
+  MDBX_page *const mp = mc->mc_pg[level];
+  cASSERT(mc, IS_BRANCH(mp) && IS_MODIFIABLE(mc->mc_txn, mp));
+  cASSERT(mc, from < to && to - from < page_numkeys(mp));
+
+  /* Все курсоры таблицы, кроме текущего, могут ссылаться на удаляемые
+   * страницы, поэтому сбрасываем их заранее, чтобы rebalance() и подстройка
+   * курсоров в node_del() не обращались к освобождённым страницам. */
+  for (MDBX_cursor *m2 = mc->mc_txn->mt_cursors[mc->mc_dbi]; m2;
+       m2 = m2->mc_next)
+    if (m2 != mc) {
+      m2->mc_snum = 0;
+      m2->mc_top = 0;
+      m2->mc_flags &= ~(C_INITIALIZED | C_EOF);
+    }
+
+  uint64_t entries = 0;
+  int rc = MDBX_SUCCESS;
+  for (size_t i = from; i < to; ++i) {
+    rc = tree_retire(mc, node_pgno(page_node(mp, i)), mp->mp_txnid, &entries);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto bailout;
+  }
+  cASSERT(mc, mc->mc_db->md_entries > entries);
+  mc->mc_db->md_entries -= entries;
+
+  /* страницы ниже уровня level могли быть освобождены,
+   * поэтому обрезаем стек курсора */
+  mc->mc_snum = (uint8_t)(level + 1);
+  mc->mc_top = (uint8_t)level;
+  mc->mc_checking |= CC_RETIRING;
+  for (size_t i = to; i > from;) {
+    mc->mc_ki[level] = (indx_t)--i;
+    node_del(mc, 0);
+  }
+  mc->mc_checking -= CC_RETIRING;
+  if (from == 0) {
+    const MDBX_val nullkey = {0, 0};
+    rc = update_key(mc, &nullkey);
+  }
+  if (likely(rc == MDBX_SUCCESS))
+    rc = rebalance(mc);
+
+bailout:
+  if (unlikely(rc != MDBX_SUCCESS))
+    mc->mc_txn->mt_flags |= MDBX_TXN_ERROR;
+  mc->mc_flags &= ~C_INITIALIZED;
+  return rc;
+}
+
+/* Отрезает от начала таблицы несколько самых левых поддеревьев, суммарно
+ * содержащих порядка pages_limit страниц. Размер поддеревьев оценивается
+ * по количеству страниц в таблице и по количеству ключей на страницах
+ * вдоль самого левого пути. */
+static int drop_chunk(MDBX_cursor *mc, const size_t pages_limit) {
+  int rc = page_search(mc, NULL, MDBX_PS_FIRST);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = cursor_touch(mc, nullptr, nullptr);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  cASSERT(mc, mc->mc_snum > 1 && mc->mc_snum == mc->mc_db->md_depth);
+
+  size_t level = 0, subtree = ((size_t)mc->mc_db->md_branch_pages +
+                               mc->mc_db->md_leaf_pages +
+                               mc->mc_db->md_overflow_pages) /
+                              page_numkeys(mc->mc_pg[0]);
+  while (subtree > pages_limit && level + 2 < mc->mc_snum)
+    subtree /= page_numkeys(mc->mc_pg[++level]);
+
+  const size_t nkeys = page_numkeys(mc->mc_pg[level]);
+  size_t n = subtree ? pages_limit / subtree : nkeys;
+  n = (n < 1) ? 1 : (n < nkeys) ? n : nkeys - 1;
+  return tree_cut(mc, level, 0, n);
+}
+
 int mdbx_drop(MDBX_txn *txn, MDBX_dbi dbi, bool del) {
   int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
   if (unlikely(rc != MDBX_SUCCESS))
@@ -22997,8 +26997,15 @@ int mdbx_drop(MDBX_txn *txn, MDBX_dbi dbi, bool del) {
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
-  rc = drop_tree(mc,
-                 dbi == MAIN_DBI || (mc->mc_db->md_flags & MDBX_DUPSORT) != 0);
+  if (unlikely(!dbi_writable(txn, dbi) ||
+               (del && dbi >= CORE_DBS && !dbi_writable(txn, MAIN_DBI)))) {
+    rc = MDBX_EACCESS;
+    goto bailout;
+  }
+
+  rc = drop_tree(mc, (dbi == MAIN_DBI &&
+                     (mc->mc_db->md_flags & MDBX_FIXEDSIZE) == 0) ||
+                        (mc->mc_db->md_flags & MDBX_DUPSORT) != 0);
   /* Invalidate the dropped DB's cursors */
   for (MDBX_cursor *m2 = txn->mt_cursors[dbi]; m2; m2 = m2->mc_next)
     m2->mc_flags &= ~(C_INITIALIZED | C_EOF);
@@ -23041,6 +27048,161 @@ bailout:
   return rc;
 }
 
+int mdbx_drop_ex(MDBX_txn *txn, MDBX_dbi dbi, bool del, size_t pages_limit) {
+  int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (pages_limit == 0)
+    return mdbx_drop(txn, dbi, del);
+
+  MDBX_cursor *mc;
+  rc = mdbx_cursor_open(txn, dbi, &mc);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(*mc->mc_dbistate & DBI_STALE)) {
+    rc = fetch_sdb(txn, dbi);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto bailout;
+  }
+
+  const MDBX_db *const db = mc->mc_db;
+  size_t pages = (size_t)db->md_branch_pages + db->md_leaf_pages +
+                 db->md_overflow_pages;
+  if (db->md_depth < 2 || pages <= pages_limit) {
+    mdbx_cursor_close(mc);
+    return mdbx_drop(txn, dbi, del);
+  }
+
+  /* Оценка размера поддеревьев может быть сильно неточной, а rebalance()
+   * может оставить слева лишь пару ключей, поэтому отрезаем порциями
+   * до исчерпания бюджета. */
+  const size_t goal = pages - pages_limit;
+  do {
+    rc = drop_chunk(mc, pages - goal);
+    pages = (size_t)db->md_branch_pages + db->md_leaf_pages +
+            db->md_overflow_pages;
+  } while (rc == MDBX_SUCCESS && pages > goal && db->md_depth > 1);
+  /* Invalidate the cursors of the partially dropped DB */
+  for (MDBX_cursor *m2 = txn->mt_cursors[dbi]; m2; m2 = m2->mc_next)
+    m2->mc_flags &= ~(C_INITIALIZED | C_EOF);
+  if (likely(rc == MDBX_SUCCESS))
+    rc = MDBX_RESULT_TRUE;
+
+bailout:
+  mdbx_cursor_close(mc);
+  return rc;
+}
+
+/* Удаляет диапазон ключей, отрезая целиком покрываемые им поддеревья.
+ * На каждой итерации курсор устанавливается на первый ключ диапазона,
+ * после чего вдоль пути курсора, начиная от корня, ищется уровень, на котором
+ * правее (либо начиная с) текущей позиции есть полностью покрываемые
+ * диапазоном поддеревья. Верхняя граница поддерева определяется ключом
+ * следующего узла на этом или одном из вышестоящих уровней. Если таких
+ * поддеревьев нет, то удаляется только текущий ключ, т.е. по-одному
+ * удаляются лишь ключи на граничных страницах. */
+static int del_range(MDBX_cursor *mc, const MDBX_val *begin,
+                     const MDBX_val *end, const MDBX_del_range_flags_t flags) {
+  int rc;
+  for (;;) {
+    MDBX_val key, data;
+    if (begin) {
+      key = *begin;
+      rc = cursor_set(mc, &key, &data, MDBX_SET_RANGE).err;
+    } else
+      rc = cursor_first(mc, &key, &data);
+    if (rc != MDBX_SUCCESS)
+      return (rc == MDBX_NOTFOUND) ? MDBX_SUCCESS : rc;
+    if (end) {
+      const int cmp = mc->mc_dbx->md_cmp(&key, end);
+      if (cmp > 0 || (cmp == 0 && !(flags & MDBX_DEL_RANGE_INCLUDE_END)))
+        return MDBX_SUCCESS;
+    }
+
+    rc = cursor_touch(mc, nullptr, nullptr);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+
+    bool upper_covered = end == nullptr;
+    for (size_t level = 0; level + 1 < mc->mc_snum; ++level) {
+      const MDBX_page *const mp = mc->mc_pg[level];
+      const size_t nkeys = page_numkeys(mp);
+      bool head = true;
+      for (size_t i = level + 1; head && i < mc->mc_snum; ++i)
+        head = mc->mc_ki[i] == 0;
+
+      /* Поддерево на пути курсора покрыто диапазоном только если курсор
+       * стоит на самом первом его ключе, а все поддеревья правее содержат
+       * только ключи больше текущего. */
+      const size_t from = mc->mc_ki[level] + (head ? 0 : 1);
+      size_t to = from;
+      while (to < nkeys) {
+        if (to + 1 < nkeys) {
+          MDBX_val sep;
+          get_key(page_node(mp, to + 1), &sep);
+          if (end && mc->mc_dbx->md_cmp(&sep, end) > 0)
+            break;
+        } else if (!upper_covered)
+          break;
+        ++to;
+      }
+      if (from == 0 && to == nkeys)
+        /* хотя бы одно поддерево должно остаться,
+         * оно будет обработано на следующих итерациях */
+        --to;
+      if (to > from) {
+        rc = tree_cut(mc, level, from, to);
+        goto next;
+      }
+
+      if (mc->mc_ki[level] + (size_t)1 < nkeys) {
+        MDBX_val sep;
+        get_key(page_node(mp, mc->mc_ki[level] + 1), &sep);
+        upper_covered = !end || mc->mc_dbx->md_cmp(&sep, end) <= 0;
+      }
+    }
+
+    const MDBX_page *const lp = mc->mc_pg[mc->mc_top];
+    if (!IS_LEAF2(lp) &&
+        unlikely(node_flags(page_node(lp, mc->mc_ki[mc->mc_top])) ==
+                 F_SUBDATA))
+      return /* disallowing implicit subDB deletion */ MDBX_INCOMPATIBLE;
+    rc = cursor_del(mc, MDBX_ALLDUPS);
+
+  next:
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+  }
+}
+
+int mdbx_del_range(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *begin,
+                   const MDBX_val *end, MDBX_del_range_flags_t flags) {
+  int rc = check_txn_rw(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(flags & ~MDBX_DEL_RANGE_INCLUDE_END))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  /* the cursor must be tracked to be consistent until the end of
+   * rebalancing, like in delete() */
+  cx.outer.mc_next = txn->mt_cursors[dbi];
+  txn->mt_cursors[dbi] = &cx.outer;
+  rc = del_range(&cx.outer, begin, end, flags);
+  txn->mt_cursors[dbi] = cx.outer.mc_next;
+  return rc;
+}
+
 int mdbx_set_compare(MDBX_txn *txn, MDBX_dbi dbi, MDBX_cmp_func *cmp) {
   int rc = check_txn(txn, MDBX_TXN_BLOCKED - MDBX_TXN_ERROR);
   if (unlikely(rc != MDBX_SUCCESS))
@@ -23263,16 +27425,18 @@ __cold MDBX_INTERNAL_FUNC int cleanup_dead_readers(MDBX_env *env,
       if (lck->mti_readers[j].mr_pid.weak == pid) {
         DEBUG("clear stale reader pid %" PRIuPTR " txn %" PRIaTXN, (size_t)pid,
               lck->mti_readers[j].mr_txnid.weak);
-        atomic_store32(&lck->mti_readers[j].mr_pid, 0, mo_Relaxed);
-        atomic_store32(&lck->mti_readers_refresh_flag, true, mo_AcquireRelease);
+        rslot_release(env, &lck->mti_readers[j]);
         count++;
       }
     }
   }
 
-  if (likely(!MDBX_IS_ERROR(rc)))
+  if (likely(!MDBX_IS_ERROR(rc))) {
     atomic_store64(&lck->mti_reader_check_timestamp, osal_monotime(),
                    mo_Relaxed);
+    if (count)
+      rc = MDBX_RESULT_TRUE;
+  }
 
   if (rdt_locked < 0)
     osal_rdt_unlock(env);
@@ -23317,7 +27481,7 @@ __cold static txnid_t kick_longlived_readers(MDBX_env *env,
   do {
     const txnid_t steady =
         env->me_txn->tw.troika.txnid[env->me_txn->tw.troika.prefer_steady];
-    env->me_lck->mti_readers_refresh_flag.weak = /* force refresh */ true;
+    readers_refresh_all(env) /* force refresh */;
     oldest = find_oldest_reader(env, steady);
     eASSERT(env, oldest < env->me_txn0->mt_txnid);
     eASSERT(env, oldest >= laggard);
@@ -23378,7 +27542,7 @@ __cold static txnid_t kick_longlived_readers(MDBX_env *env,
         /* hsr reported reader process was killed and slot should be cleared */
         safe64_reset(&stucked->mr_txnid, true);
         atomic_store64(&stucked->mr_tid, 0, mo_Relaxed);
-        atomic_store32(&stucked->mr_pid, 0, mo_AcquireRelease);
+        rslot_release(env, stucked);
       }
     } else if (!notify_eof_of_loop) {
 #if MDBX_ENABLE_PROFGC
@@ -23506,11 +27670,14 @@ __cold static int walk_tree(mdbx_walk_ctx_t *ctx, const pgno_t pgno,
   size_t unused_size =
       (mp ? page_room(mp) : pagesize - header_size) - payload_size;
   size_t align_bytes = 0;
+  const size_t align = valign(ctx->mw_cursor->mc_db->md_flags);
 
   for (size_t i = 0; err == MDBX_SUCCESS && i < nentries;
-       align_bytes += ((payload_size + align_bytes) & 1), ++i) {
+       align_bytes += (type != MDBX_page_dupfixed_leaf) &
+                      ((payload_size + align_bytes) & 1),
+              ++i) {
     if (type == MDBX_page_dupfixed_leaf) {
-      /* LEAF2 pages have no mp_ptrs[] or node headers */
+      /* LEAF2 pages have no mp_ptrs[] or node headers, nor alignment */
       payload_size += mp->mp_leaf2_ksize;
       continue;
     }
@@ -23526,14 +27693,16 @@ __cold static int walk_tree(mdbx_walk_ctx_t *ctx, const pgno_t pgno,
     assert(type == MDBX_page_leaf);
     switch (node_flags(node)) {
     case 0 /* usual node */:
+    case F_COMPRESSED /* packed data */:
       payload_size += node_ds(node);
       break;
 
-    case F_BIGDATA /* long data on the large/overflow page */: {
+    case F_BIGDATA /* long data on the large/overflow page */:
+    case F_BIGDATA | F_COMPRESSED: {
       payload_size += sizeof(pgno_t);
       const pgno_t large_pgno = node_largedata_pgno(node);
       const size_t over_payload = node_ds(node);
-      const size_t over_header = PAGEHDRSZ;
+      const size_t over_header = largedata_offset(align);
       npages = 1;
 
       assert(err == MDBX_SUCCESS);
@@ -23600,7 +27769,9 @@ __cold static int walk_tree(mdbx_walk_ctx_t *ctx, const pgno_t pgno,
       }
 
       for (size_t j = 0; err == MDBX_SUCCESS && j < nsubkeys;
-           subalign_bytes += ((subpayload_size + subalign_bytes) & 1), ++j) {
+           subalign_bytes += (subtype != MDBX_subpage_dupfixed_leaf) &
+                             ((subpayload_size + subalign_bytes) & 1),
+                  ++j) {
 
         if (subtype == MDBX_subpage_dupfixed_leaf) {
           /* LEAF2 pages have no mp_ptrs[] or node headers */
@@ -23632,6 +27803,12 @@ __cold static int walk_tree(mdbx_walk_ctx_t *ctx, const pgno_t pgno,
       assert(err == MDBX_CORRUPTED);
       err = MDBX_CORRUPTED;
     }
+
+    if (unlikely(align))
+      /* промежутки выравнивания ключей и значений, см. leaf_node_bytes() */
+      align_bytes += leaf_node_bytes(node, align) - NODESIZE - node_ks(node) -
+                     ((node_flags(node) & F_BIGDATA) ? sizeof(pgno_t)
+                                                     : node_ds(node));
   }
 
   const int rc = ctx->mw_visitor(
@@ -23759,6 +27936,9 @@ int mdbx_canary_put(MDBX_txn *txn, const MDBX_canary *canary) {
   if (unlikely(rc != MDBX_SUCCESS))
     return rc;
 
+  if (unlikely(txn->mt_flags & MDBX_TXN_DISJOINT))
+    return MDBX_EACCESS;
+
   if (likely(canary)) {
     if (txn->mt_canary.x == canary->x && txn->mt_canary.y == canary->y &&
         txn->mt_canary.z == canary->z)
@@ -24228,6 +28408,205 @@ int mdbx_estimate_range(MDBX_txn *txn, MDBX_dbi dbi, MDBX_val *begin_key,
   return MDBX_SUCCESS;
 }
 
+/* Разбиение таблицы на диапазоны для параллельного просмотра.
+ *
+ * Спускаемся от корня до первого уровня, на котором набирается не менее
+ * заданного количества элементов, и выбираем из них равномерно отстоящие
+ * ключи. Также как и в mdbx_estimate_range() предполагается, что поддеревья
+ * элементов одного уровня содержат примерно одинаковое количество записей.
+ * Поскольку на каждом уровне кроме последнего менее n элементов, то
+ * загружается не более n страниц на уровень. */
+typedef struct partition_frame {
+  MDBX_page *page;
+  /* нижняя граница ключей страницы, взятая из родительского узла */
+  MDBX_val lower;
+} partition_frame_t;
+
+int mdbx_dbi_partition(MDBX_txn *txn, MDBX_dbi dbi, size_t n,
+                       MDBX_val *boundaries, size_t *count) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!count || n < 1 || n > INT32_MAX || (n > 1 && !boundaries)))
+    return MDBX_EINVAL;
+  *count = 1;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  rc = page_search(&cx.outer, NULL, MDBX_PS_ROOTONLY);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return (rc == MDBX_NOTFOUND) ? MDBX_SUCCESS : rc;
+  if (n == 1)
+    return MDBX_SUCCESS;
+
+  partition_frame_t *const buffer =
+      osal_malloc(sizeof(partition_frame_t) * n * 2);
+  if (unlikely(!buffer))
+    return MDBX_ENOMEM;
+  partition_frame_t *level = buffer, *next = buffer + n;
+  level[0].page = cx.outer.mc_pg[0];
+  level[0].lower.iov_base = nullptr;
+  level[0].lower.iov_len = 0;
+  size_t width = 1, total;
+  while (true) {
+    total = 0;
+    for (size_t i = 0; i < width; ++i)
+      total += page_numkeys(level[i].page);
+    if (total >= n || IS_LEAF(level[0].page))
+      break;
+
+    /* на этом уровне менее n элементов, спускаемся ниже */
+    size_t w = 0;
+    for (size_t i = 0; i < width; ++i) {
+      const MDBX_page *const mp = level[i].page;
+      for (size_t k = 0; k < page_numkeys(mp); ++k) {
+        const MDBX_node *const node = page_node(mp, k);
+        rc = page_get(&cx.outer, node_pgno(node), &next[w].page, mp->mp_txnid);
+        if (unlikely(rc != MDBX_SUCCESS))
+          goto bailout;
+        if (k)
+          get_key(node, &next[w].lower);
+        else
+          next[w].lower = level[i].lower;
+        ++w;
+      }
+    }
+    tASSERT(txn, w == total && w < n);
+    partition_frame_t *const swap = level;
+    level = next;
+    next = swap;
+    width = w;
+  }
+
+  /* На листовом уровне элементов может быть меньше запрошенного. */
+  const size_t parts = (total < n) ? total : n;
+  size_t i = 0, base = 0;
+  for (size_t j = 1; j < parts; ++j) {
+    const size_t target = j * total / parts;
+    while (target >= base + page_numkeys(level[i].page))
+      base += page_numkeys(level[i++].page);
+    const size_t k = target - base;
+    if (k && IS_LEAF2(level[i].page))
+      leaf2_read(&cx.outer, level[i].page, k, &boundaries[j - 1], nullptr);
+    else if (k)
+      get_key(page_node(level[i].page, k), &boundaries[j - 1]);
+    else
+      boundaries[j - 1] = level[i].lower;
+  }
+  *count = parts ? parts : 1;
+
+bailout:
+  osal_free(buffer);
+  return rc;
+}
+
+typedef struct partition_scan {
+  MDBX_txn *origin;
+  const MDBX_val *boundaries;
+  size_t count;
+  MDBX_partition_func *visitor;
+  void *ctx;
+  MDBX_dbi dbi;
+  MDBX_atomic_uint32_t next;
+  MDBX_atomic_uint32_t error;
+} partition_scan_t;
+
+static int partition_scan_loop(partition_scan_t *ps, MDBX_txn *txn) {
+  MDBX_cursor *mc;
+  int rc = mdbx_cursor_open(txn, ps->dbi, &mc);
+  while (likely(rc == MDBX_SUCCESS) &&
+         atomic_load32(&ps->error, mo_Relaxed) == MDBX_SUCCESS) {
+    const size_t i = atomic_add32(&ps->next, 1);
+    if (i >= ps->count)
+      break;
+    MDBX_val key = {nullptr, 0}, data;
+    if (i)
+      key = ps->boundaries[i - 1];
+    rc = mdbx_cursor_get(mc, &key, &data, i ? MDBX_SET_RANGE : MDBX_FIRST);
+    if (rc == MDBX_SUCCESS)
+      rc = ps->visitor(ps->ctx, mc, i,
+                       (i + 1 < ps->count) ? &ps->boundaries[i] : nullptr);
+    else if (rc == MDBX_NOTFOUND)
+      rc = MDBX_SUCCESS /* empty partition */;
+  }
+  if (mc)
+    mdbx_cursor_close(mc);
+  if (unlikely(rc != MDBX_SUCCESS))
+    atomic_cas32(&ps->error, MDBX_SUCCESS, (uint32_t)rc);
+  return rc;
+}
+
+static THREAD_RESULT THREAD_CALL partition_scan_thread(void *arg) {
+  partition_scan_t *const ps = arg;
+  MDBX_txn *clone;
+  int rc = mdbx_txn_clone(ps->origin, &clone);
+  if (likely(rc == MDBX_SUCCESS)) {
+    partition_scan_loop(ps, clone);
+    rc = mdbx_txn_abort(clone);
+  }
+  if (unlikely(rc != MDBX_SUCCESS))
+    atomic_cas32(&ps->error, MDBX_SUCCESS, (uint32_t)rc);
+  return (THREAD_RESULT)0;
+}
+
+int mdbx_dbi_partition_scan(MDBX_txn *txn, MDBX_dbi dbi, size_t partitions,
+                            unsigned threads, MDBX_partition_func *visitor,
+                            void *ctx) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!visitor || threads < 1))
+    return MDBX_EINVAL;
+
+  /* клоны возможны только для читающих транзакций */
+  if (unlikely((txn->mt_flags & MDBX_TXN_RDONLY) == 0))
+    return MDBX_EINVAL;
+
+  if (threads > partitions)
+    threads = (unsigned)partitions;
+  MDBX_val *const boundaries = osal_malloc(sizeof(MDBX_val) * partitions +
+                                           sizeof(osal_thread_t) * threads);
+  if (unlikely(!boundaries))
+    return MDBX_ENOMEM;
+  osal_thread_t *const workers =
+      ptr_disp(boundaries, sizeof(MDBX_val) * partitions);
+
+  partition_scan_t ps;
+  rc = mdbx_dbi_partition(txn, dbi, partitions, boundaries, &ps.count);
+  if (likely(rc == MDBX_SUCCESS)) {
+    ps.boundaries = boundaries;
+    ps.origin = txn;
+    ps.visitor = visitor;
+    ps.ctx = ctx;
+    ps.dbi = dbi;
+    atomic_store32(&ps.next, 0, mo_Relaxed);
+    atomic_store32(&ps.error, MDBX_SUCCESS, mo_Relaxed);
+    /* текущий поток также обрабатывает диапазоны, используя исходную
+     * транзакцию, а при ошибке создания потоков справится с остатком */
+    size_t started = 0;
+    while (started + 1 < threads && started + 1 < ps.count &&
+           osal_thread_create(&workers[started], partition_scan_thread, &ps) ==
+               MDBX_SUCCESS)
+      ++started;
+    partition_scan_loop(&ps, txn);
+    while (started)
+      osal_thread_join(workers[--started]);
+    rc = (int)atomic_load32(&ps.error, mo_AcquireRelease);
+  }
+
+  osal_free(boundaries);
+  return rc;
+}
+
+
 //------------------------------------------------------------------------------
 
 /* Позволяет обновить или удалить существующую запись с получением
@@ -24307,6 +28686,8 @@ int mdbx_replace_ex(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
       return MDBX_EINVAL;
     MDBX_val present_data;
     rc = cursor_set(&cx.outer, &present_key, &present_data, MDBX_SET_KEY).err;
+    if (likely(rc == MDBX_SUCCESS))
+      rc = cursor_unpack(&cx.outer, &present_data);
     if (unlikely(rc != MDBX_SUCCESS)) {
       old_data->iov_base = NULL;
       old_data->iov_len = 0;
@@ -24384,6 +28765,183 @@ int mdbx_replace(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
                          default_value_preserver, nullptr);
 }
 
+/**** PARTIAL VALUES **********************************************************/
+
+static int range_slice(const MDBX_val *value, size_t offset, size_t length,
+                       MDBX_val *data) {
+  if (unlikely(offset > value->iov_len))
+    return MDBX_EINVAL;
+  const size_t tail = value->iov_len - offset;
+  data->iov_base = ptr_disp(value->iov_base, offset);
+  data->iov_len = (length < tail) ? length : tail;
+  return MDBX_SUCCESS;
+}
+
+int mdbx_get_range(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                   size_t offset, size_t length, MDBX_val *data) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!key || !data))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(txn->mt_dbs[dbi].md_flags & MDBX_DUPSORT))
+    return MDBX_INCOMPATIBLE;
+
+  MDBX_val value;
+  if (unlikely(txn->mt_flags & MDBX_TXN_OPTIMISTIC))
+    rc = optimistic_get(txn, dbi, key, &value);
+  else {
+    MDBX_cursor_couple cx;
+    rc = cursor_init(&cx.outer, txn, dbi);
+    if (likely(rc == MDBX_SUCCESS))
+      rc = cursor_set(&cx.outer, (MDBX_val *)key, &value, MDBX_SET).err;
+    /* Длинные значения размещаются в последовательных страницах и доступны
+     * в отображении целиком, поэтому диапазон возвращается без копирования.
+     * Исключением являются сжатые значения, которые распаковываются. */
+    if (likely(rc == MDBX_SUCCESS))
+      rc = cursor_unpack(&cx.outer, &value);
+  }
+  return likely(rc == MDBX_SUCCESS) ? range_slice(&value, offset, length, data)
+                                    : rc;
+}
+
+/* Формирует новое значение целиком, накладывая data на копию present. */
+static void *range_patch(const MDBX_val *present, size_t offset,
+                         const MDBX_val *data, MDBX_val *value) {
+  const size_t end = offset + data->iov_len;
+  value->iov_len = (end > present->iov_len) ? end : present->iov_len;
+  value->iov_base = osal_malloc(value->iov_len);
+  if (likely(value->iov_base)) {
+    memcpy(value->iov_base, present->iov_base, offset);
+    memcpy(ptr_disp(value->iov_base, offset), data->iov_base, data->iov_len);
+    if (end < present->iov_len)
+      memcpy(ptr_disp(value->iov_base, end), ptr_disp(present->iov_base, end),
+             present->iov_len - end);
+  }
+  return value->iov_base;
+}
+
+int mdbx_put_range(MDBX_txn *txn, MDBX_dbi dbi, const MDBX_val *key,
+                   size_t offset, const MDBX_val *data) {
+  int rc = check_txn(txn, MDBX_TXN_BLOCKED);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+
+  if (unlikely(!key || !data || (!data->iov_base && data->iov_len)))
+    return MDBX_EINVAL;
+
+  if (unlikely(!check_dbi(txn, dbi, DBI_USRVALID)))
+    return MDBX_BAD_DBI;
+
+  if (unlikely(txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN |
+                                MDBX_TXN_BLOCKED)) &&
+      !(txn->mt_flags & MDBX_TXN_OPTIMISTIC))
+    return (txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN))
+               ? MDBX_EACCESS
+               : MDBX_BAD_TXN;
+
+  if (unlikely(txn->mt_dbs[dbi].md_flags & MDBX_DUPSORT))
+    return MDBX_INCOMPATIBLE;
+
+  if (unlikely(offset > MDBX_MAXDATASIZE ||
+               data->iov_len > MDBX_MAXDATASIZE - offset))
+    return MDBX_BAD_VALSIZE;
+
+  MDBX_val present, value;
+  if (unlikely(txn->mt_flags & MDBX_TXN_OPTIMISTIC)) {
+    rc = optimistic_get(txn, dbi, key, &present);
+    if (unlikely(rc != MDBX_SUCCESS))
+      return rc;
+    if (unlikely(offset > present.iov_len))
+      return MDBX_EINVAL;
+    if (unlikely(!range_patch(&present, offset, data, &value)))
+      return MDBX_ENOMEM;
+    rc = optimistic_put(txn, dbi, key, &value, 0);
+    osal_free(value.iov_base);
+    return rc;
+  }
+
+  MDBX_cursor_couple cx;
+  rc = cursor_init(&cx.outer, txn, dbi);
+  if (unlikely(rc != MDBX_SUCCESS))
+    return rc;
+  cx.outer.mc_next = txn->mt_cursors[dbi];
+  txn->mt_cursors[dbi] = &cx.outer;
+
+  rc = cursor_set(&cx.outer, (MDBX_val *)key, &present, MDBX_SET).err;
+  if (unlikely(rc != MDBX_SUCCESS))
+    goto bailout;
+
+  /* в LEAF2-страницах MDBX_FIXEDSIZE-таблиц нет узлов */
+  const MDBX_page *const mp = cx.outer.mc_pg[cx.outer.mc_top];
+  const MDBX_node *const node =
+      IS_LEAF2(mp) ? nullptr : page_node(mp, cx.outer.mc_ki[cx.outer.mc_top]);
+  if (likely((!node || ((node_flags(node) & F_COMPRESSED) == 0 &&
+                        key->iov_len == node_ks(node))) &&
+             offset + data->iov_len <= present.iov_len)) {
+    if (unlikely(data->iov_len == 0))
+      goto bailout;
+
+    /* Размер значения не меняется, поэтому обновление выполняется на месте
+     * посредством MDBX_RESERVE: значение внутри листовой страницы копируется
+     * вместе с ней при COW, а длинное значение, уже измененное в текущей
+     * транзакции, остается в своих страницах. Последовательность страниц
+     * длинного значения должна быть непрерывной, поэтому из зафиксированного
+     * снимка (или родительской транзакции) оно перемещается целиком, но
+     * однократно и с копированием лишь неизменяемых частей. Исходные страницы
+     * при этом остаются доступны до завершения транзакции. */
+    const void *origin = nullptr;
+    if (node && (node_flags(node) & F_BIGDATA)) {
+      const pgr_t lp =
+          page_get_large(&cx.outer, node_largedata_pgno(node),
+                         cx.outer.mc_pg[cx.outer.mc_top]->mp_txnid);
+      rc = lp.err;
+      if (unlikely(rc != MDBX_SUCCESS))
+        goto bailout;
+      if (IS_FROZEN(txn, lp.page) || IS_SHADOWED(txn, lp.page))
+        origin = present.iov_base;
+    }
+
+    value.iov_base = nullptr;
+    value.iov_len = present.iov_len;
+    rc = cursor_put_checklen(&cx.outer, key, &value,
+                             MDBX_CURRENT | MDBX_RESERVE);
+    if (likely(rc == MDBX_SUCCESS)) {
+      if (origin && origin != value.iov_base) {
+        const size_t end = offset + data->iov_len;
+        memcpy(value.iov_base, origin, offset);
+        memcpy(ptr_disp(value.iov_base, end), ptr_disp(origin, end),
+               present.iov_len - end);
+      }
+      memcpy(ptr_disp(value.iov_base, offset), data->iov_base, data->iov_len);
+    }
+  } else {
+    /* Сжатое значение или увеличение размера: перезапись целиком. */
+    rc = cursor_unpack(&cx.outer, &present);
+    if (unlikely(rc != MDBX_SUCCESS))
+      goto bailout;
+    if (unlikely(offset > present.iov_len)) {
+      rc = MDBX_EINVAL;
+      goto bailout;
+    }
+    if (unlikely(!range_patch(&present, offset, data, &value))) {
+      rc = MDBX_ENOMEM;
+      goto bailout;
+    }
+    rc = cursor_put_checklen(&cx.outer, key, &value, MDBX_CURRENT);
+    osal_free(value.iov_base);
+  }
+
+bailout:
+  txn->mt_cursors[dbi] = cx.outer.mc_next;
+  return rc;
+}
+
 /* Функция сообщает находится ли указанный адрес в "грязной" странице у
  * заданной пишущей транзакции. В конечном счете это позволяет избавиться от
  * лишнего копирования данных из НЕ-грязных страниц.
@@ -24466,7 +29024,8 @@ int mdbx_dbi_sequence(MDBX_txn *txn, MDBX_dbi dbi, uint64_t *result,
     *result = dbs->md_seq;
 
   if (likely(increment > 0)) {
-    if (unlikely(txn->mt_flags & MDBX_TXN_RDONLY))
+    if (unlikely((txn->mt_flags & (MDBX_TXN_RDONLY | MDBX_TXN_FROZEN)) ||
+                 !dbi_writable(txn, dbi)))
       return MDBX_EACCESS;
 
     uint64_t new = dbs->md_seq + increment;
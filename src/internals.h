@@ -510,7 +510,7 @@ MDBX_MAYBE_UNUSED static __always_inline uint32_t atomic_load32(
 /* FROZEN: The version number for a database's datafile format. */
 #define MDBX_DATA_VERSION 3
 /* The version number for a database's lockfile format. */
-#define MDBX_LOCK_VERSION 5
+#define MDBX_LOCK_VERSION 6
 
 /* handle for the DB used to track free pages. */
 #define FREE_DBI 0
@@ -567,7 +567,7 @@ typedef uint16_t indx_t;
 typedef struct MDBX_db {
   uint16_t md_flags;        /* see mdbx_dbi_open */
   uint16_t md_depth;        /* depth of this tree */
-  uint32_t md_xsize;        /* key-size for MDBX_DUPFIXED (LEAF2 pages) */
+  uint32_t md_xsize;        /* key-size for MDBX_DUPFIXED and MDBX_FIXEDSIZE */
   pgno_t md_root;           /* the root page of this tree */
   pgno_t md_branch_pages;   /* number of internal pages */
   pgno_t md_leaf_pages;     /* number of leaf pages */
@@ -807,6 +807,26 @@ typedef pthread_mutex_t osal_ipclock_t;
 #elif MDBX_LOCKING == MDBX_LOCKING_POSIX1988
 #define MDBX_CLOCK_SIGN UINT32_C(0xFC29)
 typedef sem_t osal_ipclock_t;
+#elif MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+#if !(defined(__linux__) || defined(__gnu_linux__))
+#error "Futex-based MDBX_LOCKING is available only on Linux"
+#endif /* Linux */
+#define MDBX_CLOCK_SIGN UINT32_C(0xF195)
+typedef struct osal_ipclock {
+  /* Слово futex: ноль если блокировка свободна, иначе pid процесса-владельца
+   * либо IPCLOCK_HANDOFF при передаче владения разбуженному ожидающему. */
+  MDBX_atomic_uint32_t ipc_futex;
+  /* Количество ожидающих, в том числе спящих на futex. */
+  MDBX_atomic_uint32_t ipc_waiters;
+  /* Скользящее среднее длительности удержания в наносекундах,
+   * по которому принимается решение о spin-ожидании. */
+  MDBX_atomic_uint32_t ipc_hold_ema;
+  uint32_t ipc_reserved;
+  /* Момент захвата, изменяется только владельцем. */
+  uint64_t ipc_acquired;
+  /* Количество захватов с ожиданием, изменяется только владельцем. */
+  uint64_t ipc_contended;
+} osal_ipclock_t;
 #else
 #error "FIXME"
 #endif /* MDBX_LOCKING */
@@ -886,8 +906,38 @@ typedef struct MDBX_reader {
    * at any time the difference mm_pages_retired - mr_snapshot_pages_retired
    * will give the number of pages which this reader restraining from reuse. */
   MDBX_atomic_uint64_t mr_snapshot_pages_retired;
+
+#if MDBX_CACHELINE_SIZE > 32
+  /* Each slot occupies a whole cacheline, so starting and finishing read
+   * transactions in different threads do not interfere by false sharing. */
+  uint8_t mr_padding[MDBX_CACHELINE_SIZE - 32];
+#endif /* MDBX_CACHELINE_SIZE > 32 */
 } MDBX_reader;
 
+#define MDBX_READERS_LIMIT 131072
+
+/* The reader table is split into shards of MDBX_READERS_SHARD slots. */
+#define MDBX_READERS_SHARD 64
+
+/* The descriptor of a shard of the reader table. Descriptors are placed in
+ * the lock file right after the slots of all shards, each within its own
+ * cacheline. */
+typedef struct MDBX_rshard {
+  /* The flag which is reset by readers at the start and the end of a read
+   * transaction, and is set by the writer when the oldest txnid of the shard
+   * is recalculated. Zeroed lck-file means that all shards are dirty. */
+  MDBX_atomic_uint32_t rs_clean;
+  /* The number of occupied slots, i.e. a hint for searching a vacant slot. */
+  MDBX_atomic_uint32_t rs_count;
+  /* The slot within the shard where to start the search for a vacant one. */
+  MDBX_atomic_uint32_t rs_hint;
+  uint32_t rs_reserved;
+  /* The oldest txnid of readers within the shard, valid while the shard is
+   * clean. Accessed only by the writer under the mti_wlock. */
+  txnid_t rs_oldest;
+  uint8_t rs_padding[MDBX_CACHELINE_SIZE - 24];
+} MDBX_rshard;
+
 /* The header for the reader table (a memory-mapped lock file). */
 typedef struct MDBX_lockinfo {
   /* Stamp identifying this as an MDBX file.
@@ -967,6 +1017,13 @@ typedef struct MDBX_lockinfo {
 
   MDBX_ALIGNAS(MDBX_CACHELINE_SIZE) /* cacheline ----------------------------*/
 
+  /* Counter of commits, used as a futex by mdbx_env_wait_commit(). */
+  MDBX_atomic_uint32_t mti_commit_seq;
+  /* Number of waiters for a commit, to avoid needless futex wakes. */
+  MDBX_atomic_uint32_t mti_commit_waiters;
+
+  MDBX_ALIGNAS(MDBX_CACHELINE_SIZE) /* cacheline ----------------------------*/
+
   /* Readeaders registration lock. */
 #if MDBX_LOCKING > 0
   osal_ipclock_t mti_rlock;
@@ -1036,7 +1093,6 @@ typedef struct MDBX_lockinfo {
 #define MDBX_PGL_LIMIT (MAX_MAPSIZE32 / MIN_PAGESIZE)
 #endif /* MDBX_WORDBITS */
 
-#define MDBX_READERS_LIMIT 32767
 #define MDBX_RADIXSORT_THRESHOLD 142
 #define MDBX_GOLD_RATIO_DBL 1.6180339887498948482
 
@@ -1069,6 +1125,8 @@ typedef struct MDBX_dp {
 /* An DPL (dirty-page list) is a sorted array of MDBX_DPs. */
 typedef struct MDBX_dpl {
   size_t sorted;
+  size_t sorted_run; /* number of items after the sorted head, which are
+                        sorted too and could be searched separately */
   size_t length;
   size_t pages_including_loose; /* number of pages, but not an entries. */
   size_t detent; /* allocated size excluding the MDBX_DPL_RESERVE_GAP */
@@ -1122,6 +1180,19 @@ typedef struct MDBX_dpl {
 /* Auxiliary DB info.
  * The information here is mostly static/read-only. There is
  * only a single copy of this record in the environment. */
+/* Positions of recent insertions into a leaf page, which are used to choose
+ * a split point for monotone and near-monotone insertion patterns.
+ * A few pages are tracked at once (hashed by page number) to handle several
+ * interleaved insertion streams. */
+#define SPLIT_HINT_DEPTH 8
+#define SPLIT_HINT_SLOTS 64
+typedef struct split_hint {
+  pgno_t pgno;      /* the leaf page of recent insertions */
+  uint16_t count;   /* number of tracked insertions */
+  uint16_t appends; /* number of last insertions at the end of page */
+  indx_t pos[SPLIT_HINT_DEPTH]; /* positions of ones, the newest first */
+} split_hint_t;
+
 typedef struct MDBX_dbx {
   MDBX_val md_name;                /* name of the database */
   MDBX_cmp_func *md_cmp;           /* function for comparing keys */
@@ -1129,6 +1200,14 @@ typedef struct MDBX_dbx {
   size_t md_klen_min, md_klen_max; /* min/max key length for the database */
   size_t md_vlen_min,
       md_vlen_max; /* min/max value/data length for the database */
+  /* recent insertions (allocated on demand), see page_split() */
+  split_hint_t *md_split_hints;
+  /* codec for values, see mdbx_dbi_set_codec() */
+  const MDBX_codec *md_codec;
+  size_t md_codec_threshold; /* min length of value to be packed */
+  /* min length of value to be moved into the value log, or zero,
+   * see mdbx_dbi_set_vlog() */
+  size_t md_vlog_threshold;
 } MDBX_dbx;
 
 typedef struct troika {
@@ -1158,10 +1237,14 @@ struct MDBX_txn {
 #define MDBX_SHRINK_ALLOWED UINT32_C(0x40000000)
 
 #define MDBX_TXN_DRAINED_GC 0x20 /* GC was depleted up to oldest reader */
+#define MDBX_TXN_DISJOINT 0x40 /* see mdbx_txn_begin_disjoint() */
+#define MDBX_TXN_OPTIMISTIC 0x80 /* see mdbx_txn_begin_optimistic() */
+#define MDBX_TXN_FROZEN 0x100    /* see mdbx_txn_freeze() */
 
 #define TXN_FLAGS                                                              \
   (MDBX_TXN_FINISHED | MDBX_TXN_ERROR | MDBX_TXN_DIRTY | MDBX_TXN_SPILLS |     \
-   MDBX_TXN_HAS_CHILD | MDBX_TXN_INVALID | MDBX_TXN_DRAINED_GC)
+   MDBX_TXN_HAS_CHILD | MDBX_TXN_INVALID | MDBX_TXN_DRAINED_GC |               \
+   MDBX_TXN_DISJOINT | MDBX_TXN_OPTIMISTIC | MDBX_TXN_FROZEN)
 
 #if (TXN_FLAGS & (MDBX_TXN_RW_BEGIN_FLAGS | MDBX_TXN_RO_BEGIN_FLAGS)) ||       \
     ((MDBX_TXN_RW_BEGIN_FLAGS | MDBX_TXN_RO_BEGIN_FLAGS | TXN_FLAGS) &         \
@@ -1201,6 +1284,7 @@ struct MDBX_txn {
 #define DBI_VALID 0x10           /* DB handle is valid, see also DB_VALID */
 #define DBI_USRVALID 0x20        /* As DB_VALID, but not set for FREE_DBI */
 #define DBI_AUDITED 0x40         /* Internal flag for accounting during audit */
+#define DBI_OWNED 0x80           /* DB is held by a disjoint write txn */
   /* Array of flags for each DB */
   uint8_t *mt_dbistate;
   /* Number of DB records in use, or 0 when the txn is finished.
@@ -1211,11 +1295,18 @@ struct MDBX_txn {
   MDBX_canary mt_canary;
   void *mt_userctx; /* User-settable context */
   MDBX_cursor **mt_cursors;
+  /* Values unpacked by codecs, freed at the end of the transaction */
+  struct codec_chunk *mt_codec_arena;
+  MDBX_atomic_uint32_t mt_codec_lock; /* guards arena of a frozen txn */
+  size_t mt_codec_bufsize;
+  void *mt_codec_buf; /* buffer for values being packed by put */
 
   union {
     struct {
       /* For read txns: This thread/txn's reader table slot, or NULL. */
       MDBX_reader *reader;
+      /* For optimistic txns: the tracked reads and buffered updates. */
+      struct MDBX_oplog *oplog;
     } to;
     struct {
       meta_troika_t troika;
@@ -1243,6 +1334,21 @@ struct MDBX_txn {
       MDBX_page *loose_pages;
       /* Number of loose pages (tw.loose_pages) */
       size_t loose_count;
+      /* Private scratch page of a disjoint txn, instead of env->me_pbuf */
+      MDBX_page *scratch;
+      /* Number of view cursors bound while the txn is frozen */
+      MDBX_atomic_uint32_t views;
+      /* Number of unfinished streaming puts of large values */
+      size_t streams;
+      /* State of the value log, see mdbx_dbi_set_vlog() */
+      struct {
+        bool known;      /* the tail was loaded from the index */
+        uint64_t origin; /* the tail at the txn start, for rollback */
+        uint64_t tail;   /* the end of the log for next appends */
+        /* not yet flushed changes of the index */
+        struct vlog_delta *deltas;
+        size_t deltas_count, deltas_limit;
+      } vlog;
       union {
         struct {
           size_t least_removed;
@@ -1306,6 +1412,7 @@ struct MDBX_cursor {
 #define C_GCU                                                                                  \
   0x20 /* Происходит подготовка к обновлению GC, поэтому \
         * можно брать страницы из GC даже для FREE_DBI */
+#define C_VIEW 0x40 /* untracked cursor of a frozen write txn */
   uint8_t mc_flags;
 
   /* Cursor checking flags. */
@@ -1386,6 +1493,7 @@ struct MDBX_env {
                                  merging */
   unsigned me_os_psize;       /* OS page size, from osal_syspagesize() */
   unsigned me_maxreaders;     /* size of the reader table */
+  MDBX_rshard *me_rshards;    /* descriptors of the reader table shards */
   MDBX_dbi me_maxdbs;         /* size of the DB table */
   uint32_t me_pid;            /* process ID of this env */
   osal_thread_key_t me_txkey; /* thread-key for readers */
@@ -1455,6 +1563,14 @@ struct MDBX_env {
   MDBX_txn *me_txn; /* current write transaction */
   osal_fastmutex_t me_dbi_lock;
   MDBX_dbi me_numdbs; /* number of DBs opened */
+  /* value log of large values, see mdbx_dbi_set_vlog() */
+  struct {
+    pathchar_t *pathname;
+    osal_fastmutex_t lock; /* guards the lazy opening of the fd */
+    mdbx_filehandle_t fd;  /* opened lazily under the lock above */
+    mdbx_mode_t mode;     /* for creation, the same as of lck-file */
+    MDBX_dbi dbi;         /* the live-bytes index, or zero */
+  } me_vlog;
   bool me_prefault_write;
 
   MDBX_page *me_dp_reserve; /* list of malloc'ed blocks for re-use */
@@ -1473,6 +1589,23 @@ struct MDBX_env {
   osal_fastmutex_t me_remap_guard;
 #endif
 
+#if !(defined(_WIN32) || defined(_WIN64))
+  /* watcher of commits for mdbx_env_get_commit_fd() */
+  struct {
+    osal_thread_t thread;
+    int fd[2]; /* the same eventfd on Linux, or a pipe otherwise */
+    MDBX_atomic_uint32_t stop;
+    bool running;
+  } me_commit_watch;
+#endif /* !Windows */
+
+  /* disjoint write txns, see mdbx_txn_begin_disjoint() */
+  struct {
+    osal_fastmutex_t lock;
+    MDBX_atomic_uint32_t active; /* number of running disjoint txns */
+    MDBX_txn *parked; /* committed ones which awaiting merge into the parent */
+  } me_disjoint;
+
   /* -------------------------------------------------------------- debugging */
 
 #if MDBX_DEBUG
@@ -1544,7 +1677,7 @@ osal_flush_incoherent_mmap(const void *addr, size_t nbytes,
 MDBX_INTERNAL_FUNC int cleanup_dead_readers(MDBX_env *env, int rlocked,
                                             int *dead);
 MDBX_INTERNAL_FUNC int rthc_alloc(osal_thread_key_t *key, MDBX_reader *begin,
-                                  MDBX_reader *end);
+                                  MDBX_reader *end, MDBX_rshard *shards);
 MDBX_INTERNAL_FUNC void rthc_remove(const osal_thread_key_t key);
 
 MDBX_INTERNAL_FUNC void global_ctor(void);
@@ -1620,7 +1753,15 @@ MDBX_INTERNAL_FUNC void thread_dtor(void *ptr);
  * Leaf node flags describe node contents.  F_BIGDATA says the node's
  * data part is the page number of an overflow page with actual data.
  * F_DUPDATA and F_SUBDATA can be combined giving duplicate data in
- * a sub-page/sub-database, and named databases (just F_SUBDATA). */
+ * a sub-page/sub-database, and named databases (just F_SUBDATA).
+ * F_COMPRESSED says the data (in-node or on overflow page) is packed
+ * by a codec and prefixed with a codec header, it may only be combined
+ * with F_BIGDATA.
+ *
+ * In leaf nodes mn_extra is the number of padding bytes between the key and
+ * the data, which is non-zero only for tables with aligned values (see
+ * MDBX_ALIGNVALUE8 etc). Such nodes occupy a multiple of the alignment, so
+ * that the data is aligned relative to the page. */
 typedef struct MDBX_node {
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
   union {
@@ -1644,9 +1785,12 @@ typedef struct MDBX_node {
 #define F_BIGDATA 0x01 /* data put on overflow page */
 #define F_SUBDATA 0x02 /* data is a sub-database */
 #define F_DUPDATA 0x04 /* data has duplicates */
+#define F_COMPRESSED 0x08 /* data is packed by codec, see mdbx_dbi_set_codec() */
 
   /* valid flags for mdbx_node_add() */
-#define NODE_ADD_FLAGS (F_DUPDATA | F_SUBDATA | MDBX_RESERVE | MDBX_APPEND)
+#define NODE_ADD_FLAGS                                                         \
+  (F_BIGDATA | F_DUPDATA | F_SUBDATA | F_COMPRESSED | MDBX_RESERVE |           \
+   MDBX_APPEND)
 
 #if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L) ||              \
     (!defined(__cplusplus) && defined(_MSC_VER))
@@ -1656,7 +1800,11 @@ typedef struct MDBX_node {
 
 #define DB_PERSISTENT_FLAGS                                                    \
   (MDBX_REVERSEKEY | MDBX_DUPSORT | MDBX_INTEGERKEY | MDBX_DUPFIXED |          \
-   MDBX_INTEGERDUP | MDBX_REVERSEDUP)
+   MDBX_INTEGERDUP | MDBX_REVERSEDUP | MDBX_FIXEDSIZE | DB_ALIGNVALUE_FLAGS)
+
+/* alignment of values, only one of these could be set */
+#define DB_ALIGNVALUE_FLAGS                                                    \
+  (MDBX_ALIGNVALUE8 | MDBX_ALIGNVALUE16 | MDBX_ALIGNVALUE64)
 
 /* mdbx_dbi_open() flags */
 #define DB_USABLE_FLAGS (DB_PERSISTENT_FLAGS | MDBX_CREATE | MDBX_DB_ACCEDE)
@@ -293,6 +293,172 @@ MDBX_INTERNAL_FUNC int osal_rpid_check(MDBX_env *env, uint32_t pid) {
 
 /*---------------------------------------------------------------------------*/
 
+#if MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+/* Futex-based inter-process lock.
+ *
+ * The futex word holds the pid of the owner process, therefore a dead owner
+ * can be detected by the pid-byte lock within the DXB file, which each process
+ * holds while the environment is open. Actually the same as the robust-list
+ * does for pthread's mutexes, but without the need for the kernel's per-thread
+ * list, which is already owned by the libc.
+ *
+ * On release the ownership is handed directly to the longest sleeping waiter
+ * (the kernel wakes futex waiters in FIFO order), so the newcomers can't barge
+ * in front of sleeping writers. Before sleeping a contender spins for a while,
+ * but only if the lock is usually held shortly. */
+
+#define IPCLOCK_HANDOFF UINT32_C(0x80000000)
+#define IPCLOCK_SPIN_NS UINT32_C(32000)
+#define IPCLOCK_DEADCHECK_NS UINT32_C(250000000)
+
+static __always_inline bool ipclock_cas(MDBX_atomic_uint32_t *p, uint32_t c,
+                                        uint32_t v) {
+#ifdef MDBX_HAVE_C11ATOMICS
+  return atomic_compare_exchange_strong(MDBX_c11a_rw(uint32_t, p), &c, v);
+#else
+  return __sync_bool_compare_and_swap(&p->weak, c, v);
+#endif
+}
+
+static __always_inline uint32_t ipclock_add(MDBX_atomic_uint32_t *p,
+                                            uint32_t v) {
+#ifdef MDBX_HAVE_C11ATOMICS
+  return atomic_fetch_add(MDBX_c11a_rw(uint32_t, p), v);
+#else
+  return __sync_fetch_and_add(&p->weak, v);
+#endif
+}
+
+static __always_inline void ipclock_pause(void) {
+#if defined(__ia32__) || defined(__e2k__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH > 6)
+  __asm__ __volatile__("yield");
+#else
+  osal_compiler_barrier();
+#endif
+}
+
+static bool ipclock_owner_dead(const MDBX_env *env, uint32_t owner) {
+  if (owner == 0 || owner == IPCLOCK_HANDOFF || owner == env->me_pid ||
+      env->me_lfd == INVALID_HANDLE_VALUE)
+    return false;
+  return lck_op(env->me_lazy_fd, op_getlk, F_WRLCK, owner, 1) ==
+         MDBX_RESULT_FALSE;
+}
+
+static bool ipclock_smp(void) {
+  static int ncpu;
+  if (unlikely(ncpu == 0))
+    ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  return ncpu > 1;
+}
+
+static bool ipclock_spin(osal_ipclock_t *ipc, const uint32_t self) {
+  const uint32_t hold_ema = atomic_load32(&ipc->ipc_hold_ema, mo_Relaxed);
+  if (hold_ema > IPCLOCK_SPIN_NS || !ipclock_smp())
+    return false;
+
+  const uint64_t deadline = osal_monotime() + hold_ema * 2;
+  for (size_t n = 1;; ++n) {
+    ipclock_pause();
+    if (atomic_load32(&ipc->ipc_futex, mo_Relaxed) == 0 &&
+        ipclock_cas(&ipc->ipc_futex, 0, self))
+      return true;
+    if (n % 32 == 0 && osal_monotime() > deadline)
+      return false;
+  }
+}
+
+static int ipclock_acquire(MDBX_env *env, osal_ipclock_t *ipc,
+                           const bool dont_wait) {
+  const uint32_t self = env->me_pid;
+  eASSERT(env, self > 0 && self < IPCLOCK_HANDOFF);
+  uint32_t owner = atomic_load32(&ipc->ipc_futex, mo_AcquireRelease);
+  if (likely(owner == 0) && likely(ipclock_cas(&ipc->ipc_futex, 0, self))) {
+    ipc->ipc_acquired = osal_monotime();
+    return MDBX_SUCCESS;
+  }
+
+  int rc = MDBX_SUCCESS;
+  if (dont_wait) {
+    if (!ipclock_owner_dead(env, owner) ||
+        !ipclock_cas(&ipc->ipc_futex, owner, self))
+      return MDBX_BUSY;
+    rc = EOWNERDEAD;
+  } else if (!ipclock_spin(ipc, self)) {
+    ipclock_add(&ipc->ipc_waiters, 1);
+    bool handoff = false;
+    for (;;) {
+      owner = atomic_load32(&ipc->ipc_futex, mo_AcquireRelease);
+      if (owner == 0 || (owner == IPCLOCK_HANDOFF && handoff)) {
+        if (ipclock_cas(&ipc->ipc_futex, owner, self))
+          break;
+        continue;
+      }
+
+      int err = osal_futex_wait(&ipc->ipc_futex.weak, owner,
+                                IPCLOCK_DEADCHECK_NS);
+      /* Only the waiter woken by the releasing owner takes over a handoff,
+       * unless the handoff has got stuck since the woken one has gone. */
+      handoff = err == MDBX_SUCCESS ||
+                (err == ETIMEDOUT && owner == IPCLOCK_HANDOFF);
+      if (err == ETIMEDOUT && ipclock_owner_dead(env, owner) &&
+          ipclock_cas(&ipc->ipc_futex, owner, self)) {
+        rc = EOWNERDEAD;
+        break;
+      }
+      if (unlikely(err != MDBX_SUCCESS && err != ETIMEDOUT && err != EAGAIN &&
+                   err != EINTR)) {
+        ipclock_add(&ipc->ipc_waiters, UINT32_MAX);
+        return err;
+      }
+    }
+    ipclock_add(&ipc->ipc_waiters, UINT32_MAX);
+  }
+
+  ipc->ipc_contended += 1;
+  ipc->ipc_acquired = osal_monotime();
+  return rc;
+}
+
+static int ipclock_release(MDBX_env *env, osal_ipclock_t *ipc) {
+  const uint32_t self = env->me_pid;
+  if (unlikely(atomic_load32(&ipc->ipc_futex, mo_Relaxed) != self))
+    return EPERM;
+
+  const uint64_t hold = osal_monotime() - ipc->ipc_acquired;
+  const uint32_t hold_ema = atomic_load32(&ipc->ipc_hold_ema, mo_Relaxed);
+  const int64_t ema = (int64_t)hold_ema +
+                      ((int64_t)(hold < UINT32_MAX ? hold : UINT32_MAX) -
+                       (int64_t)hold_ema) /
+                          8;
+  atomic_store32(&ipc->ipc_hold_ema, (uint32_t)ema, mo_Relaxed);
+
+  if (atomic_load32(&ipc->ipc_waiters, mo_AcquireRelease) == 0) {
+    ENSURE(env, ipclock_cas(&ipc->ipc_futex, self, 0));
+    /* a waiter which has missed the release will be woken up here, while all
+     * others will see the changed futex word and so don't fall asleep */
+    if (unlikely(atomic_load32(&ipc->ipc_waiters, mo_AcquireRelease) != 0))
+      osal_futex_wake(&ipc->ipc_futex.weak, 1);
+    return MDBX_SUCCESS;
+  }
+
+  ENSURE(env, ipclock_cas(&ipc->ipc_futex, self, IPCLOCK_HANDOFF));
+  int woken = osal_futex_wake(&ipc->ipc_futex.weak, 1);
+  if (woken < 0)
+    return -woken;
+  if (woken == 0 && ipclock_cas(&ipc->ipc_futex, IPCLOCK_HANDOFF, 0) &&
+      atomic_load32(&ipc->ipc_waiters, mo_AcquireRelease) != 0) {
+    /* nobody sleeps yet, so just release and wake up the latecomer */
+    woken = osal_futex_wake(&ipc->ipc_futex.weak, 1);
+    if (woken < 0)
+      return -woken;
+  }
+  return MDBX_SUCCESS;
+}
+#endif /* MDBX_LOCKING == MDBX_LOCKING_BENAPHORE */
+
 #if MDBX_LOCKING > MDBX_LOCKING_SYSV
 MDBX_INTERNAL_FUNC int osal_ipclock_stub(osal_ipclock_t *ipc) {
 #if MDBX_LOCKING == MDBX_LOCKING_POSIX1988
@@ -300,6 +466,9 @@ MDBX_INTERNAL_FUNC int osal_ipclock_stub(osal_ipclock_t *ipc) {
 #elif MDBX_LOCKING == MDBX_LOCKING_POSIX2001 ||                                \
     MDBX_LOCKING == MDBX_LOCKING_POSIX2008
   return pthread_mutex_init(ipc, nullptr);
+#elif MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+  memset(ipc, 0, sizeof(osal_ipclock_t));
+  return MDBX_SUCCESS;
 #else
 #error "FIXME"
 #endif
@@ -311,6 +480,10 @@ MDBX_INTERNAL_FUNC int osal_ipclock_destroy(osal_ipclock_t *ipc) {
 #elif MDBX_LOCKING == MDBX_LOCKING_POSIX2001 ||                                \
     MDBX_LOCKING == MDBX_LOCKING_POSIX2008
   return pthread_mutex_destroy(ipc);
+#elif MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+  /* nothing to release, but a dead owner could leave the lock acquired */
+  (void)ipc;
+  return MDBX_SUCCESS;
 #else
 #error "FIXME"
 #endif
@@ -667,11 +840,16 @@ __cold MDBX_INTERNAL_FUNC int osal_lck_init(MDBX_env *env,
   env->me_sysv_ipc.semid = semid;
   return MDBX_SUCCESS;
 
-#elif MDBX_LOCKING == MDBX_LOCKING_FUTEX
+#elif MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+
+  /* don't initialize futexes twice */
   (void)inprocess_neighbor;
-  if (global_uniqueness_flag != MDBX_RESULT_TRUE)
-    return MDBX_SUCCESS;
-#error "FIXME: Not implemented"
+  if (global_uniqueness_flag == MDBX_RESULT_TRUE) {
+    osal_ipclock_stub(&env->me_lck_mmap.lck->mti_rlock);
+    osal_ipclock_stub(&env->me_lck_mmap.lck->mti_wlock);
+  }
+  return MDBX_SUCCESS;
+
 #elif MDBX_LOCKING == MDBX_LOCKING_POSIX1988
 
   /* don't initialize semaphores twice */
@@ -764,7 +942,8 @@ bailout:
 __cold static int mdbx_ipclock_failed(MDBX_env *env, osal_ipclock_t *ipc,
                                       const int err) {
   int rc = err;
-#if MDBX_LOCKING == MDBX_LOCKING_POSIX2008 || MDBX_LOCKING == MDBX_LOCKING_SYSV
+#if MDBX_LOCKING == MDBX_LOCKING_POSIX2008 ||                                  \
+    MDBX_LOCKING == MDBX_LOCKING_SYSV || MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
   if (err == EOWNERDEAD) {
     /* We own the mutex. Clean up after dead previous owner. */
 
@@ -786,6 +965,10 @@ __cold static int mdbx_ipclock_failed(MDBX_env *env, osal_ipclock_t *ipc,
 
 #if MDBX_LOCKING == MDBX_LOCKING_SYSV
     rc = (rc == MDBX_SUCCESS) ? check_rc : rc;
+#elif MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+    rc = (rc == MDBX_SUCCESS) ? check_rc : rc;
+    if (MDBX_IS_ERROR(rc))
+      ipclock_release(env, ipc);
 #else
 #if defined(PTHREAD_MUTEX_ROBUST) || defined(pthread_mutex_consistent)
     int mreco_rc = pthread_mutex_consistent(ipc);
@@ -811,13 +994,6 @@ __cold static int mdbx_ipclock_failed(MDBX_env *env, osal_ipclock_t *ipc,
   (void)ipc;
 #elif MDBX_LOCKING == MDBX_LOCKING_POSIX1988
   (void)ipc;
-#elif MDBX_LOCKING == MDBX_LOCKING_FUTEX
-#ifdef _MSC_VER
-#pragma message("warning: TODO")
-#else
-#warning "TODO"
-#endif
-  (void)ipc;
 #else
 #error "FIXME"
 #endif /* MDBX_LOCKING */
@@ -878,6 +1054,8 @@ static int mdbx_ipclock_lock(MDBX_env *env, osal_ipclock_t *ipc,
     rc = *ipc ? EOWNERDEAD : MDBX_SUCCESS;
     *ipc = env->me_pid;
   }
+#elif MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+  int rc = ipclock_acquire(env, ipc, dont_wait);
 #else
 #error "FIXME"
 #endif /* MDBX_LOCKING */
@@ -903,6 +1081,8 @@ static int mdbx_ipclock_unlock(MDBX_env *env, osal_ipclock_t *ipc) {
                       .sem_op = 1,
                       .sem_flg = SEM_UNDO};
   int rc = semop(env->me_sysv_ipc.semid, &op, 1) ? errno : MDBX_SUCCESS;
+#elif MDBX_LOCKING == MDBX_LOCKING_BENAPHORE
+  int rc = ipclock_release(env, ipc);
 #else
 #error "FIXME"
 #endif /* MDBX_LOCKING */
@@ -273,6 +273,7 @@ DEFINE_EXCEPTION(reader_slot_busy)
 DEFINE_EXCEPTION(remote_media)
 DEFINE_EXCEPTION(something_busy)
 DEFINE_EXCEPTION(thread_mismatch)
+DEFINE_EXCEPTION(transaction_conflict)
 DEFINE_EXCEPTION(transaction_full)
 DEFINE_EXCEPTION(transaction_overlapping)
 
@@ -359,6 +360,7 @@ __cold void error::throw_exception() const {
     CASE_EXCEPTION(remote_media, MDBX_EREMOTE);
     CASE_EXCEPTION(something_busy, MDBX_BUSY);
     CASE_EXCEPTION(thread_mismatch, MDBX_THREAD_MISMATCH);
+    CASE_EXCEPTION(transaction_conflict, MDBX_TXN_CONFLICT);
     CASE_EXCEPTION(transaction_full, MDBX_TXN_FULL);
     CASE_EXCEPTION(transaction_overlapping, MDBX_TXN_OVERLAPPING);
 #undef CASE_EXCEPTION
@@ -36,6 +36,10 @@ const flagbit dbflags[] = {{MDBX_DUPSORT, "dupsort"},
                            {MDBX_DUPFIXED, "dupfixed"},
                            {MDBX_REVERSEDUP, "reversedup"},
                            {MDBX_INTEGERDUP, "integerdup"},
+                           {MDBX_FIXEDSIZE, "fixedsize"},
+                           {MDBX_ALIGNVALUE8, "alignvalue8"},
+                           {MDBX_ALIGNVALUE16, "alignvalue16"},
+                           {MDBX_ALIGNVALUE64, "alignvalue64"},
                            {0, nullptr}};
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -79,7 +83,7 @@ typedef struct {
     uint64_t subleaf_dupsort, leaf_dupfixed, subleaf_dupfixed;
     uint64_t total, empty, other;
   } pages;
-  uint64_t payload_bytes;
+  uint64_t payload_bytes, leaf_payload_bytes;
   uint64_t lost_bytes;
 } walk_dbi_t;
 
@@ -573,6 +577,8 @@ static int pgvisitor(const uint64_t pgno, const unsigned pgnumber,
       } else {
         dbi->payload_bytes += (uint64_t)payload_bytes + header_bytes;
         walk.total_payload_bytes += (uint64_t)payload_bytes + header_bytes;
+        if (pagetype == MDBX_page_leaf || pagetype == MDBX_page_dupfixed_leaf)
+          dbi->leaf_payload_bytes += (uint64_t)payload_bytes + header_bytes;
       }
     }
   }
@@ -732,10 +738,20 @@ static const char *db_flags2keymode(unsigned flags) {
 }
 
 static const char *db_flags2valuemode(unsigned flags) {
-  flags &= (MDBX_DUPSORT | MDBX_REVERSEDUP | MDBX_DUPFIXED | MDBX_INTEGERDUP);
+  flags &= (MDBX_DUPSORT | MDBX_REVERSEDUP | MDBX_DUPFIXED | MDBX_INTEGERDUP |
+            MDBX_FIXEDSIZE | MDBX_ALIGNVALUE8 | MDBX_ALIGNVALUE16 |
+            MDBX_ALIGNVALUE64);
   switch (flags) {
   case 0:
     return "single";
+  case MDBX_FIXEDSIZE:
+    return "single-samelength";
+  case MDBX_ALIGNVALUE8:
+    return "single-aligned8";
+  case MDBX_ALIGNVALUE16:
+    return "single-aligned16";
+  case MDBX_ALIGNVALUE64:
+    return "single-aligned64";
   case MDBX_DUPSORT:
     return "multi";
   case MDBX_REVERSEDUP:
@@ -925,7 +941,8 @@ static int process_db(MDBX_dbi dbi_handle, const MDBX_val *dbi_name,
       }
 
       if (prev_key.iov_base) {
-        if (prev_data.iov_base && !bad_data && (flags & MDBX_DUPFIXED) &&
+        if (prev_data.iov_base && !bad_data &&
+            (flags & (MDBX_DUPFIXED | MDBX_FIXEDSIZE)) &&
             prev_data.iov_len != data.iov_len) {
           problem_add("entry", record_count, "different data length",
                       "%" PRIuPTR " != %" PRIuPTR, prev_data.iov_len,
@@ -963,12 +980,14 @@ static int process_db(MDBX_dbi dbi_handle, const MDBX_val *dbi_name,
       }
 
       if (!bad_key) {
-        if (verbose && (flags & MDBX_INTEGERKEY) && !prev_key.iov_base)
+        if (verbose && (flags & (MDBX_INTEGERKEY | MDBX_FIXEDSIZE)) &&
+            !prev_key.iov_base)
           print(" - fixed key-size %" PRIuPTR "\n", key.iov_len);
         prev_key = key;
       }
       if (!bad_data) {
-        if (verbose && (flags & (MDBX_INTEGERDUP | MDBX_DUPFIXED)) &&
+        if (verbose &&
+            (flags & (MDBX_INTEGERDUP | MDBX_DUPFIXED | MDBX_FIXEDSIZE)) &&
             !prev_data.iov_base)
           print(" - fixed data-size %" PRIuPTR "\n", data.iov_len);
         prev_data = data;
@@ -987,6 +1006,13 @@ static int process_db(MDBX_dbi dbi_handle, const MDBX_val *dbi_name,
 
     rc = mdbx_cursor_get(mc, &key, &data, MDBX_NEXT);
   }
+  if (rc == MDBX_INCOMPATIBLE && record_count == 0) {
+    /* значения сжаты пользовательским кодеком, который утилите неизвестен,
+     * при этом структура b-tree уже проверена при обходе страниц */
+    print(" - values are packed by a custom codec, skip checking entries\n");
+    rc = 0;
+    goto bailout;
+  }
   if (rc != MDBX_NOTFOUND)
     error("mdbx_cursor_get() failed, error %d %s\n", rc, mdbx_strerror(rc));
   else
@@ -1657,7 +1683,9 @@ int main(int argc, char *argv[]) {
             walk.pgcount, unused_pages);
       if (verbose > 1) {
         for (walk_dbi_t *dbi = walk.dbi;
-             dbi < ARRAY_END(walk.dbi) && dbi->name.iov_base; ++dbi) {
+             dbi < ARRAY_END(walk.dbi) &&
+             (dbi->name.iov_base || dbi == &dbi_main);
+             ++dbi) {
           print("     %s: subtotal %" PRIu64, sdb_name(&dbi->name),
                 dbi->pages.total);
           if (dbi->pages.other && dbi->pages.other != dbi->pages.total)
@@ -1692,7 +1720,9 @@ int main(int argc, char *argv[]) {
                   total_page_bytes);
       if (verbose > 2) {
         for (walk_dbi_t *dbi = walk.dbi;
-             dbi < ARRAY_END(walk.dbi) && dbi->name.iov_base; ++dbi)
+             dbi < ARRAY_END(walk.dbi) &&
+             (dbi->name.iov_base || dbi == &dbi_main);
+             ++dbi)
           if (dbi->pages.total) {
             uint64_t dbi_bytes = dbi->pages.total * envinfo.mi_dxb_pagesize;
             print("     %s: subtotal %" PRIu64 " bytes (%.1f%%),"
@@ -1702,6 +1732,12 @@ int main(int argc, char *argv[]) {
                   dbi->payload_bytes * 100.0 / dbi_bytes,
                   dbi_bytes - dbi->payload_bytes,
                   (dbi_bytes - dbi->payload_bytes) * 100.0 / dbi_bytes);
+            const uint64_t leaf_pages =
+                dbi->pages.leaf + dbi->pages.leaf_dupfixed;
+            if (leaf_pages)
+              print(", leaf fill %.1f%%",
+                    dbi->leaf_payload_bytes * 100.0 /
+                        (leaf_pages * envinfo.mi_dxb_pagesize));
             if (dbi->pages.empty)
               print(", %" PRIu64 " empty pages", dbi->pages.empty);
             if (dbi->lost_bytes)
@@ -51,10 +51,12 @@ static char *prog;
 bool quiet = false;
 static void usage(void) {
   fprintf(stderr,
-          "usage: %s [-V] [-q] [-d] [-s name] dbpath\n"
+          "usage: %s [-V] [-q] [-d] [-c pages] [-s name] dbpath\n"
           "  -V\t\tprint version and exit\n"
           "  -q\t\tbe quiet\n"
           "  -d\t\tdelete the specified database, don't just empty it\n"
+          "  -c pages\tdrop progressively by a series of transactions,\n"
+          "  \t\teach retiring about the given number of pages\n"
           "  -s name\tdrop the specified named subDB\n"
           "  \t\tby default empty the main DB\n",
           prog);
@@ -76,6 +78,7 @@ int main(int argc, char *argv[]) {
   char *subname = nullptr;
   int envflags = MDBX_ACCEDE;
   bool delete = false;
+  size_t chunk = 0;
 
   prog = argv[0];
   if (argc < 2)
@@ -83,6 +86,7 @@ int main(int argc, char *argv[]) {
 
   while ((i = getopt(argc, argv,
                      "d"
+                     "c:"
                      "s:"
                      "n"
                      "q"
@@ -110,6 +114,11 @@ int main(int argc, char *argv[]) {
       break;
     case 'n':
       break;
+    case 'c':
+      chunk = (size_t)strtoull(optarg, nullptr, 0);
+      if (chunk < 1)
+        usage();
+      break;
     case 's':
       subname = optarg;
       break;
@@ -174,9 +183,32 @@ int main(int argc, char *argv[]) {
     goto txn_abort;
   }
 
-  rc = mdbx_drop(txn, dbi, delete);
+  while (chunk && !user_break) {
+    rc = mdbx_drop_ex(txn, dbi, delete, chunk);
+    if (rc != MDBX_RESULT_TRUE)
+      break;
+    rc = mdbx_txn_commit(txn);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      error("mdbx_txn_commit", rc);
+      txn = nullptr;
+      goto env_close;
+    }
+    rc = mdbx_txn_begin(env, NULL, 0, &txn);
+    if (unlikely(rc != MDBX_SUCCESS)) {
+      error("mdbx_txn_begin", rc);
+      goto env_close;
+    }
+  }
+  if (chunk && user_break) {
+    if (!quiet)
+      fprintf(stderr, "%s: interrupted, the drop was not completed\n", prog);
+    rc = MDBX_EINTR;
+    goto txn_abort;
+  }
+  if (!chunk)
+    rc = mdbx_drop(txn, dbi, delete);
   if (unlikely(rc != MDBX_SUCCESS)) {
-    error("mdbx_drop", rc);
+    error(chunk ? "mdbx_drop_ex" : "mdbx_drop", rc);
     goto txn_abort;
   }
 
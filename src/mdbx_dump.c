@@ -40,6 +40,10 @@ flagbit dbflags[] = {{MDBX_REVERSEKEY, "reversekey"},
                      {MDBX_DUPFIXED, "dupfixed"},
                      {MDBX_INTEGERDUP, "integerdup"},
                      {MDBX_REVERSEDUP, "reversedup"},
+                     {MDBX_FIXEDSIZE, "fixedsize"},
+                     {MDBX_ALIGNVALUE8, "alignvalue8"},
+                     {MDBX_ALIGNVALUE16, "alignvalue16"},
+                     {MDBX_ALIGNVALUE64, "alignvalue64"},
                      {0, nullptr}};
 
 #if defined(_WIN32) || defined(_WIN64)
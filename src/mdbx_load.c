@@ -140,7 +140,11 @@ flagbit dbflags[] = {
     {MDBX_REVERSEKEY, S("reversekey")}, {MDBX_DUPSORT, S("duplicates")},
     {MDBX_DUPSORT, S("dupsort")},       {MDBX_INTEGERKEY, S("integerkey")},
     {MDBX_DUPFIXED, S("dupfixed")},     {MDBX_INTEGERDUP, S("integerdup")},
-    {MDBX_REVERSEDUP, S("reversedup")}, {0, 0, nullptr}};
+    {MDBX_REVERSEDUP, S("reversedup")}, {MDBX_FIXEDSIZE, S("fixedsize")},
+    {MDBX_ALIGNVALUE8, S("alignvalue8")},
+    {MDBX_ALIGNVALUE16, S("alignvalue16")},
+    {MDBX_ALIGNVALUE64, S("alignvalue64")},
+    {0, 0, nullptr}};
 
 static int readhdr(void) {
   /* reset parameters */
@@ -509,6 +513,7 @@ int main(int argc, char *argv[]) {
   MDBX_env *env = nullptr;
   MDBX_txn *txn = nullptr;
   MDBX_cursor *mc = nullptr;
+  MDBX_bulk *bulk = nullptr;
   MDBX_dbi dbi;
   char *envname = nullptr;
   int envflags = MDBX_SAFE_NOSYNC | MDBX_ACCEDE, putflags = MDBX_UPSERT;
@@ -756,10 +761,20 @@ int main(int argc, char *argv[]) {
       putflags = (dbi_flags & MDBX_DUPSORT) ? putflags | MDBX_APPENDDUP
                                             : putflags & ~MDBX_APPENDDUP;
 
-    rc = mdbx_cursor_open(txn, dbi, &mc);
-    if (unlikely(rc != MDBX_SUCCESS)) {
-      error("mdbx_cursor_open", rc);
-      goto txn_abort;
+    /* Для упорядоченной загрузки в таблицы без дубликатов используется
+     * построитель дерева, заполняющий страницы слева направо целиком. */
+    if ((putflags & MDBX_APPEND) && !(dbi_flags & MDBX_DUPSORT)) {
+      rc = mdbx_bulk_begin(txn, dbi, 0, &bulk);
+      if (unlikely(rc != MDBX_SUCCESS)) {
+        error("mdbx_bulk_begin", rc);
+        goto txn_abort;
+      }
+    } else {
+      rc = mdbx_cursor_open(txn, dbi, &mc);
+      if (unlikely(rc != MDBX_SUCCESS)) {
+        error("mdbx_cursor_open", rc);
+        goto txn_abort;
+      }
     }
 
     int batch = 0;
@@ -778,7 +793,25 @@ int main(int argc, char *argv[]) {
         goto txn_abort;
       }
 
-      rc = mdbx_cursor_put(mc, &key, &data, putflags);
+      if (bulk) {
+        rc = mdbx_bulk_add(bulk, &key, &data);
+        if (rc == MDBX_EKEYMISMATCH) {
+          /* повтор ключа, обрабатываем как при обычной вставке */
+          rc = mdbx_bulk_finish(bulk);
+          bulk = nullptr;
+          if (likely(rc == MDBX_SUCCESS))
+            rc = mdbx_put(txn, dbi, &key, &data, putflags);
+          if (rc == MDBX_SUCCESS || rc == MDBX_KEYEXIST) {
+            const int err = mdbx_bulk_begin(txn, dbi, 0, &bulk);
+            if (unlikely(err != MDBX_SUCCESS)) {
+              error("mdbx_bulk_begin", err);
+              rc = err;
+              goto txn_abort;
+            }
+          }
+        }
+      } else
+        rc = mdbx_cursor_put(mc, &key, &data, putflags);
       if (rc == MDBX_KEYEXIST && putflags)
         continue;
       if (rc == MDBX_BAD_VALSIZE && rescue) {
@@ -788,7 +821,7 @@ int main(int argc, char *argv[]) {
         continue;
       }
       if (unlikely(rc != MDBX_SUCCESS)) {
-        error("mdbx_cursor_put", rc);
+        error(bulk ? "mdbx_bulk_add" : "mdbx_cursor_put", rc);
         goto txn_abort;
       }
       batch++;
@@ -801,6 +834,14 @@ int main(int argc, char *argv[]) {
       }
 
       if (batch == 10000 || txn_info.txn_space_dirty > MEGABYTE * 256) {
+        if (bulk) {
+          rc = mdbx_bulk_finish(bulk);
+          bulk = nullptr;
+          if (unlikely(rc != MDBX_SUCCESS)) {
+            error("mdbx_bulk_finish", rc);
+            goto txn_abort;
+          }
+        }
         rc = mdbx_txn_commit(txn);
         if (unlikely(rc != MDBX_SUCCESS)) {
           error("mdbx_txn_commit", rc);
@@ -813,16 +854,33 @@ int main(int argc, char *argv[]) {
           error("mdbx_txn_begin", rc);
           goto env_close;
         }
-        rc = mdbx_cursor_bind(txn, mc, dbi);
-        if (unlikely(rc != MDBX_SUCCESS)) {
-          error("mdbx_cursor_bind", rc);
-          goto txn_abort;
+        if (mc) {
+          rc = mdbx_cursor_bind(txn, mc, dbi);
+          if (unlikely(rc != MDBX_SUCCESS)) {
+            error("mdbx_cursor_bind", rc);
+            goto txn_abort;
+          }
+        } else {
+          rc = mdbx_bulk_begin(txn, dbi, 0, &bulk);
+          if (unlikely(rc != MDBX_SUCCESS)) {
+            error("mdbx_bulk_begin", rc);
+            goto txn_abort;
+          }
         }
       }
     }
 
     mdbx_cursor_close(mc);
     mc = nullptr;
+    if (bulk) {
+      const int err = mdbx_bulk_finish(bulk);
+      bulk = nullptr;
+      if (unlikely(err != MDBX_SUCCESS)) {
+        error("mdbx_bulk_finish", err);
+        rc = err;
+        goto txn_abort;
+      }
+    }
     rc = mdbx_txn_commit(txn);
     txn = nullptr;
     if (unlikely(rc != MDBX_SUCCESS)) {
@@ -862,6 +920,8 @@ int main(int argc, char *argv[]) {
   }
 
 txn_abort:
+  if (bulk)
+    mdbx_bulk_finish(bulk);
   mdbx_cursor_close(mc);
   mdbx_txn_abort(txn);
 env_close:
@@ -189,6 +189,13 @@
 #error MDBX_ENVCOPY_WRITEBUF must be defined in range 65536..1073741824 and be multiple of 65536
 #endif /* MDBX_ENVCOPY_WRITEBUF */
 
+/** Size of segments of the value log, see mdbx_dbi_set_vlog() */
+#ifndef MDBX_VLOG_SEGMENT_SIZE
+#define MDBX_VLOG_SEGMENT_SIZE 67108864u
+#elif MDBX_VLOG_SEGMENT_SIZE < 65536u || MDBX_VLOG_SEGMENT_SIZE > 1073741824u
+#error MDBX_VLOG_SEGMENT_SIZE must be defined in range 65536..1073741824
+#endif /* MDBX_VLOG_SEGMENT_SIZE */
+
 /** Forces assertion checking */
 #ifndef MDBX_FORCE_ASSERTIONS
 #define MDBX_FORCE_ASSERTIONS 0
@@ -261,7 +268,7 @@
 /** POSIX-2008 Robust Mutexes for \ref MDBX_LOCKING */
 #define MDBX_LOCKING_POSIX2008 2008
 
-/** BeOS Benaphores, aka Futexes for \ref MDBX_LOCKING */
+/** BeOS Benaphores, aka Futexes (Linux only) for \ref MDBX_LOCKING */
 #define MDBX_LOCKING_BENAPHORE 1995
 
 /** Advanced: Choices the locking implementation (autodetection by default). */
@@ -1738,6 +1738,24 @@ MDBX_INTERNAL_FUNC int osal_ftruncate(mdbx_filehandle_t fd, uint64_t length) {
 #endif
 }
 
+/* Освобождает место занятое участком файла без изменения его размера.
+ * Возвращает MDBX_RESULT_TRUE, если это не поддерживается ОС или ФС. */
+MDBX_INTERNAL_FUNC int osal_punchhole(mdbx_filehandle_t fd, uint64_t offset,
+                                     uint64_t length) {
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+  if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset,
+                length) == 0)
+    return MDBX_SUCCESS;
+  const int err = errno;
+  return (err == EOPNOTSUPP || err == ENOSYS) ? MDBX_RESULT_TRUE : err;
+#else
+  (void)fd;
+  (void)offset;
+  (void)length;
+  return MDBX_RESULT_TRUE;
+#endif
+}
+
 MDBX_INTERNAL_FUNC int osal_fseek(mdbx_filehandle_t fd, uint64_t pos) {
 #if defined(_WIN32) || defined(_WIN64)
   LARGE_INTEGER li;
@@ -1775,6 +1793,45 @@ MDBX_INTERNAL_FUNC int osal_thread_join(osal_thread_t thread) {
 #endif
 }
 
+MDBX_INTERNAL_FUNC int osal_futex_wait(volatile uint32_t *ptr,
+                                       uint32_t expected, uint64_t timeout_ns) {
+#if defined(__linux__) || defined(__gnu_linux__)
+  struct timespec ts, *timeout = nullptr;
+  if (timeout_ns) {
+    ts.tv_sec = (time_t)(timeout_ns / 1000000000u);
+    ts.tv_nsec = (long)(timeout_ns % 1000000000u);
+    timeout = &ts;
+  }
+  return syscall(SYS_futex, ptr, FUTEX_WAIT, expected, timeout, nullptr, 0)
+             ? errno
+             : MDBX_SUCCESS;
+#else
+  /* polling fallback, the caller should re-check the condition anyway */
+  if (*ptr != expected)
+    return EAGAIN;
+  const uint64_t nap_ns =
+      (timeout_ns && timeout_ns < 1000000u) ? timeout_ns : 1000000u;
+#if defined(_WIN32) || defined(_WIN64)
+  Sleep((DWORD)((nap_ns + 999999u) / 1000000u));
+#else
+  usleep((useconds_t)((nap_ns + 999u) / 1000u));
+#endif
+  return (nap_ns == timeout_ns) ? ETIMEDOUT : MDBX_SUCCESS;
+#endif /* Linux */
+}
+
+MDBX_INTERNAL_FUNC int osal_futex_wake(volatile uint32_t *ptr, int count) {
+#if defined(__linux__) || defined(__gnu_linux__)
+  const long woken =
+      syscall(SYS_futex, ptr, FUTEX_WAKE, count, nullptr, nullptr, 0);
+  return (woken < 0) ? -errno : (int)woken;
+#else
+  (void)ptr;
+  (void)count;
+  return 0;
+#endif /* Linux */
+}
+
 /*----------------------------------------------------------------------------*/
 
 MDBX_INTERNAL_FUNC int osal_msync(const osal_mmap_t *map, size_t offset,
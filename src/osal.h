@@ -524,6 +524,14 @@ osal_thread_create(osal_thread_t *thread,
                    void *arg);
 MDBX_INTERNAL_FUNC int osal_thread_join(osal_thread_t thread);
 
+/* Waits until the value at the given address of a shared memory differs from
+ * the expected one, but no longer than timeout_ns (zero means infinite).
+ * This is a futex on Linux, and a short nap on others platforms. */
+MDBX_INTERNAL_FUNC int osal_futex_wait(volatile uint32_t *ptr,
+                                       uint32_t expected, uint64_t timeout_ns);
+/* Wakes up to count waiters, returns the number of woken or -errno. */
+MDBX_INTERNAL_FUNC int osal_futex_wake(volatile uint32_t *ptr, int count);
+
 enum osal_syncmode_bits {
   MDBX_SYNC_NONE = 0,
   MDBX_SYNC_KICK = 1,
@@ -535,6 +543,8 @@ enum osal_syncmode_bits {
 MDBX_INTERNAL_FUNC int osal_fsync(mdbx_filehandle_t fd,
                                   const enum osal_syncmode_bits mode_bits);
 MDBX_INTERNAL_FUNC int osal_ftruncate(mdbx_filehandle_t fd, uint64_t length);
+MDBX_INTERNAL_FUNC int osal_punchhole(mdbx_filehandle_t fd, uint64_t offset,
+                                     uint64_t length);
 MDBX_INTERNAL_FUNC int osal_fseek(mdbx_filehandle_t fd, uint64_t pos);
 MDBX_INTERNAL_FUNC int osal_filesize(mdbx_filehandle_t fd, uint64_t *length);
 